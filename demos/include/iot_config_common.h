@@ -86,6 +86,13 @@
     #define IOT_STATIC_MEMORY_ONLY    ( 0 )
 #endif
 
+/* Control the usage of the size-class slab allocator of iot_slab.c for the
+ * MQTT, task pool and serializer objects, in place of the FreeRTOS heap or of
+ * the static memory arrays. */
+#ifndef IOT_SLAB_ALLOCATOR
+    #define IOT_SLAB_ALLOCATOR    ( 0 )
+#endif
+
 /* Memory allocation configuration. Note that these functions will not be affected
  * by IOT_STATIC_MEMORY_ONLY. */
 #define IotNetwork_Malloc    pvPortMalloc
@@ -103,35 +110,50 @@
 /* Memory allocation function configuration for the MQTT and Defender library.
  * These libraries will be affected by IOT_STATIC_MEMORY_ONLY. */
 #if IOT_STATIC_MEMORY_ONLY == 0
+    /* With the slab allocator, the requests it cannot serve, such as large
+     * MQTT packets, fall back to the FreeRTOS heap. */
+    #if IOT_SLAB_ALLOCATOR == 1
+        void * IotSlab_Malloc( size_t size );
+        void IotSlab_Free( void * ptr );
+
+        #define IotSlab_FallbackMalloc           pvPortMalloc
+        #define IotSlab_FallbackFree             vPortFree
+        #define IotObject_Malloc                 IotSlab_Malloc
+        #define IotObject_Free                   IotSlab_Free
+    #else
+        #define IotObject_Malloc                 pvPortMalloc
+        #define IotObject_Free                   vPortFree
+    #endif
+
     #define IotMetrics_MallocTcpConnection       pvPortMalloc
     #define IotMetrics_FreeTcpConnection         vPortFree
     #define IotMetrics_MallocIpAddress           pvPortMalloc
     #define IotMetrics_FreeIpAddress             vPortFree
 
-    #define IotTaskPool_MallocTaskPool           pvPortMalloc
-    #define IotTaskPool_FreeTaskPool             vPortFree
-    #define IotTaskPool_MallocJob                pvPortMalloc
-    #define IotTaskPool_FreeJob                  vPortFree
-    #define IotTaskPool_MallocTimerEvent         pvPortMalloc
-    #define IotTaskPool_FreeTimerEvent           vPortFree
-
-    #define IotMqtt_MallocConnection             pvPortMalloc
-    #define IotMqtt_FreeConnection               vPortFree
-    #define IotMqtt_MallocMessage                pvPortMalloc
-    #define IotMqtt_FreeMessage                  vPortFree
-    #define IotMqtt_MallocOperation              pvPortMalloc
-    #define IotMqtt_FreeOperation                vPortFree
-    #define IotMqtt_MallocSubscription           pvPortMalloc
-    #define IotMqtt_FreeSubscription             vPortFree
-
-    #define IotSerializer_MallocCborEncoder      pvPortMalloc
-    #define IotSerializer_FreeCborEncoder        vPortFree
-    #define IotSerializer_MallocCborParser       pvPortMalloc
-    #define IotSerializer_FreeCborParser         vPortFree
-    #define IotSerializer_MallocCborValue        pvPortMalloc
-    #define IotSerializer_FreeCborValue          vPortFree
-    #define IotSerializer_MallocDecoderObject    pvPortMalloc
-    #define IotSerializer_FreeDecoderObject      vPortFree
+    #define IotTaskPool_MallocTaskPool           IotObject_Malloc
+    #define IotTaskPool_FreeTaskPool             IotObject_Free
+    #define IotTaskPool_MallocJob                IotObject_Malloc
+    #define IotTaskPool_FreeJob                  IotObject_Free
+    #define IotTaskPool_MallocTimerEvent         IotObject_Malloc
+    #define IotTaskPool_FreeTimerEvent           IotObject_Free
+
+    #define IotMqtt_MallocConnection             IotObject_Malloc
+    #define IotMqtt_FreeConnection               IotObject_Free
+    #define IotMqtt_MallocMessage                IotObject_Malloc
+    #define IotMqtt_FreeMessage                  IotObject_Free
+    #define IotMqtt_MallocOperation              IotObject_Malloc
+    #define IotMqtt_FreeOperation                IotObject_Free
+    #define IotMqtt_MallocSubscription           IotObject_Malloc
+    #define IotMqtt_FreeSubscription             IotObject_Free
+
+    #define IotSerializer_MallocCborEncoder      IotObject_Malloc
+    #define IotSerializer_FreeCborEncoder        IotObject_Free
+    #define IotSerializer_MallocCborParser       IotObject_Malloc
+    #define IotSerializer_FreeCborParser         IotObject_Free
+    #define IotSerializer_MallocCborValue        IotObject_Malloc
+    #define IotSerializer_FreeCborValue          IotObject_Free
+    #define IotSerializer_MallocDecoderObject    IotObject_Malloc
+    #define IotSerializer_FreeDecoderObject      IotObject_Free
 
     #define AwsIotShadow_MallocOperation         pvPortMalloc
     #define AwsIotShadow_FreeOperation           vPortFree
@@ -48,8 +48,13 @@
 #include "iot_mqtt.h"
 
 #include "iot_secure_sockets.h"
+#include "iot_secure_sockets_poll.h"
 
-#include "time.h"
+/* Water meter readings. */
+#include "meter_poll.h"
+#include "meter_record.h"
+#include "meter_journal.h"
+#include "path_trace.h"
 
 /**
  * @cond DOXYGEN_IGNORE
@@ -139,6 +144,22 @@
  */
 #define TOPIC_FILTER_LENGTH                      ( ( uint16_t ) ( sizeof( IOT_DEMO_MQTT_TOPIC_PREFIX "/topic/1" ) - 1 ) )
 
+/**
+ * @brief The number of meter records published by this demo.
+ */
+#define PUBLISH_MESSAGE_COUNT                    ( IOT_DEMO_MQTT_PUBLISH_BURST_SIZE * IOT_DEMO_MQTT_PUBLISH_BURST_COUNT )
+
+/**
+ * @brief The longest wait for the next polling round of the meters, a few
+ * polling periods.
+ */
+#define METER_ROUND_TIMEOUT_MS                   ( 60000 )
+
+/**
+ * @brief Interval at which the meter snapshot is checked for a new round.
+ */
+#define METER_ROUND_CHECK_MS                     ( 500 )
+
 /**
  * @brief Format string of the PUBLISH messages in this demo.
  */
@@ -149,6 +170,30 @@
  */
 #define PUBLISH_PAYLOAD_BUFFER_LENGTH            ( sizeof( PUBLISH_PAYLOAD_FORMAT ) + 2 )
 
+/**
+ * @brief Wire format of the meter records, JSON unless configured otherwise.
+ */
+#ifndef IOT_DEMO_MQTT_METER_RECORD_FORMAT
+    #define IOT_DEMO_MQTT_METER_RECORD_FORMAT    METER_RECORD_FORMAT_JSON
+#endif
+
+/**
+ * @brief Readings of the meter journal sent in one PUBLISH.
+ */
+#ifndef IOT_DEMO_MQTT_JOURNAL_BATCH_SIZE
+    #define IOT_DEMO_MQTT_JOURNAL_BATCH_SIZE     ( 8 )
+#endif
+
+/**
+ * @brief The topic name on which the journal batches are published.
+ */
+#define JOURNAL_TOPIC_NAME                       IOT_DEMO_MQTT_TOPIC_PREFIX "/journal"
+
+/**
+ * @brief The length of #JOURNAL_TOPIC_NAME.
+ */
+#define JOURNAL_TOPIC_NAME_LENGTH                ( ( uint16_t ) ( sizeof( JOURNAL_TOPIC_NAME ) - 1 ) )
+
 /**
  * @brief The maximum number of times each PUBLISH in this demo will be retried.
  */
@@ -192,22 +237,38 @@ int RunMqttDemo( bool awsIotMqttMode,
 
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief A meter reading being published, kept until its PUBLISH completes so
+ * that it can be journaled if the server does not acknowledge it.
+ */
+typedef struct _publishedReading
+{
+    MeterReading_t reading; /**< @brief The reading in the PUBLISH. */
+    uint32_t timestamp;     /**< @brief Timestamp of the reading in the record. */
+    intptr_t publishCount;  /**< @brief The number of the PUBLISH. */
+    volatile bool pending;  /**< @brief Set until the PUBLISH completes. */
+} _publishedReading_t;
+
+/**
+ * @brief Readings of the PUBLISH operations in flight, one per message of a burst.
+ */
+static _publishedReading_t pPublishedReadings[ IOT_DEMO_MQTT_PUBLISH_BURST_SIZE ];
+
+/*-----------------------------------------------------------*/
+
 /**
  * @brief Called by the MQTT library when an operation completes.
  *
  * The demo uses this callback to determine the result of PUBLISH operations.
- * @param[in] param1 The number of the PUBLISH that completed, passed as an intptr_t.
+ * A reading whose PUBLISH was not acknowledged is moved to the meter journal.
+ * @param[in] param1 The #_publishedReading_t of the PUBLISH that completed.
  * @param[in] pOperation Information about the completed operation passed by the
  * MQTT library.
  */
 static void _operationCompleteCallback( void * param1,
                                         IotMqttCallbackParam_t * const pOperation )
 {
-    intptr_t publishCount = ( intptr_t ) param1;
-
-    /* Silence warnings about unused variables. publishCount will not be used if
-     * logging is disabled. */
-    ( void ) publishCount;
+    _publishedReading_t * pPublished = ( _publishedReading_t * ) param1;
 
     /* Print the status of the completed operation. A PUBLISH operation is
      * successful when transmitted over the network. */
@@ -215,15 +276,24 @@ static void _operationCompleteCallback( void * param1,
     {
         IotLogInfo( "MQTT %s %d successfully sent.",
                     IotMqtt_OperationType( pOperation->u.operation.type ),
-                    ( int ) publishCount );
+                    ( int ) pPublished->publishCount );
     }
     else
     {
         IotLogError( "MQTT %s %d could not be sent. Error %s.",
                      IotMqtt_OperationType( pOperation->u.operation.type ),
-                     ( int ) publishCount,
+                     ( int ) pPublished->publishCount,
                      IotMqtt_strerror( pOperation->u.operation.result ) );
+
+        if( WaterMeter_JournalAppend( &pPublished->reading,
+                                      pPublished->timestamp ) == false )
+        {
+            IotLogError( "Failed to journal the reading of PUBLISH %d.",
+                         ( int ) pPublished->publishCount );
+        }
     }
+
+    pPublished->pending = false;
 }
 
 /*-----------------------------------------------------------*/
@@ -600,39 +670,19 @@ static int _modifySubscriptions( IotMqttConnection_t mqttConnection,
 
 /*-----------------------------------------------------------*/
 
-extern uint8_t water_meter_station_id;
-extern uint64_t water_meter_meter_id;
-extern uint64_t water_meter_amount;
-extern uint8_t water_meter_amount_place;
-extern uint64_t water_meter_reverse_amount;
-extern uint8_t water_meter_reverse_amount_place;
-extern uint16_t water_meter_lday;
-extern uint16_t water_meter_nday;
-extern uint16_t water_meter_oday;
-extern uint16_t water_meter_uday;
-extern uint16_t water_meter_hday;
-extern uint16_t water_meter_bday;
-extern uint16_t water_meter_op;
-
-static char pPublishPayload[ 1024 ] = { 0 };
-
-void water_meter_read();
-
-static char bfr[20+1];
-
-static char* uint64ToDecimal(uint64_t v) {
-  char* p = bfr + sizeof(bfr);
-  *(--p) = '\0';
-  for (bool first = true; v || first; first = false) {
-    const uint32_t digit = v % 10;
-    const char c = '0' + digit;
-    *(--p) = c;
-    v = v / 10;
-  }
-  return p;
-}
+/* Meter readings of the last polling round. */
+static MeterPollSnapshot_t meterSnapshot;
+
+/* Records are encoded straight into this buffer. */
+static uint8_t pPublishPayload[ meterrecordMAX_LENGTH ];
+
+/* Journal readings being sent and their batch, one separator per record and
+ * the two array delimiters. */
+static MeterJournalEntry_t pJournalEntries[ IOT_DEMO_MQTT_JOURNAL_BATCH_SIZE ];
+static uint8_t pJournalPayload[ IOT_DEMO_MQTT_JOURNAL_BATCH_SIZE * ( meterrecordMAX_LENGTH + 1 ) + 2 ];
 
 #define NTP_PACKET_SIZE (48)
+#define NTP_TIMEOUT_MS  (5000)
 uint8_t ntpbuf[NTP_PACKET_SIZE];
 
 uint32_t epoch = 0;
@@ -642,6 +692,7 @@ void get_utc_time()
     int ret;
     Socket_t xSocket;
     SocketsSockaddr_t xNtpServer;
+    SocketsPollFd_t xPollFd;
 
     xNtpServer.usPort = SOCKETS_htons( 123 );
     xNtpServer.ulAddress = SOCKETS_inet_addr_quick( 129, 6, 15, 28 );
@@ -667,7 +718,20 @@ void get_utc_time()
     {
         SOCKETS_Send(xSocket, ntpbuf, NTP_PACKET_SIZE, 0);
 
-        ret = SOCKETS_Recv( xSocket, ntpbuf, NTP_PACKET_SIZE, 0);
+        /* Woken up by the data ready URC of the reply, a lost reply ends the
+         * wait after NTP_TIMEOUT_MS whatever the socket receive timeout. */
+        xPollFd.xSocket = xSocket;
+        xPollFd.usEvents = SOCKETS_POLLIN;
+
+        if( ( SOCKETS_Poll( &xPollFd, 1, pdMS_TO_TICKS( NTP_TIMEOUT_MS ) ) > 0 ) &&
+            ( ( xPollFd.usREvents & SOCKETS_POLLIN ) != 0U ) )
+        {
+            ret = SOCKETS_Recv( xSocket, ntpbuf, NTP_PACKET_SIZE, 0);
+        }
+        else
+        {
+            ret = SOCKETS_EWOULDBLOCK;
+        }
         if (ret > 0) {
             uint32_t secsSince1900;
             secsSince1900 = ntpbuf[40];
@@ -685,9 +749,117 @@ void get_utc_time()
     }
 }
 
+/**
+ * @brief Timestamp of a reading, 0 if it was taken before the time was known.
+ */
+static uint32_t _readingTimestamp( const MeterPollStation_t * pStation )
+{
+    return ( epoch != 0U ) ? ( epoch + pStation->ulReadTime / configTICK_RATE_HZ ) : 0U;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Move the readings of #meterSnapshot that will not be published to the
+ * meter journal.
+ *
+ * @param[in] firstStation Index of the first station not published.
+ */
+static void _journalRemainingReadings( uint8_t firstStation )
+{
+    uint8_t station = 0;
+    const MeterPollStation_t * pStation = NULL;
+
+    for( station = firstStation; station < meterSnapshot.ucStationCount; station++ )
+    {
+        pStation = &meterSnapshot.xStations[ station ];
+
+        if( ( pStation->ucStatus == METER_POLL_OK ) &&
+            ( pStation->ulRound == meterSnapshot.ulRound ) &&
+            ( WaterMeter_JournalAppend( &pStation->xReading,
+                                        _readingTimestamp( pStation ) ) == false ) )
+        {
+            IotLogError( "Failed to journal the reading of station %d.",
+                         pStation->ucAddress );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Wait for a polling round newer than @p lastRound.
+ *
+ * @param[in] lastRound The round already published, 0 for none.
+ *
+ * @return `true` if #meterSnapshot holds a newer round; `false` if none
+ * completed within #METER_ROUND_TIMEOUT_MS.
+ */
+static bool _waitForMeterRound( uint32_t lastRound )
+{
+    uint32_t waitMs = 0;
+
+    for( waitMs = 0; waitMs < METER_ROUND_TIMEOUT_MS; waitMs += METER_ROUND_CHECK_MS )
+    {
+        if( ( WaterMeter_GetSnapshot( &meterSnapshot ) == true ) &&
+            ( meterSnapshot.ulRound != lastRound ) )
+        {
+            return true;
+        }
+
+        IotClock_SleepMs( METER_ROUND_CHECK_MS );
+    }
+
+    return false;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Wait for published messages to be received on the topic filters.
+ *
+ * @param[in] pPublishReceivedCounter Counts the number of messages received on
+ * topic filters.
+ * @param[in] count Number of messages to wait for.
+ *
+ * @return `EXIT_SUCCESS` if all were received; `EXIT_FAILURE` otherwise.
+ */
+static int _waitForPublishes( IotSemaphore_t * pPublishReceivedCounter,
+                              intptr_t count )
+{
+    int status = EXIT_SUCCESS;
+    intptr_t i = 0;
+
+    IotLogInfo( "Waiting for %d publishes to be received.",
+                ( int ) count );
+
+    for( i = 0; i < count; i++ )
+    {
+        if( IotSemaphore_TimedWait( pPublishReceivedCounter,
+                                    MQTT_TIMEOUT_MS ) == false )
+        {
+            IotLogError( "Timed out waiting for incoming PUBLISH messages." );
+            status = EXIT_FAILURE;
+            break;
+        }
+    }
+
+    IotLogInfo( "%d publishes received.",
+                ( int ) i );
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
 /**
  * @brief Transmit all messages and wait for them to be received on topic filters.
  *
+ * Each station that answered in a polling round is published once for that
+ * round; stations that timed out or sent bad replies are skipped. Readings of
+ * a round taken from the snapshot that are not acknowledged by the server go
+ * to the meter journal.
+ *
  * @param[in] mqttConnection The MQTT connection to use for publishing.
  * @param[in] pTopicNames Array of topic names for publishing. These were previously
  * subscribed to as topic filters.
@@ -702,11 +874,15 @@ static int _publishAllMessages( IotMqttConnection_t mqttConnection,
                                 IotSemaphore_t * pPublishReceivedCounter )
 {
     int status = EXIT_SUCCESS;
-    intptr_t publishCount = 0, i = 0;
+    intptr_t publishCount = 0, roundCount = 0;
+    uint32_t lastRound = 0;
+    uint8_t station = 0, firstUnpublished = 0;
+    uint32_t waitMs = 0, traceStart = 0;
+    const MeterPollStation_t * pStation = NULL;
+    _publishedReading_t * pPublished = NULL;
     IotMqttError_t publishStatus = IOT_MQTT_STATUS_PENDING;
     IotMqttPublishInfo_t publishInfo = IOT_MQTT_PUBLISH_INFO_INITIALIZER;
     IotMqttCallbackInfo_t publishComplete = IOT_MQTT_CALLBACK_INFO_INITIALIZER;
-    //char pPublishPayload[ PUBLISH_PAYLOAD_BUFFER_LENGTH ] = { 0 };
 
     /* The MQTT library should invoke this callback when a PUBLISH message
      * is successfully transmitted. */
@@ -719,126 +895,254 @@ static int _publishAllMessages( IotMqttConnection_t mqttConnection,
     publishInfo.retryMs = PUBLISH_RETRY_MS;
     publishInfo.retryLimit = PUBLISH_RETRY_LIMIT;
 
-    water_meter_read();
-
-    /* Loop to PUBLISH all messages of this demo. */
-    for( publishCount = 0;
-         publishCount < IOT_DEMO_MQTT_PUBLISH_BURST_SIZE * IOT_DEMO_MQTT_PUBLISH_BURST_COUNT;
-         publishCount++ )
+    /* Publish the readings of successive polling rounds, one station per
+     * message, until the demo's message budget is spent. The round count is
+     * bounded too, so a segment where no meter answers ends the demo. */
+    for( roundCount = 0;
+         ( roundCount < PUBLISH_MESSAGE_COUNT ) && ( publishCount < PUBLISH_MESSAGE_COUNT );
+         roundCount++ )
     {
-        /* Announce which burst of messages is being published. */
-        if( publishCount % IOT_DEMO_MQTT_PUBLISH_BURST_SIZE == 0 )
+        if( _waitForMeterRound( lastRound ) == false )
         {
-            IotLogInfo( "Publishing messages %d to %d.",
-                        publishCount,
-                        publishCount + IOT_DEMO_MQTT_PUBLISH_BURST_SIZE - 1 );
+            IotLogError( "No meter round completed after round %lu.",
+                         ( unsigned long ) lastRound );
+            status = EXIT_FAILURE;
+
+            break;
         }
 
-        /* Pass the PUBLISH number to the operation complete callback. */
-        publishComplete.pCallbackContext = ( void * ) publishCount;
-
-        /* Choose a topic name (round-robin through the array of topic names). */
-        publishInfo.pTopicName = pTopicNames[ publishCount % TOPIC_FILTER_COUNT ];
-
-        time_t e = epoch + xTaskGetTickCount()/1000;
-        char tbuf[80];
-        strftime(tbuf, 80, "%Y-%m-%dT%H:%M:%SZ", localtime(&e));
-
-        struct tm *date = gmtime( &e );
-
-        memset(pPublishPayload, 0, sizeof(pPublishPayload));
-        char *p = pPublishPayload;
-        p += sprintf(p, "{\"timestamp\":\"%s\"", tbuf);
-        p += sprintf(p, ",\"STATION_NO\":%d", water_meter_station_id);
-        p += sprintf(p, ",\"METER_NO\":%s", uint64ToDecimal(water_meter_meter_id));
-        p += sprintf(p, ",\"AMOUNT\":%s", uint64ToDecimal(water_meter_amount));
-        p += sprintf(p, ",\"AMOUNT_PLACES\":%d", water_meter_amount_place);
-        p += sprintf(p, ",\"REVERSE_AMOUNT\":%s", uint64ToDecimal(water_meter_reverse_amount));
-        p += sprintf(p, ",\"REVERSE_AMOUNT_PLACES\":%d", water_meter_reverse_amount_place);
-        p += sprintf(p, ",\"LDAY\":%d", water_meter_lday);
-        p += sprintf(p, ",\"NDAY\":%d", water_meter_nday);
-        p += sprintf(p, ",\"ODAY\":%d", water_meter_oday);
-        p += sprintf(p, ",\"UDAY\":%d", water_meter_uday);
-        p += sprintf(p, ",\"HDAY\":%d", water_meter_hday);
-        p += sprintf(p, ",\"BDAY\":%d", water_meter_bday);
-        p += sprintf(p, ",\"OP\":%d}", water_meter_op);
-
-        status = strlen(pPublishPayload);
-
-        taskENTER_CRITICAL();
-        configPRINT_STRING(("\r\npayload:%s\r\n", pPublishPayload));
-        taskEXIT_CRITICAL();
-
-#if 0
-        /* Generate the payload for the PUBLISH. */
-        status = snprintf( pPublishPayload,
-                           PUBLISH_PAYLOAD_BUFFER_LENGTH,
-                           PUBLISH_PAYLOAD_FORMAT,
-                           ( int ) publishCount );
-#endif
+        lastRound = meterSnapshot.ulRound;
+        firstUnpublished = 0;
 
-        /* Check for errors from snprintf. */
-        if( status < 0 )
+        for( station = 0;
+             ( station < meterSnapshot.ucStationCount ) && ( publishCount < PUBLISH_MESSAGE_COUNT );
+             station++ )
         {
-            IotLogError( "Failed to generate MQTT PUBLISH payload for PUBLISH %d.",
-                         ( int ) publishCount );
-            status = EXIT_FAILURE;
+            pStation = &meterSnapshot.xStations[ station ];
 
-            break;
+            /* Only readings taken in this round are published. */
+            if( ( pStation->ucStatus != METER_POLL_OK ) ||
+                ( pStation->ulRound != meterSnapshot.ulRound ) )
+            {
+                continue;
+            }
+
+            /* Announce which burst of messages is being published. */
+            if( publishCount % IOT_DEMO_MQTT_PUBLISH_BURST_SIZE == 0 )
+            {
+                IotLogInfo( "Publishing messages %d to %d.",
+                            publishCount,
+                            publishCount + IOT_DEMO_MQTT_PUBLISH_BURST_SIZE - 1 );
+            }
+
+            /* The slot of this message was used one burst ago; its PUBACK
+             * normally arrived with the echo that ended that burst. */
+            pPublished = &pPublishedReadings[ publishCount % IOT_DEMO_MQTT_PUBLISH_BURST_SIZE ];
+
+            for( waitMs = 0;
+                 ( pPublished->pending == true ) && ( waitMs < MQTT_TIMEOUT_MS );
+                 waitMs += METER_ROUND_CHECK_MS )
+            {
+                IotClock_SleepMs( METER_ROUND_CHECK_MS );
+            }
+
+            if( pPublished->pending == true )
+            {
+                IotLogError( "PUBLISH %d is still waiting for its PUBACK.",
+                             ( int ) pPublished->publishCount );
+                status = EXIT_FAILURE;
+
+                break;
+            }
+
+            pPublished->reading = pStation->xReading;
+            pPublished->timestamp = _readingTimestamp( pStation );
+            pPublished->publishCount = publishCount;
+            pPublished->pending = true;
+
+            /* Pass the reading to the operation complete callback. */
+            publishComplete.pCallbackContext = pPublished;
+
+            /* Choose a topic name (round-robin through the array of topic names). */
+            publishInfo.pTopicName = pTopicNames[ publishCount % TOPIC_FILTER_COUNT ];
+
+            traceStart = PathTrace_Begin();
+
+            /* Generate the payload for the PUBLISH. */
+            status = ( int ) MeterRecord_Encode( IOT_DEMO_MQTT_METER_RECORD_FORMAT,
+                                                 &pPublished->reading,
+                                                 pPublished->timestamp,
+                                                 pPublishPayload,
+                                                 sizeof( pPublishPayload ) );
+            PathTrace_End( PATH_TRACE_RECORD_ENCODE, traceStart );
+
+            IotLogInfo( "Meter record of station %d, round %lu: %d bytes.",
+                        pStation->ucAddress,
+                        ( unsigned long ) meterSnapshot.ulRound,
+                        status );
+
+            /* Check for errors from the encoder. */
+            if( status <= 0 )
+            {
+                IotLogError( "Failed to generate MQTT PUBLISH payload for PUBLISH %d.",
+                             ( int ) publishCount );
+                pPublished->pending = false;
+                status = EXIT_FAILURE;
+
+                break;
+            }
+            else
+            {
+                publishInfo.payloadLength = ( size_t ) status;
+                status = EXIT_SUCCESS;
+            }
+
+            /* PUBLISH a message. This is an asynchronous function that notifies of
+             * completion through a callback. */
+            publishStatus = IotMqtt_Publish( mqttConnection,
+                                             &publishInfo,
+                                             0,
+                                             &publishComplete,
+                                             NULL );
+
+            if( publishStatus != IOT_MQTT_STATUS_PENDING )
+            {
+                IotLogError( "MQTT PUBLISH %d returned error %s.",
+                             ( int ) publishCount,
+                             IotMqtt_strerror( publishStatus ) );
+                pPublished->pending = false;
+                status = EXIT_FAILURE;
+
+                break;
+            }
+
+            /* From here the operation complete callback owns the reading. */
+            publishCount++;
+            firstUnpublished = ( uint8_t ) ( station + 1U );
+
+            /* If a complete burst of messages has been published, wait for an equal
+             * number of messages to be received. Note that messages may be received
+             * out-of-order, especially if a message was lost and had to be retried. */
+            if( ( publishCount % IOT_DEMO_MQTT_PUBLISH_BURST_SIZE ) == 0 )
+            {
+                status = _waitForPublishes( pPublishReceivedCounter,
+                                            IOT_DEMO_MQTT_PUBLISH_BURST_SIZE );
+
+                if( status == EXIT_FAILURE )
+                {
+                    break;
+                }
+            }
         }
-        else
+
+        /* This round was taken from the snapshot, so the readings not handed
+         * to MQTT after an error or at the end of the budget are journaled
+         * here. Readings in flight are journaled by their completion. */
+        _journalRemainingReadings( firstUnpublished );
+
+        /* Stop publishing if there was an error. */
+        if( status == EXIT_FAILURE )
         {
-            publishInfo.payloadLength = ( size_t ) status;
-            status = EXIT_SUCCESS;
+            break;
         }
+    }
+
+    /* Wait for the messages of the last, incomplete burst. */
+    if( ( status == EXIT_SUCCESS ) &&
+        ( ( publishCount % IOT_DEMO_MQTT_PUBLISH_BURST_SIZE ) != 0 ) )
+    {
+        status = _waitForPublishes( pPublishReceivedCounter,
+                                    publishCount % IOT_DEMO_MQTT_PUBLISH_BURST_SIZE );
+    }
 
-        /* PUBLISH a message. This is an asynchronous function that notifies of
-         * completion through a callback. */
-        publishStatus = IotMqtt_Publish( mqttConnection,
-                                         &publishInfo,
-                                         0,
-                                         &publishComplete,
-                                         NULL );
+    return status;
+}
 
-        if( publishStatus != IOT_MQTT_STATUS_PENDING )
-        {
-            IotLogError( "MQTT PUBLISH %d returned error %s.",
-                         ( int ) publishCount,
-                         IotMqtt_strerror( publishStatus ) );
-            status = EXIT_FAILURE;
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send the readings waiting in the meter journal.
+ *
+ * Readings are published in batches at QoS 1 and only consumed from the
+ * journal once the server acknowledged the batch, so a reading may be
+ * received twice but never lost.
+ *
+ * @param[in] mqttConnection The MQTT connection to use for publishing.
+ *
+ * @return `EXIT_SUCCESS` if the journal was drained; `EXIT_FAILURE` otherwise.
+ */
+static int _drainMeterJournal( IotMqttConnection_t mqttConnection )
+{
+    int status = EXIT_SUCCESS;
+    size_t entryCount = 0, i = 0;
+    IotMqttError_t publishStatus = IOT_MQTT_STATUS_PENDING;
+    IotMqttPublishInfo_t publishInfo = IOT_MQTT_PUBLISH_INFO_INITIALIZER;
+    MeterRecordBatch_t batch;
+
+    publishInfo.qos = IOT_MQTT_QOS_1;
+    publishInfo.pTopicName = JOURNAL_TOPIC_NAME;
+    publishInfo.topicNameLength = JOURNAL_TOPIC_NAME_LENGTH;
+    publishInfo.pPayload = pJournalPayload;
+    publishInfo.retryMs = PUBLISH_RETRY_MS;
+    publishInfo.retryLimit = PUBLISH_RETRY_LIMIT;
+
+    for( ; ; )
+    {
+        entryCount = WaterMeter_JournalPeek( pJournalEntries, IOT_DEMO_MQTT_JOURNAL_BATCH_SIZE );
 
+        if( entryCount == 0 )
+        {
             break;
         }
 
-        /* If a complete burst of messages has been published, wait for an equal
-         * number of messages to be received. Note that messages may be received
-         * out-of-order, especially if a message was lost and had to be retried. */
-        if( ( publishCount % IOT_DEMO_MQTT_PUBLISH_BURST_SIZE ) ==
-            ( IOT_DEMO_MQTT_PUBLISH_BURST_SIZE - 1 ) )
-        {
-            IotLogInfo( "Waiting for %d publishes to be received.",
-                        IOT_DEMO_MQTT_PUBLISH_BURST_SIZE );
+        ( void ) MeterRecord_BatchInit( &batch,
+                                        IOT_DEMO_MQTT_METER_RECORD_FORMAT,
+                                        pJournalPayload,
+                                        sizeof( pJournalPayload ) );
 
-            for( i = 0; i < IOT_DEMO_MQTT_PUBLISH_BURST_SIZE; i++ )
+        for( i = 0; i < entryCount; i++ )
+        {
+            if( MeterRecord_BatchAppend( &batch,
+                                         &pJournalEntries[ i ].xReading,
+                                         pJournalEntries[ i ].ulTimestamp ) == false )
             {
-                if( IotSemaphore_TimedWait( pPublishReceivedCounter,
-                                            MQTT_TIMEOUT_MS ) == false )
-                {
-                    IotLogError( "Timed out waiting for incoming PUBLISH messages." );
-                    status = EXIT_FAILURE;
-                    break;
-                }
+                break;
             }
+        }
+
+        /* The buffer is sized for a full batch of the largest records. */
+        if( i != entryCount )
+        {
+            IotLogError( "Failed to encode journal reading %lu.",
+                         ( unsigned long ) pJournalEntries[ i ].ulSequence );
+            status = EXIT_FAILURE;
 
-            IotLogInfo( "%d publishes received.",
-                        i );
+            break;
         }
 
-        /* Stop publishing if there was an error. */
-        if( status == EXIT_FAILURE )
+        publishInfo.payloadLength = MeterRecord_BatchFinish( &batch );
+
+        publishStatus = IotMqtt_TimedPublish( mqttConnection,
+                                              &publishInfo,
+                                              0,
+                                              MQTT_TIMEOUT_MS );
+
+        if( publishStatus != IOT_MQTT_SUCCESS )
         {
+            IotLogError( "Journal PUBLISH failed with %s, %d readings kept.",
+                         IotMqtt_strerror( publishStatus ),
+                         ( int ) entryCount );
+            status = EXIT_FAILURE;
+
             break;
         }
+
+        IotLogInfo( "Journal readings %lu to %lu sent in %d bytes.",
+                    ( unsigned long ) pJournalEntries[ 0 ].ulSequence,
+                    ( unsigned long ) pJournalEntries[ entryCount - 1 ].ulSequence,
+                    ( int ) publishInfo.payloadLength );
+
+        WaterMeter_JournalConsume( pJournalEntries[ entryCount - 1 ].ulSequence );
     }
 
     return status;
@@ -919,6 +1223,12 @@ int RunMqttDemo( bool awsIotMqttMode,
                                        &publishesReceived );
     }
 
+    if( status == EXIT_SUCCESS )
+    {
+        /* Send the readings stored while the connection was down. */
+        status = _drainMeterJournal( mqttConnection );
+    }
+
     if( status == EXIT_SUCCESS )
     {
         /* Create the semaphore to count incoming PUBLISH messages. */
@@ -1597,7 +1597,7 @@
  *
  * Comment this macro to disable support for SSL session tickets
  */
-//#define MBEDTLS_SSL_SESSION_TICKETS
+#define MBEDTLS_SSL_SESSION_TICKETS
 
 /**
  * \def MBEDTLS_SSL_EXPORT_KEYS
@@ -3199,6 +3199,26 @@
  */
 //#define MBEDTLS_SSL_OUT_CONTENT_LEN             16384
 
+/*
+ * Memory profile of devices running several TLS connections out of a few
+ * tens of KB of heap, opt-in with CONFIG_MBEDTLS_SMALL_RECORD_BUFFERS. The
+ * record buffers of a connection take about 6.8 KB instead of 17 KB:
+ * - the input buffer holds the records of the server up to 4 KB, including
+ *   the handshake message carrying its certificate chain; a server sending
+ *   larger records must be asked for a maximum fragment length, at most the
+ *   2 KB of the output buffer, see tlsMAX_FRAGMENT_LENGTH;
+ * - the output buffer holds the ClientHello, the client certificate chain
+ *   and the application data records, larger writes are split.
+ */
+#ifdef CONFIG_MBEDTLS_SMALL_RECORD_BUFFERS
+    #ifndef MBEDTLS_SSL_IN_CONTENT_LEN
+        #define MBEDTLS_SSL_IN_CONTENT_LEN     4096
+    #endif
+    #ifndef MBEDTLS_SSL_OUT_CONTENT_LEN
+        #define MBEDTLS_SSL_OUT_CONTENT_LEN    2048
+    #endif
+#endif
+
 /** \def MBEDTLS_SSL_DTLS_MAX_BUFFERING
  *
  * Maximum number of heap-allocated bytes for the purpose of
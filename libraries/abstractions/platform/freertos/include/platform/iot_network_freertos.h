@@ -159,6 +159,14 @@ size_t IotNetworkAfr_ReceiveUpto( void * pConnection,
                                   uint8_t * pBuffer,
                                   size_t bufferSize );
 
+/**
+ * @brief An implementation of #IotNetworkInterface_t::peek for FreeRTOS
+ * Secure Sockets.
+ */
+size_t IotNetworkAfr_Peek( void * pConnection,
+                           const uint8_t ** pBuffer,
+                           size_t bytesRequested );
+
 /**
  * @brief An implementation of #IotNetworkInterface_t::close for FreeRTOS
  * Secure Sockets.
@@ -65,6 +65,13 @@
     #define IOT_NETWORK_SOCKET_POLL_MS    ( 1000 )
 #endif
 
+/* Provide a default size for the receive buffer of each connection. Reads from
+ * Secure Sockets fill this buffer with as much as one call returns (up to a TLS
+ * record), so that protocol headers do not each cost a Secure Sockets call. */
+#ifndef IOT_NETWORK_RECEIVE_BUFFER_SIZE
+    #define IOT_NETWORK_RECEIVE_BUFFER_SIZE    ( 1024 )
+#endif
+
 /**
  * @brief The event group bit to set when a connection's socket is shut down.
  */
@@ -91,8 +98,9 @@ typedef struct _networkConnection
     TaskHandle_t receiveTask;                    /**< @brief Handle of the receive task, if any. */
     IotNetworkReceiveCallback_t receiveCallback; /**< @brief Network receive callback, if any. */
     void * pReceiveContext;                      /**< @brief The context for the receive callback. */
-    bool bufferedByteValid;                      /**< @brief Used to determine if the buffered byte is valid. */
-    uint8_t bufferedByte;                        /**< @brief A single byte buffered from a receive, since AFR Secure Sockets does not have poll(). */
+    size_t receiveHead;                          /**< @brief Offset of the first unread byte in receiveBuffer. */
+    size_t receiveTail;                          /**< @brief Offset following the last received byte in receiveBuffer. */
+    uint8_t receiveBuffer[ IOT_NETWORK_RECEIVE_BUFFER_SIZE ]; /**< @brief Data read ahead from Secure Sockets, since AFR Secure Sockets does not have poll(). */
 } _networkConnection_t;
 
 /*-----------------------------------------------------------*/
@@ -108,7 +116,8 @@ const IotNetworkInterface_t IotNetworkAfr =
     .receive            = IotNetworkAfr_Receive,
     .receiveUpto        = IotNetworkAfr_ReceiveUpto,
     .close              = IotNetworkAfr_Close,
-    .destroy            = IotNetworkAfr_Destroy
+    .destroy            = IotNetworkAfr_Destroy,
+    .peek               = IotNetworkAfr_Peek
 };
 
 /*-----------------------------------------------------------*/
@@ -134,6 +143,83 @@ static void _destroyConnection( _networkConnection_t * pNetworkConnection )
 
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief Read as much data as Secure Sockets returns in one call into the
+ * receive buffer of a connection.
+ *
+ * Unread data is first moved to the start of the buffer so that it stays
+ * contiguous.
+ *
+ * @param[in] pNetworkConnection The connection to read.
+ *
+ * @return The value returned by SOCKETS_Recv.
+ */
+static int32_t _fillReceiveBuffer( _networkConnection_t * pNetworkConnection )
+{
+    int32_t socketStatus = 0;
+    size_t bufferedLength = pNetworkConnection->receiveTail - pNetworkConnection->receiveHead;
+
+    if( pNetworkConnection->receiveHead > 0 )
+    {
+        ( void ) memmove( pNetworkConnection->receiveBuffer,
+                          pNetworkConnection->receiveBuffer + pNetworkConnection->receiveHead,
+                          bufferedLength );
+        pNetworkConnection->receiveHead = 0;
+        pNetworkConnection->receiveTail = bufferedLength;
+    }
+
+    socketStatus = SOCKETS_Recv( pNetworkConnection->socket,
+                                 pNetworkConnection->receiveBuffer + bufferedLength,
+                                 IOT_NETWORK_RECEIVE_BUFFER_SIZE - bufferedLength,
+                                 0 );
+
+    if( socketStatus > 0 )
+    {
+        pNetworkConnection->receiveTail += ( size_t ) socketStatus;
+    }
+
+    return socketStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Copy data from the receive buffer of a connection.
+ *
+ * @param[in] pNetworkConnection The connection to read.
+ * @param[out] pBuffer Where to copy the data.
+ * @param[in] bufferSize The size of `pBuffer`.
+ *
+ * @return The number of bytes copied.
+ */
+static size_t _copyReceiveBuffer( _networkConnection_t * pNetworkConnection,
+                                  uint8_t * pBuffer,
+                                  size_t bufferSize )
+{
+    size_t bytesCopied = pNetworkConnection->receiveTail - pNetworkConnection->receiveHead;
+
+    if( bytesCopied > bufferSize )
+    {
+        bytesCopied = bufferSize;
+    }
+
+    ( void ) memcpy( pBuffer,
+                     pNetworkConnection->receiveBuffer + pNetworkConnection->receiveHead,
+                     bytesCopied );
+    pNetworkConnection->receiveHead += bytesCopied;
+
+    /* Restart at the beginning of the buffer once it is drained. */
+    if( pNetworkConnection->receiveHead == pNetworkConnection->receiveTail )
+    {
+        pNetworkConnection->receiveHead = 0;
+        pNetworkConnection->receiveTail = 0;
+    }
+
+    return bytesCopied;
+}
+
+/*-----------------------------------------------------------*/
+
 /**
  * @brief Task routine that waits on incoming network data.
  *
@@ -150,23 +236,18 @@ static void _networkReceiveTask( void * pArgument )
 
     while( true )
     {
-        /* No buffered byte should be in the connection. */
-        configASSERT( pNetworkConnection->bufferedByteValid == false );
-
-        /* Block and wait for 1 byte of data. This simulates the behavior of poll().
-         * THIS IS A TEMPORARY WORKAROUND AND DOES NOT PROVIDE THREAD-SAFETY AGAINST
-         * MULTIPLE CALLS OF RECEIVE. */
-        do
+        /* Block and wait for data only when the previous read was fully
+         * consumed. The wait fills the receive buffer, which simulates the
+         * behavior of poll(). THIS IS A TEMPORARY WORKAROUND AND DOES NOT
+         * PROVIDE THREAD-SAFETY AGAINST MULTIPLE CALLS OF RECEIVE. */
+        while( pNetworkConnection->receiveTail == pNetworkConnection->receiveHead )
         {
 			if( xSemaphoreTake( ( QueueHandle_t ) &( pNetworkConnection->socketMutex ),
 								portMAX_DELAY ) != pdTRUE ) {
 				continue;
 			}
 
-            socketStatus = SOCKETS_Recv( pNetworkConnection->socket,
-                                         &( pNetworkConnection->bufferedByte ),
-                                         1,
-                                         0 );
+            socketStatus = _fillReceiveBuffer( pNetworkConnection );
 
             connectionFlags = xEventGroupGetBits( ( EventGroupHandle_t ) &( pNetworkConnection->connectionFlags ) );
 
@@ -178,14 +259,25 @@ static void _networkReceiveTask( void * pArgument )
             xSemaphoreGive( ( QueueHandle_t ) &( pNetworkConnection->socketMutex ) );
 
             /* Check for timeout. Some ports return 0, some return EWOULDBLOCK. */
-        } while( ( socketStatus == 0 ) || ( socketStatus == SOCKETS_EWOULDBLOCK ) );
+            if( ( socketStatus != 0 ) && ( socketStatus != SOCKETS_EWOULDBLOCK ) )
+            {
+                break;
+            }
+        }
 
-        if( socketStatus <= 0 )
+        if( socketStatus < 0 )
         {
             break;
         }
 
-        pNetworkConnection->bufferedByteValid = true;
+        /* Data left over by the previous callback is not delivered once the
+         * connection is closed. */
+        connectionFlags = xEventGroupGetBits( ( EventGroupHandle_t ) &( pNetworkConnection->connectionFlags ) );
+
+        if( ( connectionFlags & _FLAG_SHUTDOWN ) == _FLAG_SHUTDOWN )
+        {
+            break;
+        }
 
         /* Invoke the network callback. */
         pNetworkConnection->receiveCallback( pNetworkConnection,
@@ -529,23 +621,35 @@ size_t IotNetworkAfr_Receive( void * pConnection,
     /* Caller should never request zero bytes. */
     configASSERT( bytesRequested > 0 );
 
-    /* Write the buffered byte. THIS IS A TEMPORARY WORKAROUND AND ASSUMES THIS
+    /* Write the buffered data. THIS IS A TEMPORARY WORKAROUND AND ASSUMES THIS
      * FUNCTION IS ALWAYS CALLED FROM THE RECEIVE CALLBACK. */
-    if( pNetworkConnection->bufferedByteValid == true )
-    {
-        *pBuffer = pNetworkConnection->bufferedByte;
-        bytesReceived = 1;
-        bytesRemaining--;
-        pNetworkConnection->bufferedByteValid = false;
-    }
+    bytesReceived = _copyReceiveBuffer( pNetworkConnection, pBuffer, bytesRequested );
+    bytesRemaining -= bytesReceived;
 
     /* Block and wait for incoming data. */
     while( bytesRemaining > 0 )
     {
-        socketStatus = SOCKETS_Recv( pNetworkConnection->socket,
-                                     pBuffer + bytesReceived,
-                                     bytesRemaining,
-                                     0 );
+        if( bytesRemaining >= IOT_NETWORK_RECEIVE_BUFFER_SIZE )
+        {
+            /* Large reads go straight to the caller's buffer. */
+            socketStatus = SOCKETS_Recv( pNetworkConnection->socket,
+                                         pBuffer + bytesReceived,
+                                         bytesRemaining,
+                                         0 );
+        }
+        else
+        {
+            /* Small reads fill the receive buffer, keeping what follows the
+             * requested data for the next receive. */
+            socketStatus = _fillReceiveBuffer( pNetworkConnection );
+
+            if( socketStatus > 0 )
+            {
+                socketStatus = ( int32_t ) _copyReceiveBuffer( pNetworkConnection,
+                                                               pBuffer + bytesReceived,
+                                                               bytesRemaining );
+            }
+        }
 
         if( socketStatus == SOCKETS_EWOULDBLOCK )
         {
@@ -597,30 +701,36 @@ size_t IotNetworkAfr_ReceiveUpto( void * pConnection,
     /* Caller should never pass a zero-length buffer. */
     configASSERT( bufferSize > 0 );
 
-    /* Write the buffered byte. THIS IS A TEMPORARY WORKAROUND AND ASSUMES THIS
+    /* Write the buffered data. THIS IS A TEMPORARY WORKAROUND AND ASSUMES THIS
      * FUNCTION IS ALWAYS CALLED FROM THE RECEIVE CALLBACK. */
-    if( pNetworkConnection->bufferedByteValid == true )
-    {
-        *pBuffer = pNetworkConnection->bufferedByte;
-        bytesReceived = 1;
-        pNetworkConnection->bufferedByteValid = false;
-    }
+    bytesReceived = _copyReceiveBuffer( pNetworkConnection, pBuffer, bufferSize );
 
-    if( bufferSize - bytesReceived > 0 )
+    if( bytesReceived == 0 )
     {
         /* Block and wait for incoming data. */
-        socketStatus = SOCKETS_Recv( pNetworkConnection->socket,
-                                     pBuffer + bytesReceived,
-                                     bufferSize - bytesReceived,
-                                     0 );
+        if( bufferSize >= IOT_NETWORK_RECEIVE_BUFFER_SIZE )
+        {
+            socketStatus = SOCKETS_Recv( pNetworkConnection->socket,
+                                         pBuffer,
+                                         bufferSize,
+                                         0 );
+        }
+        else
+        {
+            socketStatus = _fillReceiveBuffer( pNetworkConnection );
+        }
 
         if( socketStatus <= 0 )
         {
             IotLogError( "Error %ld while receiving data.", ( long int ) socketStatus );
         }
+        else if( bufferSize >= IOT_NETWORK_RECEIVE_BUFFER_SIZE )
+        {
+            bytesReceived = ( size_t ) socketStatus;
+        }
         else
         {
-            bytesReceived += ( size_t ) socketStatus;
+            bytesReceived = _copyReceiveBuffer( pNetworkConnection, pBuffer, bufferSize );
         }
     }
 
@@ -632,6 +742,51 @@ size_t IotNetworkAfr_ReceiveUpto( void * pConnection,
 
 /*-----------------------------------------------------------*/
 
+size_t IotNetworkAfr_Peek( void * pConnection,
+                           const uint8_t ** pBuffer,
+                           size_t bytesRequested )
+{
+    int32_t socketStatus = 0;
+    size_t bytesAvailable = 0;
+
+    /* Cast network connection to the correct type. */
+    _networkConnection_t * pNetworkConnection = ( _networkConnection_t * ) pConnection;
+
+    /* The peeked data must fit in the receive buffer. */
+    configASSERT( bytesRequested <= IOT_NETWORK_RECEIVE_BUFFER_SIZE );
+
+    bytesAvailable = pNetworkConnection->receiveTail - pNetworkConnection->receiveHead;
+
+    /* Block and wait for incoming data. THIS ASSUMES THIS FUNCTION IS ALWAYS
+     * CALLED FROM THE RECEIVE CALLBACK. */
+    while( bytesAvailable < bytesRequested )
+    {
+        socketStatus = _fillReceiveBuffer( pNetworkConnection );
+
+        if( socketStatus == SOCKETS_EWOULDBLOCK )
+        {
+            /* No data was received within the socket timeout. Ignore it and
+             * try again. */
+            continue;
+        }
+        else if( socketStatus < 0 )
+        {
+            IotLogError( "Error %ld while receiving data.", ( long int ) socketStatus );
+            break;
+        }
+        else
+        {
+            bytesAvailable = pNetworkConnection->receiveTail - pNetworkConnection->receiveHead;
+        }
+    }
+
+    *pBuffer = pNetworkConnection->receiveBuffer + pNetworkConnection->receiveHead;
+
+    return bytesAvailable;
+}
+
+/*-----------------------------------------------------------*/
+
 IotNetworkError_t IotNetworkAfr_Close( void * pConnection )
 {
     int32_t socketStatus = SOCKETS_ERROR_NONE;
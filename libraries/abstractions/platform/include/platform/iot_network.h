@@ -281,6 +281,36 @@ typedef struct IotNetworkInterface
     /* @[declare_platform_network_destroy] */
     IotNetworkError_t ( * destroy )( void * pConnection );
     /* @[declare_platform_network_destroy] */
+
+    /**
+     * @brief Look at incoming network data without consuming it.
+     *
+     * Blocks until at least `bytesRequested` bytes are buffered on the
+     * connection, then points `*pBuffer` at the first unread byte. The data
+     * stays available to the next @ref platform_network_function_receive.
+     * This allows a protocol to parse a header in place instead of reading
+     * it one byte at a time.
+     *
+     * This function is optional and may be `NULL` for network stacks that
+     * do not buffer incoming data.
+     *
+     * @param[in] pConnection The connection to look at, defined by the network
+     * stack.
+     * @param[out] pBuffer Set to the first unread byte of the connection.
+     * @param[in] bytesRequested How many bytes to wait for.
+     *
+     * @return The number of contiguous bytes available at `*pBuffer`. This is
+     * at least `bytesRequested` when successful; a smaller value indicates an
+     * error or a closed connection.
+     *
+     * @attention This function may only be called from a
+     * [receive callback](@ref platform_network_function_receivecallback).
+     */
+    /* @[declare_platform_network_peek] */
+    size_t ( * peek )( void * pConnection,
+                       const uint8_t ** pBuffer,
+                       size_t bytesRequested );
+    /* @[declare_platform_network_peek] */
 } IotNetworkInterface_t;
 
 /**
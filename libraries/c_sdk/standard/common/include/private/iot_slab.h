@@ -0,0 +1,136 @@
+/*
+ * FreeRTOS Common V1.1.1
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file iot_slab.h
+ * @brief Size-class slab allocator for the objects of the MQTT, task pool and
+ * serializer libraries. Only used when @ref IOT_SLAB_ALLOCATOR is `1`.
+ *
+ * The pool is split at initialization into classes of fixed-size blocks, set
+ * by @ref IOT_SLAB_BLOCK_SIZES and @ref IOT_SLAB_BLOCK_COUNTS. Each class keeps
+ * its free blocks in a list threaded through the blocks themselves, so an
+ * allocation or a free takes one block off or puts one block back without
+ * searching. A request is served by the smallest class that has a free block
+ * large enough; blocks never split or merge, so the pool cannot fragment.
+ *
+ * When `IotSlab_FallbackMalloc` and `IotSlab_FallbackFree` are defined, the
+ * requests the pool cannot serve go to them, and @ref IotSlab_Free hands them
+ * back every pointer outside the pool.
+ */
+
+/* The config header is always included first. */
+#include "iot_config.h"
+
+/* The functions in this file should only exist when the slab allocator is
+ * enabled, hence the check for IOT_SLAB_ALLOCATOR in the double inclusion guard. */
+#if !defined( IOT_SLAB_H_ ) && ( IOT_SLAB_ALLOCATOR == 1 )
+    #define IOT_SLAB_H_
+
+/* Standard includes. */
+    #include <stdbool.h>
+    #include <stddef.h>
+    #include <stdint.h>
+
+/**
+ * @brief Usage of one size class.
+ */
+    typedef struct IotSlabStats
+    {
+        size_t blockSize;     /**< @brief Size of the blocks of the class. */
+        uint32_t blocks;      /**< @brief Number of blocks of the class. */
+        uint32_t inUse;       /**< @brief Blocks currently allocated. */
+        uint32_t highWater;   /**< @brief Largest number of blocks allocated at the same time. */
+        uint32_t allocations; /**< @brief Blocks allocated since initialization. */
+        uint32_t failures;    /**< @brief Requests that found no free block in this class or a larger one. Requests larger than every class count in the last class. */
+    } IotSlabStats_t;
+
+/**
+ * @brief Split the pool into its size classes.
+ *
+ * <b>It must be called once (and only once) before calling any other slab
+ * function.</b>
+ *
+ * @return `true` if initialization succeeded; `false` if the size classes are
+ * not in increasing order or do not fit in @ref IOT_SLAB_POOL_SIZE.
+ *
+ * @attention This function is called by `IotSdk_Init` and does not need to be
+ * called by itself.
+ *
+ * @warning No thread-safety guarantees are provided for this function.
+ */
+    bool IotSlab_Init( void );
+
+/**
+ * @brief Free the resources taken by @ref IotSlab_Init.
+ *
+ * @attention This function is called by `IotSdk_Cleanup` and does not need
+ * to be called by itself.
+ *
+ * @warning No thread-safety guarantees are provided for this function.
+ */
+    void IotSlab_Cleanup( void );
+
+/**
+ * @brief Allocate a block of the smallest class that fits.
+ *
+ * This function has the same signature as [malloc]
+ * (http://pubs.opengroup.org/onlinepubs/9699919799/functions/malloc.html).
+ *
+ * @param[in] size Requested size.
+ *
+ * @return Pointer to a block of at least `size` bytes, aligned for any object;
+ * `NULL` if no class can serve the request and there is no fallback allocator.
+ */
+    void * IotSlab_Malloc( size_t size );
+
+/**
+ * @brief Free a block returned by @ref IotSlab_Malloc.
+ *
+ * This function has the same signature as [free]
+ * (http://pubs.opengroup.org/onlinepubs/9699919799/functions/free.html).
+ *
+ * @param[in] ptr Pointer to the block to free, or `NULL`.
+ */
+    void IotSlab_Free( void * ptr );
+
+/**
+ * @brief Get the number of size classes.
+ *
+ * @return Number of entries of @ref IOT_SLAB_BLOCK_SIZES.
+ */
+    uint32_t IotSlab_ClassCount( void );
+
+/**
+ * @brief Get the usage of a size class.
+ *
+ * @param[in] classIndex Size class, in increasing block size from 0.
+ * @param[out] pStats Usage of the class.
+ *
+ * @return `false` if `classIndex` is out of range.
+ */
+    bool IotSlab_GetStats( uint32_t classIndex,
+                           IotSlabStats_t * pStats );
+
+#endif /* if !defined( IOT_SLAB_H_ ) && ( IOT_SLAB_ALLOCATOR == 1 ) */
@@ -43,6 +43,9 @@
 /* Static memory include (if dynamic memory allocation is disabled). */
 #include "private/iot_static_memory.h"
 
+/* Slab allocator include (if enabled). */
+#include "private/iot_slab.h"
+
 /* Error handling include. */
 #include "private/iot_error.h"
 
@@ -74,6 +77,10 @@ bool IotSdk_Init( void )
     IotTaskPoolError_t taskPoolStatus = IOT_TASKPOOL_SUCCESS;
     IotTaskPoolInfo_t taskPoolInfo = IOT_TASKPOOL_INFO_INITIALIZER_LARGE;
 
+    #if IOT_SLAB_ALLOCATOR == 1
+        bool slabInitialized = false;
+    #endif
+
     /* Initialize the mutex for generic atomic operations if needed. */
     #if IOT_ATOMIC_GENERIC == 1
         bool genericAtomicInitialized = IotMutex_Create( &IotAtomicMutex, false );
@@ -96,6 +103,17 @@ bool IotSdk_Init( void )
         }
     #endif
 
+    /* Split the slab allocator pool before the first object is allocated. */
+    #if IOT_SLAB_ALLOCATOR == 1
+        slabInitialized = IotSlab_Init();
+
+        if( slabInitialized == false )
+        {
+            IotLogError( "Failed to initialize slab allocator." );
+            IOT_SET_AND_GOTO_CLEANUP( false );
+        }
+    #endif
+
     /* Create system task pool. */
     taskPoolStatus = IotTaskPool_CreateSystemTaskPool( &taskPoolInfo );
 
@@ -121,6 +139,12 @@ bool IotSdk_Init( void )
                 IotStaticMemory_Cleanup();
             }
         #endif
+        #if IOT_SLAB_ALLOCATOR == 1
+            if( slabInitialized == true )
+            {
+                IotSlab_Cleanup();
+            }
+        #endif
     }
     else
     {
@@ -145,6 +169,11 @@ void IotSdk_Cleanup( void )
         IotStaticMemory_Cleanup();
     #endif
 
+    /* Cleanup the slab allocator if enabled. */
+    #if IOT_SLAB_ALLOCATOR == 1
+        IotSlab_Cleanup();
+    #endif
+
     /* Clean up the mutex for generic atomic operations if needed. */
     #if IOT_ATOMIC_GENERIC == 1
         IotMutex_Destroy( &IotAtomicMutex );
@@ -0,0 +1,329 @@
+/*
+ * FreeRTOS Common V1.1.1
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file iot_slab.c
+ * @brief Implementation of the slab allocator in iot_slab.h
+ */
+
+/* The config header is always included first. */
+#include "iot_config.h"
+
+/* This file should only be compiled if the slab allocator is enabled. */
+#if IOT_SLAB_ALLOCATOR == 1
+
+/* Standard includes. */
+    #include <stdbool.h>
+    #include <stddef.h>
+    #include <stdint.h>
+    #include <string.h>
+
+/* Platform layer includes. */
+    #include "platform/iot_threads.h"
+
+/* Slab allocator include. */
+    #include "private/iot_slab.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @cond DOXYGEN_IGNORE
+ * Doxygen should ignore this section.
+ *
+ * Provide default values for undefined configuration constants.
+ */
+    #ifndef IOT_SLAB_BLOCK_SIZES
+        #define IOT_SLAB_BLOCK_SIZES     { 32, 64, 128, 256, 512, 1024 }
+    #endif
+    #ifndef IOT_SLAB_BLOCK_COUNTS
+        #define IOT_SLAB_BLOCK_COUNTS    { 16, 16, 16, 8, 4, 4 }
+    #endif
+    #ifndef IOT_SLAB_POOL_SIZE
+        #define IOT_SLAB_POOL_SIZE       ( 11776 )
+    #endif
+/** @endcond */
+
+/* Validate slab allocator configuration settings. */
+    #if IOT_SLAB_POOL_SIZE <= 0
+        #error "IOT_SLAB_POOL_SIZE cannot be 0 or negative."
+    #endif
+
+/**
+ * @brief Alignment of the blocks, the largest alignment of a scalar type on
+ * the supported targets.
+ */
+    #define SLAB_ALIGNMENT    ( sizeof( uint64_t ) )
+
+/**
+ * @brief Number of size classes.
+ */
+    #define SLAB_CLASSES      ( sizeof( _blockSizes ) / sizeof( _blockSizes[ 0 ] ) )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief A free block, linked to the next free block of its class.
+ */
+    typedef struct _slabBlock
+    {
+        struct _slabBlock * pNext; /**< @brief Next free block, `NULL` at the end of the list. */
+    } _slabBlock_t;
+
+/**
+ * @brief A size class: a run of blocks of the pool and its free list.
+ */
+    typedef struct _slabClass
+    {
+        uint8_t * pStart;         /**< @brief First block of the class. */
+        uint8_t * pEnd;           /**< @brief End of the last block of the class. */
+        _slabBlock_t * pFreeList; /**< @brief Free blocks, the most recently freed first. */
+        IotSlabStats_t stats;     /**< @brief Usage of the class. */
+    } _slabClass_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Block size of each class, in increasing order.
+ */
+    static const size_t _blockSizes[] = IOT_SLAB_BLOCK_SIZES;
+
+/**
+ * @brief Number of blocks of each class.
+ */
+    static const uint32_t _blockCounts[] = IOT_SLAB_BLOCK_COUNTS;
+
+/**
+ * @brief Guards the free lists and the statistics.
+ */
+    static IotMutex_t _mutex;
+
+/**
+ * @brief The size classes.
+ */
+    static _slabClass_t _classes[ SLAB_CLASSES ];
+
+/**
+ * @brief Storage of all the blocks, allocated at compile-time.
+ */
+    static uint64_t _pool[ ( IOT_SLAB_POOL_SIZE + SLAB_ALIGNMENT - 1 ) / SLAB_ALIGNMENT ];
+
+/*-----------------------------------------------------------*/
+
+    bool IotSlab_Init( void )
+    {
+        bool status = true;
+        uint8_t * pNext = ( uint8_t * ) _pool;
+        uint8_t * pPoolEnd = ( uint8_t * ) _pool + sizeof( _pool );
+        _slabBlock_t ** pLink = NULL;
+        size_t blockSize = 0;
+        uint32_t i = 0, j = 0;
+
+        ( void ) memset( _classes, 0x00, sizeof( _classes ) );
+
+        /* Both lists must describe the same classes, in increasing block size. */
+        if( ( sizeof( _blockCounts ) / sizeof( _blockCounts[ 0 ] ) ) != SLAB_CLASSES )
+        {
+            status = false;
+        }
+
+        for( i = 0; ( status == true ) && ( i < SLAB_CLASSES ); i++ )
+        {
+            /* Round the block size up so that every block stays aligned and
+             * can hold the free list link. */
+            blockSize = ( _blockSizes[ i ] + SLAB_ALIGNMENT - 1U ) & ~( SLAB_ALIGNMENT - 1U );
+
+            if( ( blockSize == 0U ) ||
+                ( ( i > 0U ) && ( _blockSizes[ i ] <= _blockSizes[ i - 1U ] ) ) ||
+                ( ( size_t ) ( pPoolEnd - pNext ) / blockSize < _blockCounts[ i ] ) )
+            {
+                status = false;
+                break;
+            }
+
+            _classes[ i ].pStart = pNext;
+            _classes[ i ].stats.blockSize = blockSize;
+            _classes[ i ].stats.blocks = _blockCounts[ i ];
+
+            /* Chain the blocks in address order. */
+            pLink = &( _classes[ i ].pFreeList );
+
+            for( j = 0; j < _blockCounts[ i ]; j++ )
+            {
+                *pLink = ( _slabBlock_t * ) pNext;
+                pLink = &( ( *pLink )->pNext );
+                pNext += blockSize;
+            }
+
+            *pLink = NULL;
+            _classes[ i ].pEnd = pNext;
+        }
+
+        if( status == true )
+        {
+            status = IotMutex_Create( &( _mutex ), false );
+        }
+
+        return status;
+    }
+
+/*-----------------------------------------------------------*/
+
+    void IotSlab_Cleanup( void )
+    {
+        IotMutex_Destroy( &( _mutex ) );
+    }
+
+/*-----------------------------------------------------------*/
+
+    void * IotSlab_Malloc( size_t size )
+    {
+        _slabBlock_t * pBlock = NULL;
+        _slabClass_t * pClass = NULL;
+        uint32_t i = 0;
+
+        /* Find the smallest class that fits, then the first one above it with
+         * a free block. */
+        while( ( i < SLAB_CLASSES ) && ( size > _classes[ i ].stats.blockSize ) )
+        {
+            i++;
+        }
+
+        IotMutex_Lock( &( _mutex ) );
+
+        if( i == SLAB_CLASSES )
+        {
+            /* Larger than every class. */
+            _classes[ SLAB_CLASSES - 1U ].stats.failures++;
+        }
+        else
+        {
+            pClass = &( _classes[ i ] );
+
+            while( ( i < SLAB_CLASSES ) && ( _classes[ i ].pFreeList == NULL ) )
+            {
+                i++;
+            }
+
+            if( i == SLAB_CLASSES )
+            {
+                pClass->stats.failures++;
+            }
+            else
+            {
+                pClass = &( _classes[ i ] );
+                pBlock = pClass->pFreeList;
+                pClass->pFreeList = pBlock->pNext;
+
+                pClass->stats.inUse++;
+                pClass->stats.allocations++;
+
+                if( pClass->stats.inUse > pClass->stats.highWater )
+                {
+                    pClass->stats.highWater = pClass->stats.inUse;
+                }
+            }
+        }
+
+        IotMutex_Unlock( &( _mutex ) );
+
+        #ifdef IotSlab_FallbackMalloc
+            if( pBlock == NULL )
+            {
+                return IotSlab_FallbackMalloc( size );
+            }
+        #endif
+
+        return pBlock;
+    }
+
+/*-----------------------------------------------------------*/
+
+    void IotSlab_Free( void * ptr )
+    {
+        uintptr_t address = ( uintptr_t ) ptr;
+        _slabClass_t * pClass = NULL;
+        uint32_t i = 0;
+
+        /* The class bounds do not change after initialization, so the class of
+         * the block is found outside of the critical section. */
+        if( ( address >= ( uintptr_t ) _classes[ 0 ].pStart ) &&
+            ( address < ( uintptr_t ) _classes[ SLAB_CLASSES - 1U ].pEnd ) )
+        {
+            while( address >= ( uintptr_t ) _classes[ i ].pEnd )
+            {
+                i++;
+            }
+
+            pClass = &( _classes[ i ] );
+        }
+
+        if( pClass != NULL )
+        {
+            IotMutex_Lock( &( _mutex ) );
+
+            ( ( _slabBlock_t * ) ptr )->pNext = pClass->pFreeList;
+            pClass->pFreeList = ( _slabBlock_t * ) ptr;
+            pClass->stats.inUse--;
+
+            IotMutex_Unlock( &( _mutex ) );
+        }
+        else
+        {
+            /* Not a block of the pool: NULL or a fallback allocation. */
+            #ifdef IotSlab_FallbackFree
+                IotSlab_FallbackFree( ptr );
+            #endif
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    uint32_t IotSlab_ClassCount( void )
+    {
+        return ( uint32_t ) SLAB_CLASSES;
+    }
+
+/*-----------------------------------------------------------*/
+
+    bool IotSlab_GetStats( uint32_t classIndex,
+                           IotSlabStats_t * pStats )
+    {
+        bool status = false;
+
+        if( classIndex < SLAB_CLASSES )
+        {
+            IotMutex_Lock( &( _mutex ) );
+            *pStats = _classes[ classIndex ].stats;
+            IotMutex_Unlock( &( _mutex ) );
+
+            status = true;
+        }
+
+        return status;
+    }
+
+/*-----------------------------------------------------------*/
+
+#endif /* if IOT_SLAB_ALLOCATOR == 1 */
@@ -46,6 +46,9 @@
 /* Static memory include. */
     #include "private/iot_static_memory.h"
 
+/* Slab allocator include. */
+    #include "private/iot_slab.h"
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -80,8 +83,10 @@
 /*
  * Static memory buffers and flags, allocated and zeroed at compile-time.
  */
-    static bool _pInUseMessageBuffers[ IOT_MESSAGE_BUFFERS ] = { 0 };                           /**< @brief Message buffer in-use flags. */
-    static char _pMessageBuffers[ IOT_MESSAGE_BUFFERS ][ IOT_MESSAGE_BUFFER_SIZE ] = { { 0 } }; /**< @brief Message buffers. */
+    #if IOT_SLAB_ALLOCATOR == 0
+        static bool _pInUseMessageBuffers[ IOT_MESSAGE_BUFFERS ] = { 0 };                           /**< @brief Message buffer in-use flags. */
+        static char _pMessageBuffers[ IOT_MESSAGE_BUFFERS ][ IOT_MESSAGE_BUFFER_SIZE ] = { { 0 } }; /**< @brief Message buffers. */
+    #endif
 
 /*-----------------------------------------------------------*/
 
@@ -172,20 +177,26 @@
 
     void * Iot_MallocMessageBuffer( size_t size )
     {
-        int32_t freeIndex = -1;
+        #if IOT_SLAB_ALLOCATOR == 0
+            int32_t freeIndex = -1;
+        #endif
         void * pNewBuffer = NULL;
 
         /* Check that size is within the fixed message buffer size. */
         if( size <= IOT_MESSAGE_BUFFER_SIZE )
         {
-            /* Get the index of a free message buffer. */
-            freeIndex = IotStaticMemory_FindFree( _pInUseMessageBuffers,
-                                                  IOT_MESSAGE_BUFFERS );
-
-            if( freeIndex != -1 )
-            {
-                pNewBuffer = &( _pMessageBuffers[ freeIndex ][ 0 ] );
-            }
+            #if IOT_SLAB_ALLOCATOR == 1
+                pNewBuffer = IotSlab_Malloc( size );
+            #else
+                /* Get the index of a free message buffer. */
+                freeIndex = IotStaticMemory_FindFree( _pInUseMessageBuffers,
+                                                      IOT_MESSAGE_BUFFERS );
+
+                if( freeIndex != -1 )
+                {
+                    pNewBuffer = &( _pMessageBuffers[ freeIndex ][ 0 ] );
+                }
+            #endif
         }
 
         return pNewBuffer;
@@ -195,12 +206,16 @@
 
     void Iot_FreeMessageBuffer( void * ptr )
     {
-        /* Return the in-use message buffer. */
-        IotStaticMemory_ReturnInUse( ptr,
-                                     _pMessageBuffers,
-                                     _pInUseMessageBuffers,
-                                     IOT_MESSAGE_BUFFERS,
-                                     IOT_MESSAGE_BUFFER_SIZE );
+        #if IOT_SLAB_ALLOCATOR == 1
+            IotSlab_Free( ptr );
+        #else
+            /* Return the in-use message buffer. */
+            IotStaticMemory_ReturnInUse( ptr,
+                                         _pMessageBuffers,
+                                         _pInUseMessageBuffers,
+                                         IOT_MESSAGE_BUFFERS,
+                                         IOT_MESSAGE_BUFFER_SIZE );
+        #endif
     }
 
 /*-----------------------------------------------------------*/
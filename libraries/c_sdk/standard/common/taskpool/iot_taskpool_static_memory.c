@@ -42,6 +42,9 @@
 /* Static memory include. */
     #include "private/iot_static_memory.h"
 
+/* Slab allocator include. */
+    #include "private/iot_slab.h"
+
 /* Task pool internal include. */
     #include "private/iot_taskpool_internal.h"
 
@@ -57,32 +60,40 @@
 /*
  * Static memory buffers and flags, allocated and zeroed at compile-time.
  */
-    static bool _pInUseTaskPools[ IOT_TASKPOOLS ] = { 0 };                                                          /**< @brief Task pools in-use flags. */
-    static _taskPool_t _pTaskPools[ IOT_TASKPOOLS ] = { { .dispatchQueue = IOT_DEQUEUE_INITIALIZER } };             /**< @brief Task pools. */
+    #if IOT_SLAB_ALLOCATOR == 0
+        static bool _pInUseTaskPools[ IOT_TASKPOOLS ] = { 0 };                                                          /**< @brief Task pools in-use flags. */
+        static _taskPool_t _pTaskPools[ IOT_TASKPOOLS ] = { { .dispatchQueue = IOT_DEQUEUE_INITIALIZER } };             /**< @brief Task pools. */
 
-    static bool _pInUseTaskPoolJobs[ IOT_TASKPOOL_JOBS_RECYCLE_LIMIT ] = { 0 };                                     /**< @brief Task pool jobs in-use flags. */
-    static _taskPoolJob_t _pTaskPoolJobs[ IOT_TASKPOOL_JOBS_RECYCLE_LIMIT ] = { { .link = IOT_LINK_INITIALIZER } }; /**< @brief Task pool jobs. */
+        static bool _pInUseTaskPoolJobs[ IOT_TASKPOOL_JOBS_RECYCLE_LIMIT ] = { 0 };                                     /**< @brief Task pool jobs in-use flags. */
+        static _taskPoolJob_t _pTaskPoolJobs[ IOT_TASKPOOL_JOBS_RECYCLE_LIMIT ] = { { .link = IOT_LINK_INITIALIZER } }; /**< @brief Task pool jobs. */
 
-    static bool _pInUseTaskPoolTimerEvents[ IOT_TASKPOOL_JOBS_RECYCLE_LIMIT ] = { 0 };                              /**< @brief Task pool timer event in-use flags. */
-    static _taskPoolTimerEvent_t _pTaskPoolTimerEvents[ IOT_TASKPOOL_JOBS_RECYCLE_LIMIT ] = { { .link = { 0 } } };  /**< @brief Task pool timer events. */
+        static bool _pInUseTaskPoolTimerEvents[ IOT_TASKPOOL_JOBS_RECYCLE_LIMIT ] = { 0 };                              /**< @brief Task pool timer event in-use flags. */
+        static _taskPoolTimerEvent_t _pTaskPoolTimerEvents[ IOT_TASKPOOL_JOBS_RECYCLE_LIMIT ] = { { .link = { 0 } } };  /**< @brief Task pool timer events. */
+    #endif
 
 /*-----------------------------------------------------------*/
 
     void * IotTaskPool_MallocTaskPool( size_t size )
     {
-        int freeIndex = -1;
+        #if IOT_SLAB_ALLOCATOR == 0
+            int freeIndex = -1;
+        #endif
         void * pNewTaskPool = NULL;
 
         /* Check size argument. */
         if( size == sizeof( _taskPool_t ) )
         {
-            /* Find a free task pool job. */
-            freeIndex = IotStaticMemory_FindFree( _pInUseTaskPools, IOT_TASKPOOLS );
-
-            if( freeIndex != -1 )
-            {
-                pNewTaskPool = &( _pTaskPools[ freeIndex ] );
-            }
+            #if IOT_SLAB_ALLOCATOR == 1
+                pNewTaskPool = IotSlab_Malloc( size );
+            #else
+                /* Find a free task pool job. */
+                freeIndex = IotStaticMemory_FindFree( _pInUseTaskPools, IOT_TASKPOOLS );
+
+                if( freeIndex != -1 )
+                {
+                    pNewTaskPool = &( _pTaskPools[ freeIndex ] );
+                }
+            #endif
         }
 
         return pNewTaskPool;
@@ -92,32 +103,42 @@
 
     void IotTaskPool_FreeTaskPool( void * ptr )
     {
-        /* Return the in-use task pool job. */
-        IotStaticMemory_ReturnInUse( ptr,
-                                     _pTaskPools,
-                                     _pInUseTaskPools,
-                                     IOT_TASKPOOLS,
-                                     sizeof( _taskPool_t ) );
+        #if IOT_SLAB_ALLOCATOR == 1
+            IotSlab_Free( ptr );
+        #else
+            /* Return the in-use task pool job. */
+            IotStaticMemory_ReturnInUse( ptr,
+                                         _pTaskPools,
+                                         _pInUseTaskPools,
+                                         IOT_TASKPOOLS,
+                                         sizeof( _taskPool_t ) );
+        #endif
     }
 
 /*-----------------------------------------------------------*/
 
     void * IotTaskPool_MallocJob( size_t size )
     {
-        int32_t freeIndex = -1;
+        #if IOT_SLAB_ALLOCATOR == 0
+            int32_t freeIndex = -1;
+        #endif
         void * pNewJob = NULL;
 
         /* Check size argument. */
         if( size == sizeof( _taskPoolJob_t ) )
         {
-            /* Find a free task pool job. */
-            freeIndex = IotStaticMemory_FindFree( _pInUseTaskPoolJobs,
-                                                  IOT_TASKPOOL_JOBS_RECYCLE_LIMIT );
-
-            if( freeIndex != -1 )
-            {
-                pNewJob = &( _pTaskPoolJobs[ freeIndex ] );
-            }
+            #if IOT_SLAB_ALLOCATOR == 1
+                pNewJob = IotSlab_Malloc( size );
+            #else
+                /* Find a free task pool job. */
+                freeIndex = IotStaticMemory_FindFree( _pInUseTaskPoolJobs,
+                                                      IOT_TASKPOOL_JOBS_RECYCLE_LIMIT );
+
+                if( freeIndex != -1 )
+                {
+                    pNewJob = &( _pTaskPoolJobs[ freeIndex ] );
+                }
+            #endif
         }
 
         return pNewJob;
@@ -127,32 +148,42 @@
 
     void IotTaskPool_FreeJob( void * ptr )
     {
-        /* Return the in-use task pool job. */
-        IotStaticMemory_ReturnInUse( ptr,
-                                     _pTaskPoolJobs,
-                                     _pInUseTaskPoolJobs,
-                                     IOT_TASKPOOL_JOBS_RECYCLE_LIMIT,
-                                     sizeof( _taskPoolJob_t ) );
+        #if IOT_SLAB_ALLOCATOR == 1
+            IotSlab_Free( ptr );
+        #else
+            /* Return the in-use task pool job. */
+            IotStaticMemory_ReturnInUse( ptr,
+                                         _pTaskPoolJobs,
+                                         _pInUseTaskPoolJobs,
+                                         IOT_TASKPOOL_JOBS_RECYCLE_LIMIT,
+                                         sizeof( _taskPoolJob_t ) );
+        #endif
     }
 
 /*-----------------------------------------------------------*/
 
     void * IotTaskPool_MallocTimerEvent( size_t size )
     {
-        int32_t freeIndex = -1;
+        #if IOT_SLAB_ALLOCATOR == 0
+            int32_t freeIndex = -1;
+        #endif
         void * pNewTimerEvent = NULL;
 
         /* Check size argument. */
         if( size == sizeof( _taskPoolTimerEvent_t ) )
         {
-            /* Find a free task pool timer event. */
-            freeIndex = IotStaticMemory_FindFree( _pInUseTaskPoolTimerEvents,
-                                                  IOT_TASKPOOL_JOBS_RECYCLE_LIMIT );
-
-            if( freeIndex != -1 )
-            {
-                pNewTimerEvent = &( _pTaskPoolTimerEvents[ freeIndex ] );
-            }
+            #if IOT_SLAB_ALLOCATOR == 1
+                pNewTimerEvent = IotSlab_Malloc( size );
+            #else
+                /* Find a free task pool timer event. */
+                freeIndex = IotStaticMemory_FindFree( _pInUseTaskPoolTimerEvents,
+                                                      IOT_TASKPOOL_JOBS_RECYCLE_LIMIT );
+
+                if( freeIndex != -1 )
+                {
+                    pNewTimerEvent = &( _pTaskPoolTimerEvents[ freeIndex ] );
+                }
+            #endif
         }
 
         return pNewTimerEvent;
@@ -162,12 +193,16 @@
 
     void IotTaskPool_FreeTimerEvent( void * ptr )
     {
-        /* Return the in-use task pool timer event. */
-        IotStaticMemory_ReturnInUse( ptr,
-                                     _pTaskPoolTimerEvents,
-                                     _pInUseTaskPoolTimerEvents,
-                                     IOT_TASKPOOL_JOBS_RECYCLE_LIMIT,
-                                     sizeof( _taskPoolTimerEvent_t ) );
+        #if IOT_SLAB_ALLOCATOR == 1
+            IotSlab_Free( ptr );
+        #else
+            /* Return the in-use task pool timer event. */
+            IotStaticMemory_ReturnInUse( ptr,
+                                         _pTaskPoolTimerEvents,
+                                         _pInUseTaskPoolTimerEvents,
+                                         IOT_TASKPOOL_JOBS_RECYCLE_LIMIT,
+                                         sizeof( _taskPoolTimerEvent_t ) );
+        #endif
     }
 
 /*-----------------------------------------------------------*/
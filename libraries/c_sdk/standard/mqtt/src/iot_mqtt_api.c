@@ -1372,6 +1372,7 @@ void IotMqtt_Disconnect( IotMqttConnection_t mqttConnection,
                              _mqttOperation_tryDestroy,
                              offsetof( _mqttOperation_t, link ) );
 
+    _IotMqtt_ResetPendingTable( mqttConnection );
     IotListDouble_RemoveAll( &( mqttConnection->pendingResponse ),
                              _mqttOperation_tryDestroy,
                              offsetof( _mqttOperation_t, link ) );
@@ -1505,6 +1506,7 @@ IotMqttError_t IotMqtt_Publish( IotMqttConnection_t mqttConnection,
     IOT_FUNCTION_ENTRY( IotMqttError_t, IOT_MQTT_SUCCESS );
     _mqttOperation_t * pOperation = NULL;
     uint8_t ** pPacketIdentifierHigh = NULL;
+    uint32_t traceStart = 0;
 
     /* Default PUBLISH serializer function. */
     IotMqttError_t ( * serializePublish )( const IotMqttPublishInfo_t *,
@@ -1626,11 +1628,13 @@ IotMqttError_t IotMqtt_Publish( IotMqttConnection_t mqttConnection,
     }
 
     /* Generate a PUBLISH packet from pPublishInfo. */
+    traceStart = IotMqtt_TraceBegin();
     status = serializePublish( pPublishInfo,
                                &( pOperation->u.operation.pMqttPacket ),
                                &( pOperation->u.operation.packetSize ),
                                &( pOperation->u.operation.packetIdentifier ),
                                pPacketIdentifierHigh );
+    IotMqtt_TraceEnd( MQTT_SERIALIZE, traceStart );
 
     if( status != IOT_MQTT_SUCCESS )
     {
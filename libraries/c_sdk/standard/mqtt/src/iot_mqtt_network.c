@@ -68,6 +68,18 @@ static IotMqttError_t _getIncomingPacket( void * pNetworkConnection,
                                           const _mqttConnection_t * pMqttConnection,
                                           _mqttPacket_t * pIncomingPacket );
 
+/**
+ * @brief Read the fixed header of an incoming MQTT packet, parsing it in the
+ * receive buffer of the network connection.
+ *
+ * @param[in] pNetworkConnection Network connection to use for receive.
+ * @param[in] pMqttConnection The associated MQTT connection.
+ * @param[out] pIncomingPacket Output parameter for the packet type and remaining length.
+ */
+static void _peekFixedHeader( void * pNetworkConnection,
+                              const _mqttConnection_t * pMqttConnection,
+                              _mqttPacket_t * pIncomingPacket );
+
 /**
  * @brief Deserialize a packet received from the network.
  *
@@ -134,12 +146,74 @@ static bool _incomingPacketValid( uint8_t packetType )
 
 /*-----------------------------------------------------------*/
 
+static void _peekFixedHeader( void * pNetworkConnection,
+                              const _mqttConnection_t * pMqttConnection,
+                              _mqttPacket_t * pIncomingPacket )
+{
+    const uint8_t * pHeader = NULL;
+    uint8_t header[ MQTT_FIXED_HEADER_MAX_SIZE ] = { 0 };
+    size_t headerLength = 0, bytesAvailable = 0;
+
+    /* The shortest fixed header is 2 bytes. Wait for more only while the
+     * remaining length continues past the available bytes. */
+    size_t bytesRequested = 2;
+
+    pIncomingPacket->type = 0xff;
+    pIncomingPacket->remainingLength = MQTT_REMAINING_LENGTH_INVALID;
+
+    while( headerLength == 0 )
+    {
+        bytesAvailable = pMqttConnection->pNetworkInterface->peek( pNetworkConnection,
+                                                                   &pHeader,
+                                                                   bytesRequested );
+
+        if( bytesAvailable < bytesRequested )
+        {
+            /* Network error, the packet type remains invalid. */
+            break;
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+
+        headerLength = _IotMqtt_ParseFixedHeader( pHeader,
+                                                  bytesAvailable,
+                                                  &( pIncomingPacket->type ),
+                                                  &( pIncomingPacket->remainingLength ) );
+
+        bytesRequested = bytesAvailable + 1;
+    }
+
+    /* Consume the fixed header; the remaining data follows it. */
+    if( ( headerLength > 0 ) && ( headerLength <= MQTT_FIXED_HEADER_MAX_SIZE ) )
+    {
+        if( pMqttConnection->pNetworkInterface->receive( pNetworkConnection,
+                                                         header,
+                                                         headerLength ) != headerLength )
+        {
+            pIncomingPacket->remainingLength = MQTT_REMAINING_LENGTH_INVALID;
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+    }
+    else
+    {
+        pIncomingPacket->remainingLength = MQTT_REMAINING_LENGTH_INVALID;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
 static IotMqttError_t _getIncomingPacket( void * pNetworkConnection,
                                           const _mqttConnection_t * pMqttConnection,
                                           _mqttPacket_t * pIncomingPacket )
 {
     IOT_FUNCTION_ENTRY( IotMqttError_t, IOT_MQTT_SUCCESS );
     size_t dataBytesRead = 0;
+    bool fixedHeaderParsed = false;
 
     /* Default functions for retrieving packet type and length. */
     uint8_t ( * getPacketType )( void *,
@@ -179,9 +253,20 @@ static IotMqttError_t _getIncomingPacket( void * pNetworkConnection,
         }
     #endif /* if IOT_MQTT_ENABLE_SERIALIZER_OVERRIDES == 1 */
 
-    /* Read the packet type, which is the first byte available. */
-    pIncomingPacket->type = getPacketType( pNetworkConnection,
-                                           pMqttConnection->pNetworkInterface );
+    /* Parse the fixed header in place when the network buffers incoming data.
+     * Otherwise, read the packet type, which is the first byte available. */
+    if( ( pMqttConnection->pNetworkInterface->peek != NULL ) &&
+        ( getPacketType == _IotMqtt_GetPacketType ) &&
+        ( getRemainingLength == _IotMqtt_GetRemainingLength ) )
+    {
+        _peekFixedHeader( pNetworkConnection, pMqttConnection, pIncomingPacket );
+        fixedHeaderParsed = true;
+    }
+    else
+    {
+        pIncomingPacket->type = getPacketType( pNetworkConnection,
+                                               pMqttConnection->pNetworkInterface );
+    }
 
     /* Check that the incoming packet type is valid. */
     if( _incomingPacketValid( pIncomingPacket->type ) == false )
@@ -197,9 +282,16 @@ static IotMqttError_t _getIncomingPacket( void * pNetworkConnection,
         EMPTY_ELSE_MARKER;
     }
 
-    /* Read the remaining length. */
-    pIncomingPacket->remainingLength = getRemainingLength( pNetworkConnection,
-                                                           pMqttConnection->pNetworkInterface );
+    /* Read the remaining length, unless it was parsed with the packet type. */
+    if( fixedHeaderParsed == false )
+    {
+        pIncomingPacket->remainingLength = getRemainingLength( pNetworkConnection,
+                                                               pMqttConnection->pNetworkInterface );
+    }
+    else
+    {
+        EMPTY_ELSE_MARKER;
+    }
 
     if( pIncomingPacket->remainingLength == MQTT_REMAINING_LENGTH_INVALID )
     {
@@ -491,6 +583,7 @@ static IotMqttError_t _deserializeIncomingPacket( _mqttConnection_t * pMqttConne
 
             if( pOperation != NULL )
             {
+                IotMqtt_TraceEnd( MQTT_PUBACK, pOperation->u.operation.traceStart );
                 pOperation->u.operation.status = status;
                 _IotMqtt_Notify( pOperation );
             }
@@ -91,6 +91,84 @@ static bool _checkRetryLimit( _mqttOperation_t * pOperation );
  */
 static bool _scheduleNextRetry( _mqttOperation_t * pOperation );
 
+/**
+ * @brief Computes the first slot of a packet identifier in the pending table.
+ *
+ * Packet identifiers are allocated in sequence, so they are spread by a
+ * multiplicative hash.
+ *
+ * @param[in] packetIdentifier A packet identifier.
+ *
+ * @return The slot where the search for `packetIdentifier` starts.
+ */
+static size_t _pendingSlot( uint16_t packetIdentifier );
+
+/**
+ * @brief Adds an operation awaiting a response to the pending table, or
+ * counts it as left out if the table is full.
+ *
+ * @param[in] pTable The pending table of the operation's connection.
+ * @param[in] pOperation An operation in the pending responses list.
+ */
+static void _pendingIndex( _mqttPendingTable_t * pTable,
+                           _mqttOperation_t * pOperation );
+
+/**
+ * @brief Removes an operation from the pending table, or from the count of
+ * operations left out of it.
+ *
+ * @param[in] pTable The pending table of the operation's connection.
+ * @param[in] pOperation An operation that is not an incoming PUBLISH.
+ */
+static void _pendingUnindex( _mqttPendingTable_t * pTable,
+                             _mqttOperation_t * pOperation );
+
+/**
+ * @brief Moves an operation from the pending processing list to the pending
+ * responses list, and into the pending table.
+ *
+ * @param[in] pMqttConnection The connection of the operation.
+ * @param[in] pOperation The operation, which now awaits a response.
+ */
+static void _pendingInsert( _mqttConnection_t * pMqttConnection,
+                            _mqttOperation_t * pOperation );
+
+/**
+ * @brief Removes an operation from the list it is in, and from the pending
+ * table.
+ *
+ * @param[in] pOperation A linked operation that is not an incoming PUBLISH.
+ */
+static void _pendingRemove( _mqttOperation_t * pOperation );
+
+/**
+ * @brief Sets the DUP flag of a PUBLISH to retry, which gives it a new packet
+ * identifier for an AWS IoT MQTT server.
+ *
+ * The operation may already await its PUBACK, it is then moved to the slot of
+ * its new packet identifier.
+ *
+ * @param[in] pOperation The PUBLISH to retry.
+ * @param[in] publishSetDup The set DUP function of the connection.
+ */
+static void _pendingSetDup( _mqttOperation_t * pOperation,
+                            void ( * publishSetDup )( uint8_t *,
+                                                      uint8_t *,
+                                                      uint16_t * ) );
+
+/**
+ * @brief Looks up an operation in the pending table.
+ *
+ * @param[in] pTable The pending table.
+ * @param[in] type The operation type to look for.
+ * @param[in] packetIdentifier The packet identifier to look for.
+ *
+ * @return The operation; `NULL` if it is not in the table.
+ */
+static _mqttOperation_t * _pendingFind( const _mqttPendingTable_t * pTable,
+                                        IotMqttOperationType_t type,
+                                        uint16_t packetIdentifier );
+
 /*-----------------------------------------------------------*/
 
 static bool _mqttOperation_match( const IotLink_t * pOperationLink,
@@ -179,9 +257,7 @@ static bool _checkRetryLimit( _mqttOperation_t * pOperation )
     else if( pOperation->u.operation.retry.count == 1 )
     {
         /* Always set the DUP flag on the first retry. */
-        publishSetDup( pOperation->u.operation.pMqttPacket,
-                       pOperation->u.operation.pPacketIdentifierHigh,
-                       &( pOperation->u.operation.packetIdentifier ) );
+        _pendingSetDup( pOperation, publishSetDup );
     }
     else
     {
@@ -189,9 +265,7 @@ static bool _checkRetryLimit( _mqttOperation_t * pOperation )
          * identifier) must be reset on every retry. */
         if( pMqttConnection->awsIotMqttMode == true )
         {
-            publishSetDup( pOperation->u.operation.pMqttPacket,
-                           pOperation->u.operation.pPacketIdentifierHigh,
-                           &( pOperation->u.operation.packetIdentifier ) );
+            _pendingSetDup( pOperation, publishSetDup );
         }
         else
         {
@@ -281,13 +355,7 @@ static bool _scheduleNextRetry( _mqttOperation_t * pOperation )
          * list to the pending responses list on the first retry. */
         if( firstRetry == true )
         {
-            /* Operation must be linked. */
-            IotMqtt_Assert( IotLink_IsLinked( &( pOperation->link ) ) == true );
-
-            /* Transfer to pending response list. */
-            IotListDouble_Remove( &( pOperation->link ) );
-            IotListDouble_InsertHead( &( pMqttConnection->pendingResponse ),
-                                      &( pOperation->link ) );
+            _pendingInsert( pMqttConnection, pOperation );
         }
         else
         {
@@ -315,6 +383,219 @@ static bool _scheduleNextRetry( _mqttOperation_t * pOperation )
 
 /*-----------------------------------------------------------*/
 
+static size_t _pendingSlot( uint16_t packetIdentifier )
+{
+    /* The top bits of the product, 40503 is 2^16 divided by the golden ratio. */
+    uint32_t hash = ( ( uint32_t ) packetIdentifier * 40503UL ) & 0xffffUL;
+
+    return ( size_t ) ( ( hash * ( uint32_t ) IOT_MQTT_PENDING_TABLE_SIZE ) >> 16 );
+}
+
+/*-----------------------------------------------------------*/
+
+static void _pendingIndex( _mqttPendingTable_t * pTable,
+                           _mqttOperation_t * pOperation )
+{
+    size_t slot = 0;
+
+    /* Operations without a packet identifier are only searched by type. */
+    if( pOperation->u.operation.packetIdentifier != 0U )
+    {
+        /* Keep a quarter of the slots free so that probes stay short. */
+        if( pTable->count < ( ( IOT_MQTT_PENDING_TABLE_SIZE * 3 ) / 4 ) )
+        {
+            slot = _pendingSlot( pOperation->u.operation.packetIdentifier );
+
+            while( pTable->pSlots[ slot ] != NULL )
+            {
+                slot = ( slot + 1U ) % ( size_t ) IOT_MQTT_PENDING_TABLE_SIZE;
+            }
+
+            pTable->pSlots[ slot ] = pOperation;
+            ( pTable->count )++;
+            pOperation->u.operation.indexed = true;
+        }
+        else
+        {
+            IotLogDebug( "(MQTT connection %p, %s operation %p) Pending table full, "
+                         "the response will be matched by scanning the pending list.",
+                         pOperation->pMqttConnection,
+                         IotMqtt_OperationType( pOperation->u.operation.type ),
+                         pOperation );
+
+            ( pTable->overflowCount )++;
+            pOperation->u.operation.overflow = true;
+        }
+    }
+    else
+    {
+        EMPTY_ELSE_MARKER;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void _pendingUnindex( _mqttPendingTable_t * pTable,
+                             _mqttOperation_t * pOperation )
+{
+    size_t slot = 0, next = 0, home = 0;
+
+    if( pOperation->u.operation.indexed == true )
+    {
+        slot = _pendingSlot( pOperation->u.operation.packetIdentifier );
+
+        while( pTable->pSlots[ slot ] != pOperation )
+        {
+            /* An indexed operation is always found before a free slot. */
+            IotMqtt_Assert( pTable->pSlots[ slot ] != NULL );
+
+            slot = ( slot + 1U ) % ( size_t ) IOT_MQTT_PENDING_TABLE_SIZE;
+        }
+
+        /* Move back the operations of the probe sequence that would no longer
+         * be reachable from their first slot, instead of leaving a tombstone. */
+        pTable->pSlots[ slot ] = NULL;
+        next = slot;
+
+        while( true )
+        {
+            next = ( next + 1U ) % ( size_t ) IOT_MQTT_PENDING_TABLE_SIZE;
+
+            if( pTable->pSlots[ next ] == NULL )
+            {
+                break;
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+
+            home = _pendingSlot( pTable->pSlots[ next ]->u.operation.packetIdentifier );
+
+            /* The operation at next stays if its first slot is cyclically in
+             * ( slot, next ]. */
+            if( ( ( slot < next ) && ( ( home <= slot ) || ( home > next ) ) ) ||
+                ( ( slot > next ) && ( home <= slot ) && ( home > next ) ) )
+            {
+                pTable->pSlots[ slot ] = pTable->pSlots[ next ];
+                pTable->pSlots[ next ] = NULL;
+                slot = next;
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+        }
+
+        ( pTable->count )--;
+        pOperation->u.operation.indexed = false;
+    }
+    else if( pOperation->u.operation.overflow == true )
+    {
+        ( pTable->overflowCount )--;
+        pOperation->u.operation.overflow = false;
+    }
+    else
+    {
+        EMPTY_ELSE_MARKER;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void _pendingInsert( _mqttConnection_t * pMqttConnection,
+                            _mqttOperation_t * pOperation )
+{
+    /* Operation must be linked. */
+    IotMqtt_Assert( IotLink_IsLinked( &( pOperation->link ) ) == true );
+
+    /* Transfer to pending response list. */
+    IotListDouble_Remove( &( pOperation->link ) );
+    IotListDouble_InsertHead( &( pMqttConnection->pendingResponse ),
+                              &( pOperation->link ) );
+
+    _pendingIndex( &( pMqttConnection->pendingTable ), pOperation );
+}
+
+/*-----------------------------------------------------------*/
+
+static void _pendingRemove( _mqttOperation_t * pOperation )
+{
+    IotListDouble_Remove( &( pOperation->link ) );
+
+    _pendingUnindex( &( pOperation->pMqttConnection->pendingTable ), pOperation );
+}
+
+/*-----------------------------------------------------------*/
+
+static void _pendingSetDup( _mqttOperation_t * pOperation,
+                            void ( * publishSetDup )( uint8_t *,
+                                                      uint8_t *,
+                                                      uint16_t * ) )
+{
+    _mqttConnection_t * pMqttConnection = pOperation->pMqttConnection;
+    bool pending = false;
+
+    IotMutex_Lock( &( pMqttConnection->referencesMutex ) );
+
+    pending = ( pOperation->u.operation.indexed == true ) ||
+              ( pOperation->u.operation.overflow == true );
+
+    if( pending == true )
+    {
+        _pendingUnindex( &( pMqttConnection->pendingTable ), pOperation );
+    }
+    else
+    {
+        EMPTY_ELSE_MARKER;
+    }
+
+    publishSetDup( pOperation->u.operation.pMqttPacket,
+                   pOperation->u.operation.pPacketIdentifierHigh,
+                   &( pOperation->u.operation.packetIdentifier ) );
+
+    if( pending == true )
+    {
+        _pendingIndex( &( pMqttConnection->pendingTable ), pOperation );
+    }
+    else
+    {
+        EMPTY_ELSE_MARKER;
+    }
+
+    IotMutex_Unlock( &( pMqttConnection->referencesMutex ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static _mqttOperation_t * _pendingFind( const _mqttPendingTable_t * pTable,
+                                        IotMqttOperationType_t type,
+                                        uint16_t packetIdentifier )
+{
+    _mqttOperation_t * pResult = NULL;
+    size_t slot = _pendingSlot( packetIdentifier );
+
+    while( pTable->pSlots[ slot ] != NULL )
+    {
+        if( ( pTable->pSlots[ slot ]->u.operation.packetIdentifier == packetIdentifier ) &&
+            ( pTable->pSlots[ slot ]->u.operation.type == type ) )
+        {
+            pResult = pTable->pSlots[ slot ];
+            break;
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+
+        slot = ( slot + 1U ) % ( size_t ) IOT_MQTT_PENDING_TABLE_SIZE;
+    }
+
+    return pResult;
+}
+
+/*-----------------------------------------------------------*/
+
 IotMqttError_t _IotMqtt_CreateOperation( _mqttConnection_t * pMqttConnection,
                                          uint32_t flags,
                                          const IotMqttCallbackInfo_t * pCallbackInfo,
@@ -565,7 +846,7 @@ void _IotMqtt_DestroyOperation( _mqttOperation_t * pOperation )
                      IotMqtt_OperationType( pOperation->u.operation.type ),
                      pOperation );
 
-        IotListDouble_Remove( &( pOperation->link ) );
+        _pendingRemove( pOperation );
     }
     else
     {
@@ -886,6 +1167,16 @@ void _IotMqtt_ProcessSend( IotTaskPool_t pTaskPool,
         }
         else
         {
+            /* The wait for the PUBACK starts with the first transmission. */
+            if( pOperation->u.operation.retry.count == 0 )
+            {
+                pOperation->u.operation.traceStart = IotMqtt_TraceBegin();
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+
             /* DISCONNECT operations are considered successful upon successful
              * transmission. In addition, non-waitable operations with no callback
              * may also be considered successful. */
@@ -954,13 +1245,8 @@ void _IotMqtt_ProcessSend( IotTaskPool_t pTaskPool,
             {
                 IotMutex_Lock( &( pMqttConnection->referencesMutex ) );
 
-                /* Operation must be linked. */
-                IotMqtt_Assert( IotLink_IsLinked( &( pOperation->link ) ) );
-
                 /* Transfer to pending response list. */
-                IotListDouble_Remove( &( pOperation->link ) );
-                IotListDouble_InsertHead( &( pMqttConnection->pendingResponse ),
-                                          &( pOperation->link ) );
+                _pendingInsert( pMqttConnection, pOperation );
 
                 IotMutex_Unlock( &( pMqttConnection->referencesMutex ) );
 
@@ -1096,6 +1382,23 @@ IotMqttError_t _IotMqtt_ScheduleOperation( _mqttOperation_t * pOperation,
 
 /*-----------------------------------------------------------*/
 
+void _IotMqtt_ResetPendingTable( _mqttConnection_t * pMqttConnection )
+{
+    IotLink_t * pOperationLink = NULL;
+    _mqttOperation_t * pOperation = NULL;
+
+    IotContainers_ForEach( &( pMqttConnection->pendingResponse ), pOperationLink )
+    {
+        pOperation = IotLink_Container( _mqttOperation_t, pOperationLink, link );
+        pOperation->u.operation.indexed = false;
+        pOperation->u.operation.overflow = false;
+    }
+
+    ( void ) memset( &( pMqttConnection->pendingTable ), 0x00, sizeof( _mqttPendingTable_t ) );
+}
+
+/*-----------------------------------------------------------*/
+
 _mqttOperation_t * _IotMqtt_FindOperation( _mqttConnection_t * pMqttConnection,
                                            IotMqttOperationType_t type,
                                            const uint16_t * pPacketIdentifier )
@@ -1121,18 +1424,48 @@ _mqttOperation_t * _IotMqtt_FindOperation( _mqttConnection_t * pMqttConnection,
                      IotMqtt_OperationType( type ) );
     }
 
-    /* Find and remove the first matching element in the list. */
+    /* Find and remove the first matching element in the list. An operation with
+     * a packet identifier is looked up in the pending table; the list is only
+     * scanned for the operations left out of it. */
     IotMutex_Lock( &( pMqttConnection->referencesMutex ) );
-    pResultLink = IotListDouble_FindFirstMatch( &( pMqttConnection->pendingResponse ),
-                                                NULL,
-                                                _mqttOperation_match,
-                                                &param );
+
+    if( pPacketIdentifier != NULL )
+    {
+        pResult = _pendingFind( &( pMqttConnection->pendingTable ),
+                                type,
+                                *pPacketIdentifier );
+    }
+    else
+    {
+        EMPTY_ELSE_MARKER;
+    }
+
+    if( ( pResult == NULL ) &&
+        ( ( pPacketIdentifier == NULL ) || ( pMqttConnection->pendingTable.overflowCount > 0U ) ) )
+    {
+        pResultLink = IotListDouble_FindFirstMatch( &( pMqttConnection->pendingResponse ),
+                                                    NULL,
+                                                    _mqttOperation_match,
+                                                    &param );
+
+        if( pResultLink != NULL )
+        {
+            pResult = IotLink_Container( _mqttOperation_t, pResultLink, link );
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+    }
+    else
+    {
+        EMPTY_ELSE_MARKER;
+    }
 
     /* Check if a match was found. */
-    if( pResultLink != NULL )
+    if( pResult != NULL )
     {
-        /* Get operation pointer and check if it is waitable. */
-        pResult = IotLink_Container( _mqttOperation_t, pResultLink, link );
+        /* Check if the operation is waitable. */
         waitable = ( pResult->u.operation.flags & IOT_MQTT_FLAG_WAITABLE ) == IOT_MQTT_FLAG_WAITABLE;
 
         /* Check if the matched operation is a PUBLISH with retry. If it is, cancel
@@ -1189,7 +1522,7 @@ _mqttOperation_t * _IotMqtt_FindOperation( _mqttConnection_t * pMqttConnection,
                      IotMqtt_OperationType( type ) );
 
         /* Remove the matched operation from the list. */
-        IotListDouble_Remove( &( pResult->link ) );
+        _pendingRemove( pResult );
     }
     else
     {
@@ -1263,7 +1596,7 @@ void _IotMqtt_Notify( _mqttOperation_t * pOperation )
                  * processing. */
                 if( IotLink_IsLinked( &( pOperation->link ) ) == true )
                 {
-                    IotListDouble_Remove( &( pOperation->link ) );
+                    _pendingRemove( pOperation );
                 }
                 else
                 {
@@ -1329,3 +1662,8 @@ void _IotMqtt_Notify( _mqttOperation_t * pOperation )
 }
 
 /*-----------------------------------------------------------*/
+
+/* Provide access to internal functions and variables if testing. */
+#if IOT_BUILD_TESTS == 1
+    #include "iot_test_access_mqtt_operation.c"
+#endif
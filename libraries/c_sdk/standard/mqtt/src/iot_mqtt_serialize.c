@@ -669,6 +669,66 @@ size_t _IotMqtt_GetRemainingLength( void * pNetworkConnection,
 
 /*-----------------------------------------------------------*/
 
+size_t _IotMqtt_ParseFixedHeader( const uint8_t * pBuffer,
+                                  size_t bufferLength,
+                                  uint8_t * pPacketType,
+                                  size_t * pRemainingLength )
+{
+    uint8_t encodedByte = 0x80;
+    size_t remainingLength = 0, multiplier = 1, headerLength = 1;
+
+    IotMqtt_Assert( bufferLength > 0 );
+
+    /* The MQTT packet type is in the first byte of the packet. */
+    *pPacketType = pBuffer[ 0 ];
+
+    /* Decode the remaining length as _IotMqtt_GetRemainingLength does, without
+     * reading past the available bytes. */
+    while( ( ( encodedByte & 0x80 ) != 0 ) && ( headerLength < bufferLength ) )
+    {
+        if( multiplier > 2097152 ) /* 128 ^ 3 */
+        {
+            remainingLength = MQTT_REMAINING_LENGTH_INVALID;
+            break;
+        }
+        else
+        {
+            encodedByte = pBuffer[ headerLength ];
+            remainingLength += ( encodedByte & 0x7F ) * multiplier;
+            multiplier *= 128;
+            headerLength++;
+        }
+    }
+
+    if( remainingLength != MQTT_REMAINING_LENGTH_INVALID )
+    {
+        if( ( encodedByte & 0x80 ) != 0 )
+        {
+            /* The remaining length continues after the available bytes. */
+            headerLength = 0;
+        }
+        else if( ( headerLength - 1 ) != _remainingLengthEncodedSize( remainingLength ) )
+        {
+            /* Check that the decoded remaining length conforms to the MQTT specification. */
+            remainingLength = MQTT_REMAINING_LENGTH_INVALID;
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+    }
+    else
+    {
+        EMPTY_ELSE_MARKER;
+    }
+
+    *pRemainingLength = remainingLength;
+
+    return headerLength;
+}
+
+/*-----------------------------------------------------------*/
+
 IotMqttError_t _IotMqtt_SerializeConnect( const IotMqttConnectInfo_t * pConnectInfo,
                                           uint8_t ** pConnectPacket,
                                           size_t * pPacketSize )
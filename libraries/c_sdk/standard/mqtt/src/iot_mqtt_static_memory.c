@@ -42,6 +42,9 @@
 /* Static memory include. */
     #include "private/iot_static_memory.h"
 
+/* Slab allocator include. */
+    #include "private/iot_slab.h"
+
 /* MQTT internal include. */
     #include "private/iot_mqtt_internal.h"
 
@@ -89,33 +92,41 @@
 /*
  * Static memory buffers and flags, allocated and zeroed at compile-time.
  */
-    static bool _pInUseMqttConnections[ IOT_MQTT_CONNECTIONS ] = { 0 };                                      /**< @brief MQTT connection in-use flags. */
-    static _mqttConnection_t _pMqttConnections[ IOT_MQTT_CONNECTIONS ] = { { 0 } };                          /**< @brief MQTT connections. */
+    #if IOT_SLAB_ALLOCATOR == 0
+        static bool _pInUseMqttConnections[ IOT_MQTT_CONNECTIONS ] = { 0 };                                      /**< @brief MQTT connection in-use flags. */
+        static _mqttConnection_t _pMqttConnections[ IOT_MQTT_CONNECTIONS ] = { { 0 } };                          /**< @brief MQTT connections. */
 
-    static bool _pInUseMqttOperations[ IOT_MQTT_MAX_IN_PROGRESS_OPERATIONS ] = { 0 };                        /**< @brief MQTT operation in-use flags. */
-    static _mqttOperation_t _pMqttOperations[ IOT_MQTT_MAX_IN_PROGRESS_OPERATIONS ] = { { .link = { 0 } } }; /**< @brief MQTT operations. */
+        static bool _pInUseMqttOperations[ IOT_MQTT_MAX_IN_PROGRESS_OPERATIONS ] = { 0 };                        /**< @brief MQTT operation in-use flags. */
+        static _mqttOperation_t _pMqttOperations[ IOT_MQTT_MAX_IN_PROGRESS_OPERATIONS ] = { { .link = { 0 } } }; /**< @brief MQTT operations. */
 
-    static bool _pInUseMqttSubscriptions[ IOT_MQTT_SUBSCRIPTIONS ] = { 0 };                                  /**< @brief MQTT subscription in-use flags. */
-    static char _pMqttSubscriptions[ IOT_MQTT_SUBSCRIPTIONS ][ MQTT_SUBSCRIPTION_SIZE ] = { { 0 } };         /**< @brief MQTT subscriptions. */
+        static bool _pInUseMqttSubscriptions[ IOT_MQTT_SUBSCRIPTIONS ] = { 0 };                                  /**< @brief MQTT subscription in-use flags. */
+        static char _pMqttSubscriptions[ IOT_MQTT_SUBSCRIPTIONS ][ MQTT_SUBSCRIPTION_SIZE ] = { { 0 } };         /**< @brief MQTT subscriptions. */
+    #endif
 
 /*-----------------------------------------------------------*/
 
     void * IotMqtt_MallocConnection( size_t size )
     {
-        int32_t freeIndex = -1;
+        #if IOT_SLAB_ALLOCATOR == 0
+            int32_t freeIndex = -1;
+        #endif
         void * pNewConnection = NULL;
 
         /* Check size argument. */
         if( size == sizeof( _mqttConnection_t ) )
         {
-            /* Find a free MQTT connection. */
-            freeIndex = IotStaticMemory_FindFree( _pInUseMqttConnections,
-                                                  IOT_MQTT_CONNECTIONS );
-
-            if( freeIndex != -1 )
-            {
-                pNewConnection = &( _pMqttConnections[ freeIndex ] );
-            }
+            #if IOT_SLAB_ALLOCATOR == 1
+                pNewConnection = IotSlab_Malloc( size );
+            #else
+                /* Find a free MQTT connection. */
+                freeIndex = IotStaticMemory_FindFree( _pInUseMqttConnections,
+                                                      IOT_MQTT_CONNECTIONS );
+
+                if( freeIndex != -1 )
+                {
+                    pNewConnection = &( _pMqttConnections[ freeIndex ] );
+                }
+            #endif
         }
 
         return pNewConnection;
@@ -125,32 +136,42 @@
 
     void IotMqtt_FreeConnection( void * ptr )
     {
-        /* Return the in-use MQTT connection. */
-        IotStaticMemory_ReturnInUse( ptr,
-                                     _pMqttConnections,
-                                     _pInUseMqttConnections,
-                                     IOT_MQTT_CONNECTIONS,
-                                     sizeof( _mqttConnection_t ) );
+        #if IOT_SLAB_ALLOCATOR == 1
+            IotSlab_Free( ptr );
+        #else
+            /* Return the in-use MQTT connection. */
+            IotStaticMemory_ReturnInUse( ptr,
+                                         _pMqttConnections,
+                                         _pInUseMqttConnections,
+                                         IOT_MQTT_CONNECTIONS,
+                                         sizeof( _mqttConnection_t ) );
+        #endif
     }
 
 /*-----------------------------------------------------------*/
 
     void * IotMqtt_MallocOperation( size_t size )
     {
-        int32_t freeIndex = -1;
+        #if IOT_SLAB_ALLOCATOR == 0
+            int32_t freeIndex = -1;
+        #endif
         void * pNewOperation = NULL;
 
         /* Check size argument. */
         if( size == sizeof( _mqttOperation_t ) )
         {
-            /* Find a free MQTT operation. */
-            freeIndex = IotStaticMemory_FindFree( _pInUseMqttOperations,
-                                                  IOT_MQTT_MAX_IN_PROGRESS_OPERATIONS );
-
-            if( freeIndex != -1 )
-            {
-                pNewOperation = &( _pMqttOperations[ freeIndex ] );
-            }
+            #if IOT_SLAB_ALLOCATOR == 1
+                pNewOperation = IotSlab_Malloc( size );
+            #else
+                /* Find a free MQTT operation. */
+                freeIndex = IotStaticMemory_FindFree( _pInUseMqttOperations,
+                                                      IOT_MQTT_MAX_IN_PROGRESS_OPERATIONS );
+
+                if( freeIndex != -1 )
+                {
+                    pNewOperation = &( _pMqttOperations[ freeIndex ] );
+                }
+            #endif
         }
 
         return pNewOperation;
@@ -160,31 +181,41 @@
 
     void IotMqtt_FreeOperation( void * ptr )
     {
-        /* Return the in-use MQTT operation. */
-        IotStaticMemory_ReturnInUse( ptr,
-                                     _pMqttOperations,
-                                     _pInUseMqttOperations,
-                                     IOT_MQTT_MAX_IN_PROGRESS_OPERATIONS,
-                                     sizeof( _mqttOperation_t ) );
+        #if IOT_SLAB_ALLOCATOR == 1
+            IotSlab_Free( ptr );
+        #else
+            /* Return the in-use MQTT operation. */
+            IotStaticMemory_ReturnInUse( ptr,
+                                         _pMqttOperations,
+                                         _pInUseMqttOperations,
+                                         IOT_MQTT_MAX_IN_PROGRESS_OPERATIONS,
+                                         sizeof( _mqttOperation_t ) );
+        #endif
     }
 
 /*-----------------------------------------------------------*/
 
     void * IotMqtt_MallocSubscription( size_t size )
     {
-        int32_t freeIndex = -1;
+        #if IOT_SLAB_ALLOCATOR == 0
+            int32_t freeIndex = -1;
+        #endif
         void * pNewSubscription = NULL;
 
         if( size <= MQTT_SUBSCRIPTION_SIZE )
         {
-            /* Get the index of a free MQTT subscription. */
-            freeIndex = IotStaticMemory_FindFree( _pInUseMqttSubscriptions,
-                                                  IOT_MQTT_SUBSCRIPTIONS );
-
-            if( freeIndex != -1 )
-            {
-                pNewSubscription = &( _pMqttSubscriptions[ freeIndex ][ 0 ] );
-            }
+            #if IOT_SLAB_ALLOCATOR == 1
+                pNewSubscription = IotSlab_Malloc( size );
+            #else
+                /* Get the index of a free MQTT subscription. */
+                freeIndex = IotStaticMemory_FindFree( _pInUseMqttSubscriptions,
+                                                      IOT_MQTT_SUBSCRIPTIONS );
+
+                if( freeIndex != -1 )
+                {
+                    pNewSubscription = &( _pMqttSubscriptions[ freeIndex ][ 0 ] );
+                }
+            #endif
         }
 
         return pNewSubscription;
@@ -194,12 +225,16 @@
 
     void IotMqtt_FreeSubscription( void * ptr )
     {
-        /* Return the in-use MQTT subscription. */
-        IotStaticMemory_ReturnInUse( ptr,
-                                     _pMqttSubscriptions,
-                                     _pInUseMqttSubscriptions,
-                                     IOT_MQTT_SUBSCRIPTIONS,
-                                     MQTT_SUBSCRIPTION_SIZE );
+        #if IOT_SLAB_ALLOCATOR == 1
+            IotSlab_Free( ptr );
+        #else
+            /* Return the in-use MQTT subscription. */
+            IotStaticMemory_ReturnInUse( ptr,
+                                         _pMqttSubscriptions,
+                                         _pInUseMqttSubscriptions,
+                                         IOT_MQTT_SUBSCRIPTIONS,
+                                         MQTT_SUBSCRIPTION_SIZE );
+        #endif
     }
 
 /*-----------------------------------------------------------*/
@@ -65,6 +65,23 @@ typedef struct _packetMatchParams
     int32_t order;             /**< Order to match. Set to `-1` to ignore. */
 } _packetMatchParams_t;
 
+/**
+ * @brief Subscriptions matching an incoming PUBLISH, collected in batches of
+ * #IOT_MQTT_TOPIC_INDEX_MATCHES.
+ */
+typedef struct _topicMatches
+{
+    _mqttSubscription_t * pSubscriptions[ IOT_MQTT_TOPIC_INDEX_MATCHES ]; /**< @brief Matches of this batch. */
+    size_t count;                                                       /**< @brief Matches in pSubscriptions. */
+    size_t skip;                                                        /**< @brief Matches handled by the previous batches. */
+    size_t total;                                                       /**< @brief Matches found, including the skipped ones. */
+} _topicMatches_t;
+
+/**
+ * @brief Marks a free node of the topic index.
+ */
+#define TOPIC_NODE_FREE    ( UINT16_MAX )
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -92,6 +109,124 @@ static bool _topicMatch( const IotLink_t * pSubscriptionLink,
 static bool _packetMatch( const IotLink_t * pSubscriptionLink,
                           void * pMatch );
 
+/**
+ * @brief Finds the length of the topic level starting at an offset.
+ *
+ * @param[in] pTopic Topic name or filter.
+ * @param[in] topicLength Length of pTopic.
+ * @param[in] offset Start of the level.
+ *
+ * @return Length of the level, up to the next '/' or the end of the topic.
+ */
+static uint16_t _levelLength( const char * pTopic,
+                              uint16_t topicLength,
+                              size_t offset );
+
+/**
+ * @brief Allocates a node of the topic index below a parent.
+ *
+ * @param[in] pIndex The topic index.
+ * @param[in] parent Node of the previous level.
+ *
+ * @return The node, 0 if the index is full.
+ */
+static uint16_t _allocateNode( _mqttTopicIndex_t * pIndex,
+                               uint16_t parent );
+
+/**
+ * @brief Moves the level strings in use to the start of the level buffer.
+ *
+ * @param[in] pIndex The topic index.
+ */
+static void _compactLevels( _mqttTopicIndex_t * pIndex );
+
+/**
+ * @brief Stores a level string, reusing an equal level of another node.
+ *
+ * @param[in] pIndex The topic index.
+ * @param[in] pLevel The level string.
+ * @param[in] levelLength Length of pLevel.
+ * @param[out] pLevelOffset Offset of the level in the level buffer.
+ *
+ * @return `false` if the level buffer is full.
+ */
+static bool _internLevel( _mqttTopicIndex_t * pIndex,
+                          const char * pLevel,
+                          uint16_t levelLength,
+                          uint16_t * pLevelOffset );
+
+/**
+ * @brief Finds the child of a node with a literal level.
+ *
+ * @param[in] pIndex The topic index.
+ * @param[in] node The parent node.
+ * @param[in] pLevel The level string.
+ * @param[in] levelLength Length of pLevel.
+ *
+ * @return The child, 0 if there is none.
+ */
+static uint16_t _findChild( const _mqttTopicIndex_t * pIndex,
+                            uint16_t node,
+                            const char * pLevel,
+                            uint16_t levelLength );
+
+/**
+ * @brief Frees the nodes no longer used by any filter, from a node up to the
+ * root.
+ *
+ * @param[in] pIndex The topic index.
+ * @param[in] node The last level of a removed filter.
+ */
+static void _pruneNodes( _mqttTopicIndex_t * pIndex,
+                         uint16_t node );
+
+/**
+ * @brief Adds the topic filter of a subscription to the topic index.
+ *
+ * @param[in] pIndex The topic index.
+ * @param[in] pSubscription A subscription whose filter is not in the index.
+ *
+ * @return `false` if the index is full; the index is then unchanged.
+ */
+static bool _indexInsert( _mqttTopicIndex_t * pIndex,
+                          _mqttSubscription_t * pSubscription );
+
+/**
+ * @brief Removes a subscription from the topic index, or from the count of
+ * subscriptions that did not fit.
+ *
+ * @param[in] pIndex The topic index.
+ * @param[in] pSubscription The subscription.
+ */
+static void _indexRemove( _mqttTopicIndex_t * pIndex,
+                          _mqttSubscription_t * pSubscription );
+
+/**
+ * @brief Adds a subscription to a batch of matches.
+ *
+ * @param[in] pMatches The batch.
+ * @param[in] pSubscription A subscription matching the topic name.
+ */
+static void _addMatch( _topicMatches_t * pMatches,
+                       _mqttSubscription_t * pSubscription );
+
+/**
+ * @brief Collects the subscriptions matching a topic name.
+ *
+ * The topic index is searched first, then the subscriptions left out of it.
+ * Both are always searched in the same order, so that the matches skipped by
+ * a batch are the ones handled by the previous batches.
+ *
+ * @param[in] pMqttConnection The MQTT connection.
+ * @param[in] pTopicName The topic name of a PUBLISH.
+ * @param[in] topicNameLength Length of pTopicName.
+ * @param[in,out] pMatches The batch, with its count and skip set.
+ */
+static void _findMatches( _mqttConnection_t * pMqttConnection,
+                          const char * pTopicName,
+                          uint16_t topicNameLength,
+                          _topicMatches_t * pMatches );
+
 /*-----------------------------------------------------------*/
 
 static bool _topicMatch( const IotLink_t * pSubscriptionLink,
@@ -310,6 +445,563 @@ static bool _packetMatch( const IotLink_t * pSubscriptionLink,
 
 /*-----------------------------------------------------------*/
 
+static uint16_t _levelLength( const char * pTopic,
+                              uint16_t topicLength,
+                              size_t offset )
+{
+    const char * pSeparator = memchr( pTopic + offset, '/', topicLength - offset );
+
+    return ( pSeparator == NULL ) ? ( uint16_t ) ( topicLength - offset )
+           : ( uint16_t ) ( pSeparator - ( pTopic + offset ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t _allocateNode( _mqttTopicIndex_t * pIndex,
+                               uint16_t parent )
+{
+    uint16_t node = 0;
+
+    if( pIndex->freeNode != 0U )
+    {
+        node = pIndex->freeNode;
+        pIndex->freeNode = pIndex->nodes[ node ].nextSibling;
+    }
+    else if( pIndex->nodesUsed < ( uint16_t ) ( IOT_MQTT_TOPIC_INDEX_NODES - 1 ) )
+    {
+        ( pIndex->nodesUsed )++;
+        node = pIndex->nodesUsed;
+    }
+    else
+    {
+        EMPTY_ELSE_MARKER;
+    }
+
+    if( node != 0U )
+    {
+        ( void ) memset( &( pIndex->nodes[ node ] ), 0x00, sizeof( _mqttTopicNode_t ) );
+        pIndex->nodes[ node ].parent = parent;
+    }
+    else
+    {
+        EMPTY_ELSE_MARKER;
+    }
+
+    return node;
+}
+
+/*-----------------------------------------------------------*/
+
+static void _compactLevels( _mqttTopicIndex_t * pIndex )
+{
+    uint16_t node = 0, used = 0;
+    size_t next = 0, lowest = 0;
+    uint16_t lowestLength = 0;
+    _mqttTopicNode_t * pNode = NULL;
+
+    /* Move the strings down in the order of their offsets. Nodes sharing a
+     * string are updated together; the strings already moved are all below
+     * the next offset to process. */
+    while( true )
+    {
+        lowest = IOT_MQTT_TOPIC_INDEX_LEVELS_SIZE;
+
+        for( node = 1; node <= pIndex->nodesUsed; node++ )
+        {
+            pNode = &( pIndex->nodes[ node ] );
+
+            if( ( pNode->levelLength != TOPIC_NODE_FREE ) &&
+                ( pNode->levelLength > 0U ) &&
+                ( pNode->levelOffset >= next ) &&
+                ( pNode->levelOffset < lowest ) )
+            {
+                lowest = pNode->levelOffset;
+                lowestLength = pNode->levelLength;
+            }
+        }
+
+        if( lowest == IOT_MQTT_TOPIC_INDEX_LEVELS_SIZE )
+        {
+            break;
+        }
+
+        ( void ) memmove( &( pIndex->pLevels[ used ] ), &( pIndex->pLevels[ lowest ] ), lowestLength );
+
+        for( node = 1; node <= pIndex->nodesUsed; node++ )
+        {
+            pNode = &( pIndex->nodes[ node ] );
+
+            if( ( pNode->levelLength != TOPIC_NODE_FREE ) &&
+                ( pNode->levelLength > 0U ) &&
+                ( pNode->levelOffset == lowest ) )
+            {
+                pNode->levelOffset = used;
+            }
+        }
+
+        next = lowest + lowestLength;
+        used = ( uint16_t ) ( used + lowestLength );
+    }
+
+    pIndex->levelsUsed = used;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool _internLevel( _mqttTopicIndex_t * pIndex,
+                          const char * pLevel,
+                          uint16_t levelLength,
+                          uint16_t * pLevelOffset )
+{
+    bool status = false;
+    uint16_t node = 0;
+    const _mqttTopicNode_t * pNode = NULL;
+
+    *pLevelOffset = 0;
+
+    /* Empty levels have no string. */
+    if( levelLength == 0U )
+    {
+        status = true;
+    }
+    else
+    {
+        for( node = 1; node <= pIndex->nodesUsed; node++ )
+        {
+            pNode = &( pIndex->nodes[ node ] );
+
+            if( ( pNode->levelLength == levelLength ) &&
+                ( memcmp( &( pIndex->pLevels[ pNode->levelOffset ] ), pLevel, levelLength ) == 0 ) )
+            {
+                *pLevelOffset = pNode->levelOffset;
+                status = true;
+                break;
+            }
+        }
+    }
+
+    if( status == false )
+    {
+        /* Reclaim the strings of the removed filters. */
+        if( levelLength > ( IOT_MQTT_TOPIC_INDEX_LEVELS_SIZE - pIndex->levelsUsed ) )
+        {
+            _compactLevels( pIndex );
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+
+        if( levelLength <= ( IOT_MQTT_TOPIC_INDEX_LEVELS_SIZE - pIndex->levelsUsed ) )
+        {
+            ( void ) memcpy( &( pIndex->pLevels[ pIndex->levelsUsed ] ), pLevel, levelLength );
+            *pLevelOffset = pIndex->levelsUsed;
+            pIndex->levelsUsed = ( uint16_t ) ( pIndex->levelsUsed + levelLength );
+            status = true;
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+    }
+    else
+    {
+        EMPTY_ELSE_MARKER;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint16_t _findChild( const _mqttTopicIndex_t * pIndex,
+                            uint16_t node,
+                            const char * pLevel,
+                            uint16_t levelLength )
+{
+    uint16_t child = pIndex->nodes[ node ].firstChild;
+    const _mqttTopicNode_t * pChild = NULL;
+
+    while( child != 0U )
+    {
+        pChild = &( pIndex->nodes[ child ] );
+
+        if( ( pChild->levelLength == levelLength ) &&
+            ( memcmp( &( pIndex->pLevels[ pChild->levelOffset ] ), pLevel, levelLength ) == 0 ) )
+        {
+            break;
+        }
+        else
+        {
+            child = pChild->nextSibling;
+        }
+    }
+
+    return child;
+}
+
+/*-----------------------------------------------------------*/
+
+static void _pruneNodes( _mqttTopicIndex_t * pIndex,
+                         uint16_t node )
+{
+    uint16_t parent = 0;
+    uint16_t * pLink = NULL;
+    _mqttTopicNode_t * pNode = NULL;
+
+    while( node != 0U )
+    {
+        pNode = &( pIndex->nodes[ node ] );
+
+        /* Stop at the first level still used by a filter. */
+        if( ( pNode->pSubscription != NULL ) ||
+            ( pNode->pMultiLevel != NULL ) ||
+            ( pNode->firstChild != 0U ) ||
+            ( pNode->singleLevel != 0U ) )
+        {
+            break;
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+
+        /* Unlink the node from its parent. */
+        parent = pNode->parent;
+
+        if( pIndex->nodes[ parent ].singleLevel == node )
+        {
+            pIndex->nodes[ parent ].singleLevel = 0;
+        }
+        else
+        {
+            pLink = &( pIndex->nodes[ parent ].firstChild );
+
+            while( *pLink != node )
+            {
+                pLink = &( pIndex->nodes[ *pLink ].nextSibling );
+            }
+
+            *pLink = pNode->nextSibling;
+        }
+
+        /* Its level string is reclaimed by the next compaction. */
+        pNode->levelLength = TOPIC_NODE_FREE;
+        pNode->nextSibling = pIndex->freeNode;
+        pIndex->freeNode = node;
+
+        node = parent;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool _indexInsert( _mqttTopicIndex_t * pIndex,
+                          _mqttSubscription_t * pSubscription )
+{
+    bool status = true;
+    const char * pTopicFilter = pSubscription->pTopicFilter;
+    const uint16_t topicFilterLength = pSubscription->topicFilterLength;
+    size_t offset = 0;
+    uint16_t levelLength = 0, levelOffset = 0, node = 0, child = 0;
+    _mqttSubscription_t ** pSlot = NULL;
+
+    /* Follow or create one node per level of the filter. Subscription
+     * validation only allows wildcards as whole levels, and "#" as the last. */
+    while( true )
+    {
+        levelLength = _levelLength( pTopicFilter, topicFilterLength, offset );
+
+        if( ( levelLength == 1U ) && ( pTopicFilter[ offset ] == '#' ) )
+        {
+            pSlot = &( pIndex->nodes[ node ].pMultiLevel );
+            break;
+        }
+        else if( ( levelLength == 1U ) && ( pTopicFilter[ offset ] == '+' ) )
+        {
+            child = pIndex->nodes[ node ].singleLevel;
+
+            if( child == 0U )
+            {
+                child = _allocateNode( pIndex, node );
+                pIndex->nodes[ node ].singleLevel = child;
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+        }
+        else
+        {
+            child = _findChild( pIndex, node, &( pTopicFilter[ offset ] ), levelLength );
+
+            if( ( child == 0U ) &&
+                ( _internLevel( pIndex, &( pTopicFilter[ offset ] ), levelLength, &levelOffset ) == true ) )
+            {
+                child = _allocateNode( pIndex, node );
+
+                if( child != 0U )
+                {
+                    pIndex->nodes[ child ].levelOffset = levelOffset;
+                    pIndex->nodes[ child ].levelLength = levelLength;
+                    pIndex->nodes[ child ].nextSibling = pIndex->nodes[ node ].firstChild;
+                    pIndex->nodes[ node ].firstChild = child;
+                }
+                else
+                {
+                    EMPTY_ELSE_MARKER;
+                }
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+        }
+
+        if( child == 0U )
+        {
+            status = false;
+            break;
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+
+        node = child;
+        offset += ( size_t ) levelLength + 1U;
+
+        if( offset > topicFilterLength )
+        {
+            pSlot = &( pIndex->nodes[ node ].pSubscription );
+            break;
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+    }
+
+    if( status == true )
+    {
+        /* Topic filters are unique in a connection. */
+        IotMqtt_Assert( *pSlot == NULL );
+
+        *pSlot = pSubscription;
+        pSubscription->indexed = true;
+    }
+    else
+    {
+        /* Free the levels created for this filter. */
+        _pruneNodes( pIndex, node );
+
+        pSubscription->overflow = true;
+        ( pIndex->overflowCount )++;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static void _indexRemove( _mqttTopicIndex_t * pIndex,
+                          _mqttSubscription_t * pSubscription )
+{
+    const char * pTopicFilter = pSubscription->pTopicFilter;
+    const uint16_t topicFilterLength = pSubscription->topicFilterLength;
+    size_t offset = 0;
+    uint16_t levelLength = 0, node = 0, child = 0;
+    _mqttSubscription_t ** pSlot = NULL;
+
+    if( pSubscription->indexed == true )
+    {
+        while( true )
+        {
+            levelLength = _levelLength( pTopicFilter, topicFilterLength, offset );
+
+            if( ( levelLength == 1U ) && ( pTopicFilter[ offset ] == '#' ) )
+            {
+                pSlot = &( pIndex->nodes[ node ].pMultiLevel );
+                break;
+            }
+            else if( ( levelLength == 1U ) && ( pTopicFilter[ offset ] == '+' ) )
+            {
+                child = pIndex->nodes[ node ].singleLevel;
+            }
+            else
+            {
+                child = _findChild( pIndex, node, &( pTopicFilter[ offset ] ), levelLength );
+            }
+
+            /* All the levels of an indexed filter are in the index. */
+            IotMqtt_Assert( child != 0U );
+
+            node = child;
+            offset += ( size_t ) levelLength + 1U;
+
+            if( offset > topicFilterLength )
+            {
+                pSlot = &( pIndex->nodes[ node ].pSubscription );
+                break;
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+        }
+
+        IotMqtt_Assert( *pSlot == pSubscription );
+
+        *pSlot = NULL;
+        _pruneNodes( pIndex, node );
+        pSubscription->indexed = false;
+    }
+    else if( pSubscription->overflow == true )
+    {
+        ( pIndex->overflowCount )--;
+        pSubscription->overflow = false;
+    }
+    else
+    {
+        EMPTY_ELSE_MARKER;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void _addMatch( _topicMatches_t * pMatches,
+                       _mqttSubscription_t * pSubscription )
+{
+    if( ( pMatches->total >= pMatches->skip ) &&
+        ( pMatches->count < ( size_t ) IOT_MQTT_TOPIC_INDEX_MATCHES ) )
+    {
+        pMatches->pSubscriptions[ pMatches->count ] = pSubscription;
+        ( pMatches->count )++;
+    }
+    else
+    {
+        EMPTY_ELSE_MARKER;
+    }
+
+    ( pMatches->total )++;
+}
+
+/*-----------------------------------------------------------*/
+
+static void _findMatches( _mqttConnection_t * pMqttConnection,
+                          const char * pTopicName,
+                          uint16_t topicNameLength,
+                          _topicMatches_t * pMatches )
+{
+    const _mqttTopicIndex_t * pIndex = &( pMqttConnection->topicIndex );
+    const _mqttTopicNode_t * pNode = NULL;
+    IotLink_t * pSubscriptionLink = NULL;
+    _mqttSubscription_t * pSubscription = NULL;
+    uint16_t node = 0, child = 0, levelLength = 0;
+    size_t offset = 0, depth = 0;
+    _topicMatchParams_t topicMatchParams =
+    {
+        .pTopicName      = pTopicName,
+        .topicNameLength = topicNameLength,
+        .exactMatchOnly  = false
+    };
+
+    /* Nodes left to visit with the offset of the topic level below them. A
+     * node sits at a single depth, so it is pushed at most once. */
+    uint16_t pendingNodes[ IOT_MQTT_TOPIC_INDEX_NODES ];
+    size_t pendingOffsets[ IOT_MQTT_TOPIC_INDEX_NODES ];
+
+    pendingNodes[ 0 ] = 0;
+    pendingOffsets[ 0 ] = 0;
+    depth = 1;
+
+    while( depth > 0U )
+    {
+        depth--;
+        node = pendingNodes[ depth ];
+        offset = pendingOffsets[ depth ];
+        pNode = &( pIndex->nodes[ node ] );
+
+        /* "#" matches the level it follows and any levels below. */
+        if( pNode->pMultiLevel != NULL )
+        {
+            _addMatch( pMatches, pNode->pMultiLevel );
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+
+        if( offset > topicNameLength )
+        {
+            /* The topic name ends at this level. */
+            if( pNode->pSubscription != NULL )
+            {
+                _addMatch( pMatches, pNode->pSubscription );
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+        }
+        else
+        {
+            levelLength = _levelLength( pTopicName, topicNameLength, offset );
+
+            if( pNode->singleLevel != 0U )
+            {
+                IotMqtt_Assert( depth < ( size_t ) IOT_MQTT_TOPIC_INDEX_NODES );
+                pendingNodes[ depth ] = pNode->singleLevel;
+                pendingOffsets[ depth ] = offset + levelLength + 1U;
+                depth++;
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+
+            child = _findChild( pIndex, node, &( pTopicName[ offset ] ), levelLength );
+
+            if( child != 0U )
+            {
+                IotMqtt_Assert( depth < ( size_t ) IOT_MQTT_TOPIC_INDEX_NODES );
+                pendingNodes[ depth ] = child;
+                pendingOffsets[ depth ] = offset + levelLength + 1U;
+                depth++;
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+        }
+    }
+
+    /* Scan the list only for the subscriptions left out of the index. */
+    if( pIndex->overflowCount > 0U )
+    {
+        IotContainers_ForEach( &( pMqttConnection->subscriptionList ), pSubscriptionLink )
+        {
+            pSubscription = IotLink_Container( _mqttSubscription_t, pSubscriptionLink, link );
+
+            if( ( pSubscription->overflow == true ) &&
+                ( _topicMatch( pSubscriptionLink, &topicMatchParams ) == true ) )
+            {
+                _addMatch( pMatches, pSubscription );
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+        }
+    }
+    else
+    {
+        EMPTY_ELSE_MARKER;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
 IotMqttError_t _IotMqtt_AddSubscriptions( _mqttConnection_t * pMqttConnection,
                                           uint16_t subscribePacketIdentifier,
                                           const IotMqttSubscription_t * pSubscriptionList,
@@ -374,6 +1066,20 @@ IotMqttError_t _IotMqtt_AddSubscriptions( _mqttConnection_t * pMqttConnection,
 
                 IotListDouble_InsertHead( &( pMqttConnection->subscriptionList ),
                                           &( pNewSubscription->link ) );
+
+                /* Add the topic filter to the index of incoming PUBLISH topics. */
+                if( _indexInsert( &( pMqttConnection->topicIndex ), pNewSubscription ) == false )
+                {
+                    IotLogWarn( "(MQTT connection %p) Topic index full, %.*s will be matched by "
+                                "scanning the subscription list.",
+                                pMqttConnection,
+                                pNewSubscription->topicFilterLength,
+                                pNewSubscription->pTopicFilter );
+                }
+                else
+                {
+                    EMPTY_ELSE_MARKER;
+                }
             }
         }
     }
@@ -401,101 +1107,98 @@ void _IotMqtt_InvokeSubscriptionCallback( _mqttConnection_t * pMqttConnection,
                                           IotMqttCallbackParam_t * pCallbackParam )
 {
     _mqttSubscription_t * pSubscription = NULL;
-    IotLink_t * pCurrentLink = NULL, * pNextLink = NULL;
+    _topicMatches_t matches = { .count = 0 };
+    size_t i = 0;
     void * pCallbackContext = NULL;
 
     void ( * callbackFunction )( void *,
                                  IotMqttCallbackParam_t * ) = NULL;
-    _topicMatchParams_t topicMatchParams =
-    {
-        .pTopicName      = pCallbackParam->u.message.info.pTopicName,
-        .topicNameLength = pCallbackParam->u.message.info.topicNameLength,
-        .exactMatchOnly  = false
-    };
 
     /* Prevent any other thread from modifying the subscription list while this
      * function is searching. */
     IotMutex_Lock( &( pMqttConnection->subscriptionMutex ) );
 
-    /* Search the subscription list for all matching subscriptions starting at
-     * the list head. */
-    while( true )
+    /* Look up the matching subscriptions in batches. The search of each batch
+     * skips the matches of the previous ones. */
+    do
     {
-        pCurrentLink = IotListDouble_FindFirstMatch( &( pMqttConnection->subscriptionList ),
-                                                     pCurrentLink,
-                                                     _topicMatch,
-                                                     &topicMatchParams );
-
-        /* No subscription found. Exit loop. */
-        if( pCurrentLink == NULL )
+        matches.skip += matches.count;
+        matches.count = 0;
+        matches.total = 0;
+
+        _findMatches( pMqttConnection,
+                      pCallbackParam->u.message.info.pTopicName,
+                      pCallbackParam->u.message.info.topicNameLength,
+                      &matches );
+
+        /* Keep every subscription of the batch while the subscription mutex is
+         * released for the callbacks. */
+        for( i = 0; i < matches.count; i++ )
         {
-            break;
-        }
-        else
-        {
-            EMPTY_ELSE_MARKER;
+            ( matches.pSubscriptions[ i ]->references )++;
         }
 
-        /* Subscription found. Calculate pointer to subscription object. */
-        pSubscription = IotLink_Container( _mqttSubscription_t, pCurrentLink, link );
-
-        /* Subscription validation should not have allowed a NULL callback function. */
-        IotMqtt_Assert( pSubscription->callback.function != NULL );
-
-        /* Increment the subscription's reference count. */
-        ( pSubscription->references )++;
-
-        /* Copy the necessary members of the subscription before releasing the
-         * subscription list mutex. */
-        pCallbackContext = pSubscription->callback.pCallbackContext;
-        callbackFunction = pSubscription->callback.function;
+        for( i = 0; i < matches.count; i++ )
+        {
+            pSubscription = matches.pSubscriptions[ i ];
 
-        /* Unlock the subscription list mutex. */
-        IotMutex_Unlock( &( pMqttConnection->subscriptionMutex ) );
+            /* Skip a subscription removed by a previous callback. */
+            if( pSubscription->unsubscribed == false )
+            {
+                /* Subscription validation should not have allowed a NULL callback function. */
+                IotMqtt_Assert( pSubscription->callback.function != NULL );
 
-        /* Set the members of the callback parameter. */
-        pCallbackParam->mqttConnection = pMqttConnection;
-        pCallbackParam->u.message.pTopicFilter = pSubscription->pTopicFilter;
-        pCallbackParam->u.message.topicFilterLength = pSubscription->topicFilterLength;
+                /* Copy the necessary members of the subscription before releasing the
+                 * subscription list mutex. */
+                pCallbackContext = pSubscription->callback.pCallbackContext;
+                callbackFunction = pSubscription->callback.function;
 
-        /* Invoke the subscription callback. */
-        callbackFunction( pCallbackContext, pCallbackParam );
+                /* Unlock the subscription list mutex. */
+                IotMutex_Unlock( &( pMqttConnection->subscriptionMutex ) );
 
-        /* Lock the subscription list mutex to decrement the reference count. */
-        IotMutex_Lock( &( pMqttConnection->subscriptionMutex ) );
+                /* Set the members of the callback parameter. */
+                pCallbackParam->mqttConnection = pMqttConnection;
+                pCallbackParam->u.message.pTopicFilter = pSubscription->pTopicFilter;
+                pCallbackParam->u.message.topicFilterLength = pSubscription->topicFilterLength;
 
-        /* Decrement the reference count. It must still be positive. */
-        ( pSubscription->references )--;
-        IotMqtt_Assert( pSubscription->references >= 0 );
+                /* Invoke the subscription callback. */
+                callbackFunction( pCallbackContext, pCallbackParam );
 
-        /* Save the pointer to the next link in case this subscription is freed. */
-        pNextLink = pCurrentLink->pNext;
+                /* Lock the subscription list mutex to decrement the reference count. */
+                IotMutex_Lock( &( pMqttConnection->subscriptionMutex ) );
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
 
-        /* Remove this subscription if it has no references and the unsubscribed
-         * flag is set. */
-        if( pSubscription->unsubscribed == true )
-        {
-            /* An unsubscribed subscription should have been removed from the list. */
-            IotMqtt_Assert( IotLink_IsLinked( &( pSubscription->link ) ) == false );
+            /* Decrement the reference count. It must still be positive. */
+            ( pSubscription->references )--;
+            IotMqtt_Assert( pSubscription->references >= 0 );
 
-            /* Free subscriptions with no references. */
-            if( pSubscription->references == 0 )
+            /* Remove this subscription if it has no references and the unsubscribed
+             * flag is set. */
+            if( pSubscription->unsubscribed == true )
             {
-                IotMqtt_FreeSubscription( pSubscription );
+                /* An unsubscribed subscription should have been removed from the list. */
+                IotMqtt_Assert( IotLink_IsLinked( &( pSubscription->link ) ) == false );
+
+                /* Free subscriptions with no references. */
+                if( pSubscription->references == 0 )
+                {
+                    IotMqtt_FreeSubscription( pSubscription );
+                }
+                else
+                {
+                    EMPTY_ELSE_MARKER;
+                }
             }
             else
             {
                 EMPTY_ELSE_MARKER;
             }
         }
-        else
-        {
-            EMPTY_ELSE_MARKER;
-        }
-
-        /* Move current link pointer. */
-        pCurrentLink = pNextLink;
-    }
+    } while( matches.total > ( matches.skip + matches.count ) );
 
     IotMutex_Unlock( &( pMqttConnection->subscriptionMutex ) );
 
@@ -508,6 +1211,8 @@ void _IotMqtt_RemoveSubscriptionByPacket( _mqttConnection_t * pMqttConnection,
                                           uint16_t packetIdentifier,
                                           int32_t order )
 {
+    _mqttSubscription_t * pSubscription = NULL;
+    IotLink_t * pSubscriptionLink = NULL;
     const _packetMatchParams_t packetMatchParams =
     {
         .packetIdentifier = packetIdentifier,
@@ -515,6 +1220,23 @@ void _IotMqtt_RemoveSubscriptionByPacket( _mqttConnection_t * pMqttConnection,
     };
 
     IotMutex_Lock( &( pMqttConnection->subscriptionMutex ) );
+
+    /* Remove the topic filters of the packet from the index first. */
+    IotContainers_ForEach( &( pMqttConnection->subscriptionList ), pSubscriptionLink )
+    {
+        pSubscription = IotLink_Container( _mqttSubscription_t, pSubscriptionLink, link );
+
+        if( ( pSubscription->packetInfo.identifier == packetIdentifier ) &&
+            ( ( order == -1 ) || ( ( size_t ) order == pSubscription->packetInfo.order ) ) )
+        {
+            _indexRemove( &( pMqttConnection->topicIndex ), pSubscription );
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+    }
+
     IotListDouble_RemoveAllMatches( &( pMqttConnection->subscriptionList ),
                                     _packetMatch,
                                     ( void * ) ( &packetMatchParams ),
@@ -557,7 +1279,8 @@ void _IotMqtt_RemoveSubscriptionByTopicFilter( _mqttConnection_t * pMqttConnecti
             /* Reference count must not be negative. */
             IotMqtt_Assert( pSubscription->references >= 0 );
 
-            /* Remove subscription from list. */
+            /* Remove subscription from the index and the list. */
+            _indexRemove( &( pMqttConnection->topicIndex ), pSubscription );
             IotListDouble_Remove( pSubscriptionLink );
 
             /* Check the reference count. This subscription cannot be removed if
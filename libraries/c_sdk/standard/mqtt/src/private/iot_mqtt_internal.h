@@ -76,6 +76,25 @@
 #define LIBRARY_LOG_NAME    ( "MQTT" )
 #include "iot_logging_setup.h"
 
+/**
+ * @def IotMqtt_TraceBegin()
+ * @brief Timestamp of the start of a traced stage.
+ *
+ * @def IotMqtt_TraceEnd( stage, start )
+ * @brief Record the latency of a stage started at `start`. `stage` is
+ * `MQTT_SERIALIZE` (PUBLISH serialization) or `MQTT_PUBACK` (PUBLISH sent to
+ * PUBACK received).
+ *
+ * Define both in iot_config.h to measure the latency of the PUBLISH path.
+ * They do nothing by default.
+ */
+#ifndef IotMqtt_TraceBegin
+    #define IotMqtt_TraceBegin()                ( 0U )
+#endif
+#ifndef IotMqtt_TraceEnd
+    #define IotMqtt_TraceEnd( stage, start )    ( ( void ) ( start ) )
+#endif
+
 /*
  * Provide default values for undefined memory allocation functions based on
  * the usage of dynamic memory allocation.
@@ -192,6 +211,18 @@
 #ifndef IOT_MQTT_RETRY_MS_CEILING
     #define IOT_MQTT_RETRY_MS_CEILING               ( 60000 )
 #endif
+#ifndef IOT_MQTT_TOPIC_INDEX_NODES
+    #define IOT_MQTT_TOPIC_INDEX_NODES              ( 64 )
+#endif
+#ifndef IOT_MQTT_TOPIC_INDEX_LEVELS_SIZE
+    #define IOT_MQTT_TOPIC_INDEX_LEVELS_SIZE        ( 512 )
+#endif
+#ifndef IOT_MQTT_TOPIC_INDEX_MATCHES
+    #define IOT_MQTT_TOPIC_INDEX_MATCHES            ( 8 )
+#endif
+#ifndef IOT_MQTT_PENDING_TABLE_SIZE
+    #define IOT_MQTT_PENDING_TABLE_SIZE             ( 64 )
+#endif
 /** @endcond */
 
 /**
@@ -245,8 +276,78 @@
  */
 #define MQTT_REMAINING_LENGTH_INVALID                          ( ( size_t ) 268435456 )
 
+/**
+ * @brief The largest fixed header: packet type and a 4-byte remaining length.
+ */
+#define MQTT_FIXED_HEADER_MAX_SIZE                             ( ( size_t ) 5U )
+
 /*---------------------- MQTT internal data structures ----------------------*/
 
+/* Forward declaration of the subscription referenced by the topic index. */
+struct _mqttSubscription;
+
+/* Forward declaration of the operation referenced by the pending table. */
+struct _mqttOperation;
+
+/**
+ * @brief One level of the topic filters held by a #_mqttTopicIndex_t.
+ *
+ * Nodes refer to each other by their index in #_mqttTopicIndex_t.nodes. Node
+ * 0 is the root, above the first level of every filter, so 0 also stands for
+ * "no node".
+ */
+typedef struct _mqttTopicNode
+{
+    struct _mqttSubscription * pSubscription; /**< @brief Subscription whose filter ends at this level. */
+    struct _mqttSubscription * pMultiLevel;   /**< @brief Subscription whose filter is this level followed by "#". */
+    uint16_t levelOffset;                     /**< @brief Offset of the level in #_mqttTopicIndex_t.pLevels. */
+    uint16_t levelLength;                     /**< @brief Length of the level, UINT16_MAX for a free node. */
+    uint16_t parent;                          /**< @brief Node of the previous level. */
+    uint16_t firstChild;                      /**< @brief First node of the next level, other than "+". */
+    uint16_t nextSibling;                     /**< @brief Next child of the parent, or next free node. */
+    uint16_t singleLevel;                     /**< @brief Node of a "+" next level. */
+} _mqttTopicNode_t;
+
+/**
+ * @brief Trie of the topic filters of a connection, one node per filter level.
+ *
+ * An incoming PUBLISH follows its topic levels down the trie instead of being
+ * compared with every subscription. The level strings are interned in
+ * #_mqttTopicIndex_t.pLevels: a level repeated in several filters, such as
+ * "shadow" or "accepted", is stored once. Subscriptions that do not fit are
+ * matched by scanning the subscription list.
+ *
+ * An index cleared to zero is empty.
+ */
+typedef struct _mqttTopicIndex
+{
+    _mqttTopicNode_t nodes[ IOT_MQTT_TOPIC_INDEX_NODES ]; /**< @brief Node 0 is the root. */
+    char pLevels[ IOT_MQTT_TOPIC_INDEX_LEVELS_SIZE ];     /**< @brief Level strings. */
+    uint16_t nodesUsed;                                   /**< @brief Highest node index ever allocated. */
+    uint16_t freeNode;                                    /**< @brief First free node below nodesUsed, 0 for none. */
+    uint16_t levelsUsed;                                  /**< @brief Bytes of pLevels in use. */
+    uint16_t overflowCount;                               /**< @brief Subscriptions left out of the index. */
+} _mqttTopicIndex_t;
+
+/**
+ * @brief Operations awaiting a server response, by packet identifier.
+ *
+ * An open-addressed table with linear probing, so that an acknowledgement
+ * finds its operation in a few probes instead of a scan of
+ * #_mqttConnection_t.pendingResponse. The list still holds every operation
+ * awaiting a response; the operations that do not fit in the table are found
+ * by scanning it. Operations without a packet identifier are never in the
+ * table.
+ *
+ * A table cleared to zero is empty.
+ */
+typedef struct _mqttPendingTable
+{
+    struct _mqttOperation * pSlots[ IOT_MQTT_PENDING_TABLE_SIZE ]; /**< @brief `NULL` for a free slot. */
+    uint16_t count;                                                /**< @brief Slots in use. */
+    uint16_t overflowCount;                                        /**< @brief Operations with a packet identifier left out of the table. */
+} _mqttPendingTable_t;
+
 /**
  * @brief Represents an MQTT connection.
  */
@@ -267,9 +368,11 @@ typedef struct _mqttConnection
     int32_t references;                          /**< @brief Counts callbacks and operations using this connection. */
     IotListDouble_t pendingProcessing;           /**< @brief List of operations waiting to be processed by a task pool routine. */
     IotListDouble_t pendingResponse;             /**< @brief List of processed operations awaiting a server response. */
+    _mqttPendingTable_t pendingTable;            /**< @brief Index of pendingResponse by packet identifier. */
 
     IotListDouble_t subscriptionList;            /**< @brief Holds subscriptions associated with this connection. */
-    IotMutex_t subscriptionMutex;                /**< @brief Grants exclusive access to the subscription list. */
+    IotMutex_t subscriptionMutex;                /**< @brief Grants exclusive access to the subscription list and index. */
+    _mqttTopicIndex_t topicIndex;                /**< @brief Index of the topic filters of the subscription list. */
 
     bool keepAliveFailure;                       /**< @brief Failure flag for keep-alive operation. */
     uint32_t keepAliveMs;                        /**< @brief Keep-alive interval in milliseconds. Its max value (per spec) is 65,535,000. */
@@ -300,6 +403,9 @@ typedef struct _mqttSubscription
      */
     bool unsubscribed;
 
+    bool indexed;  /**< @brief Whether the topic filter is in the topic index of the connection. */
+    bool overflow; /**< @brief The topic index was full when this subscription was added. */
+
     struct
     {
         uint16_t identifier;        /**< @brief Packet identifier. */
@@ -359,6 +465,11 @@ typedef struct _mqttOperation
                 uint32_t limit;
                 uint32_t nextPeriod;
             } retry;
+
+            uint32_t traceStart; /**< @brief Timestamp of the first transmission, see IotMqtt_TraceBegin(). */
+
+            bool indexed;        /**< @brief Whether this operation is in the pending table of its connection. */
+            bool overflow;       /**< @brief Whether this operation awaits a response but did not fit in the pending table. */
         } operation;
 
         /* If incomingPublish is true, this struct is valid. */
@@ -477,6 +588,23 @@ uint8_t _IotMqtt_GetPacketType( void * pNetworkConnection,
 size_t _IotMqtt_GetRemainingLength( void * pNetworkConnection,
                                     const IotNetworkInterface_t * pNetworkInterface );
 
+/**
+ * @brief Parse the fixed header of an incoming packet in place.
+ *
+ * @param[in] pBuffer The first bytes of the packet.
+ * @param[in] bufferLength The number of bytes available at `pBuffer`.
+ * @param[out] pPacketType Set to the packet type.
+ * @param[out] pRemainingLength Set to the remaining length;
+ * #MQTT_REMAINING_LENGTH_INVALID if the header is malformed.
+ *
+ * @return The size of the fixed header; `0` if `pBuffer` ends before the
+ * fixed header does.
+ */
+size_t _IotMqtt_ParseFixedHeader( const uint8_t * pBuffer,
+                                  size_t bufferLength,
+                                  uint8_t * pPacketType,
+                                  size_t * pRemainingLength );
+
 /**
  * @brief Generate a CONNECT packet from the given parameters.
  *
@@ -782,6 +910,14 @@ IotMqttError_t _IotMqtt_ScheduleOperation( _mqttOperation_t * pOperation,
                                            IotTaskPoolRoutine_t jobRoutine,
                                            uint32_t delay );
 
+/**
+ * @brief Empty the pending table of a connection, before the list of operations
+ * pending responses is emptied.
+ *
+ * @param[in] pMqttConnection The connection. Its references mutex must be held.
+ */
+void _IotMqtt_ResetPendingTable( _mqttConnection_t * pMqttConnection );
+
 /**
  * @brief Search a list of MQTT operations pending responses using an operation
  * name and packet identifier. Removes a matching operation from the list if found.
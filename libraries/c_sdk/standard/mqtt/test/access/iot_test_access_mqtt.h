@@ -43,6 +43,16 @@ _mqttConnection_t * IotTestMqtt_createMqttConnection( bool awsIotMqttMode,
                                                       const IotMqttNetworkInfo_t * pNetworkInfo,
                                                       uint16_t keepAliveSeconds );
 
+/*------------------------- iot_mqtt_operation.c ------------------------*/
+
+/**
+ * @brief Test access function for #_pendingIndex.
+ *
+ * @see #_pendingIndex.
+ */
+void IotTestMqtt_pendingIndex( _mqttPendingTable_t * pTable,
+                               _mqttOperation_t * pOperation );
+
 /*------------------------- iot_mqtt_serialize.c ------------------------*/
 
 /*
@@ -286,13 +286,20 @@ static IotMqttError_t _deserializePingresp( _mqttPacket_t * pPingresp )
 
 /**
  * @brief Reset the status of an #_mqttOperation_t and push it to the list of
- * MQTT operations awaiting network response.
+ * MQTT operations awaiting network response, and into the pending table.
  */
 static void _operationResetAndPush( _mqttOperation_t * pOperation )
 {
     pOperation->u.operation.status = IOT_MQTT_STATUS_PENDING;
     pOperation->u.operation.jobReference = 1;
     IotListDouble_InsertHead( &( _pMqttConnection->pendingResponse ), &( pOperation->link ) );
+
+    /* Index the operation by packet identifier, as the send path does. */
+    if( ( pOperation->u.operation.indexed == false ) &&
+        ( pOperation->u.operation.overflow == false ) )
+    {
+        IotTestMqtt_pendingIndex( &( _pMqttConnection->pendingTable ), pOperation );
+    }
 }
 
 /*-----------------------------------------------------------*/
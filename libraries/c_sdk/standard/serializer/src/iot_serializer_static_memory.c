@@ -37,6 +37,9 @@
 /* Static memory include. */
     #include "private/iot_static_memory.h"
 
+/* Slab allocator include. */
+    #include "private/iot_slab.h"
+
 /* Metrics include. */
     #include "iot_serializer.h"
 
@@ -90,34 +93,42 @@
 /*
  * Static memory buffers and flags, allocated and zeroed at compile-time.
  */
-    static bool _inUseCborEncoders[ IOT_SERIALIZER_CBOR_ENCODERS ] = { 0 };
-    static CborEncoder _cborEncoders[ IOT_SERIALIZER_CBOR_ENCODERS ] = { { .data = { 0 } } };
+    #if IOT_SLAB_ALLOCATOR == 0
+        static bool _inUseCborEncoders[ IOT_SERIALIZER_CBOR_ENCODERS ] = { 0 };
+        static CborEncoder _cborEncoders[ IOT_SERIALIZER_CBOR_ENCODERS ] = { { .data = { 0 } } };
 
-    static bool _inUseCborParsers[ IOT_SERIALIZER_CBOR_PARSERS ] = { 0 };
-    static CborParser _cborParsers[ IOT_SERIALIZER_CBOR_PARSERS ] = { { 0 } };
+        static bool _inUseCborParsers[ IOT_SERIALIZER_CBOR_PARSERS ] = { 0 };
+        static CborParser _cborParsers[ IOT_SERIALIZER_CBOR_PARSERS ] = { { 0 } };
 
-    static bool _inUseCborValues[ IOT_SERIALIZER_CBOR_VALUES ] = { 0 };
-    static _cborValueWrapper_t _cborValues[ IOT_SERIALIZER_CBOR_VALUES ] = { { .isOutermost = false } };
+        static bool _inUseCborValues[ IOT_SERIALIZER_CBOR_VALUES ] = { 0 };
+        static _cborValueWrapper_t _cborValues[ IOT_SERIALIZER_CBOR_VALUES ] = { { .isOutermost = false } };
 
-    static bool _inUseDecoderObjects[ IOT_SERIALIZER_DECODER_OBJECTS ] = { 0 };
-    static IotSerializerDecoderObject_t _decoderObjects[ IOT_SERIALIZER_DECODER_OBJECTS ] = { { 0 } };
+        static bool _inUseDecoderObjects[ IOT_SERIALIZER_DECODER_OBJECTS ] = { 0 };
+        static IotSerializerDecoderObject_t _decoderObjects[ IOT_SERIALIZER_DECODER_OBJECTS ] = { { 0 } };
+    #endif
 
 /*-----------------------------------------------------------*/
 
     void * IotSerializer_MallocCborEncoder( size_t size )
     {
-        int32_t freeIndex = -1;
+        #if IOT_SLAB_ALLOCATOR == 0
+            int32_t freeIndex = -1;
+        #endif
         void * pNewCborEncoder = NULL;
 
         if( size == sizeof( CborEncoder ) )
         {
-            freeIndex = IotStaticMemory_FindFree( _inUseCborEncoders,
-                                                  IOT_SERIALIZER_CBOR_ENCODERS );
-
-            if( freeIndex != -1 )
-            {
-                pNewCborEncoder = &( _cborEncoders[ freeIndex ] );
-            }
+            #if IOT_SLAB_ALLOCATOR == 1
+                pNewCborEncoder = IotSlab_Malloc( size );
+            #else
+                freeIndex = IotStaticMemory_FindFree( _inUseCborEncoders,
+                                                      IOT_SERIALIZER_CBOR_ENCODERS );
+
+                if( freeIndex != -1 )
+                {
+                    pNewCborEncoder = &( _cborEncoders[ freeIndex ] );
+                }
+            #endif
         }
 
         return pNewCborEncoder;
@@ -127,29 +138,39 @@
 
     void IotSerializer_FreeCborEncoder( void * ptr )
     {
-        IotStaticMemory_ReturnInUse( ptr,
-                                     _cborEncoders,
-                                     _inUseCborEncoders,
-                                     IOT_SERIALIZER_CBOR_ENCODERS,
-                                     sizeof( CborEncoder ) );
+        #if IOT_SLAB_ALLOCATOR == 1
+            IotSlab_Free( ptr );
+        #else
+            IotStaticMemory_ReturnInUse( ptr,
+                                         _cborEncoders,
+                                         _inUseCborEncoders,
+                                         IOT_SERIALIZER_CBOR_ENCODERS,
+                                         sizeof( CborEncoder ) );
+        #endif
     }
 
 /*-----------------------------------------------------------*/
 
     void * IotSerializer_MallocCborParser( size_t size )
     {
-        int32_t freeIndex = -1;
+        #if IOT_SLAB_ALLOCATOR == 0
+            int32_t freeIndex = -1;
+        #endif
         void * pNewCborParser = NULL;
 
         if( size == sizeof( CborParser ) )
         {
-            freeIndex = IotStaticMemory_FindFree( _inUseCborParsers,
-                                                  IOT_SERIALIZER_CBOR_PARSERS );
-
-            if( freeIndex != -1 )
-            {
-                pNewCborParser = &( _cborParsers[ freeIndex ] );
-            }
+            #if IOT_SLAB_ALLOCATOR == 1
+                pNewCborParser = IotSlab_Malloc( size );
+            #else
+                freeIndex = IotStaticMemory_FindFree( _inUseCborParsers,
+                                                      IOT_SERIALIZER_CBOR_PARSERS );
+
+                if( freeIndex != -1 )
+                {
+                    pNewCborParser = &( _cborParsers[ freeIndex ] );
+                }
+            #endif
         }
 
         return pNewCborParser;
@@ -159,29 +180,39 @@
 
     void IotSerializer_FreeCborParser( void * ptr )
     {
-        IotStaticMemory_ReturnInUse( ptr,
-                                     _cborParsers,
-                                     _inUseCborParsers,
-                                     IOT_SERIALIZER_CBOR_PARSERS,
-                                     sizeof( CborParser ) );
+        #if IOT_SLAB_ALLOCATOR == 1
+            IotSlab_Free( ptr );
+        #else
+            IotStaticMemory_ReturnInUse( ptr,
+                                         _cborParsers,
+                                         _inUseCborParsers,
+                                         IOT_SERIALIZER_CBOR_PARSERS,
+                                         sizeof( CborParser ) );
+        #endif
     }
 
 /*-----------------------------------------------------------*/
 
     void * IotSerializer_MallocCborValue( size_t size )
     {
-        int32_t freeIndex = -1;
+        #if IOT_SLAB_ALLOCATOR == 0
+            int32_t freeIndex = -1;
+        #endif
         void * pNewCborValue = NULL;
 
         if( size == sizeof( _cborValueWrapper_t ) )
         {
-            freeIndex = IotStaticMemory_FindFree( _inUseCborValues,
-                                                  IOT_SERIALIZER_CBOR_VALUES );
-
-            if( freeIndex != -1 )
-            {
-                pNewCborValue = &( _cborValues[ freeIndex ] );
-            }
+            #if IOT_SLAB_ALLOCATOR == 1
+                pNewCborValue = IotSlab_Malloc( size );
+            #else
+                freeIndex = IotStaticMemory_FindFree( _inUseCborValues,
+                                                      IOT_SERIALIZER_CBOR_VALUES );
+
+                if( freeIndex != -1 )
+                {
+                    pNewCborValue = &( _cborValues[ freeIndex ] );
+                }
+            #endif
         }
 
         return pNewCborValue;
@@ -191,29 +222,39 @@
 
     void IotSerializer_FreeCborValue( void * ptr )
     {
-        IotStaticMemory_ReturnInUse( ptr,
-                                     _cborValues,
-                                     _inUseCborValues,
-                                     IOT_SERIALIZER_CBOR_VALUES,
-                                     sizeof( _cborValueWrapper_t ) );
+        #if IOT_SLAB_ALLOCATOR == 1
+            IotSlab_Free( ptr );
+        #else
+            IotStaticMemory_ReturnInUse( ptr,
+                                         _cborValues,
+                                         _inUseCborValues,
+                                         IOT_SERIALIZER_CBOR_VALUES,
+                                         sizeof( _cborValueWrapper_t ) );
+        #endif
     }
 
 /*-----------------------------------------------------------*/
 
     void * IotSerializer_MallocDecoderObject( size_t size )
     {
-        int32_t freeIndex = -1;
+        #if IOT_SLAB_ALLOCATOR == 0
+            int32_t freeIndex = -1;
+        #endif
         void * pNewDecoderObject = NULL;
 
         if( size == sizeof( IotSerializerDecoderObject_t ) )
         {
-            freeIndex = IotStaticMemory_FindFree( _inUseDecoderObjects,
-                                                  IOT_SERIALIZER_DECODER_OBJECTS );
-
-            if( freeIndex != -1 )
-            {
-                pNewDecoderObject = &( _decoderObjects[ freeIndex ] );
-            }
+            #if IOT_SLAB_ALLOCATOR == 1
+                pNewDecoderObject = IotSlab_Malloc( size );
+            #else
+                freeIndex = IotStaticMemory_FindFree( _inUseDecoderObjects,
+                                                      IOT_SERIALIZER_DECODER_OBJECTS );
+
+                if( freeIndex != -1 )
+                {
+                    pNewDecoderObject = &( _decoderObjects[ freeIndex ] );
+                }
+            #endif
         }
 
         return pNewDecoderObject;
@@ -223,11 +264,15 @@
 
     void IotSerializer_FreeDecoderObject( void * ptr )
     {
-        IotStaticMemory_ReturnInUse( ptr,
-                                     _decoderObjects,
-                                     _inUseDecoderObjects,
-                                     IOT_SERIALIZER_DECODER_OBJECTS,
-                                     sizeof( IotSerializerDecoderObject_t ) );
+        #if IOT_SLAB_ALLOCATOR == 1
+            IotSlab_Free( ptr );
+        #else
+            IotStaticMemory_ReturnInUse( ptr,
+                                         _decoderObjects,
+                                         _inUseDecoderObjects,
+                                         IOT_SERIALIZER_DECODER_OBJECTS,
+                                         sizeof( IotSerializerDecoderObject_t ) );
+        #endif
     }
 
 #endif /* if IOT_STATIC_MEMORY_ONLY == 1 */
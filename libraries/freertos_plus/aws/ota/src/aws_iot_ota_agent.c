@@ -98,13 +98,19 @@ typedef union MultiParmPtr
     void ** ppvPtr;
 } MultiParmPtr_t;
 
-/* Array containing pointer to the OTA event structures used to send events to the OTA task. */
+/* Ring of the events sent to the OTA task, and its slots. */
 
-static OTA_EventMsg_t xQueueData[ OTA_NUM_MSG_Q_ENTRIES ];
+static OTA_EventRing_t xEventRing;
+static OTA_EventRingSlot_t xEventRingSlots[ OTA_NUM_MSG_Q_ENTRIES ];
 
-/* Buffers used to push event data. */
+/* Buffers used to push event data, allocated from the slab. */
 
 static OTA_EventData_t xEventBuffer[ otaconfigMAX_NUM_OTA_DATA_BUFFERS ];
+static OTA_EventSlab_t xEventSlab;
+
+/* The OTA task, woken up by the events sent while it waits. */
+
+static TaskHandle_t xOTA_TaskHandle = NULL;
 
 /* OTA control interface. */
 
@@ -247,6 +253,10 @@ static OTA_Err_t prvResetDevice( void );
 
 static bool_t prvInSelftest( void );
 
+/* Take the next event of the ring, or wait for one. */
+
+static BaseType_t prvOTAEventReceive( OTA_EventMsg_t * const pxEventMsg );
+
 /* OTA state event handler functions. */
 
 static OTA_Err_t prvStartHandler( OTA_EventData_t * pxEventData );
@@ -289,12 +299,11 @@ static OTA_AgentContext_t xOTA_Agent =
     .pcClientTokenFromJob          = NULL,
     .pvSelfTestTimer               = NULL,
     .xRequestTimer                 = NULL,
-    .xOTA_EventQueue               = NULL,
+    .pxOTA_EventRing               = NULL,
     .eImageState                   = eOTA_ImageState_Unknown,
     .xPALCallbacks                 = OTA_JOB_CALLBACK_DEFAULT_INITIALIZER,
-    .ulNumOfBlocksToReceive        = 1,
+    .xWindow                       = { 0 },
     .xStatistics                   = { 0 },
-    .xOTA_ThreadSafetyMutex        = NULL,
     .ulRequestMomentum             = 0
 };
 
@@ -459,6 +468,12 @@ static void prvRequestTimer_Callback( TimerHandle_t T )
     OTA_SignalEvent( &xEventMsg );
 }
 
+/* Time base of the block request window. */
+static uint32_t prvGetTimeMs( void )
+{
+    return ( uint32_t ) ( xTaskGetTickCount() * portTICK_PERIOD_MS );
+}
+
 /* Create and start or reset the OTA request timer to kick off the process if needed.
  * Do not output an important log message on reset since this gets called every time a file
  * block is received. Use log level 2 at most.
@@ -927,6 +942,14 @@ static OTA_Err_t prvInitFileHandler( OTA_EventData_t * pxEventData )
         /* Reset the request momentum. */
         xOTA_Agent.ulRequestMomentum = 0;
 
+        /* Start the block request window of the file. */
+        OTA_WindowInit( &xOTA_Agent.xWindow,
+                        xOTA_Agent.pxOTA_Files[ xOTA_Agent.ulFileIndex ].ulFileSize,
+                        otaconfigLOG2_FILE_BLOCK_SIZE,
+                        otaconfigLOG2_MAX_FILE_BLOCK_SIZE,
+                        otaconfigMAX_BLOCKS_IN_FLIGHT,
+                        otaconfigFILE_REQUEST_WAIT_MS );
+
         xEventMsg.xEventId = eOTA_AgentEvent_RequestFileBlock;
         OTA_SignalEvent( &xEventMsg );
     }
@@ -942,8 +965,8 @@ static OTA_Err_t prvRequestDataHandler( OTA_EventData_t * pxEventData )
 
     if( xOTA_Agent.pxOTA_Files[ xOTA_Agent.ulFileIndex ].ulBlocksRemaining > 0U )
     {
-        /* Start the request timer. */
-        prvStartRequestTimer( otaconfigFILE_REQUEST_WAIT_MS );
+        /* Start the request timer, it expires the requests of the window still unanswered. */
+        prvStartRequestTimer( OTA_WindowTimeoutMs( &xOTA_Agent.xWindow ) );
 
         if( xOTA_Agent.ulRequestMomentum < otaconfigMAX_NUM_REQUEST_MOMENTUM )
         {
@@ -1053,17 +1076,11 @@ static OTA_Err_t prvProcessDataHandler( OTA_EventData_t * pxEventData )
             xOTA_ControlInterface.prvUpdateJobStatus( &xOTA_Agent, eJobStatus_InProgress, ( int32_t ) eJobReason_Receiving, ( int32_t ) NULL );
         }
 
-        if( xOTA_Agent.ulNumOfBlocksToReceive > 1 )
-        {
-            xOTA_Agent.ulNumOfBlocksToReceive--;
-        }
-        else
-        {
-            prvStartRequestTimer( otaconfigFILE_REQUEST_WAIT_MS );
+        /* Each block received makes room in the request window, keep it full. */
+        prvStartRequestTimer( OTA_WindowTimeoutMs( &xOTA_Agent.xWindow ) );
 
-            xEventMsg.xEventId = eOTA_AgentEvent_RequestFileBlock;
-            OTA_SignalEvent( &xEventMsg );
-        }
+        xEventMsg.xEventId = eOTA_AgentEvent_RequestFileBlock;
+        OTA_SignalEvent( &xEventMsg );
     }
 
     /* Release the data buffer. */
@@ -1156,45 +1173,51 @@ void prvOTAEventBufferFree( OTA_EventData_t * const pxBuffer )
 {
     DEFINE_OTA_METHOD_NAME( "prvOTAEventBufferFree" );
 
-    if( xSemaphoreTake( xOTA_Agent.xOTA_ThreadSafetyMutex, portMAX_DELAY ) == pdPASS )
-    {
-        pxBuffer->bBufferUsed = false;
-        xSemaphoreGive( xOTA_Agent.xOTA_ThreadSafetyMutex );
-    }
-    else
-    {
-        OTA_LOG_L1( "Error: Could not take semaphore for freeing message buffer.\r\n" );
-    }
+    OTA_EventSlabFree( &xEventSlab, ( uint32_t ) ( pxBuffer - xEventBuffer ) );
 }
 
 OTA_EventData_t * prvOTAEventBufferGet( void )
 {
     DEFINE_OTA_METHOD_NAME( "prvOTAEventBufferGet" );
 
-    uint32_t ulIndex = 0;
+    int32_t lIndex = OTA_EventSlabAlloc( &xEventSlab );
     OTA_EventData_t * pxOTAFreeMsg = NULL;
 
-    /* Wait at most 1 task switch for a buffer so as not to block the callback. */
-    if( xSemaphoreTake( xOTA_Agent.xOTA_ThreadSafetyMutex, 1 ) == pdPASS )
+    /* The slab never waits, the callbacks are not blocked. */
+    if( lIndex >= 0 )
     {
-        for( ulIndex = 0; ulIndex < otaconfigMAX_NUM_OTA_DATA_BUFFERS; ulIndex++ )
-        {
-            if( xEventBuffer[ ulIndex ].bBufferUsed == false )
-            {
-                xEventBuffer[ ulIndex ].bBufferUsed = true;
-                pxOTAFreeMsg = &xEventBuffer[ ulIndex ];
-                break;
-            }
-        }
+        pxOTAFreeMsg = &xEventBuffer[ lIndex ];
+    }
+
+    return pxOTAFreeMsg;
+}
+
+/*
+ * Take the next event of the ring. If there is none, wait until an event is
+ * sent and return pdFALSE; the caller tries again.
+ */
+static BaseType_t prvOTAEventReceive( OTA_EventMsg_t * const pxEventMsg )
+{
+    BaseType_t xReceived = pdFALSE;
+    uint32_t ulEventId = 0;
+    void * pvEventData = NULL;
 
-        xSemaphoreGive( xOTA_Agent.xOTA_ThreadSafetyMutex );
+    if( OTA_EventRingPop( &xEventRing, &ulEventId, &pvEventData ) == true )
+    {
+        pxEventMsg->xEventId = ( OTA_Event_t ) ulEventId;
+        pxEventMsg->pxEventData = ( OTA_EventData_t * ) pvEventData;
+        xReceived = pdTRUE;
+    }
+    else if( OTA_EventRingPrepareWait( &xEventRing ) == true )
+    {
+        ( void ) ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
     }
     else
     {
-        OTA_LOG_L1( "Error: Could not take semaphore for getting message buffer.\r\n" );
+        /* An event arrived meanwhile. */
     }
 
-    return pxOTAFreeMsg;
+    return xReceived;
 }
 
 static void prvOTA_FreeContext( OTA_FileContext_t * const C )
@@ -2139,7 +2162,7 @@ static IngestResult_t prvIngestDataBlock( OTA_FileContext_t * C,
             if( C->pucRxBlockBitmap && ( C->ulBlocksRemaining > 0U ) )
             {
                 /* Reset or start the firmware request timer. */
-                prvStartRequestTimer( otaconfigFILE_REQUEST_WAIT_MS );
+                prvStartRequestTimer( OTA_WindowTimeoutMs( &xOTA_Agent.xWindow ) );
 
                 /* Decode the file block received. */
                 if( kOTA_Err_None != xOTA_DataInterface.prvDecodeFileBlock(
@@ -2155,102 +2178,120 @@ static IngestResult_t prvIngestDataBlock( OTA_FileContext_t * C,
                 }
                 else
                 {
-                    /* Validate the block index and size. */
-                    /* If it is NOT the last block, it MUST be equal to a full block size. */
-                    /* If it IS the last block, it MUST be equal to the expected remainder. */
-                    /* If the block ID is out of range, that's an error so abort. */
-                    uint32_t iLastBlock = ( ( C->ulFileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE ) - 1U;
-
-                    if( ( ( ulBlockIndex < iLastBlock ) && ( ulBlockSize == OTA_FILE_BLOCK_SIZE ) ) ||
-                        ( ( ulBlockIndex == iLastBlock ) && ( ulBlockSize == ( C->ulFileSize - ( iLastBlock * OTA_FILE_BLOCK_SIZE ) ) ) ) )
+                    /* Validate the block index and size. A block requested with a larger block
+                     * size than the file block size carries several consecutive file blocks.
+                     * If the block ID is out of range, that's an error so abort. */
+                    uint32_t ulFirst = 0;
+                    uint32_t ulCount = 0;
+
+                    if( OTA_WindowBlockRange( &xOTA_Agent.xWindow, ulBlockIndex, ulBlockSize, &ulFirst, &ulCount ) == true )
                     {
                         OTA_LOG_L1( "[%s] Received file block %u, size %u\r\n", OTA_METHOD_NAME, ulBlockIndex, ulBlockSize );
 
-                        /* Create bit mask for use in our bitmap. */
-                        uint8_t ulBitMask = 1U << ( ulBlockIndex % BITS_PER_BYTE ); /*lint !e9031 The composite expression will never be greater than BITS_PER_BYTE(8). */
-                        /* Calculate byte offset into bitmap. */
-                        uint32_t ulByte = ulBlockIndex >> LOG2_BITS_PER_BYTE;
+                        /* Let the request window measure the round trip, even for a duplicate. */
+                        OTA_WindowReceived( &xOTA_Agent.xWindow, ulFirst, ulCount, prvGetTimeMs() );
 
-                        if( ( C->pucRxBlockBitmap[ ulByte ] & ulBitMask ) == 0U ) /* If we've already received this block... */
-                        {
-                            OTA_LOG_L1( "[%s] block %u is a DUPLICATE. %u blocks remaining.\r\n", OTA_METHOD_NAME,
-                                        ulBlockIndex,
-                                        C->ulBlocksRemaining );
-                            eIngestResult = eIngest_Result_Duplicate_Continue;
-                            *pxCloseResult = kOTA_Err_None; /* This is a success path. */
-                        }
-                        else /* Otherwise, process it normally... */
+                        eIngestResult = eIngest_Result_Duplicate_Continue;
+                        *pxCloseResult = kOTA_Err_None; /* This is a success path. */
+
+                        for( uint32_t ulBlock = ulFirst;
+                             ( ulBlock < ( ulFirst + ulCount ) ) && ( eIngestResult >= eIngest_Result_Accepted_Continue );
+                             ulBlock++ )
                         {
-                            if( C->pucFile != NULL )
+                            /* Create bit mask for use in our bitmap. */
+                            uint8_t ulBitMask = 1U << ( ulBlock % BITS_PER_BYTE ); /*lint !e9031 The composite expression will never be greater than BITS_PER_BYTE(8). */
+                            /* Calculate byte offset into bitmap. */
+                            uint32_t ulByte = ulBlock >> LOG2_BITS_PER_BYTE;
+                            /* Offset of this file block in the payload. */
+                            uint32_t ulPayloadOffset = ( ulBlock - ulFirst ) * OTA_FILE_BLOCK_SIZE;
+                            uint32_t ulLength = ulBlockSize - ulPayloadOffset;
+
+                            if( ulLength > OTA_FILE_BLOCK_SIZE )
+                            {
+                                ulLength = OTA_FILE_BLOCK_SIZE;
+                            }
+
+                            if( ( C->pucRxBlockBitmap[ ulByte ] & ulBitMask ) == 0U ) /* If we've already received this block... */
                             {
-                                int32_t iBytesWritten = xOTA_Agent.xPALCallbacks.xWriteBlock( C, ( ulBlockIndex * OTA_FILE_BLOCK_SIZE ), pucPayload, ulBlockSize );
+                                /* Skip it, another block of the message may be new. */
+                            }
+                            else if( C->pucFile != NULL )
+                            {
+                                int32_t iBytesWritten = xOTA_Agent.xPALCallbacks.xWriteBlock( C, ( ulBlock * OTA_FILE_BLOCK_SIZE ), &pucPayload[ ulPayloadOffset ], ulLength );
 
                                 if( iBytesWritten < 0 )
                                 {
                                     OTA_LOG_L1( "[%s] Error (%d) writing file block\r\n", OTA_METHOD_NAME, iBytesWritten );
                                     eIngestResult = eIngest_Result_WriteBlockFailed;
+                                    *pxCloseResult = kOTA_Err_GenericIngestError;
                                 }
                                 else
                                 {
                                     C->pucRxBlockBitmap[ ulByte ] &= ~ulBitMask; /* Mark this block as received in our bitmap. */
                                     C->ulBlocksRemaining--;
                                     eIngestResult = eIngest_Result_Accepted_Continue;
-                                    *pxCloseResult = kOTA_Err_None; /* This is a success path. */
                                 }
                             }
                             else
                             {
                                 OTA_LOG_L1( "[%s] Error: Unable to write block, file handle is NULL.\r\n", OTA_METHOD_NAME );
                                 eIngestResult = eIngest_Result_BadFileHandle;
+                                *pxCloseResult = kOTA_Err_GenericIngestError;
                             }
+                        }
 
-                            if( C->ulBlocksRemaining == 0U )
+                        if( eIngestResult == eIngest_Result_Duplicate_Continue )
+                        {
+                            OTA_LOG_L1( "[%s] block %u is a DUPLICATE. %u blocks remaining.\r\n", OTA_METHOD_NAME,
+                                        ulBlockIndex,
+                                        C->ulBlocksRemaining );
+                        }
+                        else if( C->ulBlocksRemaining == 0U )
+                        {
+                            OTA_LOG_L1( "[%s] Received final expected block of file.\r\n", OTA_METHOD_NAME );
+                            prvStopRequestTimer();            /* Don't request any more since we're done. */
+                            vPortFree( C->pucRxBlockBitmap ); /* Free the bitmap now that we're done with the download. */
+                            C->pucRxBlockBitmap = NULL;
+
+                            if( C->pucFile != NULL )
                             {
-                                OTA_LOG_L1( "[%s] Received final expected block of file.\r\n", OTA_METHOD_NAME );
-                                prvStopRequestTimer();            /* Don't request any more since we're done. */
-                                vPortFree( C->pucRxBlockBitmap ); /* Free the bitmap now that we're done with the download. */
-                                C->pucRxBlockBitmap = NULL;
+                                *pxCloseResult = xOTA_Agent.xPALCallbacks.xCloseFile( C );
 
-                                if( C->pucFile != NULL )
+                                if( *pxCloseResult == kOTA_Err_None )
                                 {
-                                    *pxCloseResult = xOTA_Agent.xPALCallbacks.xCloseFile( C );
+                                    OTA_LOG_L1( "[%s] File receive complete and signature is valid.\r\n", OTA_METHOD_NAME );
+                                    eIngestResult = eIngest_Result_FileComplete;
+                                }
+                                else
+                                {
+                                    uint32_t ulCloseResult = ( uint32_t ) *pxCloseResult;
+                                    OTA_LOG_L1( "[%s] Error (%u:0x%06x) closing OTA file.\r\n",
+                                                OTA_METHOD_NAME,
+                                                ulCloseResult >> kOTA_MainErrShiftDownBits,
+                                                ulCloseResult & ( uint32_t ) kOTA_PAL_ErrMask );
 
-                                    if( *pxCloseResult == kOTA_Err_None )
+                                    if( ( ulCloseResult & kOTA_Main_ErrMask ) == kOTA_Err_SignatureCheckFailed )
                                     {
-                                        OTA_LOG_L1( "[%s] File receive complete and signature is valid.\r\n", OTA_METHOD_NAME );
-                                        eIngestResult = eIngest_Result_FileComplete;
+                                        eIngestResult = eIngest_Result_SigCheckFail;
                                     }
                                     else
                                     {
-                                        uint32_t ulCloseResult = ( uint32_t ) *pxCloseResult;
-                                        OTA_LOG_L1( "[%s] Error (%u:0x%06x) closing OTA file.\r\n",
-                                                    OTA_METHOD_NAME,
-                                                    ulCloseResult >> kOTA_MainErrShiftDownBits,
-                                                    ulCloseResult & ( uint32_t ) kOTA_PAL_ErrMask );
-
-                                        if( ( ulCloseResult & kOTA_Main_ErrMask ) == kOTA_Err_SignatureCheckFailed )
-                                        {
-                                            eIngestResult = eIngest_Result_SigCheckFail;
-                                        }
-                                        else
-                                        {
-                                            eIngestResult = eIngest_Result_FileCloseFail;
-                                        }
+                                        eIngestResult = eIngest_Result_FileCloseFail;
                                     }
-
-                                    C->pucFile = NULL; /* File is now closed so clear the file handle in the context. */
-                                }
-                                else
-                                {
-                                    OTA_LOG_L1( "[%s] Error: File handle is NULL after last block received.\r\n", OTA_METHOD_NAME );
-                                    eIngestResult = eIngest_Result_BadFileHandle;
                                 }
+
+                                C->pucFile = NULL; /* File is now closed so clear the file handle in the context. */
                             }
                             else
                             {
-                                OTA_LOG_L1( "[%s] Remaining: %u\r\n", OTA_METHOD_NAME, C->ulBlocksRemaining );
+                                OTA_LOG_L1( "[%s] Error: File handle is NULL after last block received.\r\n", OTA_METHOD_NAME );
+                                eIngestResult = eIngest_Result_BadFileHandle;
                             }
                         }
+                        else
+                        {
+                            OTA_LOG_L1( "[%s] Remaining: %u\r\n", OTA_METHOD_NAME, C->ulBlocksRemaining );
+                        }
                     }
                     else
                     {
@@ -2331,25 +2372,13 @@ static void prvAgentShutdownCleanup( void )
         xOTA_Agent.pcOTA_Singleton_ActiveJobName = NULL;
     }
 
-    /* Delete the OTA Agent Queue.*/
-    if( xOTA_Agent.xOTA_EventQueue != NULL )
-    {
-        vQueueDelete( xOTA_Agent.xOTA_EventQueue );
-    }
+    /* Stop accepting events, those left in the ring are dropped. */
+    xOTA_Agent.pxOTA_EventRing = NULL;
 
     /*
      * Free OTA event buffers.
      */
-    for( ulIndex = 0; ulIndex < otaconfigMAX_NUM_OTA_DATA_BUFFERS; ulIndex++ )
-    {
-        xEventBuffer[ ulIndex ].bBufferUsed = false;
-    }
-
-    /* Delete the semaphore.*/
-    if( xOTA_Agent.xOTA_ThreadSafetyMutex != NULL )
-    {
-        vSemaphoreDelete( xOTA_Agent.xOTA_ThreadSafetyMutex );
-    }
+    ( void ) OTA_EventSlabInit( &xEventSlab, otaconfigMAX_NUM_OTA_DATA_BUFFERS );
 }
 
 static void prvOTAAgentTask( void * pUnused )
@@ -2373,7 +2402,7 @@ static void prvOTAAgentTask( void * pUnused )
         /*
          * Receive the next event form the OTA event queue to process.
          */
-        if( xQueueReceive( xOTA_Agent.xOTA_EventQueue, &xEventMsg, portMAX_DELAY ) == pdTRUE )
+        if( prvOTAEventReceive( &xEventMsg ) == pdTRUE )
         {
             for( i = 0; i < ulTransitionTableLen; i++ )
             {
@@ -2434,12 +2463,22 @@ BaseType_t OTA_SignalEvent( const OTA_EventMsg_t * const pxEventMsg )
 
     BaseType_t xErr = pdFALSE;
 
+    OTA_EventRing_t * pxRing = xOTA_Agent.pxOTA_EventRing;
+    bool xWake = false;
+
     /*
-     * Send event to back of the queue.
+     * Send event to back of the ring, the kernel is only involved if the
+     * OTA task waits for it.
      */
-    if( xOTA_Agent.xOTA_EventQueue != NULL )
+    if( ( pxRing != NULL ) &&
+        ( OTA_EventRingPush( pxRing, ( uint32_t ) pxEventMsg->xEventId, pxEventMsg->pxEventData, &xWake ) == true ) )
     {
-        xErr = xQueueSendToBack( xOTA_Agent.xOTA_EventQueue, pxEventMsg, ( TickType_t ) 0 );
+        if( xWake == true )
+        {
+            ( void ) xTaskNotifyGive( xOTA_TaskHandle );
+        }
+
+        xErr = pdTRUE;
     }
 
     if( xErr == pdTRUE )
@@ -2502,16 +2541,10 @@ OTA_State_t OTA_AgentInit_internal( void * pvConnectionContext,
 {
     DEFINE_OTA_METHOD_NAME( "OTA_AgentInit_internal" );
 
-    static TaskHandle_t pxOTA_TaskHandle;
     uint32_t ulIndex;
     BaseType_t xReturn = 0;
     OTA_EventMsg_t xEventMsg = { 0 };
 
-    /*
-     * The actual OTA queue control structure. Only created once.
-     */
-    static StaticQueue_t xStaticQueue;
-
     /*
      * OTA Task is not running yet so update the state to init direclty in OTA context.
      */
@@ -2656,16 +2689,17 @@ OTA_State_t OTA_AgentInit_internal( void * pvConnectionContext,
             xOTA_Agent.pvConnectionContext = pvConnectionContext;
 
             /*
-             * Create the queue used to pass event messages to the OTA task.
+             * Start the ring used to pass event messages to the OTA task.
              */
-            xOTA_Agent.xOTA_EventQueue = xQueueCreateStatic( ( UBaseType_t ) OTA_NUM_MSG_Q_ENTRIES, ( UBaseType_t ) sizeof( OTA_EventMsg_t ), ( uint8_t * ) xQueueData, &xStaticQueue );
-            configASSERT( xOTA_Agent.xOTA_EventQueue );
+            xReturn = OTA_EventRingInit( &xEventRing, xEventRingSlots, OTA_NUM_MSG_Q_ENTRIES );
+            configASSERT( xReturn );
+            xOTA_Agent.pxOTA_EventRing = &xEventRing;
 
             /*
-             * Create the queue used to pass event messages to the OTA task.
+             * Make all the event buffers free.
              */
-            xOTA_Agent.xOTA_ThreadSafetyMutex = xSemaphoreCreateMutex();
-            configASSERT( xOTA_Agent.xOTA_ThreadSafetyMutex );
+            xReturn = OTA_EventSlabInit( &xEventSlab, otaconfigMAX_NUM_OTA_DATA_BUFFERS );
+            configASSERT( xReturn );
 
             /*
              * Initialize all file paths to NULL.
@@ -2675,15 +2709,7 @@ OTA_State_t OTA_AgentInit_internal( void * pvConnectionContext,
                 xOTA_Agent.pxOTA_Files[ ulIndex ].pucFilePath = NULL;
             }
 
-            /*
-             * Make sure OTA event buffers are clear.
-             */
-            for( ulIndex = 0; ulIndex < otaconfigMAX_NUM_OTA_DATA_BUFFERS; ulIndex++ )
-            {
-                xEventBuffer[ ulIndex ].bBufferUsed = false;
-            }
-
-            xReturn = xTaskCreate( prvOTAAgentTask, "OTA Agent Task", otaconfigSTACK_SIZE, NULL, otaconfigAGENT_PRIORITY, &pxOTA_TaskHandle );
+            xReturn = xTaskCreate( prvOTAAgentTask, "OTA Agent Task", otaconfigSTACK_SIZE, NULL, otaconfigAGENT_PRIORITY, &xOTA_TaskHandle );
             portEXIT_CRITICAL(); /* Protected elements are initialized. It's now safe to context switch. */
 
             if( xReturn == pdPASS )
@@ -2889,7 +2915,7 @@ OTA_Err_t OTA_SetImageState( OTA_ImageState_t eState )
     {
         case eOTA_ImageState_Aborted:
 
-            if( xOTA_Agent.xOTA_EventQueue != NULL )
+            if( xOTA_Agent.pxOTA_EventRing != NULL )
             {
                 xEventMsg.xEventId = eOTA_AgentEvent_UserAbort;
 
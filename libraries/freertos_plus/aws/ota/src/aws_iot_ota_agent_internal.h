@@ -44,6 +44,12 @@
 /* Type definitions for OTA Agent */
 #include "aws_iot_ota_types.h"
 
+/* Block request window. */
+#include "aws_iot_ota_window.h"
+
+/* Event ring of the agent task. */
+#include "aws_iot_ota_event_ring.h"
+
 /* General constants. */
 #define LOG2_BITS_PER_BYTE           3UL                                               /* Log base 2 of bits per byte. */
 #define BITS_PER_BYTE                ( 1UL << LOG2_BITS_PER_BYTE )                     /* Number of bits in a byte. This is used by the block bitmap implementation. */
@@ -56,7 +62,13 @@
 #ifdef configOTA_NUM_MSG_Q_ENTRIES
     #define OTA_NUM_MSG_Q_ENTRIES    configOTA_NUM_MSG_Q_ENTRIES
 #else
-    #define OTA_NUM_MSG_Q_ENTRIES    20U                   /* Maximum number of entries in the OTA message queue. */
+    #define OTA_NUM_MSG_Q_ENTRIES    32U                   /* Maximum number of entries in the OTA event ring, a power of two. */
+#endif
+#ifndef otaconfigLOG2_MAX_FILE_BLOCK_SIZE
+    #define otaconfigLOG2_MAX_FILE_BLOCK_SIZE    otaconfigLOG2_FILE_BLOCK_SIZE    /* Largest block size requested from the stream service. */
+#endif
+#ifndef otaconfigMAX_BLOCKS_IN_FLIGHT
+    #define otaconfigMAX_BLOCKS_IN_FLIGHT        otaconfigMAX_NUM_BLOCKS_REQUEST  /* Largest number of file blocks requested and not received yet. */
 #endif
 
 /* Job document parser constants. */
@@ -66,7 +78,7 @@
 #define OTA_JOB_PARAM_REQUIRED      ( ( bool_t ) pdTRUE )                                                        /* Used to denote a required document model parameter. */
 #define OTA_JOB_PARAM_OPTIONAL      ( ( bool_t ) pdFALSE )                                                       /* Used to denote an optional document model parameter. */
 #define OTA_DONT_STORE_PARAM        0xffffffffUL                                                                 /* If ulDestOffset in the model is 0xffffffff, do not store the value. */
-#define OTA_DATA_BLOCK_SIZE         ( ( 1U << otaconfigLOG2_FILE_BLOCK_SIZE ) + OTA_REQUEST_URL_MAX_SIZE + 30 )  /* Header is 19 bytes.*/
+#define OTA_DATA_BLOCK_SIZE         ( ( 1U << otaconfigLOG2_MAX_FILE_BLOCK_SIZE ) + OTA_REQUEST_URL_MAX_SIZE + 30 )  /* Header is 19 bytes.*/
 
 
 /* OTA Agent task event flags. */
@@ -255,12 +267,11 @@ typedef struct ota_agent_context
     uint8_t * pcClientTokenFromJob;                         /* The clientToken field from the latest update job. */
     TimerHandle_t pvSelfTestTimer;                          /* The self-test response expected timer. */
     TimerHandle_t xRequestTimer;                            /* The request timer associated with this OTA context. */
-    QueueHandle_t xOTA_EventQueue;                          /* Event queue for communicating with the OTA Agent task. */
+    OTA_EventRing_t * pxOTA_EventRing;                      /* Event ring for communicating with the OTA Agent task, NULL when stopped. */
     OTA_ImageState_t eImageState;                           /* The current application image state. */
     OTA_PAL_Callbacks_t xPALCallbacks;                      /* Variable to store PAL callbacks */
-    uint32_t ulNumOfBlocksToReceive;                        /* Number of data blocks to receive per data request. */
+    OTA_Window_t xWindow;                                   /* Data blocks requested and not received yet. */
     OTA_AgentStatistics_t xStatistics;                      /* The OTA agent statistics block. */
-    SemaphoreHandle_t xOTA_ThreadSafetyMutex;               /* Mutex used to ensure thread safety while managing data buffers. */
     uint32_t ulRequestMomentum;                             /* The number of requests sent before a response was received. */
 } OTA_AgentContext_t;
 
@@ -270,7 +281,6 @@ typedef struct
 {
     uint8_t ucData[ OTA_DATA_BLOCK_SIZE ];
     uint32_t ulDataLength;
-    bool_t bBufferUsed;
 } OTA_EventData_t;
 
 typedef struct
@@ -0,0 +1,251 @@
+/*
+ * FreeRTOS OTA V1.1.1
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file aws_iot_ota_event_ring.c
+ * @brief Event ring and data buffer slab of the OTA agent.
+ */
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "atomic.h"
+
+#include "aws_iot_ota_event_ring.h"
+
+/*-----------------------------------------------------------*/
+
+bool OTA_EventRingInit( OTA_EventRing_t * pxRing,
+                        OTA_EventRingSlot_t * pxSlots,
+                        uint32_t ulNumSlots )
+{
+    bool xResult = false;
+    uint32_t i;
+
+    if( ( ulNumSlots >= 2U ) &&
+        ( ulNumSlots <= OTA_EVENT_RING_MAX_SIZE ) &&
+        ( ( ulNumSlots & ( ulNumSlots - 1U ) ) == 0U ) )
+    {
+        /* Slot i is ready for the producer of position i. */
+        for( i = 0; i < ulNumSlots; i++ )
+        {
+            pxSlots[ i ].ulSequence = i;
+            pxSlots[ i ].ulEventId = 0;
+            pxSlots[ i ].pvEventData = NULL;
+        }
+
+        pxRing->pxSlots = pxSlots;
+        pxRing->ulMask = ulNumSlots - 1U;
+        pxRing->ulHead = 0;
+        pxRing->ulTail = 0;
+        pxRing->ulWaiting = 0;
+        pxRing->xStats.ulPushed = 0;
+        pxRing->xStats.ulFull = 0;
+        pxRing->xStats.ulWakes = 0;
+
+        xResult = true;
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+bool OTA_EventRingPush( OTA_EventRing_t * pxRing,
+                        uint32_t ulEventId,
+                        void * pvEventData,
+                        bool * pxWake )
+{
+    OTA_EventRingSlot_t * pxSlot = NULL;
+    uint32_t ulPosition = 0;
+    int32_t lLag = 0;
+    bool xClaimed = false;
+    bool xFull = false;
+
+    *pxWake = false;
+
+    while( ( xClaimed == false ) && ( xFull == false ) )
+    {
+        ulPosition = pxRing->ulHead;
+        pxSlot = &pxRing->pxSlots[ ulPosition & pxRing->ulMask ];
+        lLag = ( int32_t ) ( pxSlot->ulSequence - ulPosition );
+
+        if( lLag == 0 )
+        {
+            /* The slot is free for this position, claim it unless another
+             * producer did first. */
+            xClaimed = ( Atomic_CompareAndSwap_u32( &pxRing->ulHead,
+                                                    ulPosition + 1U,
+                                                    ulPosition ) == ATOMIC_COMPARE_AND_SWAP_SUCCESS );
+        }
+        else if( lLag < 0 )
+        {
+            /* The consumer has not read the event of the previous lap yet. */
+            xFull = true;
+        }
+        else
+        {
+            /* Another producer claimed the position, try the next one. */
+        }
+    }
+
+    if( xClaimed == true )
+    {
+        pxSlot->ulEventId = ulEventId;
+        pxSlot->pvEventData = pvEventData;
+
+        /* Publish the event to the consumer. */
+        ( void ) Atomic_CompareAndSwap_u32( &pxSlot->ulSequence, ulPosition + 1U, ulPosition );
+        ( void ) Atomic_Increment_u32( &pxRing->xStats.ulPushed );
+
+        /* Only a waiting consumer needs the kernel to wake it up. */
+        if( Atomic_CompareAndSwap_u32( &pxRing->ulWaiting, 0U, 1U ) == ATOMIC_COMPARE_AND_SWAP_SUCCESS )
+        {
+            ( void ) Atomic_Increment_u32( &pxRing->xStats.ulWakes );
+            *pxWake = true;
+        }
+    }
+    else
+    {
+        ( void ) Atomic_Increment_u32( &pxRing->xStats.ulFull );
+    }
+
+    return xClaimed;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvEventReady( const OTA_EventRing_t * pxRing )
+{
+    const OTA_EventRingSlot_t * pxSlot = &pxRing->pxSlots[ pxRing->ulTail & pxRing->ulMask ];
+
+    return pxSlot->ulSequence == ( pxRing->ulTail + 1U );
+}
+
+/*-----------------------------------------------------------*/
+
+bool OTA_EventRingPop( OTA_EventRing_t * pxRing,
+                       uint32_t * pulEventId,
+                       void ** ppvEventData )
+{
+    OTA_EventRingSlot_t * pxSlot = &pxRing->pxSlots[ pxRing->ulTail & pxRing->ulMask ];
+    bool xPopped = false;
+
+    if( prvEventReady( pxRing ) == true )
+    {
+        *pulEventId = pxSlot->ulEventId;
+        *ppvEventData = pxSlot->pvEventData;
+
+        /* Hand the slot to the producer of the next lap. */
+        ( void ) Atomic_CompareAndSwap_u32( &pxSlot->ulSequence,
+                                            pxRing->ulTail + pxRing->ulMask + 1U,
+                                            pxRing->ulTail + 1U );
+        pxRing->ulTail++;
+
+        xPopped = true;
+    }
+
+    return xPopped;
+}
+
+/*-----------------------------------------------------------*/
+
+bool OTA_EventRingPrepareWait( OTA_EventRing_t * pxRing )
+{
+    bool xWait = true;
+
+    ( void ) Atomic_CompareAndSwap_u32( &pxRing->ulWaiting, 1U, 0U );
+
+    if( prvEventReady( pxRing ) == true )
+    {
+        /* An event was posted before the flag was seen. If its producer
+         * cleared the flag, the consumer gets an extra wake up later. */
+        ( void ) Atomic_CompareAndSwap_u32( &pxRing->ulWaiting, 0U, 1U );
+        xWait = false;
+    }
+
+    return xWait;
+}
+
+/*-----------------------------------------------------------*/
+
+bool OTA_EventSlabInit( OTA_EventSlab_t * pxSlab,
+                        uint32_t ulNumBuffers )
+{
+    bool xResult = false;
+
+    if( ( ulNumBuffers > 0U ) && ( ulNumBuffers <= OTA_EVENT_SLAB_MAX_SIZE ) )
+    {
+        pxSlab->ulFree = ( ulNumBuffers == 32U ) ? 0xFFFFFFFFUL : ( ( 1UL << ulNumBuffers ) - 1UL );
+        xResult = true;
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t OTA_EventSlabAlloc( OTA_EventSlab_t * pxSlab )
+{
+    int32_t lIndex = -1;
+    uint32_t ulFree = 0;
+    uint32_t ulBit = 0;
+    bool xEmpty = false;
+
+    while( ( lIndex < 0 ) && ( xEmpty == false ) )
+    {
+        ulFree = pxSlab->ulFree;
+
+        if( ulFree == 0U )
+        {
+            xEmpty = true;
+        }
+        else
+        {
+            /* Lowest free buffer. */
+            ulBit = ulFree & ( ~ulFree + 1U );
+
+            if( Atomic_CompareAndSwap_u32( &pxSlab->ulFree, ulFree & ~ulBit, ulFree ) == ATOMIC_COMPARE_AND_SWAP_SUCCESS )
+            {
+                lIndex = 0;
+
+                while( ulBit > 1U )
+                {
+                    ulBit >>= 1;
+                    lIndex++;
+                }
+            }
+        }
+    }
+
+    return lIndex;
+}
+
+/*-----------------------------------------------------------*/
+
+void OTA_EventSlabFree( OTA_EventSlab_t * pxSlab,
+                        uint32_t ulIndex )
+{
+    ( void ) Atomic_OR_u32( &pxSlab->ulFree, 1UL << ulIndex );
+}
@@ -0,0 +1,179 @@
+/*
+ * FreeRTOS OTA V1.1.1
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file aws_iot_ota_event_ring.h
+ * @brief Event ring and data buffer slab of the OTA agent.
+ *
+ * Events are posted by the MQTT and HTTP callbacks, the timers, the
+ * application and the agent itself, and consumed by the agent task only. The
+ * ring is a bounded multiple producer, single consumer ring in which each
+ * slot carries a sequence number: a producer claims a slot by advancing the
+ * head, fills it and publishes it through its sequence; the consumer reads
+ * the slots in order without any lock. Each slot holds the event and the
+ * reference to its data inline, so posting an event copies no buffer and
+ * only wakes the agent task when it waits for events.
+ *
+ * Data too large for a slot (job documents, HTTP blocks) lives in a buffer of
+ * the slab, a fixed set of buffers allocated from a bitmap.
+ *
+ * The atomic operations are the ones of the kernel, short critical sections
+ * on the single core targets.
+ */
+
+#ifndef __AWS_IOT_OTA_EVENT_RING__H__
+#define __AWS_IOT_OTA_EVENT_RING__H__
+
+/* Standard library includes. */
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Largest number of events in the ring.
+ */
+#define OTA_EVENT_RING_MAX_SIZE    256U
+
+/**
+ * @brief Largest number of buffers in the slab.
+ */
+#define OTA_EVENT_SLAB_MAX_SIZE    32U
+
+/**
+ * @brief One slot of the ring.
+ */
+typedef struct OTA_EventRingSlot
+{
+    volatile uint32_t ulSequence;  /**< Position the slot is ready for. */
+    volatile uint32_t ulEventId;   /**< Event of the agent. */
+    void * volatile pvEventData;   /**< Data of the event, NULL for none. */
+} OTA_EventRingSlot_t;
+
+/**
+ * @brief Ring counters.
+ */
+typedef struct OTA_EventRingStats
+{
+    uint32_t ulPushed; /**< Events posted. */
+    uint32_t ulFull;   /**< Events dropped because the ring was full. */
+    uint32_t ulWakes;  /**< Events posted while the consumer was waiting. */
+} OTA_EventRingStats_t;
+
+/**
+ * @brief State of a ring.
+ */
+typedef struct OTA_EventRing
+{
+    OTA_EventRingSlot_t * pxSlots;
+    uint32_t ulMask;             /**< Number of slots minus one. */
+    volatile uint32_t ulHead;    /**< Next position claimed by a producer. */
+    uint32_t ulTail;             /**< Next position read by the consumer. */
+    volatile uint32_t ulWaiting; /**< The consumer waits for an event. */
+    OTA_EventRingStats_t xStats;
+} OTA_EventRing_t;
+
+/**
+ * @brief Buffers of a slab, a set bit is a free buffer.
+ */
+typedef struct OTA_EventSlab
+{
+    volatile uint32_t ulFree;
+} OTA_EventSlab_t;
+
+/**
+ * @brief Start an empty ring.
+ *
+ * @param[in] pxSlots Storage of the ring.
+ * @param[in] ulNumSlots Number of slots, a power of two up to
+ * OTA_EVENT_RING_MAX_SIZE.
+ *
+ * @return false if the number of slots is not supported.
+ */
+bool OTA_EventRingInit( OTA_EventRing_t * pxRing,
+                        OTA_EventRingSlot_t * pxSlots,
+                        uint32_t ulNumSlots );
+
+/**
+ * @brief Post an event, from any task but the consumer's or from the consumer.
+ *
+ * Never waits.
+ *
+ * @param[in] ulEventId Event.
+ * @param[in] pvEventData Data of the event, owned by the consumer until it
+ * handles the event.
+ * @param[out] pxWake Set to true if the consumer waits and must be woken up.
+ *
+ * @return false if the ring is full.
+ */
+bool OTA_EventRingPush( OTA_EventRing_t * pxRing,
+                        uint32_t ulEventId,
+                        void * pvEventData,
+                        bool * pxWake );
+
+/**
+ * @brief Take the oldest event, from the consumer only.
+ *
+ * @return false if the ring is empty.
+ */
+bool OTA_EventRingPop( OTA_EventRing_t * pxRing,
+                       uint32_t * pulEventId,
+                       void ** ppvEventData );
+
+/**
+ * @brief Announce that the consumer is about to wait, after the ring was found
+ * empty.
+ *
+ * The next event posted reports that the consumer must be woken up. The ring
+ * is checked again to close the race with a producer that posted meanwhile.
+ *
+ * @return true if the consumer must wait, false if an event is ready.
+ */
+bool OTA_EventRingPrepareWait( OTA_EventRing_t * pxRing );
+
+/**
+ * @brief Make all the buffers of a slab free.
+ *
+ * @param[in] ulNumBuffers Number of buffers, up to OTA_EVENT_SLAB_MAX_SIZE.
+ *
+ * @return false if the number of buffers is not supported.
+ */
+bool OTA_EventSlabInit( OTA_EventSlab_t * pxSlab,
+                        uint32_t ulNumBuffers );
+
+/**
+ * @brief Allocate a buffer of a slab, from any task. Never waits.
+ *
+ * @return Index of the buffer, -1 if all the buffers are used.
+ */
+int32_t OTA_EventSlabAlloc( OTA_EventSlab_t * pxSlab );
+
+/**
+ * @brief Free a buffer of a slab, from any task.
+ *
+ * @param[in] ulIndex Index returned by OTA_EventSlabAlloc().
+ */
+void OTA_EventSlabFree( OTA_EventSlab_t * pxSlab,
+                        uint32_t ulIndex );
+
+#endif /* ifndef __AWS_IOT_OTA_EVENT_RING__H__ */
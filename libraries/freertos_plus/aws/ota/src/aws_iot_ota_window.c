@@ -0,0 +1,634 @@
+/*
+ * FreeRTOS OTA V1.1.1
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file aws_iot_ota_window.c
+ * @brief Sliding window of stream block requests.
+ */
+
+/* Standard library includes. */
+#include <string.h>
+
+#include "aws_iot_ota_window.h"
+
+/* Slot states. */
+#define OTA_WINDOW_SLOT_FREE         0U
+#define OTA_WINDOW_SLOT_IN_FLIGHT    1U
+#define OTA_WINDOW_SLOT_EXPIRED      2U
+
+/* Initial number of base blocks in flight, as the initial window of TCP. */
+#define OTA_WINDOW_INITIAL_BLOCKS    4U
+
+/* Smallest timeout margin above the smoothed round trip time. */
+#define OTA_WINDOW_MIN_RTT_VAR_MS    50U
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvClampRto( uint32_t ulRtoMs )
+{
+    if( ulRtoMs < OTA_WINDOW_MIN_RTO_MS )
+    {
+        ulRtoMs = OTA_WINDOW_MIN_RTO_MS;
+    }
+    else if( ulRtoMs > OTA_WINDOW_MAX_RTO_MS )
+    {
+        ulRtoMs = OTA_WINDOW_MAX_RTO_MS;
+    }
+    else
+    {
+        /* In range. */
+    }
+
+    return ulRtoMs;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvSlotFirst( const OTA_WindowSlot_t * pxSlot )
+{
+    return pxSlot->ulBlock << pxSlot->ucShift;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvSlotCount( const OTA_Window_t * pxWindow,
+                              const OTA_WindowSlot_t * pxSlot )
+{
+    uint32_t ulFirst = prvSlotFirst( pxSlot );
+    uint32_t ulCount = 1UL << pxSlot->ucShift;
+
+    if( ( ulFirst + ulCount ) > pxWindow->ulNumBlocks )
+    {
+        ulCount = pxWindow->ulNumBlocks - ulFirst;
+    }
+
+    return ulCount;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvIsMissing( const uint8_t * pucRxBitmap,
+                          uint32_t ulBlock )
+{
+    return ( pucRxBitmap[ ulBlock >> 3 ] & ( 1U << ( ulBlock & 7U ) ) ) != 0U;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvIsInFlight( const OTA_Window_t * pxWindow,
+                           uint32_t ulBlock )
+{
+    const OTA_WindowSlot_t * pxSlot;
+    uint32_t ulFirst;
+    bool xInFlight = false;
+    uint32_t i;
+
+    for( i = 0; ( i < OTA_WINDOW_MAX_SLOTS ) && ( xInFlight == false ); i++ )
+    {
+        pxSlot = &pxWindow->xSlots[ i ];
+
+        if( pxSlot->ucState == OTA_WINDOW_SLOT_IN_FLIGHT )
+        {
+            ulFirst = prvSlotFirst( pxSlot );
+            xInFlight = ( ulBlock >= ulFirst ) && ( ulBlock < ( ulFirst + prvSlotCount( pxWindow, pxSlot ) ) );
+        }
+    }
+
+    return xInFlight;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvBlocksInFlight( const OTA_Window_t * pxWindow )
+{
+    uint32_t ulBlocks = 0;
+    uint32_t i;
+
+    for( i = 0; i < OTA_WINDOW_MAX_SLOTS; i++ )
+    {
+        if( pxWindow->xSlots[ i ].ucState == OTA_WINDOW_SLOT_IN_FLIGHT )
+        {
+            ulBlocks += prvSlotCount( pxWindow, &pxWindow->xSlots[ i ] );
+        }
+    }
+
+    return ulBlocks;
+}
+
+/*-----------------------------------------------------------*/
+
+/* A unit of 2^ulShift base blocks can be requested if all its blocks are in
+ * the file, missing and not in flight. */
+static bool prvUnitWanted( const OTA_Window_t * pxWindow,
+                           const uint8_t * pucRxBitmap,
+                           uint32_t ulUnit,
+                           uint32_t ulShift )
+{
+    uint32_t ulFirst = ulUnit << ulShift;
+    uint32_t ulCount = 1UL << ulShift;
+    bool xWanted = true;
+    uint32_t i;
+
+    if( ulShift > 0U )
+    {
+        /* Large blocks must be full, see OTA_WindowBlockRange(). */
+        xWanted = ( ulFirst + ulCount ) <= pxWindow->ulNumBlocks;
+    }
+    else
+    {
+        xWanted = ulFirst < pxWindow->ulNumBlocks;
+    }
+
+    for( i = 0; ( i < ulCount ) && ( xWanted == true ); i++ )
+    {
+        xWanted = prvIsMissing( pucRxBitmap, ulFirst + i ) &&
+                  ( prvIsInFlight( pxWindow, ulFirst + i ) == false );
+    }
+
+    return xWanted;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Shrink the window once per round trip: losses of requests sent before the
+ * last reduction are the same congestion event. */
+static void prvLoss( OTA_Window_t * pxWindow,
+                     uint32_t ulSentMs,
+                     uint32_t ulNowMs,
+                     bool xTimeout )
+{
+    pxWindow->ulCleanBlocks = 0;
+
+    if( ( pxWindow->xReduced == false ) ||
+        ( ( int32_t ) ( ulSentMs - pxWindow->ulRecoveryMs ) >= 0 ) )
+    {
+        pxWindow->ulThreshold = pxWindow->ulWindow / 2U;
+
+        if( pxWindow->ulThreshold == 0U )
+        {
+            pxWindow->ulThreshold = 1;
+        }
+
+        pxWindow->ulWindow = pxWindow->ulThreshold;
+        pxWindow->ulGrowth = 0;
+
+        if( pxWindow->ulShift > 0U )
+        {
+            pxWindow->ulShift--;
+        }
+
+        /* Back off the timer until a new round trip is measured. */
+        if( xTimeout == true )
+        {
+            pxWindow->ulRtoMs = prvClampRto( pxWindow->ulRtoMs * 2U );
+        }
+
+        pxWindow->ulRecoveryMs = ulNowMs;
+        pxWindow->xReduced = true;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvExpire( OTA_Window_t * pxWindow,
+                       uint32_t ulNowMs )
+{
+    OTA_WindowSlot_t * pxSlot;
+    uint32_t ulRtoMs = pxWindow->ulRtoMs;
+    uint32_t i;
+
+    for( i = 0; i < OTA_WINDOW_MAX_SLOTS; i++ )
+    {
+        pxSlot = &pxWindow->xSlots[ i ];
+
+        if( ( pxSlot->ucState == OTA_WINDOW_SLOT_IN_FLIGHT ) &&
+            ( ( ulNowMs - pxSlot->ulSentMs ) >= ulRtoMs ) )
+        {
+            pxSlot->ucState = OTA_WINDOW_SLOT_EXPIRED;
+            pxWindow->xStats.ulTimeouts++;
+            prvLoss( pxWindow, pxSlot->ulSentMs, ulNowMs, true );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* Take a slot for a request: the expired request of the same block first, so
+ * that its round trip is not measured (Karn), then a free slot, then the
+ * oldest expired request. */
+static OTA_WindowSlot_t * prvSlotTake( OTA_Window_t * pxWindow,
+                                       uint32_t ulUnit,
+                                       uint32_t ulShift )
+{
+    OTA_WindowSlot_t * pxSlot;
+    OTA_WindowSlot_t * pxFree = NULL;
+    OTA_WindowSlot_t * pxOldest = NULL;
+    OTA_WindowSlot_t * pxSame = NULL;
+    uint32_t i;
+
+    for( i = 0; ( i < OTA_WINDOW_MAX_SLOTS ) && ( pxSame == NULL ); i++ )
+    {
+        pxSlot = &pxWindow->xSlots[ i ];
+
+        if( pxSlot->ucState == OTA_WINDOW_SLOT_FREE )
+        {
+            if( pxFree == NULL )
+            {
+                pxFree = pxSlot;
+            }
+        }
+        else if( pxSlot->ucState == OTA_WINDOW_SLOT_EXPIRED )
+        {
+            if( ( pxSlot->ulBlock == ulUnit ) && ( pxSlot->ucShift == ulShift ) )
+            {
+                pxSame = pxSlot;
+            }
+            else if( ( pxOldest == NULL ) ||
+                     ( ( int32_t ) ( pxSlot->ulSentMs - pxOldest->ulSentMs ) < 0 ) )
+            {
+                pxOldest = pxSlot;
+            }
+            else
+            {
+                /* Newer expired request. */
+            }
+        }
+        else
+        {
+            /* In flight. */
+        }
+    }
+
+    if( pxSame != NULL )
+    {
+        pxSlot = pxSame;
+        pxSlot->ucTries++;
+    }
+    else
+    {
+        pxSlot = ( pxFree != NULL ) ? pxFree : pxOldest;
+
+        if( pxSlot != NULL )
+        {
+            pxSlot->ucTries = 0;
+        }
+    }
+
+    if( pxSlot != NULL )
+    {
+        pxSlot->ulBlock = ulUnit;
+        pxSlot->ucShift = ( uint8_t ) ulShift;
+        pxSlot->ucState = OTA_WINDOW_SLOT_IN_FLIGHT;
+        pxSlot->ucLater = 0;
+        pxSlot->ulSequence = pxWindow->ulNextSequence;
+        pxWindow->ulNextSequence++;
+    }
+
+    return pxSlot;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvRttSample( OTA_Window_t * pxWindow,
+                          uint32_t ulRttMs )
+{
+    uint32_t ulDelta;
+    uint32_t ulMargin;
+
+    /* RFC 6298. */
+    if( pxWindow->xRttValid == false )
+    {
+        pxWindow->ulSrttMs = ulRttMs;
+        pxWindow->ulRttVarMs = ulRttMs / 2U;
+        pxWindow->xRttValid = true;
+    }
+    else
+    {
+        ulDelta = ( pxWindow->ulSrttMs > ulRttMs ) ? ( pxWindow->ulSrttMs - ulRttMs ) : ( ulRttMs - pxWindow->ulSrttMs );
+        pxWindow->ulRttVarMs = ( ( 3U * pxWindow->ulRttVarMs ) + ulDelta ) / 4U;
+        pxWindow->ulSrttMs = ( ( 7U * pxWindow->ulSrttMs ) + ulRttMs ) / 8U;
+    }
+
+    ulMargin = 4U * pxWindow->ulRttVarMs;
+
+    if( ulMargin < OTA_WINDOW_MIN_RTT_VAR_MS )
+    {
+        ulMargin = OTA_WINDOW_MIN_RTT_VAR_MS;
+    }
+
+    pxWindow->ulRtoMs = prvClampRto( pxWindow->ulSrttMs + ulMargin );
+    pxWindow->xStats.ulRttSamples++;
+}
+
+/*-----------------------------------------------------------*/
+
+void OTA_WindowInit( OTA_Window_t * pxWindow,
+                     uint32_t ulFileSize,
+                     uint32_t ulLog2BlockSize,
+                     uint32_t ulLog2MaxBlockSize,
+                     uint32_t ulMaxWindow,
+                     uint32_t ulInitialRtoMs )
+{
+    memset( pxWindow, 0, sizeof( OTA_Window_t ) );
+
+    pxWindow->ulFileSize = ulFileSize;
+    pxWindow->ulLog2BlockSize = ulLog2BlockSize;
+    pxWindow->ulNumBlocks = ( ulFileSize + ( ( 1UL << ulLog2BlockSize ) - 1U ) ) >> ulLog2BlockSize;
+
+    if( ulLog2MaxBlockSize > ulLog2BlockSize )
+    {
+        pxWindow->ulMaxShift = ulLog2MaxBlockSize - ulLog2BlockSize;
+
+        if( pxWindow->ulMaxShift > OTA_WINDOW_MAX_SHIFT )
+        {
+            pxWindow->ulMaxShift = OTA_WINDOW_MAX_SHIFT;
+        }
+    }
+
+    pxWindow->ulMaxWindow = ( ulMaxWindow > 0U ) ? ulMaxWindow : 1U;
+    pxWindow->ulWindow = ( pxWindow->ulMaxWindow < OTA_WINDOW_INITIAL_BLOCKS ) ? pxWindow->ulMaxWindow : OTA_WINDOW_INITIAL_BLOCKS;
+    pxWindow->ulThreshold = pxWindow->ulMaxWindow;
+    pxWindow->ulRtoMs = prvClampRto( ulInitialRtoMs );
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t OTA_WindowRequest( OTA_Window_t * pxWindow,
+                            const uint8_t * pucRxBitmap,
+                            uint32_t ulNowMs,
+                            OTA_WindowRequest_t * pxRequest )
+{
+    OTA_WindowSlot_t * pxSlot;
+    uint32_t ulBudget;
+    uint32_t ulInFlight;
+    uint32_t ulShift;
+    uint32_t ulLargeShift;
+    uint32_t ulFirst = 0;
+    uint32_t ulUnit;
+    uint32_t ulBit;
+    bool xFound = false;
+
+    memset( pxRequest, 0, sizeof( OTA_WindowRequest_t ) );
+
+    prvExpire( pxWindow, ulNowMs );
+
+    ulInFlight = prvBlocksInFlight( pxWindow );
+    ulBudget = ( pxWindow->ulWindow > ulInFlight ) ? ( pxWindow->ulWindow - ulInFlight ) : 0U;
+
+    /* A large block must fit in the window. */
+    ulShift = pxWindow->ulShift;
+
+    while( ( ulShift > 0U ) && ( ( 1UL << ulShift ) > pxWindow->ulWindow ) )
+    {
+        ulShift--;
+    }
+
+    ulLargeShift = ulShift;
+
+    /* First missing block not in flight. */
+    while( ( ulBudget > 0U ) && ( xFound == false ) && ( ulFirst < pxWindow->ulNumBlocks ) )
+    {
+        if( ( ( ulFirst & 7U ) == 0U ) && ( pucRxBitmap[ ulFirst >> 3 ] == 0U ) )
+        {
+            ulFirst += 8U;
+        }
+        else if( prvIsMissing( pucRxBitmap, ulFirst ) && ( prvIsInFlight( pxWindow, ulFirst ) == false ) )
+        {
+            xFound = true;
+        }
+        else
+        {
+            ulFirst++;
+        }
+    }
+
+    if( xFound == true )
+    {
+        /* Use large blocks only from an entirely missing one, the gaps left
+         * by lost blocks are filled with base blocks. */
+        if( ( ( ulFirst & ( ( 1UL << ulShift ) - 1U ) ) != 0U ) ||
+            ( prvUnitWanted( pxWindow, pucRxBitmap, ulFirst >> ulShift, ulShift ) == false ) )
+        {
+            ulShift = 0;
+        }
+
+        pxRequest->ulBlockSize = 1UL << ( pxWindow->ulLog2BlockSize + ulShift );
+        pxRequest->ulBlockOffset = ulFirst >> ulShift;
+
+        for( ulBit = 0; ulBit < ( OTA_WINDOW_BITMAP_SIZE * 8U ); ulBit++ )
+        {
+            ulUnit = pxRequest->ulBlockOffset + ulBit;
+
+            if( ( ulUnit << ulShift ) >= pxWindow->ulNumBlocks )
+            {
+                break;
+            }
+
+            if( ( 1UL << ulShift ) > ulBudget )
+            {
+                break;
+            }
+
+            /* A gap is filled up to the next large block entirely missing,
+             * left to the next request. */
+            if( ( ulShift < ulLargeShift ) && ( ulBit > 0U ) &&
+                ( ( ulUnit & ( ( 1UL << ulLargeShift ) - 1U ) ) == 0U ) &&
+                ( prvUnitWanted( pxWindow, pucRxBitmap, ulUnit >> ulLargeShift, ulLargeShift ) == true ) )
+            {
+                break;
+            }
+
+            if( prvUnitWanted( pxWindow, pucRxBitmap, ulUnit, ulShift ) == true )
+            {
+                pxSlot = prvSlotTake( pxWindow, ulUnit, ulShift );
+
+                if( pxSlot == NULL )
+                {
+                    break;
+                }
+
+                pxSlot->ulSentMs = ulNowMs;
+                ulBudget -= prvSlotCount( pxWindow, pxSlot );
+
+                pxRequest->ucBitmap[ ulBit >> 3 ] |= ( uint8_t ) ( 1U << ( ulBit & 7U ) );
+                pxRequest->ulBitmapSize = ( ulBit >> 3 ) + 1U;
+                pxRequest->ulNumBlocks++;
+            }
+        }
+
+        if( pxRequest->ulNumBlocks > 0U )
+        {
+            pxWindow->xStats.ulRequests++;
+            pxWindow->xStats.ulBlocksRequested += pxRequest->ulNumBlocks;
+        }
+    }
+
+    return pxRequest->ulNumBlocks;
+}
+
+/*-----------------------------------------------------------*/
+
+bool OTA_WindowBlockRange( const OTA_Window_t * pxWindow,
+                           uint32_t ulBlockId,
+                           uint32_t ulBlockSize,
+                           uint32_t * pulFirst,
+                           uint32_t * pulCount )
+{
+    uint32_t ulBaseSize = 1UL << pxWindow->ulLog2BlockSize;
+    uint32_t ulLast = pxWindow->ulNumBlocks - 1U;
+    uint32_t ulShift;
+    bool xValid = false;
+
+    if( ( pxWindow->ulNumBlocks > 0U ) && ( ulBlockId <= ulLast ) )
+    {
+        /* A large block is always full. */
+        for( ulShift = pxWindow->ulMaxShift; ( ulShift > 0U ) && ( xValid == false ); ulShift-- )
+        {
+            if( ( ulBlockSize == ( ulBaseSize << ulShift ) ) &&
+                ( ( ( ulBlockId + 1U ) << ulShift ) <= pxWindow->ulNumBlocks ) )
+            {
+                *pulFirst = ulBlockId << ulShift;
+                *pulCount = 1UL << ulShift;
+                xValid = true;
+            }
+        }
+
+        /* If it is NOT the last block, it MUST be equal to a full block size.
+         * If it IS the last block, it MUST be equal to the expected remainder. */
+        if( ( xValid == false ) &&
+            ( ( ( ulBlockId < ulLast ) && ( ulBlockSize == ulBaseSize ) ) ||
+              ( ( ulBlockId == ulLast ) && ( ulBlockSize == ( pxWindow->ulFileSize - ( ulLast * ulBaseSize ) ) ) ) ) )
+        {
+            *pulFirst = ulBlockId;
+            *pulCount = 1;
+            xValid = true;
+        }
+    }
+
+    return xValid;
+}
+
+/*-----------------------------------------------------------*/
+
+void OTA_WindowReceived( OTA_Window_t * pxWindow,
+                         uint32_t ulFirst,
+                         uint32_t ulCount,
+                         uint32_t ulNowMs )
+{
+    OTA_WindowSlot_t * pxSlot;
+    uint32_t ulSlotFirst;
+    uint32_t ulSlotCount;
+    uint32_t ulSequence = 0;
+    bool xAnswered = false;
+    uint32_t i;
+
+    for( i = 0; i < OTA_WINDOW_MAX_SLOTS; i++ )
+    {
+        pxSlot = &pxWindow->xSlots[ i ];
+
+        if( pxSlot->ucState != OTA_WINDOW_SLOT_FREE )
+        {
+            ulSlotFirst = prvSlotFirst( pxSlot );
+            ulSlotCount = prvSlotCount( pxWindow, pxSlot );
+
+            if( ( ulSlotFirst >= ulFirst ) && ( ( ulSlotFirst + ulSlotCount ) <= ( ulFirst + ulCount ) ) )
+            {
+                /* Only the answer to a request sent once measures the round
+                 * trip, a block of another size may answer an older request. */
+                if( ( ulSlotFirst == ulFirst ) && ( ulSlotCount == ulCount ) &&
+                    ( pxSlot->ucState == OTA_WINDOW_SLOT_IN_FLIGHT ) )
+                {
+                    if( pxSlot->ucTries == 0U )
+                    {
+                        prvRttSample( pxWindow, ulNowMs - pxSlot->ulSentMs );
+                    }
+
+                    ulSequence = pxSlot->ulSequence;
+                    xAnswered = true;
+                }
+
+                pxSlot->ucState = OTA_WINDOW_SLOT_FREE;
+            }
+        }
+    }
+
+    /* The service answers in order: a block requested before the one received
+     * and still missing after OTA_WINDOW_REORDER_BLOCKS later ones is lost,
+     * without waiting for the timeout. */
+    for( i = 0; ( i < OTA_WINDOW_MAX_SLOTS ) && ( xAnswered == true ); i++ )
+    {
+        pxSlot = &pxWindow->xSlots[ i ];
+
+        if( ( pxSlot->ucState == OTA_WINDOW_SLOT_IN_FLIGHT ) &&
+            ( ( int32_t ) ( pxSlot->ulSequence - ulSequence ) < 0 ) )
+        {
+            pxSlot->ucLater++;
+
+            if( pxSlot->ucLater >= OTA_WINDOW_REORDER_BLOCKS )
+            {
+                pxSlot->ucState = OTA_WINDOW_SLOT_EXPIRED;
+                pxWindow->xStats.ulSkipped++;
+                prvLoss( pxWindow, pxSlot->ulSentMs, ulNowMs, false );
+            }
+        }
+    }
+
+    /* Grow the block size while nothing is lost. */
+    pxWindow->ulCleanBlocks += ulCount;
+
+    if( ( pxWindow->ulCleanBlocks >= OTA_WINDOW_GROW_SHIFT_BLOCKS ) && ( pxWindow->ulShift < pxWindow->ulMaxShift ) )
+    {
+        pxWindow->ulShift++;
+        pxWindow->ulCleanBlocks = 0;
+    }
+
+    /* Slow start up to the threshold, then one block per window received. */
+    if( pxWindow->ulWindow < pxWindow->ulThreshold )
+    {
+        pxWindow->ulWindow += ulCount;
+    }
+    else
+    {
+        pxWindow->ulGrowth += ulCount;
+
+        if( pxWindow->ulGrowth >= pxWindow->ulWindow )
+        {
+            pxWindow->ulGrowth -= pxWindow->ulWindow;
+            pxWindow->ulWindow++;
+        }
+    }
+
+    if( pxWindow->ulWindow > pxWindow->ulMaxWindow )
+    {
+        pxWindow->ulWindow = pxWindow->ulMaxWindow;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t OTA_WindowTimeoutMs( const OTA_Window_t * pxWindow )
+{
+    return pxWindow->ulRtoMs;
+}
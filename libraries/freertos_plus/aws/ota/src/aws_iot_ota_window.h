@@ -0,0 +1,226 @@
+/*
+ * FreeRTOS OTA V1.1.1
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file aws_iot_ota_window.h
+ * @brief Sliding window of stream block requests.
+ *
+ * The window keeps several requests in flight on the stream service instead
+ * of waiting for each batch of blocks. It measures the round trip time of
+ * every request, halves the number of blocks in flight and falls back to the
+ * file block size when a block is lost, and grows both again while the
+ * blocks keep arriving. A block is lost when it times out, or as soon as
+ * blocks requested after it arrive since the service answers in order. Only blocks still missing from the receive bitmap and
+ * not already in flight are requested.
+ *
+ * Blocks are tracked in units of the file block size (the base block). A
+ * request may use a block size of up to 2^ulMaxShift base blocks; such large
+ * blocks are only requested when they are full and entirely missing, so a
+ * block received with a large size is never ambiguous with the short last
+ * block of the file.
+ *
+ * The module has no dependency on the kernel: the agent passes the time in
+ * milliseconds to each call.
+ */
+
+#ifndef __AWS_IOT_OTA_WINDOW__H__
+#define __AWS_IOT_OTA_WINDOW__H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Number of requests tracked at the same time. Also bounds the number
+ * of blocks of one request.
+ */
+#define OTA_WINDOW_MAX_SLOTS          32U
+
+/**
+ * @brief Size of the bitmap of one request.
+ */
+#define OTA_WINDOW_BITMAP_SIZE        ( OTA_WINDOW_MAX_SLOTS / 8U )
+
+/**
+ * @brief Largest block size of a request, as a power of two of the base block.
+ */
+#define OTA_WINDOW_MAX_SHIFT          2U
+
+/**
+ * @brief Bounds of the request timeout in milliseconds.
+ */
+#define OTA_WINDOW_MIN_RTO_MS         200U
+#define OTA_WINDOW_MAX_RTO_MS         30000U
+
+/**
+ * @brief Blocks requested later and received before a block is presumed lost.
+ */
+#define OTA_WINDOW_REORDER_BLOCKS     3U
+
+/**
+ * @brief Base blocks received without loss before the block size doubles.
+ */
+#define OTA_WINDOW_GROW_SHIFT_BLOCKS  32U
+
+/**
+ * @brief One request of the stream service, in units of ulBlockSize.
+ *
+ * Bit i of the bitmap (byte i / 8, bit i % 8) requests block
+ * ulBlockOffset + i.
+ */
+typedef struct OTA_WindowRequest
+{
+    uint32_t ulBlockSize;                           /**< Block size of the request in bytes. */
+    uint32_t ulBlockOffset;                         /**< Index of the block of bit 0. */
+    uint32_t ulBitmapSize;                          /**< Bytes of ucBitmap used. */
+    uint32_t ulNumBlocks;                           /**< Blocks requested. */
+    uint8_t ucBitmap[ OTA_WINDOW_BITMAP_SIZE ];     /**< Requested blocks. */
+} OTA_WindowRequest_t;
+
+/**
+ * @brief Window counters.
+ */
+typedef struct OTA_WindowStats
+{
+    uint32_t ulRequests;        /**< Requests built. */
+    uint32_t ulBlocksRequested; /**< Blocks requested, whatever their size. */
+    uint32_t ulTimeouts;        /**< Requested blocks not received within the timeout. */
+    uint32_t ulSkipped;         /**< Requested blocks presumed lost because later ones arrived. */
+    uint32_t ulRttSamples;      /**< Round trip times measured. */
+} OTA_WindowStats_t;
+
+/**
+ * @brief One requested block.
+ */
+typedef struct OTA_WindowSlot
+{
+    uint32_t ulBlock;   /**< Index in units of the base block << ucShift. */
+    uint32_t ulSentMs;    /**< Time of the last request. */
+    uint32_t ulSequence;  /**< Order of the request among all the blocks requested. */
+    uint8_t ucState;      /**< Free, in flight or expired. */
+    uint8_t ucShift;      /**< Block size of the request. */
+    uint8_t ucTries;      /**< Requests sent before this one. */
+    uint8_t ucLater;      /**< Blocks requested later already received. */
+} OTA_WindowSlot_t;
+
+/**
+ * @brief State of the window of one file.
+ */
+typedef struct OTA_Window
+{
+    uint32_t ulFileSize;
+    uint32_t ulNumBlocks;      /**< Base blocks in the file. */
+    uint32_t ulLog2BlockSize;  /**< Base block size. */
+    uint32_t ulMaxShift;       /**< Largest request block size. */
+    uint32_t ulMaxWindow;      /**< Largest number of base blocks in flight. */
+
+    uint32_t ulWindow;         /**< Base blocks allowed in flight. */
+    uint32_t ulThreshold;      /**< Window above which it grows linearly. */
+    uint32_t ulGrowth;         /**< Base blocks received toward the next linear step. */
+    uint32_t ulShift;          /**< Current request block size. */
+    uint32_t ulCleanBlocks;    /**< Base blocks received since the last loss. */
+    bool xReduced;             /**< The window was shrunk at ulRecoveryMs. */
+    uint32_t ulRecoveryMs;     /**< Losses of requests sent before this time do not shrink the window again. */
+
+    bool xRttValid;
+    uint32_t ulSrttMs;         /**< Smoothed round trip time. */
+    uint32_t ulRttVarMs;       /**< Round trip time variation. */
+    uint32_t ulRtoMs;          /**< Request timeout. */
+    uint32_t ulNextSequence;
+
+    OTA_WindowSlot_t xSlots[ OTA_WINDOW_MAX_SLOTS ];
+    OTA_WindowStats_t xStats;
+} OTA_Window_t;
+
+/**
+ * @brief Start the window of a new file.
+ *
+ * @param[in] ulFileSize Size of the file in bytes.
+ * @param[in] ulLog2BlockSize Base block size, the unit of the receive bitmap.
+ * @param[in] ulLog2MaxBlockSize Largest block size requested, clipped to
+ * OTA_WINDOW_MAX_SHIFT above the base block.
+ * @param[in] ulMaxWindow Largest number of base blocks in flight.
+ * @param[in] ulInitialRtoMs Request timeout until a round trip is measured.
+ */
+void OTA_WindowInit( OTA_Window_t * pxWindow,
+                     uint32_t ulFileSize,
+                     uint32_t ulLog2BlockSize,
+                     uint32_t ulLog2MaxBlockSize,
+                     uint32_t ulMaxWindow,
+                     uint32_t ulInitialRtoMs );
+
+/**
+ * @brief Build the next request filling the window.
+ *
+ * Requests older than the timeout are first counted as lost. Each call builds
+ * at most one request, of a single block size; call again until it returns 0
+ * to fill the window.
+ *
+ * @param[in] pucRxBitmap Receive bitmap of the file, a set bit is a missing
+ * base block.
+ * @param[in] ulNowMs Current time.
+ * @param[out] pxRequest Request to send.
+ *
+ * @return Number of blocks of the request, 0 if there is nothing to request
+ * now.
+ */
+uint32_t OTA_WindowRequest( OTA_Window_t * pxWindow,
+                            const uint8_t * pucRxBitmap,
+                            uint32_t ulNowMs,
+                            OTA_WindowRequest_t * pxRequest );
+
+/**
+ * @brief Find the base blocks carried by a received block.
+ *
+ * @param[in] ulBlockId Block index of the data message.
+ * @param[in] ulBlockSize Payload size of the data message.
+ * @param[out] pulFirst First base block.
+ * @param[out] pulCount Number of base blocks.
+ *
+ * @return false if the block is out of range or of an unexpected size.
+ */
+bool OTA_WindowBlockRange( const OTA_Window_t * pxWindow,
+                           uint32_t ulBlockId,
+                           uint32_t ulBlockSize,
+                           uint32_t * pulFirst,
+                           uint32_t * pulCount );
+
+/**
+ * @brief Account a block received, new or duplicate.
+ *
+ * @param[in] ulFirst First base block, from OTA_WindowBlockRange().
+ * @param[in] ulCount Number of base blocks.
+ * @param[in] ulNowMs Current time.
+ */
+void OTA_WindowReceived( OTA_Window_t * pxWindow,
+                         uint32_t ulFirst,
+                         uint32_t ulCount,
+                         uint32_t ulNowMs );
+
+/**
+ * @brief Current request timeout, the period of the request timer.
+ */
+uint32_t OTA_WindowTimeoutMs( const OTA_Window_t * pxWindow );
+
+#endif /* ifndef __AWS_IOT_OTA_WINDOW__H__ */
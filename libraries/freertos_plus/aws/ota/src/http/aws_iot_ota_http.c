@@ -1075,9 +1075,6 @@ OTA_Err_t _AwsIotOTA_RequestDataBlock_HTTP( OTA_AgentContext_t * pAgentCtx )
         OTA_GOTO_CLEANUP();
     }
 
-    /* Set number of blocks to request to 1. */
-    pAgentCtx->ulNumOfBlocksToReceive = 1;
-
     /* Calculate ranges. */
     rangeStart = _httpDownloader.currBlock * OTA_FILE_BLOCK_SIZE;
 
@@ -49,114 +49,122 @@ typedef struct OTAMessageDecodeContext
 } OTAMessageDecodeContext_t, * OTAMessageDecodeContextPtr_t;
 
 /**
- * @brief Decode a Get Stream response message from AWS IoT OTA.
+ * @brief Keys of the Get Stream response found in the message.
  */
-BaseType_t OTA_CBOR_Decode_GetStreamResponseMessage( const uint8_t * pucMessageBuffer,
-                                                     size_t xMessageSize,
-                                                     int32_t * plFileId,
-                                                     int32_t * plBlockId,
-                                                     int32_t * plBlockSize,
-                                                     uint8_t ** ppucPayload,
-                                                     size_t * pxPayloadSize )
-{
-    CborError xCborResult = CborNoError;
-    CborParser xCborParser;
-    CborValue xCborValue, xCborMap;
+#define OTA_CBOR_FOUND_FILEID         0x01U
+#define OTA_CBOR_FOUND_BLOCKID        0x02U
+#define OTA_CBOR_FOUND_BLOCKSIZE      0x04U
+#define OTA_CBOR_FOUND_BLOCKPAYLOAD   0x08U
+#define OTA_CBOR_FOUND_ALL            0x0FU
 
-    /* Initialize the parser. */
-    xCborResult = cbor_parser_init( pucMessageBuffer,
-                                    xMessageSize,
-                                    0,
-                                    &xCborParser,
-                                    &xCborMap );
+/**
+ * @brief Check whether a map key is the given text string.
+ */
+static bool prvIsKey( const CborValue * pxKey,
+                      const char * pcKey )
+{
+    bool xMatch = false;
 
-    /* Get the outer element and confirm that it's a "map," i.e., a set of
-     * CBOR key/value pairs. */
-    if( CborNoError == xCborResult )
+    if( true == cbor_value_is_text_string( pxKey ) )
     {
-        if( false == cbor_value_is_map( &xCborMap ) )
+        if( CborNoError != cbor_value_text_string_equals( pxKey, pcKey, &xMatch ) )
         {
-            xCborResult = CborErrorIllegalType;
+            xMatch = false;
         }
     }
 
-    /* Find the file ID. */
-    if( CborNoError == xCborResult )
-    {
-        xCborResult = cbor_value_map_find_value( &xCborMap,
-                                                 OTA_CBOR_FILEID_KEY,
-                                                 &xCborValue );
-    }
+    return xMatch;
+}
 
-    if( CborNoError == xCborResult )
-    {
-        if( CborIntegerType != cbor_value_get_type( &xCborValue ) )
-        {
-            xCborResult = CborErrorIllegalType;
-        }
-    }
+/**
+ * @brief Read an integer value of the response.
+ */
+static CborError prvDecodeInteger( const CborValue * pxValue,
+                                   int32_t * plInteger )
+{
+    CborError xCborResult = CborErrorIllegalType;
 
-    if( CborNoError == xCborResult )
+    if( CborIntegerType == cbor_value_get_type( pxValue ) )
     {
-        xCborResult = cbor_value_get_int( &xCborValue,
-                                          ( int * ) plFileId );
+        xCborResult = cbor_value_get_int( pxValue,
+                                          ( int * ) plInteger );
     }
 
-    /* Find the block ID. */
-    if( CborNoError == xCborResult )
-    {
-        xCborResult = cbor_value_map_find_value( &xCborMap,
-                                                 OTA_CBOR_BLOCKID_KEY,
-                                                 &xCborValue );
-    }
+    return xCborResult;
+}
 
-    if( CborNoError == xCborResult )
-    {
-        if( CborIntegerType != cbor_value_get_type( &xCborValue ) )
-        {
-            xCborResult = CborErrorIllegalType;
-        }
-    }
+/**
+ * @brief Locate a byte string value in the message buffer, without copying it.
+ *
+ * Only a definite length string is contiguous in the message; a string sent in
+ * chunks is rejected.
+ */
+static CborError prvDecodeByteStringInPlace( const CborValue * pxValue,
+                                             uint8_t ** ppucBytes,
+                                             size_t * pxSize )
+{
+    CborError xCborResult = CborNoError;
+    CborValue xCborNext = *pxValue;
 
-    if( CborNoError == xCborResult )
+    if( false == cbor_value_is_byte_string( pxValue ) )
     {
-        xCborResult = cbor_value_get_int( &xCborValue,
-                                          ( int * ) plBlockId );
+        xCborResult = CborErrorIllegalType;
     }
-
-    /* Find the block size. */
-    if( CborNoError == xCborResult )
+    else if( false == cbor_value_is_length_known( pxValue ) )
     {
-        xCborResult = cbor_value_map_find_value( &xCborMap,
-                                                 OTA_CBOR_BLOCKSIZE_KEY,
-                                                 &xCborValue );
+        xCborResult = CborErrorUnknownLength;
     }
-
-    if( CborNoError == xCborResult )
+    else
     {
-        if( CborIntegerType != cbor_value_get_type( &xCborValue ) )
-        {
-            xCborResult = CborErrorIllegalType;
-        }
+        xCborResult = cbor_value_get_string_length( pxValue, pxSize );
     }
 
+    /* The string ends where the next item starts. */
     if( CborNoError == xCborResult )
     {
-        xCborResult = cbor_value_get_int( &xCborValue,
-                                          ( int * ) plBlockSize );
+        xCborResult = cbor_value_advance( &xCborNext );
     }
 
-    /* Find the payload bytes. */
     if( CborNoError == xCborResult )
     {
-        xCborResult = cbor_value_map_find_value( &xCborMap,
-                                                 OTA_CBOR_BLOCKPAYLOAD_KEY,
-                                                 &xCborValue );
+        *ppucBytes = ( uint8_t * ) cbor_value_get_next_byte( &xCborNext ) - *pxSize;
     }
 
+    return xCborResult;
+}
+
+/**
+ * @brief Decode a Get Stream response message from AWS IoT OTA.
+ *
+ * The map is walked once and the block payload is not copied: *ppucPayload
+ * points into pucMessageBuffer, which must be kept until the payload is
+ * consumed.
+ */
+BaseType_t OTA_CBOR_Decode_GetStreamResponseMessage( const uint8_t * pucMessageBuffer,
+                                                     size_t xMessageSize,
+                                                     int32_t * plFileId,
+                                                     int32_t * plBlockId,
+                                                     int32_t * plBlockSize,
+                                                     uint8_t ** ppucPayload,
+                                                     size_t * pxPayloadSize )
+{
+    CborError xCborResult = CborNoError;
+    CborParser xCborParser;
+    CborValue xCborMap, xCborKey, xCborValue;
+    uint32_t ulFound = 0;
+
+    /* Initialize the parser. */
+    xCborResult = cbor_parser_init( pucMessageBuffer,
+                                    xMessageSize,
+                                    0,
+                                    &xCborParser,
+                                    &xCborMap );
+
+    /* Get the outer element and confirm that it's a "map," i.e., a set of
+     * CBOR key/value pairs. */
     if( CborNoError == xCborResult )
     {
-        if( CborByteStringType != cbor_value_get_type( &xCborValue ) )
+        if( false == cbor_value_is_map( &xCborMap ) )
         {
             xCborResult = CborErrorIllegalType;
         }
@@ -164,26 +172,57 @@ BaseType_t OTA_CBOR_Decode_GetStreamResponseMessage( const uint8_t * pucMessageB
 
     if( CborNoError == xCborResult )
     {
-        xCborResult = cbor_value_calculate_string_length( &xCborValue,
-                                                          pxPayloadSize );
+        xCborResult = cbor_value_enter_container( &xCborMap, &xCborKey );
     }
 
-    if( CborNoError == xCborResult )
+    /* Visit each key/value pair and keep the ones of the response. */
+    while( ( CborNoError == xCborResult ) &&
+           ( false == cbor_value_at_end( &xCborKey ) ) )
     {
-        *ppucPayload = pvPortMalloc( *pxPayloadSize );
+        xCborValue = xCborKey;
+        xCborResult = cbor_value_advance( &xCborValue );
 
-        if( NULL == *ppucPayload )
+        if( CborNoError == xCborResult )
         {
-            xCborResult = CborErrorOutOfMemory;
+            if( true == prvIsKey( &xCborKey, OTA_CBOR_FILEID_KEY ) )
+            {
+                xCborResult = prvDecodeInteger( &xCborValue, plFileId );
+                ulFound |= OTA_CBOR_FOUND_FILEID;
+            }
+            else if( true == prvIsKey( &xCborKey, OTA_CBOR_BLOCKID_KEY ) )
+            {
+                xCborResult = prvDecodeInteger( &xCborValue, plBlockId );
+                ulFound |= OTA_CBOR_FOUND_BLOCKID;
+            }
+            else if( true == prvIsKey( &xCborKey, OTA_CBOR_BLOCKSIZE_KEY ) )
+            {
+                xCborResult = prvDecodeInteger( &xCborValue, plBlockSize );
+                ulFound |= OTA_CBOR_FOUND_BLOCKSIZE;
+            }
+            else if( true == prvIsKey( &xCborKey, OTA_CBOR_BLOCKPAYLOAD_KEY ) )
+            {
+                xCborResult = prvDecodeByteStringInPlace( &xCborValue, ppucPayload, pxPayloadSize );
+                ulFound |= OTA_CBOR_FOUND_BLOCKPAYLOAD;
+            }
+            else
+            {
+                /* Not a field of the response, skip it. */
+            }
+        }
+
+        /* Move to the next key. */
+        if( CborNoError == xCborResult )
+        {
+            xCborKey = xCborValue;
+            xCborResult = cbor_value_advance( &xCborKey );
         }
     }
 
-    if( CborNoError == xCborResult )
+    /* All the fields are required. */
+    if( ( CborNoError == xCborResult ) &&
+        ( OTA_CBOR_FOUND_ALL != ulFound ) )
     {
-        xCborResult = cbor_value_copy_byte_string( &xCborValue,
-                                                   *ppucPayload,
-                                                   pxPayloadSize,
-                                                   NULL );
+        xCborResult = CborErrorIllegalType;
     }
 
     return CborNoError == xCborResult;
@@ -28,6 +28,9 @@
 
 /**
  * @brief Decode a Get Stream response message from AWS IoT OTA.
+ *
+ * Nothing is allocated or copied: *ppucPayload points to the block payload
+ * inside pucMessageBuffer.
  */
 BaseType_t OTA_CBOR_Decode_GetStreamResponseMessage( const uint8_t * pucMessageBuffer,
                                                      size_t xMessageSize,
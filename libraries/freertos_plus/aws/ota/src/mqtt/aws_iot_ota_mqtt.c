@@ -440,7 +440,9 @@ static void prvDataPublishCallback( void * pvCallbackContext,
     /* Do nothing if this callback is invoked when the OTA agent is stopped. */
     if( ( ( OTA_AgentContext_t * ) pvCallbackContext )->eState != eOTA_AgentState_Stopped )
     {
-        /* Queue the event for processing received file block. */
+        /* The block is copied into a slab event buffer without waiting for the
+         * agent, the MQTT task pool worker is not blocked. The agent decodes
+         * it in place in the event buffer. */
         prvSendCallbackEvent( pvCallbackContext, pxPublishData, eOTA_AgentEvent_ReceivedFileBlock );
     }
 }
@@ -747,9 +749,11 @@ OTA_Err_t prvRequestFileBlock_Mqtt( OTA_AgentContext_t * pxAgentCtx )
 
     uint32_t ulMsgSizeToPublish;
     size_t xMsgSizeFromStream;
-    uint32_t ulNumBlocks, ulBitmapLen, ulTopicLen;
+    uint32_t ulTopicLen;
+    uint32_t ulNowMs;
     IotMqttError_t eResult;
     OTA_Err_t xErr = kOTA_Err_None;
+    OTA_WindowRequest_t xRequest;
     char pcMsg[ OTA_REQUEST_MSG_MAX_SIZE ];
     char pcTopicBuffer[ OTA_MAX_TOPIC_LEN ];
 
@@ -758,80 +762,71 @@ OTA_Err_t prvRequestFileBlock_Mqtt( OTA_AgentContext_t * pxAgentCtx )
      */
     OTA_FileContext_t * C = &( pxAgentCtx->pxOTA_Files[ pxAgentCtx->ulFileIndex ] );
 
-    /* Reset number of blocks requested. */
-    pxAgentCtx->ulNumOfBlocksToReceive = otaconfigMAX_NUM_BLOCKS_REQUEST;
-
-    if( C != NULL )
+    if( ( C != NULL ) && ( C->pucRxBlockBitmap != NULL ) )
     {
-        ulNumBlocks = ( C->ulFileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
-        ulBitmapLen = ( ulNumBlocks + ( BITS_PER_BYTE - 1U ) ) >> LOG2_BITS_PER_BYTE;
-
-        if( pdTRUE == OTA_CBOR_Encode_GetStreamRequestMessage(
-                ( uint8_t * ) pcMsg,
-                sizeof( pcMsg ),
-                &xMsgSizeFromStream,
-                OTA_CLIENT_TOKEN,
-                ( int32_t ) C->ulServerFileID,
-                ( int32_t ) ( OTA_FILE_BLOCK_SIZE & 0x7fffffffUL ), /* Mask to keep lint happy. It's still a constant. */
-                0,
-                C->pucRxBlockBitmap,
-                ulBitmapLen,
-                otaconfigMAX_NUM_BLOCKS_REQUEST ) )
+        ulNowMs = ( uint32_t ) ( xTaskGetTickCount() * portTICK_PERIOD_MS );
+
+        /* Fill the request window. Each request only asks for blocks still missing and not
+         * already in flight, so a full window sends nothing. A request that fails to publish
+         * stays in the window until it times out, which also shrinks the window. */
+        while( ( xErr == kOTA_Err_None ) &&
+               ( OTA_WindowRequest( &pxAgentCtx->xWindow, C->pucRxBlockBitmap, ulNowMs, &xRequest ) > 0U ) )
         {
-            ulMsgSizeToPublish = ( uint32_t ) xMsgSizeFromStream;
+            if( pdTRUE == OTA_CBOR_Encode_GetStreamRequestMessage(
+                    ( uint8_t * ) pcMsg,
+                    sizeof( pcMsg ),
+                    &xMsgSizeFromStream,
+                    OTA_CLIENT_TOKEN,
+                    ( int32_t ) C->ulServerFileID,
+                    ( int32_t ) ( xRequest.ulBlockSize & 0x7fffffffUL ),
+                    ( int32_t ) ( xRequest.ulBlockOffset & 0x7fffffffUL ),
+                    xRequest.ucBitmap,
+                    xRequest.ulBitmapSize,
+                    ( int32_t ) xRequest.ulNumBlocks ) )
+            {
+                ulMsgSizeToPublish = ( uint32_t ) xMsgSizeFromStream;
 
-            /* Try to build the dynamic data REQUEST topic and subscribe to it. */
-            ulTopicLen = ( uint32_t ) snprintf( pcTopicBuffer, /*lint -e586 Intentionally using snprintf. */
-                                                sizeof( pcTopicBuffer ),
-                                                pcOTA_GetStream_TopicTemplate,
-                                                pxAgentCtx->pcThingName,
-                                                ( const char * ) C->pucStreamName );
+                /* Try to build the dynamic data REQUEST topic and subscribe to it. */
+                ulTopicLen = ( uint32_t ) snprintf( pcTopicBuffer, /*lint -e586 Intentionally using snprintf. */
+                                                    sizeof( pcTopicBuffer ),
+                                                    pcOTA_GetStream_TopicTemplate,
+                                                    pxAgentCtx->pcThingName,
+                                                    ( const char * ) C->pucStreamName );
 
-            if( ( ulTopicLen > 0U ) && ( ulTopicLen < sizeof( pcTopicBuffer ) ) )
-            {
-                eResult = prvPublishMessage(
-                    pxAgentCtx,
-                    pcTopicBuffer,
-                    ( uint16_t ) ulTopicLen,
-                    &pcMsg[ 0 ],
-                    ulMsgSizeToPublish,
-                    IOT_MQTT_QOS_0 );
-
-                if( eResult != IOT_MQTT_SUCCESS )
+                if( ( ulTopicLen > 0U ) && ( ulTopicLen < sizeof( pcTopicBuffer ) ) )
                 {
-                    OTA_LOG_L1( "[%s] Failed: %s\r\n", OTA_METHOD_NAME, pcTopicBuffer );
-                    xErr = kOTA_Err_PublishFailed;
+                    eResult = prvPublishMessage(
+                        pxAgentCtx,
+                        pcTopicBuffer,
+                        ( uint16_t ) ulTopicLen,
+                        &pcMsg[ 0 ],
+                        ulMsgSizeToPublish,
+                        IOT_MQTT_QOS_0 );
+
+                    if( eResult != IOT_MQTT_SUCCESS )
+                    {
+                        OTA_LOG_L1( "[%s] Failed: %s\r\n", OTA_METHOD_NAME, pcTopicBuffer );
+                        xErr = kOTA_Err_PublishFailed;
+                    }
+                    else
+                    {
+                        OTA_LOG_L1( "[%s] OK: %s, %u blocks of %u from %u\r\n", OTA_METHOD_NAME, pcTopicBuffer,
+                                    xRequest.ulNumBlocks, xRequest.ulBlockSize, xRequest.ulBlockOffset );
+                    }
                 }
                 else
                 {
-                    OTA_LOG_L1( "[%s] OK: %s\r\n", OTA_METHOD_NAME, pcTopicBuffer );
+                    /* 0 should never happen since we supply the format strings. It must be overflow. */
+                    OTA_LOG_L1( "[%s] Failed to build stream topic!\r\n", OTA_METHOD_NAME );
+                    xErr = kOTA_Err_TopicTooLarge;
                 }
-
-                /* Restart the timer regardless if we published the Get Stream Request message
-                 * or not.
-                 *
-                 * If we published the message, then the timer will be used to time
-                 * out the OTA not continuing again.
-                 *
-                 * If we failed to publish the message, then
-                 * the timer will be used to retry publishing the message again later.
-                 *
-                 * In both cases the max momentum, if reached, will be used to stop publishing
-                 * the Get Stream Request message. */
-                /*prvStartRequestTimer(C);*/
             }
             else
             {
-                /* 0 should never happen since we supply the format strings. It must be overflow. */
-                OTA_LOG_L1( "[%s] Failed to build stream topic!\r\n", OTA_METHOD_NAME );
-                xErr = kOTA_Err_TopicTooLarge;
+                OTA_LOG_L1( "[%s] CBOR encode failed.\r\n", OTA_METHOD_NAME );
+                xErr = kOTA_Err_FailedToEncodeCBOR;
             }
         }
-        else
-        {
-            OTA_LOG_L1( "[%s] CBOR encode failed.\r\n", OTA_METHOD_NAME );
-            xErr = kOTA_Err_FailedToEncodeCBOR;
-        }
     }
 
     return xErr;
@@ -858,20 +853,13 @@ OTA_Err_t prvDecodeFileBlock_Mqtt( uint8_t * pucMessageBuffer,
             plFileId,
             plBlockId,   /*lint !e9087 CBOR requires pointer to int and our block index's never exceed 31 bits. */
             plBlockSize, /*lint !e9087 CBOR requires pointer to int and our block sizes never exceed 31 bits. */
-            ppucPayload, /* This payload gets malloc'd by OTA_CBOR_Decode_GetStreamResponseMessage(). We must free it. */
+            ppucPayload, /* The payload is left in place in the message buffer. */
             pxPayloadSize ) )
     {
         xErr = kOTA_Err_GenericIngestError;
     }
     else
     {
-        /* Decode the CBOR content. */
-        memcpy( pucMessageBuffer, *ppucPayload, *pxPayloadSize );
-
-        /* Free the payload as it is copied in data buffer. */
-        vPortFree( *ppucPayload );
-        *ppucPayload = pucMessageBuffer;
-
         xErr = kOTA_Err_None;
     }
 
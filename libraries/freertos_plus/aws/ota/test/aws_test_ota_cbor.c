@@ -556,11 +556,11 @@ TEST( Full_OTA_CBOR, CborOtaApi )
         &xPayloadSize );
     TEST_ASSERT_TRUE( xResult );
 
-    if( NULL != pucPayload )
-    {
-        vPortFree( pucPayload );
-        pucPayload = NULL;
-    }
+    /* The payload is decoded in place. */
+    TEST_ASSERT_TRUE( pucPayload > ucCborWork );
+    TEST_ASSERT_TRUE( pucPayload + xPayloadSize <= ucCborWork + xEncodedSize );
+    TEST_ASSERT_EQUAL( sizeof( ucBlockPayload ), xPayloadSize );
+    TEST_ASSERT_EQUAL_MEMORY( ucBlockPayload, pucPayload, xPayloadSize );
 }
 
 TEST( Full_OTA_CBOR, CborOtaAgentIngestStreamResponse )
@@ -722,12 +722,6 @@ TEST( Quarantine_OTA_CBOR, CborOtaServerFiles )
             &xBufferSize );
         TEST_ASSERT_TRUE( xResultBool );
 
-        /* Free the previous chunk buffer. */
-        if( NULL != pucPayload )
-        {
-            vPortFree( pucPayload );
-        }
-
         /* Parse the chunk message. */
         xResultBool = OTA_CBOR_Decode_GetStreamResponseMessage(
             pucInFile,
@@ -753,9 +747,4 @@ TEST( Quarantine_OTA_CBOR, CborOtaServerFiles )
     {
         vPortFree( pucInFile );
     }
-
-    if( NULL != pucPayload )
-    {
-        vPortFree( pucPayload );
-    }
 }
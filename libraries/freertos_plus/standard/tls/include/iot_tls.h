@@ -84,6 +84,9 @@ typedef BaseType_t ( * NetworkSend_t )( void * pvCallerContext,
  * @param[in] pxNetworkSend Caller-defined network send function pointer.
  * @param[in] pvCallerContext Caller-defined context handle to be used with callback
  * functions.
+ * @param[in] ulMaxFragmentLength Maximum fragment length requested from the
+ * server: 512, 1024, 2048 or 4096 bytes, 0 for tlsMAX_FRAGMENT_LENGTH. It
+ * cannot exceed MBEDTLS_SSL_IN_CONTENT_LEN nor MBEDTLS_SSL_OUT_CONTENT_LEN.
  */
 typedef struct xTLS_PARAMS
 {
@@ -97,8 +100,144 @@ typedef struct xTLS_PARAMS
     NetworkRecv_t pxNetworkRecv;
     NetworkSend_t pxNetworkSend;
     void * pvCallerContext;
+
+    uint32_t ulMaxFragmentLength;
 } TLSParams_t;
 
+/**
+ * @brief Maximum fragment length requested when TLSParams_t gives none, 0 to
+ * request none.
+ *
+ * A server accepting the request (RFC 6066) sends no record larger than this
+ * length, so mbedTLS can be built with an input buffer smaller than the 16 KB
+ * of the protocol. mbedTLS does not reassemble a handshake message split over
+ * several records: the certificate chain of the server must fit in one
+ * fragment. Sent records are limited to this length too.
+ */
+#ifndef tlsMAX_FRAGMENT_LENGTH
+    #define tlsMAX_FRAGMENT_LENGTH    ( 0 )
+#endif
+
+/**
+ * @brief Number of tasks whose TLS_Connect can be accounted for at once by
+ * TLS_HeapTraceMalloc() and TLS_HeapTraceFree().
+ */
+#ifndef tlsHEAP_TRACE_TASKS
+    #define tlsHEAP_TRACE_TASKS    ( 4 )
+#endif
+
+/**
+ * @brief Largest serialized session exchanged with a TLSSessionStore_t, in
+ * bytes. A session with a longer ticket is not stored.
+ */
+#ifndef tlsSESSION_MAX_LENGTH
+    #define tlsSESSION_MAX_LENGTH    ( 512 )
+#endif
+
+/**
+ * @brief Number of trust anchor lists kept parsed between connections.
+ *
+ * The default root certificates take one entry, each server certificate
+ * override given in TLSParams_t another one. A connection whose list finds
+ * no free entry parses its own copy, as with a cache of 0 entries.
+ */
+#ifndef tlsCERTIFICATE_CACHE_ENTRIES
+    #define tlsCERTIFICATE_CACHE_ENTRIES    ( 2 )
+#endif
+
+/**
+ * @brief Latency trace of the record protection done by TLS_Send.
+ *
+ * tlsTRACE_TIMESTAMP() returns a free running 32-bit counter and
+ * tlsTRACE_ENCRYPT( ulTicks ) receives the counter ticks spent in TLS_Send,
+ * network sends excluded. Both do nothing by default.
+ */
+#ifndef tlsTRACE_TIMESTAMP
+    #define tlsTRACE_TIMESTAMP()         ( 0U )
+#endif
+#ifndef tlsTRACE_ENCRYPT
+    #define tlsTRACE_ENCRYPT( ulTicks )  ( ( void ) ( ulTicks ) )
+#endif
+
+/**
+ * @brief Persistent storage of TLS sessions, keyed by server name.
+ *
+ * When a store is registered, TLS_Connect offers the session saved for the
+ * destination, by session ID or session ticket, and saves the session that
+ * was negotiated. A server that accepts it skips the certificate exchange
+ * and key agreement of a full handshake.
+ *
+ * The session holds the master secret of the connection: it must be kept
+ * where only the device can read it. The callbacks are called by the task
+ * running TLS_Connect, concurrently if several tasks connect at once.
+ */
+typedef struct TLSSessionStore
+{
+    /**
+     * @brief Copy the session saved for @p pcEndpoint.
+     *
+     * @param[in] pvContext Context of the store.
+     * @param[in] pcEndpoint Server name given in TLSParams_t.
+     * @param[out] pucSession Buffer of tlsSESSION_MAX_LENGTH bytes.
+     * @param[out] pxSessionLength Length of the session.
+     *
+     * @return pdTRUE if a session was found.
+     */
+    BaseType_t ( * xLoad )( void * pvContext,
+                            const char * pcEndpoint,
+                            unsigned char * pucSession,
+                            size_t * pxSessionLength );
+
+    /**
+     * @brief Save the session of @p pcEndpoint, replacing any previous one.
+     * A length of 0 forgets the session.
+     *
+     * @return pdTRUE on success.
+     */
+    BaseType_t ( * xSave )( void * pvContext,
+                            const char * pcEndpoint,
+                            const unsigned char * pucSession,
+                            size_t xSessionLength );
+
+    void * pvContext;
+} TLSSessionStore_t;
+
+/**
+ * @brief Handshake counters, since boot.
+ *
+ * Bytes are counted in both directions at the network interface, time from
+ * the ClientHello to the Finished message.
+ */
+typedef struct TLSHandshakeStats
+{
+    uint32_t ulFull;              /**< Full handshakes completed. */
+    uint32_t ulResumed;           /**< Abbreviated handshakes completed. */
+    uint32_t ulFailed;            /**< Handshakes that did not complete. */
+    uint32_t ulFullBytes;         /**< Bytes exchanged by full handshakes. */
+    uint32_t ulResumedBytes;      /**< Bytes exchanged by abbreviated handshakes. */
+    uint32_t ulFullMs;            /**< Time spent in full handshakes. */
+    uint32_t ulResumedMs;         /**< Time spent in abbreviated handshakes. */
+    uint32_t ulCertificateHits;   /**< Certificate chains taken from the cache. */
+    uint32_t ulCertificateParses; /**< Certificate chains parsed. */
+} TLSHandshakeStats_t;
+
+/**
+ * @brief Memory used by one TLS context.
+ *
+ * The heap counters cover the allocations made while TLS_Connect runs, kept
+ * until the context is cleaned up, except the certificates shared through the
+ * cache. They are only updated when the FreeRTOS heap reports its blocks to
+ * TLS_HeapTraceMalloc() and TLS_HeapTraceFree().
+ */
+typedef struct TLSMemoryStats
+{
+    uint32_t ulInContentLength;   /**< Largest record received, MBEDTLS_SSL_IN_CONTENT_LEN. */
+    uint32_t ulOutContentLength;  /**< Largest record sent, MBEDTLS_SSL_OUT_CONTENT_LEN. */
+    uint32_t ulMaxFragmentLength; /**< Maximum fragment length requested, 0 if none. */
+    uint32_t ulHeapCurrent;       /**< Heap held by the connection. */
+    uint32_t ulHeapPeak;          /**< Most heap held at once, during the handshake. */
+} TLSMemoryStats_t;
+
 /**
  * @brief Initializes the TLS context.
  *
@@ -133,6 +272,19 @@ BaseType_t TLS_Recv( void * pvContext,
                      unsigned char * pucReadBuffer,
                      size_t xReadLength );
 
+/**
+ * @brief Number of decrypted bytes buffered in the secure connection.
+ *
+ * These bytes are returned by TLS_Recv without reading the network, so a
+ * caller waiting for network readiness must check them first.
+ *
+ * @param pvContext Opaque context handle for TLS library.
+ *
+ * @return Number of bytes available, 0 if none or if the context is not
+ * connected.
+ */
+size_t TLS_Pending( void * pvContext );
+
 /**
  * @brief Writes the requested number of bytes to the secure connection.
  *
@@ -153,4 +305,62 @@ BaseType_t TLS_Send( void * pvContext,
  */
 void TLS_Cleanup( void * pvContext );
 
+/**
+ * @brief Register the store used to resume sessions.
+ *
+ * @param pxStore Store, must remain valid. NULL disables resumption.
+ */
+void TLS_SetSessionStore( const TLSSessionStore_t * pxStore );
+
+/**
+ * @brief Copy the handshake counters.
+ *
+ * @param pxStats Destination of the counters.
+ */
+void TLS_GetHandshakeStats( TLSHandshakeStats_t * pxStats );
+
+/**
+ * @brief Drop the certificates kept parsed between connections.
+ *
+ * The trust anchors and the client certificate chain are parsed by the first
+ * TLS_Connect using them, then shared by the following connections. This
+ * must be called once the device or JITR certificate was provisioned again,
+ * e.g. by the PKCS #11 PAL when it saves the device certificate or key, or
+ * once the memory of the server certificate overrides was reused. Chains in
+ * use by a handshake are freed at its end.
+ */
+void TLS_FlushCertificateCache( void );
+
+/**
+ * @brief Copy the memory counters of a context.
+ *
+ * @param pvContext Opaque context handle for TLS library.
+ * @param pxStats Destination of the counters.
+ */
+void TLS_GetMemoryStats( void * pvContext,
+                         TLSMemoryStats_t * pxStats );
+
+/**
+ * @brief Account a heap block to the context connecting in the calling task.
+ *
+ * Meant for traceMALLOC() of the FreeRTOS heap, with the size of the block.
+ * Called with the scheduler suspended.
+ *
+ * @param pvAddress Allocated block, NULL if the allocation failed.
+ * @param xSize Size of the block.
+ */
+void TLS_HeapTraceMalloc( void * pvAddress,
+                          size_t xSize );
+
+/**
+ * @brief Release a heap block accounted by TLS_HeapTraceMalloc().
+ *
+ * Meant for traceFREE() of the FreeRTOS heap.
+ *
+ * @param pvAddress Freed block.
+ * @param xSize Size of the block.
+ */
+void TLS_HeapTraceFree( void * pvAddress,
+                        size_t xSize );
+
 #endif /* ifndef __AWS__TLS__H__ */
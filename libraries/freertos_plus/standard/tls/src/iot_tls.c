@@ -31,6 +31,7 @@
 #include "iot_pkcs11_config.h"
 #include "iot_pkcs11.h"
 #include "task.h"
+#include "semphr.h"
 #include "aws_clientcredential_keys.h"
 #include "iot_default_root_certificates.h"
 #include "iot_pki_utils.h"
@@ -52,6 +53,7 @@
 #include "mbedtls_error.h"
 
 /* C runtime includes. */
+#include <stddef.h>
 #include <string.h>
 #include <time.h>
 #include <stdio.h>
@@ -96,10 +98,19 @@ static const char * pNoLowLevelMbedTlsCodeStr = "<No-Low-Level-Code>";
  * @param[in] xNetworkSend Callback for sending data on an open TCP socket.
  * @param[in] pvCallerContext Opaque pointer provided by caller for above callbacks.
  * @param[out] xTLSHandshakeState Indicates the state of the TLS handshake.
+ * @param[out] ulHandshakeBytes Bytes sent and received during the handshake.
+ * @param[in] ulMaxFragmentLength Maximum fragment length requested, 0 if none.
+ * @param[in] ucMaxFragmentLengthCode Code of ulMaxFragmentLength for mbedTLS.
+ * @param[out] xHeapCurrent Heap accounted to the connection.
+ * @param[out] xHeapPeak Highest value of xHeapCurrent.
  * @param[out] xMbedSslCtx Connection context for mbedTLS.
  * @param[out] xMbedSslConfig Configuration context for mbedTLS.
  * @param[out] xMbedX509CA Server certificate context for mbedTLS.
  * @param[out] xMbedX509Cli Client certificate context for mbedTLS.
+ * @param[out] pxTrustAnchors Cached server certificates, used instead of
+ * xMbedX509CA when not NULL.
+ * @param[out] pxClientCertificates Cached client certificates, used instead of
+ * xMbedX509Cli when not NULL.
  * @param[out] mbedPkAltCtx RSA crypto implementation context for mbedTLS.
  * @param[out] pxP11FunctionList PKCS#11 function list structure.
  * @param[out] xP11Session PKCS#11 session context.
@@ -117,12 +128,22 @@ typedef struct TLSContext
     NetworkSend_t xNetworkSend;
     void * pvCallerContext;
     BaseType_t xTLSHandshakeState;
+    uint32_t ulHandshakeBytes;
+    uint32_t ulNetworkTicks;
+    uint32_t ulMaxFragmentLength;
+    unsigned char ucMaxFragmentLengthCode;
+
+    /* Heap accounting. */
+    size_t xHeapCurrent;
+    size_t xHeapPeak;
 
     /* mbedTLS. */
     mbedtls_ssl_context xMbedSslCtx;
     mbedtls_ssl_config xMbedSslConfig;
     mbedtls_x509_crt xMbedX509CA;
     mbedtls_x509_crt xMbedX509Cli;
+    struct TLSCertificateCacheEntry * pxTrustAnchors;
+    struct TLSCertificateCacheEntry * pxClientCertificates;
     mbedtls_pk_context xMbedPkCtx;
     mbedtls_pk_info_t xMbedPkInfo;
 
@@ -139,12 +160,223 @@ typedef struct TLSContext
 
 #define TLS_PRINT( X )    vLoggingPrintf X
 
+/**
+ * @brief Version of the serialized session layout.
+ */
+#define tlsSESSION_FORMAT_VERSION    ( 1U )
+
+/**
+ * @brief Length of a serialized session without its ticket.
+ */
+#define tlsSESSION_HEADER_LENGTH     ( 98U )
+
+/**
+ * @brief Offset of the master secret in a serialized session.
+ */
+#define tlsSESSION_MASTER_OFFSET     ( 37U )
+
+#if ( tlsCERTIFICATE_CACHE_ENTRIES < 1 )
+    #error "tlsCERTIFICATE_CACHE_ENTRIES must be at least 1"
+#endif
+
+#if ( tlsMAX_FRAGMENT_LENGTH != 0 ) && !defined( MBEDTLS_SSL_MAX_FRAGMENT_LENGTH )
+    #error "tlsMAX_FRAGMENT_LENGTH requires MBEDTLS_SSL_MAX_FRAGMENT_LENGTH"
+#endif
+
+/**
+ * @brief Context whose TLS_Connect runs in a task, see TLS_HeapTraceMalloc.
+ */
+typedef struct TLSHeapTraceOwner
+{
+    TaskHandle_t xTask;    /**< Task running TLS_Connect, NULL if the slot is free. */
+    TLSContext_t * pxCtx;  /**< Context charged. */
+} TLSHeapTraceOwner_t;
+
+/**
+ * @brief Tasks running TLS_Connect.
+ */
+static TLSHeapTraceOwner_t xHeapTraceOwners[ tlsHEAP_TRACE_TASKS ];
+
+/**
+ * @brief Certificate chain parsed once and shared by the connections.
+ *
+ * An entry is reused for another chain only when no handshake uses it. A
+ * flushed entry that is in use can no longer be found, and its chain is freed
+ * by the last handshake using it.
+ */
+typedef struct TLSCertificateCacheEntry
+{
+    const char * pcSource;   /**< Certificates the chain was parsed from, NULL for the defaults. */
+    uint32_t ulSourceLength; /**< Length of pcSource. */
+    uint32_t ulSourceHash;   /**< Hash of pcSource, tells a reused buffer. */
+    uint32_t ulUsers;        /**< Handshakes using the chain. */
+    uint32_t ulLastUse;      /**< Value of ulCertificateCacheClock at the last use. */
+    BaseType_t xValid;       /**< The chain can be used by new handshakes. */
+    mbedtls_x509_crt xChain; /**< Parsed chain. */
+} TLSCertificateCacheEntry_t;
+
+/**
+ * @brief Parse the certificates of a cache entry into @p pxChain.
+ */
+typedef int ( * TLSCertificateParser_t )( TLSContext_t * pxCtx,
+                                          mbedtls_x509_crt * pxChain );
+
+/**
+ * @brief Trust anchor lists, keyed by the server certificate override.
+ */
+static TLSCertificateCacheEntry_t xTrustAnchorCache[ tlsCERTIFICATE_CACHE_ENTRIES ];
+
+/**
+ * @brief Device certificate, followed by the JITR certificate if any.
+ */
+static TLSCertificateCacheEntry_t xClientCertificateCache;
+
+/**
+ * @brief Counter ordering the uses of the cache entries.
+ */
+static uint32_t ulCertificateCacheClock = 0;
+
+/**
+ * @brief Lock of the certificate cache, created by the first TLS_Init.
+ */
+static SemaphoreHandle_t xCertificateCacheMutex = NULL;
+
+/**
+ * @brief Store registered with TLS_SetSessionStore.
+ */
+static const TLSSessionStore_t * pxSessionStore = NULL;
+
+/**
+ * @brief Counters returned by TLS_GetHandshakeStats.
+ */
+static TLSHandshakeStats_t xHandshakeStats = { 0 };
+
 /*-----------------------------------------------------------*/
 
 /*
  * Helper routines.
  */
 
+/**
+ * @brief Charge the heap blocks allocated and freed by the calling task to a
+ * context.
+ *
+ * @param[in] pxCtx Context charged, NULL to stop.
+ */
+static void prvHeapTraceAttach( TLSContext_t * pxCtx )
+{
+    TaskHandle_t xTask = xTaskGetCurrentTaskHandle();
+    TLSHeapTraceOwner_t * pxOwner = NULL;
+    size_t i;
+
+    taskENTER_CRITICAL();
+
+    for( i = 0; i < ( size_t ) tlsHEAP_TRACE_TASKS; i++ )
+    {
+        if( xTask == xHeapTraceOwners[ i ].xTask )
+        {
+            pxOwner = &xHeapTraceOwners[ i ];
+            break;
+        }
+        else if( ( NULL == pxOwner ) && ( NULL == xHeapTraceOwners[ i ].xTask ) )
+        {
+            pxOwner = &xHeapTraceOwners[ i ];
+        }
+    }
+
+    /* Without a free slot, the connection is not accounted. */
+    if( NULL != pxOwner )
+    {
+        pxOwner->xTask = ( NULL != pxCtx ) ? xTask : NULL;
+        pxOwner->pxCtx = pxCtx;
+    }
+
+    taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Context charged with the heap blocks of the calling task.
+ *
+ * @return The context, NULL if none.
+ */
+static TLSContext_t * prvHeapTraceOwner( void )
+{
+    TaskHandle_t xTask = xTaskGetCurrentTaskHandle();
+    TLSContext_t * pxCtx = NULL;
+    size_t i;
+
+    for( i = 0; i < ( size_t ) tlsHEAP_TRACE_TASKS; i++ )
+    {
+        if( ( NULL != xHeapTraceOwners[ i ].xTask ) &&
+            ( xTask == xHeapTraceOwners[ i ].xTask ) )
+        {
+            pxCtx = xHeapTraceOwners[ i ].pxCtx;
+            break;
+        }
+    }
+
+    return pxCtx;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Code of a maximum fragment length for mbedTLS.
+ *
+ * @param[in] ulLength Length in bytes, 0 for none.
+ * @param[out] pucCode Code of @p ulLength.
+ *
+ * @return pdTRUE if @p ulLength can be requested with the record buffers of
+ * mbedTLS.
+ */
+static BaseType_t prvMaxFragmentLengthCode( uint32_t ulLength,
+                                            unsigned char * pucCode )
+{
+    BaseType_t xValid = pdTRUE;
+
+    switch( ulLength )
+    {
+        case 0:
+            *pucCode = 0;
+            break;
+
+        #ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+            case 512:
+                *pucCode = MBEDTLS_SSL_MAX_FRAG_LEN_512;
+                break;
+
+            case 1024:
+                *pucCode = MBEDTLS_SSL_MAX_FRAG_LEN_1024;
+                break;
+
+            case 2048:
+                *pucCode = MBEDTLS_SSL_MAX_FRAG_LEN_2048;
+                break;
+
+            case 4096:
+                *pucCode = MBEDTLS_SSL_MAX_FRAG_LEN_4096;
+                break;
+        #endif /* ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH */
+
+        default:
+            xValid = pdFALSE;
+            break;
+    }
+
+    /* mbedTLS applies the length to the records of both directions. */
+    if( ( ulLength > ( uint32_t ) MBEDTLS_SSL_IN_CONTENT_LEN ) ||
+        ( ulLength > ( uint32_t ) MBEDTLS_SSL_OUT_CONTENT_LEN ) )
+    {
+        xValid = pdFALSE;
+    }
+
+    return xValid;
+}
+
+/*-----------------------------------------------------------*/
+
 /**
  * @brief TLS internal context rundown helper routine.
  *
@@ -169,6 +401,11 @@ static void prvFreeContext( TLSContext_t * pxCtx )
         }
 
         pxCtx->xTLSHandshakeState = TLS_HANDSHAKE_NOT_STARTED;
+
+        /* The connection holds no more heap. */
+        taskENTER_CRITICAL();
+        pxCtx->xHeapCurrent = 0;
+        taskEXIT_CRITICAL();
     }
 }
 
@@ -188,8 +425,18 @@ static int prvNetworkSend( void * pvContext,
                            size_t xDataLength )
 {
     TLSContext_t * pxCtx = ( TLSContext_t * ) pvContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
+    BaseType_t xSent;
+    uint32_t ulStart = tlsTRACE_TIMESTAMP();
+
+    xSent = pxCtx->xNetworkSend( pxCtx->pvCallerContext, pucData, xDataLength );
+    pxCtx->ulNetworkTicks += tlsTRACE_TIMESTAMP() - ulStart;
+
+    if( ( xSent > 0 ) && ( TLS_HANDSHAKE_SUCCESSFUL != pxCtx->xTLSHandshakeState ) )
+    {
+        pxCtx->ulHandshakeBytes += ( uint32_t ) xSent;
+    }
 
-    return ( int ) pxCtx->xNetworkSend( pxCtx->pvCallerContext, pucData, xDataLength );
+    return ( int ) xSent;
 }
 
 /*-----------------------------------------------------------*/
@@ -208,8 +455,16 @@ static int prvNetworkRecv( void * pvContext,
                            size_t xReceiveLength )
 {
     TLSContext_t * pxCtx = ( TLSContext_t * ) pvContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
+    BaseType_t xReceived;
 
-    return ( int ) pxCtx->xNetworkRecv( pxCtx->pvCallerContext, pucReceiveBuffer, xReceiveLength );
+    xReceived = pxCtx->xNetworkRecv( pxCtx->pvCallerContext, pucReceiveBuffer, xReceiveLength );
+
+    if( ( xReceived > 0 ) && ( TLS_HANDSHAKE_SUCCESSFUL != pxCtx->xTLSHandshakeState ) )
+    {
+        pxCtx->ulHandshakeBytes += ( uint32_t ) xReceived;
+    }
+
+    return ( int ) xReceived;
 }
 
 /*-----------------------------------------------------------*/
@@ -514,98 +769,443 @@ static int prvReadCertificateIntoContext( TLSContext_t * pxTlsContext,
 /*-----------------------------------------------------------*/
 
 /**
- * @brief Helper for setting up potentially hardware-based cryptographic context
- * for the client TLS certificate and private key.
+ * @brief Parse the root certificates of a connection: either the default or
+ * the override.
  *
- * @param Caller context.
+ * @param[in] pxCtx Caller TLS context.
+ * @param[out] pxChain Chain receiving the certificates.
  *
  * @return Zero on success.
  */
-static int prvInitializeClientCredential( TLSContext_t * pxCtx )
+static int prvParseTrustAnchors( TLSContext_t * pxCtx,
+                                 mbedtls_x509_crt * pxChain )
 {
-    BaseType_t xResult = CKR_OK;
-    CK_SLOT_ID * pxSlotIds = NULL;
-    CK_ULONG xCount = 0;
-    CK_ATTRIBUTE xTemplate[ 2 ];
-    mbedtls_pk_type_t xKeyAlgo = ( mbedtls_pk_type_t ) ~0;
-    char * pcJitrCertificate = keyJITR_DEVICE_CERTIFICATE_AUTHORITY_PEM;
-
-    /* Initialize the mbed contexts. */
-    mbedtls_x509_crt_init( &pxCtx->xMbedX509Cli );
+    int xResult = 0;
 
-    /* Get the PKCS #11 module/token slot count. */
-    if( CKR_OK == xResult )
+    if( NULL != pxCtx->pcServerCertificate )
     {
-        xResult = ( BaseType_t ) pxCtx->pxP11FunctionList->C_GetSlotList( CK_TRUE,
-                                                                          NULL,
-                                                                          &xCount );
-    }
+        xResult = mbedtls_x509_crt_parse( pxChain,
+                                          ( const unsigned char * ) pxCtx->pcServerCertificate,
+                                          pxCtx->ulServerCertificateLength );
 
-    /* Allocate memory to store the token slots. */
-    if( CKR_OK == xResult )
+        if( 0 != xResult )
+        {
+            TLS_PRINT( ( "ERROR: Failed to parse custom server certificates %s : %s \r\n",
+                         mbedtlsHighLevelCodeOrDefault( xResult ),
+                         mbedtlsLowLevelCodeOrDefault( xResult ) ) );
+        }
+    }
+    else
     {
-        pxSlotIds = ( CK_SLOT_ID * ) pvPortMalloc( sizeof( CK_SLOT_ID ) * xCount );
+        xResult = mbedtls_x509_crt_parse( pxChain,
+                                          ( const unsigned char * ) tlsVERISIGN_ROOT_CERTIFICATE_PEM,
+                                          tlsVERISIGN_ROOT_CERTIFICATE_LENGTH );
 
-        if( NULL == pxSlotIds )
+        if( 0 == xResult )
         {
-            xResult = CKR_HOST_MEMORY;
+            xResult = mbedtls_x509_crt_parse( pxChain,
+                                              ( const unsigned char * ) tlsATS1_ROOT_CERTIFICATE_PEM,
+                                              tlsATS1_ROOT_CERTIFICATE_LENGTH );
+
+            if( 0 == xResult )
+            {
+                xResult = mbedtls_x509_crt_parse( pxChain,
+                                                  ( const unsigned char * ) tlsSTARFIELD_ROOT_CERTIFICATE_PEM,
+                                                  tlsSTARFIELD_ROOT_CERTIFICATE_LENGTH );
+            }
         }
-    }
 
-    /* Get all of the available private key slot identities. */
-    if( CKR_OK == xResult )
-    {
-        xResult = ( BaseType_t ) pxCtx->pxP11FunctionList->C_GetSlotList( CK_TRUE,
-                                                                          pxSlotIds,
-                                                                          &xCount );
+        if( 0 != xResult )
+        {
+            /* Default root certificates should be in aws_default_root_certificate.h */
+            TLS_PRINT( ( "ERROR: Failed to parse default server certificates %s : %s \r\n",
+                         mbedtlsHighLevelCodeOrDefault( xResult ),
+                         mbedtlsLowLevelCodeOrDefault( xResult ) ) );
+        }
     }
 
-    /* Start a private session with the P#11 module using the first
-     * enumerated slot. */
-    if( CKR_OK == xResult )
-    {
-        xResult = ( BaseType_t ) pxCtx->pxP11FunctionList->C_OpenSession( pxSlotIds[ 0 ],
-                                                                          CKF_SERIAL_SESSION,
-                                                                          NULL,
-                                                                          NULL,
-                                                                          &pxCtx->xP11Session );
-    }
+    return xResult;
+}
 
-    /* Put the module in authenticated mode. */
-    if( CKR_OK == xResult )
-    {
-        pxCtx->xTLSHandshakeState = TLS_HANDSHAKE_STARTED;
-        xResult = ( BaseType_t ) pxCtx->pxP11FunctionList->C_Login( pxCtx->xP11Session,
-                                                                    CKU_USER,
-                                                                    ( CK_UTF8CHAR_PTR ) configPKCS11_DEFAULT_USER_PIN,
-                                                                    sizeof( configPKCS11_DEFAULT_USER_PIN ) - 1 );
-    }
+/*-----------------------------------------------------------*/
 
-    if( CKR_OK == xResult )
-    {
-        /* Get the handle of the device private key. */
-        xResult = xFindObjectWithLabelAndClass( pxCtx->xP11Session,
-                                                pkcs11configLABEL_DEVICE_PRIVATE_KEY_FOR_TLS,
-                                                CKO_PRIVATE_KEY,
-                                                &pxCtx->xP11PrivateKey );
-    }
+/**
+ * @brief Read the device certificate, followed by the Just-in-Time
+ * Registration (JITR) device issuer certificate if present.
+ *
+ * @param[in] pxCtx Caller TLS context, with an open PKCS #11 session.
+ * @param[out] pxChain Chain receiving the certificates.
+ *
+ * @return Zero on success.
+ */
+static int prvParseClientCertificates( TLSContext_t * pxCtx,
+                                       mbedtls_x509_crt * pxChain )
+{
+    int xResult = 0;
+    char * pcJitrCertificate = keyJITR_DEVICE_CERTIFICATE_AUTHORITY_PEM;
 
-    if( ( CKR_OK == xResult ) && ( pxCtx->xP11PrivateKey == CK_INVALID_HANDLE ) )
+    xResult = prvReadCertificateIntoContext( pxCtx,
+                                             pkcs11configLABEL_DEVICE_CERTIFICATE_FOR_TLS,
+                                             CKO_CERTIFICATE,
+                                             pxChain );
+
+    if( 0 == xResult )
     {
-        xResult = TLS_ERROR_NO_PRIVATE_KEY;
-        TLS_PRINT( ( "ERROR: Private key not found. " ) );
+        /* Prioritize a statically defined certificate over one in storage. */
+        if( ( NULL != pcJitrCertificate ) &&
+            ( 0 != strcmp( "", pcJitrCertificate ) ) )
+        {
+            xResult = mbedtls_x509_crt_parse( pxChain,
+                                              ( const unsigned char * ) pcJitrCertificate,
+                                              1 + strlen( pcJitrCertificate ) );
+        }
+        else
+        {
+            /* Check for a device JITR certificate in storage. */
+            xResult = prvReadCertificateIntoContext( pxCtx,
+                                                     pkcs11configLABEL_JITP_CERTIFICATE,
+                                                     CKO_CERTIFICATE,
+                                                     pxChain );
+
+            /* It is optional to have a JITR certificate in storage. */
+            if( CKR_OBJECT_HANDLE_INVALID == xResult )
+            {
+                xResult = CKR_OK;
+            }
+        }
     }
 
-    /* Query the device private key type. */
-    if( xResult == CKR_OK )
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief FNV-1a hash of the certificates a chain is parsed from.
+ */
+static uint32_t prvHashCertificateSource( const char * pcSource,
+                                          uint32_t ulLength )
+{
+    uint32_t ulHash = 2166136261UL;
+    uint32_t i;
+
+    for( i = 0; i < ulLength; i++ )
     {
-        xTemplate[ 0 ].type = CKA_KEY_TYPE;
-        xTemplate[ 0 ].pValue = &pxCtx->xKeyType;
-        xTemplate[ 0 ].ulValueLen = sizeof( CK_KEY_TYPE );
-        xResult = pxCtx->pxP11FunctionList->C_GetAttributeValue( pxCtx->xP11Session,
-                                                                 pxCtx->xP11PrivateKey,
-                                                                 xTemplate,
-                                                                 1 );
+        ulHash = ( ulHash ^ ( uint8_t ) pcSource[ i ] ) * 16777619UL;
+    }
+
+    return ulHash;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Create the lock of the certificate cache, if not done yet.
+ *
+ * @return CKR_OK on success.
+ */
+static BaseType_t prvCreateCertificateCacheMutex( void )
+{
+    BaseType_t xResult = CKR_OK;
+    SemaphoreHandle_t xMutex = NULL;
+
+    if( NULL == xCertificateCacheMutex )
+    {
+        xMutex = xSemaphoreCreateMutex();
+
+        if( NULL == xMutex )
+        {
+            xResult = ( BaseType_t ) CKR_HOST_MEMORY;
+        }
+        else
+        {
+            /* Another task may have created it meanwhile. */
+            taskENTER_CRITICAL();
+
+            if( NULL == xCertificateCacheMutex )
+            {
+                xCertificateCacheMutex = xMutex;
+                xMutex = NULL;
+            }
+
+            taskEXIT_CRITICAL();
+
+            if( NULL != xMutex )
+            {
+                vSemaphoreDelete( xMutex );
+            }
+        }
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Get a certificate chain from the cache, parsing it if missing.
+ *
+ * The chain is parsed into a free entry of @p pxEntries, or into
+ * @p pxOwnChain when all entries are used by other handshakes.
+ *
+ * @param[in] pxCtx Caller TLS context.
+ * @param[in] pxEntries Entries of the cache.
+ * @param[in] xEntryCount Number of entries in @p pxEntries.
+ * @param[in] pcSource Certificates the chain is parsed from, NULL for the
+ * defaults of @p xParser.
+ * @param[in] ulSourceLength Length of @p pcSource.
+ * @param[in] xParser Parser of the chain.
+ * @param[out] pxOwnChain Chain of the context, used without a free entry.
+ * @param[out] ppxEntry Entry holding the chain, NULL if the chain was parsed
+ * into the context.
+ *
+ * @return Zero on success.
+ */
+static int prvAcquireCertificates( TLSContext_t * pxCtx,
+                                   TLSCertificateCacheEntry_t * pxEntries,
+                                   size_t xEntryCount,
+                                   const char * pcSource,
+                                   uint32_t ulSourceLength,
+                                   TLSCertificateParser_t xParser,
+                                   mbedtls_x509_crt * pxOwnChain,
+                                   TLSCertificateCacheEntry_t ** ppxEntry )
+{
+    int xResult = 0;
+    TLSCertificateCacheEntry_t * pxEntry = NULL;
+    TLSCertificateCacheEntry_t * pxFree = NULL;
+    uint32_t ulHash = 0;
+    size_t i;
+
+    if( NULL != pcSource )
+    {
+        ulHash = prvHashCertificateSource( pcSource, ulSourceLength );
+    }
+
+    ( void ) xSemaphoreTake( xCertificateCacheMutex, portMAX_DELAY );
+
+    ulCertificateCacheClock++;
+
+    for( i = 0; ( i < xEntryCount ) && ( NULL == pxEntry ); i++ )
+    {
+        if( ( pdTRUE == pxEntries[ i ].xValid ) &&
+            ( pcSource == pxEntries[ i ].pcSource ) &&
+            ( ulSourceLength == pxEntries[ i ].ulSourceLength ) &&
+            ( ulHash == pxEntries[ i ].ulSourceHash ) )
+        {
+            pxEntry = &pxEntries[ i ];
+        }
+        else if( 0U == pxEntries[ i ].ulUsers )
+        {
+            /* Reuse an empty entry first, then the least recently used. */
+            if( ( NULL == pxFree ) ||
+                ( ( pdTRUE == pxFree->xValid ) &&
+                  ( ( pdFALSE == pxEntries[ i ].xValid ) ||
+                    ( pxEntries[ i ].ulLastUse < pxFree->ulLastUse ) ) ) )
+            {
+                pxFree = &pxEntries[ i ];
+            }
+        }
+    }
+
+    if( NULL == pxEntry )
+    {
+        if( NULL != pxFree )
+        {
+            /* The chains of the cache are not charged to the context. */
+            prvHeapTraceAttach( NULL );
+            mbedtls_x509_crt_free( &pxFree->xChain );
+            pxFree->xValid = pdFALSE;
+            xResult = xParser( pxCtx, &pxFree->xChain );
+
+            if( 0 == xResult )
+            {
+                pxFree->pcSource = pcSource;
+                pxFree->ulSourceLength = ulSourceLength;
+                pxFree->ulSourceHash = ulHash;
+                pxFree->xValid = pdTRUE;
+                pxEntry = pxFree;
+            }
+            else
+            {
+                mbedtls_x509_crt_free( &pxFree->xChain );
+            }
+
+            prvHeapTraceAttach( pxCtx );
+        }
+
+        taskENTER_CRITICAL();
+        xHandshakeStats.ulCertificateParses++;
+        taskEXIT_CRITICAL();
+    }
+    else
+    {
+        taskENTER_CRITICAL();
+        xHandshakeStats.ulCertificateHits++;
+        taskEXIT_CRITICAL();
+    }
+
+    if( NULL != pxEntry )
+    {
+        pxEntry->ulUsers++;
+        pxEntry->ulLastUse = ulCertificateCacheClock;
+    }
+
+    ( void ) xSemaphoreGive( xCertificateCacheMutex );
+
+    /* Every entry is used by another handshake. */
+    if( ( 0 == xResult ) && ( NULL == pxEntry ) )
+    {
+        xResult = xParser( pxCtx, pxOwnChain );
+    }
+
+    *ppxEntry = pxEntry;
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Stop using a chain of the cache.
+ *
+ * Called without heap accounting, the chain may be freed.
+ *
+ * @param[in,out] ppxEntry Entry returned by prvAcquireCertificates, cleared.
+ */
+static void prvReleaseCertificates( TLSCertificateCacheEntry_t ** ppxEntry )
+{
+    TLSCertificateCacheEntry_t * pxEntry = *ppxEntry;
+
+    if( NULL != pxEntry )
+    {
+        ( void ) xSemaphoreTake( xCertificateCacheMutex, portMAX_DELAY );
+
+        pxEntry->ulUsers--;
+
+        /* Flushed while in use. */
+        if( ( 0U == pxEntry->ulUsers ) && ( pdFALSE == pxEntry->xValid ) )
+        {
+            mbedtls_x509_crt_free( &pxEntry->xChain );
+        }
+
+        ( void ) xSemaphoreGive( xCertificateCacheMutex );
+
+        *ppxEntry = NULL;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Make a chain of the cache unavailable to new handshakes.
+ *
+ * @param[in] pxEntry Entry to flush, the certificate cache is locked.
+ */
+static void prvFlushCertificates( TLSCertificateCacheEntry_t * pxEntry )
+{
+    pxEntry->xValid = pdFALSE;
+
+    /* A chain in use is freed by its last user. */
+    if( 0U == pxEntry->ulUsers )
+    {
+        mbedtls_x509_crt_free( &pxEntry->xChain );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Helper for setting up potentially hardware-based cryptographic context
+ * for the client TLS certificate and private key.
+ *
+ * @param Caller context.
+ *
+ * @return Zero on success.
+ */
+static int prvInitializeClientCredential( TLSContext_t * pxCtx )
+{
+    BaseType_t xResult = CKR_OK;
+    CK_SLOT_ID * pxSlotIds = NULL;
+    CK_ULONG xCount = 0;
+    CK_ATTRIBUTE xTemplate[ 2 ];
+    mbedtls_pk_type_t xKeyAlgo = ( mbedtls_pk_type_t ) ~0;
+
+    /* Initialize the mbed contexts. */
+    mbedtls_x509_crt_init( &pxCtx->xMbedX509Cli );
+
+    /* Get the PKCS #11 module/token slot count. */
+    if( CKR_OK == xResult )
+    {
+        xResult = ( BaseType_t ) pxCtx->pxP11FunctionList->C_GetSlotList( CK_TRUE,
+                                                                          NULL,
+                                                                          &xCount );
+    }
+
+    /* Allocate memory to store the token slots. */
+    if( CKR_OK == xResult )
+    {
+        pxSlotIds = ( CK_SLOT_ID * ) pvPortMalloc( sizeof( CK_SLOT_ID ) * xCount );
+
+        if( NULL == pxSlotIds )
+        {
+            xResult = CKR_HOST_MEMORY;
+        }
+    }
+
+    /* Get all of the available private key slot identities. */
+    if( CKR_OK == xResult )
+    {
+        xResult = ( BaseType_t ) pxCtx->pxP11FunctionList->C_GetSlotList( CK_TRUE,
+                                                                          pxSlotIds,
+                                                                          &xCount );
+    }
+
+    /* Start a private session with the P#11 module using the first
+     * enumerated slot. */
+    if( CKR_OK == xResult )
+    {
+        xResult = ( BaseType_t ) pxCtx->pxP11FunctionList->C_OpenSession( pxSlotIds[ 0 ],
+                                                                          CKF_SERIAL_SESSION,
+                                                                          NULL,
+                                                                          NULL,
+                                                                          &pxCtx->xP11Session );
+    }
+
+    /* Put the module in authenticated mode. */
+    if( CKR_OK == xResult )
+    {
+        pxCtx->xTLSHandshakeState = TLS_HANDSHAKE_STARTED;
+        xResult = ( BaseType_t ) pxCtx->pxP11FunctionList->C_Login( pxCtx->xP11Session,
+                                                                    CKU_USER,
+                                                                    ( CK_UTF8CHAR_PTR ) configPKCS11_DEFAULT_USER_PIN,
+                                                                    sizeof( configPKCS11_DEFAULT_USER_PIN ) - 1 );
+    }
+
+    if( CKR_OK == xResult )
+    {
+        /* Get the handle of the device private key. */
+        xResult = xFindObjectWithLabelAndClass( pxCtx->xP11Session,
+                                                pkcs11configLABEL_DEVICE_PRIVATE_KEY_FOR_TLS,
+                                                CKO_PRIVATE_KEY,
+                                                &pxCtx->xP11PrivateKey );
+    }
+
+    if( ( CKR_OK == xResult ) && ( pxCtx->xP11PrivateKey == CK_INVALID_HANDLE ) )
+    {
+        xResult = TLS_ERROR_NO_PRIVATE_KEY;
+        TLS_PRINT( ( "ERROR: Private key not found. " ) );
+    }
+
+    /* Query the device private key type. */
+    if( xResult == CKR_OK )
+    {
+        xTemplate[ 0 ].type = CKA_KEY_TYPE;
+        xTemplate[ 0 ].pValue = &pxCtx->xKeyType;
+        xTemplate[ 0 ].ulValueLen = sizeof( CK_KEY_TYPE );
+        xResult = pxCtx->pxP11FunctionList->C_GetAttributeValue( pxCtx->xP11Session,
+                                                                 pxCtx->xP11PrivateKey,
+                                                                 xTemplate,
+                                                                 1 );
     }
 
     /* Map the PKCS #11 key type to an mbedTLS algorithm. */
@@ -637,58 +1237,369 @@ static int prvInitializeClientCredential( TLSContext_t * pxCtx )
         pxCtx->xMbedPkCtx.pk_ctx = pxCtx;
     }
 
-    /* Get the handle of the device client certificate. */
+    /* Get the device client certificate. */
     if( xResult == CKR_OK )
     {
-        xResult = prvReadCertificateIntoContext( pxCtx,
-                                                 pkcs11configLABEL_DEVICE_CERTIFICATE_FOR_TLS,
-                                                 CKO_CERTIFICATE,
-                                                 &pxCtx->xMbedX509Cli );
+        xResult = prvAcquireCertificates( pxCtx,
+                                          &xClientCertificateCache,
+                                          1,
+                                          NULL,
+                                          0,
+                                          prvParseClientCertificates,
+                                          &pxCtx->xMbedX509Cli,
+                                          &pxCtx->pxClientCertificates );
     }
 
-    /* Add a Just-in-Time Registration (JITR) device issuer certificate, if
-     * present, to the TLS context handle. */
-    if( xResult == CKR_OK )
+    /* Attach the client certificate(s) and private key to the TLS configuration. */
+    if( 0 == xResult )
     {
-        /* Prioritize a statically defined certificate over one in storage. */
-        if( ( NULL != pcJitrCertificate ) &&
-            ( 0 != strcmp( "", pcJitrCertificate ) ) )
-        {
-            xResult = mbedtls_x509_crt_parse( &pxCtx->xMbedX509Cli,
-                                              ( const unsigned char * ) pcJitrCertificate,
-                                              1 + strlen( pcJitrCertificate ) );
-        }
-        else
+        xResult = mbedtls_ssl_conf_own_cert( &pxCtx->xMbedSslConfig,
+                                             ( NULL != pxCtx->pxClientCertificates ) ?
+                                             &pxCtx->pxClientCertificates->xChain : &pxCtx->xMbedX509Cli,
+                                             &pxCtx->xMbedPkCtx );
+    }
+
+    /* Free memory. */
+    if( NULL != pxSlotIds )
+    {
+        vPortFree( pxSlotIds );
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Write the @p xLength low-order bytes of a value, most significant
+ * first.
+ *
+ * @return Position following the value.
+ */
+static unsigned char * prvPutUint( unsigned char * pucNext,
+                                   uint32_t ulValue,
+                                   size_t xLength )
+{
+    size_t x;
+
+    for( x = xLength; x > 0U; x-- )
+    {
+        pucNext[ x - 1U ] = ( unsigned char ) ulValue;
+        ulValue >>= 8;
+    }
+
+    return pucNext + xLength;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Read a value written by prvPutUint and advance the position.
+ */
+static uint32_t prvGetUint( const unsigned char ** ppucNext,
+                            size_t xLength )
+{
+    uint32_t ulValue = 0;
+    size_t x;
+
+    for( x = 0; x < xLength; x++ )
+    {
+        ulValue = ( ulValue << 8 ) | ( *ppucNext )[ x ];
+    }
+
+    *ppucNext += xLength;
+
+    return ulValue;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Serialize the resumable part of a session.
+ *
+ * The server certificate is not kept: it is not verified again when the
+ * session is resumed.
+ *
+ * @param[in] pxSession Session negotiated by the handshake.
+ * @param[out] pucBuffer Destination of the serialized session.
+ * @param[in] xBufferLength Size of @p pucBuffer.
+ *
+ * @return Length of the serialized session, 0 if the session cannot be
+ * resumed or does not fit.
+ */
+static size_t prvSerializeSession( const mbedtls_ssl_session * pxSession,
+                                   unsigned char * pucBuffer,
+                                   size_t xBufferLength )
+{
+    unsigned char * pucNext = pucBuffer;
+    const unsigned char * pucTicket = NULL;
+    size_t xTicketLength = 0;
+    uint32_t ulTicketLifetime = 0;
+    uint8_t ucMaxFragmentLength = 0;
+    uint8_t ucEncryptThenMac = 0;
+    uint8_t ucTruncatedHmac = 0;
+
+    #if defined( MBEDTLS_SSL_SESSION_TICKETS )
+        pucTicket = pxSession->ticket;
+        xTicketLength = pxSession->ticket_len;
+        ulTicketLifetime = pxSession->ticket_lifetime;
+    #endif
+    #if defined( MBEDTLS_SSL_MAX_FRAGMENT_LENGTH )
+        ucMaxFragmentLength = pxSession->mfl_code;
+    #endif
+    #if defined( MBEDTLS_SSL_ENCRYPT_THEN_MAC )
+        ucEncryptThenMac = ( uint8_t ) pxSession->encrypt_then_mac;
+    #endif
+    #if defined( MBEDTLS_SSL_TRUNCATED_HMAC )
+        ucTruncatedHmac = ( uint8_t ) pxSession->trunc_hmac;
+    #endif
+
+    if( ( ( 0U == pxSession->id_len ) && ( 0U == xTicketLength ) ) ||
+        ( pxSession->id_len > sizeof( pxSession->id ) ) ||
+        ( xTicketLength > 0xFFFFU ) ||
+        ( ( tlsSESSION_HEADER_LENGTH + xTicketLength ) > xBufferLength ) )
+    {
+        return 0;
+    }
+
+    *pucNext++ = ( unsigned char ) tlsSESSION_FORMAT_VERSION;
+    pucNext = prvPutUint( pucNext, ( uint32_t ) pxSession->ciphersuite, 2 );
+    *pucNext++ = ( unsigned char ) pxSession->compression;
+    *pucNext++ = ( unsigned char ) pxSession->id_len;
+    memcpy( pucNext, pxSession->id, sizeof( pxSession->id ) );
+    pucNext += sizeof( pxSession->id );
+    memcpy( pucNext, pxSession->master, sizeof( pxSession->master ) );
+    pucNext += sizeof( pxSession->master );
+    pucNext = prvPutUint( pucNext, pxSession->verify_result, 4 );
+    *pucNext++ = ucMaxFragmentLength;
+    *pucNext++ = ucEncryptThenMac;
+    *pucNext++ = ucTruncatedHmac;
+    pucNext = prvPutUint( pucNext, ulTicketLifetime, 4 );
+    pucNext = prvPutUint( pucNext, ( uint32_t ) xTicketLength, 2 );
+
+    if( xTicketLength > 0U )
+    {
+        memcpy( pucNext, pucTicket, xTicketLength );
+    }
+
+    return tlsSESSION_HEADER_LENGTH + xTicketLength;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Rebuild a session serialized by prvSerializeSession.
+ *
+ * @param[out] pxSession Initialized session, to be freed by the caller.
+ * @param[in] pucBuffer Serialized session.
+ * @param[in] xLength Length of @p pucBuffer.
+ *
+ * @return Zero on success.
+ */
+static int prvDeserializeSession( mbedtls_ssl_session * pxSession,
+                                  const unsigned char * pucBuffer,
+                                  size_t xLength )
+{
+    const unsigned char * pucNext = pucBuffer;
+    size_t xTicketLength;
+    uint32_t ulTicketLifetime;
+
+    if( ( xLength < tlsSESSION_HEADER_LENGTH ) ||
+        ( tlsSESSION_FORMAT_VERSION != *pucNext++ ) )
+    {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    pxSession->ciphersuite = ( int ) prvGetUint( &pucNext, 2 );
+    pxSession->compression = ( int ) *pucNext++;
+    pxSession->id_len = *pucNext++;
+
+    if( pxSession->id_len > sizeof( pxSession->id ) )
+    {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    memcpy( pxSession->id, pucNext, sizeof( pxSession->id ) );
+    pucNext += sizeof( pxSession->id );
+    memcpy( pxSession->master, pucNext, sizeof( pxSession->master ) );
+    pucNext += sizeof( pxSession->master );
+    pxSession->verify_result = prvGetUint( &pucNext, 4 );
+
+    #if defined( MBEDTLS_SSL_MAX_FRAGMENT_LENGTH )
+        pxSession->mfl_code = pucNext[ 0 ];
+    #endif
+    #if defined( MBEDTLS_SSL_ENCRYPT_THEN_MAC )
+        pxSession->encrypt_then_mac = ( int ) pucNext[ 1 ];
+    #endif
+    #if defined( MBEDTLS_SSL_TRUNCATED_HMAC )
+        pxSession->trunc_hmac = ( int ) pucNext[ 2 ];
+    #endif
+    pucNext += 3;
+
+    ulTicketLifetime = prvGetUint( &pucNext, 4 );
+    xTicketLength = prvGetUint( &pucNext, 2 );
+
+    if( ( tlsSESSION_HEADER_LENGTH + xTicketLength ) != xLength )
+    {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    #if defined( MBEDTLS_SSL_SESSION_TICKETS )
+        if( xTicketLength > 0U )
         {
-            /* Check for a device JITR certificate in storage. */
-            xResult = prvReadCertificateIntoContext( pxCtx,
-                                                     pkcs11configLABEL_JITP_CERTIFICATE,
-                                                     CKO_CERTIFICATE,
-                                                     &pxCtx->xMbedX509Cli );
+            pxSession->ticket = mbedtls_calloc( 1, xTicketLength );
 
-            /* It is optional to have a JITR certificate in storage. */
-            if( CKR_OBJECT_HANDLE_INVALID == xResult )
+            if( NULL == pxSession->ticket )
             {
-                xResult = CKR_OK;
+                return MBEDTLS_ERR_SSL_ALLOC_FAILED;
             }
+
+            memcpy( pxSession->ticket, pucNext, xTicketLength );
+            pxSession->ticket_len = xTicketLength;
+            pxSession->ticket_lifetime = ulTicketLifetime;
         }
+    #else
+        ( void ) ulTicketLifetime;
+    #endif
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Offer the session saved for the destination, if any.
+ *
+ * @param[in] pxCtx Caller context, set up but not yet negotiated.
+ * @param[out] pucSession Buffer of tlsSESSION_MAX_LENGTH bytes receiving the
+ * offered session.
+ *
+ * @return Length of the offered session, 0 if none was offered.
+ */
+static size_t prvOfferSession( TLSContext_t * pxCtx,
+                               unsigned char * pucSession )
+{
+    mbedtls_ssl_session xSession;
+    size_t xLength = 0;
+
+    if( pdTRUE != pxSessionStore->xLoad( pxSessionStore->pvContext,
+                                         pxCtx->pcDestination,
+                                         pucSession,
+                                         &xLength ) )
+    {
+        return 0;
     }
 
-    /* Attach the client certificate(s) and private key to the TLS configuration. */
+    mbedtls_ssl_session_init( &xSession );
+
+    if( ( xLength > tlsSESSION_MAX_LENGTH ) ||
+        ( 0 != prvDeserializeSession( &xSession, pucSession, xLength ) ) ||
+        ( 0 != mbedtls_ssl_set_session( &pxCtx->xMbedSslCtx, &xSession ) ) )
+    {
+        TLS_PRINT( ( "WARN: Ignoring the saved session of %s \r\n", pxCtx->pcDestination ) );
+        xLength = 0;
+    }
+
+    mbedtls_ssl_session_free( &xSession );
+
+    return xLength;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Account for a completed handshake attempt and update the session
+ * store.
+ *
+ * @param[in] pxCtx Caller context.
+ * @param[in] xResult Result of the handshake.
+ * @param[in] xStartTime Tick count when the handshake started.
+ * @param[in,out] pucSession Offered session followed by room for the new one,
+ * NULL if no store is registered.
+ * @param[in] xOfferedLength Length of the offered session, 0 if none.
+ */
+static void prvEndHandshake( TLSContext_t * pxCtx,
+                             BaseType_t xResult,
+                             TickType_t xStartTime,
+                             unsigned char * pucSession,
+                             size_t xOfferedLength )
+{
+    uint32_t ulElapsedMs = ( uint32_t ) ( ( xTaskGetTickCount() - xStartTime ) * portTICK_PERIOD_MS );
+    unsigned char * pucNewSession = NULL;
+    size_t xNewLength = 0;
+    BaseType_t xResumed = pdFALSE;
+
     if( 0 == xResult )
     {
-        xResult = mbedtls_ssl_conf_own_cert( &pxCtx->xMbedSslConfig,
-                                             &pxCtx->xMbedX509Cli,
-                                             &pxCtx->xMbedPkCtx );
+        /* A resumed session keeps the master secret that was offered. */
+        xResumed = ( xOfferedLength > 0U ) &&
+                   ( 0 == memcmp( pucSession + tlsSESSION_MASTER_OFFSET,
+                                  pxCtx->xMbedSslCtx.session->master,
+                                  sizeof( pxCtx->xMbedSslCtx.session->master ) ) );
     }
 
-    /* Free memory. */
-    if( NULL != pxSlotIds )
+    taskENTER_CRITICAL();
+
+    if( 0 != xResult )
     {
-        vPortFree( pxSlotIds );
+        xHandshakeStats.ulFailed++;
+    }
+    else if( pdTRUE == xResumed )
+    {
+        xHandshakeStats.ulResumed++;
+        xHandshakeStats.ulResumedBytes += pxCtx->ulHandshakeBytes;
+        xHandshakeStats.ulResumedMs += ulElapsedMs;
+    }
+    else
+    {
+        xHandshakeStats.ulFull++;
+        xHandshakeStats.ulFullBytes += pxCtx->ulHandshakeBytes;
+        xHandshakeStats.ulFullMs += ulElapsedMs;
     }
 
-    return xResult;
+    taskEXIT_CRITICAL();
+
+    if( NULL == pucSession )
+    {
+        return;
+    }
+
+    if( 0 == xResult )
+    {
+        pucNewSession = pucSession + tlsSESSION_MAX_LENGTH;
+        xNewLength = prvSerializeSession( pxCtx->xMbedSslCtx.session,
+                                          pucNewSession,
+                                          tlsSESSION_MAX_LENGTH );
+
+        /* Only write the store when the session changed, a session ID
+         * resumption leaves it as it was. */
+        if( ( xNewLength > 0U ) &&
+            ( ( xNewLength != xOfferedLength ) ||
+              ( 0 != memcmp( pucNewSession, pucSession, xNewLength ) ) ) )
+        {
+            ( void ) pxSessionStore->xSave( pxSessionStore->pvContext,
+                                            pxCtx->pcDestination,
+                                            pucNewSession,
+                                            xNewLength );
+        }
+        else if( ( 0U == xNewLength ) && ( xOfferedLength > 0U ) )
+        {
+            /* The server no longer issues resumable sessions. */
+            ( void ) pxSessionStore->xSave( pxSessionStore->pvContext,
+                                            pxCtx->pcDestination,
+                                            NULL,
+                                            0 );
+        }
+    }
+    else if( ( xOfferedLength > 0U ) && ( MBEDTLS_ERR_SSL_FATAL_ALERT_MESSAGE == xResult ) )
+    {
+        /* The server rejected the handshake, do not offer the session again.
+         * A network failure keeps the session for the next attempt. */
+        ( void ) pxSessionStore->xSave( pxSessionStore->pvContext,
+                                        pxCtx->pcDestination,
+                                        NULL,
+                                        0 );
+    }
 }
 
 /*-----------------------------------------------------------*/
@@ -721,7 +1632,35 @@ BaseType_t TLS_Init( void ** ppvContext,
         pxCtx->xNetworkRecv = pxParams->pxNetworkRecv;
         pxCtx->xNetworkSend = pxParams->pxNetworkSend;
         pxCtx->pvCallerContext = pxParams->pvCallerContext;
+        pxCtx->ulMaxFragmentLength = tlsMAX_FRAGMENT_LENGTH;
 
+        /* The field is missing from the parameters of older callers. */
+        if( ( pxParams->ulSize >= ( offsetof( TLSParams_t, ulMaxFragmentLength ) + sizeof( uint32_t ) ) ) &&
+            ( 0U != pxParams->ulMaxFragmentLength ) )
+        {
+            pxCtx->ulMaxFragmentLength = pxParams->ulMaxFragmentLength;
+        }
+
+        if( pdTRUE != prvMaxFragmentLengthCode( pxCtx->ulMaxFragmentLength,
+                                                &pxCtx->ucMaxFragmentLengthCode ) )
+        {
+            TLS_PRINT( ( "ERROR: Invalid maximum fragment length %u \r\n",
+                         ( unsigned ) pxCtx->ulMaxFragmentLength ) );
+            xResult = ( BaseType_t ) CKR_ARGUMENTS_BAD;
+        }
+        else
+        {
+            /* Create the lock of the certificate cache on first use. */
+            xResult = prvCreateCertificateCacheMutex();
+        }
+    }
+    else
+    {
+        xResult = ( BaseType_t ) CKR_HOST_MEMORY;
+    }
+
+    if( CKR_OK == xResult )
+    {
         /* Get the function pointer list for the PKCS#11 module. */
         xCkGetFunctionList = C_GetFunctionList;
         xResult = ( BaseType_t ) xCkGetFunctionList( &pxCtx->pxP11FunctionList );
@@ -738,10 +1677,6 @@ BaseType_t TLS_Init( void ** ppvContext,
             }
         }
     }
-    else
-    {
-        xResult = ( BaseType_t ) CKR_HOST_MEMORY;
-    }
 
     return xResult;
 }
@@ -771,54 +1706,27 @@ BaseType_t TLS_Connect( void * pvContext )
 {
     BaseType_t xResult = 0;
     TLSContext_t * pxCtx = ( TLSContext_t * ) pvContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
+    unsigned char * pucSession = NULL;
+    size_t xOfferedLength = 0;
+    TickType_t xStartTime = 0;
+
+    /* Charge the heap allocated from now on to the connection. */
+    prvHeapTraceAttach( pxCtx );
 
     /* Initialize mbedTLS structures. */
     mbedtls_ssl_init( &pxCtx->xMbedSslCtx );
     mbedtls_ssl_config_init( &pxCtx->xMbedSslConfig );
     mbedtls_x509_crt_init( &pxCtx->xMbedX509CA );
 
-    /* Decode the root certificate: either the default or the override. */
-    if( NULL != pxCtx->pcServerCertificate )
-    {
-        xResult = mbedtls_x509_crt_parse( &pxCtx->xMbedX509CA,
-                                          ( const unsigned char * ) pxCtx->pcServerCertificate,
-                                          pxCtx->ulServerCertificateLength );
-
-        if( 0 != xResult )
-        {
-            TLS_PRINT( ( "ERROR: Failed to parse custom server certificates %s : %s \r\n",
-                         mbedtlsHighLevelCodeOrDefault( xResult ),
-                         mbedtlsLowLevelCodeOrDefault( xResult ) ) );
-        }
-    }
-    else
-    {
-        xResult = mbedtls_x509_crt_parse( &pxCtx->xMbedX509CA,
-                                          ( const unsigned char * ) tlsVERISIGN_ROOT_CERTIFICATE_PEM,
-                                          tlsVERISIGN_ROOT_CERTIFICATE_LENGTH );
-
-        if( 0 == xResult )
-        {
-            xResult = mbedtls_x509_crt_parse( &pxCtx->xMbedX509CA,
-                                              ( const unsigned char * ) tlsATS1_ROOT_CERTIFICATE_PEM,
-                                              tlsATS1_ROOT_CERTIFICATE_LENGTH );
-
-            if( 0 == xResult )
-            {
-                xResult = mbedtls_x509_crt_parse( &pxCtx->xMbedX509CA,
-                                                  ( const unsigned char * ) tlsSTARFIELD_ROOT_CERTIFICATE_PEM,
-                                                  tlsSTARFIELD_ROOT_CERTIFICATE_LENGTH );
-            }
-        }
-
-        if( 0 != xResult )
-        {
-            /* Default root certificates should be in aws_default_root_certificate.h */
-            TLS_PRINT( ( "ERROR: Failed to parse default server certificates %s : %s \r\n",
-                         mbedtlsHighLevelCodeOrDefault( xResult ),
-                         mbedtlsLowLevelCodeOrDefault( xResult ) ) );
-        }
-    }
+    /* Get the root certificates: either the default or the override. */
+    xResult = prvAcquireCertificates( pxCtx,
+                                      xTrustAnchorCache,
+                                      tlsCERTIFICATE_CACHE_ENTRIES,
+                                      pxCtx->pcServerCertificate,
+                                      pxCtx->ulServerCertificateLength,
+                                      prvParseTrustAnchors,
+                                      &pxCtx->xMbedX509CA,
+                                      &pxCtx->pxTrustAnchors );
 
     /* Start with protocol defaults. */
     if( 0 == xResult )
@@ -850,12 +1758,24 @@ BaseType_t TLS_Connect( void * pvContext )
         mbedtls_ssl_conf_rng( &pxCtx->xMbedSslConfig, &prvGenerateRandomBytes, pxCtx ); /*lint !e546 Nothing wrong here. */
 
         /* Set issuer certificate. */
-        mbedtls_ssl_conf_ca_chain( &pxCtx->xMbedSslConfig, &pxCtx->xMbedX509CA, NULL );
+        mbedtls_ssl_conf_ca_chain( &pxCtx->xMbedSslConfig,
+                                   ( NULL != pxCtx->pxTrustAnchors ) ?
+                                   &pxCtx->pxTrustAnchors->xChain : &pxCtx->xMbedX509CA,
+                                   NULL );
 
         /* Configure the SSL context for the device credentials. */
         xResult = prvInitializeClientCredential( pxCtx );
     }
 
+    #ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+        if( ( 0 == xResult ) && ( 0U != pxCtx->ulMaxFragmentLength ) )
+        {
+            /* Ask the server for records that fit the input buffer. */
+            xResult = mbedtls_ssl_conf_max_frag_len( &pxCtx->xMbedSslConfig,
+                                                     pxCtx->ucMaxFragmentLengthCode );
+        }
+    #endif
+
     if( ( 0 == xResult ) && ( NULL != pxCtx->ppcAlpnProtocols ) )
     {
         /* Include an application protocol list in the TLS ClientHello
@@ -885,6 +1805,18 @@ BaseType_t TLS_Connect( void * pvContext )
         xResult = mbedtls_ssl_set_hostname( &pxCtx->xMbedSslCtx, pxCtx->pcDestination );
     }
 
+    /* Offer the session saved for this server. The buffer also receives the
+     * negotiated session once the handshake completes. */
+    if( ( 0 == xResult ) && ( NULL != pxSessionStore ) && ( NULL != pxCtx->pcDestination ) )
+    {
+        pucSession = ( unsigned char * ) pvPortMalloc( 2U * tlsSESSION_MAX_LENGTH ); /*lint !e9079 Allow casting void* to other types. */
+
+        if( NULL != pucSession )
+        {
+            xOfferedLength = prvOfferSession( pxCtx, pucSession );
+        }
+    }
+
     /* Set the socket callbacks. */
     if( 0 == xResult )
     {
@@ -894,6 +1826,9 @@ BaseType_t TLS_Connect( void * pvContext )
                              prvNetworkRecv,
                              NULL );
 
+        pxCtx->ulHandshakeBytes = 0;
+        xStartTime = xTaskGetTickCount();
+
         /* Negotiate. */
         while( 0 != ( xResult = mbedtls_ssl_handshake( &pxCtx->xMbedSslCtx ) ) )
         {
@@ -910,6 +1845,13 @@ BaseType_t TLS_Connect( void * pvContext )
                 break;
             }
         }
+
+        prvEndHandshake( pxCtx, xResult, xStartTime, pucSession, xOfferedLength );
+    }
+
+    if( NULL != pucSession )
+    {
+        vPortFree( pucSession );
     }
 
     /* Keep track of successful completion of the handshake. */
@@ -927,6 +1869,9 @@ BaseType_t TLS_Connect( void * pvContext )
     /* Free up allocated memory. */
     mbedtls_x509_crt_free( &pxCtx->xMbedX509CA );
     mbedtls_x509_crt_free( &pxCtx->xMbedX509Cli );
+    prvHeapTraceAttach( NULL );
+    prvReleaseCertificates( &pxCtx->pxTrustAnchors );
+    prvReleaseCertificates( &pxCtx->pxClientCertificates );
 
     return xResult;
 }
@@ -982,6 +1927,21 @@ BaseType_t TLS_Recv( void * pvContext,
 
 /*-----------------------------------------------------------*/
 
+size_t TLS_Pending( void * pvContext )
+{
+    size_t xPending = 0;
+    TLSContext_t * pxCtx = ( TLSContext_t * ) pvContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
+
+    if( ( NULL != pxCtx ) && ( TLS_HANDSHAKE_SUCCESSFUL == pxCtx->xTLSHandshakeState ) )
+    {
+        xPending = mbedtls_ssl_get_bytes_avail( &pxCtx->xMbedSslCtx );
+    }
+
+    return xPending;
+}
+
+/*-----------------------------------------------------------*/
+
 BaseType_t TLS_Send( void * pvContext,
                      const unsigned char * pucMsg,
                      size_t xMsgLength )
@@ -989,9 +1949,12 @@ BaseType_t TLS_Send( void * pvContext,
     BaseType_t xResult = 0;
     TLSContext_t * pxCtx = ( TLSContext_t * ) pvContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
     size_t xWritten = 0;
+    uint32_t ulStart = tlsTRACE_TIMESTAMP();
 
     if( ( NULL != pxCtx ) && ( TLS_HANDSHAKE_SUCCESSFUL == pxCtx->xTLSHandshakeState ) )
     {
+        pxCtx->ulNetworkTicks = 0;
+
         while( xWritten < xMsgLength )
         {
             xResult = mbedtls_ssl_write( &pxCtx->xMbedSslCtx,
@@ -1018,6 +1981,8 @@ BaseType_t TLS_Send( void * pvContext,
                 break;
             }
         }
+
+        tlsTRACE_ENCRYPT( ( tlsTRACE_TIMESTAMP() - ulStart ) - pxCtx->ulNetworkTicks );
     }
     else
     {
@@ -1046,3 +2011,97 @@ void TLS_Cleanup( void * pvContext )
         vPortFree( pxCtx );
     }
 }
+
+/*-----------------------------------------------------------*/
+
+void TLS_SetSessionStore( const TLSSessionStore_t * pxStore )
+{
+    pxSessionStore = pxStore;
+}
+
+/*-----------------------------------------------------------*/
+
+void TLS_GetHandshakeStats( TLSHandshakeStats_t * pxStats )
+{
+    taskENTER_CRITICAL();
+    *pxStats = xHandshakeStats;
+    taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+void TLS_FlushCertificateCache( void )
+{
+    size_t i;
+
+    /* Nothing was cached before the first TLS_Init. */
+    if( NULL != xCertificateCacheMutex )
+    {
+        ( void ) xSemaphoreTake( xCertificateCacheMutex, portMAX_DELAY );
+
+        for( i = 0; i < tlsCERTIFICATE_CACHE_ENTRIES; i++ )
+        {
+            prvFlushCertificates( &xTrustAnchorCache[ i ] );
+        }
+
+        prvFlushCertificates( &xClientCertificateCache );
+
+        ( void ) xSemaphoreGive( xCertificateCacheMutex );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void TLS_GetMemoryStats( void * pvContext,
+                         TLSMemoryStats_t * pxStats )
+{
+    TLSContext_t * pxCtx = ( TLSContext_t * ) pvContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
+
+    pxStats->ulInContentLength = ( uint32_t ) MBEDTLS_SSL_IN_CONTENT_LEN;
+    pxStats->ulOutContentLength = ( uint32_t ) MBEDTLS_SSL_OUT_CONTENT_LEN;
+    pxStats->ulMaxFragmentLength = pxCtx->ulMaxFragmentLength;
+
+    taskENTER_CRITICAL();
+    pxStats->ulHeapCurrent = ( uint32_t ) pxCtx->xHeapCurrent;
+    pxStats->ulHeapPeak = ( uint32_t ) pxCtx->xHeapPeak;
+    taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+void TLS_HeapTraceMalloc( void * pvAddress,
+                          size_t xSize )
+{
+    TLSContext_t * pxCtx = NULL;
+
+    if( NULL != pvAddress )
+    {
+        pxCtx = prvHeapTraceOwner();
+    }
+
+    if( NULL != pxCtx )
+    {
+        pxCtx->xHeapCurrent += xSize;
+
+        if( pxCtx->xHeapCurrent > pxCtx->xHeapPeak )
+        {
+            pxCtx->xHeapPeak = pxCtx->xHeapCurrent;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void TLS_HeapTraceFree( void * pvAddress,
+                        size_t xSize )
+{
+    TLSContext_t * pxCtx = prvHeapTraceOwner();
+
+    ( void ) pvAddress;
+
+    if( NULL != pxCtx )
+    {
+        /* A block allocated before TLS_Connect, as the context itself. */
+        pxCtx->xHeapCurrent = ( pxCtx->xHeapCurrent > xSize ) ? ( pxCtx->xHeapCurrent - xSize ) : 0U;
+    }
+}
@@ -39,7 +39,7 @@ function(create_test test_name
     foreach(dependency IN LISTS dep_list)
         add_dependencies(${test_name} ${dependency})
     endforeach()
-    target_link_libraries(${test_name} -lgcov)
+    target_link_libraries(${test_name} unity m -lgcov)
 
     target_link_directories(${test_name}  PUBLIC
                             ${CMAKE_CURRENT_BINARY_DIR}/lib
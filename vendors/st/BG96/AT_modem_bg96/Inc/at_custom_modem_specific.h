@@ -37,6 +37,11 @@ extern "C" {
 /* Exported constants --------------------------------------------------------*/
 /* device specific parameters */
 #define MODEM_MAX_SOCKET_TX_DATA_SIZE   CONFIG_MODEM_MAX_SOCKET_TX_DATA_SIZE /* cf AT+QISEND */
+#if defined(CONFIG_MODEM_SOCKET_TX_PIPELINE_DEPTH)
+#define MODEM_SOCKET_TX_PIPELINE_DEPTH  CONFIG_MODEM_SOCKET_TX_PIPELINE_DEPTH
+#else
+#define MODEM_SOCKET_TX_PIPELINE_DEPTH  (1U)
+#endif /* CONFIG_MODEM_SOCKET_TX_PIPELINE_DEPTH */
 #define MODEM_MAX_SOCKET_RX_DATA_SIZE   CONFIG_MODEM_MAX_SOCKET_RX_DATA_SIZE /* cf AT+QIRD */
 #define BG96_ACTIVATE_PING_REPORT       (1)
 
@@ -309,6 +314,7 @@ extern bg96_shared_variables_t bg96_shared;
 /* Exported functions ------------------------------------------------------- */
 void        ATCustom_BG96_init(atparser_context_t *p_atp_ctxt);
 uint8_t     ATCustom_BG96_checkEndOfMsgCallback(uint8_t rxChar);
+uint16_t    ATCustom_BG96_scanEndOfMsgCallback(const uint8_t *p_data, uint16_t size, uint8_t *p_end_of_msg);
 at_status_t ATCustom_BG96_getCmd(at_context_t *p_at_ctxt, uint32_t *p_ATcmdTimeout);
 at_endmsg_t ATCustom_BG96_extractElement(atparser_context_t *p_atp_ctxt,
                                          const IPC_RxMessage_t *p_msg_in,
@@ -48,6 +48,7 @@ extern "C" {
 #define UDP_SERVICE_SUPPORTED                (1U)
 #define CONFIG_MODEM_UDP_SERVICE_CONNECT_IP  ((uint8_t *)"127.0.0.1")
 #define CONFIG_MODEM_MAX_SOCKET_TX_DATA_SIZE ((uint32_t)1460U)
+#define CONFIG_MODEM_SOCKET_TX_PIPELINE_DEPTH ((uint32_t)4U) /* nb of AT+QISEND chained for one socket send */
 #define CONFIG_MODEM_MAX_SOCKET_RX_DATA_SIZE ((uint32_t)1500U)
 #define CONFIG_MODEM_MAX_SIM_GENERIC_ACCESS_CMD_SIZE ((uint32_t)1460U)
 #define CONFIG_MODEM_MIN_SIM_GENERIC_ACCESS_RSP_SIZE ((uint32_t)4U)
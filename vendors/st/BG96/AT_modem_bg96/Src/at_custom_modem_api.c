@@ -48,6 +48,7 @@ void atcma_init_at_func_ptrs(atcustom_funcPtrs_t *funcPtrs)
   /* init function pointers with BG96 functions */
   funcPtrs->f_init = ATCustom_BG96_init;
   funcPtrs->f_checkEndOfMsgCallback = ATCustom_BG96_checkEndOfMsgCallback;
+  funcPtrs->f_scanEndOfMsgCallback = ATCustom_BG96_scanEndOfMsgCallback;
   funcPtrs->f_getCmd = ATCustom_BG96_getCmd;
   funcPtrs->f_extractElement = ATCustom_BG96_extractElement;
   funcPtrs->f_analyzeCmd = ATCustom_BG96_analyzeCmd;
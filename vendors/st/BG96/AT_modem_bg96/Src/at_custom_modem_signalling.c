@@ -1263,7 +1263,9 @@ at_action_rsp_t fRspAnalyze_QCCID_BG96(at_context_t *p_at_ctxt, atcustom_modem_c
 
   /* analyze parameters for +QCCID */
   START_PARAM_LOOP()
-  if (element_infos->param_rank == 2U)
+  /* no device info buffer when the ICCID is read by the modem init sequence */
+  if ((element_infos->param_rank == 2U)
+      && (p_modem_ctxt->SID_ctxt.device_info != NULL))
   {
     PRINT_DBG("ICCID:")
     PRINT_BUF((const uint8_t *)&p_msg_in->buffer[element_infos->str_start_idx], element_infos->str_size)
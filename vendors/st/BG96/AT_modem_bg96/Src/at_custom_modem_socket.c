@@ -228,6 +228,8 @@ at_status_t fCmdBuild_QISEND_BG96(atparser_context_t *p_atp_ctxt, atcustom_modem
     * > ...DATA...
     *
     * DATA are sent using fCmdBuild_QISEND_WRITE_DATA_BG96()
+    * A send buffer larger than the modem limit is sent as several chunks,
+    * <send_length> is the size of current chunk.
     */
     if (p_modem_ctxt->SID_ctxt.socketSendData_struct.ip_addr_type == CS_IPAT_INVALID)
     {
@@ -237,7 +239,7 @@ at_status_t fCmdBuild_QISEND_BG96(atparser_context_t *p_atp_ctxt, atcustom_modem
       (void) sprintf((CRC_CHAR_t *)p_atp_ctxt->current_atcmd.params, "%ld,%ld",
                      atcm_socket_get_modem_cid(p_modem_ctxt,
                                                p_modem_ctxt->SID_ctxt.socketSendData_struct.socket_handle),
-                     p_modem_ctxt->SID_ctxt.socketSendData_struct.buffer_size
+                     p_modem_ctxt->socket_ctxt.socket_tx_chunk_size
                     );
     }
     else
@@ -248,7 +250,7 @@ at_status_t fCmdBuild_QISEND_BG96(atparser_context_t *p_atp_ctxt, atcustom_modem
       (void) sprintf((CRC_CHAR_t *)p_atp_ctxt->current_atcmd.params, "%ld,%ld,\"%s\",%d",
                      atcm_socket_get_modem_cid(p_modem_ctxt,
                                                p_modem_ctxt->SID_ctxt.socketSendData_struct.socket_handle),
-                     p_modem_ctxt->SID_ctxt.socketSendData_struct.buffer_size,
+                     p_modem_ctxt->socket_ctxt.socket_tx_chunk_size,
                      p_modem_ctxt->SID_ctxt.socketSendData_struct.ip_addr_value,
                      p_modem_ctxt->SID_ctxt.socketSendData_struct.remote_port
                     );
@@ -271,9 +273,11 @@ at_status_t fCmdBuild_QISEND_WRITE_DATA_BG96(atparser_context_t *p_atp_ctxt,
   {
     if (p_modem_ctxt->SID_ctxt.socketSendData_struct.p_buffer_addr_send != NULL)
     {
-      uint32_t str_size = p_modem_ctxt->SID_ctxt.socketSendData_struct.buffer_size;
+      /* send current chunk of the buffer */
+      uint32_t str_size = p_modem_ctxt->socket_ctxt.socket_tx_chunk_size;
+      uint32_t str_offset = p_modem_ctxt->socket_ctxt.socket_tx_offset;
       (void) memcpy((void *)p_atp_ctxt->current_atcmd.params,
-                    (const CS_CHAR_t *)p_modem_ctxt->SID_ctxt.socketSendData_struct.p_buffer_addr_send,
+                    (const CS_CHAR_t *)&p_modem_ctxt->SID_ctxt.socketSendData_struct.p_buffer_addr_send[str_offset],
                     (size_t) str_size);
 
       /* set raw command size */
@@ -650,15 +654,26 @@ at_action_rsp_t fRspAnalyze_QIRD_BG96(at_context_t *p_at_ctxt, atcustom_modem_co
     if (element_infos->param_rank == 2U)
     {
       /* <read_actual_length> */
-      PRINT_INFO("+QIRD: received data size = %ld",
-                 ATutil_convertStringToInt(&p_msg_in->buffer[element_infos->str_start_idx], element_infos->str_size))
-      /* NOTE !!! the size is purely informative in current implementation
+      uint32_t data_size = ATutil_convertStringToInt(&p_msg_in->buffer[element_infos->str_start_idx],
+                                                     element_infos->str_size);
+      PRINT_INFO("+QIRD: received data size = %ld", data_size)
+      /* NOTE !!! the size is not used to count the data in current implementation
       *  indeed, due to real time constraints, the socket data header is analyzed directly
       *  in ATCustom_BG96_checkEndOfMsgCallback()
       */
       /* data header analyzed, ready to analyze data payload */
       p_modem_ctxt->socket_ctxt.socket_receive_state = SocketRcvState_RequestData_Payload;
 
+      /* data payload is the next message: IPC delivers it directly to client buffer
+      *  (no intermediate copy in the IPC message buffer)
+      */
+      if ((p_modem_ctxt->socket_ctxt.socketReceivedata.p_buffer_addr_rcv != NULL) &&
+          (data_size <= p_modem_ctxt->socket_ctxt.socketReceivedata.max_buffer_size))
+      {
+        (void) IPC_setRxSink(p_at_ctxt->ipc_handle,
+                             (uint8_t *)p_modem_ctxt->socket_ctxt.socketReceivedata.p_buffer_addr_rcv,
+                             (uint16_t) data_size);
+      }
     }
     else if (element_infos->param_rank == 3U)
     {
@@ -705,18 +720,28 @@ at_action_rsp_t fRspAnalyze_QIRD_data_BG96(at_context_t *p_at_ctxt, atcustom_mod
   PRINT_DBG("DATA received: size=%ld vs %d", p_modem_ctxt->socket_ctxt.socket_rx_expected_buf_size,
             element_infos->str_size)
 
+  if (p_msg_in->sink_size == element_infos->str_size)
+  {
+    /* data already delivered by IPC to client buffer (see +QIRD header analysis) */
+    p_modem_ctxt->socket_ctxt.socketReceivedata.buffer_size = element_infos->str_size;
+    atcm_socket_add_rx_copies(p_modem_ctxt, p_modem_ctxt->socket_ctxt.socketReceivedata.socket_handle,
+                              (uint32_t) p_msg_in->nb_copies, (uint32_t) element_infos->str_size);
+  }
   /* Recopy data to client buffer if:
   *   - pointer on data buffer exists
   *   - and size of data <= maximum size
   */
-  if ((p_modem_ctxt->socket_ctxt.socketReceivedata.p_buffer_addr_rcv != NULL) &&
-      (element_infos->str_size <= p_modem_ctxt->socket_ctxt.socketReceivedata.max_buffer_size))
+  else if ((p_msg_in->sink_size == 0U) &&
+           (p_modem_ctxt->socket_ctxt.socketReceivedata.p_buffer_addr_rcv != NULL) &&
+           (element_infos->str_size <= p_modem_ctxt->socket_ctxt.socketReceivedata.max_buffer_size))
   {
     /* recopy data to client buffer */
     (void) memcpy((void *)p_modem_ctxt->socket_ctxt.socketReceivedata.p_buffer_addr_rcv,
                   (const void *)&p_msg_in->buffer[element_infos->str_start_idx],
                   (size_t) element_infos->str_size);
     p_modem_ctxt->socket_ctxt.socketReceivedata.buffer_size = element_infos->str_size;
+    atcm_socket_add_rx_copies(p_modem_ctxt, p_modem_ctxt->socket_ctxt.socketReceivedata.socket_handle,
+                              (uint32_t) p_msg_in->nb_copies + 1U, (uint32_t) element_infos->str_size);
   }
   else
   {
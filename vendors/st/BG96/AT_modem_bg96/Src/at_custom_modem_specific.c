@@ -134,6 +134,10 @@ static AT_CHAR_t SocketHeaderDataRx_Buf[4];
 static uint8_t SocketHeaderDataRx_Cpt;
 static uint8_t SocketHeaderDataRx_Cpt_Complete;
 
+/* Socket Data receive: to detect data header */
+static const uint8_t QIRD_string[] = "+QIRD";
+static uint8_t QIRD_Counter = 0U;
+
 /* ###########################  END CUSTOMIZATION PART  ########################### */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -273,10 +277,6 @@ uint8_t ATCustom_BG96_checkEndOfMsgCallback(uint8_t rxChar)
 {
   uint8_t last_char = 0U;
 
-  /* static variables */
-  static const uint8_t QIRD_string[] = "+QIRD";
-  static uint8_t QIRD_Counter = 0U;
-
   /*---------------------------------------------------------------------------------------*/
   if (BG96_ctxt.state_SyntaxAutomaton == WAITING_FOR_INIT_CR)
   {
@@ -480,6 +480,101 @@ uint8_t ATCustom_BG96_checkEndOfMsgCallback(uint8_t rxChar)
   return (last_char);
 }
 
+uint16_t ATCustom_BG96_scanEndOfMsgCallback(const uint8_t *p_data, uint16_t size, uint8_t *p_end_of_msg)
+{
+  uint8_t searched_chars[ATUTIL_SCAN_MAX_CHARS];
+  uint8_t nb_searched_chars;
+  uint16_t idx = 0U;
+  uint16_t skip;
+  uint32_t remaining_data;
+
+  *p_end_of_msg = 0U;
+
+  while ((idx < size) && (*p_end_of_msg == 0U))
+  {
+    /* Chars skipped below do not modify the automaton state, they are processed at once.
+    *  The next char is analyzed by ATCustom_BG96_checkEndOfMsgCallback().
+    */
+    skip = 0U;
+    nb_searched_chars = 0U;
+
+    /* socket prompt detection: "greater than" modifies the prompt state, then any char */
+    if (BG96_ctxt.socket_ctxt.socket_send_state == SocketSendState_WaitingPrompt1st_greaterthan)
+    {
+      searched_chars[nb_searched_chars] = (uint8_t)('>');
+      nb_searched_chars++;
+    }
+
+    if (BG96_ctxt.socket_ctxt.socket_send_state == SocketSendState_WaitingPrompt2nd_space)
+    {
+      /* analyze next char */
+    }
+    else if (BG96_ctxt.state_SyntaxAutomaton == WAITING_FOR_SOCKET_DATA)
+    {
+      /* socket data: only count chars, until the last one expected */
+      if (BG96_ctxt.socket_ctxt.socket_rx_expected_buf_size > (BG96_ctxt.socket_ctxt.socket_rx_count_bytes_received + 1U))
+      {
+        remaining_data = BG96_ctxt.socket_ctxt.socket_rx_expected_buf_size -
+                         BG96_ctxt.socket_ctxt.socket_rx_count_bytes_received - 1U;
+        skip = ((uint32_t)(size - idx) < remaining_data) ? (size - idx) : (uint16_t) remaining_data;
+        if (nb_searched_chars != 0U)
+        {
+          skip = ATutil_scan_chars(&p_data[idx], skip, searched_chars, nb_searched_chars);
+        }
+        BG96_ctxt.socket_ctxt.socket_rx_count_bytes_received += skip;
+      }
+    }
+    else if ((BG96_ctxt.state_SyntaxAutomaton == WAITING_FOR_INIT_CR) ||
+             (BG96_ctxt.state_SyntaxAutomaton == WAITING_FOR_CR))
+    {
+      /* waiting for <CR> */
+      searched_chars[nb_searched_chars] = (uint8_t)('\r');
+      nb_searched_chars++;
+      skip = ATutil_scan_chars(&p_data[idx], size - idx, searched_chars, nb_searched_chars);
+    }
+    else if (BG96_ctxt.state_SyntaxAutomaton == WAITING_FOR_FIRST_CHAR)
+    {
+      if (BG96_ctxt.socket_ctxt.socket_RxData_state == SocketRxDataState_waiting_header)
+      {
+        /* waiting for <CR> or next char of +QIRD */
+        if (QIRD_Counter < (uint8_t) sizeof(QIRD_string))
+        {
+          searched_chars[nb_searched_chars] = (uint8_t)('\r');
+          nb_searched_chars++;
+          searched_chars[nb_searched_chars] = QIRD_string[QIRD_Counter];
+          nb_searched_chars++;
+          skip = ATutil_scan_chars(&p_data[idx], size - idx, searched_chars, nb_searched_chars);
+        }
+      }
+      else if ((BG96_ctxt.socket_ctxt.socket_RxData_state != SocketRxDataState_receiving_header) &&
+               (BG96_ctxt.socket_ctxt.socket_RxData_state != SocketRxDataState_receiving_data))
+      {
+        /* waiting for <CR> */
+        searched_chars[nb_searched_chars] = (uint8_t)('\r');
+        nb_searched_chars++;
+        skip = ATutil_scan_chars(&p_data[idx], size - idx, searched_chars, nb_searched_chars);
+      }
+      else
+      {
+        /* socket data header or first data char: analyze next char */
+      }
+    }
+    else
+    {
+      /* waiting for <LF>: analyze next char */
+    }
+
+    idx += skip;
+    if (idx < size)
+    {
+      *p_end_of_msg = ATCustom_BG96_checkEndOfMsgCallback(p_data[idx]);
+      idx++;
+    }
+  }
+
+  return (idx);
+}
+
 at_status_t ATCustom_BG96_getCmd(at_context_t *p_at_ctxt, uint32_t *p_ATcmdTimeout)
 {
   /* static variables */
@@ -1352,24 +1447,51 @@ at_status_t ATCustom_BG96_getCmd(at_context_t *p_at_ctxt, uint32_t *p_ATcmdTimeo
   }
   else if (curSID == (at_msg_t) SID_CS_SEND_DATA)
   {
+    /* Data larger than MODEM_MAX_SOCKET_TX_DATA_SIZE are sent as a chain of
+     * AT+QISEND (up to MODEM_SOCKET_TX_PIPELINE_DEPTH) inside the same SID:
+     * step 3k: AT+QISEND for chunk k, step 3k+1: wait prompt, step 3k+2: send chunk k data
+     */
+    uint8_t chunk_step = p_atp_ctxt->step % 3U;
+    uint32_t remaining_size;
+
     if (p_atp_ctxt->step == 0U)
     {
+      /* nothing sent yet: error report gives the data acknowledged if a chunk fails */
+      BG96_ctxt.socket_ctxt.socket_tx_offset = 0U;
+      BG96_ctxt.SID_ctxt.error_report.error_type = CSERR_SOCKET_SEND;
+      BG96_ctxt.SID_ctxt.error_report.socket_tx_bytes = 0U;
+
       /* Check data size to send */
-      if (BG96_ctxt.SID_ctxt.socketSendData_struct.buffer_size > MODEM_MAX_SOCKET_TX_DATA_SIZE)
+      if (BG96_ctxt.SID_ctxt.socketSendData_struct.buffer_size >
+          (MODEM_MAX_SOCKET_TX_DATA_SIZE * MODEM_SOCKET_TX_PIPELINE_DEPTH))
       {
         PRINT_ERR("Data size to send %ld exceed maximum size %ld",
                   BG96_ctxt.SID_ctxt.socketSendData_struct.buffer_size,
-                  MODEM_MAX_SOCKET_TX_DATA_SIZE)
+                  MODEM_MAX_SOCKET_TX_DATA_SIZE * MODEM_SOCKET_TX_PIPELINE_DEPTH)
         atcm_program_NO_MORE_CMD(p_atp_ctxt);
         retval = ATSTATUS_ERROR;
       }
       else
       {
+        BG96_ctxt.socket_ctxt.socket_tx_chunk_size =
+          (BG96_ctxt.SID_ctxt.socketSendData_struct.buffer_size > MODEM_MAX_SOCKET_TX_DATA_SIZE) ?
+          MODEM_MAX_SOCKET_TX_DATA_SIZE : BG96_ctxt.SID_ctxt.socketSendData_struct.buffer_size;
         BG96_ctxt.socket_ctxt.socket_send_state = SocketSendState_WaitingPrompt1st_greaterthan;
         atcm_program_AT_CMD(&BG96_ctxt, p_atp_ctxt, ATTYPE_WRITE_CMD, (CMD_ID_t) CMD_AT_QISEND, INTERMEDIATE_CMD);
       }
     }
-    else if (p_atp_ctxt->step == 1U)
+    else if (chunk_step == 0U)
+    {
+      /* previous chunk acknowledged by SEND OK: send next chunk */
+      BG96_ctxt.socket_ctxt.socket_tx_offset += BG96_ctxt.socket_ctxt.socket_tx_chunk_size;
+      BG96_ctxt.SID_ctxt.error_report.socket_tx_bytes = BG96_ctxt.socket_ctxt.socket_tx_offset;
+      remaining_size = BG96_ctxt.SID_ctxt.socketSendData_struct.buffer_size - BG96_ctxt.socket_ctxt.socket_tx_offset;
+      BG96_ctxt.socket_ctxt.socket_tx_chunk_size =
+        (remaining_size > MODEM_MAX_SOCKET_TX_DATA_SIZE) ? MODEM_MAX_SOCKET_TX_DATA_SIZE : remaining_size;
+      BG96_ctxt.socket_ctxt.socket_send_state = SocketSendState_WaitingPrompt1st_greaterthan;
+      atcm_program_AT_CMD(&BG96_ctxt, p_atp_ctxt, ATTYPE_WRITE_CMD, (CMD_ID_t) CMD_AT_QISEND, INTERMEDIATE_CMD);
+    }
+    else if (chunk_step == 1U)
     {
       /* waiting for socket prompt: "<CR><LF>> " */
       if (BG96_ctxt.socket_ctxt.socket_send_state == SocketSendState_Prompt_Received)
@@ -1384,25 +1506,32 @@ at_status_t ATCustom_BG96_getCmd(at_context_t *p_at_ctxt, uint32_t *p_ATcmdTimeo
         atcm_program_WAIT_EVENT(p_atp_ctxt, BG96_SOCKET_PROMPT_TIMEOUT, INTERMEDIATE_CMD);
       }
     }
-    else if (p_atp_ctxt->step == 2U)
+    else
     {
-      /* socket prompt received, send DATA */
-      atcm_program_AT_CMD(&BG96_ctxt, p_atp_ctxt, ATTYPE_RAW_CMD, (CMD_ID_t) CMD_AT_QISEND_WRITE_DATA, FINAL_CMD);
+      /* socket prompt received, send DATA: last chunk terminates the SID */
+      remaining_size = BG96_ctxt.SID_ctxt.socketSendData_struct.buffer_size - BG96_ctxt.socket_ctxt.socket_tx_offset;
+      if (remaining_size > BG96_ctxt.socket_ctxt.socket_tx_chunk_size)
+      {
+        atcm_program_AT_CMD(&BG96_ctxt, p_atp_ctxt, ATTYPE_RAW_CMD,
+                            (CMD_ID_t) CMD_AT_QISEND_WRITE_DATA, INTERMEDIATE_CMD);
+      }
+      else
+      {
+        atcm_program_AT_CMD(&BG96_ctxt, p_atp_ctxt, ATTYPE_RAW_CMD,
+                            (CMD_ID_t) CMD_AT_QISEND_WRITE_DATA, FINAL_CMD);
+      }
 
       /* reinit automaton to receive answer */
       reinitSyntaxAutomaton_bg96();
     }
-    else
-    {
-      /* error, invalid step */
-      retval = ATSTATUS_ERROR;
-    }
   }
   else if ((curSID == (at_msg_t) SID_CS_RECEIVE_DATA) ||
            (curSID == (at_msg_t) SID_CS_RECEIVE_DATA_FROM))
   {
     if (p_atp_ctxt->step == 0U)
     {
+      /* cancel direct delivery of data to a client buffer left by a previous request (if aborted) */
+      (void) IPC_setRxSink(p_at_ctxt->ipc_handle, NULL, 0U);
       BG96_ctxt.socket_ctxt.socket_receive_state = SocketRcvState_RequestSize;
       atcm_program_AT_CMD(&BG96_ctxt, p_atp_ctxt, ATTYPE_WRITE_CMD, (CMD_ID_t) CMD_AT_QIRD, INTERMEDIATE_CMD);
     }
@@ -1675,7 +1804,6 @@ at_endmsg_t ATCustom_BG96_extractElement(atparser_context_t *p_atp_ctxt,
 {
   at_endmsg_t retval_msg_end_detected = ATENDMSG_NO;
   bool exit_loop;
-  uint16_t idx;
   uint16_t start_idx;
   uint16_t *p_parseIndex = &(element_infos->current_parse_idx);
 
@@ -1691,8 +1819,11 @@ at_endmsg_t ATCustom_BG96_extractElement(atparser_context_t *p_atp_ctxt,
       *
       */
     start_idx = 0U;
-    /* search initial <CR><LF> sequence (for robustness) */
-    if ((p_msg_in->buffer[0] == (AT_CHAR_t)('\r')) && (p_msg_in->buffer[1] == (AT_CHAR_t)('\n')))
+    /* search initial <CR><LF> sequence (for robustness)
+     * (not for socket data delivered to client buffer: message buffer does not contain it)
+     */
+    if ((p_msg_in->sink_size == 0U) &&
+        (p_msg_in->buffer[0] == (AT_CHAR_t)('\r')) && (p_msg_in->buffer[1] == (AT_CHAR_t)('\n')))
     {
       /* <CR><LF> sequence has been found, it is a command line */
       PRINT_DBG("cmd init sequence <CR><LF> found - break")
@@ -1700,21 +1831,20 @@ at_endmsg_t ATCustom_BG96_extractElement(atparser_context_t *p_atp_ctxt,
       start_idx = 2U;
     }
 
-    exit_loop = false;
-    for (idx = start_idx; (idx < (p_msg_in->size - 1U)) && (exit_loop == false); idx++)
-    {
-      if ((p_atp_ctxt->current_atcmd.id == (CMD_ID_t) CMD_AT_QIRD) &&
-          (BG96_ctxt.socket_ctxt.socket_receive_state == SocketRcvState_RequestData_Payload) &&
-          (BG96_ctxt.socket_ctxt.socket_RxData_state != SocketRxDataState_finished))
-      {
-        PRINT_DBG("receiving socket data (real size=%d)", SocketHeaderRX_getSize())
-        element_infos->str_start_idx = 0U;
-        element_infos->str_end_idx = (uint16_t) BG96_ctxt.socket_ctxt.socket_rx_count_bytes_received;
-        element_infos->str_size = (uint16_t) BG96_ctxt.socket_ctxt.socket_rx_count_bytes_received;
-        BG96_ctxt.socket_ctxt.socket_RxData_state = SocketRxDataState_finished;
-        retval_msg_end_detected = ATENDMSG_YES;
-        exit_loop = true;
-      }
+    /* socket data payload: its size has been counted by the end of message analysis,
+    *  the message content does not need to be parsed
+    */
+    if ((start_idx < (p_msg_in->size - 1U)) &&
+        (p_atp_ctxt->current_atcmd.id == (CMD_ID_t) CMD_AT_QIRD) &&
+        (BG96_ctxt.socket_ctxt.socket_receive_state == SocketRcvState_RequestData_Payload) &&
+        (BG96_ctxt.socket_ctxt.socket_RxData_state != SocketRxDataState_finished))
+    {
+      PRINT_DBG("receiving socket data (real size=%d)", SocketHeaderRX_getSize())
+      element_infos->str_start_idx = 0U;
+      element_infos->str_end_idx = (uint16_t) BG96_ctxt.socket_ctxt.socket_rx_count_bytes_received;
+      element_infos->str_size = (uint16_t) BG96_ctxt.socket_ctxt.socket_rx_count_bytes_received;
+      BG96_ctxt.socket_ctxt.socket_RxData_state = SocketRxDataState_finished;
+      retval_msg_end_detected = ATENDMSG_YES;
     }
 
     /* check if end of message has been detected */
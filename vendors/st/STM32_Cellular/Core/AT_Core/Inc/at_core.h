@@ -140,6 +140,44 @@ typedef uint16_t at_hw_event_t;
 #define HWEVT_UNKNOWN            ((at_hw_event_t) 0U)  /* unknown HW event */
 #define HWEVT_MODEM_RING         ((at_hw_event_t) 1U)  /* modem HW event = RING gpio transition detected */
 
+/* at_cmd_prio_t
+ * priority of a command in the ATCore command queue
+ * (commands of same priority are executed in submission order, priority is ignored in bare mode)
+ */
+typedef enum
+{
+  ATCMD_PRIO_HIGH = 0,    /* socket data transfers, URC follow-up requests */
+  ATCMD_PRIO_NORMAL,      /* default priority (used by AT_sendcmd) */
+  ATCMD_PRIO_LOW,         /* background polling (signal quality, ...) */
+  ATCMD_PRIO_NB,          /* number of priorities */
+} at_cmd_prio_t;
+
+#if (RTOS_USED == 1)
+/* result of a command, returned to the completion callback */
+typedef struct
+{
+  at_msg_t    msg_id;     /* message ID of the command */
+  at_status_t status;     /* status of the AT transaction */
+  at_buf_t    *p_rsp_buf; /* response buffer provided at submission */
+  uint32_t    queued_ms;  /* time spent in the queue before execution */
+  uint32_t    exec_ms;    /* duration of the AT transaction */
+  void        *p_ctx;     /* user context provided at submission */
+} at_cmd_result_t;
+
+/* completion callback, called from the ATCore command thread */
+typedef void (* at_cmd_callback_t)(at_handle_t athandle, const at_cmd_result_t *p_result);
+
+/* latency statistics of the commands executed for one priority */
+typedef struct
+{
+  uint32_t count;         /* number of commands executed */
+  uint32_t errors;        /* number of commands not returning ATSTATUS_OK */
+  uint32_t total_exec_ms; /* cumulated duration of the AT transactions */
+  uint32_t max_exec_ms;   /* longest AT transaction */
+  uint32_t max_queued_ms; /* longest time spent in the queue */
+} at_cmd_stats_t;
+#endif /* RTOS_USED == 1 */
+
 /* External variables --------------------------------------------------------*/
 
 /* Exported macros -----------------------------------------------------------*/
@@ -150,11 +188,16 @@ at_handle_t  AT_open(sysctrl_info_t *p_device_infos, const event_callback_t even
                      urc_callback_t urc_callback);
 at_status_t  AT_reset_context(at_handle_t athandle);
 at_status_t  AT_sendcmd(at_handle_t athandle, at_msg_t msg_in_id, at_buf_t *p_cmd_in_buf, at_buf_t *p_rsp_buf);
+at_status_t  AT_sendcmd_prio(at_handle_t athandle, at_msg_t msg_in_id, at_buf_t *p_cmd_in_buf, at_buf_t *p_rsp_buf,
+                             at_cmd_prio_t prio);
 at_status_t  AT_open_channel(at_handle_t athandle);
 at_status_t  AT_close_channel(at_handle_t athandle);
 void         AT_internalEvent(sysctrl_device_type_t deviceType);
 
 #if (RTOS_USED == 1)
+at_status_t  AT_sendcmd_async(at_handle_t athandle, at_msg_t msg_in_id, at_buf_t *p_cmd_in_buf, at_buf_t *p_rsp_buf,
+                              at_cmd_prio_t prio, at_cmd_callback_t callback, void *p_ctx);
+at_status_t  AT_getcmdstats(at_cmd_prio_t prio, at_cmd_stats_t *p_stats);
 at_status_t atcore_task_start(osPriority taskPrio, uint16_t stackSize);
 #else
 at_status_t  AT_getevent(at_handle_t athandle, at_buf_t *p_rsp_buf);
@@ -43,6 +43,7 @@ typedef enum
 
 typedef void (*ATC_initTypeDef)(atparser_context_t *p_atp_ctxt);
 typedef uint8_t (*ATC_checkEndOfMsgCallbackTypeDef)(uint8_t rxChar);
+typedef uint16_t (*ATC_scanEndOfMsgCallbackTypeDef)(const uint8_t *p_data, uint16_t size, uint8_t *p_end_of_msg);
 typedef at_status_t (*ATC_getCmdTypeDef)(at_context_t *p_at_ctxt,
                                          uint32_t *p_ATcmdTimeout);
 typedef at_endmsg_t (*ATC_extractElementTypeDef)(atparser_context_t *p_atp_ctxt,
@@ -65,6 +66,7 @@ typedef struct
   uint8_t                            initialized;
   ATC_initTypeDef                    f_init;
   ATC_checkEndOfMsgCallbackTypeDef   f_checkEndOfMsgCallback;
+  ATC_scanEndOfMsgCallbackTypeDef    f_scanEndOfMsgCallback; /* optional (NULL if not implemented) */
   ATC_getCmdTypeDef                  f_getCmd;
   ATC_extractElementTypeDef          f_extractElement;
   ATC_analyzeCmdTypeDef              f_analyzeCmd;
@@ -85,6 +87,7 @@ typedef struct
 at_status_t atcc_initParsers(sysctrl_device_type_t device_type);
 void atcc_init(at_context_t *p_at_ctxt);
 ATC_checkEndOfMsgCallbackTypeDef atcc_checkEndOfMsgCallback(const at_context_t *p_at_ctxt);
+ATC_scanEndOfMsgCallbackTypeDef atcc_scanEndOfMsgCallback(const at_context_t *p_at_ctxt);
 at_status_t atcc_getCmd(at_context_t *p_at_ctxt, uint32_t *p_ATcmdTimeout);
 at_endmsg_t atcc_extractElement(at_context_t *p_at_ctxt,
                                 const IPC_RxMessage_t *p_msg_in,
@@ -129,6 +129,8 @@ typedef struct
   at_bool_t   socket_connected;           /* is socket connected ? */
   at_bool_t   socket_data_pending_urc;    /* is there a pending data urc for this connID ? */
   at_bool_t   socket_closed_pending_urc;  /* is there a pending closed urc for this connID ?*/
+  uint32_t    socket_rx_copies;           /* memcpy done on received data since socket creation */
+  uint32_t    socket_rx_bytes_moved;      /* bytes copied by these memcpy (data size x number of copies) */
 } atcustom_persistent_SOCKET_context_t;
 
 /* atcustom_persistent_context_t is a structure to save datas
@@ -270,6 +272,8 @@ typedef struct
   uint32_t                   socket_rx_expected_buf_size; /* expected size of buffer to receive */
   uint32_t                   socket_rx_count_bytes_received; /* count number of char received actually for input buf */
   csint_socket_cnx_infos_t   *socket_cnx_infos;   /* SID_CS_SOCKET_CNX_STATUS */
+  uint32_t                   socket_tx_offset;     /* offset in send buffer of the chunk being sent */
+  uint32_t                   socket_tx_chunk_size; /* size of the chunk being sent */
 
   /* variables used for socket strings analyze */
   atcustom_socket_send_state_t     socket_send_state;
@@ -65,6 +65,8 @@ at_bool_t       atcm_socket_remaining_urc_data_pending(const atcustom_modem_cont
 at_bool_t       atcm_socket_remaining_urc_closed_by_remote(const atcustom_modem_context_t *p_modem_ctxt);
 at_bool_t       atcm_socket_is_connected(const atcustom_modem_context_t *p_modem_ctxt, socket_handle_t sockHandle);
 at_status_t     atcm_socket_set_connected(atcustom_modem_context_t *p_modem_ctxt, socket_handle_t sockHandle);
+void            atcm_socket_add_rx_copies(atcustom_modem_context_t *p_modem_ctxt, socket_handle_t sockHandle,
+                                          uint32_t nb_copies, uint32_t size);
 
 #ifdef __cplusplus
 }
@@ -105,7 +105,8 @@ typedef struct
 
 /* Exported functions ------------------------------------------------------- */
 at_status_t ATParser_initParsers(sysctrl_device_type_t device_type);
-void ATParser_init(at_context_t *p_at_ctxt, IPC_CheckEndOfMsgCallbackTypeDef *p_checkEndOfMsgCallback);
+void ATParser_init(at_context_t *p_at_ctxt, IPC_CheckEndOfMsgCallbackTypeDef *p_checkEndOfMsgCallback,
+                   IPC_ScanEndOfMsgCallbackTypeDef *p_scanEndOfMsgCallback);
 void ATParser_process_request(at_context_t *p_at_ctxt,
                               at_msg_t msg_id, at_buf_t *p_cmd_buf);
 at_action_send_t ATParser_get_ATcmd(at_context_t *p_at_ctxt,
@@ -29,6 +29,8 @@ extern "C" {
 #include "plf_config.h"
 
 /* Exported constants --------------------------------------------------------*/
+#define ATUTIL_SCAN_MAX_CHARS ((uint8_t) 4U) /* maximum number of chars searched by ATutil_scan_chars() */
+
 /* Exported types ------------------------------------------------------------*/
 /* External variables --------------------------------------------------------*/
 /* Exported macros -----------------------------------------------------------*/
@@ -44,6 +46,7 @@ void     ATutil_convertStringToUpperCase(uint8_t *p_string, uint16_t size);
 uint8_t  ATutil_isNegative(const uint8_t *p_string, uint16_t size);
 uint8_t  ATutil_convert_uint8_to_binary_string(uint32_t value, uint8_t nbBits, uint8_t sizeStr, uint8_t *binStr);
 uint16_t ATutil_remove_quotes(const uint8_t *p_Src, uint16_t srcSize, uint8_t *p_Dst, uint16_t dstSize);
+uint16_t ATutil_scan_chars(const uint8_t *p_buf, uint16_t size, const uint8_t *p_chars, uint8_t nb_chars);
 
 #ifdef __cplusplus
 }
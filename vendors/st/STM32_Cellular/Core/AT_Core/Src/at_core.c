@@ -65,6 +65,38 @@
 #define SIG_IPC_MSG                      (1U) /* signals definition for IPC message queue */
 #define SIG_INTERNAL_EVENT_MODEM         (2U) /* signals definition for internal event from the cellular modem */
 
+#if !defined ATCORE_CMD_QUEUE_SIZE
+#define ATCORE_CMD_QUEUE_SIZE            (8U) /* max number of commands waiting or under execution */
+#endif /* !defined ATCORE_CMD_QUEUE_SIZE */
+#define ATCMD_SLOT_NONE                  (0xFFU)
+
+#if !defined ATCMD_THREAD_PRIO
+#define ATCMD_THREAD_PRIO                osPriorityNormal
+#endif /* !defined ATCMD_THREAD_PRIO */
+#if !defined ATCMD_THREAD_STACK_SIZE
+#define ATCMD_THREAD_STACK_SIZE          (512U)
+#endif /* !defined ATCMD_THREAD_STACK_SIZE */
+
+/* Private typedef -----------------------------------------------------------*/
+/* one entry of the command queue */
+typedef struct
+{
+  at_handle_t       athandle;
+  at_msg_t          msg_id;
+  at_buf_t          *p_cmd_buf;
+  at_buf_t          *p_rsp_buf;
+  at_cmd_prio_t     prio;
+  at_cmd_callback_t callback;    /* NULL for synchronous requests */
+  void              *p_ctx;
+  at_status_t       status;
+  uint32_t          tick_submit;
+  uint32_t          tick_start;
+  uint8_t           next;        /* next slot of same priority, ATCMD_SLOT_NONE if last */
+  uint8_t           in_use;
+  at_bool_t         sync_req;    /* AT_TRUE if the submitter waits on done_sem */
+  osSemaphoreId     done_sem;    /* released when a synchronous request is completed */
+} atcmd_slot_t;
+
 /* Global variables ----------------------------------------------------------*/
 
 /* Private variables ---------------------------------------------------------*/
@@ -78,10 +110,25 @@ static osSemaphoreId s_WaitAnswer_SemaphoreId = NULL;
 /* Queues definition */
 /* this queue is used by IPC to inform that messages are ready to be retrieved */
 static osMessageQId q_msg_IPC_received_Id;
+/* this queue is used to inform the command thread that a command has been queued */
+static osMessageQId q_msg_cmd_queued_Id;
+/* this mutex protects the command queue and the statistics */
+static osMutexId atcmd_MutexId = NULL;
+static osThreadId atcmdTaskId = NULL;
+
+/* command queue: slots are chained in FIFO lists, one per priority */
+static atcmd_slot_t   atcmd_slots[ATCORE_CMD_QUEUE_SIZE];
+static uint8_t        atcmd_head[ATCMD_PRIO_NB];
+static uint8_t        atcmd_tail[ATCMD_PRIO_NB];
+static at_cmd_stats_t atcmd_stats[ATCMD_PRIO_NB];
 
 /* Private function prototypes -----------------------------------------------*/
 static at_status_t findMsgReceivedHandle(at_handle_t *athandle);
 static void ATCoreTaskBody(void const *argument);
+static void ATCmdTaskBody(void const *argument);
+static at_status_t queue_cmd(at_handle_t athandle, at_msg_t msg_in_id, at_buf_t *p_cmd_in_buf, at_buf_t *p_rsp_buf,
+                             at_cmd_prio_t prio, at_cmd_callback_t callback, void *p_ctx, uint8_t *p_slot);
+static void release_slot(uint8_t slot);
 #endif /* RTOS_USED == 1 */
 
 /* Private variables ---------------------------------------------------------*/
@@ -92,6 +139,7 @@ static urc_callback_t  register_URC_callback[ATCORE_MAX_HANDLES];
 static IPC_RxMessage_t msgFromIPC[ATCORE_MAX_HANDLES];        /* array of IPC msg (1 per ATCore handler) */
 static __IO uint8_t    MsgReceived[ATCORE_MAX_HANDLES] = {0}; /* array of rx msg counters (1 per ATCore handler) */
 static IPC_CheckEndOfMsgCallbackTypeDef custom_checkEndOfMsgCallback = NULL;
+static IPC_ScanEndOfMsgCallbackTypeDef custom_scanEndOfMsgCallback = NULL;
 
 #if (RTOS_USED == 0)
 static event_callback_t    register_event_callback[ATCORE_MAX_HANDLES];
@@ -104,6 +152,7 @@ static void msgReceivedCallback(IPC_Handle_t *ipcHandle);
 static void msgSentCallback(IPC_Handle_t *ipcHandle);
 static uint8_t find_index(const IPC_Handle_t *ipcHandle);
 
+static at_status_t execute_cmd(at_handle_t athandle, at_msg_t msg_in_id, at_buf_t *p_cmd_in_buf, at_buf_t *p_rsp_buf);
 static at_status_t process_AT_transaction(at_handle_t athandle, at_msg_t msg_in_id, at_buf_t *p_rsp_buf);
 static at_status_t allocate_ATHandle(at_handle_t *athandle);
 static at_handle_t find_deviceType_ATHandle(sysctrl_device_type_t deviceType);
@@ -231,7 +280,7 @@ at_handle_t  AT_open(sysctrl_info_t *p_device_infos, const event_callback_t even
         register_URC_callback[affectedHandle] = urc_callback;
 
         /* init the ATParser */
-        ATParser_init(&at_context[affectedHandle], &custom_checkEndOfMsgCallback);
+        ATParser_init(&at_context[affectedHandle], &custom_checkEndOfMsgCallback, &custom_scanEndOfMsgCallback);
       }
       else
       {
@@ -274,6 +323,8 @@ at_status_t  AT_open_channel(at_handle_t athandle)
                  msgSentCallback,
                  custom_checkEndOfMsgCallback) == IPC_OK)
     {
+      /* analyze received blocks of chars at once (if supported by the modem) */
+      (void) IPC_setScanEndOfMsgCallback(at_context[athandle].ipc_handle, custom_scanEndOfMsgCallback);
 
       /* Select the IPC opened channel as current channel */
       if (IPC_select(at_context[athandle].ipc_handle) == IPC_OK)
@@ -372,6 +423,7 @@ at_status_t AT_reset_context(at_handle_t athandle)
 /**
   * @brief  Request to send an AT command
   * @note   The command will be sent to the current active channel.
+  * @note   With RTOS, the command is queued with normal priority (see AT_sendcmd_prio).
   * @param  athandle Handle of the AT context.
   * @param  msg_in_id Message ID.
   * @param  p_cmd_in_buf Pointer to the buffer with the command to send.
@@ -384,89 +436,113 @@ at_status_t AT_sendcmd(at_handle_t athandle, at_msg_t msg_in_id, at_buf_t *p_cmd
   *  This is a blocking function.
   *  It returns when the command is fully processed or a timeout expires.
   */
+  return (AT_sendcmd_prio(athandle, msg_in_id, p_cmd_in_buf, p_rsp_buf, ATCMD_PRIO_NORMAL));
+}
+
+/**
+  * @brief  Request to send an AT command with a given priority
+  * @note   This is a blocking function: the command is queued and the caller
+  *         waits for its completion.
+  * @note   Commands submitted before the command thread is started, or from a
+  *         completion callback, are executed directly.
+  * @note   In bare mode, the command is always executed directly.
+  * @param  athandle Handle of the AT context.
+  * @param  msg_in_id Message ID.
+  * @param  p_cmd_in_buf Pointer to the buffer with the command to send.
+  * @param  p_rsp_buf Pointer to the buffer to return the response.
+  * @param  prio Priority of the command in the queue.
+  * @retval at_status_t
+  */
+at_status_t AT_sendcmd_prio(at_handle_t athandle, at_msg_t msg_in_id, at_buf_t *p_cmd_in_buf, at_buf_t *p_rsp_buf,
+                            at_cmd_prio_t prio)
+{
   at_status_t retval;
+#if (RTOS_USED == 1)
+  uint8_t slot;
 
-  if (athandle == AT_HANDLE_INVALID)
+  if ((atcmdTaskId == NULL) || (osThreadGetId() == atcmdTaskId))
   {
-    retval = ATSTATUS_ERROR;
-    LOG_ERROR(21, ERROR_WARNING);
+    /* command thread not available: execute in caller context */
+    retval = execute_cmd(athandle, msg_in_id, p_cmd_in_buf, p_rsp_buf);
   }
   else
   {
-    /* Check if a command is already ongoing for this handle */
-    if (at_context[athandle].processing_cmd == 1U)
+    retval = queue_cmd(athandle, msg_in_id, p_cmd_in_buf, p_rsp_buf, prio, NULL, NULL, &slot);
+    if (retval == ATSTATUS_OK)
     {
-      TRACE_ERR("!!!!!!!!!!!!!!!!!! WARNING COMMAND IS UNDER PROCESS !!!!!!!!!!!!!!!!!!")
-      retval = ATSTATUS_ERROR;
-      LOG_ERROR(2, ERROR_WARNING);
-      goto exit_func;
+      /* wait until the command thread has executed the command */
+      (void) osSemaphoreWait(atcmd_slots[slot].done_sem, RTOS_WAIT_FOREVER);
+      retval = atcmd_slots[slot].status;
+      release_slot(slot);
     }
+  }
+#else
+  UNUSED(prio);
+  retval = execute_cmd(athandle, msg_in_id, p_cmd_in_buf, p_rsp_buf);
+#endif /* RTOS_USED == 1 */
 
-    /* initialize response buffer */
-    (void) memset((void *)p_rsp_buf, 0, ATCMD_MAX_BUF_SIZE);
-
-    /* start to process this command */
-    at_context[athandle].processing_cmd = 1U;
+  return (retval);
+}
 
 #if (RTOS_USED == 1)
-    /* save ptr on response buffer */
-    at_context[athandle].p_rsp_buf = p_rsp_buf;
-#endif /* RTOS_USED == 1 */
 
-    /* Check if current mode is DATA mode */
-    if (at_context[athandle].in_data_mode == AT_TRUE)
-    {
-      /* Check if user command is DATA suspend */
-      if (msg_in_id == (at_msg_t) SID_CS_DATA_SUSPEND)
-      {
-        /* restore IPC Command channel to send ESCAPE COMMAND */
-        TRACE_DBG("<<< restore IPC COMMAND channel >>>")
-        (void) IPC_select(at_context[athandle].ipc_handle);
-      }
-    }
-    /* check if trying to suspend DATA while in command mode */
-    else if (msg_in_id == (at_msg_t) SID_CS_DATA_SUSPEND)
-    {
-      retval = ATSTATUS_ERROR;
-      LOG_ERROR(3, ERROR_WARNING);
-      TRACE_ERR("DATA not active")
-      goto exit_func;
-    }
-    else
-    {
-      /* nothing to do */
-    }
+/**
+  * @brief  Request to send an AT command without waiting for its completion
+  * @note   The command is queued and executed by the command thread, highest
+  *         priority first. The buffers must remain valid until the callback is called.
+  * @note   The callback is called from the command thread, it may call AT_sendcmd.
+  * @param  athandle Handle of the AT context.
+  * @param  msg_in_id Message ID.
+  * @param  p_cmd_in_buf Pointer to the buffer with the command to send.
+  * @param  p_rsp_buf Pointer to the buffer to return the response.
+  * @param  prio Priority of the command in the queue.
+  * @param  callback Completion callback (may be NULL).
+  * @param  p_ctx User context returned in the completion callback.
+  * @retval at_status_t ATSTATUS_ERROR if the queue is full or the command thread is not started.
+  */
+at_status_t AT_sendcmd_async(at_handle_t athandle, at_msg_t msg_in_id, at_buf_t *p_cmd_in_buf, at_buf_t *p_rsp_buf,
+                             at_cmd_prio_t prio, at_cmd_callback_t callback, void *p_ctx)
+{
+  at_status_t retval;
 
-    /* Process the user request */
-    ATParser_process_request(&at_context[athandle], msg_in_id, p_cmd_in_buf);
+  if (atcmdTaskId == NULL)
+  {
+    TRACE_ERR("command thread not started")
+    retval = ATSTATUS_ERROR;
+  }
+  else
+  {
+    retval = queue_cmd(athandle, msg_in_id, p_cmd_in_buf, p_rsp_buf, prio, callback, p_ctx, NULL);
+  }
 
-    /* Start an AT command transaction */
-    retval = process_AT_transaction(athandle, msg_in_id, p_rsp_buf);
-    if (retval != ATSTATUS_OK)
-    {
-      TRACE_DBG("AT_sendcmd error: process AT transaction")
-      /* retrieve and send error report if exist */
-      (void) ATParser_get_error(&at_context[athandle], p_rsp_buf);
-      ATParser_abort_request(&at_context[athandle]);
-      if (msg_in_id == (at_msg_t) SID_CS_DATA_SUSPEND)
-      {
-        /* force to return to command mode */
-        TRACE_ERR("force to return to COMMAND mode")
-        at_context[athandle].in_data_mode = AT_FALSE ;
-      }
-      goto exit_func;
-    }
+  return (retval);
+}
 
-    /* get command response buffer */
-    (void) ATParser_get_rsp(&at_context[athandle], p_rsp_buf);
+/**
+  * @brief  Get the latency statistics of the commands executed with a given priority.
+  * @param  prio Priority.
+  * @param  p_stats Pointer to the structure to fill.
+  * @retval at_status_t
+  */
+at_status_t AT_getcmdstats(at_cmd_prio_t prio, at_cmd_stats_t *p_stats)
+{
+  at_status_t retval;
 
-exit_func:
-    /* finished to process this command */
-    at_context[athandle].processing_cmd = 0U;
+  if ((prio >= ATCMD_PRIO_NB) || (p_stats == NULL) || (atcmd_MutexId == NULL))
+  {
+    retval = ATSTATUS_ERROR;
+  }
+  else
+  {
+    (void) osMutexWait(atcmd_MutexId, RTOS_WAIT_FOREVER);
+    *p_stats = atcmd_stats[prio];
+    (void) osMutexRelease(atcmd_MutexId);
+    retval = ATSTATUS_OK;
   }
 
   return (retval);
 }
+#endif /* RTOS_USED == 1 */
 
 #if (RTOS_USED == 0)
 /**
@@ -549,6 +625,93 @@ void AT_internalEvent(sysctrl_device_type_t deviceType)
 }
 
 /* Private function Definition -----------------------------------------------*/
+/* execute an AT command in the caller context */
+static at_status_t execute_cmd(at_handle_t athandle, at_msg_t msg_in_id, at_buf_t *p_cmd_in_buf, at_buf_t *p_rsp_buf)
+{
+  at_status_t retval;
+
+  if (athandle == AT_HANDLE_INVALID)
+  {
+    retval = ATSTATUS_ERROR;
+    LOG_ERROR(21, ERROR_WARNING);
+  }
+  else
+  {
+    /* Check if a command is already ongoing for this handle */
+    if (at_context[athandle].processing_cmd == 1U)
+    {
+      TRACE_ERR("!!!!!!!!!!!!!!!!!! WARNING COMMAND IS UNDER PROCESS !!!!!!!!!!!!!!!!!!")
+      retval = ATSTATUS_ERROR;
+      LOG_ERROR(2, ERROR_WARNING);
+      goto exit_func;
+    }
+
+    /* initialize response buffer */
+    (void) memset((void *)p_rsp_buf, 0, ATCMD_MAX_BUF_SIZE);
+
+    /* start to process this command */
+    at_context[athandle].processing_cmd = 1U;
+
+#if (RTOS_USED == 1)
+    /* save ptr on response buffer */
+    at_context[athandle].p_rsp_buf = p_rsp_buf;
+#endif /* RTOS_USED == 1 */
+
+    /* Check if current mode is DATA mode */
+    if (at_context[athandle].in_data_mode == AT_TRUE)
+    {
+      /* Check if user command is DATA suspend */
+      if (msg_in_id == (at_msg_t) SID_CS_DATA_SUSPEND)
+      {
+        /* restore IPC Command channel to send ESCAPE COMMAND */
+        TRACE_DBG("<<< restore IPC COMMAND channel >>>")
+        (void) IPC_select(at_context[athandle].ipc_handle);
+      }
+    }
+    /* check if trying to suspend DATA while in command mode */
+    else if (msg_in_id == (at_msg_t) SID_CS_DATA_SUSPEND)
+    {
+      retval = ATSTATUS_ERROR;
+      LOG_ERROR(3, ERROR_WARNING);
+      TRACE_ERR("DATA not active")
+      goto exit_func;
+    }
+    else
+    {
+      /* nothing to do */
+    }
+
+    /* Process the user request */
+    ATParser_process_request(&at_context[athandle], msg_in_id, p_cmd_in_buf);
+
+    /* Start an AT command transaction */
+    retval = process_AT_transaction(athandle, msg_in_id, p_rsp_buf);
+    if (retval != ATSTATUS_OK)
+    {
+      TRACE_DBG("execute_cmd error: process AT transaction")
+      /* retrieve and send error report if exist */
+      (void) ATParser_get_error(&at_context[athandle], p_rsp_buf);
+      ATParser_abort_request(&at_context[athandle]);
+      if (msg_in_id == (at_msg_t) SID_CS_DATA_SUSPEND)
+      {
+        /* force to return to command mode */
+        TRACE_ERR("force to return to COMMAND mode")
+        at_context[athandle].in_data_mode = AT_FALSE ;
+      }
+      goto exit_func;
+    }
+
+    /* get command response buffer */
+    (void) ATParser_get_rsp(&at_context[athandle], p_rsp_buf);
+
+exit_func:
+    /* finished to process this command */
+    at_context[athandle].processing_cmd = 0U;
+  }
+
+  return (retval);
+}
+
 static uint8_t find_index(const IPC_Handle_t *ipcHandle)
 {
   at_handle_t idx    = 0;
@@ -1120,9 +1283,245 @@ at_status_t atcore_task_start(osPriority taskPrio, uint16_t stackSize)
     }
   }
 
+  if (retval == ATSTATUS_OK)
+  {
+    /* command queue creation */
+    osMutexDef(ATCMD_MUTEX);
+    atcmd_MutexId = osMutexCreate(osMutex(ATCMD_MUTEX));
+    osMessageQDef(ATCMD_MSG_QUEUED, ATCORE_CMD_QUEUE_SIZE, uint16_t);
+    q_msg_cmd_queued_Id = osMessageCreate(osMessageQ(ATCMD_MSG_QUEUED), NULL);
+
+    osSemaphoreDef(ATCMD_SEM_DONE);
+    for (uint8_t slot = 0U; slot < ATCORE_CMD_QUEUE_SIZE; slot++)
+    {
+      atcmd_slots[slot].in_use = 0U;
+      atcmd_slots[slot].done_sem = osSemaphoreCreate(osSemaphore(ATCMD_SEM_DONE), 1);
+      if (atcmd_slots[slot].done_sem == NULL)
+      {
+        retval = ATSTATUS_ERROR;
+      }
+      else
+      {
+        /* init semaphore */
+        (void) osSemaphoreWait(atcmd_slots[slot].done_sem, 0U);
+      }
+    }
+    for (uint8_t prio = 0U; prio < (uint8_t) ATCMD_PRIO_NB; prio++)
+    {
+      atcmd_head[prio] = ATCMD_SLOT_NONE;
+      atcmd_tail[prio] = ATCMD_SLOT_NONE;
+      (void) memset((void *) &atcmd_stats[prio], 0, sizeof(at_cmd_stats_t));
+    }
+
+    if ((atcmd_MutexId == NULL) || (q_msg_cmd_queued_Id == NULL) || (retval != ATSTATUS_OK))
+    {
+      TRACE_ERR("command queue creation error")
+      LOG_ERROR(22, ERROR_WARNING);
+      retval = ATSTATUS_ERROR;
+    }
+    else
+    {
+      /* start command thread */
+      osThreadDef(atcmdTask, ATCmdTaskBody, ATCMD_THREAD_PRIO, 0, ATCMD_THREAD_STACK_SIZE);
+      atcmdTaskId = osThreadCreate(osThread(atcmdTask), NULL);
+      if (atcmdTaskId == NULL)
+      {
+        TRACE_ERR("atcmdTaskId creation error")
+        LOG_ERROR(23, ERROR_WARNING);
+        retval = ATSTATUS_ERROR;
+      }
+      else
+      {
+#if (USE_STACK_ANALYSIS == 1)
+        (void) stackAnalysis_addStackSizeByHandle(atcmdTaskId, ATCMD_THREAD_STACK_SIZE);
+#endif /* USE_STACK_ANALYSIS == 1 */
+      }
+    }
+  }
+
+  return (retval);
+}
+
+static at_status_t queue_cmd(at_handle_t athandle, at_msg_t msg_in_id, at_buf_t *p_cmd_in_buf, at_buf_t *p_rsp_buf,
+                             at_cmd_prio_t prio, at_cmd_callback_t callback, void *p_ctx, uint8_t *p_slot)
+{
+  at_status_t retval = ATSTATUS_ERROR;
+  uint8_t slot = ATCMD_SLOT_NONE;
+
+  if ((athandle == AT_HANDLE_INVALID) || (prio >= ATCMD_PRIO_NB))
+  {
+    LOG_ERROR(21, ERROR_WARNING);
+  }
+  else
+  {
+    (void) osMutexWait(atcmd_MutexId, RTOS_WAIT_FOREVER);
+
+    /* find a free slot */
+    for (uint8_t i = 0U; (i < ATCORE_CMD_QUEUE_SIZE) && (slot == ATCMD_SLOT_NONE); i++)
+    {
+      if (atcmd_slots[i].in_use == 0U)
+      {
+        slot = i;
+      }
+    }
+
+    if (slot != ATCMD_SLOT_NONE)
+    {
+      atcmd_slot_t *p_slot_desc = &atcmd_slots[slot];
+      p_slot_desc->athandle = athandle;
+      p_slot_desc->msg_id = msg_in_id;
+      p_slot_desc->p_cmd_buf = p_cmd_in_buf;
+      p_slot_desc->p_rsp_buf = p_rsp_buf;
+      p_slot_desc->prio = prio;
+      p_slot_desc->callback = callback;
+      p_slot_desc->p_ctx = p_ctx;
+      p_slot_desc->status = ATSTATUS_ERROR;
+      p_slot_desc->tick_submit = HAL_GetTick();
+      p_slot_desc->tick_start = p_slot_desc->tick_submit;
+      p_slot_desc->next = ATCMD_SLOT_NONE;
+      p_slot_desc->in_use = 1U;
+      p_slot_desc->sync_req = (p_slot == NULL) ? AT_FALSE : AT_TRUE;
+
+      /* append to the list of this priority */
+      if (atcmd_tail[prio] == ATCMD_SLOT_NONE)
+      {
+        atcmd_head[prio] = slot;
+      }
+      else
+      {
+        atcmd_slots[atcmd_tail[prio]].next = slot;
+      }
+      atcmd_tail[prio] = slot;
+      retval = ATSTATUS_OK;
+    }
+    (void) osMutexRelease(atcmd_MutexId);
+
+    if (retval == ATSTATUS_OK)
+    {
+      /* wake up the command thread (one message per queued command) */
+      (void) osMessagePut(q_msg_cmd_queued_Id, (uint32_t) slot, 0U);
+      if (p_slot != NULL)
+      {
+        /* synchronous request: slot is released by the submitter */
+        *p_slot = slot;
+      }
+    }
+    else
+    {
+      TRACE_ERR("command queue full (msg id=%d)", msg_in_id)
+      LOG_ERROR(24, ERROR_WARNING);
+    }
+  }
+
   return (retval);
 }
 
+static void release_slot(uint8_t slot)
+{
+  (void) osMutexWait(atcmd_MutexId, RTOS_WAIT_FOREVER);
+  atcmd_slots[slot].in_use = 0U;
+  (void) osMutexRelease(atcmd_MutexId);
+}
+
+static void ATCmdTaskBody(void const *argument)
+{
+  UNUSED(argument);
+
+  osEvent event;
+  uint8_t slot;
+  uint8_t prio;
+  uint32_t tick_end;
+  at_cmd_result_t result;
+  atcmd_slot_t *p_slot_desc;
+  at_cmd_stats_t *p_stats;
+
+  TRACE_DBG("<start ATCmd TASK>")
+
+  /* Infinite loop */
+  for (;;)
+  {
+    /* waiting for a queued command */
+    event = osMessageGet(q_msg_cmd_queued_Id, RTOS_WAIT_FOREVER);
+    if (event.status != osEventMessage)
+    {
+      /* skip this loop iteration */
+      continue;
+    }
+
+    /* pop the oldest command of the highest priority */
+    slot = ATCMD_SLOT_NONE;
+    (void) osMutexWait(atcmd_MutexId, RTOS_WAIT_FOREVER);
+    for (prio = 0U; (prio < (uint8_t) ATCMD_PRIO_NB) && (slot == ATCMD_SLOT_NONE); prio++)
+    {
+      slot = atcmd_head[prio];
+      if (slot != ATCMD_SLOT_NONE)
+      {
+        atcmd_head[prio] = atcmd_slots[slot].next;
+        if (atcmd_head[prio] == ATCMD_SLOT_NONE)
+        {
+          atcmd_tail[prio] = ATCMD_SLOT_NONE;
+        }
+      }
+    }
+    (void) osMutexRelease(atcmd_MutexId);
+
+    if (slot == ATCMD_SLOT_NONE)
+    {
+      /* should not happen */
+      continue;
+    }
+
+    /* execute the command */
+    p_slot_desc = &atcmd_slots[slot];
+    p_slot_desc->tick_start = HAL_GetTick();
+    p_slot_desc->status = execute_cmd(p_slot_desc->athandle, p_slot_desc->msg_id,
+                                      p_slot_desc->p_cmd_buf, p_slot_desc->p_rsp_buf);
+    tick_end = HAL_GetTick();
+
+    result.msg_id = p_slot_desc->msg_id;
+    result.status = p_slot_desc->status;
+    result.p_rsp_buf = p_slot_desc->p_rsp_buf;
+    result.queued_ms = p_slot_desc->tick_start - p_slot_desc->tick_submit;
+    result.exec_ms = tick_end - p_slot_desc->tick_start;
+    result.p_ctx = p_slot_desc->p_ctx;
+    TRACE_DBG("cmd %d (prio %d) queued %ldms exec %ldms", result.msg_id, p_slot_desc->prio,
+              result.queued_ms, result.exec_ms)
+
+    /* update latency statistics */
+    (void) osMutexWait(atcmd_MutexId, RTOS_WAIT_FOREVER);
+    p_stats = &atcmd_stats[p_slot_desc->prio];
+    p_stats->count++;
+    if (result.status != ATSTATUS_OK)
+    {
+      p_stats->errors++;
+    }
+    p_stats->total_exec_ms += result.exec_ms;
+    if (result.exec_ms > p_stats->max_exec_ms)
+    {
+      p_stats->max_exec_ms = result.exec_ms;
+    }
+    if (result.queued_ms > p_stats->max_queued_ms)
+    {
+      p_stats->max_queued_ms = result.queued_ms;
+    }
+    (void) osMutexRelease(atcmd_MutexId);
+
+    if (p_slot_desc->sync_req == AT_TRUE)
+    {
+      /* the submitter reads the status and releases the slot */
+      (void) osSemaphoreRelease(p_slot_desc->done_sem);
+    }
+    else
+    {
+      if (p_slot_desc->callback != NULL)
+      {
+        (* p_slot_desc->callback)(p_slot_desc->athandle, &result);
+      }
+      release_slot(slot);
+    }
+  }
+}
+
 static at_status_t findMsgReceivedHandle(at_handle_t *athandle)
 {
   at_status_t retval = ATSTATUS_ERROR;
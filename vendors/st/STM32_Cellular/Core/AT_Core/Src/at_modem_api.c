@@ -107,6 +107,18 @@ ATC_checkEndOfMsgCallbackTypeDef atcc_checkEndOfMsgCallback(const at_context_t *
   return (at_custom_func[p_at_ctxt->device_type].f_checkEndOfMsgCallback);
 }
 
+/**
+  * @brief  Callback modem function to find end of message in a block of chars.
+  * @note  This function is called by the IPC when chars are received by blocks.
+  * @param  p_at_ctxt Pointer to the modem context.
+  * @retval callback ptr (NULL if not implemented by the modem)
+  */
+ATC_scanEndOfMsgCallbackTypeDef atcc_scanEndOfMsgCallback(const at_context_t *p_at_ctxt)
+{
+  /* called under interruption, do not put trace here */
+  return (at_custom_func[p_at_ctxt->device_type].f_scanEndOfMsgCallback);
+}
+
 /**
   * @brief  Call modem function to retrieve next AT command to send for the requested service.
   * @note   This functions can be called many times for a service if required.
@@ -1590,6 +1590,8 @@ void atcm_reset_persistent_context(atcustom_persistent_context_t *p_persistent_c
     p_tmp->socket_connected = AT_FALSE;
     p_tmp->socket_data_pending_urc = AT_FALSE;
     p_tmp->socket_closed_pending_urc = AT_FALSE;
+    p_tmp->socket_rx_copies = 0U;
+    p_tmp->socket_rx_bytes_moved = 0U;
   }
 
   /* Power Saving Mode info */
@@ -1661,6 +1663,7 @@ void atcm_reset_SID_context(atcustom_SID_context_t *p_sid_ctxt)
 
   p_sid_ctxt->error_report.error_type = CSERR_UNKNOWN;
   p_sid_ctxt->error_report.sim_state = CS_SIMSTATE_UNKNOWN;
+  p_sid_ctxt->error_report.socket_tx_bytes = 0U;
 }
 
 /**
@@ -1702,6 +1705,8 @@ void atcm_reset_SOCKET_context(atcustom_modem_context_t *p_modem_ctxt)
   p_modem_ctxt->socket_ctxt.socket_current_connId = 0U;
   p_modem_ctxt->socket_ctxt.socket_rx_expected_buf_size = 0U;
   p_modem_ctxt->socket_ctxt.socket_rx_count_bytes_received = 0U;
+  p_modem_ctxt->socket_ctxt.socket_tx_offset = 0U;
+  p_modem_ctxt->socket_ctxt.socket_tx_chunk_size = 0U;
 
   p_modem_ctxt->socket_ctxt.socket_send_state = SocketSendState_No_Activity;
   p_modem_ctxt->socket_ctxt.socket_receive_state = SocketRcvState_No_Activity;
@@ -1733,6 +1738,11 @@ at_status_t atcm_searchCmdInLUT(atcustom_modem_context_t *p_modem_ctxt,
     /* null size string */
     retval = ATSTATUS_OK;
   }
+  else if (p_msg_in->sink_size != 0U)
+  {
+    /* message content delivered to a client buffer (socket data): not a command */
+    __NOP();
+  }
   else
   {
     /* search in LUT the ID corresponding to command received */
@@ -1603,7 +1603,9 @@ at_action_rsp_t fRspAnalyze_CGMR(at_context_t *p_at_ctxt, atcustom_modem_context
 
   /* analyze parameters for +CGMR */
   /* only for execution command, set parameters */
-  if (p_atp_ctxt->current_atcmd.type == ATTYPE_EXECUTION_CMD)
+  /* no device info buffer when the revision is read by the power on sequence */
+  if ((p_atp_ctxt->current_atcmd.type == ATTYPE_EXECUTION_CMD)
+      && (p_modem_ctxt->SID_ctxt.device_info != NULL))
   {
     PRINT_DBG("Revision:")
     PRINT_BUF((const uint8_t *)&p_msg_in->buffer[element_infos->str_start_idx], element_infos->str_size)
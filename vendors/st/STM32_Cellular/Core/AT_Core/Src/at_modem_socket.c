@@ -82,6 +82,8 @@ at_status_t atcm_socket_reserve_modem_cid(atcustom_modem_context_t *p_modem_ctxt
     p_modem_ctxt->persist.socket[sockHandle].socket_connected = AT_FALSE;
     p_modem_ctxt->persist.socket[sockHandle].socket_data_pending_urc = AT_FALSE;
     p_modem_ctxt->persist.socket[sockHandle].socket_closed_pending_urc = AT_FALSE;
+    p_modem_ctxt->persist.socket[sockHandle].socket_rx_copies = 0U;
+    p_modem_ctxt->persist.socket[sockHandle].socket_rx_bytes_moved = 0U;
     retval = ATSTATUS_OK;
   }
 
@@ -358,6 +360,24 @@ at_bool_t atcm_socket_is_connected(const atcustom_modem_context_t *p_modem_ctxt,
   return (retval);
 }
 
+/**
+  * @brief  This function accounts the copies done to bring received data to the client buffer of a socket
+  * @param  nb_copies number of memcpy done on the data
+  * @param  size size of the data
+  */
+void atcm_socket_add_rx_copies(atcustom_modem_context_t *p_modem_ctxt, socket_handle_t sockHandle,
+                               uint32_t nb_copies, uint32_t size)
+{
+  if ((sockHandle >= 0) && (sockHandle < (socket_handle_t)CELLULAR_MAX_SOCKETS))
+  {
+    p_modem_ctxt->persist.socket[sockHandle].socket_rx_copies += nb_copies;
+    p_modem_ctxt->persist.socket[sockHandle].socket_rx_bytes_moved += (nb_copies * size);
+    PRINT_DBG("socket handle %ld rx: %ld copies, %ld bytes moved", sockHandle,
+              p_modem_ctxt->persist.socket[sockHandle].socket_rx_copies,
+              p_modem_ctxt->persist.socket[sockHandle].socket_rx_bytes_moved)
+  }
+}
+
 at_status_t atcm_socket_set_connected(atcustom_modem_context_t *p_modem_ctxt, socket_handle_t sockHandle)
 {
   at_status_t retval = ATSTATUS_OK;
@@ -89,13 +89,15 @@ at_status_t ATParser_initParsers(sysctrl_device_type_t device_type)
   return (atcc_initParsers(device_type));
 }
 
-void ATParser_init(at_context_t *p_at_ctxt, IPC_CheckEndOfMsgCallbackTypeDef *p_checkEndOfMsgCallback)
+void ATParser_init(at_context_t *p_at_ctxt, IPC_CheckEndOfMsgCallbackTypeDef *p_checkEndOfMsgCallback,
+                   IPC_ScanEndOfMsgCallbackTypeDef *p_scanEndOfMsgCallback)
 {
   /* reset request context */
   reset_parser_context(&p_at_ctxt->parser);
 
-  /* get callback pointer */
+  /* get callback pointers */
   *p_checkEndOfMsgCallback = atcc_checkEndOfMsgCallback(p_at_ctxt);
+  *p_scanEndOfMsgCallback = atcc_scanEndOfMsgCallback(p_at_ctxt);
 
   /* default termination string for AT command: <CR>
    * this value can be changed in ATCustom init if needed
@@ -339,10 +341,10 @@ at_action_rsp_t ATParser_parse_rsp(at_context_t *p_at_ctxt, IPC_RxMessage_t *p_m
                                     };
   uint16_t data_mode;
 
-  /* DUMP RECEIVE BUFFER */
+  /* DUMP RECEIVE BUFFER (except bytes delivered to a client buffer) */
   display_buffer(p_at_ctxt,
-                 (uint8_t *)&p_message->buffer[0],
-                 (uint16_t)p_message->size, 0U);
+                 (uint8_t *)&p_message->buffer[p_message->sink_size],
+                 (uint16_t)(p_message->size - p_message->sink_size), 0U);
 
   /* extract next element to analyze */
   msg_end = atcc_extractElement(p_at_ctxt, p_message, &element_infos);
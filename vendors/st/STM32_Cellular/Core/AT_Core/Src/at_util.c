@@ -18,6 +18,7 @@
   */
 
 /* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
 #include <string.h>
 #include "at_util.h"
 #include "plf_config.h"
@@ -26,7 +27,11 @@
 /* Private defines -----------------------------------------------------------*/
 #define MAX_32BITS_STRING_SIZE (8U)  /* = max string size for a 32bits value (FFFF.FFFF) */
 #define MAX_64BITS_STRING_SIZE (16U) /* = max string size for a 64bits value (FFFF.FFFF.FFFF.FFFF) */
+#define SWAR_ONES  (0x01010101U)     /* 0x01 in each byte of a word */
+#define SWAR_HIGHS (0x80808080U)     /* 0x80 in each byte of a word */
 /* Private macros ------------------------------------------------------------*/
+/* not null if one of the bytes of the word is null (exact test, but the byte position is not) */
+#define SWAR_HAS_NULL_BYTE(word) (((word) - SWAR_ONES) & ~(word) & SWAR_HIGHS)
 /* Private variables ---------------------------------------------------------*/
 /* Global variables ----------------------------------------------------------*/
 /* Private function prototypes -----------------------------------------------*/
@@ -344,4 +349,87 @@ uint16_t ATutil_remove_quotes(const uint8_t *p_Src, uint16_t srcSize, uint8_t *p
   return (dest_idx);
 }
 
+/**
+  * @brief  Find the first occurence of one of a set of chars in a buffer.
+  * @note   The buffer is read one 32-bit word at a time (SIMD within a register):
+  *         a word without any of the searched chars is skipped at once.
+  * @param  p_buf ptr to the buffer to scan
+  * @param  size of p_buf buffer
+  * @param  p_chars ptr to the chars to search
+  * @param  nb_chars number of chars to search (1 to ATUTIL_SCAN_MAX_CHARS)
+  * @retval index of the first char found, size if none found.
+  */
+uint16_t ATutil_scan_chars(const uint8_t *p_buf, uint16_t size, const uint8_t *p_chars, uint8_t nb_chars)
+{
+  uint32_t pattern[ATUTIL_SCAN_MAX_CHARS];
+  uint32_t word;
+  uint32_t found;
+  uint16_t idx = 0U;
+  uint8_t  nb_patterns;
+  uint8_t  char_idx;
+  bool     match = false;
+
+  nb_patterns = (nb_chars > ATUTIL_SCAN_MAX_CHARS) ? ATUTIL_SCAN_MAX_CHARS : nb_chars;
+  for (char_idx = 0U; char_idx < nb_patterns; char_idx++)
+  {
+    /* searched char repeated in each byte */
+    pattern[char_idx] = (uint32_t)p_chars[char_idx] * SWAR_ONES;
+  }
+
+  /* head: one char at a time until the buffer is word aligned */
+  while ((idx < size) && (match == false) && ((((uintptr_t)&p_buf[idx]) & 3U) != 0U))
+  {
+    for (char_idx = 0U; char_idx < nb_patterns; char_idx++)
+    {
+      if (p_buf[idx] == p_chars[char_idx])
+      {
+        match = true;
+      }
+    }
+    if (match == false)
+    {
+      idx++;
+    }
+  }
+
+  /* body: one word at a time, stop on the first word holding a searched char */
+  while ((match == false) && ((idx + 4U) <= size))
+  {
+    (void) memcpy((void *)&word, (const void *)&p_buf[idx], sizeof(uint32_t));
+    found = 0U;
+    for (char_idx = 0U; char_idx < nb_patterns; char_idx++)
+    {
+      /* bytes equal to the searched char are null after the XOR */
+      found |= SWAR_HAS_NULL_BYTE(word ^ pattern[char_idx]);
+    }
+    if (found != 0U)
+    {
+      match = true;
+    }
+    else
+    {
+      idx += 4U;
+    }
+  }
+
+  /* tail (or word holding a searched char): one char at a time */
+  match = false;
+  while ((idx < size) && (match == false))
+  {
+    for (char_idx = 0U; char_idx < nb_patterns; char_idx++)
+    {
+      if (p_buf[idx] == p_chars[char_idx])
+      {
+        match = true;
+      }
+    }
+    if (match == false)
+    {
+      idx++;
+    }
+  }
+
+  return (idx);
+}
+
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
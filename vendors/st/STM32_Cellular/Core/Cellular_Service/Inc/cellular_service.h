@@ -466,7 +466,8 @@ CS_Status_t CDS_socket_connect(socket_handle_t sockHandle,
                                uint16_t remote_port); /* for socket client mode */
 CS_Status_t CDS_socket_send(socket_handle_t sockHandle,
                             const CS_CHAR_t *p_buf,
-                            uint32_t length);
+                            uint32_t length,
+                            uint32_t *p_sent_length);
 CS_Status_t CDS_socket_sendto(socket_handle_t sockHandle,
                               const CS_CHAR_t *p_buf,
                               uint32_t length,
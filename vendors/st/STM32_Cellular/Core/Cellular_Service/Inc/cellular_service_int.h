@@ -34,6 +34,12 @@ extern "C" {
 #define MAX_IP_ADDR_SIZE               (64U)
 
 #define DEFAULT_IP_MAX_PACKET_SIZE     (1500U) /* Hard-Coded but should use real modem limit */
+#if defined(CONFIG_MODEM_SOCKET_TX_PIPELINE_DEPTH)
+/* modem is able to chain several packets for one socket send */
+#define CS_MAX_SOCKET_TX_DATA_SIZE     (DEFAULT_IP_MAX_PACKET_SIZE * CONFIG_MODEM_SOCKET_TX_PIPELINE_DEPTH)
+#else
+#define CS_MAX_SOCKET_TX_DATA_SIZE     ((uint32_t)DEFAULT_IP_MAX_PACKET_SIZE)
+#endif /* CONFIG_MODEM_SOCKET_TX_PIPELINE_DEPTH */
 #define DEFAULT_TRP_MAX_TIMEOUT        (90U)
 #define DEFAULT_TRP_CONN_SETUP_TIMEOUT (600U)
 #define DEFAULT_TRP_TRANSFER_TIMEOUT   (50U)
@@ -260,6 +266,7 @@ typedef enum
 {
   CSERR_UNKNOWN    = 0,
   CSERR_SIM        = 1,
+  CSERR_SOCKET_SEND = 2,
 
 } csint_error_type_t;
 
@@ -292,6 +299,7 @@ typedef struct
 
   /* detailled error infos =f(error_type) are listed below */
   csint_SIMState_t    sim_state; /* if error_type = CSERR_SIM */
+  uint32_t            socket_tx_bytes; /* if error_type = CSERR_SOCKET_SEND: bytes accepted by modem */
 
 } csint_error_report_t;
 
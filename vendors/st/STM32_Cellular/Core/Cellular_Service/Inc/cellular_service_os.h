@@ -138,18 +138,21 @@ CS_Status_t osCDS_socket_listen(socket_handle_t sockHandle);
   * @brief  Send data over a socket to a remote server.
   * @note   This function is blocking until the data is transfered or when the
   *         timeout to wait for transmission expires.
-  * @note   Call CDS_socket_send with mutex access protection
+  * @note   Call CDS_socket_send with socket path access protection only: socket data transfers
+  *         do not wait for the control commands, the AT core serializes and prioritizes them
   * @param  same parameters as the CDS_socket_send function
   * @retval CS_Status_t
   */
 CS_Status_t osCDS_socket_send(socket_handle_t sockHandle,
                               const CS_CHAR_t *p_buf,
-                              uint32_t length);
+                              uint32_t length,
+                              uint32_t *p_sent_length);
 
 /**
   * @brief  Receive data from the connected remote server.
   * @note   This function is blocking until expected data length is received or a receive timeout has expired.
-  * @note   Call CDS_socket_receive with mutex access protection
+  * @note   Call CDS_socket_receive with socket path access protection only: socket data transfers
+  *         do not wait for the control commands, the AT core serializes and prioritizes them
   * @param  same parameters as the CDS_socket_receive function
   * @retval Size of received data (in bytes).
   */
@@ -161,7 +164,8 @@ int32_t osCDS_socket_receive(socket_handle_t sockHandle,
   * @brief  Send data over a socket to a remote server.
   * @note   This function is blocking until the data is transfered or when the
   *         timeout to wait for transmission expires.
-  * @note   Call CDS_socket_sendto with mutex access protection
+  * @note   Call CDS_socket_sendto with socket path access protection only: socket data transfers
+  *         do not wait for the control commands, the AT core serializes and prioritizes them
   * @param  same parameters as the CDS_socket_sendto function
   * @retval CS_Status_t
   */
@@ -175,7 +179,8 @@ CS_Status_t osCDS_socket_sendto(socket_handle_t sockHandle,
 /**
   * @brief  Receive data from the connected remote server.
   * @note   This function is blocking until expected data length is received or a receive timeout has expired.
-  * @note   Call CDS_socket_receivefrom with mutex access protection
+  * @note   Call CDS_socket_receivefrom with socket path access protection only: socket data transfers
+  *         do not wait for the control commands, the AT core serializes and prioritizes them
   * @param  same parameters as the CDS_socket_receivefrom function
   * @retval Size of received data (in bytes).
   */
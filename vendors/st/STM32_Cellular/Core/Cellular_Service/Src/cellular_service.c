@@ -58,6 +58,12 @@
 /* Cellular service context variables */
 static at_buf_t cmd_buf[ATCMD_MAX_BUF_SIZE];
 static at_buf_t rsp_buf[ATCMD_MAX_BUF_SIZE];
+/* AT buffers of the socket data paths, send/sendto and receive/receivefrom: they are
+   not serialized with the control commands (see cellular_service_os.c) */
+static at_buf_t socket_send_cmd_buf[ATCMD_MAX_BUF_SIZE];
+static at_buf_t socket_send_rsp_buf[ATCMD_MAX_BUF_SIZE];
+static at_buf_t socket_rcv_cmd_buf[ATCMD_MAX_BUF_SIZE];
+static at_buf_t socket_rcv_rsp_buf[ATCMD_MAX_BUF_SIZE];
 
 /* Permanent variables */
 static at_handle_t _Adapter_Handle;
@@ -889,7 +895,9 @@ CS_Status_t CS_get_signal_quality(CS_SignalQuality_t *p_sig_qual)
                         (void *)&local_sig_qual) == DATAPACK_OK)
   {
     at_status_t err;
-    err = AT_sendcmd(_Adapter_Handle, (at_msg_t) SID_CS_GET_SIGNAL_QUALITY, &cmd_buf[0], &rsp_buf[0]);
+    /* background polling: let pending socket transfers go first */
+    err = AT_sendcmd_prio(_Adapter_Handle, (at_msg_t) SID_CS_GET_SIGNAL_QUALITY, &cmd_buf[0], &rsp_buf[0],
+                          ATCMD_PRIO_LOW);
     if (err == ATSTATUS_OK)
     {
       PRINT_DBG("<Cellular_Service> Signal quality informations received")
@@ -1491,24 +1499,29 @@ CS_Status_t CDS_socket_listen(socket_handle_t sockHandle)
   * @brief  Send data over a socket to a remote server.
   * @note   This function is blocking until the data is transfered or when the
   *         timeout to wait for transmission expires.
+  * @note   When the data are sent as several modem commands and one of them fails,
+  *         the data accepted by the modem before the failure are reported in p_sent_length.
   * @param  sockHandle Handle of the socket
   * @param  p_buf Pointer to the data buffer to transfer.
   * @param  length Length of the data buffer.
+  * @param  p_sent_length Length of the data sent (length if CELLULAR_OK), may be NULL.
   * @retval CS_Status_t
   */
 CS_Status_t CDS_socket_send(socket_handle_t sockHandle,
                             const CS_CHAR_t *p_buf,
-                            uint32_t length)
+                            uint32_t length,
+                            uint32_t *p_sent_length)
 {
   CS_Status_t retval = CELLULAR_ERROR;
+  uint32_t sent_length = 0U;
   PRINT_API("CDS_socket_send (buf@=%p - buflength = %ld)", p_buf, length)
 
   /* check that size does not exceed maximum buffers size */
-  if (length > DEFAULT_IP_MAX_PACKET_SIZE)
+  if (length > CS_MAX_SOCKET_TX_DATA_SIZE)
   {
-    PRINT_ERR("<Cellular_Service> buffer size %ld exceed maximum value %d",
+    PRINT_ERR("<Cellular_Service> buffer size %ld exceed maximum value %ld",
               length,
-              DEFAULT_IP_MAX_PACKET_SIZE)
+              CS_MAX_SOCKET_TX_DATA_SIZE)
   }
   /* check that socket has been allocated */
   else if (cs_ctxt_sockets_info[sockHandle].state != SOCKETSTATE_CONNECTED)
@@ -1532,24 +1545,50 @@ CS_Status_t CDS_socket_send(socket_handle_t sockHandle,
      * send_data_struct.ip_addr_type = CS_IPAT_INVALID; */
     /* send_data_struct.ip_addr_value already reset */
     /* send_data_struct.remote_port already reset */
-    if (DATAPACK_writeStruct(&cmd_buf[0],
+    if (DATAPACK_writeStruct(&socket_send_cmd_buf[0],
                              (uint16_t) CSMT_SOCKET_DATA_BUFFER,
                              (uint16_t) sizeof(csint_socket_data_buffer_t),
                              (void *)&send_data_struct) == DATAPACK_OK)
     {
       at_status_t err;
-      err = AT_sendcmd(_Adapter_Handle, (at_msg_t) SID_CS_SEND_DATA, &cmd_buf[0], &rsp_buf[0]);
+      (void) memset((void *)&socket_send_rsp_buf[0], 0, sizeof(socket_send_rsp_buf));
+      err = AT_sendcmd_prio(_Adapter_Handle, (at_msg_t) SID_CS_SEND_DATA, &socket_send_cmd_buf[0], &socket_send_rsp_buf[0],
+                            ATCMD_PRIO_HIGH);
       if (err == ATSTATUS_OK)
       {
         PRINT_DBG("<Cellular_Service> socket data sent")
+        sent_length = length;
         retval = CELLULAR_OK;
       }
+      else if (DATAPACK_readMsgType(&socket_send_rsp_buf[0]) == (uint16_t) CSMT_ERROR_REPORT)
+      {
+        /* partial send: data accepted by the modem before the error */
+        csint_error_report_t error_report;
+        if ((DATAPACK_readStruct(&socket_send_rsp_buf[0],
+                                 (uint16_t) CSMT_ERROR_REPORT,
+                                 (uint16_t) sizeof(csint_error_report_t),
+                                 (void *)&error_report) == DATAPACK_OK)
+            && (error_report.error_type == CSERR_SOCKET_SEND)
+            && (error_report.socket_tx_bytes < length))
+        {
+          sent_length = error_report.socket_tx_bytes;
+        }
+      }
+      else
+      {
+        /* no error report: nothing sent */
+      }
     }
   }
 
+  if (p_sent_length != NULL)
+  {
+    *p_sent_length = sent_length;
+  }
+
   if (retval == CELLULAR_ERROR)
   {
-    PRINT_ERR("<Cellular_Service> error when sending data to socket")
+    PRINT_ERR("<Cellular_Service> error when sending data to socket (%ld/%ld bytes sent)", sent_length, length)
   }
   return (retval);
 }
@@ -1625,12 +1664,13 @@ CS_Status_t CDS_socket_sendto(socket_handle_t sockHandle,
                     (const CS_CHAR_t *)p_ip_addr_value,
                     ip_addr_length);
       send_data_struct.remote_port = remote_port;
-      if (DATAPACK_writeStruct(&cmd_buf[0],
+      if (DATAPACK_writeStruct(&socket_send_cmd_buf[0],
                                (uint16_t) CSMT_SOCKET_DATA_BUFFER,
                                (uint16_t) sizeof(csint_socket_data_buffer_t),
                                (void *)&send_data_struct) == DATAPACK_OK)
       {
-        err = AT_sendcmd(_Adapter_Handle, (at_msg_t) SID_CS_SEND_DATA, &cmd_buf[0], &rsp_buf[0]);
+        err = AT_sendcmd_prio(_Adapter_Handle, (at_msg_t) SID_CS_SEND_DATA, &socket_send_cmd_buf[0], &socket_send_rsp_buf[0],
+                              ATCMD_PRIO_HIGH);
         if (err == ATSTATUS_OK)
         {
           PRINT_DBG("<Cellular_Service> socket data sent (sendto)")
@@ -1696,16 +1736,17 @@ int32_t CDS_socket_receive(socket_handle_t sockHandle,
      * receive_data_struct.ip_addr_type = CS_IPAT_INVALID; */
     /* receive_data_struct.ip_addr_value already reset */
     /* receive_data_struct.remote_port already reset */
-    if (DATAPACK_writeStruct(&cmd_buf[0],
+    if (DATAPACK_writeStruct(&socket_rcv_cmd_buf[0],
                              (uint16_t) CSMT_SOCKET_DATA_BUFFER,
                              (uint16_t) sizeof(csint_socket_data_buffer_t),
                              (void *)&receive_data_struct) == DATAPACK_OK)
     {
       at_status_t err;
-      err = AT_sendcmd(_Adapter_Handle, (at_msg_t) SID_CS_RECEIVE_DATA, &cmd_buf[0], &rsp_buf[0]);
+      err = AT_sendcmd_prio(_Adapter_Handle, (at_msg_t) SID_CS_RECEIVE_DATA, &socket_rcv_cmd_buf[0], &socket_rcv_rsp_buf[0],
+                            ATCMD_PRIO_HIGH);
       if (err == ATSTATUS_OK)
       {
-        if (DATAPACK_readStruct(&rsp_buf[0],
+        if (DATAPACK_readStruct(&socket_rcv_rsp_buf[0],
                                 (uint16_t) CSMT_SOCKET_RXDATA,
                                 (uint16_t) sizeof(uint32_t),
                                 &bytes_received) == DATAPACK_OK)
@@ -1787,17 +1828,18 @@ int32_t CDS_socket_receivefrom(socket_handle_t sockHandle,
      * receive_data_struct.ip_addr_type = CS_IPAT_INVALID; */
     /* receive_data_struct.ip_addr_value already reset */
     /* receive_data_struct.remote_port already reset */
-    if (DATAPACK_writeStruct(&cmd_buf[0],
+    if (DATAPACK_writeStruct(&socket_rcv_cmd_buf[0],
                              (uint16_t) CSMT_SOCKET_DATA_BUFFER,
                              (uint16_t) sizeof(csint_socket_data_buffer_t),
                              (void *)&receive_data_struct) == DATAPACK_OK)
     {
       at_status_t err;
-      err = AT_sendcmd(_Adapter_Handle, (at_msg_t) SID_CS_RECEIVE_DATA_FROM, &cmd_buf[0], &rsp_buf[0]);
+      err = AT_sendcmd_prio(_Adapter_Handle, (at_msg_t) SID_CS_RECEIVE_DATA_FROM, &socket_rcv_cmd_buf[0], &socket_rcv_rsp_buf[0],
+                            ATCMD_PRIO_HIGH);
       if (err == ATSTATUS_OK)
       {
         csint_socket_rxdata_from_t  rx_data_from;
-        if (DATAPACK_readStruct(&rsp_buf[0],
+        if (DATAPACK_readStruct(&socket_rcv_rsp_buf[0],
                                 (uint16_t) CSMT_SOCKET_RXDATA_FROM,
                                 (uint16_t) sizeof(csint_socket_rxdata_from_t),
                                 &rx_data_from) == DATAPACK_OK)
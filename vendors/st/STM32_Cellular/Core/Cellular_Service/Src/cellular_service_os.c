@@ -32,6 +32,10 @@
 
 /* Private variables ---------------------------------------------------------*/
 static osMutexId CellularServiceMutexHandle;
+/* socket data paths: taken alone by send/sendto and receive/receivefrom, both before
+   CellularServiceMutexHandle by the calls changing the socket context */
+static osMutexId CellularServiceSocketSendMutexHandle;
+static osMutexId CellularServiceSocketRcvMutexHandle;
 static osMutexId CellularServiceGeneralMutexHandle;
 
 /* Global variables ----------------------------------------------------------*/
@@ -60,7 +64,8 @@ CS_Status_t osCS_get_signal_quality(CS_SignalQuality_t *p_sig_qual)
 
 /**
   * @brief  Allocate a socket among of the free sockets (maximum 6 sockets)
-  * @note   Call CDS_socket_create with mutex acces protection
+  * @note   Call CDS_socket_create with socket paths and mutex access protection:
+  *         the socket context does not change during a socket data transfer
   * @param  same parameters as the CDS_socket_create function
   * @retval Socket handle which references allocated socket
   */
@@ -70,12 +75,16 @@ socket_handle_t osCDS_socket_create(CS_IPaddrType_t addr_type,
 {
   socket_handle_t socket_handle;
 
+  (void)osMutexWait(CellularServiceSocketSendMutexHandle, RTOS_WAIT_FOREVER);
+  (void)osMutexWait(CellularServiceSocketRcvMutexHandle, RTOS_WAIT_FOREVER);
   (void)osMutexWait(CellularServiceMutexHandle, RTOS_WAIT_FOREVER);
 
   socket_handle = CDS_socket_create(addr_type,
                                     protocol,
                                     cid);
   (void)osMutexRelease(CellularServiceMutexHandle);
+  (void)osMutexRelease(CellularServiceSocketRcvMutexHandle);
+  (void)osMutexRelease(CellularServiceSocketSendMutexHandle);
 
   return (socket_handle);
 }
@@ -83,7 +92,8 @@ socket_handle_t osCDS_socket_create(CS_IPaddrType_t addr_type,
 /**
   * @brief  Set the callbacks to use when datas are received or sent.
   * @note   This function has to be called before to use a socket.
-  * @note   Call CDS_socket_set_callbacks with mutex access protection
+  * @note   Call CDS_socket_set_callbacks with socket paths and mutex access protection:
+  *         the socket context does not change during a socket data transfer
   * @param  same parameters as the CDS_socket_set_callbacks function
   * @retval CS_Status_t
   */
@@ -94,6 +104,8 @@ CS_Status_t osCDS_socket_set_callbacks(socket_handle_t sockHandle,
 {
   CS_Status_t result;
 
+  (void)osMutexWait(CellularServiceSocketSendMutexHandle, RTOS_WAIT_FOREVER);
+  (void)osMutexWait(CellularServiceSocketRcvMutexHandle, RTOS_WAIT_FOREVER);
   (void)osMutexWait(CellularServiceMutexHandle, RTOS_WAIT_FOREVER);
 
   result = CDS_socket_set_callbacks(sockHandle,
@@ -102,6 +114,8 @@ CS_Status_t osCDS_socket_set_callbacks(socket_handle_t sockHandle,
                                     remote_close_cb);
 
   (void)osMutexRelease(CellularServiceMutexHandle);
+  (void)osMutexRelease(CellularServiceSocketRcvMutexHandle);
+  (void)osMutexRelease(CellularServiceSocketSendMutexHandle);
 
   return (result);
 }
@@ -110,7 +124,8 @@ CS_Status_t osCDS_socket_set_callbacks(socket_handle_t sockHandle,
   * @brief  Define configurable options for a created socket.
   * @note   This function is called to configure one parameter at a time.
   *         If a parameter is not configured with this function, a default value will be applied.
-  * @note   Call CDS_socket_set_option with mutex access protection
+  * @note   Call CDS_socket_set_option with socket paths and mutex access protection:
+  *         the socket context does not change during a socket data transfer
   * @param  same parameters as the CDS_socket_set_option function
   * @retval CS_Status_t
   */
@@ -122,6 +137,8 @@ CS_Status_t osCDS_socket_set_option(socket_handle_t sockHandle,
 {
   CS_Status_t result;
 
+  (void)osMutexWait(CellularServiceSocketSendMutexHandle, RTOS_WAIT_FOREVER);
+  (void)osMutexWait(CellularServiceSocketRcvMutexHandle, RTOS_WAIT_FOREVER);
   (void)osMutexWait(CellularServiceMutexHandle, RTOS_WAIT_FOREVER);
 
   result = CDS_socket_set_option(sockHandle,
@@ -130,6 +147,8 @@ CS_Status_t osCDS_socket_set_option(socket_handle_t sockHandle,
                                  p_opt_val);
 
   (void)osMutexRelease(CellularServiceMutexHandle);
+  (void)osMutexRelease(CellularServiceSocketRcvMutexHandle);
+  (void)osMutexRelease(CellularServiceSocketSendMutexHandle);
 
   return (result);
 }
@@ -162,7 +181,8 @@ CS_Status_t osCDS_socket_get_option(void)
 /**
   * @brief  Bind the socket to a local port.
   * @note   If this function is not called, default local port value = 0 will be used.
-  * @note   Call CDS_socket_bind with mutex access protection
+  * @note   Call CDS_socket_bind with socket paths and mutex access protection:
+  *         the socket context does not change during a socket data transfer
   * @param  same parameters as the CDS_socket_bind function
   * @retval CS_Status_t
   */
@@ -173,12 +193,16 @@ CS_Status_t osCDS_socket_bind(socket_handle_t sockHandle,
 
   if (CST_get_state() == CST_MODEM_DATA_READY_STATE)
   {
+    (void)osMutexWait(CellularServiceSocketSendMutexHandle, RTOS_WAIT_FOREVER);
+    (void)osMutexWait(CellularServiceSocketRcvMutexHandle, RTOS_WAIT_FOREVER);
     (void)osMutexWait(CellularServiceMutexHandle, RTOS_WAIT_FOREVER);
 
     result = CDS_socket_bind(sockHandle,
                              local_port);
 
     (void)osMutexRelease(CellularServiceMutexHandle);
+    (void)osMutexRelease(CellularServiceSocketRcvMutexHandle);
+    (void)osMutexRelease(CellularServiceSocketSendMutexHandle);
   }
 
   return (result);
@@ -188,7 +212,8 @@ CS_Status_t osCDS_socket_bind(socket_handle_t sockHandle,
   * @brief  Connect to a remote server (for socket client mode).
   * @note   This function is blocking until the connection is setup or when the timeout to wait
   *         for socket connection expires.
-  * @note   Call CDS_socket_connect with mutex access protection
+  * @note   Call CDS_socket_connect with socket paths and mutex access protection:
+  *         the socket context does not change during a socket data transfer
   * @param  same parameters as the CDS_socket_connect function
   * @retval CS_Status_t
   */
@@ -201,6 +226,8 @@ CS_Status_t osCDS_socket_connect(socket_handle_t sockHandle,
 
   if (CST_get_state() == CST_MODEM_DATA_READY_STATE)
   {
+    (void)osMutexWait(CellularServiceSocketSendMutexHandle, RTOS_WAIT_FOREVER);
+    (void)osMutexWait(CellularServiceSocketRcvMutexHandle, RTOS_WAIT_FOREVER);
     (void)osMutexWait(CellularServiceMutexHandle, RTOS_WAIT_FOREVER);
 
     result = CDS_socket_connect(sockHandle,
@@ -209,6 +236,8 @@ CS_Status_t osCDS_socket_connect(socket_handle_t sockHandle,
                                 remote_port);
 
     (void)osMutexRelease(CellularServiceMutexHandle);
+    (void)osMutexRelease(CellularServiceSocketRcvMutexHandle);
+    (void)osMutexRelease(CellularServiceSocketSendMutexHandle);
   }
 
   return (result);
@@ -217,7 +246,8 @@ CS_Status_t osCDS_socket_connect(socket_handle_t sockHandle,
 /**
   * @brief  Listen to clients (for socket server mode).
   * @note   Function not implemeted yet
-  * @note   Call CDS_socket_listen with mutex access protection
+  * @note   Call CDS_socket_listen with socket paths and mutex access protection:
+  *         the socket context does not change during a socket data transfer
   * @param  same parameters as the CDS_socket_listen function
   * @retval CS_Status_t
   */
@@ -227,11 +257,15 @@ CS_Status_t osCDS_socket_listen(socket_handle_t sockHandle)
 
   if (CST_get_state() == CST_MODEM_DATA_READY_STATE)
   {
+    (void)osMutexWait(CellularServiceSocketSendMutexHandle, RTOS_WAIT_FOREVER);
+    (void)osMutexWait(CellularServiceSocketRcvMutexHandle, RTOS_WAIT_FOREVER);
     (void)osMutexWait(CellularServiceMutexHandle, RTOS_WAIT_FOREVER);
 
     result = CDS_socket_listen(sockHandle);
 
     (void)osMutexRelease(CellularServiceMutexHandle);
+    (void)osMutexRelease(CellularServiceSocketRcvMutexHandle);
+    (void)osMutexRelease(CellularServiceSocketSendMutexHandle);
   }
 
   return (result);
@@ -241,25 +275,33 @@ CS_Status_t osCDS_socket_listen(socket_handle_t sockHandle)
   * @brief  Send data over a socket to a remote server.
   * @note   This function is blocking until the data is transfered or when the
   *         timeout to wait for transmission expires.
-  * @note   Call CDS_socket_send with mutex access protection
+  * @note   Call CDS_socket_send with socket path access protection only: socket data transfers
+  *         do not wait for the control commands, the AT core serializes and prioritizes them
   * @param  same parameters as the CDS_socket_send function
   * @retval CS_Status_t
   */
 CS_Status_t osCDS_socket_send(socket_handle_t sockHandle,
                               const CS_CHAR_t *p_buf,
-                              uint32_t length)
+                              uint32_t length,
+                              uint32_t *p_sent_length)
 {
   CS_Status_t result = CELLULAR_ERROR;
 
+  if (p_sent_length != NULL)
+  {
+    *p_sent_length = 0U;
+  }
+
   if (CST_get_state() == CST_MODEM_DATA_READY_STATE)
   {
-    (void)osMutexWait(CellularServiceMutexHandle, RTOS_WAIT_FOREVER);
+    (void)osMutexWait(CellularServiceSocketSendMutexHandle, RTOS_WAIT_FOREVER);
 
     result = CDS_socket_send(sockHandle,
                              p_buf,
-                             length);
+                             length,
+                             p_sent_length);
 
-    (void)osMutexRelease(CellularServiceMutexHandle);
+    (void)osMutexRelease(CellularServiceSocketSendMutexHandle);
   }
 
   return (result);
@@ -268,7 +310,8 @@ CS_Status_t osCDS_socket_send(socket_handle_t sockHandle,
 /**
   * @brief  Receive data from the connected remote server.
   * @note   This function is blocking until expected data length is received or a receive timeout has expired.
-  * @note   Call CDS_socket_receive with mutex access protection
+  * @note   Call CDS_socket_receive with socket path access protection only: socket data transfers
+  *         do not wait for the control commands, the AT core serializes and prioritizes them
   * @param  same parameters as the CDS_socket_receive function
   * @retval Size of received data (in bytes).
   */
@@ -281,13 +324,13 @@ int32_t osCDS_socket_receive(socket_handle_t sockHandle,
   result = 0;
   if (CST_get_state() == CST_MODEM_DATA_READY_STATE)
   {
-    (void)osMutexWait(CellularServiceMutexHandle, RTOS_WAIT_FOREVER);
+    (void)osMutexWait(CellularServiceSocketRcvMutexHandle, RTOS_WAIT_FOREVER);
 
     result = CDS_socket_receive(sockHandle,
                                 p_buf,
                                 max_buf_length);
 
-    (void)osMutexRelease(CellularServiceMutexHandle);
+    (void)osMutexRelease(CellularServiceSocketRcvMutexHandle);
   }
 
   return (result);
@@ -297,7 +340,8 @@ int32_t osCDS_socket_receive(socket_handle_t sockHandle,
   * @brief  Send data over a socket to a remote server.
   * @note   This function is blocking until the data is transfered or when the
   *         timeout to wait for transmission expires.
-  * @note   Call CDS_socket_sendto with mutex access protection
+  * @note   Call CDS_socket_sendto with socket path access protection only: socket data transfers
+  *         do not wait for the control commands, the AT core serializes and prioritizes them
   * @param  same parameters as the CDS_socket_sendto function
   * @retval CS_Status_t
   */
@@ -313,7 +357,7 @@ CS_Status_t osCDS_socket_sendto(socket_handle_t sockHandle,
 
   if (CST_get_state() == CST_MODEM_DATA_READY_STATE)
   {
-    (void)osMutexWait(CellularServiceMutexHandle, RTOS_WAIT_FOREVER);
+    (void)osMutexWait(CellularServiceSocketSendMutexHandle, RTOS_WAIT_FOREVER);
 
     result = CDS_socket_sendto(sockHandle,
                                p_buf,
@@ -322,7 +366,7 @@ CS_Status_t osCDS_socket_sendto(socket_handle_t sockHandle,
                                p_ip_addr_value,
                                remote_port);
 
-    (void)osMutexRelease(CellularServiceMutexHandle);
+    (void)osMutexRelease(CellularServiceSocketSendMutexHandle);
   }
 
   return (result);
@@ -331,7 +375,8 @@ CS_Status_t osCDS_socket_sendto(socket_handle_t sockHandle,
 /**
   * @brief  Receive data from the connected remote server.
   * @note   This function is blocking until expected data length is received or a receive timeout has expired.
-  * @note   Call CDS_socket_receivefrom with mutex access protection
+  * @note   Call CDS_socket_receivefrom with socket path access protection only: socket data transfers
+  *         do not wait for the control commands, the AT core serializes and prioritizes them
   * @param  same parameters as the CDS_socket_receivefrom function
   * @retval Size of received data (in bytes).
   */
@@ -347,7 +392,7 @@ int32_t osCDS_socket_receivefrom(socket_handle_t sockHandle,
   result = 0;
   if (CST_get_state() == CST_MODEM_DATA_READY_STATE)
   {
-    (void)osMutexWait(CellularServiceMutexHandle, RTOS_WAIT_FOREVER);
+    (void)osMutexWait(CellularServiceSocketRcvMutexHandle, RTOS_WAIT_FOREVER);
 
     result = CDS_socket_receivefrom(sockHandle,
                                     p_buf,
@@ -356,7 +401,7 @@ int32_t osCDS_socket_receivefrom(socket_handle_t sockHandle,
                                     p_ip_addr_value,
                                     p_remote_port);
 
-    (void)osMutexRelease(CellularServiceMutexHandle);
+    (void)osMutexRelease(CellularServiceSocketRcvMutexHandle);
   }
 
   return (result);
@@ -365,7 +410,8 @@ int32_t osCDS_socket_receivefrom(socket_handle_t sockHandle,
 /**
   * @brief  Free a socket handle.
   * @note   If a PDN is activated at socket creation, the socket will not be deactivated at socket closure.
-  * @note   Call CDS_socket_close with mutex access protection
+  * @note   Call CDS_socket_close with socket paths and mutex access protection:
+  *         the socket context does not change during a socket data transfer
   * @param  same parameters as the CDS_socket_close function
   * @retval CS_Status_t
   */
@@ -374,12 +420,16 @@ CS_Status_t osCDS_socket_close(socket_handle_t sockHandle,
 {
   CS_Status_t result;
 
+  (void)osMutexWait(CellularServiceSocketSendMutexHandle, RTOS_WAIT_FOREVER);
+  (void)osMutexWait(CellularServiceSocketRcvMutexHandle, RTOS_WAIT_FOREVER);
   (void)osMutexWait(CellularServiceMutexHandle, RTOS_WAIT_FOREVER);
 
   result = CDS_socket_close(sockHandle,
                             force);
 
   (void)osMutexRelease(CellularServiceMutexHandle);
+  (void)osMutexRelease(CellularServiceSocketRcvMutexHandle);
+  (void)osMutexRelease(CellularServiceSocketSendMutexHandle);
 
   return (result);
 }
@@ -435,6 +485,22 @@ CS_Bool_t osCDS_cellular_service_init(void)
       /* Platform is reset */
       ERROR_Handler(DBG_CHAN_CELLULAR_SERVICE, 2, ERROR_FATAL);
     }
+    osMutexDef(osCellularServiceSocketSendMutex);
+    CellularServiceSocketSendMutexHandle = osMutexCreate(osMutex(osCellularServiceSocketSendMutex));
+    if (CellularServiceSocketSendMutexHandle == NULL)
+    {
+      result = CELLULAR_FALSE;
+      /* Platform is reset */
+      ERROR_Handler(DBG_CHAN_CELLULAR_SERVICE, 3, ERROR_FATAL);
+    }
+    osMutexDef(osCellularServiceSocketRcvMutex);
+    CellularServiceSocketRcvMutexHandle = osMutexCreate(osMutex(osCellularServiceSocketRcvMutex));
+    if (CellularServiceSocketRcvMutexHandle == NULL)
+    {
+      result = CELLULAR_FALSE;
+      /* Platform is reset */
+      ERROR_Handler(DBG_CHAN_CELLULAR_SERVICE, 4, ERROR_FATAL);
+    }
 
     /* To do next line of code not done under if result == CELLULAR_TRUE
        because if result == CELLULAR_FALSE platform is reset (avoid quality error)
@@ -37,6 +37,9 @@ extern "C" {
 * - IPC_RXBUF_THRESHOLD: if free space in RX queue is < to this value, the interface (UART,..) will be paused
 *   until enough free space (ie previous msg have been read)
 * - IPC_USE_UART: set to 1 is IPC uses UART (ONLY UART IS SUPPORTED ACTUALLY)
+* - IPC_USE_RX_DMA: set to 1 to receive UART chars with a circular DMA and idle line detection
+*   instead of one interrupt per char (character mode only, UART handle must be linked to a DMA channel)
+* - IPC_RXDMA_BUFFER_SIZE: size of the circular DMA buffer (if IPC_USE_RX_DMA is set)
 * - IPC_USE_SPI: 0
 * - IPC_USE_I2C: 0
 * - DBG_IPC_RX_FIFO: set to 1 for additional debug informations
@@ -44,6 +47,16 @@ extern "C" {
 
 /* Exported constants --------------------------------------------------------*/
 
+#if !defined(IPC_USE_RX_DMA)
+#define IPC_USE_RX_DMA (0U)
+#endif /* IPC_USE_RX_DMA */
+
+#if (IPC_USE_RX_DMA == 1U)
+#if (IPC_USE_STREAM_MODE == 1U)
+#error "IPC_USE_RX_DMA is only supported in character mode"
+#endif /* IPC_USE_STREAM_MODE */
+#endif /* IPC_USE_RX_DMA */
+
 #if (USER_DEFINED_IPC_MAX_DEVICES != 0)
 #define IPC_MAX_DEVICES  ((uint8_t) USER_DEFINED_IPC_MAX_DEVICES)
 #else
@@ -65,6 +78,7 @@ extern "C" {
 #define  IPC_RXMSG_HEADER_SIZE            ((uint16_t) 2U)
 #define  IPC_RXMSG_HEADER_COMPLETE_MASK   ((uint8_t) 0x80U)
 #define  IPC_RXMSG_HEADER_SIZE_MASK       ((uint8_t) 0x7FU)
+#define  IPC_RXMSG_MAX_SEGMENTS           ((uint8_t) 2U)
 #define  IPC_DEVICE_NOT_FOUND             ((uint8_t) 0xFFU)
 
 /* Exported types ------------------------------------------------------------*/
@@ -150,8 +164,24 @@ typedef struct
 {
   uint8_t     buffer[IPC_RXBUF_MAXSIZE];
   uint16_t    size;
+  uint16_t    sink_size;  /* leading bytes delivered to the RX sink buffer, buffer[0..sink_size-1] is not filled */
+  uint8_t     nb_copies;  /* memcpy done to read the sink bytes (or the whole message if no sink): 2 if it wraps */
 } IPC_RxMessage_t;
 
+/* contiguous part of a message in the RX FIFO (a message wrapping at the end of the FIFO has 2 segments) */
+typedef struct
+{
+  const uint8_t *p_data;
+  uint16_t       size;
+} IPC_RxSegment_t;
+
+/* one-shot destination for the leading bytes of the next message read, when its content is known in advance */
+typedef struct
+{
+  uint8_t     *p_buffer;
+  uint16_t     size;
+} IPC_RxSink_t;
+
 typedef struct
 {
   uint8_t      data[IPC_RXBUF_MAXSIZE];
@@ -179,6 +209,10 @@ typedef void (*IPC_RxCallbackTypeDef)(struct IPC_Handle_Typedef_struct *hipc);
 typedef void (*IPC_TxCallbackTypeDef)(struct IPC_Handle_Typedef_struct *hipc);
 typedef void (*IPC_RXFIFO_writeTypeDef)(struct IPC_Handle_Typedef_struct *hipc, uint8_t rxChar);
 typedef uint8_t (*IPC_CheckEndOfMsgCallbackTypeDef)(uint8_t rxChar);
+/* analyze a block of chars, stopping after the first end of message:
+*  returns the number of chars analyzed, *p_end_of_msg set to 1 if the last one is an end of message
+*/
+typedef uint16_t (*IPC_ScanEndOfMsgCallbackTypeDef)(const uint8_t *p_data, uint16_t size, uint8_t *p_end_of_msg);
 
 typedef struct IPC_Handle_Typedef_struct
 {
@@ -194,7 +228,9 @@ typedef struct IPC_Handle_Typedef_struct
   IPC_RxCallbackTypeDef             RxClientCallback;
   IPC_TxCallbackTypeDef             TxClientCallback;
   IPC_CheckEndOfMsgCallbackTypeDef  CheckEndOfMsgCallback;
+  IPC_ScanEndOfMsgCallbackTypeDef   ScanEndOfMsgCallback; /* optional, used for blocks of chars */
   IPC_RXFIFO_writeTypeDef           RxFifoWrite;
+  IPC_RxSink_t                      RxSink;               /* optional, set with IPC_setRxSink() */
 
 #if (DBG_IPC_RX_FIFO == 1U)
   dbg_rx_queue_info_t         dbgRxQueue;
@@ -206,6 +242,10 @@ typedef struct
   IPC_State_t              state;
   IPC_PhysicalInterface_t  phy_int;
   IPC_CHAR_t               RxChar[1];    /* RX DMA buffer (1 char) - common buffer for one physical interface  */
+#if (IPC_USE_RX_DMA == 1U)
+  IPC_CHAR_t               RxDmaBuffer[IPC_RXDMA_BUFFER_SIZE]; /* RX circular DMA buffer */
+  uint16_t                 RxDmaReadPos;                       /* next char to write in RX FIFO */
+#endif /* IPC_USE_RX_DMA */
   IPC_Handle_t             *h_current_channel;   /* current active IPC channel */
   IPC_Handle_t             *h_inactive_channel;  /* other IPC channel (exists if not NULL), currently not active */
 } IPC_ClientDescription_t;
@@ -225,12 +265,14 @@ IPC_Status_t IPC_open(IPC_Handle_t     *hipc,
                       IPC_TxCallbackTypeDef pTxClientCallback,
                       IPC_CheckEndOfMsgCallbackTypeDef pCheckEndOfMsg);
 IPC_Status_t IPC_close(IPC_Handle_t *hipc);
+IPC_Status_t IPC_setScanEndOfMsgCallback(IPC_Handle_t *hipc, IPC_ScanEndOfMsgCallbackTypeDef pScanEndOfMsg);
 IPC_Status_t IPC_select(IPC_Handle_t *hipc);
 IPC_Status_t IPC_reset(IPC_Handle_t *hipc);
 IPC_Status_t IPC_abort(IPC_Handle_t *hipc);
 IPC_Handle_t *IPC_get_other_channel(IPC_Handle_t *hipc);
 IPC_Status_t IPC_send(IPC_Handle_t *hipc, uint8_t *p_TxBuffer, uint16_t bufsize);
 IPC_Status_t IPC_receive(IPC_Handle_t *hipc, IPC_RxMessage_t *p_msg);
+IPC_Status_t IPC_setRxSink(IPC_Handle_t *hipc, uint8_t *p_buffer, uint16_t size);
 IPC_Status_t IPC_streamReceive(IPC_Handle_t *hipc, uint8_t *p_buffer, int16_t *p_len);
 void IPC_DumpRXQueue(IPC_Handle_t *hipc, uint8_t readable);
 
@@ -39,7 +39,9 @@ extern "C" {
 /* Exported functions ------------------------------------------------------- */
 void IPC_RXFIFO_init(IPC_Handle_t *hipc);
 void IPC_RXFIFO_writeCharacter(IPC_Handle_t *hipc, uint8_t rxChar);
+uint16_t IPC_RXFIFO_writeBlock(IPC_Handle_t *hipc, const uint8_t *p_data, uint16_t size);
 int16_t IPC_RXFIFO_read(IPC_Handle_t *hipc, IPC_RxMessage_t *pMsg);
+uint8_t IPC_RXFIFO_getMsgSegments(const IPC_Handle_t *hipc, IPC_RxSegment_t *p_segment);
 #if (IPC_USE_STREAM_MODE == 1U)
 void IPC_RXFIFO_stream_init(IPC_Handle_t *hipc);
 void IPC_RXFIFO_writeStream(IPC_Handle_t *hipc, uint8_t rxChar);
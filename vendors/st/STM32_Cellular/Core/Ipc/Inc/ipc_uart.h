@@ -59,6 +59,10 @@ void IPC_UART_DumpRXQueue(const IPC_Handle_t *hipc, uint8_t readable);
 void IPC_UART_RxCpltCallback(UART_HandleTypeDef *UartHandle);
 void IPC_UART_TxCpltCallback(UART_HandleTypeDef *UartHandle);
 void IPC_UART_ErrorCallback(UART_HandleTypeDef *UartHandle);
+#if (IPC_USE_RX_DMA == 1U)
+void IPC_UART_RxHalfCpltCallback(UART_HandleTypeDef *UartHandle);
+void IPC_UART_RxIdleCallback(UART_HandleTypeDef *UartHandle);
+#endif /* IPC_USE_RX_DMA */
 
 #ifdef __cplusplus
 }
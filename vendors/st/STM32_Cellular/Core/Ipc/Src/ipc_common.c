@@ -180,6 +180,32 @@ IPC_Status_t IPC_close(IPC_Handle_t *hipc)
   return (status);
 }
 
+/**
+  * @brief  Register the function analyzing blocks of received chars.
+  * @note   Optional: without it, blocks are analyzed char by char with the end of message callback.
+  *         The block function must give the same result as the end of message callback called for each char.
+  * @param  hipc IPC handle.
+  * @param  pScanEndOfMsg Callback ptr to the function used to find the end of message in a block of chars
+  *         (NULL to analyze char by char).
+  * @retval status
+  */
+IPC_Status_t IPC_setScanEndOfMsgCallback(IPC_Handle_t *hipc, IPC_ScanEndOfMsgCallbackTypeDef pScanEndOfMsg)
+{
+  IPC_Status_t status;
+
+  if (hipc != NULL)
+  {
+    hipc->ScanEndOfMsgCallback = pScanEndOfMsg;
+    status = IPC_OK;
+  }
+  else
+  {
+    status = IPC_ERROR;
+  }
+
+  return (status);
+}
+
 /**
   * @brief  Reset a specific channel.
   * @param  hipc IPC handle to reset.
@@ -298,6 +324,35 @@ IPC_Status_t IPC_receive(IPC_Handle_t *hipc, IPC_RxMessage_t *p_msg)
   return (status);
 }
 
+/**
+  * @brief  Deliver the leading bytes of the next message read directly to a client buffer.
+  * @note   Used when the content of the next message is known in advance (socket data payload):
+  *         its first size bytes are copied from the RX FIFO to p_buffer instead of the message buffer,
+  *         the remaining bytes (if any) are read as usual.
+  *         The sink is used once, it is ignored if the next message is shorter than size.
+  * @param  hipc IPC handle.
+  * @param  p_buffer Destination of the leading bytes of the next message (NULL to cancel).
+  * @param  size Number of bytes to deliver to p_buffer.
+  * @retval status
+  */
+IPC_Status_t IPC_setRxSink(IPC_Handle_t *hipc, uint8_t *p_buffer, uint16_t size)
+{
+  IPC_Status_t status;
+
+  if (hipc != NULL)
+  {
+    hipc->RxSink.p_buffer = (size != 0U) ? p_buffer : NULL;
+    hipc->RxSink.size = (p_buffer != NULL) ? size : 0U;
+    status = IPC_OK;
+  }
+  else
+  {
+    status = IPC_ERROR;
+  }
+
+  return (status);
+}
+
 /**
   * @brief  Receive a data buffer from a channel.
   * @param  hipc IPC handle.
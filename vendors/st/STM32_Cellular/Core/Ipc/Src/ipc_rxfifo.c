@@ -67,6 +67,10 @@ static void RXFIFO_incrementTail(IPC_Handle_t *hipc, uint16_t inc_size);
 static void RXFIFO_incrementHead(IPC_Handle_t *hipc);
 static void RXFIFO_updateMsgHeader(IPC_Handle_t *hipc);
 static void RXFIFO_prepareNextMsgHeader(IPC_Handle_t *hipc);
+static void RXFIFO_completeMsg(IPC_Handle_t *hipc);
+static void RXFIFO_writeRun(IPC_Handle_t *hipc, const uint8_t *p_data, uint16_t size);
+static uint8_t RXFIFO_copySegments(const IPC_RxSegment_t *p_segment, uint8_t nb_segments,
+                                   uint16_t offset, uint8_t *p_dest, uint16_t size);
 static void RXFIFO_rearm_RX_IT(IPC_Handle_t *hipc);
 
 /* Functions Definition ------------------------------------------------------*/
@@ -83,6 +87,8 @@ void IPC_RXFIFO_init(IPC_Handle_t *hipc)
   hipc->RxQueue.current_msg_index = 0U;
   hipc->RxQueue.current_msg_size = 0U;
   hipc->RxQueue.nb_unread_msg = 0U;
+  hipc->RxSink.p_buffer = NULL;
+  hipc->RxSink.size = 0U;
 
 #if (DBG_IPC_RX_FIFO == 1U)
   /* init debug infos */
@@ -125,24 +131,83 @@ void IPC_RXFIFO_writeCharacter(IPC_Handle_t *hipc, uint8_t rxChar)
     /* check if the char received is an end of message */
     if ((*hipc->CheckEndOfMsgCallback)(rxChar) == 1U)
     {
-      hipc->RxQueue.nb_unread_msg++;
-
-      /* update header for message received */
-      RXFIFO_updateMsgHeader(hipc);
+      RXFIFO_completeMsg(hipc);
+    }
+  }
+}
 
-      /* save start position of next message */
-      hipc->RxQueue.current_msg_index = hipc->RxQueue.index_write;
+/**
+  * @brief  Write a block of chars in the IPC RX FIFO.
+  * @note   Produces the same RX FIFO content as IPC_RXFIFO_writeCharacter() called
+  *         for each char, but copies the chars between two ends of message at once.
+  *         Writing stops after the char which paused the IPC (RX FIFO almost full),
+  *         the remaining chars have to be written once the IPC is resumed.
+  *         Ends of message are searched with the scan callback if registered, char by char otherwise.
+  * @param  hipc IPC handle.
+  * @param  p_data chars to write.
+  * @param  size number of chars to write.
+  * @retval number of chars written.
+  */
+uint16_t IPC_RXFIFO_writeBlock(IPC_Handle_t *hipc, const uint8_t *p_data, uint16_t size)
+{
+  uint16_t run_start = 0U;
+  uint16_t idx = 0U;
+  uint16_t end;
+  uint16_t free_bytes;
+  uint8_t end_of_msg;
 
-      /* reset current msg size */
-      hipc->RxQueue.current_msg_size = 0U;
+  if (hipc != NULL)
+  {
+    while ((idx < size) && (hipc->State != IPC_STATE_PAUSED))
+    {
+      /* the IPC is paused by the char which leaves IPC_RXBUF_THRESHOLD free bytes:
+      *  do not analyze chars beyond it
+      */
+      free_bytes = IPC_RXFIFO_getFreeBytes(hipc);
+      end = size;
+      if (free_bytes > IPC_RXBUF_THRESHOLD)
+      {
+        if ((free_bytes - IPC_RXBUF_THRESHOLD) < (end - run_start))
+        {
+          end = run_start + (free_bytes - IPC_RXBUF_THRESHOLD);
+        }
+      }
+      else
+      {
+        /* already at threshold: next char pauses the IPC */
+        end = run_start + 1U;
+      }
 
-      /* reserve place for next msg header */
-      RXFIFO_prepareNextMsgHeader(hipc);
+      /* look for an end of message */
+      end_of_msg = 0U;
+      if (hipc->ScanEndOfMsgCallback != NULL)
+      {
+        idx += (*hipc->ScanEndOfMsgCallback)(&p_data[idx], end - idx, &end_of_msg);
+      }
+      else
+      {
+        while ((idx < end) && (end_of_msg == 0U))
+        {
+          end_of_msg = (*hipc->CheckEndOfMsgCallback)(p_data[idx]);
+          idx++;
+        }
+      }
 
-      /* msg received: call client callback */
-      (* hipc->RxClientCallback)((IPC_Handle_t *)hipc);
+      if (end_of_msg == 1U)
+      {
+        /* end of message found: copy message tail and close it */
+        RXFIFO_writeRun(hipc, &p_data[run_start], idx - run_start);
+        RXFIFO_completeMsg(hipc);
+      }
+      else
+      {
+        RXFIFO_writeRun(hipc, &p_data[run_start], idx - run_start);
+      }
+      run_start = idx;
     }
   }
+
+  return (idx);
 }
 
 /**
@@ -154,8 +219,10 @@ void IPC_RXFIFO_writeCharacter(IPC_Handle_t *hipc, uint8_t rxChar)
 int16_t IPC_RXFIFO_read(IPC_Handle_t *hipc, IPC_RxMessage_t *pMsg)
 {
   int16_t retval;
-  uint16_t oversize;
+  uint8_t nb_segments;
+  uint16_t sink_size;
   IPC_RxHeader_t header;
+  IPC_RxSegment_t segment[IPC_RXMSG_MAX_SEGMENTS];
 
   if (hipc != NULL)
   {
@@ -173,6 +240,9 @@ int16_t IPC_RXFIFO_read(IPC_Handle_t *hipc, IPC_RxMessage_t *pMsg)
     }
     else
     {
+      /* locate msg content in the circular buffer */
+      nb_segments = IPC_RXFIFO_getMsgSegments(hipc, segment);
+
       /* jump header */
       RXFIFO_incrementTail(hipc, IPC_RXMSG_HEADER_SIZE);
 
@@ -185,31 +255,35 @@ int16_t IPC_RXFIFO_read(IPC_Handle_t *hipc, IPC_RxMessage_t *pMsg)
       /* update size in output structure */
       pMsg->size = header.size;
 
-      /* copy msg content to output structure */
-      if ((hipc->RxQueue.index_read + header.size) > IPC_RXBUF_MAXSIZE)
+      /* leading bytes expected by a client buffer: deliver them directly (the sink is used only once) */
+      sink_size = 0U;
+      if ((hipc->RxSink.p_buffer != NULL) && (header.size >= hipc->RxSink.size))
       {
-        /* message is split in 2 parts in the circular buffer */
-        oversize = (hipc->RxQueue.index_read + header.size - IPC_RXBUF_MAXSIZE);
-        uint16_t remaining_size = header.size - oversize;
-        (void) memcpy((void *) & (pMsg->buffer[0]),
-                      (void *) & (hipc->RxQueue.data[hipc->RxQueue.index_read]),
-                      (size_t) remaining_size);
-        (void) memcpy((void *) & (pMsg->buffer[header.size - oversize]),
-                      (void *) & (hipc->RxQueue.data[0]),
-                      (size_t) oversize);
+        sink_size = hipc->RxSink.size;
+        pMsg->nb_copies = RXFIFO_copySegments(segment, nb_segments, 0U, hipc->RxSink.p_buffer, sink_size);
+      }
+      hipc->RxSink.p_buffer = NULL;
+      hipc->RxSink.size = 0U;
+      pMsg->sink_size = sink_size;
 
-#if (DBG_IPC_RX_FIFO == 1U)
-        PRINT_DBG("override end of buffer")
-#endif /* DBG_IPC_RX_FIFO */
+      /* copy msg content (or what remains after the sink bytes) to output structure */
+      if (sink_size == 0U)
+      {
+        pMsg->nb_copies = RXFIFO_copySegments(segment, nb_segments, 0U, pMsg->buffer, header.size);
       }
       else
       {
-        /* message is contiguous in the circular buffer */
-        (void) memcpy((void *)pMsg->buffer,
-                      (void *) & (hipc->RxQueue.data[hipc->RxQueue.index_read]),
-                      (size_t) header.size);
+        (void) RXFIFO_copySegments(segment, nb_segments, sink_size, &pMsg->buffer[sink_size],
+                                   header.size - sink_size);
       }
 
+#if (DBG_IPC_RX_FIFO == 1U)
+      if (nb_segments > 1U)
+      {
+        PRINT_DBG("override end of buffer")
+      }
+#endif /* DBG_IPC_RX_FIFO */
+
       /* increment tail index to the next message */
       RXFIFO_incrementTail(hipc, header.size);
 
@@ -235,6 +309,49 @@ int16_t IPC_RXFIFO_read(IPC_Handle_t *hipc, IPC_RxMessage_t *pMsg)
   return (retval);
 }
 
+/**
+  * @brief  Locate the content of the first unread message in the IPC RX FIFO.
+  * @note   The message is not consumed: the segments point to the RX FIFO and are valid until it is read.
+  * @param  hipc IPC handle.
+  * @param  p_segment array of IPC_RXMSG_MAX_SEGMENTS segments, set to the message content.
+  * @retval number of segments (1 if the message is contiguous, 2 if it wraps at the end of the FIFO,
+  *         0 if there is no complete message).
+  */
+uint8_t IPC_RXFIFO_getMsgSegments(const IPC_Handle_t *hipc, IPC_RxSegment_t *p_segment)
+{
+  uint8_t nb_segments;
+  uint16_t pos;
+  uint16_t size;
+  IPC_RxHeader_t header;
+
+  IPC_RXFIFO_readMsgHeader_at_pos(hipc, &header, hipc->RxQueue.index_read);
+  pos = (hipc->RxQueue.index_read + IPC_RXMSG_HEADER_SIZE) % IPC_RXBUF_MAXSIZE;
+  size = header.size;
+
+  p_segment[0].p_data = &hipc->RxQueue.data[pos];
+  if (header.complete != 1U)
+  {
+    p_segment[0].size = 0U;
+    nb_segments = 0U;
+  }
+  else if ((pos + size) > IPC_RXBUF_MAXSIZE)
+  {
+    /* message is split in 2 parts in the circular buffer */
+    p_segment[0].size = IPC_RXBUF_MAXSIZE - pos;
+    p_segment[1].p_data = &hipc->RxQueue.data[0];
+    p_segment[1].size = size - p_segment[0].size;
+    nb_segments = 2U;
+  }
+  else
+  {
+    /* message is contiguous in the circular buffer */
+    p_segment[0].size = size;
+    nb_segments = 1U;
+  }
+
+  return (nb_segments);
+}
+
 #if (IPC_USE_STREAM_MODE == 1U)
 /**
   * @brief Initialize IPC RX FIFO for the stream mode.
@@ -513,6 +630,112 @@ static void RXFIFO_prepareNextMsgHeader(IPC_Handle_t *hipc)
   }
 }
 
+/**
+  * @brief  Close current message and signal it to the client.
+  * @param  hipc IPC handle.
+  * @retval none.
+  */
+static void RXFIFO_completeMsg(IPC_Handle_t *hipc)
+{
+  hipc->RxQueue.nb_unread_msg++;
+
+  /* update header for message received */
+  RXFIFO_updateMsgHeader(hipc);
+
+  /* save start position of next message */
+  hipc->RxQueue.current_msg_index = hipc->RxQueue.index_write;
+
+  /* reset current msg size */
+  hipc->RxQueue.current_msg_size = 0U;
+
+  /* reserve place for next msg header */
+  RXFIFO_prepareNextMsgHeader(hipc);
+
+  /* msg received: call client callback */
+  (* hipc->RxClientCallback)((IPC_Handle_t *)hipc);
+}
+
+/**
+  * @brief  Append chars to current message.
+  * @note   Caller ensures that only the last char may reach IPC_RXBUF_THRESHOLD.
+  * @param  hipc IPC handle.
+  * @param  p_data chars to append.
+  * @param  size number of chars to append.
+  * @retval none.
+  */
+static void RXFIFO_writeRun(IPC_Handle_t *hipc, const uint8_t *p_data, uint16_t size)
+{
+  uint16_t first_part;
+
+  if (size != 0U)
+  {
+    /* copy chars, in 2 parts if the circular buffer loops back to index 0 */
+    first_part = IPC_RXBUF_MAXSIZE - hipc->RxQueue.index_write;
+    if (first_part > size)
+    {
+      first_part = size;
+    }
+    (void) memcpy((void *) &hipc->RxQueue.data[hipc->RxQueue.index_write],
+                  (const void *) p_data,
+                  (size_t) first_part);
+    (void) memcpy((void *) &hipc->RxQueue.data[0],
+                  (const void *) &p_data[first_part],
+                  (size_t)(size - first_part));
+
+    hipc->RxQueue.current_msg_size += size;
+
+#if (DBG_IPC_RX_FIFO == 1U)
+    hipc->dbgRxQueue.msg_info_queue[hipc->dbgRxQueue.queue_pos].size = hipc->RxQueue.current_msg_size;
+#endif /* DBG_IPC_RX_FIFO */
+
+    /* move head to last char, then increment it as for a single char (threshold check) */
+    hipc->RxQueue.index_write = (hipc->RxQueue.index_write + size - 1U) % IPC_RXBUF_MAXSIZE;
+    RXFIFO_incrementHead(hipc);
+  }
+}
+
+/**
+  * @brief  Copy a part of a message located in the RX FIFO.
+  * @param  p_segment message segments (from IPC_RXFIFO_getMsgSegments).
+  * @param  nb_segments number of segments.
+  * @param  offset position of the first byte to copy in the message.
+  * @param  p_dest destination buffer.
+  * @param  size number of bytes to copy.
+  * @retval number of memcpy done.
+  */
+static uint8_t RXFIFO_copySegments(const IPC_RxSegment_t *p_segment, uint8_t nb_segments,
+                                   uint16_t offset, uint8_t *p_dest, uint16_t size)
+{
+  uint8_t nb_copies = 0U;
+  uint16_t skip = offset;
+  uint16_t copied = 0U;
+
+  for (uint8_t i = 0U; (i < nb_segments) && (copied < size); i++)
+  {
+    if (skip >= p_segment[i].size)
+    {
+      /* copy starts in next segment */
+      skip -= p_segment[i].size;
+    }
+    else
+    {
+      uint16_t part = p_segment[i].size - skip;
+      if (part > (size - copied))
+      {
+        part = size - copied;
+      }
+      (void) memcpy((void *) &p_dest[copied],
+                    (const void *) &p_segment[i].p_data[skip],
+                    (size_t) part);
+      copied += part;
+      skip = 0U;
+      nb_copies++;
+    }
+  }
+
+  return (nb_copies);
+}
+
 static void RXFIFO_rearm_RX_IT(IPC_Handle_t *hipc)
 {
 #if (IPC_USE_UART == 1U)
@@ -59,6 +59,13 @@
 /* Private function prototypes -----------------------------------------------*/
 static uint8_t find_Device_Id(const UART_HandleTypeDef *huart);
 static IPC_Status_t change_ipc_channel(IPC_Handle_t *hipc);
+#if (IPC_USE_RX_DMA == 1U)
+static IPC_Status_t rx_dma_start(uint8_t device_id);
+static void rx_dma_process(uint8_t device_id);
+static void rx_dma_pause(UART_HandleTypeDef *huart);
+static void rx_dma_resume(UART_HandleTypeDef *huart);
+static IRQn_Type find_uart_irq(const UART_HandleTypeDef *huart);
+#endif /* IPC_USE_RX_DMA */
 
 /* Functions Definition ------------------------------------------------------*/
 /**
@@ -191,6 +198,7 @@ IPC_Status_t IPC_UART_open(IPC_Handle_t *hipc,
     hipc->RxClientCallback = pRxClientCallback;
     hipc->TxClientCallback = pTxClientCallback;
     hipc->CheckEndOfMsgCallback = pCheckEndOfMsg;
+    hipc->ScanEndOfMsgCallback = NULL;
     hipc->Mode = mode;
     hipc->UartBusyFlag = 0U;
 
@@ -200,8 +208,20 @@ IPC_Status_t IPC_UART_open(IPC_Handle_t *hipc,
     IPC_RXFIFO_stream_init(hipc);
 #endif /* IPC_USE_STREAM_MODE */
 
+#if (IPC_USE_RX_DMA == 1U)
+    /* start RX DMA (common to both channels of the device) */
+    if (hipc->Interface.h_uart->RxState == HAL_UART_STATE_READY)
+    {
+      uart_status = (rx_dma_start(device) == IPC_OK) ? HAL_OK : HAL_ERROR;
+    }
+    else
+    {
+      uart_status = HAL_OK;
+    }
+#else
     /* start RX IT */
     uart_status = HAL_UART_Receive_IT(hipc->Interface.h_uart, (uint8_t *)IPC_DevicesList[device].RxChar, 1U);
+#endif /* IPC_USE_RX_DMA */
     if (uart_status != HAL_OK)
     {
       PRINT_ERR("HAL_UART_Receive_IT error")
@@ -232,6 +252,7 @@ IPC_Status_t IPC_UART_close(IPC_Handle_t *hipc)
     hipc->State = IPC_STATE_NOT_INITIALIZED;
     hipc->RxClientCallback = NULL;
     hipc->CheckEndOfMsgCallback = NULL;
+    hipc->ScanEndOfMsgCallback = NULL;
 
     /* init RXFIFO */
     IPC_RXFIFO_init(hipc);
@@ -268,6 +289,9 @@ IPC_Status_t IPC_UART_close(IPC_Handle_t *hipc)
         if (hipc->Interface.h_uart != NULL)
         {
           (void)HAL_UART_AbortTransmit_IT(hipc->Interface.h_uart);
+#if (IPC_USE_RX_DMA == 1U)
+          (void)HAL_UART_AbortReceive(hipc->Interface.h_uart);
+#endif /* IPC_USE_RX_DMA */
         }
       }
 
@@ -313,8 +337,14 @@ IPC_Status_t IPC_UART_reset(IPC_Handle_t *hipc)
     IPC_RXFIFO_stream_init(hipc);
 #endif /* IPC_USE_STREAM_MODE */
 
+#if (IPC_USE_RX_DMA == 1U)
+    /* restart RX DMA from the beginning of its buffer */
+    (void) HAL_UART_AbortReceive(hipc->Interface.h_uart);
+    (void) rx_dma_start(device_id);
+#else
     /* rearm IT */
     (void) HAL_UART_Receive_IT(hipc->Interface.h_uart, (uint8_t *)IPC_DevicesList[device_id].RxChar, 1U);
+#endif /* IPC_USE_RX_DMA */
     hipc->State = IPC_STATE_ACTIVE;
     retval = IPC_OK;
   }
@@ -482,7 +512,13 @@ IPC_Status_t IPC_UART_receive(IPC_Handle_t *hipc, IPC_RxMessage_t *p_msg)
 #endif /* DBG_IPC_RX_FIFO */
 
           hipc->State = IPC_STATE_ACTIVE;
+#if (IPC_USE_RX_DMA == 1U)
+          /* chars may be waiting in the DMA buffer: process them from the UART interrupt */
+          rx_dma_resume(hipc->Interface.h_uart);
+          HAL_NVIC_SetPendingIRQ(find_uart_irq(hipc->Interface.h_uart));
+#else
           (void) HAL_UART_Receive_IT(hipc->Interface.h_uart, (uint8_t *)IPC_DevicesList[hipc->Device_ID].RxChar, 1U);
+#endif /* IPC_USE_RX_DMA */
         }
 
         if (unread_msg == 0)
@@ -660,14 +696,60 @@ void IPC_UART_RxCpltCallback(UART_HandleTypeDef *UartHandle)
   uint8_t device_id = find_Device_Id(UartHandle);
   if (device_id < IPC_MAX_DEVICES)
   {
+#if (IPC_USE_RX_DMA == 1U)
+    /* end of the circular DMA buffer reached */
+    rx_dma_process(device_id);
+#else
     if (IPC_DevicesList[device_id].h_current_channel != NULL)
     {
       IPC_DevicesList[device_id].h_current_channel->RxFifoWrite(IPC_DevicesList[device_id].h_current_channel,
                                                                 IPC_DevicesList[device_id].RxChar[0]);
     }
+#endif /* IPC_USE_RX_DMA */
+  }
+}
+
+#if (IPC_USE_RX_DMA == 1U)
+/**
+  * @brief  IPC uart RX half complete callback (called under IT !).
+  * @param  UartHandle Ptr to the HAL UART handle.
+  * @retval none
+  */
+void IPC_UART_RxHalfCpltCallback(UART_HandleTypeDef *UartHandle)
+{
+  /* Warning ! this function is called under IT */
+  uint8_t device_id = find_Device_Id(UartHandle);
+  if (device_id < IPC_MAX_DEVICES)
+  {
+    /* first half of the circular DMA buffer filled */
+    rx_dma_process(device_id);
   }
 }
 
+/**
+  * @brief  IPC uart idle line callback (called under IT !).
+  * @note   To be called from the UART IRQ handler, before HAL_UART_IRQHandler().
+  *         Also processes the DMA buffer when the IRQ has been set pending by software.
+  * @param  UartHandle Ptr to the HAL UART handle.
+  * @retval none
+  */
+void IPC_UART_RxIdleCallback(UART_HandleTypeDef *UartHandle)
+{
+  /* Warning ! this function is called under IT */
+  uint8_t device_id = find_Device_Id(UartHandle);
+  if (device_id < IPC_MAX_DEVICES)
+  {
+    if (__HAL_UART_GET_FLAG(UartHandle, UART_FLAG_IDLE) != RESET)
+    {
+      __HAL_UART_CLEAR_FLAG(UartHandle, UART_CLEAR_IDLEF);
+    }
+
+    /* the modem stopped sending: deliver what has been received */
+    rx_dma_process(device_id);
+  }
+}
+#endif /* IPC_USE_RX_DMA */
+
 /**
   * @brief  IPC uart TX callback (called under IT !).
   * @param  UartHandle Ptr to the HAL UART handle.
@@ -697,8 +779,21 @@ void IPC_UART_TxCpltCallback(UART_HandleTypeDef *UartHandle)
   */
 void IPC_UART_ErrorCallback(UART_HandleTypeDef *UartHandle)
 {
-  UNUSED(UartHandle);
   /* Warning ! this function is called under IT */
+#if (IPC_USE_RX_DMA == 1U)
+  /* any error aborts a DMA reception: deliver chars received before the error and restart */
+  uint8_t device_id = find_Device_Id(UartHandle);
+  if (device_id < IPC_MAX_DEVICES)
+  {
+    if (UartHandle->RxState == HAL_UART_STATE_READY)
+    {
+      rx_dma_process(device_id);
+      (void) rx_dma_start(device_id);
+    }
+  }
+#else
+  UNUSED(UartHandle);
+#endif /* IPC_USE_RX_DMA */
 }
 
 /* Private function Definition -----------------------------------------------*/
@@ -751,5 +846,151 @@ static IPC_Status_t change_ipc_channel(IPC_Handle_t *hipc)
   return (IPC_OK);
 }
 
+#if (IPC_USE_RX_DMA == 1U)
+/**
+  * brief  Start circular DMA reception with idle line detection.
+  * param  device_id IPC device identifier.
+  * retval status
+  */
+static IPC_Status_t rx_dma_start(uint8_t device_id)
+{
+  IPC_Status_t retval = IPC_OK;
+  UART_HandleTypeDef *huart = IPC_DevicesList[device_id].phy_int.h_uart;
+
+  IPC_DevicesList[device_id].RxDmaReadPos = 0U;
+  if (HAL_UART_Receive_DMA(huart, (uint8_t *)IPC_DevicesList[device_id].RxDmaBuffer, IPC_RXDMA_BUFFER_SIZE) != HAL_OK)
+  {
+    PRINT_ERR("HAL_UART_Receive_DMA error")
+    retval = IPC_ERROR;
+  }
+  else
+  {
+    __HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_IDLEF);
+    __HAL_UART_ENABLE_IT(huart, UART_IT_IDLE);
+  }
+
+  return (retval);
+}
+
+/**
+  * brief  Write chars received by the DMA since last call into the RX FIFO.
+  * note   Called under IT from UART and DMA interrupts, which must have the same priority.
+  * param  device_id IPC device identifier.
+  * retval none
+  */
+static void rx_dma_process(uint8_t device_id)
+{
+  IPC_ClientDescription_t *p_device = &IPC_DevicesList[device_id];
+  IPC_Handle_t *hipc = p_device->h_current_channel;
+  uint16_t write_pos;
+  uint16_t size;
+  uint16_t written;
+
+  if ((hipc != NULL) && (hipc->State == IPC_STATE_ACTIVE) && (p_device->phy_int.h_uart->hdmarx != NULL))
+  {
+    /* DMA counter holds the number of chars before the end of the buffer */
+    write_pos = IPC_RXDMA_BUFFER_SIZE - (uint16_t) __HAL_DMA_GET_COUNTER(p_device->phy_int.h_uart->hdmarx);
+    if (write_pos >= IPC_RXDMA_BUFFER_SIZE)
+    {
+      write_pos = 0U;
+    }
+
+    while ((p_device->RxDmaReadPos != write_pos) && (hipc->State == IPC_STATE_ACTIVE))
+    {
+      /* contiguous part of the circular buffer */
+      if (write_pos > p_device->RxDmaReadPos)
+      {
+        size = write_pos - p_device->RxDmaReadPos;
+      }
+      else
+      {
+        size = IPC_RXDMA_BUFFER_SIZE - p_device->RxDmaReadPos;
+      }
+
+      written = IPC_RXFIFO_writeBlock(hipc, (const uint8_t *)&p_device->RxDmaBuffer[p_device->RxDmaReadPos], size);
+      p_device->RxDmaReadPos = (p_device->RxDmaReadPos + written) % IPC_RXDMA_BUFFER_SIZE;
+    }
+
+    if (hipc->State == IPC_STATE_PAUSED)
+    {
+      /* RX FIFO almost full: keep remaining chars in the DMA buffer and hold the modem */
+      rx_dma_pause(p_device->phy_int.h_uart);
+    }
+  }
+}
+
+/**
+  * brief  Stop DMA requests: the char kept in the UART data register deasserts RTS.
+  * param  huart Handle to the HAL UART structure.
+  * retval none
+  */
+static void rx_dma_pause(UART_HandleTypeDef *huart)
+{
+  /* same as HAL_UART_DMAPause() for RX only, without locking the handle (called under IT) */
+  CLEAR_BIT(huart->Instance->CR1, USART_CR1_PEIE);
+  CLEAR_BIT(huart->Instance->CR3, USART_CR3_EIE);
+  CLEAR_BIT(huart->Instance->CR3, USART_CR3_DMAR);
+}
+
+/**
+  * brief  Restart DMA requests stopped by rx_dma_pause().
+  * param  huart Handle to the HAL UART structure.
+  * retval none
+  */
+static void rx_dma_resume(UART_HandleTypeDef *huart)
+{
+  __HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_OREF);
+  if (huart->Init.Parity != UART_PARITY_NONE)
+  {
+    SET_BIT(huart->Instance->CR1, USART_CR1_PEIE);
+  }
+  SET_BIT(huart->Instance->CR3, USART_CR3_EIE);
+  SET_BIT(huart->Instance->CR3, USART_CR3_DMAR);
+}
+
+/**
+  * brief  Find the interrupt line of an UART.
+  * param  huart Handle to the HAL UART structure.
+  * retval IRQ number
+  */
+static IRQn_Type find_uart_irq(const UART_HandleTypeDef *huart)
+{
+  IRQn_Type irq;
+
+  if (huart->Instance == USART1)
+  {
+    irq = USART1_IRQn;
+  }
+  else if (huart->Instance == USART2)
+  {
+    irq = USART2_IRQn;
+  }
+#if defined(USART3)
+  else if (huart->Instance == USART3)
+  {
+    irq = USART3_IRQn;
+  }
+#endif /* USART3 */
+#if defined(UART4)
+  else if (huart->Instance == UART4)
+  {
+    irq = UART4_IRQn;
+  }
+#endif /* UART4 */
+#if defined(UART5)
+  else if (huart->Instance == UART5)
+  {
+    irq = UART5_IRQn;
+  }
+#endif /* UART5 */
+  else
+  {
+    irq = LPUART1_IRQn;
+  }
+
+  return (irq);
+}
+#endif /* IPC_USE_RX_DMA */
+
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
 
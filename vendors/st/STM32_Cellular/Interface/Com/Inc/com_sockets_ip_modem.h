@@ -30,8 +30,13 @@ extern "C" {
 
 #include "com_common.h"
 #include "com_sockets_addr_compat.h"
+#include "com_sockets_net_compat.h"
 
 /* Exported constants --------------------------------------------------------*/
+/* Maximum number of tasks waiting at the same time in com_poll_ip_modem() */
+#if !defined COM_SOCKETS_POLL_WAITERS_NB
+#define COM_SOCKETS_POLL_WAITERS_NB 4U
+#endif /* !defined COM_SOCKETS_POLL_WAITERS_NB */
 
 /* Exported types ------------------------------------------------------------*/
 
@@ -193,6 +198,11 @@ int32_t com_connect_ip_modem(int32_t sock,
   *         - if flags = COM_MSG_WAIT, application accept to wait
   *         if len of buffer to send > interface between COM and low level.
   *          COM will fragment the buffer according to the interface (multiple sends)
+  *         - if flags contains COM_MSG_MORE, application has more data to send
+  *          data may be gathered and sent with next send (or before next receive)
+  *          success only means the data is gathered: if it cannot be sent later
+  *          the socket is in error, next send and recv return the error
+  *          until the socket is closed
   * @retval int32_t   - number of bytes sent or error value
   */
 int32_t com_send_ip_modem(int32_t sock,
@@ -275,6 +285,25 @@ int32_t com_recvfrom_ip_modem(int32_t sock,
                               int32_t flags,
                               com_sockaddr_t *from, int32_t *fromlen);
 
+/**
+  * @brief  Socket poll
+  * @note   Wait until at least one socket of a set is ready
+  * @param  fds       - sockets to check, revents is updated for each of them
+  * @param  nfds      - number of entries in fds
+  * @param  timeout   - maximum time to wait (in ms)
+  * @note   - 0 : check readiness and return immediately
+  *         - COM_POLL_INFINITE : wait until a socket is ready
+  * @note   COM_POLLIN is raised from modem URC data ready and stays raised
+  *         until a receive call drains the data announced by the modem
+  *         COM_POLLERR, COM_POLLHUP and COM_POLLNVAL are always reported
+  * @note   Data gathered with COM_MSG_MORE are sent before waiting,
+  *         COM_POLLERR is raised if they could not be sent
+  * @note   At most COM_SOCKETS_POLL_WAITERS_NB tasks may wait at the same time
+  *         an additional task gets COM_SOCKETS_ERR_NOMEMORY unless timeout is 0
+  * @retval int32_t   - number of ready sockets, 0 on timeout or error value
+  */
+int32_t com_poll_ip_modem(com_pollfd_t *fds, uint32_t nfds, uint32_t timeout);
+
 /**
   * @brief  Socket close
   * @note   Close a socket and release socket handle
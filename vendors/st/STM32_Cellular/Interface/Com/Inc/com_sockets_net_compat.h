@@ -90,6 +90,15 @@ extern "C" {
 /* Flags used with recv. */
 #define COM_MSG_WAIT       0x00    /*!< Blocking     */
 #define COM_MSG_DONTWAIT   0x01    /*!< Non blocking */
+/* Flags used with send. */
+#define COM_MSG_MORE       0x02    /*!< More data to come: may be gathered with next send */
+
+/* Events used with poll. */
+#define COM_POLLIN         0x0001  /*!< Data may be read without blocking   */
+#define COM_POLLERR        0x0008  /*!< Gathered data lost - revents only   */
+#define COM_POLLHUP        0x0010  /*!< Remote closed the connection        */
+#define COM_POLLNVAL       0x0020  /*!< Socket handle unknown - revents only */
+#define COM_POLL_INFINITE  0xFFFFFFFFU /*!< poll timeout: wait until a socket is ready */
 
 /**
   * @}
@@ -100,6 +109,14 @@ extern "C" {
   * @{
   */
 
+/* Socket entry used with poll */
+typedef struct
+{
+  int32_t sock;    /*!< Socket handle obtained with com_socket                 */
+  int16_t events;  /*!< Requested events - COM_POLLIN                          */
+  int16_t revents; /*!< Returned events - COM_POLLIN, COM_POLLERR, COM_POLLHUP, COM_POLLNVAL */
+} com_pollfd_t;
+
 /**
   * @}
   */
@@ -181,6 +198,8 @@ extern "C" {
 /* Flags used with recv. */
 #define COM_MSG_WAIT       0x00
 #define COM_MSG_DONTWAIT   MSG_DONTWAIT
+/* Flags used with send. */
+#define COM_MSG_MORE       MSG_MORE
 
 /* Exported types ------------------------------------------------------------*/
 
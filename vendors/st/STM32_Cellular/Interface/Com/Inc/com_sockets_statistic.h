@@ -37,6 +37,9 @@ extern "C" {
   * @}
   */
 
+/* Internal usage only: number of buckets of the send latency histogram */
+#define COM_SOCKETS_SND_LATENCY_BUCKETS 8U
+
 /* Internal usage only: use by com_sockets_ip_modem to update statistics */
 typedef enum
 {
@@ -56,6 +59,14 @@ typedef enum
 #endif /* USE_DATACACHE == 1 */
 } com_sockets_stat_update_t;
 
+/* Internal usage only: send latency histogram of a socket
+   bucket[0]: < 16ms, bucket[i]: < (16ms << i), last bucket: >= 1024ms */
+typedef struct
+{
+  uint16_t bucket[COM_SOCKETS_SND_LATENCY_BUCKETS];
+  uint32_t max; /* in ms */
+} com_sockets_snd_latency_t;
+
 /* Exported types ------------------------------------------------------------*/
 /** @addtogroup COM_SOCKETS_Types
   * @{
@@ -124,6 +135,26 @@ void com_sockets_statistic_init(void);
   */
 void com_sockets_statistic_update(com_sockets_stat_update_t stat);
 
+/**
+  * @brief  Add a send duration to a socket send latency histogram
+  * @note   -
+  * @param  p_latency - histogram to update
+  * @param  latency   - duration of the low level send (in ms)
+  * @retval -
+  */
+void com_sockets_statistic_snd_latency_update(com_sockets_snd_latency_t *p_latency,
+                                              uint32_t latency);
+
+/**
+  * @brief  Display a socket send latency histogram
+  * @note   COM_SOCKETS_STATISTIC and USE_TRACE_COM_SOCKETS must be set to 1
+  * @param  sock      - socket handle
+  * @param  p_latency - histogram to display
+  * @retval -
+  */
+void com_sockets_statistic_snd_latency_display(int32_t sock,
+                                               const com_sockets_snd_latency_t *p_latency);
+
 #ifdef __cplusplus
 }
 #endif
@@ -71,6 +71,28 @@
 #define COM_MODEM_MAX_TX_DATA_SIZE CONFIG_MODEM_MAX_SOCKET_TX_DATA_SIZE
 #define COM_MODEM_MAX_RX_DATA_SIZE CONFIG_MODEM_MAX_SOCKET_RX_DATA_SIZE
 
+/* Maximum data passed to low level in one send:
+   low level chains the AT+QISEND of consecutive chunks without returning to COM */
+#if defined(CONFIG_MODEM_SOCKET_TX_PIPELINE_DEPTH)
+#define COM_MODEM_TX_BATCH_SIZE (COM_MODEM_MAX_TX_DATA_SIZE * CONFIG_MODEM_SOCKET_TX_PIPELINE_DEPTH)
+#else
+#define COM_MODEM_TX_BATCH_SIZE COM_MODEM_MAX_TX_DATA_SIZE
+#endif /* CONFIG_MODEM_SOCKET_TX_PIPELINE_DEPTH */
+
+#if !defined COM_SOCKETS_SND_COALESCING
+#define COM_SOCKETS_SND_COALESCING 0U
+#endif /* !defined COM_SOCKETS_SND_COALESCING */
+
+/* Latency trace points of the send path: COM_SOCKETS_TRACE_BEGIN() returns a timestamp,
+   COM_SOCKETS_TRACE_END(stage, start) records the duration of COM_SEND (com_send_ip_modem)
+   or COM_MODEM_SEND (one low level send) - Nothing traced by default */
+#if !defined COM_SOCKETS_TRACE_BEGIN
+#define COM_SOCKETS_TRACE_BEGIN() 0U
+#endif /* !defined COM_SOCKETS_TRACE_BEGIN */
+#if !defined COM_SOCKETS_TRACE_END
+#define COM_SOCKETS_TRACE_END(stage, start) UNUSED(start)
+#endif /* !defined COM_SOCKETS_TRACE_END */
+
 #define COM_SOCKET_LOCAL_ID_NB 1U /* Socket local id number : 1 for ping */
 
 #define COM_LOCAL_PORT_BEGIN  0xc000U /* 49152 */
@@ -114,6 +136,7 @@ typedef struct _socket_desc_t
   bool                  local;       /*   internal id - e.g for ping
                                        or external id - e.g modem    */
   bool                  closing;     /* close recv from remote  */
+  bool                  rcv_ready;   /* data announced by modem not yet read */
   uint8_t               type;        /* Socket Type TCP/UDP/RAW */
   int32_t               error;       /* last command status     */
   int32_t               id;          /* identifier */
@@ -124,6 +147,14 @@ typedef struct _socket_desc_t
   uint32_t              rcv_timeout; /* timeout for receive cmd */
   osMessageQId          queue;       /* message queue for URC   */
   com_ping_rsp_t        *rsp;
+  com_sockets_snd_latency_t snd_latency; /* low level send duration histogram */
+#if (COM_SOCKETS_SND_COALESCING == 1U)
+  com_char_t            *snd_buffer; /* data sent with COM_MSG_MORE waiting
+                                        to be sent to low level or NULL */
+  uint32_t              snd_length;  /* length of data waiting in snd_buffer */
+  int32_t               snd_error;   /* gathered data lost by a failed flush:
+                                        returned by send and recv until close */
+#endif /* COM_SOCKETS_SND_COALESCING == 1U */
   struct _socket_desc_t *next;       /* chained list            */
 } socket_desc_t;
 
@@ -159,6 +190,13 @@ typedef enum
                                            (socket)->error = (val); }\
                                          } while(0)
 
+/* Error of gathered data lost by a failed flush */
+#if (COM_SOCKETS_SND_COALESCING == 1U)
+#define SOCKET_SND_ERROR(socket) ((socket)->snd_error)
+#else
+#define SOCKET_SND_ERROR(socket) (COM_SOCKETS_ERR_OK)
+#endif /* COM_SOCKETS_SND_COALESCING == 1U */
+
 /* Get socket error */
 #define SOCKET_GET_ERROR(socket, val) do {\
                                            if ((socket) != NULL) {\
@@ -199,6 +237,15 @@ static int32_t ping_socket_id; /* Ping socket id */
 
 static bool com_sockets_network_is_up; /* Network status is managed through Datacache */
 
+/* Tasks waiting in com_poll_ip_modem() - in_use protected by ComSocketsMutexHandle
+   Each waiter has its own semaphore: a wake up can neither be stolen by another waiter nor dropped */
+typedef struct
+{
+  bool          in_use;
+  osSemaphoreId sem;
+} com_poll_waiter_t;
+static com_poll_waiter_t com_poll_waiters[COM_SOCKETS_POLL_WAITERS_NB];
+
 #if (USE_LOW_POWER == 1)
 /* Timer to check inactivity on socket and maybe to go in data idle mode */
 static osTimerId ComTimerInactivityId;
@@ -227,6 +274,10 @@ static uint16_t com_local_port; /* a value in [COM_LOCAL_PORT_BEGIN, COM_LOCAL_P
 static void com_ip_modem_data_ready_cb(socket_handle_t sock);
 /* Callback called by AT when closing is received */
 static void com_ip_modem_closing_cb(socket_handle_t sock);
+/* Wake up tasks waiting in com_poll_ip_modem() */
+static void com_ip_modem_poll_wakeup(void);
+/* Readiness of one socket for com_poll_ip_modem() */
+static int16_t com_ip_modem_poll_revents(const com_pollfd_t *fd);
 
 #if (USE_DATACACHE == 1)
 /* Callback called by Datacache - used to know Network status */
@@ -284,6 +335,20 @@ static int32_t com_ip_modem_connect_udp_service(socket_desc_t *socket_desc);
 /* Request low power */
 static void com_ip_modem_wakeup_request(void);
 static void com_ip_modem_idlemode_request(bool immediate);
+
+/* Send data to low level and update send latency histogram */
+static CS_Status_t com_ip_modem_socket_send(socket_desc_t *socket_desc,
+                                            const com_char_t *buf, uint32_t len,
+                                            uint32_t *len_sent);
+#if (COM_SOCKETS_SND_COALESCING == 1U)
+/* Gather data in socket coalescing buffer */
+static bool com_ip_modem_snd_coalesce(socket_desc_t *socket_desc,
+                                      const com_char_t *buf, uint32_t len);
+/* Send data waiting in socket coalescing buffer */
+static bool com_ip_modem_snd_flush(socket_desc_t *socket_desc);
+/* Release socket coalescing buffer */
+static void com_ip_modem_snd_release(socket_desc_t *socket_desc);
+#endif /* COM_SOCKETS_SND_COALESCING == 1U */
 #if (USE_LOW_POWER == 1U)
 static bool com_ip_modem_are_all_sockets_invalid(void);
 #endif /* USE_LOW_POWER == 1U */
@@ -301,6 +366,7 @@ static void com_ip_modem_init_socket_desc(socket_desc_t *socket_desc)
   socket_desc->state            = COM_SOCKET_INVALID;
   socket_desc->local            = false;
   socket_desc->closing          = false;
+  socket_desc->rcv_ready        = false;
   socket_desc->id               = COM_SOCKET_INVALID_ID;
   socket_desc->local_port       = 0U;
   socket_desc->remote_port      = 0U;
@@ -309,6 +375,12 @@ static void com_ip_modem_init_socket_desc(socket_desc_t *socket_desc)
   socket_desc->rcv_timeout      = RTOS_WAIT_FOREVER;
   socket_desc->snd_timeout      = RTOS_WAIT_FOREVER;
   socket_desc->error            = COM_SOCKETS_ERR_OK;
+  (void)memset((void *)&socket_desc->snd_latency, 0, sizeof(socket_desc->snd_latency));
+#if (COM_SOCKETS_SND_COALESCING == 1U)
+  /* Data still gathered are dropped */
+  com_ip_modem_snd_release(socket_desc);
+  socket_desc->snd_error        = COM_SOCKETS_ERR_OK;
+#endif /* COM_SOCKETS_SND_COALESCING == 1U */
   /* socket_desc->next is not re-initialize - element is let in the list at its place */
   /* socket_desc->queue is not re-initialize - queue is reused */
 }
@@ -338,6 +410,9 @@ static socket_desc_t *com_ip_modem_create_socket_desc(void)
     else
     {
       socket_desc->next = NULL;
+#if (COM_SOCKETS_SND_COALESCING == 1U)
+      socket_desc->snd_buffer = NULL;
+#endif /* COM_SOCKETS_SND_COALESCING == 1U */
       com_ip_modem_init_socket_desc(socket_desc);
     }
   }
@@ -993,6 +1068,121 @@ static void com_ip_modem_wakeup_request(void)
 #endif /* USE_LOW_POWER == 1 */
 }
 
+/**
+  * @brief  Send data to low level
+  * @note   Duration of the low level send is added to socket send latency histogram
+  * @param  socket_desc - socket descriptor
+  * @param  buf         - pointer to data to send
+  * @param  len         - length of data to send (at most COM_MODEM_TX_BATCH_SIZE)
+  * @param  len_sent    - length of data sent: len if status OK,
+  *                       data accepted before the error otherwise
+  * @retval CS_Status_t - low level send status
+  */
+static CS_Status_t com_ip_modem_socket_send(socket_desc_t *socket_desc,
+                                            const com_char_t *buf, uint32_t len,
+                                            uint32_t *len_sent)
+{
+  CS_Status_t status;
+  uint32_t start;
+  uint32_t trace_start;
+
+  start = osKernelSysTick();
+  trace_start = COM_SOCKETS_TRACE_BEGIN();
+  /* A tempo is already managed at low-level */
+  status = osCDS_socket_send(socket_desc->id, buf, len, len_sent);
+  COM_SOCKETS_TRACE_END(COM_MODEM_SEND, trace_start);
+  com_sockets_statistic_snd_latency_update(&socket_desc->snd_latency,
+                                           ((osKernelSysTick() - start) * 1000U) / osKernelSysTickFrequency);
+
+  return status;
+}
+
+#if (COM_SOCKETS_SND_COALESCING == 1U)
+/**
+  * @brief  Gather data in socket coalescing buffer
+  * @note   Buffer is allocated at first use and kept until socket is closed
+  * @param  socket_desc - socket descriptor
+  * @param  buf         - pointer to data to gather
+  * @param  len         - length of data to gather
+  * @retval bool        - true: data gathered, false: buffer full or not enough memory
+  */
+static bool com_ip_modem_snd_coalesce(socket_desc_t *socket_desc,
+                                      const com_char_t *buf, uint32_t len)
+{
+  bool result = false;
+
+  if (len <= (COM_MODEM_MAX_TX_DATA_SIZE - socket_desc->snd_length))
+  {
+    if (socket_desc->snd_buffer == NULL)
+    {
+      socket_desc->snd_buffer = (com_char_t *)pvPortMalloc(COM_MODEM_MAX_TX_DATA_SIZE);
+    }
+    if (socket_desc->snd_buffer != NULL)
+    {
+      (void)memcpy(&socket_desc->snd_buffer[socket_desc->snd_length], buf, len);
+      socket_desc->snd_length += len;
+      result = true;
+    }
+    else
+    {
+      PRINT_ERR("snd gathering NOK no memory")
+    }
+  }
+
+  return result;
+}
+
+/**
+  * @brief  Send data waiting in socket coalescing buffer
+  * @note   Data waiting are dropped whatever the send result
+  *         The sends that gathered them already returned success, so on error
+  *         the socket keeps snd_error and next send and recv return it
+  * @param  socket_desc - socket descriptor
+  * @retval bool        - true: no data waiting or data sent, false: send NOK
+  */
+static bool com_ip_modem_snd_flush(socket_desc_t *socket_desc)
+{
+  bool result = true;
+
+  if (socket_desc->snd_length != 0U)
+  {
+    if (com_ip_modem_socket_send(socket_desc,
+                                 socket_desc->snd_buffer,
+                                 socket_desc->snd_length,
+                                 NULL)
+        == CELLULAR_OK)
+    {
+      PRINT_INFO("snd gathered data ok")
+    }
+    else
+    {
+      PRINT_ERR("snd gathered data NOK at low level")
+      socket_desc->snd_error = COM_SOCKETS_ERR_GENERAL;
+      result = false;
+    }
+    socket_desc->snd_length = 0U;
+  }
+
+  return result;
+}
+
+/**
+  * @brief  Release socket coalescing buffer
+  * @note   Data waiting are dropped
+  * @param  socket_desc - socket descriptor
+  * @retval -
+  */
+static void com_ip_modem_snd_release(socket_desc_t *socket_desc)
+{
+  if (socket_desc->snd_buffer != NULL)
+  {
+    vPortFree(socket_desc->snd_buffer);
+    socket_desc->snd_buffer = NULL;
+  }
+  socket_desc->snd_length = 0U;
+}
+#endif /* COM_SOCKETS_SND_COALESCING == 1U */
+
 /**
   * @brief  Callback called when URC data ready raised
   * @note   Managed URC data ready
@@ -1013,6 +1203,10 @@ static void com_ip_modem_data_ready_cb(socket_handle_t sock)
   {
     if (socket_desc->closing != true)
     {
+      /* Data stays ready until a receive finds the modem buffer drained */
+      socket_desc->rcv_ready = true;
+      com_ip_modem_poll_wakeup();
+
       if (socket_desc->state == COM_SOCKET_WAITING_RSP)
       {
         PRINT_INFO("cb socket %ld data ready called: waiting rsp", socket_desc->id)
@@ -1070,6 +1264,7 @@ static void com_ip_modem_closing_cb(socket_handle_t sock)
     {
       socket_desc->closing = true;
       PRINT_INFO("cb socket closing: close rqt")
+      com_ip_modem_poll_wakeup();
     }
     if ((socket_desc->state == COM_SOCKET_WAITING_RSP)
         || (socket_desc->state == COM_SOCKET_WAITING_FROM))
@@ -1087,6 +1282,68 @@ static void com_ip_modem_closing_cb(socket_handle_t sock)
   }
 }
 
+/**
+  * @brief  Wake up tasks waiting in poll
+  * @note   Called on URC data ready / closing
+  *         Each waiting task is woken up and checks its own sockets
+  * @param  -
+  * @retval -
+  */
+static void com_ip_modem_poll_wakeup(void)
+{
+  uint8_t i;
+
+  for (i = 0U; i < COM_SOCKETS_POLL_WAITERS_NB; i++)
+  {
+    if (com_poll_waiters[i].in_use == true)
+    {
+      PRINT_DBG("cb socket poll wakeup")
+      /* Semaphore already released: waiter is already woken up */
+      (void)osSemaphoreRelease(com_poll_waiters[i].sem);
+    }
+  }
+}
+
+/**
+  * @brief  Readiness of one socket
+  * @note   ComSocketsMutexHandle must be taken by the caller
+  * @param  fd      - poll entry
+  * @retval int16_t - events raised on the socket
+  */
+static int16_t com_ip_modem_poll_revents(const com_pollfd_t *fd)
+{
+  uint16_t revents;
+  const socket_desc_t *socket_desc;
+
+  revents = 0U;
+  socket_desc = com_ip_modem_find_socket(fd->sock, false);
+
+  if ((socket_desc == NULL)
+      || (socket_desc->state == COM_SOCKET_INVALID))
+  {
+    revents = (uint16_t)COM_POLLNVAL;
+  }
+  else
+  {
+    if ((socket_desc->rcv_ready == true)
+        && (((uint16_t)fd->events & (uint16_t)COM_POLLIN) != 0U))
+    {
+      revents |= (uint16_t)COM_POLLIN;
+    }
+    if ((socket_desc->closing == true)
+        || (socket_desc->state == COM_SOCKET_CLOSING))
+    {
+      revents |= (uint16_t)COM_POLLHUP;
+    }
+    if (SOCKET_SND_ERROR(socket_desc) != COM_SOCKETS_ERR_OK)
+    {
+      revents |= (uint16_t)COM_POLLERR;
+    }
+  }
+
+  return ((int16_t)revents);
+}
+
 #if (USE_DATACACHE == 1)
 /**
   * @brief  Callback called when a value in datacache changed
@@ -1915,6 +2172,11 @@ int32_t com_connect_ip_modem(int32_t sock,
   *         - if flags = COM_MSG_WAIT, application accept to wait
   *         if len of buffer to send > interface between COM and low level.
   *          COM will fragment the buffer according to the interface (multiple sends)
+  *         - if flags contains COM_MSG_MORE, application has more data to send
+  *          data may be gathered and sent with next send (or before next receive)
+  *          success only means the data is gathered: if it cannot be sent later
+  *          the socket is in error, next send and recv return the error
+  *          until the socket is closed
   * @retval int32_t   - number of bytes sent or error value
   */
 int32_t com_send_ip_modem(int32_t sock,
@@ -1924,7 +2186,9 @@ int32_t com_send_ip_modem(int32_t sock,
   bool is_network_up;
   socket_desc_t *socket_desc;
   int32_t result;
+  uint32_t trace_start;
 
+  trace_start = COM_SOCKETS_TRACE_BEGIN();
   result = COM_SOCKETS_ERR_PARAMETER;
   socket_desc = com_ip_modem_find_socket(sock,
                                          false);
@@ -1960,22 +2224,76 @@ int32_t com_send_ip_modem(int32_t sock,
           {
             uint32_t length_to_send;
             uint32_t length_send;
+            bool send_ok;
 
             result = COM_SOCKETS_ERR_GENERAL;
             length_send = 0U;
+            send_ok = true;
             socket_desc->state = COM_SOCKET_SENDING;
 
-            if (flags == COM_MSG_DONTWAIT)
+            if (SOCKET_SND_ERROR(socket_desc) != COM_SOCKETS_ERR_OK)
             {
-              length_to_send = COM_MIN((uint32_t)len, COM_MODEM_MAX_TX_DATA_SIZE);
-              if (osCDS_socket_send(socket_desc->id,
-                                    buf, length_to_send)
+              /* Gathered data already reported sent were lost */
+              result = SOCKET_SND_ERROR(socket_desc);
+              send_ok = false;
+              PRINT_ERR("snd data NOK gathered data lost")
+            }
+#if (COM_SOCKETS_SND_COALESCING == 1U)
+            /* Data sent with COM_MSG_MORE are gathered
+               and sent with the first data sent without COM_MSG_MORE */
+            else if (((flags & COM_MSG_MORE) == COM_MSG_MORE)
+                     || (socket_desc->snd_length != 0U))
+            {
+              bool gathered;
+
+              gathered = com_ip_modem_snd_coalesce(socket_desc, buf, (uint32_t)len);
+              if ((gathered == false)
+                  || ((flags & COM_MSG_MORE) != COM_MSG_MORE))
+              {
+                send_ok = com_ip_modem_snd_flush(socket_desc);
+                /* Buffer full: data sent with COM_MSG_MORE start a new gathering */
+                if ((gathered == false)
+                    && (send_ok == true)
+                    && ((flags & COM_MSG_MORE) == COM_MSG_MORE))
+                {
+                  gathered = com_ip_modem_snd_coalesce(socket_desc, buf, (uint32_t)len);
+                }
+              }
+              if (gathered == true)
+              {
+                length_send = (uint32_t)len;
+              }
+            }
+#endif /* COM_SOCKETS_SND_COALESCING == 1U */
+
+            if (send_ok == false)
+            {
+              socket_desc->state = COM_SOCKET_CONNECTED;
+            }
+            else if (length_send == (uint32_t)len)
+            {
+              /* Data already managed by coalescing */
+              result = (int32_t)length_send;
+              socket_desc->state = COM_SOCKET_CONNECTED;
+              PRINT_INFO("snd data gathered")
+            }
+            else if ((flags & ~COM_MSG_MORE) == COM_MSG_DONTWAIT)
+            {
+              length_to_send = COM_MIN((uint32_t)len, COM_MODEM_TX_BATCH_SIZE);
+              if (com_ip_modem_socket_send(socket_desc,
+                                           buf, length_to_send,
+                                           &length_send)
                   == CELLULAR_OK)
               {
-                length_send = length_to_send;
                 result = (int32_t)length_send;
                 PRINT_INFO("snd data DONTWAIT ok")
               }
+              else if (length_send != 0U)
+              {
+                /* Part of the batch accepted before the error */
+                result = (int32_t)length_send;
+                PRINT_ERR("snd data DONTWAIT partial at low level")
+              }
               else
               {
                 PRINT_ERR("snd data DONTWAIT NOK at low level")
@@ -1985,19 +2303,21 @@ int32_t com_send_ip_modem(int32_t sock,
             else
             {
               is_network_up = com_ip_modem_is_network_up();
-              /* Send all data of a big buffer - Whatever the size */
+              /* Send all data of a big buffer - Whatever the size
+                 Wake-up already requested for the whole buffer */
               while ((length_send != (uint32_t)len)
                      && (socket_desc->closing == false)
                      && (is_network_up == true)
                      && (socket_desc->state == COM_SOCKET_SENDING))
               {
+                uint32_t length_sent;
+
                 length_to_send = COM_MIN((((uint32_t)len) - length_send),
-                                         COM_MODEM_MAX_TX_DATA_SIZE);
-                com_ip_modem_wakeup_request();
-                /* A tempo is already managed at low-level */
-                if (osCDS_socket_send(socket_desc->id,
-                                      buf + length_send,
-                                      length_to_send)
+                                         COM_MODEM_TX_BATCH_SIZE);
+                if (com_ip_modem_socket_send(socket_desc,
+                                             buf + length_send,
+                                             length_to_send,
+                                             &length_sent)
                     == CELLULAR_OK)
                 {
                   length_send += length_to_send;
@@ -2007,10 +2327,11 @@ int32_t com_send_ip_modem(int32_t sock,
                 }
                 else
                 {
+                  /* Part of the batch may have been accepted before the error */
+                  length_send += length_sent;
                   socket_desc->state = COM_SOCKET_CONNECTED;
                   PRINT_ERR("snd data NOK at low level")
                 }
-                com_ip_modem_idlemode_request(false);
               }
               socket_desc->state = COM_SOCKET_CONNECTED;
               result = (int32_t)length_send;
@@ -2058,6 +2379,8 @@ int32_t com_send_ip_modem(int32_t sock,
     SOCKET_SET_ERROR(socket_desc, result);
   }
 
+  COM_SOCKETS_TRACE_END(COM_SEND, trace_start);
+
   return (result);
 }
 
@@ -2193,7 +2516,7 @@ int32_t com_sendto_ip_modem(int32_t sock,
 
               com_ip_modem_wakeup_request();
 
-              if (flags == COM_MSG_DONTWAIT)
+              if ((flags & ~COM_MSG_MORE) == COM_MSG_DONTWAIT)
               {
                 length_to_send = COM_MIN((uint32_t)len, COM_MODEM_MAX_TX_DATA_SIZE);
 
@@ -2335,9 +2658,16 @@ int32_t com_recv_ip_modem(int32_t sock,
       uint32_t length_to_read;
       length_to_read = COM_MIN((uint32_t)len, COM_MODEM_MAX_RX_DATA_SIZE);
       socket_desc->state = COM_SOCKET_WAITING_RSP;
+      /* A data ready received from now on is for data not read by this call */
+      socket_desc->rcv_ready = false;
 
       com_ip_modem_wakeup_request();
 
+#if (COM_SOCKETS_SND_COALESCING == 1U)
+      /* Remote can answer only once gathered data are sent */
+      (void)com_ip_modem_snd_flush(socket_desc);
+#endif /* COM_SOCKETS_SND_COALESCING == 1U */
+
       do
       {
         event = osMessageGet(socket_desc->queue, 0U);
@@ -2347,7 +2677,14 @@ int32_t com_recv_ip_modem(int32_t sock,
         }
       } while (event.status == osEventMessage);
 
-      if (flags == COM_MSG_DONTWAIT)
+      if (SOCKET_SND_ERROR(socket_desc) != COM_SOCKETS_ERR_OK)
+      {
+        /* Gathered data already reported sent were lost */
+        result = SOCKET_SND_ERROR(socket_desc);
+        socket_desc->state = COM_SOCKET_CONNECTED;
+        PRINT_ERR("rcv data NOK gathered data lost")
+      }
+      else if (flags == COM_MSG_DONTWAIT)
       {
 
         /* Application don't want to wait if there is no data available */
@@ -2442,6 +2779,13 @@ int32_t com_recv_ip_modem(int32_t sock,
         }
       } while (event.status == osEventMessage);
 
+      /* Application buffer full: more data may wait in the modem */
+      if ((result == COM_SOCKETS_ERR_OK)
+          && ((uint32_t)len_rcv == length_to_read))
+      {
+        socket_desc->rcv_ready = true;
+      }
+
       com_ip_modem_idlemode_request(false);
     }
     else
@@ -2569,6 +2913,8 @@ int32_t com_recvfrom_ip_modem(int32_t sock,
           uint32_t length_to_read;
           length_to_read = COM_MIN((uint32_t)len, COM_MODEM_MAX_RX_DATA_SIZE);
           socket_desc->state = COM_SOCKET_WAITING_FROM;
+          /* A data ready received from now on is for data not read by this call */
+          socket_desc->rcv_ready = false;
 
           do
           {
@@ -2684,6 +3030,13 @@ int32_t com_recvfrom_ip_modem(int32_t sock,
               PRINT_DBG("rcvfrom data exit cleanup MSGqueue")
             }
           } while (event.status == osEventMessage);
+
+          /* A datagram was read: others may wait in the modem */
+          if ((result == COM_SOCKETS_ERR_OK)
+              && (len_rcv > 0))
+          {
+            socket_desc->rcv_ready = true;
+          }
         }
         else
         {
@@ -2722,6 +3075,119 @@ int32_t com_recvfrom_ip_modem(int32_t sock,
   return ((result == COM_SOCKETS_ERR_OK) ? len_rcv : result);
 }
 
+/**
+  * @brief  Socket poll
+  * @note   Wait until at least one socket of a set is ready
+  * @param  fds       - sockets to check, revents is updated for each of them
+  * @param  nfds      - number of entries in fds
+  * @param  timeout   - maximum time to wait (in ms)
+  * @note   - 0 : check readiness and return immediately
+  *         - COM_POLL_INFINITE : wait until a socket is ready
+  * @note   Data gathered with COM_MSG_MORE are sent before waiting
+  * @note   At most COM_SOCKETS_POLL_WAITERS_NB tasks may wait at the same time
+  *         an additional task gets COM_SOCKETS_ERR_NOMEMORY unless timeout is 0
+  * @retval int32_t   - number of ready sockets, 0 on timeout or error value
+  */
+int32_t com_poll_ip_modem(com_pollfd_t *fds, uint32_t nfds, uint32_t timeout)
+{
+  int32_t result;
+  uint32_t i;
+  uint32_t start;
+  uint32_t elapsed;
+  bool waiting;
+  com_poll_waiter_t *waiter;
+#if (COM_SOCKETS_SND_COALESCING == 1U)
+  socket_desc_t *socket_desc;
+#endif /* COM_SOCKETS_SND_COALESCING == 1U */
+
+  if ((fds == NULL)
+      || (nfds == 0U))
+  {
+    result = COM_SOCKETS_ERR_PARAMETER;
+  }
+  else
+  {
+#if (COM_SOCKETS_SND_COALESCING == 1U)
+    /* Remote can answer only once gathered data are sent */
+    for (i = 0U; i < nfds; i++)
+    {
+      socket_desc = com_ip_modem_find_socket(fds[i].sock, false);
+      if ((socket_desc != NULL)
+          && (socket_desc->state == COM_SOCKET_CONNECTED)
+          && (socket_desc->snd_length != 0U))
+      {
+        com_ip_modem_wakeup_request();
+        (void)com_ip_modem_snd_flush(socket_desc);
+        com_ip_modem_idlemode_request(false);
+      }
+    }
+#endif /* COM_SOCKETS_SND_COALESCING == 1U */
+
+    start = osKernelSysTick();
+    waiting = true;
+    waiter = NULL;
+    result = 0;
+
+    while (waiting == true)
+    {
+      (void)osMutexWait(ComSocketsMutexHandle, RTOS_WAIT_FOREVER);
+      /* Registered as waiter before the check:
+         a URC received after the check always wakes up this task */
+      if ((waiter == NULL)
+          && (timeout != 0U))
+      {
+        for (i = 0U; (i < COM_SOCKETS_POLL_WAITERS_NB) && (waiter == NULL); i++)
+        {
+          if (com_poll_waiters[i].in_use == false)
+          {
+            waiter = &com_poll_waiters[i];
+            /* Drop a wake up left by the previous user of the slot */
+            (void)osSemaphoreWait(waiter->sem, 0U);
+            waiter->in_use = true;
+          }
+        }
+      }
+      result = 0;
+      for (i = 0U; i < nfds; i++)
+      {
+        fds[i].revents = com_ip_modem_poll_revents(&fds[i]);
+        if (fds[i].revents != 0)
+        {
+          result++;
+        }
+      }
+      (void)osMutexRelease(ComSocketsMutexHandle);
+
+      elapsed = ((osKernelSysTick() - start) * 1000U) / osKernelSysTickFrequency;
+      if ((result > 0)
+          || ((timeout != COM_POLL_INFINITE) && (elapsed >= timeout)))
+      {
+        waiting = false;
+      }
+      else if (waiter == NULL)
+      {
+        PRINT_ERR("socket poll: too many waiters")
+        result = COM_SOCKETS_ERR_NOMEMORY;
+        waiting = false;
+      }
+      else
+      {
+        /* Wake up means only: readiness is checked again */
+        (void)osSemaphoreWait(waiter->sem,
+                              (timeout == COM_POLL_INFINITE) ? RTOS_WAIT_FOREVER : (timeout - elapsed));
+      }
+    }
+
+    if (waiter != NULL)
+    {
+      (void)osMutexWait(ComSocketsMutexHandle, RTOS_WAIT_FOREVER);
+      waiter->in_use = false;
+      (void)osMutexRelease(ComSocketsMutexHandle);
+    }
+  }
+
+  return result;
+}
 
 /**
   * @brief  Socket close
@@ -2752,6 +3218,11 @@ int32_t com_closesocket_ip_modem(int32_t sock)
     else
     {
       result = COM_SOCKETS_ERR_GENERAL;
+#if (COM_SOCKETS_SND_COALESCING == 1U)
+      /* Data still gathered are dropped */
+      com_ip_modem_snd_release(socket_desc);
+#endif /* COM_SOCKETS_SND_COALESCING == 1U */
+      com_sockets_statistic_snd_latency_display(sock, &socket_desc->snd_latency);
       com_ip_modem_wakeup_request();
       if (osCDS_socket_close(sock, 0U)
           == CELLULAR_OK)
@@ -3194,6 +3665,7 @@ int32_t com_closeping_ip_modem(int32_t ping)
 bool com_init_ip_modem(void)
 {
   bool result;
+  bool poll_ok;
 
   result = false;
 
@@ -3212,7 +3684,27 @@ bool com_init_ip_modem(void)
   /* Initialize Mutex to protect socket descriptor list access */
   osMutexDef(ComSocketsMutex);
   ComSocketsMutexHandle = osMutexCreate(osMutex(ComSocketsMutex));
-  if (ComSocketsMutexHandle != NULL)
+
+  /* Initialize Semaphores to wake up tasks waiting for socket readiness */
+  poll_ok = true;
+  osSemaphoreDef(COM_POLL_SEM);
+  for (uint8_t i = 0U; i < COM_SOCKETS_POLL_WAITERS_NB; i++)
+  {
+    com_poll_waiters[i].in_use = false;
+    com_poll_waiters[i].sem = osSemaphoreCreate(osSemaphore(COM_POLL_SEM), 1);
+    if (com_poll_waiters[i].sem == NULL)
+    {
+      poll_ok = false;
+    }
+    else
+    {
+      /* Semaphore is available at creation: take it */
+      (void)osSemaphoreWait(com_poll_waiters[i].sem, 0U);
+    }
+  }
+
+  if ((ComSocketsMutexHandle != NULL)
+      && (poll_ok == true))
   {
     /* Create always the first element of the list */
     socket_desc_list = com_ip_modem_create_socket_desc();
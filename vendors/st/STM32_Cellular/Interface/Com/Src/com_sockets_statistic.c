@@ -330,6 +330,59 @@ void com_sockets_statistic_display(void)
   }
 }
 
+/**
+  * @brief  Add a send duration to a socket send latency histogram
+  * @note   -
+  * @param  p_latency - histogram to update
+  * @param  latency   - duration of the low level send (in ms)
+  * @retval -
+  */
+void com_sockets_statistic_snd_latency_update(com_sockets_snd_latency_t *p_latency,
+                                              uint32_t latency)
+{
+  uint8_t i = 0U;
+  uint32_t limit = 16U;
+
+  /* Logarithmic buckets: 16ms, 32ms, ... 1024ms and more */
+  while ((i < (COM_SOCKETS_SND_LATENCY_BUCKETS - 1U))
+         && (latency >= limit))
+  {
+    i++;
+    limit <<= 1;
+  }
+  if (p_latency->bucket[i] != 0xFFFFU)
+  {
+    p_latency->bucket[i]++;
+  }
+  if (latency > p_latency->max)
+  {
+    p_latency->max = latency;
+  }
+}
+
+/**
+  * @brief  Display a socket send latency histogram
+  * @note   COM_SOCKETS_STATISTIC and USE_TRACE_COM_SOCKETS must be set to 1
+  * @param  sock      - socket handle
+  * @param  p_latency - histogram to display
+  * @retval -
+  */
+void com_sockets_statistic_snd_latency_display(int32_t sock,
+                                               const com_sockets_snd_latency_t *p_latency)
+{
+  PRINT_STAT("Snd latency sock:%ld <16:%d <32:%d <64:%d <128:%d <256:%d <512:%d <1024:%d >=1024:%d max:%ldms",
+             sock,
+             p_latency->bucket[0],
+             p_latency->bucket[1],
+             p_latency->bucket[2],
+             p_latency->bucket[3],
+             p_latency->bucket[4],
+             p_latency->bucket[5],
+             p_latency->bucket[6],
+             p_latency->bucket[7],
+             p_latency->max)
+}
+
 #else /* COM_SOCKETS_STATISTIC == 0U */
 /**
   * @brief  Component initialization
@@ -368,6 +421,36 @@ void com_sockets_statistic_display(void)
   /* Nothing to do */
 }
 
+/**
+  * @brief  Add a send duration to a socket send latency histogram
+  * @note   -
+  * @param  p_latency - histogram to update
+  * @param  latency   - duration of the low level send (in ms)
+  * @retval -
+  */
+void com_sockets_statistic_snd_latency_update(com_sockets_snd_latency_t *p_latency,
+                                              uint32_t latency)
+{
+  UNUSED(p_latency);
+  UNUSED(latency);
+  /* Nothing to do */
+}
+
+/**
+  * @brief  Display a socket send latency histogram
+  * @note   COM_SOCKETS_STATISTIC and USE_TRACE_COM_SOCKETS must be set to 1
+  * @param  sock      - socket handle
+  * @param  p_latency - histogram to display
+  * @retval -
+  */
+void com_sockets_statistic_snd_latency_display(int32_t sock,
+                                               const com_sockets_snd_latency_t *p_latency)
+{
+  UNUSED(sock);
+  UNUSED(p_latency);
+  /* Nothing to do */
+}
+
 #endif /* COM_SOCKET_STATISTIC == 1U */
 
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -30,6 +30,10 @@ extern "C" {
 #include "setup.h"
 
 /* Exported types ------------------------------------------------------------*/
+/* store a value in the key/value store, return 0 on success */
+typedef uint32_t (*feeprom_utils_kv_import_t)(void *context, const uint8_t *key, uint32_t key_len,
+                                              const uint8_t *value, uint32_t len);
+
 /* Exported constants --------------------------------------------------------*/
 /* External variables --------------------------------------------------------*/
 /* Exported macros -----------------------------------------------------------*/
@@ -53,6 +57,8 @@ uint32_t feeprom_utils_save_config_flash(setup_appli_code_t appli_code, setup_ap
 uint32_t feeprom_utils_read_config_flash(setup_appli_code_t appli_code, setup_appli_version_t appli_version,
                                          uint8_t **config_addr, uint32_t *config_size);
 
+/*  copy the configurations of the flash pages to the key/value store (FEEPROM_UTILS_KV_STORE == 1) */
+uint32_t feeprom_utils_import_legacy(feeprom_utils_kv_import_t import, void *context);
 
 #ifdef __cplusplus
 }
@@ -23,6 +23,8 @@
 #include "app_select.h"
 #include "menu_utils.h"
 
+#include <string.h>
+
 /* Private defines -----------------------------------------------------------*/
 #define FEEPROM_UTILS_MAGIC_FLASH_CONFIG1 ((uint32_t)0x00000002)
 #define FEEPROM_UTILS_MAGIC_FLASH_CONFIG2 ((uint32_t)0x5555AAAA)
@@ -50,6 +52,207 @@ typedef struct
 /* Private variables ---------------------------------------------------------*/
 
 /* Global variables ----------------------------------------------------------*/
+#if (FEEPROM_UTILS_KV_STORE == 1)
+/* Configurations are kept as values of the board key/value store:
+   "setup.NN" holds the data of appli_code NN and "setup.NN.v" its format version.
+   The version is written after the data: an update interrupted by a reset
+   leaves the previous version, or none, and the config is then discarded. */
+#define FEEPROM_UTILS_KEY_LENGTH          (8U)   /* "setup.NN"   */
+#define FEEPROM_UTILS_VERSION_KEY_LENGTH  (10U)  /* "setup.NN.v" */
+
+/* Private function prototypes -----------------------------------------------*/
+static void feeprom_utils_kv_key(setup_appli_code_t appli_code, uint8_t *key);
+static uint32_t feeprom_utils_kv_erase(setup_appli_code_t appli_code);
+
+/* Functions Definition ------------------------------------------------------*/
+
+/**
+  * @brief  build the keys of the configuration of an application
+  * @param  appli_code   code of owner of configuration
+  * @param  key          (out) "setup.NN.v", its first FEEPROM_UTILS_KEY_LENGTH
+  *                      bytes are the key of the data
+  * @retval none
+  */
+static void feeprom_utils_kv_key(setup_appli_code_t appli_code, uint8_t *key)
+{
+  (void)memcpy(key, "setup.00.v", FEEPROM_UTILS_VERSION_KEY_LENGTH);
+  key[6] = (uint8_t)((uint32_t)'0' + (((uint32_t)appli_code / 10U) % 10U));
+  key[7] = (uint8_t)((uint32_t)'0' + ((uint32_t)appli_code % 10U));
+}
+
+/**
+  * @brief  remove the configuration of an application from the store
+  * @param  appli_code   code of owner of configuration
+  * @retval status (0=>erase OK / 1=>erase error)
+  */
+static uint32_t feeprom_utils_kv_erase(setup_appli_code_t appli_code)
+{
+  uint8_t key[FEEPROM_UTILS_VERSION_KEY_LENGTH];
+  uint32_t ret;
+
+  feeprom_utils_kv_key(appli_code, key);
+
+  ret = 1U;
+  /* the version first: the data alone is never used */
+  if (FEEPROM_UTILS_KV_DELETE(key, FEEPROM_UTILS_VERSION_KEY_LENGTH)
+      && FEEPROM_UTILS_KV_DELETE(key, FEEPROM_UTILS_KEY_LENGTH))
+  {
+    ret = 0U;
+  }
+  return ret;
+}
+
+/* External functions BEGIN */
+
+/**
+  * @brief  erase a setup configuration in flash
+  * @param  appli_code          owner code of application to erase
+  * @param  appli_version       format version of configuration
+  * @retval status (0=>erase OK / 1=>erase error)
+  */
+uint32_t feeprom_utils_setup_erase(setup_appli_code_t appli_code, setup_appli_version_t version_appli)
+{
+  (void)version_appli;
+  return feeprom_utils_kv_erase(appli_code);
+}
+
+/**
+  * @brief  erase all flash pages of the configuration flash bank
+  * @param  none
+  * @retval none
+  */
+void feeprom_utils_flash_erase_all(void)
+{
+  uint32_t i;
+  for (i = (uint32_t)1; i < (uint32_t)SETUP_APPLI_MAX ; i++)
+  {
+    (void)feeprom_utils_kv_erase((setup_appli_code_t)i);
+  }
+}
+
+/**
+  * @brief  save the configuration of an application in flash
+  * @param  appli_code               code of owner of configuration
+  * @param  appli_version            format version of configuration
+  * @param  config_addr              config addr to save
+  * @param  config_size              config size to save
+  * @retval number of bytes saved (0 on error)
+  */
+uint32_t feeprom_utils_save_config_flash(setup_appli_code_t appli_code, setup_appli_version_t appli_version,
+                                         uint8_t *config_addr, uint32_t config_size)
+{
+  uint8_t  key[FEEPROM_UTILS_VERSION_KEY_LENGTH];
+  uint32_t count;
+
+  feeprom_utils_kv_key(appli_code, key);
+
+  count = 0U;
+  /* an unchanged config or version costs no flash operation */
+  if (FEEPROM_UTILS_KV_SET(key, FEEPROM_UTILS_KEY_LENGTH, config_addr, config_size)
+      && FEEPROM_UTILS_KV_SET(key, FEEPROM_UTILS_VERSION_KEY_LENGTH, &appli_version, sizeof(appli_version)))
+  {
+    count = config_size + (uint32_t)sizeof(appli_version);
+  }
+  else
+  {
+    PRINT_SETUP("Save config fail: key/value store error")
+  }
+  return count;
+}
+
+/**
+  * @brief  get the configuration of an application (appli_code) in flash
+  * @param  appli_code               code of owner of configuration
+  * @param  appli_version            format version of configuration
+  * @param  config_addr              (out) config addr, valid until the next save
+  * @param  config_size              (out) config size
+  * @retval status                   0=>OK / 1=>KO
+  */
+uint32_t feeprom_utils_read_config_flash(setup_appli_code_t appli_code, setup_appli_version_t appli_version,
+                                         uint8_t **config_addr, uint32_t *config_size)
+{
+  uint8_t  key[FEEPROM_UTILS_VERSION_KEY_LENGTH];
+  setup_appli_version_t version;
+  const uint8_t *value;
+  size_t   length;
+  uint32_t ret;
+  const uint8_t  *label;
+
+  feeprom_utils_kv_key(appli_code, key);
+
+  ret = 1U;
+  if (FEEPROM_UTILS_KV_READ(key, FEEPROM_UTILS_VERSION_KEY_LENGTH, &version, sizeof(version), &length))
+  {
+    if (version != appli_version)
+    {
+      label = setup_get_label_appli(appli_code);
+      PRINT_SETUP("WARNING : \"%s\"  FEEPROM Config Bad format : config erased\r\n", label)
+
+      /* Invalid version of config for this application => the config is removed */
+      (void)feeprom_utils_kv_erase(appli_code);
+    }
+    else if (FEEPROM_UTILS_KV_GET(key, FEEPROM_UTILS_KEY_LENGTH, &value, &length))
+    {
+      *config_size = (uint32_t)length;
+      *config_addr = (uint8_t *)value;
+      ret = 0U;
+    }
+    else
+    {
+      /* no data */
+    }
+  }
+
+  return ret;
+}
+
+/**
+  * @brief  copy the configurations saved one per flash page, before the
+  *         key/value store was used, to the store
+  * @param  import   stores one value of the key/value store
+  * @param  context  context of import
+  * @retval status (0=>import OK / 1=>import error)
+  * @note   the pages below FEEPROM_UTILS_LAST_PAGE_ADDR must still be readable:
+  *         called once, when the key/value store is formatted
+  */
+uint32_t feeprom_utils_import_legacy(feeprom_utils_kv_import_t import, void *context)
+{
+  const setup_config_t *setup_config;
+  uint8_t  key[FEEPROM_UTILS_VERSION_KEY_LENGTH];
+  setup_appli_version_t version;
+  uint32_t i;
+  uint32_t ret;
+
+  ret = 0U;
+  for (i = 0U; (i < (uint32_t)FEEPROM_UTILS_APPLI_MAX) && (ret == 0U); i++)
+  {
+    setup_config = (const setup_config_t *)(FEEPROM_UTILS_LAST_PAGE_ADDR - (i * FLASH_PAGE_SIZE));
+    /* the header was programmed after the data: a page with a header is complete */
+    if ((setup_config->header.config_magic1 == FEEPROM_UTILS_MAGIC_FLASH_CONFIG1)
+        && (setup_config->header.config_magic2 == FEEPROM_UTILS_MAGIC_FLASH_CONFIG2)
+        && (setup_config->header.appli_code < (uint16_t)SETUP_APPLI_MAX)
+        && (setup_config->header.config_size <= (FLASH_PAGE_SIZE - sizeof(setup_config_header_t))))
+    {
+      feeprom_utils_kv_key((setup_appli_code_t)setup_config->header.appli_code, key);
+      version = setup_config->header.appli_version;
+
+      /* the data first, as feeprom_utils_save_config_flash() */
+      if ((import(context, key, FEEPROM_UTILS_KEY_LENGTH,
+                  &setup_config->data, setup_config->header.config_size) != 0U)
+          || (import(context, key, FEEPROM_UTILS_VERSION_KEY_LENGTH,
+                     (const uint8_t *)&version, (uint32_t)sizeof(version)) != 0U))
+      {
+        PRINT_SETUP("Import config fail: key/value store error")
+        ret = 1U;
+      }
+    }
+  }
+  return ret;
+}
+
+/* External functions END */
+
+#else /* FEEPROM_UTILS_KV_STORE == 1 */
 /* Private function prototypes -----------------------------------------------*/
 static uint32_t feeprom_utils_flash_write(uint8_t *data_addr, uint8_t *flash_addr, uint32_t Lenght,
                                           uint32_t *byteswritten);
@@ -376,6 +579,7 @@ uint32_t feeprom_utils_read_config_flash(setup_appli_code_t appli_code, setup_ap
 }
 
 /* External functions END */
+#endif /* FEEPROM_UTILS_KV_STORE == 1 */
 
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
 
@@ -36,6 +36,8 @@
 #include "main.h"
 #include "stdint.h"
 #include "stdarg.h"
+#include <stdio.h>
+#include <string.h>
 
 /* FreeRTOS includes. */
 #include "FreeRTOS.h"
@@ -48,6 +50,23 @@
 #include "aws_clientcredential.h"
 #include "aws_dev_mode_key_provisioning.h"
 
+/* Meter bus. */
+#include "semphr.h"
+#include "modbus_rtu.h"
+#include "meter_poll.h"
+#include "meter_journal.h"
+#include "tls_session_store.h"
+#include "kv_store.h"
+#include "iot_tls.h"
+#include "flash.h"
+#include "aws_ota_pal_boot.h"
+#include "path_trace.h"
+#include "plf_config.h"
+#include "feeprom_utils.h"
+#if ( USE_CMD_CONSOLE == 1 )
+    #include "cmd.h"
+#endif
+
 /* Application version info. */
 #include "aws_application_version.h"
 
@@ -76,6 +95,9 @@ RTC_HandleTypeDef xHrtc;
 RNG_HandleTypeDef xHrng;
 UART_HandleTypeDef xConsoleUart;
 
+/* Handle of the meter reading task, notified when a reply frame arrives. */
+static TaskHandle_t xWaterMeterTaskHandle = NULL;
+
 /* Private variables ---------------------------------------------------------*/
 
 /* Private function prototypes -----------------------------------------------*/
@@ -101,6 +123,27 @@ static void prvInitializeHeap( void );
 
 static void prvWaterMeterTask( void * pArgument );
 
+/**
+ * @brief Opens the TLS session store and registers it with the TLS library.
+ */
+static void prvTlsSessionStoreInit( void );
+
+/**
+ * @brief Opens the key/value store of the PKCS #11 objects and the settings.
+ */
+static void prvKVStoreInit( void );
+
+/**
+ * @brief Starts the publish path latency trace and its console command.
+ */
+static void prvPathTraceInit( void );
+
+/**
+ * @brief Meter bus interrupt hooks, see prvModbusInit().
+ */
+static void prvModbusBitTick( void );
+static void prvModbusEdge( void );
+
 /**
  * @brief Application runtime entry point.
  */
@@ -115,6 +158,10 @@ int main( void )
                             mainLOGGING_TASK_PRIORITY,
                             mainLOGGING_MESSAGE_QUEUE_LENGTH );
 
+    /* Roll back an update that reset during its trial run, before the
+     * application data regions are used. */
+    OTA_PAL_BootCheck();
+
     /* Start the scheduler.  Initialization that requires the OS to be running,
      * including the BG96 initialization, is performed in the RTOS daemon task
      * startup hook. */
@@ -126,6 +173,8 @@ int main( void )
 
 void vApplicationDaemonTaskStartupHook( void )
 {
+    /* The PKCS #11 objects are kept in the key/value store. */
+    prvKVStoreInit();
 
     /* A simple example to demonstrate key and certificate provisioning in
      * micro-controller flash using PKCS#11 interface. This should be replaced
@@ -134,16 +183,23 @@ void vApplicationDaemonTaskStartupHook( void )
 
     if( SYSTEM_Init() == pdPASS )
     {
+        /* Sessions saved before the reset are offered by the first
+         * connections of the demos. */
+        prvTlsSessionStoreInit();
+
     	/* Static initialization of the BG96 modem */
     	BG96_Modem_Init();
 
     	/* Starts the BG96 modem tasks before running the demos */
         BG96_Modem_Start();
 
+        /* Time the stages of the publishes of the demos. */
+        prvPathTraceInit();
+
         /* Start demos. */
     	DEMO_RUNNER_RunDemos();
 
-		xTaskCreate(prvWaterMeterTask, "WATER METER", configMINIMAL_STACK_SIZE*8, NULL, tskIDLE_PRIORITY+1, NULL);
+		xTaskCreate(prvWaterMeterTask, "WATER METER", configMINIMAL_STACK_SIZE*8, NULL, tskIDLE_PRIORITY+1, &xWaterMeterTaskHandle);
     }
 
 }
@@ -599,6 +655,10 @@ void HAL_GPIO_EXTI_Callback( uint16_t GPIO_Pin )
 {
     switch( GPIO_Pin )
     {
+        case GPIO_PIN_7:
+            prvModbusEdge();
+            break;
+
         default:
             break;
     }
@@ -631,246 +691,870 @@ void HAL_TIM_PeriodElapsedCallback( TIM_HandleTypeDef * htim )
     {
         HAL_IncTick();
     }
+    else if( htim->Instance == TIM7 )
+    {
+        prvModbusBitTick();
+    }
 }
 /*-----------------------------------------------------------*/
 
-#define BIT_DELAY (828)
+/*
+ * Modbus RTU master on PG7/PG8.
+ *
+ * The meter bus is driven as a complementary pair on PG7/PG8 and sampled on
+ * PG7. TIM7 produces one interrupt per bit period: it clocks the request out
+ * and, once the bus is released, polls the receive decoder so that the
+ * silent interval closing the reply is detected. Receive edges are taken
+ * from EXTI line 7 and time-stamped with TIM2 running at 1 MHz. The task
+ * only sleeps on its notification while the reply is on the wire, so the
+ * scheduler and the modem UART keep running during a meter read.
+ */
+#define mainMODBUS_BAUD_RATE              ( 9600UL )
+#define mainMODBUS_STAMP_HZ               ( 1000000UL )
+#define mainMODBUS_REPLY_TIMEOUT_MS       ( 200 )
+#define mainMODBUS_STAMP()                ( xModbusStampTimer.Instance->CNT )
+
+static ModbusRtuLine_t xModbusLine;
+static TIM_HandleTypeDef xModbusStampTimer;
+static TIM_HandleTypeDef xModbusBitTimer;
 
-void sw_uart_putc(uint8_t b) {
-    GPIOG->BRR = (uint32_t) GPIO_PIN_7;
-    GPIOG->BSRR = (uint32_t) GPIO_PIN_8;
-    for (int d=0; d<BIT_DELAY; d++) asm("nop");
+/* Start of the Modbus transaction in progress, see PathTrace_Begin(). */
+static uint32_t ulMeterReadStart;
 
-    for (int i=0; i<8; i++) {
-        if (b & 0x01) {
-            GPIOG->BSRR = (uint32_t) GPIO_PIN_7;
-            GPIOG->BRR = (uint32_t) GPIO_PIN_8;
-        } else {
-            GPIOG->BRR = (uint32_t) GPIO_PIN_7;
-            GPIOG->BSRR = (uint32_t) GPIO_PIN_8;
+static void prvModbusDrive( int32_t lLevel )
+{
+    if( lLevel != 0 )
+    {
+        GPIOG->BSRR = ( uint32_t ) GPIO_PIN_7;
+        GPIOG->BRR = ( uint32_t ) GPIO_PIN_8;
+    }
+    else
+    {
+        GPIOG->BRR = ( uint32_t ) GPIO_PIN_7;
+        GPIOG->BSRR = ( uint32_t ) GPIO_PIN_8;
+    }
+}
+
+/* Take the bus: PG7/PG8 as outputs, receive edges masked. */
+static void prvModbusAcquire( void )
+{
+    EXTI->IMR1 &= ~EXTI_IMR1_IM7;
+    prvModbusDrive( 1 );
+    GPIOG->MODER = ( GPIOG->MODER & ~( GPIO_MODER_MODER7 | GPIO_MODER_MODER8 ) ) |
+                   GPIO_MODER_MODER7_0 | GPIO_MODER_MODER8_0;
+}
+
+/* Release the bus: PG7/PG8 as inputs, receive edges unmasked. */
+static void prvModbusRelease( void )
+{
+    GPIOG->MODER &= ~( GPIO_MODER_MODER7 | GPIO_MODER_MODER8 );
+    EXTI->PR1 = EXTI_PR1_PIF7;
+    EXTI->IMR1 |= EXTI_IMR1_IM7;
+}
+
+static void prvModbusFrameReceived( void * pvContext )
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    ( void ) pvContext;
+
+    if( xWaterMeterTaskHandle != NULL )
+    {
+        vTaskNotifyGiveFromISR( xWaterMeterTaskHandle, &xHigherPriorityTaskWoken );
+    }
+
+    portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
+
+static void prvModbusBitTick( void )
+{
+    int32_t lLevel;
+
+    if( xModbusLine.xTxBusy == true )
+    {
+        lLevel = ModbusRtu_TxNextLevel( &xModbusLine );
+
+        if( lLevel != modbusrtuTX_DONE )
+        {
+            prvModbusDrive( lLevel );
+        }
+        else
+        {
+            prvModbusRelease();
+            ModbusRtu_RxArm( &xModbusLine, mainMODBUS_STAMP() );
         }
-        for (int d=0; d<BIT_DELAY; d++) asm("nop");
-        b >>= 1;
     }
+    else
+    {
+        ModbusRtu_RxPoll( &xModbusLine, mainMODBUS_STAMP() );
+    }
+}
+
+static void prvModbusEdge( void )
+{
+    uint32_t ulStamp = mainMODBUS_STAMP();
 
-    GPIOG->BSRR = (uint32_t) GPIO_PIN_7;
-    GPIOG->BRR = (uint32_t) GPIO_PIN_8;
-    for (int d=0; d<BIT_DELAY; d++) asm("nop");
+    ModbusRtu_RxEdge( &xModbusLine,
+                      ulStamp,
+                      ( GPIOG->IDR & GPIO_PIN_7 ) != 0 ? 1U : 0U );
 }
 
-void sw_uart_send(uint8_t* buf, uint32_t length) {
-    for (int i=0; i<length; i++) sw_uart_putc(buf[i]);
+static void prvModbusInit( void )
+{
+    GPIO_InitTypeDef xGpio = { 0 };
+
+    ModbusRtu_Init( &xModbusLine,
+                    mainMODBUS_STAMP_HZ,
+                    mainMODBUS_BAUD_RATE,
+                    prvModbusFrameReceived,
+                    NULL );
+
+    /* Free running 32-bit time base for edge stamps. */
+    __HAL_RCC_TIM2_CLK_ENABLE();
+    xModbusStampTimer.Instance = TIM2;
+    xModbusStampTimer.Init.Prescaler = ( HAL_RCC_GetPCLK1Freq() / mainMODBUS_STAMP_HZ ) - 1UL;
+    xModbusStampTimer.Init.CounterMode = TIM_COUNTERMODE_UP;
+    xModbusStampTimer.Init.Period = 0xFFFFFFFFUL;
+    xModbusStampTimer.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    xModbusStampTimer.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+    HAL_TIM_Base_Init( &xModbusStampTimer );
+    HAL_TIM_Base_Start( &xModbusStampTimer );
+
+    /* One update interrupt per bit period. */
+    __HAL_RCC_TIM7_CLK_ENABLE();
+    xModbusBitTimer.Instance = TIM7;
+    xModbusBitTimer.Init.Prescaler = 0;
+    xModbusBitTimer.Init.CounterMode = TIM_COUNTERMODE_UP;
+    xModbusBitTimer.Init.Period = ( HAL_RCC_GetPCLK1Freq() / mainMODBUS_BAUD_RATE ) - 1UL;
+    xModbusBitTimer.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+    HAL_TIM_Base_Init( &xModbusBitTimer );
+    HAL_NVIC_SetPriority( TIM7_IRQn, 5, 0 );
+    HAL_NVIC_EnableIRQ( TIM7_IRQn );
+
+    /* PG7 routed to EXTI line 7 on both edges, masked until the bus is
+     * released. */
+    xGpio.Pin = GPIO_PIN_7;
+    xGpio.Mode = GPIO_MODE_IT_RISING_FALLING;
+    xGpio.Pull = GPIO_NOPULL;
+    HAL_GPIO_Init( GPIOG, &xGpio );
+    EXTI->IMR1 &= ~EXTI_IMR1_IM7;
+
+    prvModbusAcquire();
+}
+
+/* Start clocking a request out. The reply is collected by the line engine
+ * once the bus is released. */
+static void prvModbusSend( void * pvContext,
+                           const uint8_t * pucRequest,
+                           size_t xLength )
+{
+    ( void ) pvContext;
+
+    ulMeterReadStart = PathTrace_Begin();
+    HAL_TIM_Base_Stop_IT( &xModbusBitTimer );
+    prvModbusAcquire();
+    ModbusRtu_TxStart( &xModbusLine, pucRequest, xLength );
+    __HAL_TIM_SET_COUNTER( &xModbusBitTimer, 0 );
+    HAL_TIM_Base_Start_IT( &xModbusBitTimer );
 }
 
-uint8_t sw_uart_getc() {
-    volatile uint8_t c = 0;
-    volatile uint16_t b[10];
-    memset(b, 0, 20);
+void TIM7_IRQHandler( void )
+{
+    HAL_TIM_IRQHandler( &xModbusBitTimer );
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Meter polling.
+ *
+ * The stations listed below are read back to back once per period. The
+ * table of the last round is published as a snapshot for the MQTT side.
+ */
+#define mainMETER_POLL_PERIOD_MS          ( 10000 )
+#define mainMETER_REGISTER_START          ( 0x0504 )
+#define mainMETER_REGISTER_COUNT          ( 0x14 )
+#define mainMETER_MAX_RETRIES             ( 2 )
+#define mainMETER_TURNAROUND_MS           ( 0 )
+
+static const uint8_t ucMeterStations[] = { 1 };
+
+static MeterPoll_t xMeterPoll;
+static MeterPollSnapshot_t xMeterSnapshot;
+static SemaphoreHandle_t xMeterSnapshotMutex = NULL;
 
-    while((GPIOG->IDR & GPIO_PIN_7) != 0); // wait start bit
+/* Last round handed to the MQTT side, which then owns its delivery. */
+static uint32_t ulMeterRoundTaken = 0;
 
-    for (int i=0; i<310; i++) b[0] += ((GPIOG->IDR & GPIO_PIN_7)) == 0 ? 0 : 1;
-    for (int i=0; i<324; i++) b[1] += ((GPIOG->IDR & GPIO_PIN_7)) == 0 ? 0 : 1;
-    for (int i=0; i<324; i++) b[2] += ((GPIOG->IDR & GPIO_PIN_7)) == 0 ? 0 : 1;
-    for (int i=0; i<324; i++) b[3] += ((GPIOG->IDR & GPIO_PIN_7)) == 0 ? 0 : 1;
-    for (int i=0; i<324; i++) b[4] += ((GPIOG->IDR & GPIO_PIN_7)) == 0 ? 0 : 1;
-    for (int i=0; i<324; i++) b[5] += ((GPIOG->IDR & GPIO_PIN_7)) == 0 ? 0 : 1;
-    for (int i=0; i<324; i++) b[6] += ((GPIOG->IDR & GPIO_PIN_7)) == 0 ? 0 : 1;
-    for (int i=0; i<324; i++) b[7] += ((GPIOG->IDR & GPIO_PIN_7)) == 0 ? 0 : 1;
-    for (int i=0; i<324; i++) b[8] += ((GPIOG->IDR & GPIO_PIN_7)) == 0 ? 0 : 1;
+/* Wall clock offset set by the MQTT demo once the time is known. */
+extern uint32_t epoch;
 
-    c = 0;
-    for (int i=0; i<8; i++) {
-        if (b[i+1] > 160) c |= 1<<i;
+bool WaterMeter_GetSnapshot( MeterPollSnapshot_t * pxSnapshot )
+{
+    bool xResult = false;
+
+    if( ( xMeterSnapshotMutex != NULL ) &&
+        ( xSemaphoreTake( xMeterSnapshotMutex, portMAX_DELAY ) == pdTRUE ) )
+    {
+        if( xMeterSnapshot.ulRound != 0U )
+        {
+            *pxSnapshot = xMeterSnapshot;
+            ulMeterRoundTaken = xMeterSnapshot.ulRound;
+            xResult = true;
+        }
+
+        xSemaphoreGive( xMeterSnapshotMutex );
     }
 
-    while((GPIOG->IDR & GPIO_PIN_7) == 0); // wait stop bit
+    return xResult;
+}
+
+/*
+ * Meter journal.
+ *
+ * Readings that could not be published live are appended to a journal in the
+ * internal flash (see _smeter_journal in the linker script) and stay there
+ * until the MQTT side confirms their delivery. Those are the rounds the MQTT
+ * side never took, e.g. while the cellular link is down, and the readings it
+ * took but could not get acknowledged.
+ */
+extern uint8_t _smeter_journal[];
+extern uint8_t _emeter_journal[];
+
+/* Flash callbacks of the application data regions, the context is the start
+ * of the region. */
+static int32_t prvFlashErase( void * pvContext,
+                              uint32_t ulOffset );
+static int32_t prvFlashProgram( void * pvContext,
+                                uint32_t ulOffset,
+                                const void * pvData,
+                                uint32_t ulLength );
+
+static MeterJournalFlash_t xMeterJournalFlash =
+{
+    .ulPageSize = FLASH_PAGE_SIZE,
+    .xErase     = prvFlashErase,
+    .xProgram   = prvFlashProgram,
+    .pvContext  = _smeter_journal
+};
+
+static MeterJournal_t xMeterJournal;
+static SemaphoreHandle_t xMeterJournalMutex = NULL;
+
+static int32_t prvFlashErase( void * pvContext,
+                              uint32_t ulOffset )
+{
+    int lResult;
+
+    /* The journal, the TLS session store and the KV store erases share the
+     * flash controller with FLASH_update() and the OTA bank. */
+    FLASH_access_take();
+    /* Leaves the flash unlocked. */
+    lResult = FLASH_unlock_erase( ( uint32_t ) pvContext + ulOffset, FLASH_PAGE_SIZE );
+    HAL_FLASH_Lock();
+    FLASH_access_give();
+
+    return ( lResult == 0 ) ? 0 : -1;
+}
+
+static int32_t prvFlashProgram( void * pvContext,
+                                uint32_t ulOffset,
+                                const void * pvData,
+                                uint32_t ulLength )
+{
+    int lResult;
+
+    FLASH_access_take();
+    HAL_FLASH_Unlock();
+    __HAL_FLASH_CLEAR_FLAG( FLASH_FLAG_ALL_ERRORS );
+    lResult = FLASH_write_at( ( uint32_t ) pvContext + ulOffset, ( uint64_t * ) pvData, ulLength );
+    HAL_FLASH_Lock();
+    FLASH_access_give();
+
+    return ( lResult == 0 ) ? 0 : -1;
+}
+
+size_t WaterMeter_JournalPeek( MeterJournalEntry_t * pxEntries,
+                               size_t xMaxEntries )
+{
+    size_t xCount = 0;
+
+    if( ( xMeterJournalMutex != NULL ) &&
+        ( xSemaphoreTake( xMeterJournalMutex, portMAX_DELAY ) == pdTRUE ) )
+    {
+        xCount = MeterJournal_Peek( &xMeterJournal, pxEntries, xMaxEntries );
+        xSemaphoreGive( xMeterJournalMutex );
+    }
 
-    return c;
+    return xCount;
 }
 
-int sw_uart_recv(uint8_t *buf, uint32_t len)
+bool WaterMeter_JournalAppend( const MeterReading_t * pxReading,
+                               uint32_t ulTimestamp )
 {
-    volatile uint32_t m = GPIOG->MODER;
-    GPIOG->MODER &= ~(GPIO_MODER_MODER7 | GPIO_MODER_MODER8);
+    bool xResult = false;
 
-    for (int i=0; i<len; i++)
+    if( ( xMeterJournalMutex != NULL ) &&
+        ( xSemaphoreTake( xMeterJournalMutex, portMAX_DELAY ) == pdTRUE ) )
     {
-        buf[i] = sw_uart_getc();
+        xResult = MeterJournal_Append( &xMeterJournal, ulTimestamp, pxReading );
+        xSemaphoreGive( xMeterJournalMutex );
     }
 
-    GPIOG->MODER = m;
+    return xResult;
+}
+
+void WaterMeter_JournalConsume( uint32_t ulLastSequence )
+{
+    if( ( xMeterJournalMutex != NULL ) &&
+        ( xSemaphoreTake( xMeterJournalMutex, portMAX_DELAY ) == pdTRUE ) )
+    {
+        ( void ) MeterJournal_Consume( &xMeterJournal, ulLastSequence );
+        xSemaphoreGive( xMeterJournalMutex );
+    }
+}
+
+/*
+ * TLS session store.
+ *
+ * The sessions negotiated with the servers are kept in the internal flash
+ * (see _stls_session in the linker script), so that a connection opened after
+ * a reset or a modem power cycle resumes the previous session instead of
+ * running a full handshake.
+ */
+extern uint8_t _stls_session[];
+extern uint8_t _etls_session[];
+
+#if tlssessionstoreMAX_SESSION_LENGTH < tlsSESSION_MAX_LENGTH
+    #error "The TLS session store is smaller than the sessions of the TLS library"
+#endif
+
+static BaseType_t prvTlsSessionLoad( void * pvContext,
+                                     const char * pcEndpoint,
+                                     unsigned char * pucSession,
+                                     size_t * pxSessionLength );
+static BaseType_t prvTlsSessionSave( void * pvContext,
+                                     const char * pcEndpoint,
+                                     const unsigned char * pucSession,
+                                     size_t xSessionLength );
+
+static TlsSessionFlash_t xTlsSessionFlash =
+{
+    .ulPageSize = FLASH_PAGE_SIZE,
+    .xErase     = prvFlashErase,
+    .xProgram   = prvFlashProgram,
+    .pvContext  = _stls_session
+};
+
+static const TLSSessionStore_t xTlsSessionInterface =
+{
+    .xLoad     = prvTlsSessionLoad,
+    .xSave     = prvTlsSessionSave,
+    .pvContext = NULL
+};
+
+static TlsSessionStore_t xTlsSessionStore;
+static SemaphoreHandle_t xTlsSessionMutex = NULL;
+
+static BaseType_t prvTlsSessionLoad( void * pvContext,
+                                     const char * pcEndpoint,
+                                     unsigned char * pucSession,
+                                     size_t * pxSessionLength )
+{
+    bool xFound;
+
+    ( void ) pvContext;
+
+    xSemaphoreTake( xTlsSessionMutex, portMAX_DELAY );
+    xFound = TlsSessionStore_Load( &xTlsSessionStore, pcEndpoint, pucSession, pxSessionLength );
+    xSemaphoreGive( xTlsSessionMutex );
+
+    return ( xFound == true ) ? pdTRUE : pdFALSE;
+}
+
+static BaseType_t prvTlsSessionSave( void * pvContext,
+                                     const char * pcEndpoint,
+                                     const unsigned char * pucSession,
+                                     size_t xSessionLength )
+{
+    bool xSaved;
+
+    ( void ) pvContext;
+
+    xSemaphoreTake( xTlsSessionMutex, portMAX_DELAY );
+    xSaved = TlsSessionStore_Save( &xTlsSessionStore, pcEndpoint, pucSession, xSessionLength );
+    xSemaphoreGive( xTlsSessionMutex );
+
+    if( xSaved == false )
+    {
+        configPRINTF( ( "tls session store: save failed\r\n" ) );
+    }
 
-    return len;
+    return ( xSaved == true ) ? pdTRUE : pdFALSE;
 }
 
-#define CRC_LENGTH (2)
-#define RESPONSE_LENGTH (45)
+static void prvTlsSessionStoreInit( void )
+{
+    xTlsSessionFlash.pucBase = _stls_session;
+    xTlsSessionFlash.ulPageCount = ( uint32_t ) ( _etls_session - _stls_session ) / FLASH_PAGE_SIZE;
+    xTlsSessionMutex = xSemaphoreCreateMutex();
 
-static const int TABLE[] = {
-    0x0000, 0xc0c1, 0xc181, 0x0140, 0xc301, 0x03c0, 0x0280, 0xc241,
-    0xc601, 0x06c0, 0x0780, 0xc741, 0x0500, 0xc5c1, 0xc481, 0x0440,
-    0xcc01, 0x0cc0, 0x0d80, 0xcd41, 0x0f00, 0xcfc1, 0xce81, 0x0e40,
-    0x0a00, 0xcac1, 0xcb81, 0x0b40, 0xc901, 0x09c0, 0x0880, 0xc841,
-    0xd801, 0x18c0, 0x1980, 0xd941, 0x1b00, 0xdbc1, 0xda81, 0x1a40,
-    0x1e00, 0xdec1, 0xdf81, 0x1f40, 0xdd01, 0x1dc0, 0x1c80, 0xdc41,
-    0x1400, 0xd4c1, 0xd581, 0x1540, 0xd701, 0x17c0, 0x1680, 0xd641,
-    0xd201, 0x12c0, 0x1380, 0xd341, 0x1100, 0xd1c1, 0xd081, 0x1040,
-    0xf001, 0x30c0, 0x3180, 0xf141, 0x3300, 0xf3c1, 0xf281, 0x3240,
-    0x3600, 0xf6c1, 0xf781, 0x3740, 0xf501, 0x35c0, 0x3480, 0xf441,
-    0x3c00, 0xfcc1, 0xfd81, 0x3d40, 0xff01, 0x3fc0, 0x3e80, 0xfe41,
-    0xfa01, 0x3ac0, 0x3b80, 0xfb41, 0x3900, 0xf9c1, 0xf881, 0x3840,
-    0x2800, 0xe8c1, 0xe981, 0x2940, 0xeb01, 0x2bc0, 0x2a80, 0xea41,
-    0xee01, 0x2ec0, 0x2f80, 0xef41, 0x2d00, 0xedc1, 0xec81, 0x2c40,
-    0xe401, 0x24c0, 0x2580, 0xe541, 0x2700, 0xe7c1, 0xe681, 0x2640,
-    0x2200, 0xe2c1, 0xe381, 0x2340, 0xe101, 0x21c0, 0x2080, 0xe041,
-    0xa001, 0x60c0, 0x6180, 0xa141, 0x6300, 0xa3c1, 0xa281, 0x6240,
-    0x6600, 0xa6c1, 0xa781, 0x6740, 0xa501, 0x65c0, 0x6480, 0xa441,
-    0x6c00, 0xacc1, 0xad81, 0x6d40, 0xaf01, 0x6fc0, 0x6e80, 0xae41,
-    0xaa01, 0x6ac0, 0x6b80, 0xab41, 0x6900, 0xa9c1, 0xa881, 0x6840,
-    0x7800, 0xb8c1, 0xb981, 0x7940, 0xbb01, 0x7bc0, 0x7a80, 0xba41,
-    0xbe01, 0x7ec0, 0x7f80, 0xbf41, 0x7d00, 0xbdc1, 0xbc81, 0x7c40,
-    0xb401, 0x74c0, 0x7580, 0xb541, 0x7700, 0xb7c1, 0xb681, 0x7640,
-    0x7200, 0xb2c1, 0xb381, 0x7340, 0xb101, 0x71c0, 0x7080, 0xb041,
-    0x5000, 0x90c1, 0x9181, 0x5140, 0x9301, 0x53c0, 0x5280, 0x9241,
-    0x9601, 0x56c0, 0x5780, 0x9741, 0x5500, 0x95c1, 0x9481, 0x5440,
-    0x9c01, 0x5cc0, 0x5d80, 0x9d41, 0x5f00, 0x9fc1, 0x9e81, 0x5e40,
-    0x5a00, 0x9ac1, 0x9b81, 0x5b40, 0x9901, 0x59c0, 0x5880, 0x9841,
-    0x8801, 0x48c0, 0x4980, 0x8941, 0x4b00, 0x8bc1, 0x8a81, 0x4a40,
-    0x4e00, 0x8ec1, 0x8f81, 0x4f40, 0x8d01, 0x4dc0, 0x4c80, 0x8c41,
-    0x4400, 0x84c1, 0x8581, 0x4540, 0x8701, 0x47c0, 0x4680, 0x8641,
-    0x8201, 0x42c0, 0x4380, 0x8341, 0x4100, 0x81c1, 0x8081, 0x4040
+    if( ( xTlsSessionMutex != NULL ) &&
+        ( TlsSessionStore_Open( &xTlsSessionStore, &xTlsSessionFlash ) == true ) )
+    {
+        TLS_SetSessionStore( &xTlsSessionInterface );
+    }
+    else
+    {
+        configPRINTF( ( "tls session store: disabled\r\n" ) );
+    }
+}
+
+/*
+ * Key/value store.
+ *
+ * The PKCS #11 objects and the setup settings of the cellular middleware
+ * are kept in the internal flash (see _skv_store in the linker script).
+ * The records are programmed through the FLASH_update_cached() page cache.
+ *
+ * The setup pages written by the former feeprom format, below
+ * FLASH_LAST_PAGE_ADDR, lie in sector 1 of the region and are imported when
+ * the store is formatted. The former PKCS #11 section was never placed in
+ * flash by this board's linker script: there are no objects to import.
+ */
+extern uint8_t _skv_store[];
+extern uint8_t _ekv_store[];
+
+static int32_t prvKVStoreErase( void * pvContext,
+                                uint32_t ulOffset );
+static int32_t prvKVStoreProgram( void * pvContext,
+                                  uint32_t ulOffset,
+                                  const void * pvData,
+                                  uint32_t ulLength );
+static int32_t prvKVStoreSync( void * pvContext );
+static int32_t prvKVStoreImport( KVStore_t * pxStore,
+                                 void * pvContext );
+static uint32_t prvKVStoreTimestamp( void );
+
+static KVStoreFlash_t xKVStoreFlash =
+{
+    .ulPageSize = FLASH_PAGE_SIZE,
+    .xErase     = prvKVStoreErase,
+    .xProgram   = prvKVStoreProgram,
+    .xSync      = prvKVStoreSync,
+    .xImport    = prvKVStoreImport,
+    .xTimestamp = prvKVStoreTimestamp,
+    .pvContext  = _skv_store
 };
 
-void updateCrc(uint8_t* bytes, int offset, int length, int crcIndex)
+static KVStore_t xKVStore;
+static SemaphoreHandle_t xKVStoreMutex = NULL;
+
+static int32_t prvKVStoreErase( void * pvContext,
+                                uint32_t ulOffset )
 {
-    if ((NULL == bytes) || (length == 0) || (crcIndex < 0)) return;
-    int checksum = 0xFFFF;
-    for (int i = offset; i < offset + length; i++) {
-        checksum = (checksum >> 8) ^ TABLE[((checksum) ^ ((int) bytes[i] & 0xff)) & 0xff];
+    int32_t lResult = -1;
+
+    /* The erase bypasses the page cache, which must not hold the page. */
+    FLASH_access_take();
+
+    if( FLASH_sync() == 0 )
+    {
+        lResult = prvFlashErase( pvContext, ulOffset );
     }
-    long value = checksum;
-    bytes[crcIndex] = (uint8_t) ((value & 0x000000ff));
-    bytes[crcIndex + 1] = (uint8_t) ((value & 0x0000ff00) >> 8);
+
+    FLASH_access_give();
+
+    return lResult;
 }
 
-void compose(uint8_t* request, size_t request_len, uint8_t stationNo)
+static int32_t prvKVStoreProgram( void * pvContext,
+                                  uint32_t ulOffset,
+                                  const void * pvData,
+                                  uint32_t ulLength )
 {
-    request[0] = stationNo;
-    request[1] = 0x03;
-    request[2] = 0x05;
-    request[3] = 0x04;
-    request[4] = 0x00;
-    request[5] = 0x14;
-    request[6] = 0x00;
-    request[7] = 0x00;
-    updateCrc(request, 0, request_len - CRC_LENGTH, request_len - CRC_LENGTH);
+    int lResult;
+
+    lResult = FLASH_update_cached( ( uint32_t ) pvContext + ulOffset, pvData, ulLength );
+
+    return ( lResult == ( int ) ulLength ) ? 0 : -1;
 }
 
-uint8_t water_meter_station_id = 0;
-uint64_t water_meter_meter_id = 0;
-uint64_t water_meter_amount = 0;
-uint8_t water_meter_amount_place = 0;
-uint64_t water_meter_reverse_amount = 0;
-uint8_t water_meter_reverse_amount_place = 0;
-uint16_t water_meter_lday = 0;
-uint16_t water_meter_nday = 0;
-uint16_t water_meter_oday = 0;
-uint16_t water_meter_uday = 0;
-uint16_t water_meter_hday = 0;
-uint16_t water_meter_bday = 0;
-uint16_t water_meter_op = 0;
+static int32_t prvKVStoreSync( void * pvContext )
+{
+    ( void ) pvContext;
 
-uint8_t water_meter_rawdata[45] = {0};
+    return ( FLASH_sync() == 0 ) ? 0 : -1;
+}
 
-#include <semphr.h>
+static uint32_t prvKVStoreImportSetup( void * pvContext,
+                                       const uint8_t * pucKey,
+                                       uint32_t ulKeyLength,
+                                       const uint8_t * pucValue,
+                                       uint32_t ulLength )
+{
+    return ( KVStore_Set( ( KVStore_t * ) pvContext, pucKey, ulKeyLength, pucValue, ulLength ) == true ) ? 0U : 1U;
+}
+
+static int32_t prvKVStoreImport( KVStore_t * pxStore,
+                                 void * pvContext )
+{
+    uint32_t ulSetupStart = FEEPROM_UTILS_LAST_PAGE_ADDR - ( ( FEEPROM_UTILS_APPLI_MAX - 1U ) * FLASH_PAGE_SIZE );
+    uint32_t ulSector1 = ( uint32_t ) _skv_store + pxStore->ulSectorSize;
+    int32_t lResult = 0;
 
-SemaphoreHandle_t sema_water_meter = NULL;
+    ( void ) pvContext;
+
+    /* Sector 0 is erased by now, no setup page may lie in it. */
+    if( ( ulSetupStart < ulSector1 ) &&
+        ( ( FEEPROM_UTILS_LAST_PAGE_ADDR + FLASH_PAGE_SIZE ) > ( uint32_t ) _skv_store ) )
+    {
+        lResult = -1;
+    }
+    else if( feeprom_utils_import_legacy( prvKVStoreImportSetup, pxStore ) != 0U )
+    {
+        lResult = -1;
+    }
+
+    if( lResult != 0 )
+    {
+        configPRINTF( ( "kv store: setup import failed\r\n" ) );
+    }
 
-void water_meter_read()
+    return lResult;
+}
+
+static uint32_t prvKVStoreTimestamp( void )
 {
-    xSemaphoreGive(sema_water_meter);
-    vTaskDelay(300);
+    return DWT->CYCCNT;
 }
 
-static void prvWaterMeterTask( void * pArgument )
+bool WaterMeter_KVGet( const void * pvKey,
+                       size_t xKeyLength,
+                       const uint8_t ** ppucValue,
+                       size_t * pxLength )
 {
-#if 0
-req:
-    01 03 05 04 00 14 04 C8
-rsp:
-    00 01 03 28 F0 01 05 00
-    00 00 00 01 06 00 FF E0
-    00 00 00 00 00 00 00 68
-    08 FF F8 59 47 4D 34 00
-    FE 00 FE 00 FF 00 FF 00
-    00 00 00 00 00
-#endif
-    uint8_t req[8] = { 0x01, 0x03, 0x05, 0x04, 0x00, 0x14, 0x04, 0xC8 };
-    uint8_t rsp[45];
+    bool xFound = false;
+
+    if( ( xKVStoreMutex != NULL ) &&
+        ( xSemaphoreTake( xKVStoreMutex, portMAX_DELAY ) == pdTRUE ) )
+    {
+        xFound = KVStore_Get( &xKVStore, pvKey, xKeyLength, ppucValue, pxLength );
+        xSemaphoreGive( xKVStoreMutex );
+    }
+
+    return xFound;
+}
+
+bool WaterMeter_KVRead( const void * pvKey,
+                        size_t xKeyLength,
+                        void * pvValue,
+                        size_t xMaxLength,
+                        size_t * pxLength )
+{
+    bool xRead = false;
+
+    if( ( xKVStoreMutex != NULL ) &&
+        ( xSemaphoreTake( xKVStoreMutex, portMAX_DELAY ) == pdTRUE ) )
+    {
+        xRead = KVStore_Read( &xKVStore, pvKey, xKeyLength, pvValue, xMaxLength, pxLength );
+        xSemaphoreGive( xKVStoreMutex );
+    }
+
+    return xRead;
+}
+
+bool WaterMeter_KVSet( const void * pvKey,
+                       size_t xKeyLength,
+                       const void * pvValue,
+                       size_t xValueLength )
+{
+    bool xSet = false;
+
+    if( ( xKVStoreMutex != NULL ) &&
+        ( xSemaphoreTake( xKVStoreMutex, portMAX_DELAY ) == pdTRUE ) )
+    {
+        xSet = KVStore_Set( &xKVStore, pvKey, xKeyLength, pvValue, xValueLength );
+        xSemaphoreGive( xKVStoreMutex );
+    }
+
+    if( xSet == false )
+    {
+        configPRINTF( ( "kv store: save failed\r\n" ) );
+    }
+
+    return xSet;
+}
+
+bool WaterMeter_KVDelete( const void * pvKey,
+                          size_t xKeyLength )
+{
+    bool xDeleted = false;
+
+    if( ( xKVStoreMutex != NULL ) &&
+        ( xSemaphoreTake( xKVStoreMutex, portMAX_DELAY ) == pdTRUE ) )
+    {
+        xDeleted = KVStore_Delete( &xKVStore, pvKey, xKeyLength );
+        xSemaphoreGive( xKVStoreMutex );
+    }
+
+    return xDeleted;
+}
 
-    HAL_GPIO_WritePin(GPIOG, GPIO_PIN_7, GPIO_PIN_SET);
+static void prvKVStoreInit( void )
+{
+    /* The collections are timed with the DWT cycle counter. */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 
-    vSemaphoreCreateBinary( sema_water_meter );
+    xKVStoreFlash.pucBase = _skv_store;
+    xKVStoreFlash.ulPageCount = ( uint32_t ) ( _ekv_store - _skv_store ) / FLASH_PAGE_SIZE;
+    xKVStoreFlash.ulTicksPerUs = SystemCoreClock / 1000000UL;
 
+    if( KVStore_Open( &xKVStore, &xKVStoreFlash ) == true )
+    {
+        xKVStoreMutex = xSemaphoreCreateMutex();
+    }
 
-    vTaskDelay(100);
-    while(1) {
-        xSemaphoreTake(sema_water_meter, portMAX_DELAY);
+    if( xKVStoreMutex == NULL )
+    {
+        configPRINTF( ( "kv store: disabled\r\n" ) );
+    }
+}
 
-        compose(req, sizeof(req), 1);
+/*
+ * Publish path latency.
+ *
+ * The stages are timed with the DWT cycle counter. The "latency" console
+ * command prints the p50 and p99 of each stage, "latency reset" clears them.
+ */
+static uint32_t prvPathTraceTimestamp( void )
+{
+    return DWT->CYCCNT;
+}
+
+#if ( USE_CMD_CONSOLE == 1 )
+    static cmd_status_t prvPathTraceCmd( uint8_t * pucCmdLine )
+    {
+        PathTraceReport_t xReport;
+        const char * pcArgument;
+        cmd_status_t xStatus = CMD_OK;
+        uint32_t i;
 
-        if (0) {
-            configPRINTF(("req: %02X %02X %02X %02X %02X %02X %02X %02X\r\n", req[0], req[1], req[2], req[3], req[4], req[5], req[6], req[7]));
+        ( void ) strtok( ( char * ) pucCmdLine, " \t" );
+        pcArgument = strtok( NULL, " \t" );
+
+        if( pcArgument == NULL )
+        {
+            configPRINTF( ( "%-16s %8s %10s %10s %10s\r\n", "stage", "count", "p50 us", "p99 us", "max us" ) );
+
+            for( i = 0; i < ( uint32_t ) PATH_TRACE_STAGE_COUNT; i++ )
+            {
+                PathTrace_Report( ( PathTraceStage_t ) i, &xReport );
+                configPRINTF( ( "%-16s %8u %10u %10u %10u\r\n",
+                                PathTrace_StageName( ( PathTraceStage_t ) i ),
+                                ( unsigned ) xReport.ulCount,
+                                ( unsigned ) xReport.ulP50Us,
+                                ( unsigned ) xReport.ulP99Us,
+                                ( unsigned ) xReport.ulMaxUs ) );
+            }
+        }
+        else if( strcmp( pcArgument, "reset" ) == 0 )
+        {
+            PathTrace_Reset();
+        }
+        else
+        {
+            CMD_print_help( ( uint8_t * ) "latency" );
+            configPRINTF( ( "latency          (p50/p99/max of each stage of the publish path)\r\n" ) );
+            configPRINTF( ( "latency reset    (clear the histograms)\r\n" ) );
+            xStatus = CMD_SYNTAX_ERROR;
         }
 
-        taskENTER_CRITICAL();
-        sw_uart_send(req, 8);
-        sw_uart_recv(rsp, 45);
-        taskEXIT_CRITICAL();
+        return xStatus;
+    }
 
-        if (0)
+    /* Wear and write back latency of the pages written by FLASH_update()
+     * and FLASH_update_cached(). */
+    static cmd_status_t prvFlashCmd( uint8_t * pucCmdLine )
+    {
+        FlashWriterPageStats_t xStats[ flashwriterTRACKED_PAGES + 1U ];
+        char cPage[ 12 ];
+        size_t xCount, i;
+
+        ( void ) pucCmdLine;
+        xCount = FLASH_update_stats( xStats, flashwriterTRACKED_PAGES + 1U );
+
+        configPRINTF( ( "%-10s %8s %8s %8s %10s %10s %10s\r\n", "page", "writes", "flushes", "erases", "dwords", "last us", "max us" ) );
+
+        for( i = 0; i < xCount; i++ )
         {
-            for (int i=0; i<45; i++) {
-                configPRINTF(("rsp[%d]: %02X\r\n", i, rsp[i]));
+            if( xStats[ i ].ulPage == flashwriterOTHER_PAGES )
+            {
+                ( void ) strcpy( cPage, "other" );
+            }
+            else
+            {
+                ( void ) snprintf( cPage, sizeof( cPage ), "0x%08x",
+                                   ( unsigned ) ( FLASH_BASE + ( xStats[ i ].ulPage * FLASH_PAGE_SIZE ) ) );
             }
+
+            configPRINTF( ( "%-10s %8u %8u %8u %10u %10u %10u\r\n",
+                            cPage,
+                            ( unsigned ) xStats[ i ].ulWrites,
+                            ( unsigned ) xStats[ i ].ulFlushes,
+                            ( unsigned ) xStats[ i ].ulErases,
+                            ( unsigned ) xStats[ i ].ulPrograms,
+                            ( unsigned ) xStats[ i ].ulLastFlushUs,
+                            ( unsigned ) xStats[ i ].ulMaxFlushUs ) );
         }
-        memcpy(water_meter_rawdata, rsp, 45);
-
-        water_meter_station_id = rsp[0];
-
-        water_meter_amount = rsp[8];
-        water_meter_amount = (water_meter_amount << 8) | (rsp[7]);
-        water_meter_amount = (water_meter_amount << 8) | (rsp[6]);
-        water_meter_amount = (water_meter_amount << 8) | (rsp[5]);
-        water_meter_amount = (water_meter_amount << 8) | (rsp[4]);
-        water_meter_amount = (water_meter_amount << 8) | (rsp[3]);
-
-        water_meter_amount_place = rsp[10];
-
-        water_meter_reverse_amount = rsp[16];
-        water_meter_reverse_amount = (water_meter_reverse_amount << 8) | (rsp[15]);
-        water_meter_reverse_amount = (water_meter_reverse_amount << 8) | (rsp[14]);
-        water_meter_reverse_amount = (water_meter_reverse_amount << 8) | (rsp[13]);
-        water_meter_reverse_amount = (water_meter_reverse_amount << 8) | (rsp[12]);
-        water_meter_reverse_amount = (water_meter_reverse_amount << 8) | (rsp[11]);
-
-        water_meter_reverse_amount_place = rsp[18];
-        water_meter_lday = (rsp[20] << 8) | (rsp[19]);
-        water_meter_nday = (rsp[22] << 8) | (rsp[21]);
-        water_meter_oday = (rsp[24] << 8) | (rsp[23]);
-        water_meter_uday = (rsp[26] << 8) | (rsp[25]);
-        water_meter_hday = (rsp[28] << 8) | (rsp[27]);
-        water_meter_bday = (rsp[30] << 8) | (rsp[29]);
-        water_meter_op = (rsp[33] << 8) | (rsp[31]);
-
-        water_meter_meter_id = rsp[42];
-        water_meter_meter_id = (water_meter_meter_id << 8) | (rsp[41]);
-        water_meter_meter_id = (water_meter_meter_id << 8) | (rsp[40]);
-        water_meter_meter_id = (water_meter_meter_id << 8) | (rsp[39]);
-        water_meter_meter_id = (water_meter_meter_id << 8) | (rsp[38]);
-        water_meter_meter_id = (water_meter_meter_id << 8) | (rsp[37]);
-    }
-
-    while(1) vTaskDelay(1000);
+
+        return CMD_OK;
+    }
+#endif /* if ( USE_CMD_CONSOLE == 1 ) */
+
+static void prvPathTraceInit( void )
+{
+    PathTraceConfig_t xConfig = { 0 };
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    xConfig.xTimestamp = prvPathTraceTimestamp;
+    xConfig.ulTicksPerUs = SystemCoreClock / 1000000UL;
+    xConfig.xEnterCritical = vPortEnterCritical;
+    xConfig.xExitCritical = vPortExitCritical;
+    PathTrace_Init( &xConfig );
+
+    #if ( USE_CMD_CONSOLE == 1 )
+        CMD_Declare( ( uint8_t * ) "latency", prvPathTraceCmd, ( uint8_t * ) "publish path latency" );
+        CMD_Declare( ( uint8_t * ) "flash", prvFlashCmd, ( uint8_t * ) "flash page wear and write latency" );
+    #endif
+}
+
+/* Append the readings of the snapshot about to be replaced if the MQTT side
+ * never took it. Only this task writes the snapshot, so it is read unlocked. */
+static void prvJournalRound( void )
+{
+    const MeterPollStation_t * pxStation;
+    uint32_t ulTimestamp;
+    uint32_t ulTaken;
+    uint8_t i;
+
+    xSemaphoreTake( xMeterSnapshotMutex, portMAX_DELAY );
+    ulTaken = ulMeterRoundTaken;
+    xSemaphoreGive( xMeterSnapshotMutex );
+
+    if( ( xMeterSnapshot.ulRound == 0U ) || ( xMeterSnapshot.ulRound == ulTaken ) )
+    {
+        return;
+    }
+
+    xSemaphoreTake( xMeterJournalMutex, portMAX_DELAY );
+
+    for( i = 0; i < xMeterSnapshot.ucStationCount; i++ )
+    {
+        pxStation = &xMeterSnapshot.xStations[ i ];
+
+        if( ( pxStation->ucStatus == METER_POLL_OK ) &&
+            ( pxStation->ulRound == xMeterSnapshot.ulRound ) )
+        {
+            /* Readings taken before the time is known are stored without one. */
+            ulTimestamp = ( epoch != 0U ) ? ( epoch + ( pxStation->ulReadTime / configTICK_RATE_HZ ) ) : 0U;
+
+            if( MeterJournal_Append( &xMeterJournal, ulTimestamp, &pxStation->xReading ) == false )
+            {
+                configPRINTF( ( "meter journal: append failed\r\n" ) );
+            }
+        }
+    }
+
+    xSemaphoreGive( xMeterJournalMutex );
+}
+
+static void prvWaterMeterTask( void * pArgument )
+{
+    uint8_t ucFrame[ modbusrtuMAX_FRAME_LENGTH ];
+    MeterPollConfig_t xConfig = { 0 };
+    TickType_t xLastRound;
+    uint32_t ulDelay;
+    size_t xLength;
+    bool xJournalOpen;
+
+    ( void ) pArgument;
+
+    xMeterSnapshotMutex = xSemaphoreCreateMutex();
+    configASSERT( xMeterSnapshotMutex != NULL );
+
+    xMeterJournalFlash.pucBase = _smeter_journal;
+    xMeterJournalFlash.ulPageCount = ( uint32_t ) ( _emeter_journal - _smeter_journal ) / FLASH_PAGE_SIZE;
+    xJournalOpen = MeterJournal_Open( &xMeterJournal, &xMeterJournalFlash );
+    configASSERT( xJournalOpen == true );
+    xMeterJournalMutex = xSemaphoreCreateMutex();
+    configASSERT( xMeterJournalMutex != NULL );
+
+    configPRINTF( ( "meter journal: %u readings pending\r\n",
+                    ( unsigned ) MeterJournal_Pending( &xMeterJournal ) ) );
+
+    prvModbusInit();
+
+    xConfig.usStartRegister = mainMETER_REGISTER_START;
+    xConfig.usRegisterCount = mainMETER_REGISTER_COUNT;
+    xConfig.ulReplyTimeout = pdMS_TO_TICKS( mainMODBUS_REPLY_TIMEOUT_MS );
+    xConfig.ulTurnaround = pdMS_TO_TICKS( mainMETER_TURNAROUND_MS );
+    xConfig.ucMaxRetries = mainMETER_MAX_RETRIES;
+    xConfig.xSend = prvModbusSend;
+    xConfig.pvSendContext = NULL;
+    MeterPoll_Init( &xMeterPoll, &xConfig, ucMeterStations, sizeof( ucMeterStations ) );
+
+    vTaskDelay( pdMS_TO_TICKS( 100 ) );
+    xLastRound = xTaskGetTickCount();
+
+    for( ; ; )
+    {
+        ( void ) ulTaskNotifyTake( pdTRUE, 0 );
+        ModbusRtu_FrameFlush( &xModbusLine );
+
+        MeterPoll_StartRound( &xMeterPoll, xTaskGetTickCount() );
+        ulDelay = MeterPoll_Step( &xMeterPoll, xTaskGetTickCount(), NULL, 0 );
+
+        while( ulDelay != meterpollROUND_COMPLETE )
+        {
+            /* One notification is given per frame committed to the ring. */
+            if( ulTaskNotifyTake( pdFALSE, ( TickType_t ) ulDelay ) != 0 )
+            {
+                xLength = ModbusRtu_FrameGet( &xModbusLine, ucFrame, sizeof( ucFrame ) );
+
+                if( xLength > 0 )
+                {
+                    PathTrace_End( PATH_TRACE_METER_READ, ulMeterReadStart );
+                }
+
+                ulDelay = MeterPoll_Step( &xMeterPoll,
+                                          xTaskGetTickCount(),
+                                          ( xLength > 0 ) ? ucFrame : NULL,
+                                          xLength );
+            }
+            else
+            {
+                ulDelay = MeterPoll_Step( &xMeterPoll, xTaskGetTickCount(), NULL, 0 );
+            }
+        }
+
+        HAL_TIM_Base_Stop_IT( &xModbusBitTimer );
+        prvModbusAcquire();
+
+        prvJournalRound();
+
+        xSemaphoreTake( xMeterSnapshotMutex, portMAX_DELAY );
+        MeterPoll_Snapshot( &xMeterPoll, &xMeterSnapshot );
+        xSemaphoreGive( xMeterSnapshotMutex );
+
+        configPRINTF( ( "meter round %u: %u stations in %u ms\r\n",
+                        ( unsigned ) xMeterSnapshot.ulRound,
+                        ( unsigned ) xMeterSnapshot.ucStationCount,
+                        ( unsigned ) xMeterSnapshot.ulRoundTime ) );
+
+        vTaskDelayUntil( &xLastRound, pdMS_TO_TICKS( mainMETER_POLL_PERIOD_MS ) );
+    }
 }
@@ -53,6 +53,13 @@ extern "C" {
 #define IPC_USE_SPI  (0U) /* SPI NOT SUPPORTED YET */
 #define IPC_USE_I2C  (0U) /* I2C NOT SUPPORTED YET */
 
+/* UART reception: circular DMA delivering blocks on idle line, half and full buffer events,
+ * instead of one interrupt per char. DMA buffer size must cover the chars received during
+ * one interrupt latency at the modem baud rate.
+ */
+#define IPC_USE_RX_DMA        (1U)
+#define IPC_RXDMA_BUFFER_SIZE ((uint16_t) 512U)
+
 /* Debug flags */
 #define DBG_IPC_RX_FIFO  (0U)             /* additional debug infos */
 #define DBG_QUEUE_SIZE ((uint16_t) 1000U) /* debug message history depth */
@@ -76,11 +76,34 @@ and every COM_SOCKETS_STATISTIC_PERIOD value in min.
 */
 #define COM_SOCKETS_STATISTIC_PERIOD (0U) /* in min. */
 
+/* If COM_SOCKETS_SND_COALESCING activated then for USE_SOCKETS_TYPE == USE_SOCKETS_MODEM
+   data sent with COM_MSG_MORE flag are gathered, up to the modem maximum send size,
+   and sent to the modem by the next send without COM_MSG_MORE or before the next receive */
+#if !defined COM_SOCKETS_SND_COALESCING
+#define COM_SOCKETS_SND_COALESCING    (1U) /* 0: not activated, 1: activated */
+#endif /* !defined COM_SOCKETS_SND_COALESCING */
+
+/* Latency trace points of com_send_ip_modem and of each low level send
+   recorded in the publish path histograms (see path_trace.h) */
+#include "path_trace.h"
+#define COM_SOCKETS_TRACE_BEGIN()            PathTrace_Begin()
+#define COM_SOCKETS_TRACE_END(stage, start)  PathTrace_End(PATH_TRACE_ ## stage, (start))
+
 /* FLASH config mapping */
 #define FEEPROM_UTILS_FLASH_USED      (1)
 #define FEEPROM_UTILS_LAST_PAGE_ADDR  (FLASH_LAST_PAGE_ADDR)
 #define FEEPROM_UTILS_APPLI_MAX       5
 
+/* Setup configurations saved in the board key/value store (see kv_store.h)
+   instead of one flash page per application. The pages, in the upper half of
+   the store region, are imported when the store is formatted */
+#include "kv_store.h"
+#define FEEPROM_UTILS_KV_STORE        (1)
+#define FEEPROM_UTILS_KV_GET(key, key_len, value, len)             WaterMeter_KVGet((key), (key_len), (value), (len))
+#define FEEPROM_UTILS_KV_READ(key, key_len, value, max_len, len)   WaterMeter_KVRead((key), (key_len), (value), (max_len), (len))
+#define FEEPROM_UTILS_KV_SET(key, key_len, value, len)             WaterMeter_KVSet((key), (key_len), (value), (len))
+#define FEEPROM_UTILS_KV_DELETE(key, key_len)                      WaterMeter_KVDelete((key), (key_len))
+
 /* behaviour at boot selection */
 #define USE_BOOT_BEHAVIOUR_CONFIG     0  /* 0: automatic boot - 1: boot behaviour selection by boot menu */
 #define USE_MODEM_VOUCHER             0  /* 0: voucher management not included - 1: voucher management included */
@@ -41,6 +41,7 @@ extern "C" {
 #define DC_MEMS_THREAD_PRIO                osPriorityNormal
 #define DC_EMUL_THREAD_PRIO                osPriorityNormal
 #define ATCORE_THREAD_STACK_PRIO           osPriorityNormal
+#define ATCMD_THREAD_PRIO                  osPriorityNormal
 #define CELLULAR_SERVICE_THREAD_PRIO       osPriorityNormal
 #define NIFMAN_THREAD_PRIO                 osPriorityNormal
 #define CTRL_THREAD_PRIO                   osPriorityAboveNormal
@@ -74,6 +75,7 @@ extern "C" {
 #define FREERTOS_IDLE_THREAD_STACK_SIZE     (128U)
 
 #define ATCORE_THREAD_STACK_SIZE            (384U)
+#define ATCMD_THREAD_STACK_SIZE             (512U)
 #define CELLULAR_SERVICE_THREAD_STACK_SIZE  (512U)
 #define NIFMAN_THREAD_STACK_SIZE            (384U)
 
@@ -145,6 +147,7 @@ extern "C" {
 /* ========================*/
 
 #define USED_ATCORE_THREAD_STACK_SIZE            ATCORE_THREAD_STACK_SIZE
+#define USED_ATCMD_THREAD_STACK_SIZE             ATCMD_THREAD_STACK_SIZE
 #define USED_CELLULAR_SERVICE_THREAD_STACK_SIZE  CELLULAR_SERVICE_THREAD_STACK_SIZE
 #define USED_NIFMAN_THREAD_STACK_SIZE            NIFMAN_THREAD_STACK_SIZE
 #define USED_DEFAULT_THREAD_STACK_SIZE           DEFAULT_THREAD_STACK_SIZE
@@ -152,6 +155,7 @@ extern "C" {
 #define USED_FREERTOS_IDLE_THREAD_STACK_SIZE     FREERTOS_IDLE_THREAD_STACK_SIZE
 
 #define USED_ATCORE_THREAD            1
+#define USED_ATCMD_THREAD             1
 #define USED_CELLULAR_SERVICE_THREAD  1
 #define USED_NIFMAN_THREAD            1
 #define USED_DEFAULT_THREAD           1
@@ -270,6 +274,7 @@ extern "C" {
            +USED_PPPOSIF_CLIENT_THREAD_STACK_SIZE       \
            +USED_BOARD_BUTTONS_THREAD_STACK_SIZE        \
            +USED_ATCORE_THREAD_STACK_SIZE               \
+           +USED_ATCMD_THREAD_STACK_SIZE                \
            +USED_CELLULAR_SERVICE_THREAD_STACK_SIZE     \
            +USED_NIFMAN_THREAD_STACK_SIZE               \
            +USED_DC_MEMS_THREAD_STACK_SIZE              \
@@ -291,6 +296,7 @@ extern "C" {
             +USED_PPPOSIF_CLIENT_THREAD        \
             +USED_BOARD_BUTTONS_THREAD         \
             +USED_ATCORE_THREAD                \
+            +USED_ATCMD_THREAD                 \
             +USED_CELLULAR_SERVICE_THREAD      \
             +USED_NIFMAN_THREAD                \
             +USED_DC_MEMS_THREAD               \
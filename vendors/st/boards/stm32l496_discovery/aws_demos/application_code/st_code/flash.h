@@ -56,9 +56,16 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include <stdint.h>
+#include <stddef.h>
+#include "flash_writer.h"
 
+void FLASH_access_take(void);
+void FLASH_access_give(void);
 int FLASH_unlock_erase(uint32_t address, uint32_t len_bytes);
 int FLASH_update(uint32_t dst_addr, const void *data, uint32_t size);
+int FLASH_update_cached(uint32_t dst_addr, const void *data, uint32_t size);
+int FLASH_sync(void);
+size_t FLASH_update_stats(FlashWriterPageStats_t *stats, size_t max_stats);
 
 
 #if defined(STM32L475xx) || defined(STM32L496xx)
@@ -52,16 +52,118 @@
 #include <stdbool.h>
 
 #include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private defines -----------------------------------------------------------*/
-#define ROUND_DOWN(a,b) (((a) / (b)) * (b))
-#define MIN(a,b)        (((a) < (b)) ? (a) : (b))
+/* Private function prototypes -----------------------------------------------*/
+static int32_t prvFlashWriterErase(void *pvContext, uint32_t ulOffset);
+static int32_t prvFlashWriterProgram(void *pvContext, uint32_t ulOffset, const void *pvData, uint32_t ulLength);
+static uint32_t prvFlashWriterTimestamp(void);
+static bool prvFlashWriterInit(void);
 
 /* Private variables ----------------------------------------------------------*/
-/* Private function prototypes -----------------------------------------------*/
+/* Page cache of FLASH_update(), the region is the whole internal flash. */
+static FlashWriterFlash_t xFlashWriterFlash =
+{
+  .pucBase     = (const volatile uint8_t *) FLASH_BASE,
+  .ulPageSize  = FLASH_PAGE_SIZE,
+  .xErase      = prvFlashWriterErase,
+  .xProgram    = prvFlashWriterProgram,
+  .xTimestamp  = prvFlashWriterTimestamp,
+  .pvContext   = NULL
+};
+static FlashWriter_t xFlashWriter;
+static bool xFlashWriterReady = false;
+/* Serializes the unlock / erase / program / lock sequences of all the flash writers. */
+static StaticSemaphore_t xFlashAccessMutexBuffer;
+static SemaphoreHandle_t xFlashAccessMutex = NULL;
+
 /* Functions Definition ------------------------------------------------------*/
 
+/* Flash callbacks of the FLASH_update() page cache, offsets from FLASH_BASE. */
+static int32_t prvFlashWriterErase(void *pvContext, uint32_t ulOffset)
+{
+  int rc;
+
+  (void) pvContext;
+  FLASH_access_take();
+  /* Leaves the flash unlocked. */
+  rc = FLASH_unlock_erase(FLASH_BASE + ulOffset, FLASH_PAGE_SIZE);
+  HAL_FLASH_Lock();
+  FLASH_access_give();
+
+  return (rc == 0) ? 0 : -1;
+}
+
+static int32_t prvFlashWriterProgram(void *pvContext, uint32_t ulOffset, const void *pvData, uint32_t ulLength)
+{
+  int rc;
+
+  (void) pvContext;
+  FLASH_access_take();
+  HAL_FLASH_Unlock();
+  __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ALL_ERRORS);
+  rc = FLASH_write_at(FLASH_BASE + ulOffset, (uint64_t *) pvData, ulLength);
+  HAL_FLASH_Lock();
+  FLASH_access_give();
+
+  return (rc == 0) ? 0 : -1;
+}
+
+static uint32_t prvFlashWriterTimestamp(void)
+{
+  return DWT->CYCCNT;
+}
+
+static bool prvFlashWriterInit(void)
+{
+  if (xFlashWriterReady == false)
+  {
+    /* Time the write backs with the DWT cycle counter. */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    xFlashWriterFlash.ulTicksPerUs = SystemCoreClock / 1000000UL;
+    /* The bank size is read from a register. */
+    xFlashWriterFlash.ulPageCount = (2 * FLASH_BANK_SIZE) / FLASH_PAGE_SIZE;
+    xFlashWriterReady = FlashWriter_Init(&xFlashWriter, &xFlashWriterFlash);
+  }
+  return xFlashWriterReady;
+}
+
+/**
+  * @brief  Take the exclusive access to the FLASH controller.
+  * @note   The unlock state and the error flags are shared by all the writers:
+  *         each unlock / erase / program / lock sequence is run between
+  *         FLASH_access_take() and FLASH_access_give().
+  * @note   Recursive. No-op before the scheduler is started.
+  */
+void FLASH_access_take(void)
+{
+  if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED)
+  {
+    taskENTER_CRITICAL();
+    if (xFlashAccessMutex == NULL)
+    {
+      xFlashAccessMutex = xSemaphoreCreateRecursiveMutexStatic(&xFlashAccessMutexBuffer);
+    }
+    taskEXIT_CRITICAL();
+    (void) xSemaphoreTakeRecursive(xFlashAccessMutex, portMAX_DELAY);
+  }
+}
+
+/**
+  * @brief  Release the access taken by FLASH_access_take().
+  */
+void FLASH_access_give(void)
+{
+  if ((xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) && (xFlashAccessMutex != NULL))
+  {
+    (void) xSemaphoreGiveRecursive(xFlashAccessMutex);
+  }
+}
+
 /**
   * @brief  Erase FLASH memory page(s) at address.
   * @note   The range to erase shall not cross the bank boundary.
@@ -84,7 +186,7 @@ int FLASH_unlock_erase(uint32_t address, uint32_t len_bytes)
   EraseInit.TypeErase = FLASH_TYPEERASE_PAGES;
   
   EraseInit.Banks = FLASH_get_bank(address); 
-  if (EraseInit.Banks != FLASH_get_bank(address + len_bytes))
+  if (EraseInit.Banks != FLASH_get_bank(address + len_bytes - 1))
   {
     printf("Error: Cannot erase across FLASH banks.\n");
   }
@@ -226,6 +328,9 @@ int FLASH_get_pageInBank(uint32_t addr)
   * @brief  Update a chunk of the FLASH memory.
   * @note   The FLASH chunk must no cross a FLASH bank boundary.
   * @note   The source and destination buffers have no specific alignment constraints.
+  * @note   Only the double words which change are written. The page is erased
+  *         only when one of them was already programmed (see flash_writer.h).
+  * @note   The FLASH memory holds the update on return.
   * @param  In: dst_addr    Destination address in the FLASH memory.
   * @param  In: data        Source address. 
   * @param  In: size        Number of bytes to update.
@@ -234,56 +339,110 @@ int FLASH_get_pageInBank(uint32_t addr)
   */
 int FLASH_update(uint32_t dst_addr, const void *data, uint32_t size)
 {
-	int ret = 0;
-	int remaining = size;
-	uint8_t * src_addr = (uint8_t *) data;
+  int32_t ret = -1;
 
-	uint64_t * page_cache = pvPortMalloc(FLASH_PAGE_SIZE);
+  if ((prvFlashWriterInit() == true) && (dst_addr >= FLASH_BASE))
+  {
+    /* The page cache is shared by all the callers. */
+    FLASH_access_take();
+    ret = FlashWriter_Write(&xFlashWriter, dst_addr - FLASH_BASE, data, size);
+    if (ret == 0)
+    {
+      ret = FlashWriter_Flush(&xFlashWriter);
+    }
+    FLASH_access_give();
+    if (ret != 0)
+    {
+      printf("Error updating %lu bytes at 0x%08lx\n", size, dst_addr);
+    }
+  }
+  if (ret == 0)
+  {
+    return size;
+  }
+  else
+  {
+    return -1;
+  }
+}
 
-	if (page_cache != NULL)
-	{
-		__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ALL_ERRORS);
-
-		do {
-			uint32_t fl_addr = ROUND_DOWN(dst_addr, FLASH_PAGE_SIZE);
-			int fl_offset = dst_addr - fl_addr;
-			int len = MIN(FLASH_PAGE_SIZE - fl_offset, size);
-
-			/* Load from the flash into the cache */
-			memcpy(page_cache, (void *) fl_addr, FLASH_PAGE_SIZE);
-			/* Update the cache from the source */
-			memcpy((uint8_t *)page_cache + fl_offset, src_addr, len);
-			/* Erase the page, and write the cache */
-			ret = FLASH_unlock_erase(fl_addr, FLASH_PAGE_SIZE);
-			if (ret != 0)
-			{
-			  printf("Error erasing at 0x%08lx\n", fl_addr);
-			}
-			else
-			{
-			  ret = FLASH_write_at(fl_addr, page_cache, FLASH_PAGE_SIZE);
-			  if(ret != 0)
-			  {
-				printf("Error writing %lu bytes at 0x%08lx\n", FLASH_PAGE_SIZE, fl_addr);
-			  }
-			  else
-			  {
-				dst_addr += len;
-				src_addr += len;
-				remaining -= len;
-			  }
-			}
-		} while ((ret == 0) && (remaining > 0));
-		vPortFree(page_cache);
-	}
-	if (ret == 0)
-	{
-	  return size;
-	}
-	else
-	{
-	  return -1;
-	}
+/**
+  * @brief  Update a chunk of the FLASH memory through the page cache.
+  * @note   Same as FLASH_update(), except that the last page updated stays in
+  *         a RAM cache, so that consecutive updates of a page are merged: it
+  *         is written back when an update moves to another page, or by
+  *         FLASH_sync(). Until then, reading the FLASH memory returns the
+  *         previous content, and a reset loses the update.
+  * @param  In: dst_addr    Destination address in the FLASH memory.
+  * @param  In: data        Source address.
+  * @param  In: size        Number of bytes to update.
+  * @retval  0:  Success.
+  *         <0:  Failure.
+  */
+int FLASH_update_cached(uint32_t dst_addr, const void *data, uint32_t size)
+{
+  int32_t ret = -1;
+
+  if ((prvFlashWriterInit() == true) && (dst_addr >= FLASH_BASE))
+  {
+    FLASH_access_take();
+    ret = FlashWriter_Write(&xFlashWriter, dst_addr - FLASH_BASE, data, size);
+    FLASH_access_give();
+    if (ret != 0)
+    {
+      printf("Error updating %lu bytes at 0x%08lx\n", size, dst_addr);
+    }
+  }
+  if (ret == 0)
+  {
+    return size;
+  }
+  else
+  {
+    return -1;
+  }
+}
+
+/**
+  * @brief  Write back the page cached by FLASH_update_cached().
+  * @retval  0:  Success, or nothing to write.
+  *         <0:  Failure, the content of the cached page is undefined.
+  */
+int FLASH_sync(void)
+{
+  int32_t ret = 0;
+
+  if (xFlashWriterReady == true)
+  {
+    FLASH_access_take();
+    ret = FlashWriter_Flush(&xFlashWriter);
+    FLASH_access_give();
+    if (ret != 0)
+    {
+      printf("Error writing back the FLASH page cache\n");
+    }
+  }
+  return (ret == 0) ? 0 : -1;
+}
+
+/**
+  * @brief  Get the erase and program counters of the pages written by FLASH_update()
+  *         and FLASH_update_cached().
+  * @param  Out: stats     Counters, ulPage is the page index from FLASH_BASE.
+  * @param  In: max_stats  Number of entries of stats.
+  * @retval Number of entries written.
+  */
+size_t FLASH_update_stats(FlashWriterPageStats_t *stats, size_t max_stats)
+{
+  size_t count = 0;
+
+  if (xFlashWriterReady == true)
+  {
+    FLASH_access_take();
+    count = FlashWriter_PageStats(&xFlashWriter, stats, max_stats);
+    FLASH_access_give();
+  }
+  return count;
 }
 
 /**
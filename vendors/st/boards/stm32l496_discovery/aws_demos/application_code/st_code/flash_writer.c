@@ -0,0 +1,348 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file flash_writer.c
+ * @brief Write engine of the internal flash with a page cache.
+ */
+
+#include <string.h>
+
+#include "flash_writer.h"
+
+/* Content of an erased double word. */
+#define flashwriterERASED        ( 0xFFFFFFFFFFFFFFFFULL )
+
+/*-----------------------------------------------------------*/
+
+static uint64_t prvReadDoubleWord( const FlashWriter_t * pxWriter,
+                                   uint32_t ulOffset )
+{
+    const volatile uint8_t * pucFlash = pxWriter->pxFlash->pucBase + ulOffset;
+    uint8_t ucBytes[ flashwriterPROGRAM_UNIT ];
+    uint64_t ullValue;
+    size_t i;
+
+    for( i = 0; i < flashwriterPROGRAM_UNIT; i++ )
+    {
+        ucBytes[ i ] = pucFlash[ i ];
+    }
+
+    memcpy( &ullValue, ucBytes, sizeof( ullValue ) );
+
+    return ullValue;
+}
+
+/*-----------------------------------------------------------*/
+
+static FlashWriterPageStats_t * prvPageStats( FlashWriter_t * pxWriter,
+                                              uint32_t ulPage )
+{
+    FlashWriterPageStats_t * pxStats = NULL;
+    uint32_t i;
+
+    for( i = 0; ( i < pxWriter->ulTrackedPages ) && ( pxStats == NULL ); i++ )
+    {
+        if( pxWriter->xPages[ i ].ulPage == ulPage )
+        {
+            pxStats = &pxWriter->xPages[ i ];
+        }
+    }
+
+    if( pxStats == NULL )
+    {
+        if( pxWriter->ulTrackedPages < flashwriterTRACKED_PAGES )
+        {
+            pxStats = &pxWriter->xPages[ pxWriter->ulTrackedPages ];
+            pxWriter->ulTrackedPages++;
+            pxStats->ulPage = ulPage;
+        }
+        else
+        {
+            pxStats = &pxWriter->xPages[ flashwriterTRACKED_PAGES ];
+        }
+    }
+
+    return pxStats;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvTimestamp( const FlashWriter_t * pxWriter )
+{
+    return ( pxWriter->pxFlash->xTimestamp != NULL ) ? pxWriter->pxFlash->xTimestamp() : 0U;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvLoadPage( FlashWriter_t * pxWriter,
+                         uint32_t ulPage )
+{
+    const volatile uint8_t * pucPage = pxWriter->pxFlash->pucBase +
+                                       ( ulPage * pxWriter->pxFlash->ulPageSize );
+    uint8_t * pucCache = ( uint8_t * ) pxWriter->ullCache;
+    uint32_t i;
+
+    for( i = 0; i < pxWriter->pxFlash->ulPageSize; i++ )
+    {
+        pucCache[ i ] = pucPage[ i ];
+    }
+
+    pxWriter->ulCachedPage = ulPage;
+    pxWriter->ulDirtyStart = pxWriter->pxFlash->ulPageSize;
+    pxWriter->ulDirtyEnd = 0;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Program the double words of [ulFirst, ulLast) whose cached value differs
+ * from the flash, one program call per run of consecutive double words. */
+static int32_t prvProgramRuns( FlashWriter_t * pxWriter,
+                               FlashWriterPageStats_t * pxStats,
+                               uint32_t ulFirst,
+                               uint32_t ulLast )
+{
+    const FlashWriterFlash_t * pxFlash = pxWriter->pxFlash;
+    uint32_t ulPageOffset = pxWriter->ulCachedPage * pxFlash->ulPageSize;
+    uint32_t ulRunStart = ulFirst;
+    uint32_t i;
+    int32_t lResult = 0;
+
+    for( i = ulFirst; ( i <= ulLast ) && ( lResult == 0 ); i++ )
+    {
+        if( ( i < ulLast ) &&
+            ( pxWriter->ullCache[ i ] != prvReadDoubleWord( pxWriter, ulPageOffset + ( i * flashwriterPROGRAM_UNIT ) ) ) )
+        {
+            continue;
+        }
+
+        /* i ends the current run. */
+        if( i > ulRunStart )
+        {
+            lResult = pxFlash->xProgram( pxFlash->pvContext,
+                                         ulPageOffset + ( ulRunStart * flashwriterPROGRAM_UNIT ),
+                                         &pxWriter->ullCache[ ulRunStart ],
+                                         ( i - ulRunStart ) * flashwriterPROGRAM_UNIT );
+
+            if( lResult == 0 )
+            {
+                pxStats->ulPrograms += i - ulRunStart;
+            }
+        }
+
+        ulRunStart = i + 1U;
+    }
+
+    return lResult;
+}
+
+/*-----------------------------------------------------------*/
+
+bool FlashWriter_Init( FlashWriter_t * pxWriter,
+                       const FlashWriterFlash_t * pxFlash )
+{
+    bool xValid = false;
+
+    if( ( pxWriter != NULL ) &&
+        ( pxFlash != NULL ) &&
+        ( pxFlash->pucBase != NULL ) &&
+        ( pxFlash->xErase != NULL ) &&
+        ( pxFlash->xProgram != NULL ) &&
+        ( pxFlash->ulPageSize != 0U ) &&
+        ( pxFlash->ulPageSize <= flashwriterMAX_PAGE_SIZE ) &&
+        ( ( pxFlash->ulPageSize % flashwriterPROGRAM_UNIT ) == 0U ) &&
+        ( pxFlash->ulPageCount != 0U ) )
+    {
+        memset( pxWriter, 0, sizeof( *pxWriter ) );
+        pxWriter->pxFlash = pxFlash;
+        pxWriter->xPages[ flashwriterTRACKED_PAGES ].ulPage = flashwriterOTHER_PAGES;
+        xValid = true;
+    }
+
+    return xValid;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t FlashWriter_Write( FlashWriter_t * pxWriter,
+                           uint32_t ulOffset,
+                           const void * pvData,
+                           uint32_t ulLength )
+{
+    const FlashWriterFlash_t * pxFlash = pxWriter->pxFlash;
+    const uint8_t * pucData = pvData;
+    uint32_t ulRegionSize = pxFlash->ulPageSize * pxFlash->ulPageCount;
+    uint32_t ulPage, ulPageOffset, ulChunk;
+    int32_t lResult = 0;
+
+    if( ( ulOffset > ulRegionSize ) || ( ulLength > ( ulRegionSize - ulOffset ) ) )
+    {
+        lResult = -1;
+    }
+
+    while( ( lResult == 0 ) && ( ulLength > 0U ) )
+    {
+        ulPage = ulOffset / pxFlash->ulPageSize;
+        ulPageOffset = ulOffset % pxFlash->ulPageSize;
+        ulChunk = pxFlash->ulPageSize - ulPageOffset;
+
+        if( ulChunk > ulLength )
+        {
+            ulChunk = ulLength;
+        }
+
+        if( ( pxWriter->xDirty == false ) || ( pxWriter->ulCachedPage != ulPage ) )
+        {
+            lResult = FlashWriter_Flush( pxWriter );
+
+            if( lResult == 0 )
+            {
+                prvLoadPage( pxWriter, ulPage );
+            }
+        }
+
+        if( lResult == 0 )
+        {
+            memcpy( ( uint8_t * ) pxWriter->ullCache + ulPageOffset, pucData, ulChunk );
+            pxWriter->xDirty = true;
+
+            if( ulPageOffset < pxWriter->ulDirtyStart )
+            {
+                pxWriter->ulDirtyStart = ulPageOffset;
+            }
+
+            if( ( ulPageOffset + ulChunk ) > pxWriter->ulDirtyEnd )
+            {
+                pxWriter->ulDirtyEnd = ulPageOffset + ulChunk;
+            }
+
+            prvPageStats( pxWriter, ulPage )->ulWrites++;
+
+            ulOffset += ulChunk;
+            pucData += ulChunk;
+            ulLength -= ulChunk;
+        }
+    }
+
+    return lResult;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t FlashWriter_Flush( FlashWriter_t * pxWriter )
+{
+    const FlashWriterFlash_t * pxFlash = pxWriter->pxFlash;
+    FlashWriterPageStats_t * pxStats;
+    uint32_t ulPageOffset, ulFirst, ulLast, ulWords, i;
+    uint32_t ulStart, ulElapsedUs = 0;
+    bool xNeedErase = false;
+    int32_t lResult = 0;
+
+    if( pxWriter->xDirty == true )
+    {
+        ulStart = prvTimestamp( pxWriter );
+        pxStats = prvPageStats( pxWriter, pxWriter->ulCachedPage );
+        ulPageOffset = pxWriter->ulCachedPage * pxFlash->ulPageSize;
+        ulWords = pxFlash->ulPageSize / flashwriterPROGRAM_UNIT;
+
+        /* Double words covering the updated bytes. */
+        ulFirst = pxWriter->ulDirtyStart / flashwriterPROGRAM_UNIT;
+        ulLast = ( pxWriter->ulDirtyEnd + flashwriterPROGRAM_UNIT - 1U ) / flashwriterPROGRAM_UNIT;
+
+        /* A changed double word can be programmed in place only if it is
+         * still erased. */
+        for( i = ulFirst; ( i < ulLast ) && ( xNeedErase == false ); i++ )
+        {
+            uint64_t ullFlash = prvReadDoubleWord( pxWriter, ulPageOffset + ( i * flashwriterPROGRAM_UNIT ) );
+
+            xNeedErase = ( pxWriter->ullCache[ i ] != ullFlash ) && ( ullFlash != flashwriterERASED );
+        }
+
+        if( xNeedErase == true )
+        {
+            lResult = pxFlash->xErase( pxFlash->pvContext, ulPageOffset );
+
+            if( lResult == 0 )
+            {
+                pxStats->ulErases++;
+
+                /* The whole page is erased, the erased double words of the
+                 * cache are skipped by prvProgramRuns(). */
+                lResult = prvProgramRuns( pxWriter, pxStats, 0, ulWords );
+            }
+        }
+        else
+        {
+            lResult = prvProgramRuns( pxWriter, pxStats, ulFirst, ulLast );
+        }
+
+        if( lResult != 0 )
+        {
+            pxWriter->ulFlashErrors++;
+            lResult = -1;
+        }
+
+        if( pxFlash->ulTicksPerUs != 0U )
+        {
+            ulElapsedUs = ( prvTimestamp( pxWriter ) - ulStart ) / pxFlash->ulTicksPerUs;
+        }
+
+        pxStats->ulFlushes++;
+        pxStats->ulLastFlushUs = ulElapsedUs;
+
+        if( ulElapsedUs > pxStats->ulMaxFlushUs )
+        {
+            pxStats->ulMaxFlushUs = ulElapsedUs;
+        }
+
+        pxWriter->xDirty = false;
+    }
+
+    return lResult;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t FlashWriter_PageStats( const FlashWriter_t * pxWriter,
+                              FlashWriterPageStats_t * pxStats,
+                              size_t xMaxStats )
+{
+    size_t xCount = 0;
+    uint32_t i;
+
+    for( i = 0; ( i < pxWriter->ulTrackedPages ) && ( xCount < xMaxStats ); i++ )
+    {
+        pxStats[ xCount ] = pxWriter->xPages[ i ];
+        xCount++;
+    }
+
+    if( ( pxWriter->xPages[ flashwriterTRACKED_PAGES ].ulWrites != 0U ) && ( xCount < xMaxStats ) )
+    {
+        pxStats[ xCount ] = pxWriter->xPages[ flashwriterTRACKED_PAGES ];
+        xCount++;
+    }
+
+    return xCount;
+}
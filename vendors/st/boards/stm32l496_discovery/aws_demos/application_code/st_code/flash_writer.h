@@ -0,0 +1,186 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file flash_writer.h
+ * @brief Write engine of the internal flash with a page cache.
+ *
+ * Updates of arbitrary byte ranges are merged in a RAM copy of their page
+ * and written back by FlashWriter_Flush(), or when an update moves to
+ * another page. The write back only touches the double words that changed:
+ * when all of them are still erased they are programmed in place, and the
+ * page is erased and reprogrammed only when a programmed double word has to
+ * change. Rewriting identical data costs no flash operation at all.
+ *
+ * Erase and program counts, and the duration of the write backs, are kept
+ * per page so the wear and the latency of each page can be read back.
+ *
+ * The flash is reached through callbacks, the board binds them to
+ * flash_l4.c and the host tests to a RAM-backed model.
+ */
+
+#ifndef _FLASH_WRITER_H_
+#define _FLASH_WRITER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @brief Largest page size supported, the size of the page cache.
+ */
+#define flashwriterMAX_PAGE_SIZE      ( 2048U )
+
+/**
+ * @brief Smallest unit the flash can program, in bytes. A programmed unit
+ * can only be programmed again after an erase.
+ */
+#define flashwriterPROGRAM_UNIT       ( 8U )
+
+/**
+ * @brief Pages whose counters are kept individually. The counters of the
+ * pages written after the table is full are added to a shared entry.
+ */
+#define flashwriterTRACKED_PAGES      ( 8U )
+
+/**
+ * @brief Page index of the shared statistics entry.
+ */
+#define flashwriterOTHER_PAGES        ( 0xFFFFFFFFUL )
+
+/**
+ * @brief Flash access used by the writer.
+ *
+ * Offsets are relative to the start of the region, which is read directly
+ * through @p pucBase.
+ */
+typedef struct FlashWriterFlash
+{
+    const volatile uint8_t * pucBase; /**< Memory mapped region. */
+    uint32_t ulPageSize;              /**< Erase unit, at most flashwriterMAX_PAGE_SIZE. */
+    uint32_t ulPageCount;             /**< Pages in the region. */
+
+    /**
+     * @brief Erase one page, return 0 on success.
+     */
+    int32_t ( * xErase )( void * pvContext,
+                          uint32_t ulOffset );
+
+    /**
+     * @brief Program erased flash, return 0 on success. @p ulOffset and
+     * @p ulLength are multiples of flashwriterPROGRAM_UNIT and @p pvData is
+     * 8-byte aligned.
+     */
+    int32_t ( * xProgram )( void * pvContext,
+                            uint32_t ulOffset,
+                            const void * pvData,
+                            uint32_t ulLength );
+
+    /**
+     * @brief Free running counter timing the write backs, NULL to disable.
+     */
+    uint32_t ( * xTimestamp )( void );
+    uint32_t ulTicksPerUs; /**< Counter ticks per microsecond. */
+
+    void * pvContext;
+} FlashWriterFlash_t;
+
+/**
+ * @brief Counters of one page.
+ */
+typedef struct FlashWriterPageStats
+{
+    uint32_t ulPage;        /**< Page index, flashwriterOTHER_PAGES for the shared entry. */
+    uint32_t ulWrites;      /**< Updates merged in the cache. */
+    uint32_t ulFlushes;     /**< Write backs, including the ones with nothing to do. */
+    uint32_t ulErases;      /**< Page erases. */
+    uint32_t ulPrograms;    /**< Double words programmed. */
+    uint32_t ulLastFlushUs; /**< Duration of the last write back. */
+    uint32_t ulMaxFlushUs;  /**< Longest write back. */
+} FlashWriterPageStats_t;
+
+/**
+ * @brief Writer state.
+ */
+typedef struct FlashWriter
+{
+    const FlashWriterFlash_t * pxFlash;
+
+    /* Cached page, valid while xDirty is set. */
+    uint64_t ullCache[ flashwriterMAX_PAGE_SIZE / sizeof( uint64_t ) ];
+    uint32_t ulCachedPage;
+    bool xDirty;
+    uint32_t ulDirtyStart; /**< First updated byte of the page. */
+    uint32_t ulDirtyEnd;   /**< One past the last updated byte. */
+
+    uint32_t ulFlashErrors; /**< Failed erase or program operations. */
+    uint32_t ulTrackedPages;
+    FlashWriterPageStats_t xPages[ flashwriterTRACKED_PAGES + 1U ];
+} FlashWriter_t;
+
+/**
+ * @brief Initialize the writer.
+ *
+ * @return false if the flash description is invalid.
+ */
+bool FlashWriter_Init( FlashWriter_t * pxWriter,
+                       const FlashWriterFlash_t * pxFlash );
+
+/**
+ * @brief Update a range of the flash.
+ *
+ * The data is merged in the page cache. Moving to another page writes the
+ * cached one back first, so the pages reach the flash in the order they
+ * were updated.
+ *
+ * @return 0 on success, -1 if the range is outside the region or a write
+ * back failed.
+ */
+int32_t FlashWriter_Write( FlashWriter_t * pxWriter,
+                           uint32_t ulOffset,
+                           const void * pvData,
+                           uint32_t ulLength );
+
+/**
+ * @brief Write the cached page back to the flash.
+ *
+ * The updates of a failed write back are dropped, the page content is then
+ * undefined.
+ *
+ * @return 0 on success or if there is nothing to write, -1 on failure.
+ */
+int32_t FlashWriter_Flush( FlashWriter_t * pxWriter );
+
+/**
+ * @brief Copy the counters of the pages written so far, the shared entry
+ * last if it was used.
+ *
+ * @return Number of entries written to @p pxStats.
+ */
+size_t FlashWriter_PageStats( const FlashWriter_t * pxWriter,
+                              FlashWriterPageStats_t * pxStats,
+                              size_t xMaxStats );
+
+#endif /* _FLASH_WRITER_H_ */
@@ -0,0 +1,858 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file kv_store.c
+ * @brief Log-structured key/value store in internal flash.
+ */
+
+#include <string.h>
+
+#include "kv_store.h"
+
+/* "KVS1", marks a sector header. */
+#define kvstoreSECTOR_MAGIC              ( 0x3153564BUL )
+
+/* "KV" in the upper half of the first record word, the flags and the key
+ * length in the lower half. */
+#define kvstoreRECORD_MAGIC              ( 0x4B560000UL )
+#define kvstoreRECORD_MAGIC_MASK         ( 0xFFFF0000UL )
+#define kvstoreFLAG_DELETED              ( 0x0100UL )
+#define kvstoreKEY_LENGTH_MASK           ( 0x00FFUL )
+
+/* The CRC covers the first three header words, then the key and the value
+ * of a record. */
+#define kvstoreCRC_OFFSET                ( 12U )
+
+/* Sector and record headers share the same layout. */
+typedef struct KVStoreHeader
+{
+    uint32_t ulMagic;    /* Sector magic, or record magic, flags and key length. */
+    uint32_t ulHash;     /* Sector generation, or hash of the key. */
+    uint32_t ulLength;   /* Sector size, or value length. */
+    uint32_t ulCrc;
+} KVStoreHeader_t;
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvCrc32( uint32_t ulCrc,
+                          const volatile uint8_t * pucData,
+                          size_t xLength )
+{
+    /* CRC-32 (IEEE 802.3), four bits at a time. Start with 0. */
+    static const uint32_t ulTable[ 16 ] =
+    {
+        0x00000000UL, 0x1DB71064UL, 0x3B6E20C8UL, 0x26D930ACUL,
+        0x76DC4190UL, 0x6B6B51F4UL, 0x4DB26158UL, 0x5005713CUL,
+        0xEDB88320UL, 0xF00F9344UL, 0xD6D6A3E8UL, 0xCB61B38CUL,
+        0x9B64C2B0UL, 0x86D3D2D4UL, 0xA00AE278UL, 0xBDBDF21CUL
+    };
+    size_t i;
+
+    ulCrc = ~ulCrc;
+
+    for( i = 0; i < xLength; i++ )
+    {
+        ulCrc ^= pucData[ i ];
+        ulCrc = ( ulCrc >> 4 ) ^ ulTable[ ulCrc & 0x0FU ];
+        ulCrc = ( ulCrc >> 4 ) ^ ulTable[ ulCrc & 0x0FU ];
+    }
+
+    return ~ulCrc;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvHash( const uint8_t * pucKey,
+                         size_t xKeyLength )
+{
+    /* FNV-1a. */
+    uint32_t ulHash = 0x811C9DC5UL;
+    size_t i;
+
+    for( i = 0; i < xKeyLength; i++ )
+    {
+        ulHash ^= pucKey[ i ];
+        ulHash *= 0x01000193UL;
+    }
+
+    return ulHash;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvAlign( uint32_t ulLength )
+{
+    return ( ulLength + kvstorePROGRAM_UNIT - 1U ) & ~( kvstorePROGRAM_UNIT - 1U );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvRecordSize( uint32_t ulKeyLength,
+                               uint32_t ulValueLength )
+{
+    return kvstoreHEADER_LENGTH + prvAlign( ulKeyLength ) + prvAlign( ulValueLength );
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvSectorOffset( const KVStore_t * pxStore,
+                                 uint32_t ulSector )
+{
+    return ulSector * pxStore->ulSectorSize;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvReadHeader( const KVStore_t * pxStore,
+                           uint32_t ulOffset,
+                           KVStoreHeader_t * pxHeader )
+{
+    const volatile uint8_t * pucHeader = pxStore->pxFlash->pucBase + ulOffset;
+    size_t i;
+
+    for( i = 0; i < sizeof( *pxHeader ); i++ )
+    {
+        ( ( uint8_t * ) pxHeader )[ i ] = pucHeader[ i ];
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvIsErased( const KVStoreHeader_t * pxHeader )
+{
+    return ( pxHeader->ulMagic == 0xFFFFFFFFUL ) && ( pxHeader->ulHash == 0xFFFFFFFFUL ) &&
+           ( pxHeader->ulLength == 0xFFFFFFFFUL ) && ( pxHeader->ulCrc == 0xFFFFFFFFUL );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Generation of a valid sector, 0 if the sector has no valid header. */
+static uint32_t prvSectorGeneration( const KVStore_t * pxStore,
+                                     uint32_t ulSector )
+{
+    uint32_t ulOffset = prvSectorOffset( pxStore, ulSector );
+    KVStoreHeader_t xHeader;
+    uint32_t ulGeneration = 0;
+
+    prvReadHeader( pxStore, ulOffset, &xHeader );
+
+    if( ( xHeader.ulMagic == kvstoreSECTOR_MAGIC ) &&
+        ( xHeader.ulLength == pxStore->ulSectorSize ) &&
+        ( xHeader.ulHash != 0U ) &&
+        ( prvCrc32( 0, pxStore->pxFlash->pucBase + ulOffset, kvstoreCRC_OFFSET ) == xHeader.ulCrc ) )
+    {
+        ulGeneration = xHeader.ulHash;
+    }
+
+    return ulGeneration;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t prvProgram( KVStore_t * pxStore,
+                           uint32_t ulOffset,
+                           const void * pvData,
+                           uint32_t ulLength )
+{
+    const KVStoreFlash_t * pxFlash = pxStore->pxFlash;
+    int32_t lResult;
+
+    lResult = pxFlash->xProgram( pxFlash->pvContext, ulOffset, pvData, ulLength );
+
+    if( lResult == 0 )
+    {
+        pxStore->xStats.ulBytesProgrammed += ulLength;
+    }
+    else
+    {
+        pxStore->xStats.ulFlashErrors++;
+    }
+
+    return lResult;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Write back the buffered programs, failed ones included: the flash then
+ * holds what programming through would have left. */
+static int32_t prvSync( KVStore_t * pxStore,
+                        int32_t lResult )
+{
+    const KVStoreFlash_t * pxFlash = pxStore->pxFlash;
+    int32_t lSynced = lResult;
+
+    if( pxFlash->xSync != NULL )
+    {
+        if( pxFlash->xSync( pxFlash->pvContext ) != 0 )
+        {
+            pxStore->xStats.ulFlashErrors++;
+            lSynced = -1;
+        }
+    }
+
+    return lSynced;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t prvEraseSector( KVStore_t * pxStore,
+                               uint32_t ulSector )
+{
+    const KVStoreFlash_t * pxFlash = pxStore->pxFlash;
+    uint32_t ulOffset = prvSectorOffset( pxStore, ulSector );
+    uint32_t ulEnd = ulOffset + pxStore->ulSectorSize;
+    int32_t lResult = 0;
+
+    for( ; ( ulOffset < ulEnd ) && ( lResult == 0 ); ulOffset += pxFlash->ulPageSize )
+    {
+        lResult = pxFlash->xErase( pxFlash->pvContext, ulOffset );
+
+        if( lResult == 0 )
+        {
+            pxStore->xStats.ulErases++;
+        }
+        else
+        {
+            pxStore->xStats.ulFlashErrors++;
+        }
+    }
+
+    return lResult;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t prvWriteSectorHeader( KVStore_t * pxStore,
+                                     uint32_t ulSector,
+                                     uint32_t ulGeneration )
+{
+    KVStoreHeader_t * pxHeader = ( KVStoreHeader_t * ) pxStore->xStaging.ucBytes;
+
+    pxHeader->ulMagic = kvstoreSECTOR_MAGIC;
+    pxHeader->ulHash = ulGeneration;
+    pxHeader->ulLength = pxStore->ulSectorSize;
+    pxHeader->ulCrc = prvCrc32( 0, pxStore->xStaging.ucBytes, kvstoreCRC_OFFSET );
+
+    return prvProgram( pxStore, prvSectorOffset( pxStore, ulSector ), pxHeader, kvstoreHEADER_LENGTH );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Position of the first index entry whose hash is not lower than ulHash. */
+static uint32_t prvLowerBound( const KVStore_t * pxStore,
+                               uint32_t ulHash )
+{
+    uint32_t ulLow = 0;
+    uint32_t ulHigh = pxStore->ulKeyCount;
+    uint32_t ulMiddle;
+
+    while( ulLow < ulHigh )
+    {
+        ulMiddle = ulLow + ( ( ulHigh - ulLow ) / 2U );
+
+        if( pxStore->xIndex[ ulMiddle ].ulHash < ulHash )
+        {
+            ulLow = ulMiddle + 1U;
+        }
+        else
+        {
+            ulHigh = ulMiddle;
+        }
+    }
+
+    return ulLow;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Index position of a key, ulKeyCount if absent. */
+static uint32_t prvFind( const KVStore_t * pxStore,
+                         uint32_t ulHash,
+                         const uint8_t * pucKey,
+                         size_t xKeyLength )
+{
+    const volatile uint8_t * pucRecordKey;
+    uint32_t ulPosition;
+    uint32_t ulFound = pxStore->ulKeyCount;
+    size_t i;
+    bool xMatch;
+
+    for( ulPosition = prvLowerBound( pxStore, ulHash );
+         ( ulPosition < pxStore->ulKeyCount ) && ( pxStore->xIndex[ ulPosition ].ulHash == ulHash ) &&
+         ( ulFound == pxStore->ulKeyCount );
+         ulPosition++ )
+    {
+        if( pxStore->xIndex[ ulPosition ].ucKeyLength == xKeyLength )
+        {
+            pucRecordKey = pxStore->pxFlash->pucBase + pxStore->xIndex[ ulPosition ].ulOffset + kvstoreHEADER_LENGTH;
+            xMatch = true;
+
+            for( i = 0; ( i < xKeyLength ) && ( xMatch == true ); i++ )
+            {
+                xMatch = ( pucRecordKey[ i ] == pucKey[ i ] );
+            }
+
+            if( xMatch == true )
+            {
+                ulFound = ulPosition;
+            }
+        }
+    }
+
+    return ulFound;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvIndexRemove( KVStore_t * pxStore,
+                            uint32_t ulPosition )
+{
+    memmove( &pxStore->xIndex[ ulPosition ],
+             &pxStore->xIndex[ ulPosition + 1U ],
+             ( pxStore->ulKeyCount - ulPosition - 1U ) * sizeof( KVStoreIndexEntry_t ) );
+    pxStore->ulKeyCount--;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Point the index at a record, adding the key if it is new. Returns false if
+ * the index is full. */
+static bool prvIndexUpdate( KVStore_t * pxStore,
+                            uint32_t ulPosition,
+                            uint32_t ulHash,
+                            uint32_t ulOffset,
+                            uint32_t ulKeyLength,
+                            uint32_t ulValueLength )
+{
+    bool xUpdated = true;
+
+    if( ulPosition == pxStore->ulKeyCount )
+    {
+        if( pxStore->ulKeyCount == kvstoreMAX_KEYS )
+        {
+            xUpdated = false;
+        }
+        else
+        {
+            ulPosition = prvLowerBound( pxStore, ulHash );
+            memmove( &pxStore->xIndex[ ulPosition + 1U ],
+                     &pxStore->xIndex[ ulPosition ],
+                     ( pxStore->ulKeyCount - ulPosition ) * sizeof( KVStoreIndexEntry_t ) );
+            pxStore->ulKeyCount++;
+        }
+    }
+
+    if( xUpdated == true )
+    {
+        pxStore->xIndex[ ulPosition ].ulHash = ulHash;
+        pxStore->xIndex[ ulPosition ].ulOffset = ulOffset;
+        pxStore->xIndex[ ulPosition ].usValueLength = ( uint16_t ) ulValueLength;
+        pxStore->xIndex[ ulPosition ].ucKeyLength = ( uint8_t ) ulKeyLength;
+    }
+
+    return xUpdated;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Build the index from the records of the active sector. */
+static void prvScan( KVStore_t * pxStore )
+{
+    const volatile uint8_t * pucBase = pxStore->pxFlash->pucBase;
+    uint32_t ulSectorOffset = prvSectorOffset( pxStore, pxStore->ulActiveSector );
+    uint32_t ulOffset = kvstoreHEADER_LENGTH;
+    uint32_t ulKeyLength, ulSize, ulCrc, ulPosition;
+    KVStoreHeader_t xHeader;
+    uint8_t ucKey[ kvstoreMAX_KEY_LENGTH ];
+    size_t i;
+
+    pxStore->ulKeyCount = 0;
+    pxStore->ulWriteOffset = pxStore->ulSectorSize;
+
+    while( ( ulOffset + kvstoreHEADER_LENGTH ) <= pxStore->ulSectorSize )
+    {
+        prvReadHeader( pxStore, ulSectorOffset + ulOffset, &xHeader );
+
+        if( prvIsErased( &xHeader ) == true )
+        {
+            pxStore->ulWriteOffset = ulOffset;
+            break;
+        }
+
+        ulKeyLength = xHeader.ulMagic & kvstoreKEY_LENGTH_MASK;
+
+        /* A record interrupted by a reset, or not a record at all: nothing can
+         * be appended after it, the next update collects the sector. */
+        if( ( ( xHeader.ulMagic & kvstoreRECORD_MAGIC_MASK ) != kvstoreRECORD_MAGIC ) ||
+            ( ulKeyLength == 0U ) ||
+            ( ulKeyLength > kvstoreMAX_KEY_LENGTH ) ||
+            ( xHeader.ulLength > kvstoreMAX_VALUE_LENGTH ) ||
+            ( prvRecordSize( ulKeyLength, xHeader.ulLength ) > ( pxStore->ulSectorSize - ulOffset ) ) )
+        {
+            pxStore->xStats.ulCorrupt++;
+            break;
+        }
+
+        ulSize = prvRecordSize( ulKeyLength, xHeader.ulLength );
+        ulCrc = prvCrc32( 0, pucBase + ulSectorOffset + ulOffset, kvstoreCRC_OFFSET );
+        ulCrc = prvCrc32( ulCrc, pucBase + ulSectorOffset + ulOffset + kvstoreHEADER_LENGTH, ulKeyLength );
+        ulCrc = prvCrc32( ulCrc,
+                          pucBase + ulSectorOffset + ulOffset + kvstoreHEADER_LENGTH + prvAlign( ulKeyLength ),
+                          xHeader.ulLength );
+
+        if( ulCrc != xHeader.ulCrc )
+        {
+            pxStore->xStats.ulCorrupt++;
+            break;
+        }
+
+        for( i = 0; i < ulKeyLength; i++ )
+        {
+            ucKey[ i ] = pucBase[ ulSectorOffset + ulOffset + kvstoreHEADER_LENGTH + i ];
+        }
+
+        ulPosition = prvFind( pxStore, xHeader.ulHash, ucKey, ulKeyLength );
+
+        if( ( xHeader.ulMagic & kvstoreFLAG_DELETED ) != 0U )
+        {
+            if( ulPosition < pxStore->ulKeyCount )
+            {
+                prvIndexRemove( pxStore, ulPosition );
+            }
+        }
+        else
+        {
+            /* A full index drops the keys that do not fit, they are lost at
+             * the next collection. */
+            ( void ) prvIndexUpdate( pxStore, ulPosition, xHeader.ulHash,
+                                     ulSectorOffset + ulOffset, ulKeyLength, xHeader.ulLength );
+        }
+
+        pxStore->xStats.ulRecordsScanned++;
+        ulOffset += ulSize;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* Append a record to the active sector, which has room for it. */
+static int32_t prvAppend( KVStore_t * pxStore,
+                          uint32_t ulHash,
+                          uint32_t ulFlags,
+                          const uint8_t * pucKey,
+                          uint32_t ulKeyLength,
+                          const uint8_t * pucValue,
+                          uint32_t ulValueLength )
+{
+    KVStoreHeader_t * pxHeader = ( KVStoreHeader_t * ) pxStore->xStaging.ucBytes;
+    uint8_t * pucStaging = pxStore->xStaging.ucBytes;
+    uint32_t ulOffset = prvSectorOffset( pxStore, pxStore->ulActiveSector ) + pxStore->ulWriteOffset;
+    uint32_t ulHead = kvstoreHEADER_LENGTH + prvAlign( ulKeyLength );
+    uint32_t ulDone = 0, ulChunk;
+    int32_t lResult;
+
+    /* Header and key are programmed first, a record missing its value fails
+     * its CRC. */
+    memset( pucStaging, 0xFF, ulHead );
+    pxHeader->ulMagic = kvstoreRECORD_MAGIC | ulFlags | ulKeyLength;
+    pxHeader->ulHash = ulHash;
+    pxHeader->ulLength = ulValueLength;
+    memcpy( &pucStaging[ kvstoreHEADER_LENGTH ], pucKey, ulKeyLength );
+    pxHeader->ulCrc = prvCrc32( 0, pucStaging, kvstoreCRC_OFFSET );
+    pxHeader->ulCrc = prvCrc32( pxHeader->ulCrc, pucKey, ulKeyLength );
+    pxHeader->ulCrc = prvCrc32( pxHeader->ulCrc, pucValue, ulValueLength );
+
+    lResult = prvProgram( pxStore, ulOffset, pucStaging, ulHead );
+    ulOffset += ulHead;
+
+    /* An aligned value is programmed in place, the rest goes through the
+     * staging buffer. */
+    if( ( lResult == 0 ) && ( ( ( uintptr_t ) pucValue % kvstorePROGRAM_UNIT ) == 0U ) )
+    {
+        ulDone = ulValueLength & ~( kvstorePROGRAM_UNIT - 1U );
+
+        if( ulDone > 0U )
+        {
+            lResult = prvProgram( pxStore, ulOffset, pucValue, ulDone );
+        }
+    }
+
+    while( ( lResult == 0 ) && ( ulDone < ulValueLength ) )
+    {
+        ulChunk = ulValueLength - ulDone;
+
+        if( ulChunk > sizeof( pxStore->xStaging ) )
+        {
+            ulChunk = sizeof( pxStore->xStaging );
+        }
+
+        memset( pucStaging, 0xFF, prvAlign( ulChunk ) );
+        memcpy( pucStaging, &pucValue[ ulDone ], ulChunk );
+        lResult = prvProgram( pxStore, ulOffset + ulDone, pucStaging, prvAlign( ulChunk ) );
+        ulDone += ulChunk;
+    }
+
+    lResult = prvSync( pxStore, lResult );
+
+    if( lResult == 0 )
+    {
+        pxStore->ulWriteOffset += prvRecordSize( ulKeyLength, ulValueLength );
+        pxStore->xStats.ulWrites++;
+        pxStore->xStats.ulBytesWritten += ulKeyLength + ulValueLength;
+    }
+    else
+    {
+        /* A scan would stop at the failed record and miss the ones appended
+         * after it: the next update collects the sector instead. */
+        pxStore->ulWriteOffset = pxStore->ulSectorSize;
+    }
+
+    return lResult;
+}
+
+/*-----------------------------------------------------------*/
+
+bool KVStore_Open( KVStore_t * pxStore,
+                   const KVStoreFlash_t * pxFlash )
+{
+    uint32_t ulGeneration0, ulGeneration1;
+    bool xOpened = false;
+
+    if( ( pxStore != NULL ) &&
+        ( pxFlash != NULL ) &&
+        ( pxFlash->pucBase != NULL ) &&
+        ( ( ( uintptr_t ) pxFlash->pucBase % kvstorePROGRAM_UNIT ) == 0U ) &&
+        ( pxFlash->xErase != NULL ) &&
+        ( pxFlash->xProgram != NULL ) &&
+        ( pxFlash->ulPageSize != 0U ) &&
+        ( ( pxFlash->ulPageSize % kvstorePROGRAM_UNIT ) == 0U ) &&
+        ( pxFlash->ulPageCount >= 2U ) &&
+        ( ( pxFlash->ulPageCount % 2U ) == 0U ) )
+    {
+        memset( pxStore, 0, sizeof( *pxStore ) );
+        pxStore->pxFlash = pxFlash;
+        pxStore->ulSectorSize = ( pxFlash->ulPageCount / 2U ) * pxFlash->ulPageSize;
+
+        ulGeneration0 = prvSectorGeneration( pxStore, 0 );
+        ulGeneration1 = prvSectorGeneration( pxStore, 1 );
+
+        if( ( ulGeneration0 == 0U ) && ( ulGeneration1 == 0U ) )
+        {
+            /* Never used, or both sectors lost: start over. The records
+             * imported from sector 1 go before the header committing
+             * sector 0. */
+            pxStore->ulActiveSector = 0;
+            pxStore->ulGeneration = 1;
+            pxStore->ulWriteOffset = kvstoreHEADER_LENGTH;
+
+            if( prvEraseSector( pxStore, 0 ) == 0 )
+            {
+                if( pxFlash->xImport != NULL )
+                {
+                    pxStore->xImporting = true;
+                    xOpened = ( pxFlash->xImport( pxStore, pxFlash->pvContext ) == 0 );
+                    pxStore->xImporting = false;
+                }
+                else
+                {
+                    xOpened = true;
+                }
+
+                if( xOpened == true )
+                {
+                    xOpened = ( prvSync( pxStore, prvWriteSectorHeader( pxStore, 0, 1 ) ) == 0 );
+                }
+            }
+        }
+        else
+        {
+            /* Generations may wrap, compare them through the difference. */
+            if( ( ulGeneration1 == 0U ) ||
+                ( ( ulGeneration0 != 0U ) && ( ( int32_t ) ( ulGeneration0 - ulGeneration1 ) > 0 ) ) )
+            {
+                pxStore->ulActiveSector = 0;
+                pxStore->ulGeneration = ulGeneration0;
+            }
+            else
+            {
+                pxStore->ulActiveSector = 1;
+                pxStore->ulGeneration = ulGeneration1;
+            }
+
+            prvScan( pxStore );
+            xOpened = true;
+        }
+    }
+
+    return xOpened;
+}
+
+/*-----------------------------------------------------------*/
+
+bool KVStore_Get( const KVStore_t * pxStore,
+                  const void * pvKey,
+                  size_t xKeyLength,
+                  const uint8_t ** ppucValue,
+                  size_t * pxLength )
+{
+    const KVStoreIndexEntry_t * pxEntry;
+    uint32_t ulPosition;
+    bool xFound = false;
+
+    if( ( pvKey != NULL ) && ( xKeyLength > 0U ) && ( xKeyLength <= kvstoreMAX_KEY_LENGTH ) )
+    {
+        ulPosition = prvFind( pxStore, prvHash( pvKey, xKeyLength ), pvKey, xKeyLength );
+
+        if( ulPosition < pxStore->ulKeyCount )
+        {
+            pxEntry = &pxStore->xIndex[ ulPosition ];
+            *ppucValue = ( const uint8_t * ) pxStore->pxFlash->pucBase +
+                         pxEntry->ulOffset + kvstoreHEADER_LENGTH + prvAlign( pxEntry->ucKeyLength );
+            *pxLength = pxEntry->usValueLength;
+            xFound = true;
+        }
+    }
+
+    return xFound;
+}
+
+/*-----------------------------------------------------------*/
+
+bool KVStore_Read( const KVStore_t * pxStore,
+                   const void * pvKey,
+                   size_t xKeyLength,
+                   void * pvValue,
+                   size_t xMaxLength,
+                   size_t * pxLength )
+{
+    const uint8_t * pucValue;
+    bool xRead;
+
+    xRead = KVStore_Get( pxStore, pvKey, xKeyLength, &pucValue, pxLength );
+
+    if( ( xRead == true ) && ( pvValue != NULL ) )
+    {
+        if( *pxLength <= xMaxLength )
+        {
+            memcpy( pvValue, pucValue, *pxLength );
+        }
+        else
+        {
+            xRead = false;
+        }
+    }
+
+    return xRead;
+}
+
+/*-----------------------------------------------------------*/
+
+bool KVStore_Set( KVStore_t * pxStore,
+                  const void * pvKey,
+                  size_t xKeyLength,
+                  const void * pvValue,
+                  size_t xValueLength )
+{
+    const uint8_t * pucStored;
+    size_t xStoredLength;
+    uint32_t ulHash, ulPosition, ulOffset, ulSize;
+    bool xSet = false;
+
+    if( ( pvKey == NULL ) || ( xKeyLength == 0U ) || ( xKeyLength > kvstoreMAX_KEY_LENGTH ) ||
+        ( ( pvValue == NULL ) && ( xValueLength > 0U ) ) || ( xValueLength > kvstoreMAX_VALUE_LENGTH ) ||
+        ( prvRecordSize( xKeyLength, xValueLength ) > ( pxStore->ulSectorSize - kvstoreHEADER_LENGTH ) ) )
+    {
+        /* Invalid or too large. */
+    }
+    else if( ( KVStore_Get( pxStore, pvKey, xKeyLength, &pucStored, &xStoredLength ) == true ) &&
+             ( xStoredLength == xValueLength ) &&
+             ( ( xValueLength == 0U ) || ( memcmp( pucStored, pvValue, xValueLength ) == 0 ) ) )
+    {
+        pxStore->xStats.ulUnchanged++;
+        xSet = true;
+    }
+    else
+    {
+        ulHash = prvHash( pvKey, xKeyLength );
+        ulPosition = prvFind( pxStore, ulHash, pvKey, xKeyLength );
+        ulSize = prvRecordSize( xKeyLength, xValueLength );
+
+        if( ( ulPosition == pxStore->ulKeyCount ) && ( pxStore->ulKeyCount == kvstoreMAX_KEYS ) )
+        {
+            /* Index full. */
+        }
+        else if( ( ( pxStore->ulSectorSize - pxStore->ulWriteOffset ) < ulSize ) &&
+                 ( ( KVStore_Collect( pxStore ) == false ) ||
+                   ( ( pxStore->ulSectorSize - pxStore->ulWriteOffset ) < ulSize ) ) )
+        {
+            /* Flash full, or the collection failed. */
+        }
+        else
+        {
+            ulOffset = prvSectorOffset( pxStore, pxStore->ulActiveSector ) + pxStore->ulWriteOffset;
+
+            if( prvAppend( pxStore, ulHash, 0, pvKey, xKeyLength, pvValue, xValueLength ) == 0 )
+            {
+                /* The collection may have moved the entry of the key. */
+                ulPosition = prvFind( pxStore, ulHash, pvKey, xKeyLength );
+                xSet = prvIndexUpdate( pxStore, ulPosition, ulHash, ulOffset, xKeyLength, xValueLength );
+            }
+        }
+    }
+
+    return xSet;
+}
+
+/*-----------------------------------------------------------*/
+
+bool KVStore_Delete( KVStore_t * pxStore,
+                     const void * pvKey,
+                     size_t xKeyLength )
+{
+    uint32_t ulHash, ulPosition, ulSize;
+    bool xDeleted = true;
+
+    if( ( pvKey == NULL ) || ( xKeyLength == 0U ) || ( xKeyLength > kvstoreMAX_KEY_LENGTH ) )
+    {
+        xDeleted = false;
+    }
+    else
+    {
+        ulHash = prvHash( pvKey, xKeyLength );
+        ulPosition = prvFind( pxStore, ulHash, pvKey, xKeyLength );
+        ulSize = prvRecordSize( xKeyLength, 0 );
+
+        if( ulPosition < pxStore->ulKeyCount )
+        {
+            /* Removing the key first lets a collection drop it. */
+            prvIndexRemove( pxStore, ulPosition );
+
+            if( ( pxStore->ulSectorSize - pxStore->ulWriteOffset ) < ulSize )
+            {
+                xDeleted = KVStore_Collect( pxStore );
+            }
+            else
+            {
+                xDeleted = ( prvAppend( pxStore, ulHash, kvstoreFLAG_DELETED, pvKey, xKeyLength, NULL, 0 ) == 0 );
+            }
+
+            if( xDeleted == false )
+            {
+                /* The record of the key is still in the active sector. */
+                prvScan( pxStore );
+            }
+        }
+    }
+
+    return xDeleted;
+}
+
+/*-----------------------------------------------------------*/
+
+bool KVStore_Collect( KVStore_t * pxStore )
+{
+    const KVStoreFlash_t * pxFlash = pxStore->pxFlash;
+    uint32_t ulTarget = 1U - pxStore->ulActiveSector;
+    uint32_t ulTargetOffset = prvSectorOffset( pxStore, ulTarget );
+    uint32_t ulOffset = kvstoreHEADER_LENGTH;
+    uint32_t ulGeneration = pxStore->ulGeneration + 1U;
+    uint32_t ulStart = 0, ulElapsedUs = 0, ulSize, i;
+    const KVStoreIndexEntry_t * pxEntry;
+    int32_t lResult;
+
+    /* 0 marks a sector without header. */
+    if( ulGeneration == 0U )
+    {
+        ulGeneration = 1U;
+    }
+
+    if( pxFlash->xTimestamp != NULL )
+    {
+        ulStart = pxFlash->xTimestamp();
+    }
+
+    /* The sector being imported from must outlive the import. */
+    if( pxStore->xImporting == true )
+    {
+        lResult = -1;
+    }
+    else
+    {
+        lResult = prvEraseSector( pxStore, ulTarget );
+    }
+
+    /* Copy the live records as they are, flash to flash. */
+    for( i = 0; ( i < pxStore->ulKeyCount ) && ( lResult == 0 ); i++ )
+    {
+        pxEntry = &pxStore->xIndex[ i ];
+        ulSize = prvRecordSize( pxEntry->ucKeyLength, pxEntry->usValueLength );
+        lResult = prvProgram( pxStore, ulTargetOffset + ulOffset,
+                              ( const void * ) ( pxFlash->pucBase + pxEntry->ulOffset ), ulSize );
+        ulOffset += ulSize;
+    }
+
+    /* The header commits the new sector, the copies must reach the flash
+     * first: a buffered page is written back in address order, header
+     * first. */
+    lResult = prvSync( pxStore, lResult );
+
+    if( lResult == 0 )
+    {
+        lResult = prvSync( pxStore, prvWriteSectorHeader( pxStore, ulTarget, ulGeneration ) );
+    }
+
+    if( lResult == 0 )
+    {
+        ulOffset = kvstoreHEADER_LENGTH;
+
+        for( i = 0; i < pxStore->ulKeyCount; i++ )
+        {
+            pxEntry = &pxStore->xIndex[ i ];
+            ulSize = prvRecordSize( pxEntry->ucKeyLength, pxEntry->usValueLength );
+            pxStore->xIndex[ i ].ulOffset = ulTargetOffset + ulOffset;
+            ulOffset += ulSize;
+        }
+
+        pxStore->ulActiveSector = ulTarget;
+        pxStore->ulGeneration = ulGeneration;
+        pxStore->ulWriteOffset = ulOffset;
+        pxStore->xStats.ulCollections++;
+    }
+
+    if( ( pxFlash->xTimestamp != NULL ) && ( pxFlash->ulTicksPerUs != 0U ) )
+    {
+        ulElapsedUs = ( pxFlash->xTimestamp() - ulStart ) / pxFlash->ulTicksPerUs;
+    }
+
+    pxStore->xStats.ulLastCollectUs = ulElapsedUs;
+
+    if( ulElapsedUs > pxStore->xStats.ulMaxCollectUs )
+    {
+        pxStore->xStats.ulMaxCollectUs = ulElapsedUs;
+    }
+
+    return ( lResult == 0 );
+}
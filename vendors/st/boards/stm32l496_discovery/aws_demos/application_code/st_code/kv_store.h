@@ -0,0 +1,306 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file kv_store.h
+ * @brief Log-structured key/value store in internal flash.
+ *
+ * The region is split in two sectors of equal size, one of them active.
+ * Every update appends a CRC protected record to the active sector, so
+ * writing a value costs program operations only. When the active sector is
+ * full, the live records are copied to the other sector, which then becomes
+ * active: the erases happen only during this garbage collection, and are
+ * spread evenly over both sectors.
+ *
+ * An update is atomic. A record interrupted by a reset fails its CRC and the
+ * previous value of the key stays in force. A collection is committed by the
+ * header of the new sector, programmed after the last copied record.
+ *
+ * The index of the live keys, sorted by key hash, is built in RAM by
+ * KVStore_Open() from a single scan of the active sector; lookups then read
+ * the flash only to confirm the key and to fetch the value.
+ *
+ * The flash is reached through callbacks, like the meter journal. The board
+ * programs it through the FLASH_update_cached() page cache, which merges the
+ * programs of a record into one write back per page.
+ */
+
+#ifndef _KV_STORE_H_
+#define _KV_STORE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @brief Keys held by the index.
+ */
+#ifndef kvstoreMAX_KEYS
+    #define kvstoreMAX_KEYS               ( 32U )
+#endif
+
+/**
+ * @brief Longest key, in bytes.
+ */
+#define kvstoreMAX_KEY_LENGTH             ( 64U )
+
+/**
+ * @brief Longest value, in bytes. A record must also fit in a sector.
+ */
+#define kvstoreMAX_VALUE_LENGTH           ( 0xFFFFU )
+
+/**
+ * @brief Smallest unit the flash can program, in bytes.
+ */
+#define kvstorePROGRAM_UNIT               ( 8U )
+
+/**
+ * @brief Length of the header of a sector and of a record.
+ */
+#define kvstoreHEADER_LENGTH              ( 16U )
+
+struct KVStore;
+
+/**
+ * @brief Flash access used by the store.
+ *
+ * Offsets are relative to the start of the region, which is read directly
+ * through @p pucBase.
+ */
+typedef struct KVStoreFlash
+{
+    const volatile uint8_t * pucBase; /**< Memory mapped region, 8-byte aligned. */
+    uint32_t ulPageSize;              /**< Erase unit. */
+    uint32_t ulPageCount;             /**< Pages in the region, an even number. */
+
+    /**
+     * @brief Erase one page, return 0 on success.
+     */
+    int32_t ( * xErase )( void * pvContext,
+                          uint32_t ulOffset );
+
+    /**
+     * @brief Program erased flash, return 0 on success. @p ulOffset and
+     * @p ulLength are multiples of kvstorePROGRAM_UNIT and @p pvData is
+     * 8-byte aligned. @p pvData may point into the region itself.
+     */
+    int32_t ( * xProgram )( void * pvContext,
+                            uint32_t ulOffset,
+                            const void * pvData,
+                            uint32_t ulLength );
+
+    /**
+     * @brief Write back the programs buffered by xProgram, return 0 on
+     * success. Called once a record or a sector header is programmed, and
+     * before the header committing a collection, which must not reach the
+     * flash before the copied records. NULL if xProgram writes through.
+     */
+    int32_t ( * xSync )( void * pvContext );
+
+    /**
+     * @brief Copy the data of a former storage format into the store with
+     * KVStore_Set(), return 0 on success. Called by KVStore_Open() when it
+     * finds no valid sector: only sector 0 is then erased, the former data
+     * must lie in sector 1, which no collection erases during the import.
+     * The header of sector 0 is programmed after the imported records, an
+     * import cut by a reset starts over at the next open. NULL if there is
+     * nothing to import.
+     */
+    int32_t ( * xImport )( struct KVStore * pxStore,
+                           void * pvContext );
+
+    /**
+     * @brief Free running counter timing the collections, NULL to disable.
+     */
+    uint32_t ( * xTimestamp )( void );
+    uint32_t ulTicksPerUs; /**< Counter ticks per microsecond. */
+
+    void * pvContext;
+} KVStoreFlash_t;
+
+/**
+ * @brief Store counters.
+ *
+ * The write amplification is ulBytesProgrammed / ulBytesWritten.
+ */
+typedef struct KVStoreStats
+{
+    uint32_t ulRecordsScanned;   /**< Records read by KVStore_Open(). */
+    uint32_t ulWrites;           /**< Records appended by updates and deletions. */
+    uint32_t ulUnchanged;        /**< Updates skipped because the value was already stored. */
+    uint32_t ulBytesWritten;     /**< Key and value bytes of the appended records. */
+    uint32_t ulBytesProgrammed;  /**< Bytes programmed, copies of the collections included. */
+    uint32_t ulErases;           /**< Pages erased. */
+    uint32_t ulCollections;      /**< Garbage collections. */
+    uint32_t ulLastCollectUs;    /**< Duration of the last collection. */
+    uint32_t ulMaxCollectUs;     /**< Longest collection. */
+    uint32_t ulCorrupt;          /**< Records that failed their CRC at open. */
+    uint32_t ulFlashErrors;      /**< Failed erase or program operations. */
+} KVStoreStats_t;
+
+/**
+ * @brief Index entry of a live key.
+ */
+typedef struct KVStoreIndexEntry
+{
+    uint32_t ulHash;          /**< Hash of the key, the sort key of the index. */
+    uint32_t ulOffset;        /**< Record offset in the region. */
+    uint16_t usValueLength;
+    uint8_t ucKeyLength;
+} KVStoreIndexEntry_t;
+
+/**
+ * @brief Store state, all of it can be rebuilt from the flash.
+ */
+typedef struct KVStore
+{
+    const KVStoreFlash_t * pxFlash;
+    uint32_t ulSectorSize;
+    uint32_t ulActiveSector;   /**< 0 or 1. */
+    uint32_t ulGeneration;     /**< Generation of the active sector. */
+    uint32_t ulWriteOffset;    /**< Next record, relative to the active sector. */
+    bool xImporting;           /**< xImport is running, collections are refused. */
+
+    uint32_t ulKeyCount;
+    KVStoreIndexEntry_t xIndex[ kvstoreMAX_KEYS ];
+
+    /* Record header and key, aligned for the double word programming. */
+    union
+    {
+        uint64_t ullAlign[ ( kvstoreHEADER_LENGTH + kvstoreMAX_KEY_LENGTH ) / sizeof( uint64_t ) ];
+        uint8_t ucBytes[ kvstoreHEADER_LENGTH + kvstoreMAX_KEY_LENGTH ];
+    } xStaging;
+
+    KVStoreStats_t xStats;
+} KVStore_t;
+
+/**
+ * @brief Open the store, building the index from the flash. A region with
+ * no valid sector is formatted, and the former data imported by xImport.
+ *
+ * @return false if the flash description is invalid, or formatting or the
+ * import failed.
+ */
+bool KVStore_Open( KVStore_t * pxStore,
+                   const KVStoreFlash_t * pxFlash );
+
+/**
+ * @brief Find the value of a key, without copying it.
+ *
+ * @param[out] ppucValue Value in the flash, valid until the next update of
+ * the store.
+ * @param[out] pxLength Length of the value.
+ *
+ * @return true if the key is present.
+ */
+bool KVStore_Get( const KVStore_t * pxStore,
+                  const void * pvKey,
+                  size_t xKeyLength,
+                  const uint8_t ** ppucValue,
+                  size_t * pxLength );
+
+/**
+ * @brief Copy the value of a key.
+ *
+ * @param[out] pvValue Buffer of @p xMaxLength bytes, may be NULL to get the
+ * length only.
+ * @param[out] pxLength Length of the value.
+ *
+ * @return true if the key is present and its value fits in the buffer.
+ */
+bool KVStore_Read( const KVStore_t * pxStore,
+                   const void * pvKey,
+                   size_t xKeyLength,
+                   void * pvValue,
+                   size_t xMaxLength,
+                   size_t * pxLength );
+
+/**
+ * @brief Set the value of a key. Storing the value already present costs
+ * no flash operation.
+ *
+ * @return false if the key or value is too long, the index or the flash is
+ * full, or a flash operation failed. The previous value is then kept.
+ */
+bool KVStore_Set( KVStore_t * pxStore,
+                  const void * pvKey,
+                  size_t xKeyLength,
+                  const void * pvValue,
+                  size_t xValueLength );
+
+/**
+ * @brief Remove a key.
+ *
+ * @return true if the key is absent on return.
+ */
+bool KVStore_Delete( KVStore_t * pxStore,
+                     const void * pvKey,
+                     size_t xKeyLength );
+
+/**
+ * @brief Copy the live records to the other sector and make it active.
+ * Called by KVStore_Set() when the active sector is full.
+ *
+ * @return false if a flash operation failed or an import is running, the
+ * active sector is then unchanged.
+ */
+bool KVStore_Collect( KVStore_t * pxStore );
+
+/**
+ * @brief Find the value of a key of the board store, thread safe. The value
+ * is valid until the next update of the store. Provided by the application.
+ */
+bool WaterMeter_KVGet( const void * pvKey,
+                       size_t xKeyLength,
+                       const uint8_t ** ppucValue,
+                       size_t * pxLength );
+
+/**
+ * @brief Copy the value of a key of the board store, thread safe. Provided
+ * by the application.
+ */
+bool WaterMeter_KVRead( const void * pvKey,
+                        size_t xKeyLength,
+                        void * pvValue,
+                        size_t xMaxLength,
+                        size_t * pxLength );
+
+/**
+ * @brief Set the value of a key of the board store, thread safe. Provided
+ * by the application.
+ */
+bool WaterMeter_KVSet( const void * pvKey,
+                       size_t xKeyLength,
+                       const void * pvValue,
+                       size_t xValueLength );
+
+/**
+ * @brief Remove a key of the board store, thread safe. Provided by the
+ * application.
+ */
+bool WaterMeter_KVDelete( const void * pvKey,
+                          size_t xKeyLength );
+
+#endif /* _KV_STORE_H_ */
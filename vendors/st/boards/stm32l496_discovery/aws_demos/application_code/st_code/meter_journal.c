@@ -0,0 +1,621 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file meter_journal.c
+ * @brief Store-and-forward journal of meter readings in internal flash.
+ */
+
+#include <string.h>
+
+#include "meter_journal.h"
+
+/* "MJNL", marks a page header. */
+#define meterjournalPAGE_MAGIC           ( 0x4C4E4A4DUL )
+
+/* Page header, in slot 0. Only the first three double words are programmed. */
+#define meterjournalHEADER_LENGTH        ( 24U )
+#define meterjournalHEADER_CRC_OFFSET    ( 20U )
+
+/* Record slot: sequence, time stamp, packed reading and CRC are programmed
+ * together, the last double word once the record was delivered. */
+#define meterjournalRECORD_LENGTH        ( 56U )
+#define meterjournalREADING_OFFSET       ( 8U )
+#define meterjournalREADING_LENGTH       ( 44U )
+#define meterjournalRECORD_CRC_OFFSET    ( 52U )
+#define meterjournalCONSUMED_OFFSET      ( 56U )
+
+/* Outcome of reading a slot. */
+#define meterjournalSLOT_FREE            ( 0U )
+#define meterjournalSLOT_PENDING         ( 1U )
+#define meterjournalSLOT_CONSUMED        ( 2U )
+#define meterjournalSLOT_CORRUPT         ( 3U )
+
+/* Sequence numbers may wrap, compare them through the difference. */
+#define meterjournalSEQUENCE_AFTER( a, b )    ( ( int32_t ) ( ( a ) - ( b ) ) > 0 )
+
+typedef struct MeterJournalHeader
+{
+    uint32_t ulMagic;
+    uint32_t ulPageSequence;
+    uint32_t ulFirstSequence; /* Sequence of the record in slot 1. */
+    uint32_t ulEraseCount;
+    uint32_t ulReserved;
+    uint32_t ulCrc;
+} MeterJournalHeader_t;
+
+/* Slot image, aligned for the double word programming of the flash. */
+typedef union MeterJournalSlot
+{
+    uint64_t ullAlign[ meterjournalSLOT_SIZE / sizeof( uint64_t ) ];
+    uint8_t ucBytes[ meterjournalSLOT_SIZE ];
+    uint32_t ulWords[ meterjournalSLOT_SIZE / sizeof( uint32_t ) ];
+} MeterJournalSlot_t;
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvCrc32( const uint8_t * pucData,
+                          size_t xLength )
+{
+    /* CRC-32 (IEEE 802.3), four bits at a time. */
+    static const uint32_t ulTable[ 16 ] =
+    {
+        0x00000000UL, 0x1DB71064UL, 0x3B6E20C8UL, 0x26D930ACUL,
+        0x76DC4190UL, 0x6B6B51F4UL, 0x4DB26158UL, 0x5005713CUL,
+        0xEDB88320UL, 0xF00F9344UL, 0xD6D6A3E8UL, 0xCB61B38CUL,
+        0x9B64C2B0UL, 0x86D3D2D4UL, 0xA00AE278UL, 0xBDBDF21CUL
+    };
+    uint32_t ulCrc = 0xFFFFFFFFUL;
+    size_t i;
+
+    for( i = 0; i < xLength; i++ )
+    {
+        ulCrc ^= pucData[ i ];
+        ulCrc = ( ulCrc >> 4 ) ^ ulTable[ ulCrc & 0x0FU ];
+        ulCrc = ( ulCrc >> 4 ) ^ ulTable[ ulCrc & 0x0FU ];
+    }
+
+    return ~ulCrc;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvSlotOffset( const MeterJournal_t * pxJournal,
+                               uint32_t ulPage,
+                               uint32_t ulSlot )
+{
+    return ( ulPage * pxJournal->pxFlash->ulPageSize ) + ( ulSlot * meterjournalSLOT_SIZE );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvReadSlot( const MeterJournal_t * pxJournal,
+                         uint32_t ulPage,
+                         uint32_t ulSlot,
+                         MeterJournalSlot_t * pxSlot )
+{
+    const volatile uint8_t * pucSlot = pxJournal->pxFlash->pucBase +
+                                       prvSlotOffset( pxJournal, ulPage, ulSlot );
+    size_t i;
+
+    for( i = 0; i < meterjournalSLOT_SIZE; i++ )
+    {
+        pxSlot->ucBytes[ i ] = pucSlot[ i ];
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvIsErased( const uint8_t * pucData,
+                         size_t xLength )
+{
+    size_t i;
+    bool xErased = true;
+
+    for( i = 0; ( i < xLength ) && ( xErased == true ); i++ )
+    {
+        xErased = ( pucData[ i ] == 0xFFU );
+    }
+
+    return xErased;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvReadHeader( const MeterJournal_t * pxJournal,
+                           uint32_t ulPage,
+                           MeterJournalHeader_t * pxHeader )
+{
+    MeterJournalSlot_t xSlot;
+
+    prvReadSlot( pxJournal, ulPage, 0, &xSlot );
+    memcpy( pxHeader, xSlot.ucBytes, sizeof( *pxHeader ) );
+
+    return ( pxHeader->ulMagic == meterjournalPAGE_MAGIC ) &&
+           ( pxHeader->ulCrc == prvCrc32( xSlot.ucBytes, meterjournalHEADER_CRC_OFFSET ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvPackReading( uint8_t * pucOut,
+                            const MeterReading_t * pxReading )
+{
+    uint8_t * pucField = pucOut;
+
+    memset( pucOut, 0, meterjournalREADING_LENGTH );
+
+    memcpy( pucField, &pxReading->ullMeterId, 8 );
+    pucField += 8;
+    memcpy( pucField, &pxReading->ullAmount, 8 );
+    pucField += 8;
+    memcpy( pucField, &pxReading->ullReverseAmount, 8 );
+    pucField += 8;
+    memcpy( pucField, &pxReading->usLDay, 2 );
+    pucField += 2;
+    memcpy( pucField, &pxReading->usNDay, 2 );
+    pucField += 2;
+    memcpy( pucField, &pxReading->usODay, 2 );
+    pucField += 2;
+    memcpy( pucField, &pxReading->usUDay, 2 );
+    pucField += 2;
+    memcpy( pucField, &pxReading->usHDay, 2 );
+    pucField += 2;
+    memcpy( pucField, &pxReading->usBDay, 2 );
+    pucField += 2;
+    memcpy( pucField, &pxReading->usOp, 2 );
+    pucField += 2;
+    *pucField++ = pxReading->ucStationId;
+    *pucField++ = pxReading->ucAmountPlaces;
+    *pucField = pxReading->ucReverseAmountPlaces;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvUnpackReading( MeterReading_t * pxReading,
+                              const uint8_t * pucIn )
+{
+    const uint8_t * pucField = pucIn;
+
+    memcpy( &pxReading->ullMeterId, pucField, 8 );
+    pucField += 8;
+    memcpy( &pxReading->ullAmount, pucField, 8 );
+    pucField += 8;
+    memcpy( &pxReading->ullReverseAmount, pucField, 8 );
+    pucField += 8;
+    memcpy( &pxReading->usLDay, pucField, 2 );
+    pucField += 2;
+    memcpy( &pxReading->usNDay, pucField, 2 );
+    pucField += 2;
+    memcpy( &pxReading->usODay, pucField, 2 );
+    pucField += 2;
+    memcpy( &pxReading->usUDay, pucField, 2 );
+    pucField += 2;
+    memcpy( &pxReading->usHDay, pucField, 2 );
+    pucField += 2;
+    memcpy( &pxReading->usBDay, pucField, 2 );
+    pucField += 2;
+    memcpy( &pxReading->usOp, pucField, 2 );
+    pucField += 2;
+    pxReading->ucStationId = *pucField++;
+    pxReading->ucAmountPlaces = *pucField++;
+    pxReading->ucReverseAmountPlaces = *pucField;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint8_t prvReadRecord( const MeterJournal_t * pxJournal,
+                              uint32_t ulPage,
+                              uint32_t ulSlot,
+                              MeterJournalEntry_t * pxEntry )
+{
+    MeterJournalSlot_t xSlot;
+    uint32_t ulCrc;
+    uint8_t ucState;
+
+    prvReadSlot( pxJournal, ulPage, ulSlot, &xSlot );
+    memcpy( &ulCrc, &xSlot.ucBytes[ meterjournalRECORD_CRC_OFFSET ], sizeof( ulCrc ) );
+
+    if( prvIsErased( xSlot.ucBytes, meterjournalSLOT_SIZE ) == true )
+    {
+        ucState = meterjournalSLOT_FREE;
+    }
+    else if( ulCrc != prvCrc32( xSlot.ucBytes, meterjournalRECORD_CRC_OFFSET ) )
+    {
+        ucState = meterjournalSLOT_CORRUPT;
+    }
+    else
+    {
+        /* Anything but an erased mark, including a torn one, is delivered. */
+        ucState = ( prvIsErased( &xSlot.ucBytes[ meterjournalCONSUMED_OFFSET ],
+                                 meterjournalPROGRAM_UNIT ) == true ) ?
+                  meterjournalSLOT_PENDING : meterjournalSLOT_CONSUMED;
+
+        if( pxEntry != NULL )
+        {
+            pxEntry->ulSequence = xSlot.ulWords[ 0 ];
+            pxEntry->ulTimestamp = xSlot.ulWords[ 1 ];
+            prvUnpackReading( &pxEntry->xReading, &xSlot.ucBytes[ meterjournalREADING_OFFSET ] );
+        }
+    }
+
+    return ucState;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvNextPage( const MeterJournal_t * pxJournal,
+                             uint32_t ulPage )
+{
+    ulPage++;
+
+    return ( ulPage == pxJournal->pxFlash->ulPageCount ) ? 0U : ulPage;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvAtHead( const MeterJournal_t * pxJournal,
+                       uint32_t ulPage,
+                       uint32_t ulSlot )
+{
+    return ( ulPage == pxJournal->ulHeadPage ) && ( ulSlot >= pxJournal->ulHeadSlot );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Move a position to the next slot written before the head. */
+static void prvStep( const MeterJournal_t * pxJournal,
+                     uint32_t * pulPage,
+                     uint32_t * pulSlot )
+{
+    ( *pulSlot )++;
+
+    if( ( *pulSlot >= pxJournal->ulSlotsPerPage ) && ( *pulPage != pxJournal->ulHeadPage ) )
+    {
+        *pulPage = prvNextPage( pxJournal, *pulPage );
+        *pulSlot = 1;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* Skip delivered and unreadable slots at the tail. */
+static void prvAdvanceTail( MeterJournal_t * pxJournal )
+{
+    while( ( prvAtHead( pxJournal, pxJournal->ulTailPage, pxJournal->ulTailSlot ) == false ) &&
+           ( prvReadRecord( pxJournal, pxJournal->ulTailPage, pxJournal->ulTailSlot, NULL ) !=
+             meterjournalSLOT_PENDING ) )
+    {
+        prvStep( pxJournal, &pxJournal->ulTailPage, &pxJournal->ulTailSlot );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* Erase the page after the head and make it the new head. */
+static bool prvOpenNextPage( MeterJournal_t * pxJournal )
+{
+    const MeterJournalFlash_t * pxFlash = pxJournal->pxFlash;
+    uint32_t ulPage = prvNextPage( pxJournal, pxJournal->ulHeadPage );
+    MeterJournalHeader_t xOld;
+    MeterJournalSlot_t xSlot;
+    uint32_t ulEraseCount;
+
+    /* The journal is full, give up the oldest page. */
+    if( ( pxJournal->ulPending > 0U ) && ( pxJournal->ulTailPage == ulPage ) )
+    {
+        while( pxJournal->ulTailPage == ulPage )
+        {
+            if( prvReadRecord( pxJournal, ulPage, pxJournal->ulTailSlot, NULL ) == meterjournalSLOT_PENDING )
+            {
+                pxJournal->ulPending--;
+                pxJournal->xStats.ulDropped++;
+            }
+
+            prvStep( pxJournal, &pxJournal->ulTailPage, &pxJournal->ulTailSlot );
+        }
+
+        prvAdvanceTail( pxJournal );
+    }
+
+    /* A page without a valid header (blank or torn) is assumed to be as worn
+     * as the most used one. */
+    if( prvReadHeader( pxJournal, ulPage, &xOld ) == true )
+    {
+        ulEraseCount = xOld.ulEraseCount + 1U;
+    }
+    else
+    {
+        ulEraseCount = ( pxJournal->xStats.ulMaxEraseCount > 0U ) ? pxJournal->xStats.ulMaxEraseCount : 1U;
+    }
+
+    if( pxFlash->xErase( pxFlash->pvContext, prvSlotOffset( pxJournal, ulPage, 0 ) ) != 0 )
+    {
+        pxJournal->xStats.ulFlashErrors++;
+
+        return false;
+    }
+
+    memset( &xSlot, 0xFF, sizeof( xSlot ) );
+    xSlot.ulWords[ 0 ] = meterjournalPAGE_MAGIC;
+    xSlot.ulWords[ 1 ] = pxJournal->ulNextPageSequence;
+    xSlot.ulWords[ 2 ] = pxJournal->ulNextSequence;
+    xSlot.ulWords[ 3 ] = ulEraseCount;
+    xSlot.ulWords[ 4 ] = 0;
+    xSlot.ulWords[ 5 ] = prvCrc32( xSlot.ucBytes, meterjournalHEADER_CRC_OFFSET );
+
+    if( pxFlash->xProgram( pxFlash->pvContext,
+                           prvSlotOffset( pxJournal, ulPage, 0 ),
+                           xSlot.ucBytes,
+                           meterjournalHEADER_LENGTH ) != 0 )
+    {
+        pxJournal->xStats.ulFlashErrors++;
+
+        return false;
+    }
+
+    if( ulEraseCount > pxJournal->xStats.ulMaxEraseCount )
+    {
+        pxJournal->xStats.ulMaxEraseCount = ulEraseCount;
+    }
+
+    pxJournal->ulNextPageSequence++;
+    pxJournal->ulHeadPage = ulPage;
+    pxJournal->ulHeadSlot = 1;
+
+    if( pxJournal->ulPending == 0U )
+    {
+        pxJournal->ulTailPage = ulPage;
+        pxJournal->ulTailSlot = 1;
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+bool MeterJournal_Open( MeterJournal_t * pxJournal,
+                        const MeterJournalFlash_t * pxFlash )
+{
+    MeterJournalHeader_t xHeader, xHeadHeader = { 0 };
+    uint32_t ulPage, ulSlot, ulTailSequence = 0;
+    bool xFound = false;
+    uint8_t ucState;
+
+    if( ( pxFlash->ulPageCount < 2U ) ||
+        ( pxFlash->ulPageSize < ( 2U * meterjournalSLOT_SIZE ) ) ||
+        ( ( pxFlash->ulPageSize % meterjournalSLOT_SIZE ) != 0U ) ||
+        ( pxFlash->xErase == NULL ) ||
+        ( pxFlash->xProgram == NULL ) )
+    {
+        return false;
+    }
+
+    memset( pxJournal, 0, sizeof( *pxJournal ) );
+    pxJournal->pxFlash = pxFlash;
+    pxJournal->ulSlotsPerPage = pxFlash->ulPageSize / meterjournalSLOT_SIZE;
+
+    /* The newest valid page is the head, the oldest one holds the tail. */
+    for( ulPage = 0; ulPage < pxFlash->ulPageCount; ulPage++ )
+    {
+        if( prvReadHeader( pxJournal, ulPage, &xHeader ) == false )
+        {
+            continue;
+        }
+
+        if( xHeader.ulEraseCount > pxJournal->xStats.ulMaxEraseCount )
+        {
+            pxJournal->xStats.ulMaxEraseCount = xHeader.ulEraseCount;
+        }
+
+        if( ( xFound == false ) ||
+            meterjournalSEQUENCE_AFTER( xHeader.ulPageSequence, xHeadHeader.ulPageSequence ) )
+        {
+            xHeadHeader = xHeader;
+            pxJournal->ulHeadPage = ulPage;
+        }
+
+        if( ( xFound == false ) ||
+            meterjournalSEQUENCE_AFTER( ulTailSequence, xHeader.ulPageSequence ) )
+        {
+            ulTailSequence = xHeader.ulPageSequence;
+            pxJournal->ulTailPage = ulPage;
+        }
+
+        xFound = true;
+    }
+
+    if( xFound == false )
+    {
+        /* Blank journal: the first append opens page 0. */
+        pxJournal->ulHeadPage = pxFlash->ulPageCount - 1U;
+        pxJournal->ulHeadSlot = pxJournal->ulSlotsPerPage;
+        pxJournal->ulTailPage = pxJournal->ulHeadPage;
+        pxJournal->ulTailSlot = pxJournal->ulHeadSlot;
+        pxJournal->ulNextSequence = 1;
+        pxJournal->ulNextPageSequence = 1;
+
+        return true;
+    }
+
+    /* Records are written in slot order, the head follows the last used slot. */
+    for( ulSlot = pxJournal->ulSlotsPerPage - 1U; ulSlot > 0U; ulSlot-- )
+    {
+        if( prvReadRecord( pxJournal, pxJournal->ulHeadPage, ulSlot, NULL ) != meterjournalSLOT_FREE )
+        {
+            break;
+        }
+    }
+
+    pxJournal->ulHeadSlot = ulSlot + 1U;
+    pxJournal->ulNextSequence = xHeadHeader.ulFirstSequence + ulSlot;
+    pxJournal->ulNextPageSequence = xHeadHeader.ulPageSequence + 1U;
+
+    /* Count what is left to deliver. */
+    pxJournal->ulTailSlot = 1;
+    ulPage = pxJournal->ulTailPage;
+    ulSlot = pxJournal->ulTailSlot;
+
+    while( prvAtHead( pxJournal, ulPage, ulSlot ) == false )
+    {
+        ucState = prvReadRecord( pxJournal, ulPage, ulSlot, NULL );
+
+        if( ucState == meterjournalSLOT_PENDING )
+        {
+            pxJournal->ulPending++;
+        }
+        else if( ucState == meterjournalSLOT_CORRUPT )
+        {
+            pxJournal->xStats.ulCorrupt++;
+        }
+
+        prvStep( pxJournal, &ulPage, &ulSlot );
+    }
+
+    prvAdvanceTail( pxJournal );
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+bool MeterJournal_Append( MeterJournal_t * pxJournal,
+                          uint32_t ulTimestamp,
+                          const MeterReading_t * pxReading )
+{
+    const MeterJournalFlash_t * pxFlash = pxJournal->pxFlash;
+    MeterJournalSlot_t xSlot;
+    bool xResult = true;
+
+    if( pxJournal->ulHeadSlot >= pxJournal->ulSlotsPerPage )
+    {
+        xResult = prvOpenNextPage( pxJournal );
+    }
+
+    if( xResult == true )
+    {
+        memset( &xSlot, 0xFF, sizeof( xSlot ) );
+        xSlot.ulWords[ 0 ] = pxJournal->ulNextSequence;
+        xSlot.ulWords[ 1 ] = ulTimestamp;
+        prvPackReading( &xSlot.ucBytes[ meterjournalREADING_OFFSET ], pxReading );
+        xSlot.ulWords[ meterjournalRECORD_CRC_OFFSET / sizeof( uint32_t ) ] =
+            prvCrc32( xSlot.ucBytes, meterjournalRECORD_CRC_OFFSET );
+
+        /* The slot and its sequence are used even if programming fails. */
+        pxJournal->ulNextSequence++;
+        pxJournal->ulHeadSlot++;
+
+        if( pxFlash->xProgram( pxFlash->pvContext,
+                               prvSlotOffset( pxJournal, pxJournal->ulHeadPage, pxJournal->ulHeadSlot - 1U ),
+                               xSlot.ucBytes,
+                               meterjournalRECORD_LENGTH ) == 0 )
+        {
+            pxJournal->ulPending++;
+            pxJournal->xStats.ulAppended++;
+        }
+        else
+        {
+            pxJournal->xStats.ulFlashErrors++;
+            xResult = false;
+        }
+
+        if( pxJournal->ulPending == 0U )
+        {
+            pxJournal->ulTailPage = pxJournal->ulHeadPage;
+            pxJournal->ulTailSlot = pxJournal->ulHeadSlot;
+        }
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t MeterJournal_Peek( MeterJournal_t * pxJournal,
+                          MeterJournalEntry_t * pxEntries,
+                          size_t xMaxEntries )
+{
+    uint32_t ulPage = pxJournal->ulTailPage, ulSlot = pxJournal->ulTailSlot;
+    size_t xCount = 0;
+
+    while( ( xCount < xMaxEntries ) && ( prvAtHead( pxJournal, ulPage, ulSlot ) == false ) )
+    {
+        if( prvReadRecord( pxJournal, ulPage, ulSlot, &pxEntries[ xCount ] ) == meterjournalSLOT_PENDING )
+        {
+            xCount++;
+        }
+
+        prvStep( pxJournal, &ulPage, &ulSlot );
+    }
+
+    return xCount;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t MeterJournal_Consume( MeterJournal_t * pxJournal,
+                             uint32_t ulLastSequence )
+{
+    const MeterJournalFlash_t * pxFlash = pxJournal->pxFlash;
+    static const uint64_t ullConsumed = 0;
+    uint32_t ulPage = pxJournal->ulTailPage, ulSlot = pxJournal->ulTailSlot;
+    MeterJournalEntry_t xEntry;
+    size_t xCount = 0;
+
+    while( prvAtHead( pxJournal, ulPage, ulSlot ) == false )
+    {
+        if( prvReadRecord( pxJournal, ulPage, ulSlot, &xEntry ) == meterjournalSLOT_PENDING )
+        {
+            if( meterjournalSEQUENCE_AFTER( xEntry.ulSequence, ulLastSequence ) )
+            {
+                break;
+            }
+
+            if( pxFlash->xProgram( pxFlash->pvContext,
+                                   prvSlotOffset( pxJournal, ulPage, ulSlot ) + meterjournalCONSUMED_OFFSET,
+                                   &ullConsumed,
+                                   meterjournalPROGRAM_UNIT ) != 0 )
+            {
+                pxJournal->xStats.ulFlashErrors++;
+                break;
+            }
+
+            pxJournal->ulPending--;
+            xCount++;
+        }
+
+        prvStep( pxJournal, &ulPage, &ulSlot );
+    }
+
+    prvAdvanceTail( pxJournal );
+
+    return xCount;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t MeterJournal_Pending( const MeterJournal_t * pxJournal )
+{
+    return pxJournal->ulPending;
+}
@@ -0,0 +1,203 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file meter_journal.h
+ * @brief Store-and-forward journal of meter readings in internal flash.
+ *
+ * Readings are appended as fixed-size, CRC protected records to a ring of
+ * flash pages. Pages are used in turn, so every page sees the same number of
+ * erase cycles. Each record carries a double word that is programmed once
+ * the record was delivered; delivery is at least once.
+ *
+ * Every state change is a single double word program or a page erase, and
+ * the state is rebuilt from the flash content by MeterJournal_Open(), so a
+ * reset at any point loses no delivered-pending record.
+ *
+ * The flash is reached through a small set of callbacks, the board binds
+ * them to flash_l4.c and the host tests to a RAM-backed simulator.
+ */
+
+#ifndef _METER_JOURNAL_H_
+#define _METER_JOURNAL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "meter_poll.h"
+
+/**
+ * @brief Size of one record slot. The first slot of a page holds the page
+ * header.
+ */
+#define meterjournalSLOT_SIZE         ( 64U )
+
+/**
+ * @brief Smallest unit the flash can program, in bytes.
+ */
+#define meterjournalPROGRAM_UNIT      ( 8U )
+
+/**
+ * @brief Flash access used by the journal.
+ *
+ * Offsets are relative to the start of the journal region. The region is
+ * read directly through @p pucBase.
+ */
+typedef struct MeterJournalFlash
+{
+    const volatile uint8_t * pucBase; /**< Memory mapped journal region. */
+    uint32_t ulPageSize;              /**< Erase unit, multiple of meterjournalSLOT_SIZE. */
+    uint32_t ulPageCount;             /**< Pages in the region, at least 2. */
+
+    /**
+     * @brief Erase one page, return 0 on success.
+     */
+    int32_t ( * xErase )( void * pvContext,
+                          uint32_t ulOffset );
+
+    /**
+     * @brief Program erased flash, return 0 on success. @p ulOffset and
+     * @p ulLength are multiples of meterjournalPROGRAM_UNIT and @p pvData is
+     * 8-byte aligned.
+     */
+    int32_t ( * xProgram )( void * pvContext,
+                            uint32_t ulOffset,
+                            const void * pvData,
+                            uint32_t ulLength );
+
+    void * pvContext;
+} MeterJournalFlash_t;
+
+/**
+ * @brief A reading as stored in the journal.
+ */
+typedef struct MeterJournalEntry
+{
+    uint32_t ulSequence;  /**< Increments with every appended record. */
+    uint32_t ulTimestamp; /**< Seconds since the Unix epoch, 0 if unknown. */
+    MeterReading_t xReading;
+} MeterJournalEntry_t;
+
+/**
+ * @brief Journal counters.
+ */
+typedef struct MeterJournalStats
+{
+    uint32_t ulAppended;      /**< Records appended since open. */
+    uint32_t ulDropped;       /**< Pending records overwritten because the journal was full. */
+    uint32_t ulCorrupt;       /**< Slots skipped because their CRC did not match. */
+    uint32_t ulFlashErrors;   /**< Failed erase or program operations. */
+    uint32_t ulMaxEraseCount; /**< Highest erase count of any page. */
+} MeterJournalStats_t;
+
+/**
+ * @brief Journal state, all of it can be rebuilt from the flash.
+ */
+typedef struct MeterJournal
+{
+    const MeterJournalFlash_t * pxFlash;
+    uint32_t ulSlotsPerPage;
+
+    /* Append position. */
+    uint32_t ulHeadPage;
+    uint32_t ulHeadSlot;
+    uint32_t ulNextSequence;
+    uint32_t ulNextPageSequence;
+
+    /* Oldest slot that may hold a pending record. */
+    uint32_t ulTailPage;
+    uint32_t ulTailSlot;
+
+    uint32_t ulPending;
+
+    MeterJournalStats_t xStats;
+} MeterJournal_t;
+
+/**
+ * @brief Open the journal, recovering its state from the flash.
+ *
+ * Never-used or unreadable pages are treated as free. A record that was
+ * being written when the device reset fails its CRC and is skipped.
+ *
+ * @return false if the flash description is invalid.
+ */
+bool MeterJournal_Open( MeterJournal_t * pxJournal,
+                        const MeterJournalFlash_t * pxFlash );
+
+/**
+ * @brief Append a reading. When the journal is full the oldest page is
+ * reclaimed and its pending records are counted as dropped.
+ *
+ * @return false if the flash operation failed.
+ */
+bool MeterJournal_Append( MeterJournal_t * pxJournal,
+                          uint32_t ulTimestamp,
+                          const MeterReading_t * pxReading );
+
+/**
+ * @brief Copy the oldest pending records, without consuming them.
+ *
+ * @return Number of entries written to @p pxEntries.
+ */
+size_t MeterJournal_Peek( MeterJournal_t * pxJournal,
+                          MeterJournalEntry_t * pxEntries,
+                          size_t xMaxEntries );
+
+/**
+ * @brief Mark every pending record up to and including @p ulLastSequence as
+ * delivered.
+ *
+ * @return Number of records consumed.
+ */
+size_t MeterJournal_Consume( MeterJournal_t * pxJournal,
+                             uint32_t ulLastSequence );
+
+/**
+ * @brief Number of records waiting for delivery.
+ */
+uint32_t MeterJournal_Pending( const MeterJournal_t * pxJournal );
+
+/**
+ * @brief Read the oldest pending readings of the board journal, thread safe.
+ * Provided by the application.
+ */
+size_t WaterMeter_JournalPeek( MeterJournalEntry_t * pxEntries,
+                               size_t xMaxEntries );
+
+/**
+ * @brief Append a reading that could not be delivered to the board journal,
+ * thread safe. Provided by the application.
+ */
+bool WaterMeter_JournalAppend( const MeterReading_t * pxReading,
+                               uint32_t ulTimestamp );
+
+/**
+ * @brief Mark readings of the board journal as delivered, thread safe.
+ * Provided by the application.
+ */
+void WaterMeter_JournalConsume( uint32_t ulLastSequence );
+
+#endif /* _METER_JOURNAL_H_ */
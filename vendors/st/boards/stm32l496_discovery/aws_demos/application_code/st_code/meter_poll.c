@@ -0,0 +1,374 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file meter_poll.c
+ * @brief Round-robin polling of the water meters sharing one RS-485 segment.
+ */
+
+#include <string.h>
+
+#include "meter_poll.h"
+#include "modbus_rtu.h"
+
+/* Modbus function codes. */
+#define meterpollREAD_HOLDING_REGISTERS    ( 0x03U )
+
+/* Scheduler states. */
+#define meterpollSTATE_IDLE                ( 0U )
+#define meterpollSTATE_SEND                ( 1U )
+#define meterpollSTATE_WAIT_REPLY          ( 2U )
+#define meterpollSTATE_TURNAROUND          ( 3U )
+
+/*
+ * Byte offsets of the fields in the reply frame, from the address byte.
+ */
+#define meterpollOFFSET_AMOUNT             ( 2U )
+#define meterpollOFFSET_AMOUNT_PLACES      ( 9U )
+#define meterpollOFFSET_REVERSE_AMOUNT     ( 10U )
+#define meterpollOFFSET_REVERSE_PLACES     ( 17U )
+#define meterpollOFFSET_LDAY               ( 18U )
+#define meterpollOFFSET_NDAY               ( 20U )
+#define meterpollOFFSET_ODAY               ( 22U )
+#define meterpollOFFSET_UDAY               ( 24U )
+#define meterpollOFFSET_HDAY               ( 26U )
+#define meterpollOFFSET_BDAY               ( 28U )
+#define meterpollOFFSET_OP_LOW             ( 30U )
+#define meterpollOFFSET_OP_HIGH            ( 32U )
+#define meterpollOFFSET_METER_ID           ( 36U )
+
+/* Amounts and the meter number are 48-bit little endian values. */
+#define meterpollWIDE_FIELD_LENGTH         ( 6U )
+
+/*-----------------------------------------------------------*/
+
+static uint64_t prvGetWide( const uint8_t * pucField )
+{
+    uint64_t ullValue = 0;
+    int32_t i;
+
+    for( i = ( int32_t ) meterpollWIDE_FIELD_LENGTH - 1; i >= 0; i-- )
+    {
+        ullValue = ( ullValue << 8 ) | pucField[ i ];
+    }
+
+    return ullValue;
+}
+/*-----------------------------------------------------------*/
+
+static uint16_t prvGetShort( const uint8_t * pucField )
+{
+    return ( uint16_t ) ( ( pucField[ 1 ] << 8 ) | pucField[ 0 ] );
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvSendCurrent( MeterPoll_t * pxPoll,
+                                uint32_t ulNow )
+{
+    MeterPollStation_t * pxStation = &pxPoll->xStations[ pxPoll->ucCurrent ];
+
+    MeterPoll_ComposeRequest( pxPoll->ucRequest,
+                              pxStation->ucAddress,
+                              pxPoll->xConfig.usStartRegister,
+                              pxPoll->xConfig.usRegisterCount );
+
+    pxStation->usRequests++;
+    pxPoll->ucAttempt++;
+    pxPoll->xBadReply = false;
+    pxPoll->ucState = meterpollSTATE_WAIT_REPLY;
+    pxPoll->ulDeadline = ulNow + pxPoll->xConfig.ulReplyTimeout;
+
+    pxPoll->xConfig.xSend( pxPoll->xConfig.pvSendContext,
+                           pxPoll->ucRequest,
+                           sizeof( pxPoll->ucRequest ) );
+
+    return pxPoll->xConfig.ulReplyTimeout;
+}
+/*-----------------------------------------------------------*/
+
+/* Move to the next station, or close the round. */
+static uint32_t prvNextStation( MeterPoll_t * pxPoll,
+                                uint32_t ulNow )
+{
+    pxPoll->ucCurrent++;
+    pxPoll->ucAttempt = 0;
+
+    if( pxPoll->ucCurrent >= pxPoll->ucStationCount )
+    {
+        pxPoll->ucState = meterpollSTATE_IDLE;
+        pxPoll->ulLastRoundTime = ulNow - pxPoll->ulRoundStart;
+
+        return meterpollROUND_COMPLETE;
+    }
+
+    if( pxPoll->xConfig.ulTurnaround > 0U )
+    {
+        pxPoll->ucState = meterpollSTATE_TURNAROUND;
+        pxPoll->ulDeadline = ulNow + pxPoll->xConfig.ulTurnaround;
+
+        return pxPoll->xConfig.ulTurnaround;
+    }
+
+    /* The reply was only delimited after the silent interval, so the bus is
+     * already free for the next request. */
+    return prvSendCurrent( pxPoll, ulNow );
+}
+/*-----------------------------------------------------------*/
+
+/* A station used all its attempts without a valid reply. */
+static uint32_t prvStationFailed( MeterPoll_t * pxPoll,
+                                  uint32_t ulNow )
+{
+    MeterPollStation_t * pxStation = &pxPoll->xStations[ pxPoll->ucCurrent ];
+
+    if( pxPoll->xBadReply == true )
+    {
+        pxStation->ucStatus = ( uint8_t ) METER_POLL_BAD_REPLY;
+    }
+    else
+    {
+        pxStation->ucStatus = ( uint8_t ) METER_POLL_TIMEOUT;
+    }
+
+    return prvNextStation( pxPoll, ulNow );
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvRemaining( const MeterPoll_t * pxPoll,
+                              uint32_t ulNow )
+{
+    int32_t lRemaining = ( int32_t ) ( pxPoll->ulDeadline - ulNow );
+
+    return ( lRemaining > 0 ) ? ( uint32_t ) lRemaining : 0U;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvOnFrame( MeterPoll_t * pxPoll,
+                            uint32_t ulNow,
+                            const uint8_t * pucFrame,
+                            size_t xFrameLength )
+{
+    MeterPollStation_t * pxStation = &pxPoll->xStations[ pxPoll->ucCurrent ];
+    MeterReading_t xReading;
+
+    /* Our own request echoed by a transceiver, or a late reply from another
+     * station: keep waiting for the rest of the timeout. */
+    if( ( xFrameLength == 0U ) || ( pucFrame[ 0 ] != pxStation->ucAddress ) ||
+        ( ( xFrameLength == sizeof( pxPoll->ucRequest ) ) &&
+          ( memcmp( pucFrame, pxPoll->ucRequest, xFrameLength ) == 0 ) ) )
+    {
+        return prvRemaining( pxPoll, ulNow );
+    }
+
+    if( MeterPoll_DecodeReading( pucFrame, xFrameLength, &xReading ) == false )
+    {
+        /* Corrupted or exception reply: the station is alive, retry now. */
+        pxStation->usBadReplies++;
+        pxPoll->xBadReply = true;
+
+        if( pxPoll->ucAttempt <= pxPoll->xConfig.ucMaxRetries )
+        {
+            return prvSendCurrent( pxPoll, ulNow );
+        }
+
+        return prvStationFailed( pxPoll, ulNow );
+    }
+
+    pxStation->xReading = xReading;
+    pxStation->ulRound = pxPoll->ulRound;
+    pxStation->ulReadTime = ulNow;
+    pxStation->ucStatus = ( uint8_t ) METER_POLL_OK;
+
+    return prvNextStation( pxPoll, ulNow );
+}
+/*-----------------------------------------------------------*/
+
+void MeterPoll_Init( MeterPoll_t * pxPoll,
+                     const MeterPollConfig_t * pxConfig,
+                     const uint8_t * pucAddresses,
+                     uint8_t ucStationCount )
+{
+    uint8_t i;
+
+    memset( pxPoll, 0, sizeof( MeterPoll_t ) );
+    pxPoll->xConfig = *pxConfig;
+
+    if( ucStationCount > meterpollMAX_STATIONS )
+    {
+        ucStationCount = meterpollMAX_STATIONS;
+    }
+
+    for( i = 0; i < ucStationCount; i++ )
+    {
+        pxPoll->xStations[ i ].ucAddress = pucAddresses[ i ];
+        pxPoll->xStations[ i ].ucStatus = ( uint8_t ) METER_POLL_NEVER;
+    }
+
+    pxPoll->ucStationCount = ucStationCount;
+    pxPoll->ucState = meterpollSTATE_IDLE;
+}
+/*-----------------------------------------------------------*/
+
+void MeterPoll_StartRound( MeterPoll_t * pxPoll,
+                           uint32_t ulNow )
+{
+    pxPoll->ulRound++;
+    pxPoll->ulRoundStart = ulNow;
+    pxPoll->ucCurrent = 0;
+    pxPoll->ucAttempt = 0;
+    pxPoll->ucState = meterpollSTATE_SEND;
+}
+/*-----------------------------------------------------------*/
+
+uint32_t MeterPoll_Step( MeterPoll_t * pxPoll,
+                         uint32_t ulNow,
+                         const uint8_t * pucFrame,
+                         size_t xFrameLength )
+{
+    uint32_t ulDelay = meterpollROUND_COMPLETE;
+
+    switch( pxPoll->ucState )
+    {
+        case meterpollSTATE_SEND:
+
+            if( pxPoll->ucStationCount == 0U )
+            {
+                pxPoll->ucState = meterpollSTATE_IDLE;
+                pxPoll->ulLastRoundTime = 0;
+            }
+            else
+            {
+                ulDelay = prvSendCurrent( pxPoll, ulNow );
+            }
+
+            break;
+
+        case meterpollSTATE_WAIT_REPLY:
+
+            if( pucFrame != NULL )
+            {
+                ulDelay = prvOnFrame( pxPoll, ulNow, pucFrame, xFrameLength );
+            }
+            else if( prvRemaining( pxPoll, ulNow ) > 0U )
+            {
+                ulDelay = prvRemaining( pxPoll, ulNow );
+            }
+            else
+            {
+                pxPoll->xStations[ pxPoll->ucCurrent ].usTimeouts++;
+
+                if( pxPoll->ucAttempt <= pxPoll->xConfig.ucMaxRetries )
+                {
+                    ulDelay = prvSendCurrent( pxPoll, ulNow );
+                }
+                else
+                {
+                    ulDelay = prvStationFailed( pxPoll, ulNow );
+                }
+            }
+
+            break;
+
+        case meterpollSTATE_TURNAROUND:
+
+            /* Frames seen here are stray, the previous station is done. */
+            ulDelay = prvRemaining( pxPoll, ulNow );
+
+            if( ulDelay == 0U )
+            {
+                ulDelay = prvSendCurrent( pxPoll, ulNow );
+            }
+
+            break;
+
+        default:
+            break;
+    }
+
+    return ulDelay;
+}
+/*-----------------------------------------------------------*/
+
+void MeterPoll_Snapshot( const MeterPoll_t * pxPoll,
+                         MeterPollSnapshot_t * pxSnapshot )
+{
+    pxSnapshot->ulRound = pxPoll->ulRound;
+    pxSnapshot->ulRoundTime = pxPoll->ulLastRoundTime;
+    pxSnapshot->ucStationCount = pxPoll->ucStationCount;
+    memcpy( pxSnapshot->xStations,
+            pxPoll->xStations,
+            pxPoll->ucStationCount * sizeof( MeterPollStation_t ) );
+}
+/*-----------------------------------------------------------*/
+
+void MeterPoll_ComposeRequest( uint8_t * pucRequest,
+                               uint8_t ucAddress,
+                               uint16_t usStartRegister,
+                               uint16_t usRegisterCount )
+{
+    uint16_t usCrc;
+
+    pucRequest[ 0 ] = ucAddress;
+    pucRequest[ 1 ] = meterpollREAD_HOLDING_REGISTERS;
+    pucRequest[ 2 ] = ( uint8_t ) ( usStartRegister >> 8 );
+    pucRequest[ 3 ] = ( uint8_t ) ( usStartRegister & 0xFFU );
+    pucRequest[ 4 ] = ( uint8_t ) ( usRegisterCount >> 8 );
+    pucRequest[ 5 ] = ( uint8_t ) ( usRegisterCount & 0xFFU );
+
+    usCrc = ModbusRtu_Crc16( pucRequest, meterpollREQUEST_LENGTH - modbusrtuCRC_LENGTH );
+    pucRequest[ 6 ] = ( uint8_t ) ( usCrc & 0xFFU );
+    pucRequest[ 7 ] = ( uint8_t ) ( usCrc >> 8 );
+}
+/*-----------------------------------------------------------*/
+
+bool MeterPoll_DecodeReading( const uint8_t * pucFrame,
+                              size_t xLength,
+                              MeterReading_t * pxReading )
+{
+    if( ( xLength != meterpollREPLY_LENGTH ) ||
+        ( pucFrame[ 1 ] != meterpollREAD_HOLDING_REGISTERS ) ||
+        ( ModbusRtu_CrcValid( pucFrame, xLength ) == false ) )
+    {
+        return false;
+    }
+
+    pxReading->ucStationId = pucFrame[ 0 ];
+    pxReading->ullAmount = prvGetWide( &pucFrame[ meterpollOFFSET_AMOUNT ] );
+    pxReading->ucAmountPlaces = pucFrame[ meterpollOFFSET_AMOUNT_PLACES ];
+    pxReading->ullReverseAmount = prvGetWide( &pucFrame[ meterpollOFFSET_REVERSE_AMOUNT ] );
+    pxReading->ucReverseAmountPlaces = pucFrame[ meterpollOFFSET_REVERSE_PLACES ];
+    pxReading->usLDay = prvGetShort( &pucFrame[ meterpollOFFSET_LDAY ] );
+    pxReading->usNDay = prvGetShort( &pucFrame[ meterpollOFFSET_NDAY ] );
+    pxReading->usODay = prvGetShort( &pucFrame[ meterpollOFFSET_ODAY ] );
+    pxReading->usUDay = prvGetShort( &pucFrame[ meterpollOFFSET_UDAY ] );
+    pxReading->usHDay = prvGetShort( &pucFrame[ meterpollOFFSET_HDAY ] );
+    pxReading->usBDay = prvGetShort( &pucFrame[ meterpollOFFSET_BDAY ] );
+    pxReading->usOp = ( uint16_t ) ( ( pucFrame[ meterpollOFFSET_OP_HIGH ] << 8 ) |
+                                     pucFrame[ meterpollOFFSET_OP_LOW ] );
+    pxReading->ullMeterId = prvGetWide( &pucFrame[ meterpollOFFSET_METER_ID ] );
+
+    return true;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,237 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file meter_poll.h
+ * @brief Round-robin polling of the water meters sharing one RS-485 segment.
+ *
+ * The scheduler keeps one compact state entry per station and walks the
+ * stations back to back: the next request goes out as soon as the previous
+ * reply was delimited (or timed out), without waiting for a consumer. A
+ * consistent copy of the whole table is taken once per round and handed to
+ * the publishers as a snapshot.
+ *
+ * It is transport agnostic. The caller supplies a send function and steps
+ * the scheduler with the received frames and the current time, so the same
+ * code runs over the interrupt driven line on the board and over a simulated
+ * bus on the host.
+ */
+
+#ifndef _METER_POLL_H_
+#define _METER_POLL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @brief Largest number of meters on one segment.
+ */
+#ifndef meterpollMAX_STATIONS
+    #define meterpollMAX_STATIONS          ( 32U )
+#endif
+
+/**
+ * @brief Length of a read holding registers request.
+ */
+#define meterpollREQUEST_LENGTH            ( 8U )
+
+/**
+ * @brief Length of the reply to the meter register block (0x14 registers).
+ */
+#define meterpollREPLY_LENGTH              ( 45U )
+
+/**
+ * @brief Returned by MeterPoll_Step() when the round is complete.
+ */
+#define meterpollROUND_COMPLETE            ( 0xFFFFFFFFUL )
+
+/**
+ * @brief Outcome of the last poll of a station.
+ */
+typedef enum MeterPollStatus
+{
+    METER_POLL_NEVER = 0,   /**< Not polled yet. */
+    METER_POLL_OK,          /**< Reading is from the last round. */
+    METER_POLL_TIMEOUT,     /**< No reply after all retries. */
+    METER_POLL_BAD_REPLY    /**< Replies were received but none was valid. */
+} MeterPollStatus_t;
+
+/**
+ * @brief Decoded content of the meter register block.
+ */
+typedef struct MeterReading
+{
+    uint64_t ullMeterId;
+    uint64_t ullAmount;
+    uint64_t ullReverseAmount;
+    uint16_t usLDay;
+    uint16_t usNDay;
+    uint16_t usODay;
+    uint16_t usUDay;
+    uint16_t usHDay;
+    uint16_t usBDay;
+    uint16_t usOp;
+    uint8_t ucStationId;
+    uint8_t ucAmountPlaces;
+    uint8_t ucReverseAmountPlaces;
+} MeterReading_t;
+
+/**
+ * @brief Per-station entry of the state table.
+ */
+typedef struct MeterPollStation
+{
+    MeterReading_t xReading;
+    uint32_t ulRound;           /**< Round in which xReading was taken. */
+    uint32_t ulReadTime;        /**< Time at which xReading was taken. */
+    uint16_t usRequests;
+    uint16_t usTimeouts;
+    uint16_t usBadReplies;
+    uint8_t ucAddress;
+    uint8_t ucStatus;           /**< MeterPollStatus_t. */
+} MeterPollStation_t;
+
+/**
+ * @brief Sends a request on the bus. Must not block for the reply.
+ */
+typedef void (* MeterPollSend_t)( void * pvContext,
+                                  const uint8_t * pucRequest,
+                                  size_t xLength );
+
+/**
+ * @brief Scheduler configuration. Times use the unit of the caller clock.
+ */
+typedef struct MeterPollConfig
+{
+    uint16_t usStartRegister;
+    uint16_t usRegisterCount;
+    uint32_t ulReplyTimeout;    /**< From request sent to reply delimited. */
+    uint32_t ulTurnaround;      /**< Extra idle time before the next request. */
+    uint8_t ucMaxRetries;
+    MeterPollSend_t xSend;
+    void * pvSendContext;
+} MeterPollConfig_t;
+
+/**
+ * @brief Scheduler state.
+ */
+typedef struct MeterPoll
+{
+    MeterPollConfig_t xConfig;
+    MeterPollStation_t xStations[ meterpollMAX_STATIONS ];
+    uint8_t ucStationCount;
+    uint8_t ucCurrent;          /**< Station being polled. */
+    uint8_t ucAttempt;          /**< Attempts on the current station. */
+    uint8_t ucState;
+    bool xBadReply;             /**< An invalid reply was seen this attempt. */
+    uint32_t ulDeadline;
+    uint32_t ulRound;
+    uint32_t ulRoundStart;
+    uint32_t ulLastRoundTime;   /**< Duration of the last complete round. */
+    uint8_t ucRequest[ meterpollREQUEST_LENGTH ];
+} MeterPoll_t;
+
+/**
+ * @brief Copy of the state table published once per round.
+ */
+typedef struct MeterPollSnapshot
+{
+    uint32_t ulRound;
+    uint32_t ulRoundTime;
+    uint8_t ucStationCount;
+    MeterPollStation_t xStations[ meterpollMAX_STATIONS ];
+} MeterPollSnapshot_t;
+
+/**
+ * @brief Initialize the scheduler with the addresses of the stations.
+ */
+void MeterPoll_Init( MeterPoll_t * pxPoll,
+                     const MeterPollConfig_t * pxConfig,
+                     const uint8_t * pucAddresses,
+                     uint8_t ucStationCount );
+
+/**
+ * @brief Begin a new round at time @p ulNow.
+ *
+ * The first request is sent by the following call to MeterPoll_Step().
+ */
+void MeterPoll_StartRound( MeterPoll_t * pxPoll,
+                           uint32_t ulNow );
+
+/**
+ * @brief Advance the scheduler.
+ *
+ * Call it once after MeterPoll_StartRound(), then each time a frame is
+ * received and each time the previously returned delay elapses.
+ *
+ * @param[in] ulNow Current time.
+ * @param[in] pucFrame Received frame, NULL when stepping on a timeout.
+ * @param[in] xFrameLength Length of @p pucFrame.
+ *
+ * @return Time until the scheduler must be stepped again if no frame
+ * arrives, or meterpollROUND_COMPLETE.
+ */
+uint32_t MeterPoll_Step( MeterPoll_t * pxPoll,
+                         uint32_t ulNow,
+                         const uint8_t * pucFrame,
+                         size_t xFrameLength );
+
+/**
+ * @brief Copy the state table into @p pxSnapshot.
+ */
+void MeterPoll_Snapshot( const MeterPoll_t * pxPoll,
+                         MeterPollSnapshot_t * pxSnapshot );
+
+/**
+ * @brief Build a read holding registers request.
+ */
+void MeterPoll_ComposeRequest( uint8_t * pucRequest,
+                               uint8_t ucAddress,
+                               uint16_t usStartRegister,
+                               uint16_t usRegisterCount );
+
+/**
+ * @brief Decode a meter reply.
+ *
+ * @return true if @p pucFrame is a valid reply of @p xLength bytes.
+ */
+bool MeterPoll_DecodeReading( const uint8_t * pucFrame,
+                              size_t xLength,
+                              MeterReading_t * pxReading );
+
+/**
+ * @brief Copy the snapshot of the last complete round.
+ *
+ * Provided by the application task that owns the meter bus. The round is
+ * then handed over to the caller: the application no longer journals its
+ * readings, and the caller journals those it fails to deliver with
+ * WaterMeter_JournalAppend().
+ *
+ * @return false if no round has completed yet.
+ */
+bool WaterMeter_GetSnapshot( MeterPollSnapshot_t * pxSnapshot );
+
+#endif /* _METER_POLL_H_ */
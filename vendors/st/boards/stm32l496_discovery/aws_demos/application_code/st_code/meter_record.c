@@ -0,0 +1,418 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file meter_record.c
+ * @brief Schema driven encoder of the meter telemetry record.
+ */
+
+/* The config header is always included first. */
+#include "iot_config.h"
+
+#include <string.h>
+
+#include "iot_serializer.h"
+
+#include "meter_record.h"
+
+/* Width of a field in the reading, taken from the member itself. */
+#define meterrecordFIELD_U8     ( 1U )
+#define meterrecordFIELD_U16    ( 2U )
+#define meterrecordFIELD_U64    ( 8U )
+
+/* One entry of the record schema. The JSON key is stored as the complete
+ * fragment preceding the value, so it is copied with a single memcpy. */
+#define meterrecordFIELD( pcJsonKey, pcCborKey, xMember )          \
+    {                                                              \
+        ",\"" pcJsonKey "\":",                                     \
+        ( uint8_t ) ( sizeof( ",\"" pcJsonKey "\":" ) - 1U ),      \
+        pcCborKey,                                                 \
+        ( uint8_t ) offsetof( MeterReading_t, xMember ),           \
+        ( uint8_t ) sizeof( ( ( MeterReading_t * ) 0 )->xMember ) \
+    }
+
+/* JSON fragments around the time stamp. */
+#define meterrecordJSON_TIMESTAMP_KEY         "{\"timestamp\":\""
+#define meterrecordJSON_TIMESTAMP_END         "Z\""
+#define meterrecordCBOR_TIMESTAMP_KEY         "t"
+
+/* Longest decimal rendering of a 64-bit value. */
+#define meterrecordMAX_DECIMAL_DIGITS         ( 20U )
+
+/* Longest JSON field value, key fragment excluded. */
+#define meterrecordMAX_JSON_VALUE_LENGTH      meterrecordMAX_DECIMAL_DIGITS
+
+/* "YYYY-MM-DDTHH:MM:SS" */
+#define meterrecordISO8601_LENGTH             ( 19U )
+
+/* Delimiters of a batch. The CBOR array has an indefinite length, so records
+ * can be added without knowing their count up front. */
+#define meterrecordJSON_ARRAY_START           ( ( uint8_t ) '[' )
+#define meterrecordJSON_ARRAY_SEPARATOR       ( ( uint8_t ) ',' )
+#define meterrecordJSON_ARRAY_END             ( ( uint8_t ) ']' )
+#define meterrecordCBOR_ARRAY_START           ( ( uint8_t ) 0x9FU )
+#define meterrecordCBOR_ARRAY_END             ( ( uint8_t ) 0xFFU )
+
+typedef struct MeterRecordField
+{
+    const char * pcJsonKey;
+    uint8_t ucJsonKeyLength;
+    const char * pcCborKey;
+    uint8_t ucOffset;
+    uint8_t ucWidth;
+} MeterRecordField_t;
+
+/*
+ * Record schema, in publishing order. The JSON keys are the ones of the
+ * original demo and must not change, the CBOR keys are free.
+ */
+static const MeterRecordField_t xMeterRecordSchema[] =
+{
+    meterrecordFIELD( "STATION_NO",            "s",  ucStationId           ),
+    meterrecordFIELD( "METER_NO",              "m",  ullMeterId            ),
+    meterrecordFIELD( "AMOUNT",                "a",  ullAmount             ),
+    meterrecordFIELD( "AMOUNT_PLACES",         "ap", ucAmountPlaces        ),
+    meterrecordFIELD( "REVERSE_AMOUNT",        "r",  ullReverseAmount      ),
+    meterrecordFIELD( "REVERSE_AMOUNT_PLACES", "rp", ucReverseAmountPlaces ),
+    meterrecordFIELD( "LDAY",                  "ld", usLDay                ),
+    meterrecordFIELD( "NDAY",                  "nd", usNDay                ),
+    meterrecordFIELD( "ODAY",                  "od", usODay                ),
+    meterrecordFIELD( "UDAY",                  "ud", usUDay                ),
+    meterrecordFIELD( "HDAY",                  "hd", usHDay                ),
+    meterrecordFIELD( "BDAY",                  "bd", usBDay                ),
+    meterrecordFIELD( "OP",                    "op", usOp                  )
+};
+
+#define meterrecordFIELD_COUNT    ( sizeof( xMeterRecordSchema ) / sizeof( xMeterRecordSchema[ 0 ] ) )
+
+/*-----------------------------------------------------------*/
+
+static uint64_t prvFieldValue( const MeterReading_t * pxReading,
+                               const MeterRecordField_t * pxField )
+{
+    const uint8_t * pucMember = ( const uint8_t * ) pxReading + pxField->ucOffset;
+    uint64_t ullValue;
+
+    switch( pxField->ucWidth )
+    {
+        case meterrecordFIELD_U8:
+            ullValue = *pucMember;
+            break;
+
+        case meterrecordFIELD_U16:
+            ullValue = *( const uint16_t * ) pucMember;
+            break;
+
+        default:
+            ullValue = *( const uint64_t * ) pucMember;
+            break;
+    }
+
+    return ullValue;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Write the decimal digits of a 32-bit value, return the number of digits. */
+static size_t prvWriteDecimal32( char * pcOut,
+                                 uint32_t ulValue,
+                                 size_t xMinDigits )
+{
+    char cDigits[ 10 ];
+    size_t xCount = 0, i;
+
+    do
+    {
+        cDigits[ xCount++ ] = ( char ) ( '0' + ( ulValue % 10U ) );
+        ulValue /= 10U;
+    } while( ( ulValue != 0U ) || ( xCount < xMinDigits ) );
+
+    for( i = 0; i < xCount; i++ )
+    {
+        pcOut[ i ] = cDigits[ xCount - 1U - i ];
+    }
+
+    return xCount;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Write the decimal digits of a 64-bit value. 64-bit divisions are library
+ * calls on the target, so the value is split in 9 digit groups first. */
+static size_t prvWriteDecimal( char * pcOut,
+                               uint64_t ullValue )
+{
+    size_t xLength;
+
+    if( ullValue <= UINT32_MAX )
+    {
+        xLength = prvWriteDecimal32( pcOut, ( uint32_t ) ullValue, 1U );
+    }
+    else
+    {
+        xLength = prvWriteDecimal( pcOut, ullValue / 1000000000ULL );
+        xLength += prvWriteDecimal32( pcOut + xLength,
+                                      ( uint32_t ) ( ullValue % 1000000000ULL ),
+                                      9U );
+    }
+
+    return xLength;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Render seconds since the Unix epoch as "YYYY-MM-DDTHH:MM:SS" (UTC). */
+static void prvWriteIso8601( char * pcOut,
+                             uint32_t ulTimestamp )
+{
+    uint32_t ulDays = ulTimestamp / 86400U;
+    uint32_t ulSeconds = ulTimestamp % 86400U;
+    uint32_t ulEra, ulDayOfEra, ulYearOfEra, ulDayOfYear, ulMonthIndex;
+    uint32_t ulYear, ulMonth, ulDay;
+
+    /* Civil from days, with eras of 400 years starting on March 1st. */
+    ulDays += 719468U;
+    ulEra = ulDays / 146097U;
+    ulDayOfEra = ulDays - ( ulEra * 146097U );
+    ulYearOfEra = ( ulDayOfEra - ( ulDayOfEra / 1460U ) + ( ulDayOfEra / 36524U ) -
+                    ( ulDayOfEra / 146096U ) ) / 365U;
+    ulDayOfYear = ulDayOfEra - ( ( 365U * ulYearOfEra ) + ( ulYearOfEra / 4U ) - ( ulYearOfEra / 100U ) );
+    ulMonthIndex = ( ( 5U * ulDayOfYear ) + 2U ) / 153U;
+    ulDay = ulDayOfYear - ( ( ( 153U * ulMonthIndex ) + 2U ) / 5U ) + 1U;
+    ulMonth = ( ulMonthIndex < 10U ) ? ( ulMonthIndex + 3U ) : ( ulMonthIndex - 9U );
+    ulYear = ulYearOfEra + ( ulEra * 400U ) + ( ( ulMonth <= 2U ) ? 1U : 0U );
+
+    ( void ) prvWriteDecimal32( &pcOut[ 0 ], ulYear, 4U );
+    pcOut[ 4 ] = '-';
+    ( void ) prvWriteDecimal32( &pcOut[ 5 ], ulMonth, 2U );
+    pcOut[ 7 ] = '-';
+    ( void ) prvWriteDecimal32( &pcOut[ 8 ], ulDay, 2U );
+    pcOut[ 10 ] = 'T';
+    ( void ) prvWriteDecimal32( &pcOut[ 11 ], ulSeconds / 3600U, 2U );
+    pcOut[ 13 ] = ':';
+    ( void ) prvWriteDecimal32( &pcOut[ 14 ], ( ulSeconds / 60U ) % 60U, 2U );
+    pcOut[ 16 ] = ':';
+    ( void ) prvWriteDecimal32( &pcOut[ 17 ], ulSeconds % 60U, 2U );
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t prvEncodeJson( const MeterReading_t * pxReading,
+                             uint32_t ulTimestamp,
+                             char * pcOut,
+                             size_t xBufferLength )
+{
+    const MeterRecordField_t * pxField;
+    size_t xLength = 0, i;
+
+    if( xBufferLength < ( sizeof( meterrecordJSON_TIMESTAMP_KEY ) - 1U ) + meterrecordISO8601_LENGTH +
+        ( sizeof( meterrecordJSON_TIMESTAMP_END ) - 1U ) )
+    {
+        return 0;
+    }
+
+    memcpy( pcOut, meterrecordJSON_TIMESTAMP_KEY, sizeof( meterrecordJSON_TIMESTAMP_KEY ) - 1U );
+    xLength += sizeof( meterrecordJSON_TIMESTAMP_KEY ) - 1U;
+    prvWriteIso8601( &pcOut[ xLength ], ulTimestamp );
+    xLength += meterrecordISO8601_LENGTH;
+    memcpy( &pcOut[ xLength ], meterrecordJSON_TIMESTAMP_END, sizeof( meterrecordJSON_TIMESTAMP_END ) - 1U );
+    xLength += sizeof( meterrecordJSON_TIMESTAMP_END ) - 1U;
+
+    for( i = 0; i < meterrecordFIELD_COUNT; i++ )
+    {
+        pxField = &xMeterRecordSchema[ i ];
+
+        /* Check the worst case once per field instead of once per byte. */
+        if( ( xBufferLength - xLength ) < ( pxField->ucJsonKeyLength + meterrecordMAX_JSON_VALUE_LENGTH ) )
+        {
+            return 0;
+        }
+
+        memcpy( &pcOut[ xLength ], pxField->pcJsonKey, pxField->ucJsonKeyLength );
+        xLength += pxField->ucJsonKeyLength;
+        xLength += prvWriteDecimal( &pcOut[ xLength ], prvFieldValue( pxReading, pxField ) );
+    }
+
+    if( xLength == xBufferLength )
+    {
+        return 0;
+    }
+
+    pcOut[ xLength++ ] = '}';
+
+    return xLength;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t prvEncodeCbor( const MeterReading_t * pxReading,
+                             uint32_t ulTimestamp,
+                             uint8_t * pucOut,
+                             size_t xBufferLength )
+{
+    const IotSerializerEncodeInterface_t * pxEncoder = &_IotSerializerCborEncoder;
+    IotSerializerEncoderObject_t xStream = IOT_SERIALIZER_ENCODER_CONTAINER_INITIALIZER_STREAM;
+    IotSerializerEncoderObject_t xMap = IOT_SERIALIZER_ENCODER_CONTAINER_INITIALIZER_MAP;
+    IotSerializerError_t xError;
+    size_t xLength = 0, i;
+
+    if( pxEncoder->init( &xStream, pucOut, xBufferLength ) != IOT_SERIALIZER_SUCCESS )
+    {
+        return 0;
+    }
+
+    xError = pxEncoder->openContainer( &xStream, &xMap, meterrecordFIELD_COUNT + 1U );
+
+    if( xError == IOT_SERIALIZER_SUCCESS )
+    {
+        xError = pxEncoder->appendKeyValue( &xMap,
+                                            meterrecordCBOR_TIMESTAMP_KEY,
+                                            IotSerializer_ScalarSignedInt( ulTimestamp ) );
+    }
+
+    for( i = 0; ( i < meterrecordFIELD_COUNT ) && ( xError == IOT_SERIALIZER_SUCCESS ); i++ )
+    {
+        /* Fields are at most 48 bits wide, they fit a signed integer. */
+        xError = pxEncoder->appendKeyValue( &xMap,
+                                            xMeterRecordSchema[ i ].pcCborKey,
+                                            IotSerializer_ScalarSignedInt(
+                                                ( int64_t ) prvFieldValue( pxReading, &xMeterRecordSchema[ i ] ) ) );
+    }
+
+    /* An opened map must be closed to release its encoder, even on error. */
+    if( ( xMap.pHandle != NULL ) &&
+        ( pxEncoder->closeContainer( &xStream, &xMap ) != IOT_SERIALIZER_SUCCESS ) )
+    {
+        xError = IOT_SERIALIZER_BUFFER_TOO_SMALL;
+    }
+
+    if( xError == IOT_SERIALIZER_SUCCESS )
+    {
+        xLength = pxEncoder->getEncodedSize( &xStream, pucOut );
+    }
+
+    pxEncoder->destroy( &xStream );
+
+    return xLength;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t MeterRecord_Encode( MeterRecordFormat_t xFormat,
+                           const MeterReading_t * pxReading,
+                           uint32_t ulTimestamp,
+                           uint8_t * pucBuffer,
+                           size_t xBufferLength )
+{
+    size_t xLength;
+
+    if( xFormat == METER_RECORD_FORMAT_CBOR )
+    {
+        xLength = prvEncodeCbor( pxReading, ulTimestamp, pucBuffer, xBufferLength );
+    }
+    else
+    {
+        xLength = prvEncodeJson( pxReading, ulTimestamp, ( char * ) pucBuffer, xBufferLength );
+    }
+
+    return xLength;
+}
+
+/*-----------------------------------------------------------*/
+
+bool MeterRecord_BatchInit( MeterRecordBatch_t * pxBatch,
+                            MeterRecordFormat_t xFormat,
+                            uint8_t * pucBuffer,
+                            size_t xBufferLength )
+{
+    /* Room for the opening and closing bytes. */
+    if( xBufferLength < 2U )
+    {
+        return false;
+    }
+
+    pxBatch->xFormat = xFormat;
+    pxBatch->pucBuffer = pucBuffer;
+    pxBatch->xBufferLength = xBufferLength;
+    pxBatch->xCount = 0;
+    pxBatch->xLength = 1;
+    pucBuffer[ 0 ] = ( xFormat == METER_RECORD_FORMAT_CBOR ) ?
+                     meterrecordCBOR_ARRAY_START : meterrecordJSON_ARRAY_START;
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+bool MeterRecord_BatchAppend( MeterRecordBatch_t * pxBatch,
+                              const MeterReading_t * pxReading,
+                              uint32_t ulTimestamp )
+{
+    size_t xOffset = pxBatch->xLength;
+    size_t xLength;
+
+    /* JSON elements are comma separated, CBOR items follow each other. */
+    if( ( pxBatch->xFormat != METER_RECORD_FORMAT_CBOR ) && ( pxBatch->xCount > 0U ) )
+    {
+        xOffset++;
+    }
+
+    /* Keep one byte for the end of the array. */
+    if( xOffset + 1U >= pxBatch->xBufferLength )
+    {
+        return false;
+    }
+
+    xLength = MeterRecord_Encode( pxBatch->xFormat,
+                                  pxReading,
+                                  ulTimestamp,
+                                  &pxBatch->pucBuffer[ xOffset ],
+                                  pxBatch->xBufferLength - xOffset - 1U );
+
+    if( xLength == 0U )
+    {
+        return false;
+    }
+
+    if( xOffset != pxBatch->xLength )
+    {
+        pxBatch->pucBuffer[ pxBatch->xLength ] = meterrecordJSON_ARRAY_SEPARATOR;
+    }
+
+    pxBatch->xLength = xOffset + xLength;
+    pxBatch->xCount++;
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t MeterRecord_BatchFinish( MeterRecordBatch_t * pxBatch )
+{
+    pxBatch->pucBuffer[ pxBatch->xLength ] = ( pxBatch->xFormat == METER_RECORD_FORMAT_CBOR ) ?
+                                             meterrecordCBOR_ARRAY_END : meterrecordJSON_ARRAY_END;
+
+    return pxBatch->xLength + 1U;
+}
@@ -0,0 +1,128 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file meter_record.h
+ * @brief Schema driven encoder of the meter telemetry record.
+ *
+ * A reading is serialized straight into the caller's publish buffer, either
+ * as compact CBOR through the iot_serializer tinycbor backend or as the JSON
+ * document published by the original demo. Both encodings walk the same
+ * field table, so adding a field to the record is a one line change.
+ */
+
+#ifndef _METER_RECORD_H_
+#define _METER_RECORD_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "meter_poll.h"
+
+/**
+ * @brief Upper bound of an encoded JSON record.
+ */
+#define meterrecordMAX_JSON_LENGTH    ( 320U )
+
+/**
+ * @brief Upper bound of an encoded CBOR record.
+ */
+#define meterrecordMAX_CBOR_LENGTH    ( 192U )
+
+/**
+ * @brief Buffer size that fits a record in any format.
+ */
+#define meterrecordMAX_LENGTH         meterrecordMAX_JSON_LENGTH
+
+/**
+ * @brief Wire format of a record.
+ */
+typedef enum MeterRecordFormat
+{
+    METER_RECORD_FORMAT_JSON = 0, /**< Text, key names of the original demo. */
+    METER_RECORD_FORMAT_CBOR      /**< RFC 7049 map with short text keys. */
+} MeterRecordFormat_t;
+
+/**
+ * @brief Encode one reading.
+ *
+ * JSON records carry the time stamp as an ISO 8601 UTC string, CBOR records
+ * as an integer number of seconds since the Unix epoch.
+ *
+ * @param[in] xFormat Wire format.
+ * @param[in] pxReading Reading to encode.
+ * @param[in] ulTimestamp Seconds since the Unix epoch.
+ * @param[out] pucBuffer Destination, typically the PUBLISH payload buffer.
+ * @param[in] xBufferLength Size of @p pucBuffer.
+ *
+ * @return Length of the record, 0 if it does not fit in @p pucBuffer.
+ */
+size_t MeterRecord_Encode( MeterRecordFormat_t xFormat,
+                           const MeterReading_t * pxReading,
+                           uint32_t ulTimestamp,
+                           uint8_t * pucBuffer,
+                           size_t xBufferLength );
+
+/**
+ * @brief Batch of records encoded into one payload: a JSON array, or a CBOR
+ * indefinite length array.
+ */
+typedef struct MeterRecordBatch
+{
+    MeterRecordFormat_t xFormat;
+    uint8_t * pucBuffer;
+    size_t xBufferLength;
+    size_t xLength;   /**< Bytes used, without the closing byte. */
+    size_t xCount;    /**< Records in the batch. */
+} MeterRecordBatch_t;
+
+/**
+ * @brief Start a batch in @p pucBuffer.
+ *
+ * @return false if the buffer cannot hold an empty batch.
+ */
+bool MeterRecord_BatchInit( MeterRecordBatch_t * pxBatch,
+                            MeterRecordFormat_t xFormat,
+                            uint8_t * pucBuffer,
+                            size_t xBufferLength );
+
+/**
+ * @brief Add one reading to a batch.
+ *
+ * @return false if the record does not fit, the batch is left unchanged.
+ */
+bool MeterRecord_BatchAppend( MeterRecordBatch_t * pxBatch,
+                              const MeterReading_t * pxReading,
+                              uint32_t ulTimestamp );
+
+/**
+ * @brief Close a batch.
+ *
+ * @return Length of the payload.
+ */
+size_t MeterRecord_BatchFinish( MeterRecordBatch_t * pxBatch );
+
+#endif /* _METER_RECORD_H_ */
@@ -0,0 +1,420 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file modbus_rtu.c
+ * @brief Interrupt driven software UART and Modbus RTU framer.
+ */
+
+#include <string.h>
+
+#include "modbus_rtu.h"
+
+/* Number of bits in an 8N1 character, start and stop bits included. */
+#define modbusrtuBITS_PER_CHAR         ( 10U )
+
+/* Index of the stop bit within a character. */
+#define modbusrtuSTOP_BIT              ( 9U )
+
+/* Above 19200 bit/s the protocol fixes the silent interval to 1750 us. */
+#define modbusrtuFIXED_GAP_BAUD_RATE   ( 19200U )
+#define modbusrtuFIXED_GAP_US          ( 1750U )
+
+/* Bytes used in front of each frame in the receive ring. */
+#define modbusrtuRING_HEADER_LENGTH    ( 2U )
+
+#define modbusrtuRING_MASK             ( modbusrtuRX_RING_SIZE - 1U )
+
+#if ( modbusrtuRX_RING_SIZE & modbusrtuRING_MASK ) != 0
+    #error "modbusrtuRX_RING_SIZE must be a power of two."
+#endif
+
+/*-----------------------------------------------------------*/
+
+static const uint16_t usCrcTable[ 256 ] =
+{
+    0x0000, 0xc0c1, 0xc181, 0x0140, 0xc301, 0x03c0, 0x0280, 0xc241,
+    0xc601, 0x06c0, 0x0780, 0xc741, 0x0500, 0xc5c1, 0xc481, 0x0440,
+    0xcc01, 0x0cc0, 0x0d80, 0xcd41, 0x0f00, 0xcfc1, 0xce81, 0x0e40,
+    0x0a00, 0xcac1, 0xcb81, 0x0b40, 0xc901, 0x09c0, 0x0880, 0xc841,
+    0xd801, 0x18c0, 0x1980, 0xd941, 0x1b00, 0xdbc1, 0xda81, 0x1a40,
+    0x1e00, 0xdec1, 0xdf81, 0x1f40, 0xdd01, 0x1dc0, 0x1c80, 0xdc41,
+    0x1400, 0xd4c1, 0xd581, 0x1540, 0xd701, 0x17c0, 0x1680, 0xd641,
+    0xd201, 0x12c0, 0x1380, 0xd341, 0x1100, 0xd1c1, 0xd081, 0x1040,
+    0xf001, 0x30c0, 0x3180, 0xf141, 0x3300, 0xf3c1, 0xf281, 0x3240,
+    0x3600, 0xf6c1, 0xf781, 0x3740, 0xf501, 0x35c0, 0x3480, 0xf441,
+    0x3c00, 0xfcc1, 0xfd81, 0x3d40, 0xff01, 0x3fc0, 0x3e80, 0xfe41,
+    0xfa01, 0x3ac0, 0x3b80, 0xfb41, 0x3900, 0xf9c1, 0xf881, 0x3840,
+    0x2800, 0xe8c1, 0xe981, 0x2940, 0xeb01, 0x2bc0, 0x2a80, 0xea41,
+    0xee01, 0x2ec0, 0x2f80, 0xef41, 0x2d00, 0xedc1, 0xec81, 0x2c40,
+    0xe401, 0x24c0, 0x2580, 0xe541, 0x2700, 0xe7c1, 0xe681, 0x2640,
+    0x2200, 0xe2c1, 0xe381, 0x2340, 0xe101, 0x21c0, 0x2080, 0xe041,
+    0xa001, 0x60c0, 0x6180, 0xa141, 0x6300, 0xa3c1, 0xa281, 0x6240,
+    0x6600, 0xa6c1, 0xa781, 0x6740, 0xa501, 0x65c0, 0x6480, 0xa441,
+    0x6c00, 0xacc1, 0xad81, 0x6d40, 0xaf01, 0x6fc0, 0x6e80, 0xae41,
+    0xaa01, 0x6ac0, 0x6b80, 0xab41, 0x6900, 0xa9c1, 0xa881, 0x6840,
+    0x7800, 0xb8c1, 0xb981, 0x7940, 0xbb01, 0x7bc0, 0x7a80, 0xba41,
+    0xbe01, 0x7ec0, 0x7f80, 0xbf41, 0x7d00, 0xbdc1, 0xbc81, 0x7c40,
+    0xb401, 0x74c0, 0x7580, 0xb541, 0x7700, 0xb7c1, 0xb681, 0x7640,
+    0x7200, 0xb2c1, 0xb381, 0x7340, 0xb101, 0x71c0, 0x7080, 0xb041,
+    0x5000, 0x90c1, 0x9181, 0x5140, 0x9301, 0x53c0, 0x5280, 0x9241,
+    0x9601, 0x56c0, 0x5780, 0x9741, 0x5500, 0x95c1, 0x9481, 0x5440,
+    0x9c01, 0x5cc0, 0x5d80, 0x9d41, 0x5f00, 0x9fc1, 0x9e81, 0x5e40,
+    0x5a00, 0x9ac1, 0x9b81, 0x5b40, 0x9901, 0x59c0, 0x5880, 0x9841,
+    0x8801, 0x48c0, 0x4980, 0x8941, 0x4b00, 0x8bc1, 0x8a81, 0x4a40,
+    0x4e00, 0x8ec1, 0x8f81, 0x4f40, 0x8d01, 0x4dc0, 0x4c80, 0x8c41,
+    0x4400, 0x84c1, 0x8581, 0x4540, 0x8701, 0x47c0, 0x4680, 0x8641,
+    0x8201, 0x42c0, 0x4380, 0x8341, 0x4100, 0x81c1, 0x8081, 0x4040
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Offset from the start edge to the middle of bit @p ulBit.
+ *
+ * Computed from the start edge for every bit so that the rounding error of
+ * the bit period does not accumulate across the character.
+ */
+static uint32_t prvBitCentre( const ModbusRtuLine_t * pxLine,
+                              uint32_t ulBit )
+{
+    return ( ( ( 2U * ulBit ) + 1U ) * pxLine->ulTimerHz ) / ( 2U * pxLine->ulBaudRate );
+}
+/*-----------------------------------------------------------*/
+
+static void prvFrameCommit( ModbusRtuLine_t * pxLine )
+{
+    uint32_t ulFree = modbusrtuRX_RING_SIZE - ( pxLine->ulRingHead - pxLine->ulRingTail );
+    uint16_t usLength = pxLine->usRxFrameLength;
+    uint32_t ulHead = pxLine->ulRingHead;
+    uint16_t i;
+
+    pxLine->xRxInFrame = false;
+
+    if( pxLine->xRxFrameError == true )
+    {
+        pxLine->xStats.ulFramingErrors++;
+    }
+    else if( ( usLength == 0U ) ||
+             ( ( uint32_t ) usLength + modbusrtuRING_HEADER_LENGTH > ulFree ) )
+    {
+        pxLine->xStats.ulOverruns++;
+    }
+    else
+    {
+        /* Fill the ring through a local head so the reader never sees a
+         * partially written frame. */
+        pxLine->ucRing[ ulHead++ & modbusrtuRING_MASK ] = ( uint8_t ) ( usLength & 0xFFU );
+        pxLine->ucRing[ ulHead++ & modbusrtuRING_MASK ] = ( uint8_t ) ( usLength >> 8 );
+
+        for( i = 0; i < usLength; i++ )
+        {
+            pxLine->ucRing[ ulHead++ & modbusrtuRING_MASK ] = pxLine->ucRxFrame[ i ];
+        }
+
+        pxLine->ulRingHead = ulHead;
+        pxLine->xStats.ulFrames++;
+
+        if( pxLine->xFrameCallback != NULL )
+        {
+            pxLine->xFrameCallback( pxLine->pvCallbackContext );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvCharComplete( ModbusRtuLine_t * pxLine,
+                             uint8_t ucStopLevel )
+{
+    pxLine->xRxInChar = false;
+    pxLine->ulRxLastCharEnd = pxLine->ulRxCharStart + pxLine->ulCharTicks;
+    pxLine->xStats.ulCharacters++;
+
+    if( ucStopLevel == 0U )
+    {
+        pxLine->xRxFrameError = true;
+    }
+    else if( pxLine->usRxFrameLength < modbusrtuMAX_FRAME_LENGTH )
+    {
+        pxLine->ucRxFrame[ pxLine->usRxFrameLength++ ] = pxLine->ucRxShift;
+    }
+    else
+    {
+        /* Longer than any legal frame, it cannot be ours. */
+        pxLine->xRxFrameError = true;
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Sample every bit centre reached by @p ulTick with the current level.
+ *
+ * @param[in] xInclusive When an edge is being processed, a bit centre falling
+ * exactly on the edge belongs to the previous level.
+ */
+static void prvSampleUntil( ModbusRtuLine_t * pxLine,
+                            uint32_t ulTick,
+                            bool xInclusive )
+{
+    int32_t lDelta;
+
+    while( pxLine->xRxInChar == true )
+    {
+        lDelta = ( int32_t ) ( ulTick - ( pxLine->ulRxCharStart +
+                                          prvBitCentre( pxLine, pxLine->ucRxBit ) ) );
+
+        if( ( lDelta < 0 ) || ( ( lDelta == 0 ) && ( xInclusive == false ) ) )
+        {
+            break;
+        }
+
+        if( pxLine->ucRxBit == 0U )
+        {
+            if( pxLine->ucRxLevel != 0U )
+            {
+                /* Glitch shorter than half a bit: not a start bit. */
+                pxLine->xRxInChar = false;
+                break;
+            }
+        }
+        else if( pxLine->ucRxBit < modbusrtuSTOP_BIT )
+        {
+            pxLine->ucRxShift = ( uint8_t ) ( pxLine->ucRxShift >> 1 );
+
+            if( pxLine->ucRxLevel != 0U )
+            {
+                pxLine->ucRxShift |= 0x80U;
+            }
+        }
+        else
+        {
+            prvCharComplete( pxLine, pxLine->ucRxLevel );
+            break;
+        }
+
+        pxLine->ucRxBit++;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvCheckGap( ModbusRtuLine_t * pxLine,
+                         uint32_t ulTick )
+{
+    /* The last character ends half a bit after its stop bit was sampled,
+     * so the elapsed silence may still be negative here. */
+    if( ( pxLine->xRxInChar == false ) &&
+        ( pxLine->xRxInFrame == true ) &&
+        ( ( int32_t ) ( ulTick - pxLine->ulRxLastCharEnd ) >= ( int32_t ) pxLine->ulGapTicks ) )
+    {
+        prvFrameCommit( pxLine );
+    }
+}
+/*-----------------------------------------------------------*/
+
+void ModbusRtu_Init( ModbusRtuLine_t * pxLine,
+                     uint32_t ulTimerHz,
+                     uint32_t ulBaudRate,
+                     ModbusRtuFrameCallback_t xCallback,
+                     void * pvContext )
+{
+    memset( pxLine, 0, sizeof( ModbusRtuLine_t ) );
+
+    pxLine->ulTimerHz = ulTimerHz;
+    pxLine->ulBaudRate = ulBaudRate;
+    pxLine->ulCharTicks = ( modbusrtuBITS_PER_CHAR * ulTimerHz ) / ulBaudRate;
+
+    if( ulBaudRate > modbusrtuFIXED_GAP_BAUD_RATE )
+    {
+        pxLine->ulGapTicks = ( uint32_t ) ( ( ( uint64_t ) ulTimerHz * modbusrtuFIXED_GAP_US ) / 1000000U );
+    }
+    else
+    {
+        pxLine->ulGapTicks = ( 7U * pxLine->ulCharTicks ) / 2U;
+    }
+
+    pxLine->xFrameCallback = xCallback;
+    pxLine->pvCallbackContext = pvContext;
+    pxLine->ucRxLevel = 1U;
+}
+/*-----------------------------------------------------------*/
+
+void ModbusRtu_RxArm( ModbusRtuLine_t * pxLine,
+                      uint32_t ulTick )
+{
+    pxLine->xRxInChar = false;
+    pxLine->xRxInFrame = false;
+    pxLine->xRxFrameError = false;
+    pxLine->usRxFrameLength = 0;
+    pxLine->ucRxLevel = 1U;
+    pxLine->ulRxLastCharEnd = ulTick;
+}
+/*-----------------------------------------------------------*/
+
+void ModbusRtu_RxEdge( ModbusRtuLine_t * pxLine,
+                       uint32_t ulTick,
+                       uint8_t ucLevel )
+{
+    prvSampleUntil( pxLine, ulTick, false );
+
+    pxLine->ucRxLevel = ( ucLevel != 0U ) ? 1U : 0U;
+
+    if( ( pxLine->xRxInChar == false ) && ( pxLine->ucRxLevel == 0U ) )
+    {
+        /* A start bit after a long enough silence opens a new frame. */
+        prvCheckGap( pxLine, ulTick );
+
+        if( pxLine->xRxInFrame == false )
+        {
+            pxLine->xRxInFrame = true;
+            pxLine->xRxFrameError = false;
+            pxLine->usRxFrameLength = 0;
+        }
+
+        pxLine->xRxInChar = true;
+        pxLine->ucRxBit = 0;
+        pxLine->ucRxShift = 0;
+        pxLine->ulRxCharStart = ulTick;
+    }
+}
+/*-----------------------------------------------------------*/
+
+void ModbusRtu_RxPoll( ModbusRtuLine_t * pxLine,
+                       uint32_t ulTick )
+{
+    prvSampleUntil( pxLine, ulTick, true );
+    prvCheckGap( pxLine, ulTick );
+}
+/*-----------------------------------------------------------*/
+
+size_t ModbusRtu_FrameGet( ModbusRtuLine_t * pxLine,
+                           uint8_t * pucBuffer,
+                           size_t xBufferLength )
+{
+    uint32_t ulTail = pxLine->ulRingTail;
+    size_t xLength, xCopy, i;
+
+    if( ulTail == pxLine->ulRingHead )
+    {
+        return 0;
+    }
+
+    xLength = pxLine->ucRing[ ulTail++ & modbusrtuRING_MASK ];
+    xLength |= ( size_t ) pxLine->ucRing[ ulTail++ & modbusrtuRING_MASK ] << 8;
+    xCopy = ( xLength < xBufferLength ) ? xLength : xBufferLength;
+
+    for( i = 0; i < xCopy; i++ )
+    {
+        pucBuffer[ i ] = pxLine->ucRing[ ( ulTail + i ) & modbusrtuRING_MASK ];
+    }
+
+    pxLine->ulRingTail = ulTail + ( uint32_t ) xLength;
+
+    return xCopy;
+}
+/*-----------------------------------------------------------*/
+
+void ModbusRtu_FrameFlush( ModbusRtuLine_t * pxLine )
+{
+    pxLine->ulRingTail = pxLine->ulRingHead;
+}
+/*-----------------------------------------------------------*/
+
+void ModbusRtu_TxStart( ModbusRtuLine_t * pxLine,
+                        const uint8_t * pucData,
+                        size_t xLength )
+{
+    pxLine->pucTx = pucData;
+    pxLine->xTxLength = xLength;
+    pxLine->xTxIndex = 0;
+    pxLine->ucTxBit = 0;
+    pxLine->xTxBusy = true;
+}
+/*-----------------------------------------------------------*/
+
+int32_t ModbusRtu_TxNextLevel( ModbusRtuLine_t * pxLine )
+{
+    int32_t lLevel;
+
+    if( pxLine->xTxIndex >= pxLine->xTxLength )
+    {
+        pxLine->xTxBusy = false;
+
+        return modbusrtuTX_DONE;
+    }
+
+    if( pxLine->ucTxBit == 0U )
+    {
+        lLevel = 0;
+    }
+    else if( pxLine->ucTxBit < modbusrtuSTOP_BIT )
+    {
+        lLevel = ( pxLine->pucTx[ pxLine->xTxIndex ] >> ( pxLine->ucTxBit - 1U ) ) & 0x01;
+    }
+    else
+    {
+        lLevel = 1;
+    }
+
+    if( ++pxLine->ucTxBit == modbusrtuBITS_PER_CHAR )
+    {
+        pxLine->ucTxBit = 0;
+        pxLine->xTxIndex++;
+    }
+
+    return lLevel;
+}
+/*-----------------------------------------------------------*/
+
+uint16_t ModbusRtu_Crc16( const uint8_t * pucData,
+                          size_t xLength )
+{
+    uint16_t usCrc = 0xFFFFU;
+    size_t i;
+
+    for( i = 0; i < xLength; i++ )
+    {
+        usCrc = ( uint16_t ) ( ( usCrc >> 8 ) ^ usCrcTable[ ( usCrc ^ pucData[ i ] ) & 0xFFU ] );
+    }
+
+    return usCrc;
+}
+/*-----------------------------------------------------------*/
+
+bool ModbusRtu_CrcValid( const uint8_t * pucFrame,
+                         size_t xLength )
+{
+    uint16_t usCrc;
+
+    if( xLength <= modbusrtuCRC_LENGTH )
+    {
+        return false;
+    }
+
+    usCrc = ModbusRtu_Crc16( pucFrame, xLength - modbusrtuCRC_LENGTH );
+
+    return ( pucFrame[ xLength - 2U ] == ( uint8_t ) ( usCrc & 0xFFU ) ) &&
+           ( pucFrame[ xLength - 1U ] == ( uint8_t ) ( usCrc >> 8 ) );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,217 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file modbus_rtu.h
+ * @brief Interrupt driven software UART and Modbus RTU framer.
+ *
+ * The line engine is free of any HAL dependency. The board code feeds it
+ * with time-stamped line edges (from a timer capture or EXTI interrupt) and
+ * with a periodic bit tick (from a timer update interrupt). Complete frames,
+ * delimited by the Modbus 3.5 character silent interval, are stored in a
+ * ring buffer and signalled through a callback running in interrupt context.
+ * On the host the same entry points are driven from recorded waveforms.
+ */
+
+#ifndef _MODBUS_RTU_H_
+#define _MODBUS_RTU_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @brief Largest RTU frame (address + PDU + CRC) defined by the protocol.
+ */
+#define modbusrtuMAX_FRAME_LENGTH      ( 256U )
+
+/**
+ * @brief Size of the receive ring buffer. Each frame uses two bytes of
+ * length header plus its payload. Must be a power of two.
+ */
+#ifndef modbusrtuRX_RING_SIZE
+    #define modbusrtuRX_RING_SIZE      ( 512U )
+#endif
+
+/**
+ * @brief Number of CRC bytes closing an RTU frame.
+ */
+#define modbusrtuCRC_LENGTH            ( 2U )
+
+/**
+ * @brief Returned by ModbusRtu_TxNextLevel() once the whole buffer was sent.
+ */
+#define modbusrtuTX_DONE               ( -1 )
+
+/**
+ * @brief Invoked from interrupt context each time a frame is committed to
+ * the receive ring.
+ */
+typedef void (* ModbusRtuFrameCallback_t)( void * pvContext );
+
+/**
+ * @brief Line statistics, updated from interrupt context.
+ */
+typedef struct ModbusRtuStats
+{
+    uint32_t ulFrames;         /**< Frames committed to the ring. */
+    uint32_t ulCharacters;     /**< Characters decoded. */
+    uint32_t ulFramingErrors;  /**< Frames dropped because a stop bit was low. */
+    uint32_t ulOverruns;       /**< Frames dropped because they did not fit. */
+} ModbusRtuStats_t;
+
+/**
+ * @brief State of one half-duplex software UART line.
+ *
+ * All tick values are expressed in the unit of the time-stamp timer and may
+ * wrap around freely.
+ */
+typedef struct ModbusRtuLine
+{
+    /* Configuration. */
+    uint32_t ulTimerHz;
+    uint32_t ulBaudRate;
+    uint32_t ulCharTicks;      /**< Duration of one 10-bit character. */
+    uint32_t ulGapTicks;       /**< Silent interval closing a frame. */
+
+    /* Receive decoder. */
+    bool xRxInChar;
+    bool xRxInFrame;
+    bool xRxFrameError;
+    uint8_t ucRxLevel;         /**< Line level after the last edge. */
+    uint8_t ucRxBit;           /**< Next bit to sample, 0 is the start bit. */
+    uint8_t ucRxShift;
+    uint32_t ulRxCharStart;
+    uint32_t ulRxLastCharEnd;
+    uint16_t usRxFrameLength;
+    uint8_t ucRxFrame[ modbusrtuMAX_FRAME_LENGTH ];
+
+    /* Receive ring, written by the ISR and read by the task. */
+    uint8_t ucRing[ modbusrtuRX_RING_SIZE ];
+    volatile uint32_t ulRingHead;
+    volatile uint32_t ulRingTail;
+
+    /* Transmitter. */
+    const uint8_t * pucTx;
+    size_t xTxLength;
+    size_t xTxIndex;
+    uint8_t ucTxBit;
+    volatile bool xTxBusy;
+
+    ModbusRtuFrameCallback_t xFrameCallback;
+    void * pvCallbackContext;
+
+    ModbusRtuStats_t xStats;
+} ModbusRtuLine_t;
+
+/**
+ * @brief Initialize a line.
+ *
+ * @param[in] pxLine Line to initialize.
+ * @param[in] ulTimerHz Frequency of the time-stamp timer.
+ * @param[in] ulBaudRate Line baud rate (8N1 framing).
+ * @param[in] xCallback Frame notification, may be NULL.
+ * @param[in] pvContext Passed to @p xCallback.
+ */
+void ModbusRtu_Init( ModbusRtuLine_t * pxLine,
+                     uint32_t ulTimerHz,
+                     uint32_t ulBaudRate,
+                     ModbusRtuFrameCallback_t xCallback,
+                     void * pvContext );
+
+/**
+ * @brief Reset the receive decoder and mark the line idle at @p ulTick.
+ *
+ * Called when the bus is released after a transmission.
+ */
+void ModbusRtu_RxArm( ModbusRtuLine_t * pxLine,
+                      uint32_t ulTick );
+
+/**
+ * @brief Report an edge on the receive line. Interrupt context.
+ *
+ * @param[in] ulTick Time stamp of the edge.
+ * @param[in] ucLevel Line level after the edge (0 or 1).
+ */
+void ModbusRtu_RxEdge( ModbusRtuLine_t * pxLine,
+                       uint32_t ulTick,
+                       uint8_t ucLevel );
+
+/**
+ * @brief Advance the decoder to @p ulTick without an edge. Interrupt context.
+ *
+ * Completes a character whose trailing bits produced no edge and closes the
+ * current frame once the 3.5 character silent interval has elapsed. Must be
+ * called at least once per character time while a reply is expected.
+ */
+void ModbusRtu_RxPoll( ModbusRtuLine_t * pxLine,
+                       uint32_t ulTick );
+
+/**
+ * @brief Pop the oldest complete frame from the receive ring. Task context.
+ *
+ * @param[out] pucBuffer Destination of the frame.
+ * @param[in] xBufferLength Size of @p pucBuffer.
+ *
+ * @return Length of the frame, 0 if the ring is empty. A frame larger than
+ * @p xBufferLength is truncated.
+ */
+size_t ModbusRtu_FrameGet( ModbusRtuLine_t * pxLine,
+                           uint8_t * pucBuffer,
+                           size_t xBufferLength );
+
+/**
+ * @brief Drop every frame waiting in the receive ring. Task context.
+ */
+void ModbusRtu_FrameFlush( ModbusRtuLine_t * pxLine );
+
+/**
+ * @brief Start transmitting @p xLength bytes. The buffer must stay valid
+ * until ModbusRtu_TxNextLevel() returns modbusrtuTX_DONE.
+ */
+void ModbusRtu_TxStart( ModbusRtuLine_t * pxLine,
+                        const uint8_t * pucData,
+                        size_t xLength );
+
+/**
+ * @brief Line level to drive for the next bit period. Interrupt context.
+ *
+ * @return 0 or 1, or modbusrtuTX_DONE once the last stop bit was sent.
+ */
+int32_t ModbusRtu_TxNextLevel( ModbusRtuLine_t * pxLine );
+
+/**
+ * @brief Compute the Modbus CRC-16 of a buffer.
+ */
+uint16_t ModbusRtu_Crc16( const uint8_t * pucData,
+                          size_t xLength );
+
+/**
+ * @brief Check the trailing CRC of a received frame.
+ */
+bool ModbusRtu_CrcValid( const uint8_t * pucFrame,
+                         size_t xLength );
+
+#endif /* _MODBUS_RTU_H_ */
@@ -0,0 +1,561 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+/**
+ * @file ota_bank.c
+ * @brief Firmware update image written to the inactive flash bank.
+ */
+
+#include <string.h>
+
+#include "ota_bank.h"
+
+/* "BANK", first word of the descriptor header, the image size follows. */
+#define otabankMAGIC                 ( 0x4B4E4142UL )
+
+/* Double words of the descriptor page. A marker is set once any of its bits
+ * was programmed, so a marker cut short by a reset still counts. */
+#define otabankDW_HEADER             ( 0U )
+#define otabankDW_VERIFIED           ( 1U ) /* Signature valid. */
+#define otabankDW_ACTIVATED          ( 2U ) /* Swap requested. */
+#define otabankDW_TRIAL              ( 3U ) /* Booted once. */
+#define otabankDW_ACCEPTED           ( 4U )
+#define otabankDW_REJECTED           ( 5U )
+
+#define otabankERASED_BYTE           ( 0xFFU )
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvDescriptorOffset( const OtaBankFlash_t * pxFlash )
+{
+    return pxFlash->ulDataOffset - pxFlash->ulPageSize;
+}
+
+static bool prvErased( const OtaBankFlash_t * pxFlash,
+                       uint32_t ulBank,
+                       uint32_t ulOffset,
+                       uint32_t ulLength )
+{
+    const volatile uint8_t * pucFlash = &pxFlash->pucBank[ ulBank ][ ulOffset ];
+    uint32_t i;
+
+    for( i = 0; i < ulLength; i++ )
+    {
+        if( pucFlash[ i ] != otabankERASED_BYTE )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool prvErase( OtaBank_t * pxBank,
+                      uint32_t ulBank,
+                      uint32_t ulOffset )
+{
+    const OtaBankFlash_t * pxFlash = pxBank->pxFlash;
+
+    /* Erasing takes far longer than checking the page. */
+    if( prvErased( pxFlash, ulBank, ulOffset, pxFlash->ulPageSize ) == true )
+    {
+        return true;
+    }
+
+    if( pxFlash->xErase( pxFlash->pvContext, ulBank, ulOffset ) != 0 )
+    {
+        pxBank->xStats.ulFlashErrors++;
+
+        return false;
+    }
+
+    return true;
+}
+
+static bool prvProgram( OtaBank_t * pxBank,
+                        uint32_t ulBank,
+                        uint32_t ulOffset,
+                        const void * pvData,
+                        uint32_t ulLength )
+{
+    const OtaBankFlash_t * pxFlash = pxBank->pxFlash;
+
+    if( pxFlash->xProgram( pxFlash->pvContext, ulBank, ulOffset, pvData, ulLength ) != 0 )
+    {
+        pxBank->xStats.ulFlashErrors++;
+
+        return false;
+    }
+
+    return true;
+}
+
+static bool prvMarkerSet( const OtaBankFlash_t * pxFlash,
+                          uint32_t ulBank,
+                          uint32_t ulMarker )
+{
+    uint32_t ulOffset = prvDescriptorOffset( pxFlash ) + ( ulMarker * otabankPROGRAM_UNIT );
+
+    return ( prvErased( pxFlash, ulBank, ulOffset, otabankPROGRAM_UNIT ) == false );
+}
+
+static bool prvSetMarker( OtaBank_t * pxBank,
+                          uint32_t ulBank,
+                          uint32_t ulMarker )
+{
+    const uint64_t ullMarker = 0;
+    uint32_t ulOffset = prvDescriptorOffset( pxBank->pxFlash ) + ( ulMarker * otabankPROGRAM_UNIT );
+
+    if( prvMarkerSet( pxBank->pxFlash, ulBank, ulMarker ) == true )
+    {
+        return true;
+    }
+
+    return prvProgram( pxBank, ulBank, ulOffset, &ullMarker, otabankPROGRAM_UNIT );
+}
+
+static uint32_t prvReadWord( const volatile uint8_t * pucFlash )
+{
+    return ( uint32_t ) pucFlash[ 0 ] |
+           ( ( uint32_t ) pucFlash[ 1 ] << 8 ) |
+           ( ( uint32_t ) pucFlash[ 2 ] << 16 ) |
+           ( ( uint32_t ) pucFlash[ 3 ] << 24 );
+}
+
+/* A bank holds an image written by the writer. */
+static bool prvHeaderValid( const OtaBankFlash_t * pxFlash,
+                            uint32_t ulBank )
+{
+    const volatile uint8_t * pucHeader = &pxFlash->pucBank[ ulBank ][ prvDescriptorOffset( pxFlash ) ];
+    uint32_t ulImageSize = prvReadWord( &pucHeader[ 4 ] );
+
+    return ( prvReadWord( pucHeader ) == otabankMAGIC ) &&
+           ( ulImageSize != 0U ) &&
+           ( ulImageSize <= prvDescriptorOffset( pxFlash ) );
+}
+
+static OtaBankState_t prvRunningState( const OtaBankFlash_t * pxFlash )
+{
+    OtaBankState_t xState = eOtaBankValid;
+
+    /* An image written by a debugger has no descriptor. */
+    if( ( prvHeaderValid( pxFlash, otabankRUNNING ) == true ) &&
+        ( prvMarkerSet( pxFlash, otabankRUNNING, otabankDW_ACTIVATED ) == true ) &&
+        ( prvMarkerSet( pxFlash, otabankRUNNING, otabankDW_ACCEPTED ) == false ) )
+    {
+        if( prvMarkerSet( pxFlash, otabankRUNNING, otabankDW_REJECTED ) == true )
+        {
+            xState = eOtaBankRejected;
+        }
+        else
+        {
+            xState = eOtaBankPendingCommit;
+        }
+    }
+
+    return xState;
+}
+
+/* Move the application data window to the running bank, which becomes the
+ * inactive one after the swap. The source is left untouched, a reset during
+ * the copy only means it is done again. The flash is held from the first page
+ * copied to the swap, a write to the window in between would be lost. */
+static bool prvSwap( OtaBank_t * pxBank )
+{
+    const OtaBankFlash_t * pxFlash = pxBank->pxFlash;
+    bool xResult = true;
+    uint32_t ulOffset;
+
+    if( pxFlash->xLock != NULL )
+    {
+        pxFlash->xLock( pxFlash->pvContext );
+    }
+
+    for( ulOffset = pxFlash->ulDataOffset;
+         ( xResult == true ) && ( ulOffset < pxFlash->ulBankSize );
+         ulOffset += pxFlash->ulPageSize )
+    {
+        if( prvErase( pxBank, otabankRUNNING, ulOffset ) == false )
+        {
+            xResult = false;
+        }
+        else if( ( prvErased( pxFlash, otabankINACTIVE, ulOffset, pxFlash->ulPageSize ) == false ) &&
+                 ( prvProgram( pxBank, otabankRUNNING, ulOffset,
+                               ( const void * ) &pxFlash->pucBank[ otabankINACTIVE ][ ulOffset ],
+                               pxFlash->ulPageSize ) == false ) )
+        {
+            xResult = false;
+        }
+    }
+
+    if( ( xResult == true ) && ( pxFlash->xSwap( pxFlash->pvContext ) != 0 ) )
+    {
+        pxBank->xStats.ulFlashErrors++;
+        xResult = false;
+    }
+
+    if( pxFlash->xUnlock != NULL )
+    {
+        pxFlash->xUnlock( pxFlash->pvContext );
+    }
+
+    return xResult;
+}
+
+static void prvRollBack( OtaBank_t * pxBank )
+{
+    /* Once rejected, a reset during the copy still leads back here. */
+    if( prvSetMarker( pxBank, otabankRUNNING, otabankDW_REJECTED ) == true )
+    {
+        ( void ) prvSwap( pxBank );
+    }
+}
+
+/* Hash the blocks received ahead of the part already hashed. */
+static void prvHashReceived( OtaBank_t * pxBank )
+{
+    const volatile uint8_t * pucImage = pxBank->pxFlash->pucBank[ otabankINACTIVE ];
+    uint32_t ulBlock;
+    uint32_t ulLength;
+
+    while( pxBank->ulHashedLength < pxBank->ulImageSize )
+    {
+        ulBlock = pxBank->ulHashedLength / pxBank->ulBlockSize;
+
+        if( ( pxBank->ucReceived[ ulBlock / 8U ] & ( 1U << ( ulBlock % 8U ) ) ) == 0U )
+        {
+            break;
+        }
+
+        ulLength = pxBank->ulImageSize - pxBank->ulHashedLength;
+
+        if( ulLength > pxBank->ulBlockSize )
+        {
+            ulLength = pxBank->ulBlockSize;
+        }
+
+        pxBank->xHashUpdate( pxBank->pvHashContext,
+                             ( const uint8_t * ) &pucImage[ pxBank->ulHashedLength ],
+                             ulLength );
+        pxBank->ulHashedLength += ulLength;
+        pxBank->xStats.ulBytesReread += ulLength;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+bool OtaBank_Open( OtaBank_t * pxBank,
+                   const OtaBankFlash_t * pxFlash )
+{
+    OtaBankState_t xState;
+
+    if( ( pxFlash == NULL ) ||
+        ( pxFlash->pucBank[ otabankRUNNING ] == NULL ) ||
+        ( pxFlash->pucBank[ otabankINACTIVE ] == NULL ) ||
+        ( pxFlash->xErase == NULL ) ||
+        ( pxFlash->xProgram == NULL ) ||
+        ( pxFlash->xSwap == NULL ) ||
+        ( ( pxFlash->xLock == NULL ) != ( pxFlash->xUnlock == NULL ) ) ||
+        ( pxFlash->ulPageSize < otabankPROGRAM_UNIT ) ||
+        ( ( pxFlash->ulPageSize % otabankPROGRAM_UNIT ) != 0U ) ||
+        ( ( pxFlash->ulDataOffset % pxFlash->ulPageSize ) != 0U ) ||
+        ( ( pxFlash->ulBankSize % pxFlash->ulPageSize ) != 0U ) ||
+        ( pxFlash->ulDataOffset < ( 2U * pxFlash->ulPageSize ) ) ||
+        ( pxFlash->ulDataOffset > pxFlash->ulBankSize ) )
+    {
+        return false;
+    }
+
+    memset( pxBank, 0, sizeof( *pxBank ) );
+    pxBank->pxFlash = pxFlash;
+
+    xState = prvRunningState( pxFlash );
+
+    if( xState == eOtaBankPendingCommit )
+    {
+        /* The trial run ended with a reset instead of a verdict. If the trial
+         * cannot be recorded, the next reset would not be noticed either. */
+        if( ( prvMarkerSet( pxFlash, otabankRUNNING, otabankDW_TRIAL ) == true ) ||
+            ( prvSetMarker( pxBank, otabankRUNNING, otabankDW_TRIAL ) == false ) )
+        {
+            prvRollBack( pxBank );
+        }
+    }
+    else if( xState == eOtaBankRejected )
+    {
+        prvRollBack( pxBank );
+    }
+    else
+    {
+        /* Nothing to do. */
+    }
+
+    return true;
+}
+
+OtaBankState_t OtaBank_GetState( const OtaBank_t * pxBank )
+{
+    return prvRunningState( pxBank->pxFlash );
+}
+
+uint32_t OtaBank_MaxImageSize( const OtaBank_t * pxBank )
+{
+    return prvDescriptorOffset( pxBank->pxFlash );
+}
+
+bool OtaBank_Begin( OtaBank_t * pxBank,
+                    uint32_t ulImageSize,
+                    uint32_t ulBlockSize,
+                    OtaBankHashUpdate_t xHashUpdate,
+                    void * pvHashContext )
+{
+    const OtaBankFlash_t * pxFlash = pxBank->pxFlash;
+    uint32_t ulOffset;
+
+    union
+    {
+        uint64_t ullAlign;
+        uint32_t ulWords[ 2 ];
+    } xHeader;
+
+    pxBank->ulImageSize = 0;
+
+    if( ( ulImageSize == 0U ) ||
+        ( ulImageSize > OtaBank_MaxImageSize( pxBank ) ) ||
+        ( ulBlockSize == 0U ) ||
+        ( ( ulBlockSize % otabankPROGRAM_UNIT ) != 0U ) ||
+        ( ( ( ulImageSize + ulBlockSize - 1U ) / ulBlockSize ) > otabankMAX_BLOCKS ) ||
+        ( xHashUpdate == NULL ) )
+    {
+        return false;
+    }
+
+    /* The inactive bank holds the image to roll back to. */
+    if( prvRunningState( pxFlash ) != eOtaBankValid )
+    {
+        return false;
+    }
+
+    /* The descriptor goes first, a reset leaves no image behind. */
+    if( prvErase( pxBank, otabankINACTIVE, prvDescriptorOffset( pxFlash ) ) == false )
+    {
+        return false;
+    }
+
+    for( ulOffset = 0; ulOffset < ulImageSize; ulOffset += pxFlash->ulPageSize )
+    {
+        if( prvErase( pxBank, otabankINACTIVE, ulOffset ) == false )
+        {
+            return false;
+        }
+    }
+
+    xHeader.ulWords[ 0 ] = otabankMAGIC;
+    xHeader.ulWords[ 1 ] = ulImageSize;
+
+    if( prvProgram( pxBank, otabankINACTIVE, prvDescriptorOffset( pxFlash ),
+                    &xHeader.ullAlign, otabankPROGRAM_UNIT ) == false )
+    {
+        return false;
+    }
+
+    memset( pxBank->ucReceived, 0, sizeof( pxBank->ucReceived ) );
+    pxBank->ulBlockSize = ulBlockSize;
+    pxBank->ulHashedLength = 0;
+    pxBank->xHashUpdate = xHashUpdate;
+    pxBank->pvHashContext = pvHashContext;
+    pxBank->ulImageSize = ulImageSize;
+
+    return true;
+}
+
+int32_t OtaBank_Write( OtaBank_t * pxBank,
+                       uint32_t ulOffset,
+                       const uint8_t * pucData,
+                       uint32_t ulLength )
+{
+    uint32_t ulBlock;
+    uint32_t ulDone;
+    uint32_t ulChunk;
+    uint32_t ulPadded;
+
+    if( ( pxBank->ulImageSize == 0U ) ||
+        ( pucData == NULL ) ||
+        ( ulLength == 0U ) ||
+        ( ulLength > pxBank->ulBlockSize ) ||
+        ( ( ulOffset % pxBank->ulBlockSize ) != 0U ) ||
+        ( ulOffset >= pxBank->ulImageSize ) ||
+        ( ulLength > ( pxBank->ulImageSize - ulOffset ) ) )
+    {
+        return -1;
+    }
+
+    /* Only the last block may be short. */
+    if( ( ulLength != pxBank->ulBlockSize ) &&
+        ( ( ulOffset + ulLength ) != pxBank->ulImageSize ) )
+    {
+        return -1;
+    }
+
+    ulBlock = ulOffset / pxBank->ulBlockSize;
+
+    if( ( pxBank->ucReceived[ ulBlock / 8U ] & ( 1U << ( ulBlock % 8U ) ) ) != 0U )
+    {
+        /* Programmed flash cannot be written again. */
+        pxBank->xStats.ulDuplicates++;
+
+        return ( int32_t ) ulLength;
+    }
+
+    /* The block buffer of the caller has no particular alignment, and the
+     * last block is padded up to a double word. */
+    for( ulDone = 0; ulDone < ulLength; ulDone += ulChunk )
+    {
+        ulChunk = ulLength - ulDone;
+
+        if( ulChunk > otabankSTAGING_LENGTH )
+        {
+            ulChunk = otabankSTAGING_LENGTH;
+        }
+
+        ulPadded = ( ulChunk + otabankPROGRAM_UNIT - 1U ) & ~( otabankPROGRAM_UNIT - 1U );
+        memcpy( pxBank->xStaging.ucBytes, &pucData[ ulDone ], ulChunk );
+        memset( &pxBank->xStaging.ucBytes[ ulChunk ], otabankERASED_BYTE, ulPadded - ulChunk );
+
+        if( prvProgram( pxBank, otabankINACTIVE, ulOffset + ulDone,
+                        pxBank->xStaging.ucBytes, ulPadded ) == false )
+        {
+            return -1;
+        }
+    }
+
+    pxBank->ucReceived[ ulBlock / 8U ] |= ( uint8_t ) ( 1U << ( ulBlock % 8U ) );
+    pxBank->xStats.ulBlocksWritten++;
+
+    /* The block extends the hashed part: hash it from RAM, then the blocks
+     * already waiting behind it from the flash. */
+    if( ulOffset == pxBank->ulHashedLength )
+    {
+        pxBank->xHashUpdate( pxBank->pvHashContext, pucData, ulLength );
+        pxBank->ulHashedLength += ulLength;
+        prvHashReceived( pxBank );
+    }
+
+    return ( int32_t ) ulLength;
+}
+
+bool OtaBank_Complete( const OtaBank_t * pxBank )
+{
+    return ( pxBank->ulImageSize != 0U ) &&
+           ( pxBank->ulHashedLength == pxBank->ulImageSize );
+}
+
+bool OtaBank_Close( OtaBank_t * pxBank,
+                    bool xVerified )
+{
+    bool xActivable = false;
+
+    if( pxBank->ulImageSize != 0U )
+    {
+        if( ( xVerified == true ) && ( OtaBank_Complete( pxBank ) == true ) )
+        {
+            xActivable = prvSetMarker( pxBank, otabankINACTIVE, otabankDW_VERIFIED );
+        }
+
+        if( xActivable == false )
+        {
+            ( void ) prvSetMarker( pxBank, otabankINACTIVE, otabankDW_REJECTED );
+        }
+
+        pxBank->ulImageSize = 0;
+    }
+
+    return xActivable;
+}
+
+bool OtaBank_Activate( OtaBank_t * pxBank )
+{
+    const OtaBankFlash_t * pxFlash = pxBank->pxFlash;
+
+    if( ( pxBank->ulImageSize != 0U ) ||
+        ( prvRunningState( pxFlash ) != eOtaBankValid ) ||
+        ( prvHeaderValid( pxFlash, otabankINACTIVE ) == false ) ||
+        ( prvMarkerSet( pxFlash, otabankINACTIVE, otabankDW_VERIFIED ) == false ) ||
+        ( prvMarkerSet( pxFlash, otabankINACTIVE, otabankDW_REJECTED ) == true ) )
+    {
+        return false;
+    }
+
+    if( prvSetMarker( pxBank, otabankINACTIVE, otabankDW_ACTIVATED ) == false )
+    {
+        return false;
+    }
+
+    return prvSwap( pxBank );
+}
+
+bool OtaBank_Accept( OtaBank_t * pxBank )
+{
+    bool xAccepted = false;
+
+    switch( prvRunningState( pxBank->pxFlash ) )
+    {
+        case eOtaBankValid:
+            xAccepted = true;
+            break;
+
+        case eOtaBankPendingCommit:
+            xAccepted = prvSetMarker( pxBank, otabankRUNNING, otabankDW_ACCEPTED );
+            break;
+
+        default:
+            break;
+    }
+
+    return xAccepted;
+}
+
+bool OtaBank_Reject( OtaBank_t * pxBank )
+{
+    if( prvRunningState( pxBank->pxFlash ) == eOtaBankPendingCommit )
+    {
+        return prvSetMarker( pxBank, otabankRUNNING, otabankDW_REJECTED );
+    }
+
+    return OtaBank_Abort( pxBank );
+}
+
+bool OtaBank_Abort( OtaBank_t * pxBank )
+{
+    pxBank->ulImageSize = 0;
+
+    /* Leave alone the image to roll back to. */
+    if( ( prvHeaderValid( pxBank->pxFlash, otabankINACTIVE ) == false ) ||
+        ( prvMarkerSet( pxBank->pxFlash, otabankINACTIVE, otabankDW_ACTIVATED ) == true ) )
+    {
+        return true;
+    }
+
+    return prvSetMarker( pxBank, otabankINACTIVE, otabankDW_REJECTED );
+}
@@ -0,0 +1,291 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file ota_bank.h
+ * @brief Firmware update image written to the inactive flash bank.
+ *
+ * The running image and the update each own one bank of the dual-bank flash.
+ * The running bank is mapped first, the inactive bank follows it, whatever
+ * the physical bank the device booted from. An update is programmed into the
+ * inactive bank as its blocks arrive, in any order, and is committed by
+ * swapping the banks at the next boot.
+ *
+ * Each bank is split in three areas:
+ * - the image, from the start of the bank;
+ * - one descriptor page, holding the state of the image in that bank;
+ * - the application data window at the top of the bank, only used in the
+ *   inactive bank. It is copied to the other bank before each swap, so the
+ *   data regions keep their address and their content across an update.
+ *
+ * The blocks are fed to a hash as soon as they extend the part of the image
+ * already hashed. A block received ahead of a missing one is hashed from the
+ * flash once the gap is filled, so the digest is complete when the last block
+ * is written and the signature is checked without reading the image again.
+ *
+ * Every state change programs its own double word of the descriptor, so a
+ * reset at any point leaves either the previous state or the next one. A new
+ * image runs once on trial: if the device resets again before the image is
+ * accepted, the banks are swapped back at boot.
+ *
+ * The flash is reached through callbacks, like the meter journal.
+ */
+
+#ifndef _OTA_BANK_H_
+#define _OTA_BANK_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @brief Largest number of blocks of an image, the OTA agent tracks at most
+ * 1024 blocks.
+ */
+#ifndef otabankMAX_BLOCKS
+    #define otabankMAX_BLOCKS       ( 1024U )
+#endif
+
+/**
+ * @brief Smallest unit the flash can program, in bytes.
+ */
+#define otabankPROGRAM_UNIT         ( 8U )
+
+/**
+ * @brief Blocks are programmed through a staging buffer of this size.
+ */
+#define otabankSTAGING_LENGTH       ( 256U )
+
+/**
+ * @brief Bank index of the flash callbacks.
+ */
+#define otabankRUNNING              ( 0U )
+#define otabankINACTIVE             ( 1U )
+
+/**
+ * @brief Hash update, CRYPTO_SignatureVerificationUpdate() on the device.
+ */
+typedef void ( * OtaBankHashUpdate_t )( void * pvHashContext,
+                                        const uint8_t * pucData,
+                                        size_t xLength );
+
+/**
+ * @brief Flash access used by the image writer.
+ *
+ * Offsets are relative to the start of a bank, which is read directly
+ * through @p pucBank.
+ */
+typedef struct OtaBankFlash
+{
+    const volatile uint8_t * pucBank[ 2 ]; /**< Memory mapped banks, indexed by otabankRUNNING and otabankINACTIVE. */
+    uint32_t ulPageSize;                   /**< Erase unit. */
+    uint32_t ulDataOffset;                 /**< Start of the application data window, page aligned. */
+    uint32_t ulBankSize;                   /**< End of the application data window. */
+
+    /**
+     * @brief Erase one page of a bank, return 0 on success.
+     */
+    int32_t ( * xErase )( void * pvContext,
+                          uint32_t ulBank,
+                          uint32_t ulOffset );
+
+    /**
+     * @brief Program erased flash of a bank, return 0 on success.
+     * @p ulOffset and @p ulLength are multiples of otabankPROGRAM_UNIT and
+     * @p pvData is 8-byte aligned.
+     */
+    int32_t ( * xProgram )( void * pvContext,
+                            uint32_t ulBank,
+                            uint32_t ulOffset,
+                            const void * pvData,
+                            uint32_t ulLength );
+
+    /**
+     * @brief Boot from the other bank and reset. Only returns on failure, or
+     * on the host where the reset is simulated, return 0 on success.
+     */
+    int32_t ( * xSwap )( void * pvContext );
+
+    /**
+     * @brief Take and give the flash for the copy of the application data
+     * window and the swap that follows, so no other writer changes the
+     * window in between. Recursive, NULL when the flash has no other writer.
+     */
+    void ( * xLock )( void * pvContext );
+    void ( * xUnlock )( void * pvContext );
+
+    void * pvContext;
+} OtaBankFlash_t;
+
+/**
+ * @brief State of the running image.
+ */
+typedef enum OtaBankState
+{
+    eOtaBankValid = 0,     /**< Accepted, or written without the OTA agent. */
+    eOtaBankPendingCommit, /**< First run of an update, not accepted yet. */
+    eOtaBankRejected       /**< Rejected, the banks are swapped back at the next boot. */
+} OtaBankState_t;
+
+/**
+ * @brief Writer counters.
+ */
+typedef struct OtaBankStats
+{
+    uint32_t ulBlocksWritten; /**< Blocks programmed. */
+    uint32_t ulDuplicates;    /**< Blocks received again, not programmed. */
+    uint32_t ulBytesReread;   /**< Bytes hashed from the flash, received ahead of a gap. */
+    uint32_t ulFlashErrors;   /**< Failed erase or program operations. */
+} OtaBankStats_t;
+
+/**
+ * @brief Writer state.
+ */
+typedef struct OtaBank
+{
+    const OtaBankFlash_t * pxFlash;
+
+    /* Image being received, ulImageSize is 0 outside a reception. */
+    uint32_t ulImageSize;
+    uint32_t ulBlockSize;
+    uint32_t ulHashedLength;
+    OtaBankHashUpdate_t xHashUpdate;
+    void * pvHashContext;
+    uint8_t ucReceived[ otabankMAX_BLOCKS / 8U ];
+
+    /* Block image, aligned for the double word programming of the flash. */
+    union
+    {
+        uint64_t ullAlign[ otabankSTAGING_LENGTH / sizeof( uint64_t ) ];
+        uint8_t ucBytes[ otabankSTAGING_LENGTH ];
+    } xStaging;
+
+    OtaBankStats_t xStats;
+} OtaBank_t;
+
+/**
+ * @brief Open the writer at boot, before the data regions are used.
+ *
+ * An update that reset during its trial run, or that was rejected, is
+ * rolled back: the banks are swapped and the device resets. An update
+ * booting for the first time starts its trial run.
+ *
+ * @return false if the flash description is invalid.
+ */
+bool OtaBank_Open( OtaBank_t * pxBank,
+                   const OtaBankFlash_t * pxFlash );
+
+/**
+ * @brief State of the running image.
+ */
+OtaBankState_t OtaBank_GetState( const OtaBank_t * pxBank );
+
+/**
+ * @brief Largest image the inactive bank can receive.
+ */
+uint32_t OtaBank_MaxImageSize( const OtaBank_t * pxBank );
+
+/**
+ * @brief Erase the inactive bank and start receiving an image.
+ *
+ * @param[in] ulImageSize Size of the image.
+ * @param[in] ulBlockSize Size of the blocks, a multiple of
+ * otabankPROGRAM_UNIT. Only the last block may be shorter.
+ * @param[in] xHashUpdate Fed with the image, in order.
+ * @param[in] pvHashContext Passed to @p xHashUpdate.
+ *
+ * @return false if the image does not fit, the running image is on trial or
+ * the flash operation failed.
+ */
+bool OtaBank_Begin( OtaBank_t * pxBank,
+                    uint32_t ulImageSize,
+                    uint32_t ulBlockSize,
+                    OtaBankHashUpdate_t xHashUpdate,
+                    void * pvHashContext );
+
+/**
+ * @brief Program one block of the image.
+ *
+ * A block received again is not programmed a second time.
+ *
+ * @param[in] ulOffset Offset of the block, a multiple of the block size.
+ *
+ * @return @p ulLength, or -1 if the block is invalid or the flash operation
+ * failed.
+ */
+int32_t OtaBank_Write( OtaBank_t * pxBank,
+                       uint32_t ulOffset,
+                       const uint8_t * pucData,
+                       uint32_t ulLength );
+
+/**
+ * @brief Check that the whole image was received and fed to the hash.
+ */
+bool OtaBank_Complete( const OtaBank_t * pxBank );
+
+/**
+ * @brief End the reception.
+ *
+ * @param[in] xVerified The signature of the image is valid. The image can
+ * only be activated if it is complete and verified.
+ *
+ * @return true if the image can be activated.
+ */
+bool OtaBank_Close( OtaBank_t * pxBank,
+                    bool xVerified );
+
+/**
+ * @brief Copy the application data window and boot the received image.
+ *
+ * @return false if there is no verified image or the flash operation failed.
+ * Does not return on success, except on the host.
+ */
+bool OtaBank_Activate( OtaBank_t * pxBank );
+
+/**
+ * @brief Accept the running image at the end of its trial run.
+ *
+ * @return false if the running image was rejected or the flash operation
+ * failed.
+ */
+bool OtaBank_Accept( OtaBank_t * pxBank );
+
+/**
+ * @brief Reject the running image if it is on trial, it is rolled back at the
+ * next boot. Otherwise abort the image received in the inactive bank.
+ *
+ * @return false if the flash operation failed.
+ */
+bool OtaBank_Reject( OtaBank_t * pxBank );
+
+/**
+ * @brief Abort the image received in the inactive bank, it can no longer be
+ * activated.
+ *
+ * @return false if the flash operation failed.
+ */
+bool OtaBank_Abort( OtaBank_t * pxBank );
+
+#endif /* _OTA_BANK_H_ */
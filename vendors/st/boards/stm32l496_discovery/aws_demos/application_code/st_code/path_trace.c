@@ -0,0 +1,280 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file path_trace.c
+ * @brief Per-stage latency histograms of the publish path.
+ */
+
+#include <string.h>
+
+#include "path_trace.h"
+
+/* Bits of the duration below its leading one that select the bucket. */
+#define pathtraceSUB_BITS            ( 2U )
+
+#if ( ( 1U << pathtraceSUB_BITS ) != pathtraceSUB_BUCKETS )
+    #error "pathtraceSUB_BUCKETS must be 2^pathtraceSUB_BITS"
+#endif
+
+/* A bucket reaching this count halves the histogram of its stage, which
+ * keeps the percentiles of a long uptime in 16-bit counters. */
+#define pathtraceBUCKET_MAX          ( 0xFFFFU )
+
+/**
+ * @brief Durations of one stage.
+ */
+typedef struct PathTraceHistogram
+{
+    uint32_t ulCount;
+    uint32_t ulMaxUs;
+    uint16_t usBuckets[ pathtraceBUCKETS ];
+} PathTraceHistogram_t;
+
+static PathTraceConfig_t xTraceConfig;
+static PathTraceHistogram_t xHistograms[ PATH_TRACE_STAGE_COUNT ];
+
+static const char * const pcStageNames[ PATH_TRACE_STAGE_COUNT ] =
+{
+    "meter read",
+    "record encode",
+    "mqtt serialize",
+    "tls encrypt",
+    "com send",
+    "modem send",
+    "mqtt puback"
+};
+
+/*-----------------------------------------------------------*/
+
+static void prvEnterCritical( void )
+{
+    if( xTraceConfig.xEnterCritical != NULL )
+    {
+        xTraceConfig.xEnterCritical();
+    }
+}
+
+static void prvExitCritical( void )
+{
+    if( xTraceConfig.xExitCritical != NULL )
+    {
+        xTraceConfig.xExitCritical();
+    }
+}
+
+static uint32_t prvBucket( uint32_t ulUs )
+{
+    uint32_t ulMsb = pathtraceSUB_BITS;
+    uint32_t ulBucket;
+
+    if( ulUs < pathtraceSUB_BUCKETS )
+    {
+        ulBucket = ulUs;
+    }
+    else
+    {
+        while( ( ulMsb < 31U ) && ( ( ulUs >> ( ulMsb + 1U ) ) != 0U ) )
+        {
+            ulMsb++;
+        }
+
+        ulBucket = ( ( ulMsb - pathtraceSUB_BITS + 1U ) << pathtraceSUB_BITS ) +
+                   ( ( ulUs >> ( ulMsb - pathtraceSUB_BITS ) ) & ( pathtraceSUB_BUCKETS - 1U ) );
+
+        if( ulBucket >= pathtraceBUCKETS )
+        {
+            ulBucket = pathtraceBUCKETS - 1U;
+        }
+    }
+
+    return ulBucket;
+}
+
+/* Smallest duration of a bucket. */
+static uint32_t prvBucketStart( uint32_t ulBucket )
+{
+    uint32_t ulStart = ulBucket;
+    uint32_t ulShift;
+
+    if( ulBucket >= pathtraceSUB_BUCKETS )
+    {
+        ulShift = ( ulBucket >> pathtraceSUB_BITS ) - 1U;
+        ulStart = ( pathtraceSUB_BUCKETS + ( ulBucket & ( pathtraceSUB_BUCKETS - 1U ) ) ) << ulShift;
+    }
+
+    return ulStart;
+}
+
+/* Largest duration in the bucket holding the given share of the durations. */
+static uint32_t prvPercentile( const PathTraceHistogram_t * pxHistogram,
+                               uint32_t ulTotal,
+                               uint32_t ulPercent )
+{
+    uint32_t ulRank = ( uint32_t ) ( ( ( ( uint64_t ) ulTotal * ulPercent ) + 99U ) / 100U );
+    uint32_t ulSeen = 0;
+    uint32_t ulUs = pxHistogram->ulMaxUs;
+    uint32_t i;
+
+    for( i = 0; i < ( pathtraceBUCKETS - 1U ); i++ )
+    {
+        ulSeen += pxHistogram->usBuckets[ i ];
+
+        if( ulSeen >= ulRank )
+        {
+            ulUs = prvBucketStart( i + 1U ) - 1U;
+            break;
+        }
+    }
+
+    return ( ulUs < pxHistogram->ulMaxUs ) ? ulUs : pxHistogram->ulMaxUs;
+}
+
+/*-----------------------------------------------------------*/
+
+void PathTrace_Init( const PathTraceConfig_t * pxConfig )
+{
+    xTraceConfig = *pxConfig;
+    PathTrace_Reset();
+}
+
+/*-----------------------------------------------------------*/
+
+void PathTrace_Reset( void )
+{
+    prvEnterCritical();
+    memset( xHistograms, 0, sizeof( xHistograms ) );
+    prvExitCritical();
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t PathTrace_Begin( void )
+{
+    uint32_t ulNow = 0;
+
+    if( xTraceConfig.xTimestamp != NULL )
+    {
+        ulNow = xTraceConfig.xTimestamp();
+    }
+
+    return ulNow;
+}
+
+/*-----------------------------------------------------------*/
+
+void PathTrace_End( PathTraceStage_t eStage,
+                    uint32_t ulStart )
+{
+    if( xTraceConfig.xTimestamp != NULL )
+    {
+        PathTrace_Record( eStage, xTraceConfig.xTimestamp() - ulStart );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void PathTrace_Record( PathTraceStage_t eStage,
+                       uint32_t ulTicks )
+{
+    PathTraceHistogram_t * pxHistogram;
+    uint32_t ulUs;
+    uint32_t ulBucket;
+    uint32_t i;
+
+    if( ( xTraceConfig.xTimestamp != NULL ) && ( ( uint32_t ) eStage < ( uint32_t ) PATH_TRACE_STAGE_COUNT ) )
+    {
+        pxHistogram = &xHistograms[ eStage ];
+        ulUs = ulTicks / xTraceConfig.ulTicksPerUs;
+        ulBucket = prvBucket( ulUs );
+
+        prvEnterCritical();
+
+        if( pxHistogram->usBuckets[ ulBucket ] == pathtraceBUCKET_MAX )
+        {
+            for( i = 0; i < pathtraceBUCKETS; i++ )
+            {
+                /* A bucket in use stays in use. */
+                pxHistogram->usBuckets[ i ] = ( uint16_t ) ( ( pxHistogram->usBuckets[ i ] + 1U ) / 2U );
+            }
+        }
+
+        pxHistogram->usBuckets[ ulBucket ]++;
+        pxHistogram->ulCount++;
+
+        if( ulUs > pxHistogram->ulMaxUs )
+        {
+            pxHistogram->ulMaxUs = ulUs;
+        }
+
+        prvExitCritical();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void PathTrace_Report( PathTraceStage_t eStage,
+                       PathTraceReport_t * pxReport )
+{
+    PathTraceHistogram_t xHistogram;
+    uint32_t ulTotal = 0;
+    uint32_t i;
+
+    memset( pxReport, 0, sizeof( *pxReport ) );
+
+    if( ( uint32_t ) eStage < ( uint32_t ) PATH_TRACE_STAGE_COUNT )
+    {
+        prvEnterCritical();
+        xHistogram = xHistograms[ eStage ];
+        prvExitCritical();
+
+        for( i = 0; i < pathtraceBUCKETS; i++ )
+        {
+            ulTotal += xHistogram.usBuckets[ i ];
+        }
+
+        if( ulTotal > 0U )
+        {
+            pxReport->ulCount = xHistogram.ulCount;
+            pxReport->ulP50Us = prvPercentile( &xHistogram, ulTotal, 50U );
+            pxReport->ulP99Us = prvPercentile( &xHistogram, ulTotal, 99U );
+            pxReport->ulMaxUs = xHistogram.ulMaxUs;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+const char * PathTrace_StageName( PathTraceStage_t eStage )
+{
+    const char * pcName = "?";
+
+    if( ( uint32_t ) eStage < ( uint32_t ) PATH_TRACE_STAGE_COUNT )
+    {
+        pcName = pcStageNames[ eStage ];
+    }
+
+    return pcName;
+}
@@ -0,0 +1,136 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file path_trace.h
+ * @brief Latency of the stages of the publish path, from meter read to PUBACK.
+ *
+ * Each stage keeps a histogram of its durations in fixed memory, so the p50
+ * and p99 latency of every stage can be read from the console of a device in
+ * the field. A trace point costs two reads of the timestamp counter and a
+ * bucket increment.
+ *
+ * The timestamp is a free running 32-bit counter given by the board, the DWT
+ * cycle counter on the target and clock_gettime() in the host tests. A stage
+ * must be shorter than one wrap of the counter, 53 s at 80 MHz.
+ *
+ * Buckets are log-linear in microseconds: pathtraceSUB_BUCKETS per power of
+ * two, so a percentile is reported within 25% above its value.
+ */
+
+#ifndef _PATH_TRACE_H_
+#define _PATH_TRACE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Buckets per power of two of the duration.
+ */
+#define pathtraceSUB_BUCKETS          ( 4U )
+
+/**
+ * @brief Buckets of a stage. The last one takes durations of 58 s and more.
+ */
+#define pathtraceBUCKETS              ( 100U )
+
+/**
+ * @brief Stages of the publish path.
+ */
+typedef enum PathTraceStage
+{
+    PATH_TRACE_METER_READ = 0,      /**< Modbus request sent to reply received. */
+    PATH_TRACE_RECORD_ENCODE,       /**< Meter record payload built by the MQTT demo. */
+    PATH_TRACE_MQTT_SERIALIZE,      /**< PUBLISH packet serialized. */
+    PATH_TRACE_TLS_ENCRYPT,         /**< TLS_Send, network sends excluded. */
+    PATH_TRACE_COM_SEND,            /**< com_send_ip_modem, chunking and coalescing included. */
+    PATH_TRACE_COM_MODEM_SEND,      /**< One low level send, a chain of AT+QISEND up to SEND OK. */
+    PATH_TRACE_MQTT_PUBACK,         /**< PUBLISH sent to PUBACK received. */
+    PATH_TRACE_STAGE_COUNT
+} PathTraceStage_t;
+
+/**
+ * @brief Timestamp source and locking of the trace points.
+ */
+typedef struct PathTraceConfig
+{
+    uint32_t ( * xTimestamp )( void );  /**< Free running counter. */
+    uint32_t ulTicksPerUs;              /**< Counter ticks per microsecond. */
+    void ( * xEnterCritical )( void );  /**< NULL if the stages are recorded by a single task. */
+    void ( * xExitCritical )( void );
+} PathTraceConfig_t;
+
+/**
+ * @brief Latency summary of a stage.
+ */
+typedef struct PathTraceReport
+{
+    uint32_t ulCount;   /**< Durations recorded since the last reset. */
+    uint32_t ulP50Us;   /**< Median, upper bound of its bucket. */
+    uint32_t ulP99Us;   /**< 99th percentile, upper bound of its bucket. */
+    uint32_t ulMaxUs;   /**< Longest duration. */
+} PathTraceReport_t;
+
+/**
+ * @brief Start tracing, the histograms are cleared.
+ *
+ * Trace points reached before do nothing.
+ */
+void PathTrace_Init( const PathTraceConfig_t * pxConfig );
+
+/**
+ * @brief Clear the histograms.
+ */
+void PathTrace_Reset( void );
+
+/**
+ * @brief Timestamp of the start of a stage, 0 when tracing is not started.
+ */
+uint32_t PathTrace_Begin( void );
+
+/**
+ * @brief Record the duration of a stage started at @p ulStart.
+ */
+void PathTrace_End( PathTraceStage_t eStage,
+                    uint32_t ulStart );
+
+/**
+ * @brief Record a duration measured by the caller, in counter ticks.
+ */
+void PathTrace_Record( PathTraceStage_t eStage,
+                       uint32_t ulTicks );
+
+/**
+ * @brief Summarize the durations of a stage.
+ */
+void PathTrace_Report( PathTraceStage_t eStage,
+                       PathTraceReport_t * pxReport );
+
+/**
+ * @brief Short name of a stage, for the console.
+ */
+const char * PathTrace_StageName( PathTraceStage_t eStage );
+
+#endif /* _PATH_TRACE_H_ */
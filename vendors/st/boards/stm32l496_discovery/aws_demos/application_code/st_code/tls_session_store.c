@@ -0,0 +1,402 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file tls_session_store.c
+ * @brief TLS sessions kept in internal flash across resets and deep sleep.
+ */
+
+#include <string.h>
+
+#include "tls_session_store.h"
+
+/* "TS" in the upper half of the first header word, the record length in the
+ * lower half. */
+#define tlssessionstoreMAGIC             ( 0x54530000UL )
+#define tlssessionstoreMAGIC_MASK        ( 0xFFFF0000UL )
+#define tlssessionstoreLENGTH_MASK       ( 0x0000FFFFUL )
+
+/* The CRC covers the first three header words and the session. */
+#define tlssessionstoreCRC_OFFSET        ( 12U )
+
+/* Sequence numbers may wrap, compare them through the difference. */
+#define tlssessionstoreSEQUENCE_AFTER( a, b )    ( ( int32_t ) ( ( a ) - ( b ) ) > 0 )
+
+typedef struct TlsSessionRecordHeader
+{
+    uint32_t ulMagicLength;
+    uint32_t ulKey;      /* Hash of the server name. */
+    uint32_t ulSequence; /* Increments with every record of the region. */
+    uint32_t ulCrc;
+} TlsSessionRecordHeader_t;
+
+/* What a scan learnt about one page. */
+typedef struct TlsSessionPage
+{
+    bool xOwned;             /* The page holds a valid record. */
+    uint32_t ulKey;          /* Key of the first valid record. */
+    uint32_t ulLastOffset;   /* Last valid record of that key. */
+    uint32_t ulLastLength;
+    uint32_t ulLastSequence;
+    uint32_t ulFreeOffset;   /* Start of the erased space, page size if none. */
+} TlsSessionPage_t;
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvCrc32( uint32_t ulCrc,
+                          const volatile uint8_t * pucData,
+                          size_t xLength )
+{
+    /* CRC-32 (IEEE 802.3), four bits at a time. Start with 0. */
+    static const uint32_t ulTable[ 16 ] =
+    {
+        0x00000000UL, 0x1DB71064UL, 0x3B6E20C8UL, 0x26D930ACUL,
+        0x76DC4190UL, 0x6B6B51F4UL, 0x4DB26158UL, 0x5005713CUL,
+        0xEDB88320UL, 0xF00F9344UL, 0xD6D6A3E8UL, 0xCB61B38CUL,
+        0x9B64C2B0UL, 0x86D3D2D4UL, 0xA00AE278UL, 0xBDBDF21CUL
+    };
+    size_t i;
+
+    ulCrc = ~ulCrc;
+
+    for( i = 0; i < xLength; i++ )
+    {
+        ulCrc ^= pucData[ i ];
+        ulCrc = ( ulCrc >> 4 ) ^ ulTable[ ulCrc & 0x0FU ];
+        ulCrc = ( ulCrc >> 4 ) ^ ulTable[ ulCrc & 0x0FU ];
+    }
+
+    return ~ulCrc;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvKey( const char * pcEndpoint )
+{
+    /* FNV-1a. Two servers sharing a key would offer each other their
+     * session, which the server refuses with a full handshake. */
+    uint32_t ulHash = 0x811C9DC5UL;
+
+    while( *pcEndpoint != '\0' )
+    {
+        ulHash ^= ( uint8_t ) *pcEndpoint++;
+        ulHash *= 0x01000193UL;
+    }
+
+    return ulHash;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvRecordSize( uint32_t ulLength )
+{
+    return tlssessionstoreRECORD_HEADER_LENGTH +
+           ( ( ulLength + tlssessionstorePROGRAM_UNIT - 1U ) & ~( tlssessionstorePROGRAM_UNIT - 1U ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvScanPage( TlsSessionStore_t * pxStore,
+                         uint32_t ulPage,
+                         TlsSessionPage_t * pxPage )
+{
+    const TlsSessionFlash_t * pxFlash = pxStore->pxFlash;
+    const volatile uint8_t * pucPage = pxFlash->pucBase + ( ulPage * pxFlash->ulPageSize );
+    TlsSessionRecordHeader_t xHeader;
+    uint32_t ulOffset = 0;
+    uint32_t ulLength;
+    uint32_t ulCrc;
+    size_t i;
+
+    memset( pxPage, 0, sizeof( *pxPage ) );
+    pxPage->ulFreeOffset = pxFlash->ulPageSize;
+
+    while( ( ulOffset + tlssessionstoreRECORD_HEADER_LENGTH ) <= pxFlash->ulPageSize )
+    {
+        for( i = 0; i < sizeof( xHeader ); i++ )
+        {
+            ( ( uint8_t * ) &xHeader )[ i ] = pucPage[ ulOffset + i ];
+        }
+
+        if( ( xHeader.ulMagicLength == 0xFFFFFFFFUL ) && ( xHeader.ulKey == 0xFFFFFFFFUL ) &&
+            ( xHeader.ulSequence == 0xFFFFFFFFUL ) && ( xHeader.ulCrc == 0xFFFFFFFFUL ) )
+        {
+            pxPage->ulFreeOffset = ulOffset;
+            break;
+        }
+
+        ulLength = xHeader.ulMagicLength & tlssessionstoreLENGTH_MASK;
+
+        /* Not a record header: nothing can be appended after it. */
+        if( ( ( xHeader.ulMagicLength & tlssessionstoreMAGIC_MASK ) != tlssessionstoreMAGIC ) ||
+            ( ulLength > tlssessionstoreMAX_SESSION_LENGTH ) ||
+            ( ( ulOffset + prvRecordSize( ulLength ) ) > pxFlash->ulPageSize ) )
+        {
+            break;
+        }
+
+        ulCrc = prvCrc32( 0, pucPage + ulOffset, tlssessionstoreCRC_OFFSET );
+        ulCrc = prvCrc32( ulCrc, pucPage + ulOffset + tlssessionstoreRECORD_HEADER_LENGTH, ulLength );
+
+        if( ulCrc == xHeader.ulCrc )
+        {
+            if( pxPage->xOwned == false )
+            {
+                pxPage->xOwned = true;
+                pxPage->ulKey = xHeader.ulKey;
+            }
+
+            if( xHeader.ulKey == pxPage->ulKey )
+            {
+                pxPage->ulLastOffset = ulOffset;
+                pxPage->ulLastLength = ulLength;
+                pxPage->ulLastSequence = xHeader.ulSequence;
+            }
+
+            if( tlssessionstoreSEQUENCE_AFTER( xHeader.ulSequence + 1U, pxStore->ulNextSequence ) )
+            {
+                pxStore->ulNextSequence = xHeader.ulSequence + 1U;
+            }
+        }
+
+        ulOffset += prvRecordSize( ulLength );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvErase( TlsSessionStore_t * pxStore,
+                      uint32_t ulPage )
+{
+    const TlsSessionFlash_t * pxFlash = pxStore->pxFlash;
+
+    pxStore->xStats.ulErases++;
+
+    if( pxFlash->xErase( pxFlash->pvContext, ulPage * pxFlash->ulPageSize ) != 0 )
+    {
+        pxStore->xStats.ulFlashErrors++;
+
+        return false;
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+bool TlsSessionStore_Open( TlsSessionStore_t * pxStore,
+                           const TlsSessionFlash_t * pxFlash )
+{
+    TlsSessionPage_t xPage;
+    uint32_t ulPage;
+
+    if( ( pxFlash->xErase == NULL ) || ( pxFlash->xProgram == NULL ) ||
+        ( pxFlash->ulPageCount == 0U ) ||
+        ( ( pxFlash->ulPageSize % tlssessionstorePROGRAM_UNIT ) != 0U ) ||
+        ( pxFlash->ulPageSize < prvRecordSize( tlssessionstoreMAX_SESSION_LENGTH ) ) )
+    {
+        return false;
+    }
+
+    memset( pxStore, 0, sizeof( *pxStore ) );
+    pxStore->pxFlash = pxFlash;
+
+    /* Scanning every page brings the next sequence past all records. */
+    for( ulPage = 0; ulPage < pxFlash->ulPageCount; ulPage++ )
+    {
+        prvScanPage( pxStore, ulPage, &xPage );
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+bool TlsSessionStore_Load( TlsSessionStore_t * pxStore,
+                           const char * pcEndpoint,
+                           uint8_t * pucSession,
+                           size_t * pxLength )
+{
+    const TlsSessionFlash_t * pxFlash = pxStore->pxFlash;
+    uint32_t ulKey = prvKey( pcEndpoint );
+    TlsSessionPage_t xPage;
+    const volatile uint8_t * pucRecord;
+    uint32_t ulPage;
+    size_t i;
+
+    for( ulPage = 0; ulPage < pxFlash->ulPageCount; ulPage++ )
+    {
+        prvScanPage( pxStore, ulPage, &xPage );
+
+        if( ( xPage.xOwned == true ) && ( xPage.ulKey == ulKey ) && ( xPage.ulLastLength > 0U ) )
+        {
+            pucRecord = pxFlash->pucBase + ( ulPage * pxFlash->ulPageSize ) +
+                        xPage.ulLastOffset + tlssessionstoreRECORD_HEADER_LENGTH;
+
+            for( i = 0; i < xPage.ulLastLength; i++ )
+            {
+                pucSession[ i ] = pucRecord[ i ];
+            }
+
+            *pxLength = xPage.ulLastLength;
+            pxStore->xStats.ulHits++;
+
+            return true;
+        }
+    }
+
+    pxStore->xStats.ulMisses++;
+
+    return false;
+}
+
+/*-----------------------------------------------------------*/
+
+bool TlsSessionStore_Save( TlsSessionStore_t * pxStore,
+                           const char * pcEndpoint,
+                           const uint8_t * pucSession,
+                           size_t xLength )
+{
+    const TlsSessionFlash_t * pxFlash = pxStore->pxFlash;
+    uint32_t ulKey = prvKey( pcEndpoint );
+    TlsSessionRecordHeader_t * pxHeader = ( TlsSessionRecordHeader_t * ) pxStore->xRecord.ucBytes;
+    TlsSessionPage_t xPage;
+    TlsSessionPage_t xTarget;
+    uint32_t ulTarget = 0;
+    uint32_t ulRank;
+    uint32_t ulBestRank = 0;
+    uint32_t ulSize;
+    uint32_t ulPage;
+
+    if( xLength > tlssessionstoreMAX_SESSION_LENGTH )
+    {
+        return false;
+    }
+
+    /* Use the page of the server, or else the first erased page, or else a
+     * page whose session was forgotten, or else the least recently written
+     * page. */
+    memset( &xTarget, 0, sizeof( xTarget ) );
+
+    for( ulPage = 0; ( ulPage < pxFlash->ulPageCount ) && ( ulBestRank < 4U ); ulPage++ )
+    {
+        prvScanPage( pxStore, ulPage, &xPage );
+
+        if( ( xPage.xOwned == true ) && ( xPage.ulKey == ulKey ) )
+        {
+            ulRank = 4U;
+        }
+        else if( ( xPage.xOwned == false ) && ( xPage.ulFreeOffset == 0U ) )
+        {
+            ulRank = 3U;
+        }
+        else if( ( xPage.xOwned == false ) || ( xPage.ulLastLength == 0U ) )
+        {
+            ulRank = 2U;
+        }
+        else
+        {
+            ulRank = 1U;
+        }
+
+        if( ( ulRank > ulBestRank ) ||
+            ( ( ulRank == 1U ) && ( ulBestRank == 1U ) &&
+              tlssessionstoreSEQUENCE_AFTER( xTarget.ulLastSequence, xPage.ulLastSequence ) ) )
+        {
+            ulBestRank = ulRank;
+            ulTarget = ulPage;
+            xTarget = xPage;
+        }
+    }
+
+    if( ulBestRank != 4U )
+    {
+        /* Nothing to forget for a server without a page. */
+        if( xLength == 0U )
+        {
+            return true;
+        }
+
+        /* The page changes owner, drop its records. */
+        if( ( xTarget.ulFreeOffset != 0U ) || ( xTarget.xOwned == true ) )
+        {
+            if( prvErase( pxStore, ulTarget ) == false )
+            {
+                return false;
+            }
+        }
+
+        xTarget.ulFreeOffset = 0;
+    }
+    else if( ( xLength == 0U ) && ( xTarget.ulLastLength == 0U ) )
+    {
+        /* Already forgotten. */
+        return true;
+    }
+
+    ulSize = prvRecordSize( ( uint32_t ) xLength );
+
+    if( ( xTarget.ulFreeOffset + ulSize ) > pxFlash->ulPageSize )
+    {
+        if( prvErase( pxStore, ulTarget ) == false )
+        {
+            return false;
+        }
+
+        xTarget.ulFreeOffset = 0;
+    }
+
+    /* Build the record, header first so that a reset in the middle of the
+     * program leaves a record failing its CRC. */
+    memset( pxStore->xRecord.ucBytes, 0xFF, ulSize );
+    pxHeader->ulMagicLength = tlssessionstoreMAGIC | ( uint32_t ) xLength;
+    pxHeader->ulKey = ulKey;
+    pxHeader->ulSequence = pxStore->ulNextSequence;
+
+    if( xLength > 0U )
+    {
+        memcpy( &pxStore->xRecord.ucBytes[ tlssessionstoreRECORD_HEADER_LENGTH ], pucSession, xLength );
+    }
+
+    pxHeader->ulCrc = prvCrc32( 0, pxStore->xRecord.ucBytes, tlssessionstoreCRC_OFFSET );
+    pxHeader->ulCrc = prvCrc32( pxHeader->ulCrc,
+                                &pxStore->xRecord.ucBytes[ tlssessionstoreRECORD_HEADER_LENGTH ],
+                                xLength );
+
+    pxStore->ulNextSequence++;
+    pxStore->xStats.ulWrites++;
+
+    if( pxFlash->xProgram( pxFlash->pvContext,
+                           ( ulTarget * pxFlash->ulPageSize ) + xTarget.ulFreeOffset,
+                           pxStore->xRecord.ullAlign,
+                           ulSize ) != 0 )
+    {
+        pxStore->xStats.ulFlashErrors++;
+
+        return false;
+    }
+
+    return true;
+}
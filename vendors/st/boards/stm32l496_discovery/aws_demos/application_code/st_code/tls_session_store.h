@@ -0,0 +1,168 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file tls_session_store.h
+ * @brief TLS sessions kept in internal flash across resets and deep sleep.
+ *
+ * Each server name owns one flash page of the region, found through a hash
+ * of the name. Saving a session appends a CRC protected record to the page of
+ * the server, the page is erased only once it is full, so renewing a session
+ * ticket costs a program operation. When every page is owned by another
+ * server, the page used least recently is reclaimed.
+ *
+ * The records hold the master secret of the sessions in clear. The region
+ * must not be readable from outside the device (RDP level 1 or above).
+ *
+ * The flash is reached through callbacks, like the meter journal.
+ */
+
+#ifndef _TLS_SESSION_STORE_H_
+#define _TLS_SESSION_STORE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @brief Largest session that can be stored, matches tlsSESSION_MAX_LENGTH of
+ * the TLS library.
+ */
+#ifndef tlssessionstoreMAX_SESSION_LENGTH
+    #define tlssessionstoreMAX_SESSION_LENGTH    ( 512U )
+#endif
+
+/**
+ * @brief Smallest unit the flash can program, in bytes.
+ */
+#define tlssessionstorePROGRAM_UNIT              ( 8U )
+
+/**
+ * @brief Length of the header preceding each session record.
+ */
+#define tlssessionstoreRECORD_HEADER_LENGTH      ( 16U )
+
+/**
+ * @brief Flash access used by the store.
+ *
+ * Offsets are relative to the start of the region, which is read directly
+ * through @p pucBase.
+ */
+typedef struct TlsSessionFlash
+{
+    const volatile uint8_t * pucBase; /**< Memory mapped region. */
+    uint32_t ulPageSize;              /**< Erase unit, holds at least one record of the largest session. */
+    uint32_t ulPageCount;             /**< Pages in the region, one per server. */
+
+    /**
+     * @brief Erase one page, return 0 on success.
+     */
+    int32_t ( * xErase )( void * pvContext,
+                          uint32_t ulOffset );
+
+    /**
+     * @brief Program erased flash, return 0 on success. @p ulOffset and
+     * @p ulLength are multiples of tlssessionstorePROGRAM_UNIT and @p pvData
+     * is 8-byte aligned.
+     */
+    int32_t ( * xProgram )( void * pvContext,
+                            uint32_t ulOffset,
+                            const void * pvData,
+                            uint32_t ulLength );
+
+    void * pvContext;
+} TlsSessionFlash_t;
+
+/**
+ * @brief Store counters.
+ */
+typedef struct TlsSessionStoreStats
+{
+    uint32_t ulHits;        /**< Loads that found a session. */
+    uint32_t ulMisses;      /**< Loads that found none. */
+    uint32_t ulWrites;      /**< Records programmed. */
+    uint32_t ulErases;      /**< Pages erased. */
+    uint32_t ulFlashErrors; /**< Failed erase or program operations. */
+} TlsSessionStoreStats_t;
+
+/**
+ * @brief Store state. Only the sequence of the next record is kept, the
+ * pages are scanned on each access.
+ */
+typedef struct TlsSessionStore
+{
+    const TlsSessionFlash_t * pxFlash;
+    uint32_t ulNextSequence;
+
+    /* Record image, aligned for the double word programming of the flash. */
+    union
+    {
+        uint64_t ullAlign[ ( tlssessionstoreRECORD_HEADER_LENGTH + tlssessionstoreMAX_SESSION_LENGTH ) / sizeof( uint64_t ) ];
+        uint8_t ucBytes[ tlssessionstoreRECORD_HEADER_LENGTH + tlssessionstoreMAX_SESSION_LENGTH ];
+    } xRecord;
+
+    TlsSessionStoreStats_t xStats;
+} TlsSessionStore_t;
+
+/**
+ * @brief Open the store on a flash region.
+ *
+ * A record that was being written when the device reset fails its CRC and is
+ * ignored, the previous session of the server is used instead.
+ *
+ * @return false if the flash description is invalid.
+ */
+bool TlsSessionStore_Open( TlsSessionStore_t * pxStore,
+                           const TlsSessionFlash_t * pxFlash );
+
+/**
+ * @brief Copy the session saved for a server.
+ *
+ * @param[in] pcEndpoint Server name.
+ * @param[out] pucSession Buffer of tlssessionstoreMAX_SESSION_LENGTH bytes.
+ * @param[out] pxLength Length of the session.
+ *
+ * @return true if a session was found.
+ */
+bool TlsSessionStore_Load( TlsSessionStore_t * pxStore,
+                           const char * pcEndpoint,
+                           uint8_t * pucSession,
+                           size_t * pxLength );
+
+/**
+ * @brief Save the session of a server, replacing the previous one.
+ *
+ * @param[in] pcEndpoint Server name.
+ * @param[in] pucSession Session to save, may be NULL if @p xLength is 0.
+ * @param[in] xLength Length of the session, 0 forgets the session.
+ *
+ * @return false if the session is too long or the flash operation failed.
+ */
+bool TlsSessionStore_Save( TlsSessionStore_t * pxStore,
+                           const char * pcEndpoint,
+                           const uint8_t * pucSession,
+                           size_t xLength );
+
+#endif /* _TLS_SESSION_STORE_H_ */
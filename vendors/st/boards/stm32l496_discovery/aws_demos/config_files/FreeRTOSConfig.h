@@ -168,6 +168,34 @@ extern int iMainRand32( void );
 #define configPRE_STOP_PROCESSING     vMainPreStopProcessing
 #define configPOST_STOP_PROCESSING    vMainPostStopProcessing
 
+/* Set to 1 to charge the heap blocks to the TLS connection being established
+ * by the task, see TLS_GetMemoryStats(). Each allocation and free then costs
+ * a lookup of the calling task. */
+#ifndef configUSE_TLS_HEAP_TRACE
+    #define configUSE_TLS_HEAP_TRACE    0
+#endif
+
+#if ( configUSE_TLS_HEAP_TRACE == 1 )
+    #if defined( __ICCARM__ ) || defined( __CC_ARM ) || defined( __GNUC__ )
+        #include <stddef.h>
+        void TLS_HeapTraceMalloc( void * pvAddress,
+                                  size_t xSize );
+        void TLS_HeapTraceFree( void * pvAddress,
+                                size_t xSize );
+    #endif /* defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__) */
+
+    #define traceMALLOC( pvAddress, uiSize )    TLS_HeapTraceMalloc( ( pvAddress ), ( uiSize ) )
+    #define traceFREE( pvAddress, uiSize )      TLS_HeapTraceFree( ( pvAddress ), ( uiSize ) )
+#endif
+
+/* Time spent protecting TLS records, see path_trace.h. */
+#if defined( __ICCARM__ ) || defined( __CC_ARM ) || defined( __GNUC__ )
+    #include "path_trace.h"
+#endif /* defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__) */
+
+#define tlsTRACE_TIMESTAMP()           PathTrace_Begin()
+#define tlsTRACE_ENCRYPT( ulTicks )    PathTrace_Record( PATH_TRACE_TLS_ENCRYPT, ( ulTicks ) )
+
 /* Definitions that map the FreeRTOS port interrupt handlers to their CMSIS
  * standard names. */
 #define vPortSVCHandler               SVC_Handler
@@ -28,6 +28,10 @@
 #define IOT_DEMO_MQTT_PUBLISH_BURST_COUNT       ( 10 )
 #define IOT_DEMO_MQTT_PUBLISH_BURST_SIZE        ( 2 )
 
+/* Meter records stay in JSON for the existing consumers. METER_RECORD_FORMAT_CBOR
+ * cuts each record to about a third of the bytes. */
+#define IOT_DEMO_MQTT_METER_RECORD_FORMAT       METER_RECORD_FORMAT_JSON
+
 /* Shadow demo configuration. The demo publishes periodic Shadow updates and responds
  * to changing Shadows. */
 #define AWS_IOT_DEMO_SHADOW_UPDATE_COUNT        ( 20 )   /* Number of updates to publish. */
@@ -51,6 +55,11 @@
 #define IOT_THREAD_DEFAULT_STACK_SIZE           2048
 #define IOT_THREAD_DEFAULT_PRIORITY             5
 
+/* Latency of the PUBLISH path, printed by the "latency" console command. */
+#include "path_trace.h"
+#define IotMqtt_TraceBegin()                    PathTrace_Begin()
+#define IotMqtt_TraceEnd( stage, start )        PathTrace_End( PATH_TRACE_ ## stage, ( start ) )
+
 /* Include the common configuration file for FreeRTOS. */
 #include "iot_config_common.h"
 
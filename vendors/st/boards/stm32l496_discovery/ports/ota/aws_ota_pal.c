@@ -0,0 +1,531 @@
+/*
+ * FreeRTOS OTA PAL for STM32L4 Discovery kit IoT node V1.0.0
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file aws_ota_pal.c
+ * @brief OTA PAL writing the update to the inactive bank of the STM32L4 flash.
+ *
+ * The image is hashed while its blocks are programmed (see ota_bank.h), the
+ * signature check at close only finishes the hash. The update is committed
+ * by booting from the other bank, with a trial run that the OTA agent must
+ * accept.
+ */
+
+/* C Runtime includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* FreeRTOS include. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "aws_iot_ota_pal.h"
+#include "aws_iot_ota_agent_internal.h"
+#include "aws_ota_pal_boot.h"
+#include "iot_crypto.h"
+#include "aws_ota_codesigner_certificate.h"
+
+/* ST includes. */
+#include "stm32l4xx_hal.h"
+#include "flash.h"
+#include "ota_bank.h"
+
+/* Specify the OTA signature algorithm we support on this platform. */
+const char cOTA_JSON_FileSignatureKey[ OTA_FILE_SIG_KEY_STR_MAX_LENGTH ] = "sig-sha256-ecdsa";
+
+/* Application data window at the top of the bank mapped second, see the
+ * linker script. */
+extern uint8_t _sapp_data[];
+extern uint8_t _eapp_data[];
+
+/* End of the running image and end of the image area of a bank. */
+extern uint8_t _eimage[];
+extern uint8_t _eota_image[];
+
+/**
+ * @brief Verify the signature of the specified file.
+ *
+ * The hash was computed while the blocks were written, only the signature
+ * itself is checked here.
+ *
+ * This function is called from prvPAL_Close().
+ *
+ * @param[in] C OTA file context information.
+ *
+ * @return Below are the valid return values for this function.
+ * kOTA_Err_None if the signature verification passes.
+ * kOTA_Err_SignatureCheckFailed if the signature verification fails.
+ * kOTA_Err_BadSignerCert if the if the signature verification certificate cannot be read.
+ *
+ */
+static OTA_Err_t prvPAL_CheckFileSignature( OTA_FileContext_t * const C );
+
+/**
+ * @brief Read the specified signer certificate.
+ *
+ * The certificate built in from aws_ota_codesigner_certificate.h is used
+ * whatever the path. It is not allocated and must not be freed.
+ *
+ * This function is called from prvPAL_CheckFileSignature().
+ *
+ * @param[in] pucCertName The file path of the certificate file.
+ * @param[out] ulSignerCertSize The size of the certificate file read.
+ *
+ * @return A pointer to the signer certificate. NULL if the certificate cannot be read.
+ */
+static uint8_t * prvPAL_ReadAndAssumeCertificate( const uint8_t * const pucCertName,
+                                                  uint32_t * const ulSignerCertSize );
+
+static int32_t prvFlashErase( void * pvContext,
+                              uint32_t ulBank,
+                              uint32_t ulOffset );
+static int32_t prvFlashProgram( void * pvContext,
+                                uint32_t ulBank,
+                                uint32_t ulOffset,
+                                const void * pvData,
+                                uint32_t ulLength );
+static int32_t prvFlashSwap( void * pvContext );
+static void prvFlashLock( void * pvContext );
+static void prvFlashUnlock( void * pvContext );
+
+/* The banks are located at boot. */
+static OtaBankFlash_t xOtaBankFlash =
+{
+    .ulPageSize = FLASH_PAGE_SIZE,
+    .xErase     = prvFlashErase,
+    .xProgram   = prvFlashProgram,
+    .xSwap      = prvFlashSwap,
+    .xLock      = prvFlashLock,
+    .xUnlock    = prvFlashUnlock,
+    .pvContext  = NULL
+};
+
+static OtaBank_t xOtaBank;
+static bool xOtaBankOpen = false;
+
+/* Signature verification context of the file being received. */
+static void * pvSignatureContext = NULL;
+
+/*-----------------------------------------------------------*/
+
+static int32_t prvFlashErase( void * pvContext,
+                              uint32_t ulBank,
+                              uint32_t ulOffset )
+{
+    int lResult;
+
+    ( void ) pvContext;
+
+    FLASH_access_take();
+    /* Leaves the flash unlocked. */
+    lResult = FLASH_unlock_erase( ( uint32_t ) xOtaBankFlash.pucBank[ ulBank ] + ulOffset, FLASH_PAGE_SIZE );
+    HAL_FLASH_Lock();
+    FLASH_access_give();
+
+    return ( lResult == 0 ) ? 0 : -1;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t prvFlashProgram( void * pvContext,
+                                uint32_t ulBank,
+                                uint32_t ulOffset,
+                                const void * pvData,
+                                uint32_t ulLength )
+{
+    int lResult;
+
+    ( void ) pvContext;
+
+    FLASH_access_take();
+    HAL_FLASH_Unlock();
+    __HAL_FLASH_CLEAR_FLAG( FLASH_FLAG_ALL_ERRORS );
+    lResult = FLASH_write_at( ( uint32_t ) xOtaBankFlash.pucBank[ ulBank ] + ulOffset, ( uint64_t * ) pvData, ulLength );
+    HAL_FLASH_Lock();
+    FLASH_access_give();
+
+    return ( lResult == 0 ) ? 0 : -1;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t prvFlashSwap( void * pvContext )
+{
+    ( void ) pvContext;
+
+    /* The system bootloader starts the bank selected by BFB2 and maps it
+     * first. Loading the option bytes resets the device. */
+    FLASH_access_take();
+
+    if( FLASH_set_boot_bank( FLASH_BANK_BOTH ) == 0 )
+    {
+        ( void ) HAL_FLASH_OB_Launch();
+    }
+
+    HAL_FLASH_OB_Lock();
+    HAL_FLASH_Lock();
+    FLASH_access_give();
+
+    return -1;
+}
+/*-----------------------------------------------------------*/
+
+static void prvFlashLock( void * pvContext )
+{
+    ( void ) pvContext;
+
+    /* The meter journal, the TLS session store and the KV store write to the
+     * application data window, they wait until the banks are swapped. */
+    FLASH_access_take();
+}
+/*-----------------------------------------------------------*/
+
+static void prvFlashUnlock( void * pvContext )
+{
+    ( void ) pvContext;
+
+    FLASH_access_give();
+}
+/*-----------------------------------------------------------*/
+
+static void prvReleaseSignatureContext( void )
+{
+    if( pvSignatureContext != NULL )
+    {
+        /* Called with the context alone, only frees it. */
+        ( void ) CRYPTO_SignatureVerificationFinal( pvSignatureContext, NULL, 0, NULL, 0 );
+        pvSignatureContext = NULL;
+    }
+}
+/*-----------------------------------------------------------*/
+
+void OTA_PAL_BootCheck( void )
+{
+    /* Linked past the image area of its bank, the running image overlaps the
+     * descriptor page and the start of the other bank. */
+    if( ( uint32_t ) _eimage > ( uint32_t ) _eota_image )
+    {
+        configPRINTF( ( "OTA PAL: image of %u bytes larger than the OTA bank layout, updates disabled\r\n",
+                        ( unsigned ) ( ( uint32_t ) _eimage - FLASH_BASE ) ) );
+    }
+    else
+    {
+        xOtaBankFlash.pucBank[ otabankRUNNING ] = ( const volatile uint8_t * ) FLASH_get_current_bank_addr();
+        xOtaBankFlash.pucBank[ otabankINACTIVE ] = ( const volatile uint8_t * ) FLASH_get_alternate_bank_addr();
+        xOtaBankFlash.ulDataOffset = ( uint32_t ) _sapp_data - FLASH_get_alternate_bank_addr();
+        xOtaBankFlash.ulBankSize = ( uint32_t ) _eapp_data - FLASH_get_alternate_bank_addr();
+
+        xOtaBankOpen = OtaBank_Open( &xOtaBank, &xOtaBankFlash );
+
+        if( xOtaBankOpen == false )
+        {
+            configPRINTF( ( "OTA PAL: invalid flash layout, updates disabled\r\n" ) );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+OTA_Err_t prvPAL_CreateFileForRx( OTA_FileContext_t * const C )
+{
+    DEFINE_OTA_METHOD_NAME( "prvPAL_CreateFileForRx" );
+
+    OTA_Err_t xResult = kOTA_Err_None;
+
+    prvReleaseSignatureContext();
+
+    if( xOtaBankOpen == false )
+    {
+        xResult = kOTA_Err_RxFileCreateFailed;
+    }
+    else if( C->ulFileSize > OtaBank_MaxImageSize( &xOtaBank ) )
+    {
+        OTA_LOG_L1( "[%s] Image of %u bytes larger than the bank.\r\n", OTA_METHOD_NAME, C->ulFileSize );
+        xResult = kOTA_Err_RxFileTooLarge;
+    }
+    else if( CRYPTO_SignatureVerificationStart( &pvSignatureContext,
+                                                cryptoASYMMETRIC_ALGORITHM_ECDSA,
+                                                cryptoHASH_ALGORITHM_SHA256 ) != pdTRUE )
+    {
+        pvSignatureContext = NULL;
+        xResult = kOTA_Err_RxFileCreateFailed;
+    }
+    else if( OtaBank_Begin( &xOtaBank,
+                            C->ulFileSize,
+                            OTA_FILE_BLOCK_SIZE,
+                            CRYPTO_SignatureVerificationUpdate,
+                            pvSignatureContext ) == false )
+    {
+        OTA_LOG_L1( "[%s] Could not erase the inactive bank.\r\n", OTA_METHOD_NAME );
+        prvReleaseSignatureContext();
+        xResult = kOTA_Err_RxFileCreateFailed;
+    }
+    else
+    {
+        C->pucFile = ( uint8_t * ) xOtaBankFlash.pucBank[ otabankINACTIVE ];
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+OTA_Err_t prvPAL_Abort( OTA_FileContext_t * const C )
+{
+    DEFINE_OTA_METHOD_NAME( "prvPAL_Abort" );
+
+    OTA_Err_t xResult = kOTA_Err_None;
+
+    prvReleaseSignatureContext();
+
+    if( ( xOtaBankOpen == true ) && ( OtaBank_Abort( &xOtaBank ) == false ) )
+    {
+        OTA_LOG_L1( "[%s] Could not mark the image aborted.\r\n", OTA_METHOD_NAME );
+        xResult = kOTA_Err_FileAbort;
+    }
+
+    C->pucFile = NULL;
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+/* Write a block of data to the specified file. */
+int16_t prvPAL_WriteBlock( OTA_FileContext_t * const C,
+                           uint32_t ulOffset,
+                           uint8_t * const pacData,
+                           uint32_t ulBlockSize )
+{
+    DEFINE_OTA_METHOD_NAME( "prvPAL_WriteBlock" );
+
+    int32_t lResult;
+
+    ( void ) C;
+
+    lResult = OtaBank_Write( &xOtaBank, ulOffset, pacData, ulBlockSize );
+
+    if( lResult < 0 )
+    {
+        OTA_LOG_L1( "[%s] Error writing %u bytes at offset %u.\r\n", OTA_METHOD_NAME, ulBlockSize, ulOffset );
+    }
+
+    return ( int16_t ) lResult;
+}
+/*-----------------------------------------------------------*/
+
+OTA_Err_t prvPAL_CloseFile( OTA_FileContext_t * const C )
+{
+    DEFINE_OTA_METHOD_NAME( "prvPAL_CloseFile" );
+
+    OTA_Err_t xResult;
+
+    xResult = prvPAL_CheckFileSignature( C );
+
+    if( ( OtaBank_Close( &xOtaBank, ( xResult == kOTA_Err_None ) ) == false ) &&
+        ( xResult == kOTA_Err_None ) )
+    {
+        OTA_LOG_L1( "[%s] Could not mark the image verified.\r\n", OTA_METHOD_NAME );
+        xResult = kOTA_Err_FileClose;
+    }
+
+    C->pucFile = NULL;
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+static OTA_Err_t prvPAL_CheckFileSignature( OTA_FileContext_t * const C )
+{
+    DEFINE_OTA_METHOD_NAME( "prvPAL_CheckFileSignature" );
+
+    OTA_Err_t xResult = kOTA_Err_None;
+    uint8_t * pucSignerCert;
+    uint32_t ulSignerCertSize;
+
+    if( ( pvSignatureContext == NULL ) || ( OtaBank_Complete( &xOtaBank ) == false ) )
+    {
+        OTA_LOG_L1( "[%s] Image incomplete.\r\n", OTA_METHOD_NAME );
+        xResult = kOTA_Err_SignatureCheckFailed;
+    }
+    else
+    {
+        pucSignerCert = prvPAL_ReadAndAssumeCertificate( C->pucCertFilepath, &ulSignerCertSize );
+
+        if( pucSignerCert == NULL )
+        {
+            xResult = kOTA_Err_BadSignerCert;
+        }
+        else if( CRYPTO_SignatureVerificationFinal( pvSignatureContext,
+                                                    ( char * ) pucSignerCert,
+                                                    ulSignerCertSize,
+                                                    C->pxSignature->ucData,
+                                                    C->pxSignature->usSize ) != pdTRUE )
+        {
+            OTA_LOG_L1( "[%s] Signature verification failed.\r\n", OTA_METHOD_NAME );
+            xResult = kOTA_Err_SignatureCheckFailed;
+        }
+        else
+        {
+            OTA_LOG_L1( "[%s] Signature verification passed.\r\n", OTA_METHOD_NAME );
+        }
+
+        /* The final step frees the context. */
+        if( pucSignerCert != NULL )
+        {
+            pvSignatureContext = NULL;
+        }
+    }
+
+    prvReleaseSignatureContext();
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+static uint8_t * prvPAL_ReadAndAssumeCertificate( const uint8_t * const pucCertName,
+                                                  uint32_t * const ulSignerCertSize )
+{
+    ( void ) pucCertName;
+
+    /* The PEM parser expects the terminating null character. */
+    *ulSignerCertSize = sizeof( signingcredentialSIGNING_CERTIFICATE_PEM );
+
+    return ( uint8_t * ) signingcredentialSIGNING_CERTIFICATE_PEM;
+}
+/*-----------------------------------------------------------*/
+
+OTA_Err_t prvPAL_ResetDevice( void )
+{
+    /* A rejected image is rolled back by OTA_PAL_BootCheck() after the
+     * reset. */
+    NVIC_SystemReset();
+
+    return kOTA_Err_ResetNotSupported;
+}
+/*-----------------------------------------------------------*/
+
+OTA_Err_t prvPAL_ActivateNewImage( void )
+{
+    DEFINE_OTA_METHOD_NAME( "prvPAL_ActivateNewImage" );
+
+    /* No task may write the application data window while it is copied to
+     * the other bank. Returns only on failure. */
+    if( xOtaBankOpen == true )
+    {
+        vTaskSuspendAll();
+        ( void ) OtaBank_Activate( &xOtaBank );
+        ( void ) xTaskResumeAll();
+    }
+
+    OTA_LOG_L1( "[%s] Could not boot the new image.\r\n", OTA_METHOD_NAME );
+
+    return kOTA_Err_ActivateFailed;
+}
+/*-----------------------------------------------------------*/
+
+OTA_Err_t prvPAL_SetPlatformImageState( OTA_ImageState_t eState )
+{
+    DEFINE_OTA_METHOD_NAME( "prvPAL_SetPlatformImageState" );
+
+    OTA_Err_t xResult = kOTA_Err_None;
+
+    if( xOtaBankOpen == false )
+    {
+        eState = eOTA_ImageState_Unknown;
+    }
+
+    switch( eState )
+    {
+        case eOTA_ImageState_Testing:
+            /* The trial run was started at boot. */
+            break;
+
+        case eOTA_ImageState_Accepted:
+
+            if( OtaBank_Accept( &xOtaBank ) == false )
+            {
+                xResult = kOTA_Err_CommitFailed;
+            }
+
+            break;
+
+        case eOTA_ImageState_Rejected:
+
+            if( OtaBank_Reject( &xOtaBank ) == false )
+            {
+                xResult = kOTA_Err_RejectFailed;
+            }
+
+            break;
+
+        case eOTA_ImageState_Aborted:
+            prvReleaseSignatureContext();
+
+            if( OtaBank_Reject( &xOtaBank ) == false )
+            {
+                xResult = kOTA_Err_AbortFailed;
+            }
+
+            break;
+
+        default:
+            xResult = kOTA_Err_BadImageState;
+            break;
+    }
+
+    if( xResult != kOTA_Err_None )
+    {
+        OTA_LOG_L1( "[%s] Could not set the image state %d.\r\n", OTA_METHOD_NAME, eState );
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+OTA_PAL_ImageState_t prvPAL_GetPlatformImageState( void )
+{
+    OTA_PAL_ImageState_t eImageState = eOTA_PAL_ImageState_Invalid;
+
+    if( xOtaBankOpen == true )
+    {
+        switch( OtaBank_GetState( &xOtaBank ) )
+        {
+            case eOtaBankValid:
+                eImageState = eOTA_PAL_ImageState_Valid;
+                break;
+
+            case eOtaBankPendingCommit:
+                eImageState = eOTA_PAL_ImageState_PendingCommit;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    return eImageState;
+}
+/*-----------------------------------------------------------*/
+
+/* Provide access to private members for testing. */
+#ifdef AMAZON_FREERTOS_ENABLE_UNIT_TESTS
+    #include "aws_ota_pal_test_access_define.h"
+#endif
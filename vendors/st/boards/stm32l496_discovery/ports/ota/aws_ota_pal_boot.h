@@ -0,0 +1,48 @@
+/*
+ * FreeRTOS OTA PAL for STM32L4 Discovery kit IoT node V1.0.0
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file aws_ota_pal_boot.h
+ * @brief Boot time part of the dual-bank OTA PAL.
+ */
+
+#ifndef _AWS_OTA_PAL_BOOT_H_
+#define _AWS_OTA_PAL_BOOT_H_
+
+/**
+ * @brief Locate the flash banks and check the state of the running image.
+ *
+ * Must be called once at boot, before the scheduler is started and before
+ * the application data regions are used. An update that reset during its
+ * trial run, or that was rejected, is rolled back here: the banks are swapped
+ * and the device resets. An update booting for the first time starts its
+ * trial run, to be accepted by the OTA agent.
+ *
+ * Updates stay disabled when the running image does not fit the image area
+ * of a bank, see _eota_image in the linker script.
+ */
+void OTA_PAL_BootCheck( void );
+
+#endif /* _AWS_OTA_PAL_BOOT_H_ */
@@ -43,19 +43,17 @@
 #include <stdio.h>
 #include <string.h>
 
-/* flash driver includes. */
-#include "flash.h"
+/* Board key/value store. */
+#include "kv_store.h"
+
+/* TLS certificate cache. */
+#include "iot_tls.h"
 
 /* mbedTLS includes. */
 #include "mbedtls/pk.h"
 #include "mbedtls/base64.h"
 #include "mbedtls/platform.h"
 
-#define pkcs11OBJECT_MAX_SIZE                   2048
-#define pkcs11OBJECT_PRESENT_MAGIC              ( 0xABCD0000uL )
-#define pkcs11OBJECT_LENGTH_MASK                ( 0x0000FFFFuL )
-#define pkcs11OBJECT_PRESENT_MASK               ( 0xFFFF0000uL )
-
 enum eObjectHandles
 {
     eInvalidHandle = 0, /* From PKCS #11 spec: 0 is never a valid object handle.*/
@@ -66,25 +64,27 @@ enum eObjectHandles
 };
 
 /**
- * @brief Structure for certificates/key storage.
+ * @brief Object stored under each handle.
+ *
+ * The objects are values of the board key/value store, their label is the
+ * key. The public key handle reads the key pair saved as the private key.
  */
 typedef struct
 {
-    CK_CHAR cDeviceCertificate[ pkcs11OBJECT_MAX_SIZE ];
-    CK_CHAR cDeviceKey[ pkcs11OBJECT_MAX_SIZE ];
-    CK_CHAR cCodeSignKey[ pkcs11OBJECT_MAX_SIZE ];
-    uint32_t ulDeviceCertificateMark;
-    uint32_t ulDeviceKeyMark;
-    uint32_t ulCodeSignKeyMark;
-} P11KeyConfig_t;
-
-
-/**
- * @brief Certificates/key storage in flash.
- */
-P11KeyConfig_t P11KeyConfig __attribute__( ( section( "UNINIT_FIXED_LOC" ) ) );
+    CK_OBJECT_HANDLE xHandle;
+    const char * pcLabel;
+    CK_BBOOL xIsPrivate;
+} P11Object_t;
 
+static const P11Object_t xP11Objects[] =
+{
+    { eAwsDeviceCertificate, pkcs11configLABEL_DEVICE_CERTIFICATE_FOR_TLS, CK_FALSE },
+    { eAwsDevicePrivateKey,  pkcs11configLABEL_DEVICE_PRIVATE_KEY_FOR_TLS, CK_TRUE  },
+    { eAwsDevicePublicKey,   pkcs11configLABEL_DEVICE_PRIVATE_KEY_FOR_TLS, CK_FALSE },
+    { eAwsCodeSigningKey,    pkcs11configLABEL_CODE_VERIFICATION_KEY,      CK_FALSE }
+};
 
+#define pkcs11OBJECT_COUNT    ( sizeof( xP11Objects ) / sizeof( xP11Objects[ 0 ] ) )
 
 /*-----------------------------------------------------------*/
 
@@ -106,68 +106,27 @@ CK_OBJECT_HANDLE PKCS11_PAL_SaveObject( CK_ATTRIBUTE_PTR pxLabel,
 
 {
     CK_OBJECT_HANDLE xHandle = eInvalidHandle;
-    CK_RV xBytesWritten = 0;
-    uint32_t ulFlashMark = ( pkcs11OBJECT_PRESENT_MAGIC | ( ulDataSize ) );
+    const char * pcLabel = NULL;
+    uint32_t i;
 
-    if( ulDataSize <= pkcs11OBJECT_MAX_SIZE )
+    /* The public key is not saved on its own. */
+    for( i = 0; ( i < pkcs11OBJECT_COUNT ) && ( pcLabel == NULL ); i++ )
     {
-        /*
-         * write client certificate.
-         */
-        if( strcmp( pxLabel->pValue,
-                    pkcs11configLABEL_DEVICE_CERTIFICATE_FOR_TLS ) == 0 )
-        {
-            xBytesWritten = FLASH_update( ( uint32_t ) P11KeyConfig.cDeviceCertificate,
-                                          pucData,
-                                          ( ulDataSize ) );
-
-            if( xBytesWritten == ( ulDataSize ) )
-            {
-                xHandle = eAwsDeviceCertificate;
-
-                /*change flash written mark'*/
-                FLASH_update( ( uint32_t ) &P11KeyConfig.ulDeviceCertificateMark,
-                              &ulFlashMark,
-                              sizeof( uint32_t ) );
-            }
-        }
-
-        /*
-         * write client key.
-         */
-
-        else if( strcmp( pxLabel->pValue,
-                         pkcs11configLABEL_DEVICE_PRIVATE_KEY_FOR_TLS ) == 0 )
-        {
-            xBytesWritten = FLASH_update( ( uint32_t ) P11KeyConfig.cDeviceKey,
-                                          pucData,
-                                          ulDataSize );
-
-            if( xBytesWritten == ( ulDataSize ) )
-            {
-                xHandle = eAwsDevicePrivateKey;
-                /*change flash written mark'*/
-                FLASH_update( ( uint32_t ) &P11KeyConfig.ulDeviceKeyMark,
-                              &ulFlashMark,
-                              sizeof( uint32_t ) );
-            }
-        }
-
-        else if( strcmp( pxLabel->pValue,
-                         pkcs11configLABEL_CODE_VERIFICATION_KEY ) == 0 )
+        if( ( xP11Objects[ i ].xHandle != eAwsDevicePublicKey ) &&
+            ( strcmp( pxLabel->pValue, xP11Objects[ i ].pcLabel ) == 0 ) )
         {
-            xBytesWritten = FLASH_update( ( uint32_t ) P11KeyConfig.cCodeSignKey,
-                                          pucData,
-                                          ulDataSize );
+            pcLabel = xP11Objects[ i ].pcLabel;
 
-            if( xBytesWritten == ( ulDataSize ) )
+            /* Saving the value already stored costs no flash operation. */
+            if( WaterMeter_KVSet( pcLabel, strlen( pcLabel ), pucData, ulDataSize ) == true )
             {
-                xHandle = eAwsCodeSigningKey;
+                xHandle = xP11Objects[ i ].xHandle;
 
-                /*change flash written mark'*/
-                FLASH_update( ( uint32_t ) &P11KeyConfig.ulCodeSignKeyMark,
-                              &ulFlashMark,
-                              sizeof( uint32_t ) );
+                /* The next TLS connection reads the new client certificate. */
+                if( xHandle != eAwsCodeSigningKey )
+                {
+                    TLS_FlushCertificateCache();
+                }
             }
         }
     }
@@ -197,21 +156,20 @@ CK_OBJECT_HANDLE PKCS11_PAL_FindObject( uint8_t * pLabel,
                                         uint8_t usLength )
 {
     CK_OBJECT_HANDLE xHandle = eInvalidHandle;
+    const char * pcLabel;
+    size_t xLength;
+    uint32_t i;
 
-    if( ( 0 == memcmp( pLabel, pkcs11configLABEL_DEVICE_CERTIFICATE_FOR_TLS, usLength ) ) &&
-        ( ( P11KeyConfig.ulDeviceCertificateMark & pkcs11OBJECT_PRESENT_MASK ) == pkcs11OBJECT_PRESENT_MAGIC ) )
+    for( i = 0; ( i < pkcs11OBJECT_COUNT ) && ( xHandle == eInvalidHandle ); i++ )
     {
-        xHandle = eAwsDeviceCertificate;
-    }
-    else if( ( 0 == memcmp( pLabel, pkcs11configLABEL_DEVICE_PRIVATE_KEY_FOR_TLS, usLength ) ) &&
-             ( ( P11KeyConfig.ulDeviceKeyMark & pkcs11OBJECT_PRESENT_MASK ) == pkcs11OBJECT_PRESENT_MAGIC ) )
-    {
-        xHandle = eAwsDevicePrivateKey;
-    }
-    else if( ( 0 == memcmp( pLabel, pkcs11configLABEL_CODE_VERIFICATION_KEY, usLength ) ) &&
-             ( ( P11KeyConfig.ulCodeSignKeyMark & pkcs11OBJECT_PRESENT_MASK ) == pkcs11OBJECT_PRESENT_MAGIC ) )
-    {
-        xHandle = eAwsCodeSigningKey;
+        pcLabel = xP11Objects[ i ].pcLabel;
+
+        if( ( xP11Objects[ i ].xHandle != eAwsDevicePublicKey ) &&
+            ( 0 == memcmp( pLabel, pcLabel, usLength ) ) &&
+            ( WaterMeter_KVRead( pcLabel, strlen( pcLabel ), NULL, 0, &xLength ) == true ) )
+        {
+            xHandle = xP11Objects[ i ].xHandle;
+        }
     }
 
     return xHandle;
@@ -248,65 +206,43 @@ CK_RV PKCS11_PAL_GetObjectValue( CK_OBJECT_HANDLE xHandle,
 
 {
     CK_RV ulReturn = CKR_OBJECT_HANDLE_INVALID;
+    const P11Object_t * pxObject = NULL;
+    uint8_t * pucBuffer;
+    size_t xLength;
+    uint32_t i;
 
-    /*
-     * Read client certificate.
-     */
-
-    if( xHandle == eAwsDeviceCertificate )
+    for( i = 0; ( i < pkcs11OBJECT_COUNT ) && ( pxObject == NULL ); i++ )
     {
-        /*
-         * return reference and size only if certificates are present in flash
-         */
-        if( ( P11KeyConfig.ulDeviceCertificateMark & pkcs11OBJECT_PRESENT_MASK ) == pkcs11OBJECT_PRESENT_MAGIC )
+        if( xP11Objects[ i ].xHandle == xHandle )
         {
-            *ppucData = P11KeyConfig.cDeviceCertificate;
-            *pulDataSize = ( uint32_t ) P11KeyConfig.ulDeviceCertificateMark & pkcs11OBJECT_LENGTH_MASK;
-            *pIsPrivate = CK_FALSE;
-            ulReturn = CKR_OK;
+            pxObject = &xP11Objects[ i ];
         }
     }
 
     /*
-     * Read client key.
+     * The value is copied: a later save may move it in the flash.
      */
-
-    else if( xHandle == eAwsDevicePrivateKey )
+    if( ( pxObject != NULL ) &&
+        ( WaterMeter_KVRead( pxObject->pcLabel, strlen( pxObject->pcLabel ), NULL, 0, &xLength ) == true ) )
     {
-        /*
-         * return reference and size only if certificates are present in flash
-         */
-        if( ( P11KeyConfig.ulDeviceKeyMark & pkcs11OBJECT_PRESENT_MASK ) == pkcs11OBJECT_PRESENT_MAGIC )
+        pucBuffer = pvPortMalloc( xLength + 1U );
+
+        if( pucBuffer == NULL )
         {
-            *ppucData = P11KeyConfig.cDeviceKey;
-            *pulDataSize = ( uint32_t ) ( P11KeyConfig.ulDeviceKeyMark & pkcs11OBJECT_LENGTH_MASK );
-            *pIsPrivate = CK_TRUE;
-            ulReturn = CKR_OK;
+            ulReturn = CKR_DEVICE_MEMORY;
         }
-    }
-
-    else if( xHandle == eAwsDevicePublicKey )
-    {
-        /*
-         * return reference and size only if certificates are present in flash
-         */
-        if( ( P11KeyConfig.ulDeviceKeyMark & pkcs11OBJECT_PRESENT_MASK ) == pkcs11OBJECT_PRESENT_MAGIC )
+        else if( WaterMeter_KVRead( pxObject->pcLabel, strlen( pxObject->pcLabel ),
+                                    pucBuffer, xLength, &xLength ) == true )
         {
-            *ppucData = P11KeyConfig.cDeviceKey;
-            *pulDataSize = ( uint32_t ) P11KeyConfig.ulDeviceKeyMark & pkcs11OBJECT_LENGTH_MASK;
-            *pIsPrivate = CK_FALSE;
+            *ppucData = pucBuffer;
+            *pulDataSize = ( uint32_t ) xLength;
+            *pIsPrivate = pxObject->xIsPrivate;
             ulReturn = CKR_OK;
         }
-    }
-
-    else if( xHandle == eAwsCodeSigningKey )
-    {
-        if( ( P11KeyConfig.ulCodeSignKeyMark & pkcs11OBJECT_PRESENT_MASK ) == pkcs11OBJECT_PRESENT_MAGIC )
+        else
         {
-            *ppucData = P11KeyConfig.cCodeSignKey;
-            *pulDataSize = ( uint32_t ) P11KeyConfig.ulCodeSignKeyMark & pkcs11OBJECT_LENGTH_MASK;
-            *pIsPrivate = CK_FALSE;
-            ulReturn = CKR_OK;
+            vPortFree( pucBuffer );
+            ulReturn = CKR_FUNCTION_FAILED;
         }
     }
 
@@ -326,11 +262,11 @@ CK_RV PKCS11_PAL_GetObjectValue( CK_OBJECT_HANDLE xHandle,
 void PKCS11_PAL_GetObjectValueCleanup( uint8_t * pucData,
                                        uint32_t ulDataSize )
 {
-    /* Unused parameters. */
-    ( void ) pucData;
-    ( void ) ulDataSize;
-
-    /* Since no buffer was allocated on heap, there is no cleanup
-     * to be done. */
+    if( pucData != NULL )
+    {
+        /* The buffer may hold the private key. */
+        memset( pucData, 0, ulDataSize );
+        vPortFree( pucData );
+    }
 }
 /*-----------------------------------------------------------*/
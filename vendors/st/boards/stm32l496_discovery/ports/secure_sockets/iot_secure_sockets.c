@@ -48,6 +48,7 @@
 
 /* Socket and WiFi interface includes. */
 #include "iot_secure_sockets.h"
+#include "iot_secure_sockets_poll.h"
 
 /* Socket and BG96 modem includes. */
 #include "com_sockets_ip_modem.h"
@@ -80,22 +81,20 @@ extern osMessageQId BG96_modem_queue;
 #define stsecuresocketsSOCKET_WRITE_CLOSED_FLAG    ( 1UL << 2 )
 
 /**
- * @brief The maximum timeout accepted by the Inventek module.
+ * @brief A flag to indicate that the TLS handshake is in progress.
  *
- * This value is dictated by the hardware and should not be
- * modified.
+ * Handshake records are then sent with COM_MSG_MORE so that consecutive
+ * records go to the modem in one AT+QISEND.
  */
-#define stsecuresocketsMAX_TIMEOUT                 ( 30000 )
+#define stsecuresocketsSOCKET_HANDSHAKE_FLAG       ( 1UL << 3 )
 
 /**
- * @brief Delay used between network read attempts when effecting a receive timeout.
+ * @brief The maximum timeout accepted by the Inventek module.
  *
- * Receive sockets are either blocking until the receive buffer is filled up to
- * the number of bytes set in the call or the timeout period is reached.
- * To avoid blocking any other task of same or lower priority this constant sets
- * between each read attempt during the receive timeout period.
+ * This value is dictated by the hardware and should not be
+ * modified.
  */
-#define stsecuresocketsFIVE_MILLISECONDS           ( pdMS_TO_TICKS( 5 ) )
+#define stsecuresocketsMAX_TIMEOUT                 ( 30000 )
 
 /**
  * @brief Minimum Receive and Send Timeout values.
@@ -108,8 +107,6 @@ extern osMessageQId BG96_modem_queue;
 #define stsecuresocketsHUNDRED_MILLISECONDS        ( pdMS_TO_TICKS( 100 ))
 #define stsecuresocketsTWO_HUNDRED_MILLISECONDS    ( pdMS_TO_TICKS( 200 ))
 
-#define minMESSAGE_SIZE								(5)
-
 
 static bool xModemInitialized = false;
 
@@ -294,6 +291,13 @@ static BaseType_t prvNetworkSend( void * pvContext,
 {
     uint32_t ulSocketNumber = ( uint32_t ) pvContext; /*lint !e923 cast is necessary for port. */
     BaseType_t xRetVal = SOCKETS_SOCKET_ERROR;
+    int32_t lFlags = COM_MSG_WAIT;
+
+    /* During the handshake, records are gathered until the next receive. */
+    if( ( xSockets[ ulSocketNumber ].ulFlags & stsecuresocketsSOCKET_HANDSHAKE_FLAG ) != 0UL )
+    {
+        lFlags = COM_MSG_MORE;
+    }
 
     /* Sends the data. Note that this is a blocking function and the send timeout must be set properly
      * using SOCKETS_SetSockOpt. If the timeout expires when sending data, the function will return
@@ -301,7 +305,7 @@ static BaseType_t prvNetworkSend( void * pvContext,
      * COM_MSG_DONTWAIT as it does not handle sending buffers greater than the MSS (1460).
      */
     xRetVal = ( BaseType_t )com_send_ip_modem ((uint32_t)xSockets[ulSocketNumber].ST_socket_handle,
-        		(const com_char_t *) &pucData[0], (int32_t) xDataLength, 0);
+        		(const com_char_t *) &pucData[0], (int32_t) xDataLength, lFlags);
 
     /* If the data was successfully sent, return the actual
      * number of bytes sent. Otherwise return SOCKETS_SOCKET_ERROR. */
@@ -331,64 +335,63 @@ static BaseType_t prvNetworkRecv( void * pvContext,
                                   size_t xReceiveBufferLength )
 {
     uint32_t ulSocketNumber = ( uint32_t ) pvContext; /*lint !e923 cast is needed for portability. */
+    int32_t lHandle = xSockets[ ulSocketNumber ].ST_socket_handle;
     BaseType_t xRetVal = 0;
-    int32_t xReceiveValue,xTotalBytesReceived = 0;
-    unsigned char * tmpReceiveBuffer = pucReceiveBuffer;
-    int32_t tmpReceiveBufferLength = xReceiveBufferLength;
+    int32_t xReceiveValue, xTotalBytesReceived = 0;
+    com_pollfd_t xPollFd;
+
+    /* Wait for the modem to announce data. The receive timeout must be properly
+     * set using SOCKETS_SetSockOpt. */
+    xReceiveValue = com_recv_ip_modem( lHandle, pucReceiveBuffer,
+                                       ( int32_t ) xReceiveBufferLength, COM_MSG_WAIT );
+
+    /* Gather whatever else the modem already holds, without waiting: a short
+     * read is returned as is and mbedTLS asks again for the rest of a record. */
+    while( ( xReceiveValue > 0 ) &&
+           ( ( xTotalBytesReceived + xReceiveValue ) < ( int32_t ) xReceiveBufferLength ) )
+    {
+        xTotalBytesReceived += xReceiveValue;
 
+        xPollFd.sock = lHandle;
+        xPollFd.events = COM_POLLIN;
 
-    for (;;)
-    {
-    	/* Receive the data. Note that this is a blocking function unless COM_MSG_DONTWAIT is specified.
-    	 * The receive timeout must be properly set using SOCKETS_SetSockOpt. If the timeout expires
-    	 * when receiving data, the function will return an ERROR, so please be wise in setting the value.
-    	 * Also note that you should not use the option COM_MSG_DONTWAIT as it does not handle receiving
-    	 * buffers greater than the MSS (1460). If the timeout expires and there is data in the modem
-    	 * receive buffer the data cache may try to flush it and this may result in data loss
-		 */
-
-    	xReceiveValue = (BaseType_t) com_recv_ip_modem ((uint32_t)xSockets[ulSocketNumber].ST_socket_handle,
-    			tmpReceiveBuffer, (int32_t) tmpReceiveBufferLength, 0);
-
-    	if( xReceiveValue < 0 )
-    	{
-    	    /* check if the receive timeout expired and return 0 as this is a valid case */
-    	    if (xReceiveValue == COM_SOCKETS_ERR_TIMEOUT)
-    	    {
-    	    	/* The socket read has timed out too. Returning SOCKETS_EWOULDBLOCK
-    	    	 * will cause mBedTLS to fail and so we must return zero. */
-    	    	xTotalBytesReceived = 0;
-    	    	break;
-    	    }
-    	    else
-    	    {
-    	    	/* We had a communication error status of some sort */
-    	    	xRetVal = SOCKETS_SOCKET_ERROR;
-    	    	break;
-    	    }
-    	}
-    	else if (( xReceiveValue >= minMESSAGE_SIZE ) || (xReceiveValue == xReceiveBufferLength))
-    	{
-    		/* We received enough data and need to pass it back */
-    		xTotalBytesReceived +=  xReceiveValue;
-    	    break;
-    	}
-    	else
-    	{
-    		/* we received less than minMESSAGE_SIZE bytes, so wait a little longer to see if something is coming back.
-    		 * This also allows other tasks of equal priority to take the hand.
-    		 */
-    		tmpReceiveBuffer = tmpReceiveBuffer + xReceiveValue;
-    		tmpReceiveBufferLength = tmpReceiveBufferLength - xReceiveValue;
-    		xTotalBytesReceived += xReceiveValue;
-    		vTaskDelay( stsecuresocketsFIVE_MILLISECONDS );
-    	}
+        if( ( com_poll_ip_modem( &xPollFd, 1U, 0U ) > 0 ) &&
+            ( ( ( uint16_t ) xPollFd.revents & COM_POLLIN ) != 0U ) )
+        {
+            xReceiveValue = com_recv_ip_modem( lHandle, pucReceiveBuffer + xTotalBytesReceived,
+                                               ( int32_t ) xReceiveBufferLength - xTotalBytesReceived,
+                                               COM_MSG_DONTWAIT );
+        }
+        else
+        {
+            xReceiveValue = 0;
+        }
+    }
 
+    if( xReceiveValue > 0 )
+    {
+        /* Buffer is full. */
+        xTotalBytesReceived += xReceiveValue;
+    }
+    else if( ( xReceiveValue < 0 ) && ( xTotalBytesReceived == 0 ) )
+    {
+        /* The socket read has timed out. Returning SOCKETS_EWOULDBLOCK
+         * will cause mBedTLS to fail and so we must return zero. */
+        if( xReceiveValue != COM_SOCKETS_ERR_TIMEOUT )
+        {
+            /* We had a communication error status of some sort */
+            xRetVal = SOCKETS_SOCKET_ERROR;
+        }
+    }
+    else
+    {
+        /* Data already received is returned, an error is reported by the
+         * next call. */
     }
 
-    if (xRetVal != SOCKETS_SOCKET_ERROR )
+    if( xRetVal != SOCKETS_SOCKET_ERROR )
     {
-    	xRetVal = (BaseType_t) xTotalBytesReceived;
+        xRetVal = ( BaseType_t ) xTotalBytesReceived;
     }
 
     return xRetVal;
@@ -450,6 +453,7 @@ int32_t SOCKETS_Connect( Socket_t xSocket,
     STSecureSocket_t * pxSecureSocket;
     TLSParams_t xTLSParams = { 0 };
     int32_t lRetVal = SOCKETS_SOCKET_ERROR;
+    BaseType_t lStatus;
     com_sockaddr_in_t  destination_address;
     uint32_t lRecvTimeout,lSendTimeout;
 
@@ -513,7 +517,11 @@ int32_t SOCKETS_Connect( Socket_t xSocket,
 			if( TLS_Init( &( pxSecureSocket->pvTLSContext ), &( xTLSParams ) ) == pdFREERTOS_ERRNO_NONE )
 			{
 				/* Initiate TLS handshake. */
-				if( TLS_Connect( pxSecureSocket->pvTLSContext ) != pdFREERTOS_ERRNO_NONE )
+				pxSecureSocket->ulFlags |= stsecuresocketsSOCKET_HANDSHAKE_FLAG;
+				lStatus = TLS_Connect( pxSecureSocket->pvTLSContext );
+				pxSecureSocket->ulFlags &= ~stsecuresocketsSOCKET_HANDSHAKE_FLAG;
+
+				if( lStatus != pdFREERTOS_ERRNO_NONE )
 				{
 					/* TLS handshake failed. */
 					configPRINTF(("TLS Handshake failed\r\n"));
@@ -933,6 +941,105 @@ uint32_t SOCKETS_GetHostByName( const char * pcHostName )
 }
 /*-----------------------------------------------------------*/
 
+int32_t SOCKETS_Poll( SocketsPollFd_t * pxFds,
+                      uint32_t ulNumFds,
+                      TickType_t xTimeout )
+{
+    com_pollfd_t xModemFds[ CELLULAR_MAX_SOCKETS ];
+    uint32_t ulModemFdIndex[ CELLULAR_MAX_SOCKETS ];
+    uint32_t ulNumModemFds = 0;
+    uint32_t ulIndex;
+    uint32_t ulSocketNumber;
+    uint32_t ulTimeoutMs;
+    STSecureSocket_t * pxSecureSocket;
+    int32_t lReady = 0;
+
+    if( ( pxFds == NULL ) || ( ulNumFds == 0U ) || ( ulNumFds > ( uint32_t ) CELLULAR_MAX_SOCKETS ) )
+    {
+        lReady = SOCKETS_EINVAL;
+    }
+    else
+    {
+        /* Events known without asking the modem. */
+        for( ulIndex = 0 ; ulIndex < ulNumFds ; ulIndex++ )
+        {
+            ulSocketNumber = ( uint32_t ) pxFds[ ulIndex ].xSocket; /*lint !e923 cast required for portability. */
+            pxFds[ ulIndex ].usREvents = 0;
+
+            if( prvIsValidSocket( ulSocketNumber ) != pdTRUE )
+            {
+                pxFds[ ulIndex ].usREvents = SOCKETS_POLLNVAL;
+            }
+            else
+            {
+                pxSecureSocket = &( xSockets[ ulSocketNumber ] );
+
+                if( ( pxSecureSocket->ulFlags & stsecuresocketsSOCKET_READ_CLOSED_FLAG ) != 0UL )
+                {
+                    pxFds[ ulIndex ].usREvents = SOCKETS_POLLHUP;
+                }
+                else
+                {
+                    /* Plaintext already decrypted by mbedTLS is not seen by the modem. */
+                    if( ( ( pxSecureSocket->ulFlags & stsecuresocketsSOCKET_SECURE_FLAG ) != 0UL ) &&
+                        ( ( pxFds[ ulIndex ].usEvents & SOCKETS_POLLIN ) != 0U ) &&
+                        ( TLS_Pending( pxSecureSocket->pvTLSContext ) > 0U ) )
+                    {
+                        pxFds[ ulIndex ].usREvents = SOCKETS_POLLIN;
+                    }
+
+                    /* SOCKETS_POLL* and COM_POLL* events share the same values. */
+                    xModemFds[ ulNumModemFds ].sock = pxSecureSocket->ST_socket_handle;
+                    xModemFds[ ulNumModemFds ].events = ( int16_t ) pxFds[ ulIndex ].usEvents;
+                    ulModemFdIndex[ ulNumModemFds ] = ulIndex;
+                    ulNumModemFds++;
+                }
+            }
+
+            if( pxFds[ ulIndex ].usREvents != 0U )
+            {
+                lReady++;
+            }
+        }
+
+        /* Wait on the modem only if nothing is ready yet. */
+        if( lReady > 0 )
+        {
+            ulTimeoutMs = 0;
+        }
+        else if( xTimeout == portMAX_DELAY )
+        {
+            ulTimeoutMs = COM_POLL_INFINITE;
+        }
+        else
+        {
+            ulTimeoutMs = ( uint32_t ) xTimeout * ( uint32_t ) portTICK_PERIOD_MS;
+        }
+
+        if( ( ulNumModemFds > 0U ) &&
+            ( com_poll_ip_modem( xModemFds, ulNumModemFds, ulTimeoutMs ) > 0 ) )
+        {
+            for( ulIndex = 0 ; ulIndex < ulNumModemFds ; ulIndex++ )
+            {
+                SocketsPollFd_t * pxFd = &( pxFds[ ulModemFdIndex[ ulIndex ] ] );
+
+                if( xModemFds[ ulIndex ].revents != 0 )
+                {
+                    if( pxFd->usREvents == 0U )
+                    {
+                        lReady++;
+                    }
+
+                    pxFd->usREvents |= ( uint16_t ) xModemFds[ ulIndex ].revents;
+                }
+            }
+        }
+    }
+
+    return lReady;
+}
+/*-----------------------------------------------------------*/
+
 BaseType_t SOCKETS_Init( void )
 {
     uint32_t ulIndex;
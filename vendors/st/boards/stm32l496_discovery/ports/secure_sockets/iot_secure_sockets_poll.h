@@ -0,0 +1,96 @@
+/*
+ * FreeRTOS Secure Sockets for STM32L4 Discovery kit IoT node V1.0.0 Beta 4
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file iot_secure_sockets_poll.h
+ * @brief Readiness notification over several secure sockets of the BG96 port.
+ *
+ * A single task can wait on all its connections (MQTT, NTP, HTTPS...) and is
+ * woken up by the modem data ready and closing URCs instead of polling each
+ * socket with SOCKETS_Recv.
+ */
+
+#ifndef _IOT_SECURE_SOCKETS_POLL_H_
+#define _IOT_SECURE_SOCKETS_POLL_H_
+
+#include "iot_secure_sockets.h"
+
+/**
+ * @brief Data can be read without waiting for the receive timeout.
+ */
+#define SOCKETS_POLLIN      ( 0x0001U )
+
+/**
+ * @brief Data sent before could not reach the network, the next receive
+ * returns the error. Always reported.
+ */
+#define SOCKETS_POLLERR     ( 0x0008U )
+
+/**
+ * @brief The remote closed the connection or the socket is closed for read.
+ * Always reported.
+ */
+#define SOCKETS_POLLHUP     ( 0x0010U )
+
+/**
+ * @brief The socket is not a valid open socket. Always reported.
+ */
+#define SOCKETS_POLLNVAL    ( 0x0020U )
+
+/**
+ * @brief One socket waited on by SOCKETS_Poll().
+ */
+typedef struct SocketsPollFd
+{
+    Socket_t xSocket;    /**< Socket returned by SOCKETS_Socket. */
+    uint16_t usEvents;   /**< Requested events, SOCKETS_POLLIN. */
+    uint16_t usREvents;  /**< Events raised, set by SOCKETS_Poll. */
+} SocketsPollFd_t;
+
+/**
+ * @brief Wait until at least one socket of a set is ready.
+ *
+ * For a TLS socket, SOCKETS_POLLIN is raised either by data already decrypted
+ * or by network data received from the modem. In the latter case the data
+ * may not complete a TLS record yet, and SOCKETS_Recv then waits for the rest
+ * of the record within the socket receive timeout.
+ *
+ * TLS handshake records still gathered by a socket are sent before waiting,
+ * the server answers only once it has them.
+ *
+ * @param[in,out] pxFds Sockets to wait on, usREvents is updated for each.
+ * @param[in] ulNumFds Number of entries in @p pxFds, at most
+ * CELLULAR_MAX_SOCKETS.
+ * @param[in] xTimeout Time to wait in ticks. 0 checks and returns immediately,
+ * portMAX_DELAY waits until a socket is ready.
+ *
+ * @return Number of sockets whose usREvents is not zero, 0 on timeout,
+ * SOCKETS_EINVAL if the parameters are invalid.
+ */
+int32_t SOCKETS_Poll( SocketsPollFd_t * pxFds,
+                      uint32_t ulNumFds,
+                      TickType_t xTimeout );
+
+#endif /* _IOT_SECURE_SOCKETS_POLL_H_ */
@@ -0,0 +1,158 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+
+#include "at_util.h"
+
+#define BUFFER_SIZE    ( 256U )
+
+/* ============================  GLOBAL VARIABLES =========================== */
+
+/* Extra bytes so that the scanned buffer can start at each word offset. */
+static uint8_t ucBuffer[ BUFFER_SIZE + 8U ];
+
+/* ==========================  Helper functions  ============================ */
+
+static uint16_t scanReference( const uint8_t * pucBuffer,
+                               uint16_t usSize,
+                               const uint8_t * pucChars,
+                               uint8_t ucCount )
+{
+    uint16_t i;
+    uint8_t j;
+
+    for( i = 0; i < usSize; i++ )
+    {
+        for( j = 0; j < ucCount; j++ )
+        {
+            if( pucBuffer[ i ] == pucChars[ j ] )
+            {
+                return i;
+            }
+        }
+    }
+
+    return usSize;
+}
+
+/* Random bytes drawn from a small alphabet, so the searched chars show up at
+ * any position, including next to each other and at word boundaries. */
+static void fillRandom( uint8_t * pucBuffer,
+                        size_t xLength,
+                        const uint8_t * pucAlphabet,
+                        size_t xAlphabetLength )
+{
+    size_t i;
+
+    for( i = 0; i < xLength; i++ )
+    {
+        pucBuffer[ i ] = pucAlphabet[ ( size_t ) rand() % xAlphabetLength ];
+    }
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+void setUp( void )
+{
+    srand( 1U );
+}
+
+void tearDown( void )
+{
+}
+
+/* =======================  TESTING ATutil_scan_chars  ======================= */
+
+/*!
+ * @brief Same index as a byte by byte search, for each buffer alignment,
+ * size and number of searched chars.
+ */
+void test_ScanChars_MatchesByteSearch( void )
+{
+    /* Borrow and sign corner cases of the word test: 0x00, 0x01, 0x7F, 0x80, 0xFF. */
+    static const uint8_t ucAlphabet[] = { 0x00, 0x01, 0x7F, 0x80, 0x81, 0xFE, 0xFF, '\r', '\n', '>', 'A', ' ' };
+    uint8_t ucChars[ ATUTIL_SCAN_MAX_CHARS ];
+    uint32_t ulRound;
+    uint16_t usSize;
+    uint8_t ucOffset, ucCount;
+
+    for( ulRound = 0; ulRound < 20000U; ulRound++ )
+    {
+        ucOffset = ( uint8_t ) ( ( uint32_t ) rand() % 8U );
+        usSize = ( uint16_t ) ( ( uint32_t ) rand() % ( BUFFER_SIZE + 1U ) );
+        ucCount = ( uint8_t ) ( 1U + ( ( uint32_t ) rand() % ATUTIL_SCAN_MAX_CHARS ) );
+
+        /* A sparse alphabet for the buffer, most rounds then find nothing or a late match. */
+        fillRandom( ucBuffer, sizeof( ucBuffer ), ucAlphabet, ( ulRound % 2U ) ? sizeof( ucAlphabet ) : 3U );
+        fillRandom( ucChars, ucCount, ucAlphabet, sizeof( ucAlphabet ) );
+
+        TEST_ASSERT_EQUAL_UINT16( scanReference( &ucBuffer[ ucOffset ], usSize, ucChars, ucCount ),
+                                  ATutil_scan_chars( &ucBuffer[ ucOffset ], usSize, ucChars, ucCount ) );
+    }
+}
+
+/*!
+ * @brief A match in each position of a word, and the first of two matches
+ * in the same word.
+ */
+void test_ScanChars_PositionInWord( void )
+{
+    static const uint8_t ucChars[] = { '\r', '>' };
+    uint16_t i;
+
+    for( i = 0; i < 64U; i++ )
+    {
+        memset( ucBuffer, 'x', sizeof( ucBuffer ) );
+        ucBuffer[ i ] = '>';
+        ucBuffer[ i + 1U ] = '\r';
+
+        TEST_ASSERT_EQUAL_UINT16( i, ATutil_scan_chars( ucBuffer, 64U, ucChars, 2U ) );
+        TEST_ASSERT_EQUAL_UINT16( i + 1U, ATutil_scan_chars( ucBuffer, 64U, ucChars, 1U ) );
+    }
+}
+
+/*!
+ * @brief Nothing found and empty buffers return the size.
+ */
+void test_ScanChars_NotFound( void )
+{
+    static const uint8_t ucChars[] = { '\n' };
+
+    memset( ucBuffer, 0xFF, sizeof( ucBuffer ) );
+
+    TEST_ASSERT_EQUAL_UINT16( BUFFER_SIZE, ATutil_scan_chars( ucBuffer, BUFFER_SIZE, ucChars, 1U ) );
+    TEST_ASSERT_EQUAL_UINT16( 3U, ATutil_scan_chars( &ucBuffer[ 1 ], 3U, ucChars, 1U ) );
+    TEST_ASSERT_EQUAL_UINT16( 0U, ATutil_scan_chars( ucBuffer, 0U, ucChars, 1U ) );
+
+    /* The char following the scanned area is not looked at. */
+    ucBuffer[ 10 ] = '\n';
+    TEST_ASSERT_EQUAL_UINT16( 10U, ATutil_scan_chars( ucBuffer, 10U, ucChars, 1U ) );
+}
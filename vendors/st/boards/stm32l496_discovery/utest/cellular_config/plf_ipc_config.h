@@ -0,0 +1,44 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/*
+ * Host build of the IPC configuration. Queue geometry matches the board
+ * (STM32_Cellular/App/plf_ipc_config.h), no physical interface is compiled.
+ */
+
+#ifndef PLF_IPC_CONFIG_H
+#define PLF_IPC_CONFIG_H
+
+#define IPC_RXBUF_MAXSIZE      ( ( uint16_t ) 2000U )
+#define IPC_RXBUF_THRESHOLD    ( ( uint16_t ) 20U )
+#define IPC_USE_STREAM_MODE    ( 0U )
+
+#define IPC_USE_UART           ( 0U )
+#define IPC_USE_SPI            ( 0U )
+#define IPC_USE_I2C            ( 0U )
+
+#define DBG_IPC_RX_FIFO        ( 0U )
+
+#endif /* PLF_IPC_CONFIG_H */
@@ -0,0 +1,889 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file bg96_emul.c
+ * @brief Scriptable Quectel BG96 emulator, see bg96_emul.h.
+ *
+ * Answers and network deliveries are events ordered by due time. The
+ * emulator thread sleeps in poll() until the next event or until the host
+ * writes; everything it sends is paced at the line rate.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bg96_emul.h"
+
+#define EMUL_LINE_MAX          ( 256U )
+#define EMUL_TEXT_MAX          ( 128U )
+#define EMUL_TX_DATA_MAX       ( 1460U )
+#define EMUL_RX_READ_MAX       ( 1500U )
+#define EMUL_PDN_ADDRESS       "10.0.0.2"
+
+typedef enum EmulEventType
+{
+    EMUL_EVENT_OUTPUT,  /**< Characters sent to the host. */
+    EMUL_EVENT_ARRIVAL  /**< Data coming from the network into a socket. */
+} EmulEventType_t;
+
+typedef struct EmulEvent
+{
+    uint64_t ullDue;
+    EmulEventType_t xType;
+    uint32_t ulConnectId;
+    size_t xLength;
+    struct EmulEvent * pxNext;
+    uint8_t ucData[];
+} EmulEvent_t;
+
+typedef struct EmulSocket
+{
+    bool xOpen;
+    bool xUrcArmed;     /**< A "recv" report is due on the next arrival. */
+    uint8_t * pucBuffer;
+    size_t xLength;
+    size_t xCapacity;
+    uint32_t ulTotal;
+    uint32_t ulRead;
+} EmulSocket_t;
+
+typedef struct EmulReply
+{
+    char cCommand[ EMUL_TEXT_MAX ];
+    char cText[ EMUL_TEXT_MAX ];
+    struct EmulReply * pxNext;
+} EmulReply_t;
+
+typedef struct EmulAnswer
+{
+    const char * pcCommand;
+    const char * pcText;
+} EmulAnswer_t;
+
+typedef struct Emulator
+{
+    pthread_mutex_t xLock;
+    int lFd;
+
+    /* Settings. */
+    uint32_t ulBaudRate;
+    uint32_t ulLatencyMs;
+    uint32_t ulQiopenMs;
+    uint32_t ulRttMs;
+    uint32_t ulLossPercent;
+    uint32_t ulRtoMs;
+    uint32_t ulSendFail;
+    bool xEcho;
+    uint32_t ulRandom;
+    EmulReply_t * pxReplies;
+
+    /* Modem state. */
+    EmulEvent_t * pxEvents;
+    EmulSocket_t xSockets[ bg96emulMAX_SOCKETS ];
+    bool xPdnActive;
+    char cLine[ EMUL_LINE_MAX ];
+    size_t xLineLength;
+    bool xInData;
+    uint32_t ulDataId;
+    size_t xDataExpected;
+    size_t xDataReceived;
+    uint8_t ucData[ EMUL_TX_DATA_MAX ];
+
+    Bg96EmulStats_t xStats;
+} Emulator_t;
+
+/*-----------------------------------------------------------*/
+
+static Emulator_t xEmul =
+{
+    .xLock       = PTHREAD_MUTEX_INITIALIZER,
+    .lFd         = -1,
+    .ulBaudRate  = 115200U,
+    .ulLatencyMs = 2U,
+    .ulQiopenMs  = 50U,
+    .ulRttMs     = 100U,
+    .ulRtoMs     = 1000U,
+    .xEcho       = true,
+    .ulRandom    = 1U
+};
+
+/* Information lines of the commands that are not socket related. */
+static const EmulAnswer_t xAnswers[] =
+{
+    { "AT+CPIN?",    "+CPIN: READY"                },
+    { "AT+QINISTAT", "+QINISTAT: 7"                },
+    { "AT+COPS?",    "+COPS: 0,0,\"EMUL\",8"       },
+    { "AT+CEREG?",   "+CEREG: 0,1"                 },
+    { "AT+CREG?",    "+CREG: 0,1"                  },
+    { "AT+CGREG?",   "+CGREG: 0,1"                 },
+    { "AT+CGATT?",   "+CGATT: 1"                   },
+    { "AT+CSQ",      "+CSQ: 20,99"                 },
+    { "AT+CGMI",     "Quectel"                     },
+    { "AT+CGMM",     "BG96"                        },
+    { "AT+CGMR",     "BG96MAR02A07M1G"             },
+    { "AT+QGMR",     "BG96MAR02A07M1G_01.016.01.016" },
+    { "AT+CGSN",     "866425030000000"             },
+    { "AT+GSN",      "866425030000000"             },
+    { "AT+CIMI",     "208010000000000"             },
+    { "AT+QCCID",    "+QCCID: 89330000000000000000" }
+};
+
+/*-----------------------------------------------------------*/
+
+static uint64_t prvNowUs( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( uint64_t ) xNow.tv_sec * 1000000U ) + ( ( uint64_t ) xNow.tv_nsec / 1000U );
+}
+
+static uint32_t prvRandom( void )
+{
+    xEmul.ulRandom ^= xEmul.ulRandom << 13;
+    xEmul.ulRandom ^= xEmul.ulRandom >> 17;
+    xEmul.ulRandom ^= xEmul.ulRandom << 5;
+
+    return xEmul.ulRandom;
+}
+
+/* Write to the host at the line rate. */
+static void prvWrite( const uint8_t * pucData,
+                      size_t xLength )
+{
+    size_t xWritten = 0U;
+    ssize_t xResult;
+
+    while( xWritten < xLength )
+    {
+        xResult = write( xEmul.lFd, &pucData[ xWritten ], xLength - xWritten );
+
+        if( xResult > 0 )
+        {
+            xWritten += ( size_t ) xResult;
+        }
+        else if( ( xResult < 0 ) && ( errno == EINTR ) )
+        {
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if( xEmul.ulBaudRate != 0U )
+    {
+        ( void ) usleep( ( useconds_t ) ( ( ( uint64_t ) xLength * 10U * 1000000U ) / xEmul.ulBaudRate ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* Queue an event, after the events due at the same time. */
+static void prvSchedule( EmulEventType_t xType,
+                         uint64_t ullDelayUs,
+                         uint32_t ulConnectId,
+                         const uint8_t * pucData,
+                         size_t xLength )
+{
+    EmulEvent_t * pxEvent = malloc( sizeof( EmulEvent_t ) + xLength );
+    EmulEvent_t ** ppxLink = &xEmul.pxEvents;
+
+    if( pxEvent != NULL )
+    {
+        pxEvent->ullDue = prvNowUs() + ullDelayUs;
+        pxEvent->xType = xType;
+        pxEvent->ulConnectId = ulConnectId;
+        pxEvent->xLength = xLength;
+        ( void ) memcpy( pxEvent->ucData, pucData, xLength );
+
+        while( ( *ppxLink != NULL ) && ( ( *ppxLink )->ullDue <= pxEvent->ullDue ) )
+        {
+            ppxLink = &( *ppxLink )->pxNext;
+        }
+
+        pxEvent->pxNext = *ppxLink;
+        *ppxLink = pxEvent;
+    }
+}
+
+/* Answer to the host after the command latency. */
+static void prvAnswer( const uint8_t * pucData,
+                       size_t xLength )
+{
+    prvSchedule( EMUL_EVENT_OUTPUT, ( uint64_t ) xEmul.ulLatencyMs * 1000U, 0U, pucData, xLength );
+}
+
+static void prvAnswerText( const char * pcFormat,
+                           ... )
+{
+    char cText[ EMUL_LINE_MAX ];
+    va_list xArgs;
+    int lLength;
+
+    va_start( xArgs, pcFormat );
+    lLength = vsnprintf( cText, sizeof( cText ), pcFormat, xArgs );
+    va_end( xArgs );
+
+    if( lLength > 0 )
+    {
+        prvAnswer( ( const uint8_t * ) cText, ( ( size_t ) lLength < sizeof( cText ) ) ? ( size_t ) lLength : sizeof( cText ) - 1U );
+    }
+}
+
+static void prvUrc( const char * pcText )
+{
+    char cText[ EMUL_LINE_MAX ];
+    int lLength = snprintf( cText, sizeof( cText ), "\r\n%s\r\n", pcText );
+
+    if( lLength > 0 )
+    {
+        prvWrite( ( const uint8_t * ) cText, ( size_t ) lLength );
+        xEmul.xStats.ulUrcs++;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvArrival( const EmulEvent_t * pxEvent )
+{
+    EmulSocket_t * pxSocket = &xEmul.xSockets[ pxEvent->ulConnectId ];
+    char cUrc[ 32 ];
+    uint8_t * pucBuffer;
+    size_t xCapacity;
+
+    if( pxSocket->xOpen == true )
+    {
+        if( ( pxSocket->xLength + pxEvent->xLength ) > pxSocket->xCapacity )
+        {
+            xCapacity = ( pxSocket->xLength + pxEvent->xLength ) * 2U;
+            pucBuffer = realloc( pxSocket->pucBuffer, xCapacity );
+
+            if( pucBuffer == NULL )
+            {
+                return;
+            }
+
+            pxSocket->pucBuffer = pucBuffer;
+            pxSocket->xCapacity = xCapacity;
+        }
+
+        ( void ) memcpy( &pxSocket->pucBuffer[ pxSocket->xLength ], pxEvent->ucData, pxEvent->xLength );
+        pxSocket->xLength += pxEvent->xLength;
+        pxSocket->ulTotal += ( uint32_t ) pxEvent->xLength;
+
+        /* Buffer access mode: one report until the buffer is read empty. */
+        if( pxSocket->xUrcArmed == true )
+        {
+            pxSocket->xUrcArmed = false;
+            ( void ) snprintf( cUrc, sizeof( cUrc ), "+QIURC: \"recv\",%u", ( unsigned ) pxEvent->ulConnectId );
+            prvUrc( cUrc );
+        }
+    }
+}
+
+/* Run the events that are due, return the delay to the next one in ms. */
+static int prvRunEvents( void )
+{
+    EmulEvent_t ** ppxLink = &xEmul.pxEvents;
+    EmulEvent_t * pxEvent;
+    uint64_t ullNow = prvNowUs();
+    int lTimeout = -1;
+
+    while( *ppxLink != NULL )
+    {
+        pxEvent = *ppxLink;
+
+        if( pxEvent->ullDue > ullNow )
+        {
+            lTimeout = ( int ) ( ( pxEvent->ullDue - ullNow + 999U ) / 1000U );
+            break;
+        }
+
+        /* No report between a prompt and the data it asks for. */
+        if( ( pxEvent->xType == EMUL_EVENT_ARRIVAL ) && ( xEmul.xInData == true ) )
+        {
+            ppxLink = &pxEvent->pxNext;
+            continue;
+        }
+
+        *ppxLink = pxEvent->pxNext;
+
+        if( pxEvent->xType == EMUL_EVENT_OUTPUT )
+        {
+            prvWrite( pxEvent->ucData, pxEvent->xLength );
+        }
+        else
+        {
+            prvArrival( pxEvent );
+        }
+
+        free( pxEvent );
+        ullNow = prvNowUs();
+    }
+
+    /* Deferred arrivals are retried once the data is in. */
+    if( ( lTimeout < 0 ) && ( xEmul.pxEvents != NULL ) && ( xEmul.xInData == false ) )
+    {
+        lTimeout = 0;
+    }
+
+    return lTimeout;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvParseSocket( const char * pcArguments,
+                            uint32_t * pulConnectId,
+                            uint32_t * pulLength )
+{
+    unsigned uConnectId = 0U;
+    unsigned uLength = 0U;
+    bool xValid = false;
+
+    if( sscanf( pcArguments, "%u,%u", &uConnectId, &uLength ) >= 1 )
+    {
+        xValid = ( uConnectId < bg96emulMAX_SOCKETS );
+        *pulConnectId = ( uint32_t ) uConnectId;
+        *pulLength = ( uint32_t ) uLength;
+    }
+
+    return xValid;
+}
+
+static void prvSocketReset( EmulSocket_t * pxSocket,
+                            bool xOpen )
+{
+    pxSocket->xOpen = xOpen;
+    pxSocket->xUrcArmed = true;
+    pxSocket->xLength = 0U;
+    pxSocket->ulTotal = 0U;
+    pxSocket->ulRead = 0U;
+}
+
+static void prvQiopen( const char * pcArguments )
+{
+    unsigned uContext;
+    unsigned uConnectId;
+    char cUrc[ 32 ];
+    int lLength;
+
+    if( ( sscanf( pcArguments, "%u,%u", &uContext, &uConnectId ) == 2 ) && ( uConnectId < bg96emulMAX_SOCKETS ) )
+    {
+        prvSocketReset( &xEmul.xSockets[ uConnectId ], true );
+        prvAnswerText( "\r\nOK\r\n" );
+
+        lLength = snprintf( cUrc, sizeof( cUrc ), "\r\n+QIOPEN: %u,0\r\n", uConnectId );
+        prvSchedule( EMUL_EVENT_OUTPUT, ( uint64_t ) ( xEmul.ulLatencyMs + xEmul.ulQiopenMs ) * 1000U,
+                     uConnectId, ( const uint8_t * ) cUrc, ( size_t ) lLength );
+        xEmul.xStats.ulUrcs++;
+    }
+    else
+    {
+        prvAnswerText( "\r\nERROR\r\n" );
+    }
+}
+
+static void prvQisend( const char * pcArguments )
+{
+    uint32_t ulConnectId;
+    uint32_t ulLength;
+
+    xEmul.xStats.ulQisend++;
+
+    if( ( prvParseSocket( pcArguments, &ulConnectId, &ulLength ) == true ) &&
+        ( xEmul.xSockets[ ulConnectId ].xOpen == true ) &&
+        ( ulLength != 0U ) && ( ulLength <= EMUL_TX_DATA_MAX ) )
+    {
+        xEmul.xInData = true;
+        xEmul.ulDataId = ulConnectId;
+        xEmul.xDataExpected = ulLength;
+        xEmul.xDataReceived = 0U;
+        prvAnswerText( "\r\n> " );
+    }
+    else
+    {
+        prvAnswerText( "\r\nERROR\r\n" );
+    }
+}
+
+/* The data announced by AT+QISEND is in: send it to the network. */
+static void prvQisendData( void )
+{
+    uint64_t ullDelayUs = ( uint64_t ) xEmul.ulRttMs * 1000U;
+
+    xEmul.xInData = false;
+
+    if( xEmul.ulSendFail != 0U )
+    {
+        xEmul.ulSendFail--;
+
+        if( xEmul.ulSendFail == 0U )
+        {
+            /* The data never reaches the network. */
+            prvAnswerText( "\r\nSEND FAIL\r\n" );
+
+            return;
+        }
+    }
+
+    xEmul.xStats.ulBytesSent += ( uint32_t ) xEmul.xDataReceived;
+
+    if( xEmul.xEcho == true )
+    {
+        if( ( xEmul.ulLossPercent != 0U ) && ( ( prvRandom() % 100U ) < xEmul.ulLossPercent ) )
+        {
+            ullDelayUs += ( uint64_t ) xEmul.ulRtoMs * 1000U;
+            xEmul.xStats.ulRetransmissions++;
+        }
+
+        prvSchedule( EMUL_EVENT_ARRIVAL, ullDelayUs, xEmul.ulDataId, xEmul.ucData, xEmul.xDataReceived );
+    }
+
+    prvAnswerText( "\r\nSEND OK\r\n" );
+}
+
+static void prvQird( const char * pcArguments )
+{
+    static uint8_t ucAnswer[ EMUL_RX_READ_MAX + 64U ];
+    EmulSocket_t * pxSocket;
+    uint32_t ulConnectId;
+    uint32_t ulLength;
+    int lHeader;
+
+    xEmul.xStats.ulQird++;
+
+    if( ( prvParseSocket( pcArguments, &ulConnectId, &ulLength ) == false ) ||
+        ( xEmul.xSockets[ ulConnectId ].xOpen == false ) )
+    {
+        prvAnswerText( "\r\nERROR\r\n" );
+    }
+    else if( ulLength == 0U )
+    {
+        pxSocket = &xEmul.xSockets[ ulConnectId ];
+        prvAnswerText( "\r\n+QIRD: %u,%u,%u\r\n\r\nOK\r\n",
+                       ( unsigned ) pxSocket->ulTotal, ( unsigned ) pxSocket->ulRead,
+                       ( unsigned ) pxSocket->xLength );
+    }
+    else
+    {
+        pxSocket = &xEmul.xSockets[ ulConnectId ];
+
+        if( ulLength > pxSocket->xLength )
+        {
+            ulLength = ( uint32_t ) pxSocket->xLength;
+        }
+
+        if( ulLength > EMUL_RX_READ_MAX )
+        {
+            ulLength = EMUL_RX_READ_MAX;
+        }
+
+        lHeader = snprintf( ( char * ) ucAnswer, 32U, "\r\n+QIRD: %u\r\n", ( unsigned ) ulLength );
+        ( void ) memcpy( &ucAnswer[ lHeader ], pxSocket->pucBuffer, ulLength );
+        ( void ) memcpy( &ucAnswer[ ( size_t ) lHeader + ulLength ], "\r\n\r\nOK\r\n", 8U );
+        prvAnswer( ucAnswer, ( size_t ) lHeader + ulLength + 8U );
+
+        ( void ) memmove( pxSocket->pucBuffer, &pxSocket->pucBuffer[ ulLength ], pxSocket->xLength - ulLength );
+        pxSocket->xLength -= ulLength;
+        pxSocket->ulRead += ulLength;
+        xEmul.xStats.ulBytesDelivered += ulLength;
+
+        if( pxSocket->xLength == 0U )
+        {
+            pxSocket->xUrcArmed = true;
+        }
+    }
+}
+
+static void prvCommand( const char * pcCommand )
+{
+    const EmulReply_t * pxReply;
+    uint32_t ulConnectId;
+    uint32_t ulUnused;
+    size_t i;
+
+    xEmul.xStats.ulCommands++;
+
+    for( pxReply = xEmul.pxReplies; pxReply != NULL; pxReply = pxReply->pxNext )
+    {
+        if( strcmp( pcCommand, pxReply->cCommand ) == 0 )
+        {
+            break;
+        }
+    }
+
+    if( pxReply != NULL )
+    {
+        if( strcmp( pxReply->cText, "ERROR" ) == 0 )
+        {
+            prvAnswerText( "\r\nERROR\r\n" );
+        }
+        else
+        {
+            prvAnswerText( "\r\n%s\r\n\r\nOK\r\n", pxReply->cText );
+        }
+    }
+    else if( strncmp( pcCommand, "AT+QISEND=", 10U ) == 0 )
+    {
+        prvQisend( &pcCommand[ 10 ] );
+    }
+    else if( strncmp( pcCommand, "AT+QIRD=", 8U ) == 0 )
+    {
+        prvQird( &pcCommand[ 8 ] );
+    }
+    else if( strncmp( pcCommand, "AT+QIOPEN=", 10U ) == 0 )
+    {
+        prvQiopen( &pcCommand[ 10 ] );
+    }
+    else if( strncmp( pcCommand, "AT+QICLOSE=", 11U ) == 0 )
+    {
+        if( prvParseSocket( &pcCommand[ 11 ], &ulConnectId, &ulUnused ) == true )
+        {
+            prvSocketReset( &xEmul.xSockets[ ulConnectId ], false );
+        }
+
+        prvAnswerText( "\r\nOK\r\n" );
+    }
+    else if( strcmp( pcCommand, "AT+QIACT?" ) == 0 )
+    {
+        if( xEmul.xPdnActive == true )
+        {
+            prvAnswerText( "\r\n+QIACT: 1,1,1,\"%s\"\r\n\r\nOK\r\n", EMUL_PDN_ADDRESS );
+        }
+        else
+        {
+            prvAnswerText( "\r\nOK\r\n" );
+        }
+    }
+    else if( strncmp( pcCommand, "AT+QIACT=", 9U ) == 0 )
+    {
+        xEmul.xPdnActive = true;
+        prvAnswerText( "\r\nOK\r\n" );
+    }
+    else
+    {
+        for( i = 0U; i < ( sizeof( xAnswers ) / sizeof( xAnswers[ 0 ] ) ); i++ )
+        {
+            if( strcmp( pcCommand, xAnswers[ i ].pcCommand ) == 0 )
+            {
+                break;
+            }
+        }
+
+        if( i < ( sizeof( xAnswers ) / sizeof( xAnswers[ 0 ] ) ) )
+        {
+            prvAnswerText( "\r\n%s\r\n\r\nOK\r\n", xAnswers[ i ].pcText );
+        }
+        else
+        {
+            prvAnswerText( "\r\nOK\r\n" );
+        }
+    }
+}
+
+static void prvReceive( const uint8_t * pucData,
+                        size_t xLength )
+{
+    size_t i;
+    size_t xCopy;
+
+    for( i = 0U; i < xLength; i++ )
+    {
+        if( xEmul.xInData == true )
+        {
+            xCopy = xEmul.xDataExpected - xEmul.xDataReceived;
+
+            if( xCopy > ( xLength - i ) )
+            {
+                xCopy = xLength - i;
+            }
+
+            ( void ) memcpy( &xEmul.ucData[ xEmul.xDataReceived ], &pucData[ i ], xCopy );
+            xEmul.xDataReceived += xCopy;
+            i += xCopy - 1U;
+
+            if( xEmul.xDataReceived == xEmul.xDataExpected )
+            {
+                prvQisendData();
+            }
+        }
+        else if( pucData[ i ] == ( uint8_t ) '\r' )
+        {
+            xEmul.cLine[ xEmul.xLineLength ] = '\0';
+
+            if( xEmul.xLineLength != 0U )
+            {
+                prvCommand( xEmul.cLine );
+            }
+
+            xEmul.xLineLength = 0U;
+        }
+        else if( ( pucData[ i ] != ( uint8_t ) '\n' ) && ( xEmul.xLineLength < ( EMUL_LINE_MAX - 1U ) ) )
+        {
+            xEmul.cLine[ xEmul.xLineLength ] = ( char ) pucData[ i ];
+            xEmul.xLineLength++;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void * prvEmulatorThread( void * pvArgument )
+{
+    struct pollfd xPoll;
+    uint8_t ucData[ 512 ];
+    ssize_t xRead;
+    int lTimeout;
+
+    ( void ) pvArgument;
+
+    xPoll.fd = xEmul.lFd;
+    xPoll.events = POLLIN;
+
+    for( ; ; )
+    {
+        ( void ) pthread_mutex_lock( &xEmul.xLock );
+        lTimeout = prvRunEvents();
+        ( void ) pthread_mutex_unlock( &xEmul.xLock );
+
+        /* Settings may change the schedule: do not sleep for long. */
+        if( ( lTimeout < 0 ) || ( lTimeout > 10 ) )
+        {
+            lTimeout = 10;
+        }
+
+        if( poll( &xPoll, 1, lTimeout ) > 0 )
+        {
+            xRead = read( xEmul.lFd, ucData, sizeof( ucData ) );
+
+            if( xRead <= 0 )
+            {
+                break;
+            }
+
+            ( void ) pthread_mutex_lock( &xEmul.xLock );
+            prvReceive( ucData, ( size_t ) xRead );
+            ( void ) pthread_mutex_unlock( &xEmul.xLock );
+        }
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvDirective( char * pcLine )
+{
+    char cKeyword[ 16 ];
+    char cCommand[ EMUL_TEXT_MAX ];
+    unsigned uValue;
+    int lOffset = 0;
+    EmulReply_t * pxReply;
+    bool xValid = true;
+
+    if( sscanf( pcLine, "%15s %n", cKeyword, &lOffset ) < 1 )
+    {
+        /* Blank line. */
+    }
+    else if( cKeyword[ 0 ] == '#' )
+    {
+        /* Comment. */
+    }
+    else if( strcmp( cKeyword, "remote" ) == 0 )
+    {
+        xEmul.xEcho = ( strncmp( &pcLine[ lOffset ], "echo", 4U ) == 0 );
+        xValid = xEmul.xEcho || ( strncmp( &pcLine[ lOffset ], "sink", 4U ) == 0 );
+    }
+    else if( strcmp( cKeyword, "reply" ) == 0 )
+    {
+        pxReply = calloc( 1, sizeof( *pxReply ) );
+        xValid = ( pxReply != NULL ) && ( sscanf( &pcLine[ lOffset ], "%127s %n", cCommand, &lOffset ) == 1 );
+
+        if( xValid == true )
+        {
+            ( void ) strcpy( pxReply->cCommand, cCommand );
+            ( void ) snprintf( pxReply->cText, sizeof( pxReply->cText ), "%s",
+                               &pcLine[ strlen( cKeyword ) + 1U + ( size_t ) lOffset ] );
+            pxReply->pxNext = xEmul.pxReplies;
+            xEmul.pxReplies = pxReply;
+        }
+        else
+        {
+            free( pxReply );
+        }
+    }
+    else if( strcmp( cKeyword, "urc" ) == 0 )
+    {
+        xValid = ( sscanf( &pcLine[ lOffset ], "%u %n", &uValue, &lOffset ) == 1 );
+
+        if( xValid == true )
+        {
+            ( void ) snprintf( cCommand, sizeof( cCommand ), "\r\n%s\r\n",
+                               &pcLine[ strlen( cKeyword ) + 1U + ( size_t ) lOffset ] );
+            prvSchedule( EMUL_EVENT_OUTPUT, ( uint64_t ) uValue * 1000U, 0U,
+                         ( const uint8_t * ) cCommand, strlen( cCommand ) );
+            xEmul.xStats.ulUrcs++;
+        }
+    }
+    else if( sscanf( &pcLine[ lOffset ], "%u", &uValue ) != 1 )
+    {
+        xValid = false;
+    }
+    else if( strcmp( cKeyword, "baud" ) == 0 )
+    {
+        xEmul.ulBaudRate = uValue;
+    }
+    else if( strcmp( cKeyword, "latency" ) == 0 )
+    {
+        xEmul.ulLatencyMs = uValue;
+    }
+    else if( strcmp( cKeyword, "qiopen" ) == 0 )
+    {
+        xEmul.ulQiopenMs = uValue;
+    }
+    else if( strcmp( cKeyword, "rtt" ) == 0 )
+    {
+        xEmul.ulRttMs = uValue;
+    }
+    else if( strcmp( cKeyword, "loss" ) == 0 )
+    {
+        xEmul.ulLossPercent = ( uValue > 100U ) ? 100U : uValue;
+    }
+    else if( strcmp( cKeyword, "rto" ) == 0 )
+    {
+        xEmul.ulRtoMs = uValue;
+    }
+    else if( strcmp( cKeyword, "sendfail" ) == 0 )
+    {
+        xEmul.ulSendFail = uValue;
+    }
+    else if( strcmp( cKeyword, "seed" ) == 0 )
+    {
+        xEmul.ulRandom = ( uValue != 0U ) ? uValue : 1U;
+    }
+    else
+    {
+        xValid = false;
+    }
+
+    return xValid;
+}
+
+bool Bg96Emul_Script( const char * pcScript )
+{
+    char cLine[ EMUL_LINE_MAX ];
+    const char * pcEnd;
+    size_t xLength;
+    bool xValid = true;
+
+    ( void ) pthread_mutex_lock( &xEmul.xLock );
+
+    while( ( pcScript != NULL ) && ( *pcScript != '\0' ) && ( xValid == true ) )
+    {
+        pcEnd = strchr( pcScript, '\n' );
+        xLength = ( pcEnd != NULL ) ? ( size_t ) ( pcEnd - pcScript ) : strlen( pcScript );
+
+        if( xLength >= sizeof( cLine ) )
+        {
+            xValid = false;
+        }
+        else
+        {
+            ( void ) memcpy( cLine, pcScript, xLength );
+            cLine[ xLength ] = '\0';
+            xValid = prvDirective( cLine );
+        }
+
+        pcScript = ( pcEnd != NULL ) ? &pcEnd[ 1 ] : &pcScript[ xLength ];
+    }
+
+    ( void ) pthread_mutex_unlock( &xEmul.xLock );
+
+    return xValid;
+}
+
+int Bg96Emul_Start( const char * pcScript )
+{
+    int lFds[ 2 ];
+    int lHostFd = -1;
+    pthread_t xThread;
+    uint32_t i;
+
+    if( ( Bg96Emul_Script( pcScript ) == true ) &&
+        ( socketpair( AF_UNIX, SOCK_STREAM, 0, lFds ) == 0 ) )
+    {
+        for( i = 0U; i < bg96emulMAX_SOCKETS; i++ )
+        {
+            prvSocketReset( &xEmul.xSockets[ i ], false );
+        }
+
+        xEmul.lFd = lFds[ 1 ];
+
+        if( pthread_create( &xThread, NULL, prvEmulatorThread, NULL ) == 0 )
+        {
+            ( void ) pthread_detach( xThread );
+            lHostFd = lFds[ 0 ];
+        }
+        else
+        {
+            ( void ) close( lFds[ 0 ] );
+            ( void ) close( lFds[ 1 ] );
+        }
+    }
+
+    return lHostFd;
+}
+
+void Bg96Emul_GetStats( Bg96EmulStats_t * pxStats )
+{
+    ( void ) pthread_mutex_lock( &xEmul.xLock );
+    *pxStats = xEmul.xStats;
+    ( void ) pthread_mutex_unlock( &xEmul.xLock );
+}
+
+size_t Bg96Emul_Pending( uint32_t ulConnectId )
+{
+    size_t xPending = 0U;
+
+    if( ulConnectId < bg96emulMAX_SOCKETS )
+    {
+        ( void ) pthread_mutex_lock( &xEmul.xLock );
+        xPending = xEmul.xSockets[ ulConnectId ].xLength;
+        ( void ) pthread_mutex_unlock( &xEmul.xLock );
+    }
+
+    return xPending;
+}
@@ -0,0 +1,115 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file bg96_emul.h
+ * @brief Scriptable Quectel BG96 emulator for the host build of the cellular
+ * stack.
+ *
+ * The emulator owns one end of a socketpair and answers, on its own thread,
+ * the AT commands the BG96 driver sends during power on, network
+ * registration and PDN activation, and the socket commands AT+QIOPEN,
+ * AT+QISEND, AT+QIRD and AT+QICLOSE. The remote host behind the sockets
+ * echoes or discards what it receives after a network round trip time; data
+ * coming back is announced with +QIURC: "recv" as the modem does in buffer
+ * access mode.
+ *
+ * Timing is configurable: baud rate of the line, latency of every final
+ * result code, delay of the +QIOPEN report, round trip time and loss rate of
+ * the network. A lost packet is delivered after a retransmission timeout,
+ * which is how TCP losses show to the application.
+ *
+ * Settings may be changed at any time with Bg96Emul_Script(), one directive
+ * per line, '#' starting a comment:
+ *
+ *     baud <bit/s>           line pacing, 0 for none
+ *     latency <ms>           delay before each final result code
+ *     qiopen <ms>            delay of the +QIOPEN report
+ *     rtt <ms>               network round trip time
+ *     loss <percent>         packets delayed by a retransmission
+ *     rto <ms>               retransmission timeout
+ *     sendfail <n>           n-th next AT+QISEND data answered SEND FAIL
+ *                            and dropped, 0 for none
+ *     remote echo|sink       behaviour of the remote host
+ *     seed <n>               seed of the loss draws
+ *     reply <command> <text> information line answered to <command>, ERROR
+ *                            to fail it
+ *     urc <ms> <text>        unsolicited line sent <ms> from now
+ */
+
+#ifndef BG96_EMUL_H
+#define BG96_EMUL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Number of modem sockets (connectID 0 to 11).
+ */
+#define bg96emulMAX_SOCKETS    ( 12U )
+
+/**
+ * @brief Counters maintained by the emulator.
+ */
+typedef struct Bg96EmulStats
+{
+    uint32_t ulCommands;        /**< AT commands received. */
+    uint32_t ulQisend;          /**< AT+QISEND commands. */
+    uint32_t ulQird;            /**< AT+QIRD commands, queries included. */
+    uint32_t ulUrcs;            /**< Unsolicited lines sent. */
+    uint32_t ulBytesSent;       /**< Socket bytes received from the host. */
+    uint32_t ulBytesDelivered;  /**< Socket bytes read back by the host. */
+    uint32_t ulRetransmissions; /**< Packets delayed by a loss. */
+} Bg96EmulStats_t;
+
+/**
+ * @brief Start the emulator.
+ *
+ * @param[in] pcScript Initial settings, may be NULL.
+ *
+ * @return Host end of the line, to attach to the modem UART, -1 on error.
+ */
+int Bg96Emul_Start( const char * pcScript );
+
+/**
+ * @brief Apply settings, see the file header for the syntax.
+ *
+ * @return false if a line could not be parsed; the lines before it are
+ * applied.
+ */
+bool Bg96Emul_Script( const char * pcScript );
+
+/**
+ * @brief Read the counters.
+ */
+void Bg96Emul_GetStats( Bg96EmulStats_t * pxStats );
+
+/**
+ * @brief Bytes waiting in the modem buffer of socket @p ulConnectId.
+ */
+size_t Bg96Emul_Pending( uint32_t ulConnectId );
+
+#endif /* BG96_EMUL_H */
@@ -0,0 +1,238 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file cmsis_os.h
+ * @brief Host build of the CMSIS-RTOS v1 subset used by the cellular stack.
+ *
+ * Every thread, timer and simulated interrupt is a pthread, and they run one
+ * at a time under a global lock, the way the FreeRTOS POSIX port schedules
+ * its tasks. The lock is given up only when a thread blocks on a kernel
+ * object, sleeps or performs a UART transfer, so the code between two
+ * blocking calls runs as it would with the scheduler suspended. Interrupt
+ * handlers are called with the lock held and never block.
+ */
+
+#ifndef CMSIS_OS_H
+#define CMSIS_OS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define osCMSIS                     0x10002U
+#define osFeature_SysTick           1
+#define osKernelSysTickFrequency    1000U
+
+#define osWaitForever               0xFFFFFFFFU
+
+typedef enum
+{
+    osPriorityIdle = -3,
+    osPriorityLow = -2,
+    osPriorityBelowNormal = -1,
+    osPriorityNormal = 0,
+    osPriorityAboveNormal = +1,
+    osPriorityHigh = +2,
+    osPriorityRealtime = +3,
+    osPriorityError = 0x84
+} osPriority;
+
+typedef enum
+{
+    osOK = 0,
+    osEventSignal = 0x08,
+    osEventMessage = 0x10,
+    osEventMail = 0x20,
+    osEventTimeout = 0x40,
+    osErrorParameter = 0x80,
+    osErrorResource = 0x81,
+    osErrorTimeoutResource = 0xC1,
+    osErrorISR = 0x82,
+    osErrorValue = 0x86,
+    osErrorOS = 0xFF,
+    os_status_reserved = 0x7FFFFFFF
+} osStatus;
+
+typedef enum
+{
+    osTimerOnce = 0,
+    osTimerPeriodic = 1
+} os_timer_type;
+
+typedef void (* os_pthread)( void const * argument );
+typedef void (* os_ptimer)( void const * argument );
+
+typedef struct os_thread_cb * osThreadId;
+typedef struct os_timer_cb * osTimerId;
+typedef struct os_mutex_cb * osMutexId;
+typedef struct os_semaphore_cb * osSemaphoreId;
+typedef struct os_messageQ_cb * osMessageQId;
+
+typedef struct os_thread_def
+{
+    char * name;
+    os_pthread pthread;
+    osPriority tpriority;
+    uint32_t instances;
+    uint32_t stacksize;
+} osThreadDef_t;
+
+typedef struct os_timer_def
+{
+    os_ptimer ptimer;
+} osTimerDef_t;
+
+typedef struct os_mutex_def
+{
+    uint32_t dummy;
+} osMutexDef_t;
+
+typedef struct os_semaphore_def
+{
+    uint32_t dummy;
+} osSemaphoreDef_t;
+
+typedef struct os_messageQ_def
+{
+    uint32_t queue_sz;
+    uint32_t item_sz;
+} osMessageQDef_t;
+
+typedef struct
+{
+    osStatus status;
+    union
+    {
+        uint32_t v;
+        void * p;
+        int32_t signals;
+    } value;
+    union
+    {
+        osMessageQId message_id;
+    } def;
+} osEvent;
+
+#define osThreadDef( name, thread, priority, instances, stacksz ) \
+    const osThreadDef_t os_thread_def_ ## name =                  \
+    { # name, ( thread ), ( priority ), ( instances ), ( stacksz ) }
+#define osThread( name )                       & os_thread_def_ ## name
+
+#define osTimerDef( name, function ) \
+    const osTimerDef_t os_timer_def_ ## name = { ( function ) }
+#define osTimer( name )                        & os_timer_def_ ## name
+
+#define osMutexDef( name ) \
+    const osMutexDef_t os_mutex_def_ ## name = { 0 }
+#define osMutex( name )                        & os_mutex_def_ ## name
+
+#define osSemaphoreDef( name ) \
+    const osSemaphoreDef_t os_semaphore_def_ ## name = { 0 }
+#define osSemaphore( name )                    & os_semaphore_def_ ## name
+
+#define osMessageQDef( name, queue_sz, type ) \
+    const osMessageQDef_t os_messageQ_def_ ## name = { ( queue_sz ), sizeof( type ) }
+#define osMessageQ( name )                     & os_messageQ_def_ ## name
+
+/* Kernel. */
+osStatus osKernelInitialize( void );
+osStatus osKernelStart( void );
+int32_t osKernelRunning( void );
+uint32_t osKernelSysTick( void );
+
+/* Threads. */
+osThreadId osThreadCreate( const osThreadDef_t * thread_def,
+                           void * argument );
+osThreadId osThreadGetId( void );
+osStatus osThreadYield( void );
+osStatus osDelay( uint32_t millisec );
+
+/* Timers, their callbacks run one at a time in the timer thread. */
+osTimerId osTimerCreate( const osTimerDef_t * timer_def,
+                         os_timer_type type,
+                         void * argument );
+osStatus osTimerStart( osTimerId timer_id,
+                       uint32_t millisec );
+osStatus osTimerStop( osTimerId timer_id );
+osStatus osTimerDelete( osTimerId timer_id );
+
+/* Mutexes. */
+osMutexId osMutexCreate( const osMutexDef_t * mutex_def );
+osStatus osMutexWait( osMutexId mutex_id,
+                      uint32_t millisec );
+osStatus osMutexRelease( osMutexId mutex_id );
+osStatus osMutexDelete( osMutexId mutex_id );
+
+/* Semaphores, binary when created with a count of 1. */
+osSemaphoreId osSemaphoreCreate( const osSemaphoreDef_t * semaphore_def,
+                                 int32_t count );
+int32_t osSemaphoreWait( osSemaphoreId semaphore_id,
+                         uint32_t millisec );
+osStatus osSemaphoreRelease( osSemaphoreId semaphore_id );
+osStatus osSemaphoreDelete( osSemaphoreId semaphore_id );
+
+/* Message queues of 32-bit words. */
+osMessageQId osMessageCreate( const osMessageQDef_t * queue_def,
+                              osThreadId thread_id );
+osStatus osMessagePut( osMessageQId queue_id,
+                       uint32_t info,
+                       uint32_t millisec );
+osEvent osMessageGet( osMessageQId queue_id,
+                      uint32_t millisec );
+uint32_t osMessageWaiting( osMessageQId queue_id );
+
+/* Heap, reached through cmsis_os.h on the target too. */
+void * pvPortMalloc( size_t xSize );
+void vPortFree( void * pv );
+
+/**
+ * @brief Enter the simulated target from a thread that was not created by
+ * osThreadCreate(), typically the test runner.
+ *
+ * The caller then runs as one of the target threads until it calls
+ * osHostLeave(). Calls do not nest.
+ */
+void osHostEnter( void );
+
+/**
+ * @brief Give the simulated target back to its threads.
+ */
+void osHostLeave( void );
+
+/**
+ * @brief Run @p handler as an interrupt: the caller must not be a target
+ * thread, @p handler is called with the global lock held.
+ */
+void osHostInterrupt( void ( * handler )( void * pvContext ),
+                      void * pvContext );
+
+/**
+ * @brief Release the global lock around a blocking host call made by a
+ * target thread (a file descriptor write for instance), and take it back.
+ */
+void osHostUnlock( void );
+void osHostLock( void );
+
+#endif /* CMSIS_OS_H */
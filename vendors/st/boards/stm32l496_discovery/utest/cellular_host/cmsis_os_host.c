@@ -0,0 +1,715 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file cmsis_os_host.c
+ * @brief CMSIS-RTOS v1 subset on POSIX threads, see cmsis_os.h.
+ *
+ * A single condition variable, tied to the global lock, is broadcast each
+ * time a kernel object changes state; blocked threads re-check their own
+ * object when woken up. With a handful of threads this keeps every object a
+ * few plain fields, the same trade-off as a small RTOS scanning its lists.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cmsis_os.h"
+
+/*-----------------------------------------------------------*/
+
+struct os_thread_cb
+{
+    pthread_t xThread;
+    os_pthread xEntry;
+    void * pvArgument;
+    const char * pcName;
+};
+
+struct os_timer_cb
+{
+    os_ptimer xCallback;
+    os_timer_type xType;
+    void * pvArgument;
+    bool xActive;
+    uint32_t ulPeriod;
+    uint32_t ulExpiry;
+    struct os_timer_cb * pxNext;
+};
+
+struct os_mutex_cb
+{
+    bool xTaken;
+};
+
+struct os_semaphore_cb
+{
+    int32_t lCount;
+    int32_t lMax;
+};
+
+struct os_messageQ_cb
+{
+    uint32_t ulSize;
+    uint32_t ulHead;
+    uint32_t ulCount;
+    uint32_t ulItems[];
+};
+
+/*-----------------------------------------------------------*/
+
+static pthread_mutex_t xKernelLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t xKernelEvent;
+static pthread_once_t xKernelOnce = PTHREAD_ONCE_INIT;
+static struct timespec xKernelStart;
+
+static struct os_timer_cb * pxTimerList = NULL;
+static pthread_t xTimerThread;
+
+static __thread struct os_thread_cb * pxCurrentThread = NULL;
+static struct os_thread_cb xHostThread = { .pcName = "host" };
+
+/*-----------------------------------------------------------*/
+
+static void * prvTimerThread( void * pvArgument );
+
+static void prvKernelInit( void )
+{
+    pthread_condattr_t xAttr;
+
+    ( void ) pthread_condattr_init( &xAttr );
+    ( void ) pthread_condattr_setclock( &xAttr, CLOCK_MONOTONIC );
+    ( void ) pthread_cond_init( &xKernelEvent, &xAttr );
+    ( void ) pthread_condattr_destroy( &xAttr );
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xKernelStart );
+
+    if( pthread_create( &xTimerThread, NULL, prvTimerThread, NULL ) == 0 )
+    {
+        ( void ) pthread_detach( xTimerThread );
+    }
+}
+
+static void prvKernelCheck( void )
+{
+    ( void ) pthread_once( &xKernelOnce, prvKernelInit );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvSignal( void )
+{
+    ( void ) pthread_cond_broadcast( &xKernelEvent );
+}
+
+/* Absolute deadline @p ulMillisec from now, on the monotonic clock. */
+static void prvDeadline( uint32_t ulMillisec,
+                         struct timespec * pxDeadline )
+{
+    ( void ) clock_gettime( CLOCK_MONOTONIC, pxDeadline );
+    pxDeadline->tv_sec += ( time_t ) ( ulMillisec / 1000U );
+    pxDeadline->tv_nsec += ( long ) ( ulMillisec % 1000U ) * 1000000L;
+
+    if( pxDeadline->tv_nsec >= 1000000000L )
+    {
+        pxDeadline->tv_sec++;
+        pxDeadline->tv_nsec -= 1000000000L;
+    }
+}
+
+/* Wait for the next kernel event, giving up the global lock meanwhile.
+ * Returns false once @p pxDeadline, NULL for no deadline, has passed. */
+static bool prvWait( const struct timespec * pxDeadline )
+{
+    bool xInTime = true;
+
+    if( pxDeadline == NULL )
+    {
+        ( void ) pthread_cond_wait( &xKernelEvent, &xKernelLock );
+    }
+    else if( pthread_cond_timedwait( &xKernelEvent, &xKernelLock, pxDeadline ) == ETIMEDOUT )
+    {
+        xInTime = false;
+    }
+
+    return xInTime;
+}
+
+/* Common prologue of the blocking calls: true when the caller may wait,
+ * with the deadline to pass to prvWait(). */
+static bool prvMayWait( uint32_t ulMillisec,
+                        struct timespec * pxDeadline,
+                        const struct timespec ** ppxDeadline )
+{
+    *ppxDeadline = NULL;
+
+    if( ( ulMillisec != 0U ) && ( ulMillisec != osWaitForever ) )
+    {
+        prvDeadline( ulMillisec, pxDeadline );
+        *ppxDeadline = pxDeadline;
+    }
+
+    return ( ulMillisec != 0U );
+}
+
+/*-----------------------------------------------------------*/
+
+osStatus osKernelInitialize( void )
+{
+    prvKernelCheck();
+
+    return osOK;
+}
+
+osStatus osKernelStart( void )
+{
+    prvKernelCheck();
+
+    return osOK;
+}
+
+int32_t osKernelRunning( void )
+{
+    return 1;
+}
+
+uint32_t osKernelSysTick( void )
+{
+    struct timespec xNow;
+
+    prvKernelCheck();
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( uint32_t ) ( ( xNow.tv_sec - xKernelStart.tv_sec ) * 1000L +
+                          ( xNow.tv_nsec - xKernelStart.tv_nsec ) / 1000000L );
+}
+
+/*-----------------------------------------------------------*/
+
+static void * prvThreadEntry( void * pvArgument )
+{
+    struct os_thread_cb * pxThread = ( struct os_thread_cb * ) pvArgument;
+
+    pxCurrentThread = pxThread;
+
+    ( void ) pthread_mutex_lock( &xKernelLock );
+    pxThread->xEntry( pxThread->pvArgument );
+    ( void ) pthread_mutex_unlock( &xKernelLock );
+
+    return NULL;
+}
+
+osThreadId osThreadCreate( const osThreadDef_t * thread_def,
+                           void * argument )
+{
+    struct os_thread_cb * pxThread = NULL;
+
+    prvKernelCheck();
+
+    if( ( thread_def != NULL ) && ( thread_def->pthread != NULL ) )
+    {
+        pxThread = calloc( 1, sizeof( *pxThread ) );
+    }
+
+    if( pxThread != NULL )
+    {
+        pxThread->xEntry = thread_def->pthread;
+        pxThread->pvArgument = argument;
+        pxThread->pcName = thread_def->name;
+
+        /* The new thread starts once the caller blocks. */
+        if( pthread_create( &pxThread->xThread, NULL, prvThreadEntry, pxThread ) == 0 )
+        {
+            ( void ) pthread_detach( pxThread->xThread );
+        }
+        else
+        {
+            free( pxThread );
+            pxThread = NULL;
+        }
+    }
+
+    return pxThread;
+}
+
+osThreadId osThreadGetId( void )
+{
+    return pxCurrentThread;
+}
+
+osStatus osThreadYield( void )
+{
+    ( void ) pthread_mutex_unlock( &xKernelLock );
+    ( void ) sched_yield();
+    ( void ) pthread_mutex_lock( &xKernelLock );
+
+    return osOK;
+}
+
+osStatus osDelay( uint32_t millisec )
+{
+    struct timespec xDeadline;
+
+    if( millisec == 0U )
+    {
+        ( void ) osThreadYield();
+    }
+    else
+    {
+        prvDeadline( millisec, &xDeadline );
+
+        while( prvWait( &xDeadline ) == true )
+        {
+        }
+    }
+
+    return osOK;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * prvTimerThread( void * pvArgument )
+{
+    struct os_timer_cb * pxTimer;
+    struct os_timer_cb * pxFirst;
+    struct timespec xDeadline;
+    uint32_t ulNow;
+
+    ( void ) pvArgument;
+
+    ( void ) pthread_mutex_lock( &xKernelLock );
+
+    for( ; ; )
+    {
+        ulNow = osKernelSysTick();
+        pxFirst = NULL;
+
+        for( pxTimer = pxTimerList; pxTimer != NULL; pxTimer = pxTimer->pxNext )
+        {
+            if( ( pxTimer->xActive == true ) &&
+                ( ( pxFirst == NULL ) || ( ( int32_t ) ( pxTimer->ulExpiry - pxFirst->ulExpiry ) < 0 ) ) )
+            {
+                pxFirst = pxTimer;
+            }
+        }
+
+        if( pxFirst == NULL )
+        {
+            ( void ) prvWait( NULL );
+        }
+        else if( ( int32_t ) ( pxFirst->ulExpiry - ulNow ) > 0 )
+        {
+            prvDeadline( pxFirst->ulExpiry - ulNow, &xDeadline );
+            ( void ) prvWait( &xDeadline );
+        }
+        else
+        {
+            if( pxFirst->xType == osTimerPeriodic )
+            {
+                pxFirst->ulExpiry += pxFirst->ulPeriod;
+            }
+            else
+            {
+                pxFirst->xActive = false;
+            }
+
+            pxFirst->xCallback( pxFirst->pvArgument );
+            prvSignal();
+        }
+    }
+
+    return NULL;
+}
+
+osTimerId osTimerCreate( const osTimerDef_t * timer_def,
+                         os_timer_type type,
+                         void * argument )
+{
+    struct os_timer_cb * pxTimer = NULL;
+
+    prvKernelCheck();
+
+    if( ( timer_def != NULL ) && ( timer_def->ptimer != NULL ) )
+    {
+        pxTimer = calloc( 1, sizeof( *pxTimer ) );
+    }
+
+    if( pxTimer != NULL )
+    {
+        pxTimer->xCallback = timer_def->ptimer;
+        pxTimer->xType = type;
+        pxTimer->pvArgument = argument;
+        pxTimer->pxNext = pxTimerList;
+        pxTimerList = pxTimer;
+    }
+
+    return pxTimer;
+}
+
+osStatus osTimerStart( osTimerId timer_id,
+                       uint32_t millisec )
+{
+    osStatus xStatus = osErrorParameter;
+
+    if( ( timer_id != NULL ) && ( millisec != 0U ) )
+    {
+        timer_id->ulPeriod = millisec;
+        timer_id->ulExpiry = osKernelSysTick() + millisec;
+        timer_id->xActive = true;
+        prvSignal();
+        xStatus = osOK;
+    }
+
+    return xStatus;
+}
+
+osStatus osTimerStop( osTimerId timer_id )
+{
+    osStatus xStatus = osErrorParameter;
+
+    if( timer_id != NULL )
+    {
+        timer_id->xActive = false;
+        xStatus = osOK;
+    }
+
+    return xStatus;
+}
+
+osStatus osTimerDelete( osTimerId timer_id )
+{
+    struct os_timer_cb ** ppxLink;
+    osStatus xStatus = osErrorParameter;
+
+    for( ppxLink = &pxTimerList; *ppxLink != NULL; ppxLink = &( *ppxLink )->pxNext )
+    {
+        if( *ppxLink == timer_id )
+        {
+            *ppxLink = timer_id->pxNext;
+            free( timer_id );
+            xStatus = osOK;
+            break;
+        }
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+osMutexId osMutexCreate( const osMutexDef_t * mutex_def )
+{
+    ( void ) mutex_def;
+    prvKernelCheck();
+
+    return calloc( 1, sizeof( struct os_mutex_cb ) );
+}
+
+osStatus osMutexWait( osMutexId mutex_id,
+                      uint32_t millisec )
+{
+    struct timespec xDeadline;
+    const struct timespec * pxDeadline;
+    bool xMayWait;
+    osStatus xStatus = osErrorParameter;
+
+    if( mutex_id != NULL )
+    {
+        xMayWait = prvMayWait( millisec, &xDeadline, &pxDeadline );
+
+        while( ( mutex_id->xTaken == true ) && ( xMayWait == true ) )
+        {
+            xMayWait = prvWait( pxDeadline );
+        }
+
+        if( mutex_id->xTaken == false )
+        {
+            mutex_id->xTaken = true;
+            xStatus = osOK;
+        }
+        else
+        {
+            xStatus = ( millisec == 0U ) ? osErrorResource : osErrorTimeoutResource;
+        }
+    }
+
+    return xStatus;
+}
+
+osStatus osMutexRelease( osMutexId mutex_id )
+{
+    osStatus xStatus = osErrorParameter;
+
+    if( mutex_id != NULL )
+    {
+        xStatus = ( mutex_id->xTaken == true ) ? osOK : osErrorResource;
+        mutex_id->xTaken = false;
+        prvSignal();
+    }
+
+    return xStatus;
+}
+
+osStatus osMutexDelete( osMutexId mutex_id )
+{
+    free( mutex_id );
+
+    return osOK;
+}
+
+/*-----------------------------------------------------------*/
+
+osSemaphoreId osSemaphoreCreate( const osSemaphoreDef_t * semaphore_def,
+                                 int32_t count )
+{
+    struct os_semaphore_cb * pxSemaphore;
+
+    ( void ) semaphore_def;
+    prvKernelCheck();
+
+    pxSemaphore = calloc( 1, sizeof( *pxSemaphore ) );
+
+    if( pxSemaphore != NULL )
+    {
+        /* Like the target port: available at creation. */
+        pxSemaphore->lCount = count;
+        pxSemaphore->lMax = count;
+    }
+
+    return pxSemaphore;
+}
+
+int32_t osSemaphoreWait( osSemaphoreId semaphore_id,
+                         uint32_t millisec )
+{
+    struct timespec xDeadline;
+    const struct timespec * pxDeadline;
+    bool xMayWait;
+    int32_t lStatus = ( int32_t ) osErrorParameter;
+
+    if( semaphore_id != NULL )
+    {
+        xMayWait = prvMayWait( millisec, &xDeadline, &pxDeadline );
+
+        while( ( semaphore_id->lCount == 0 ) && ( xMayWait == true ) )
+        {
+            xMayWait = prvWait( pxDeadline );
+        }
+
+        if( semaphore_id->lCount > 0 )
+        {
+            semaphore_id->lCount--;
+            lStatus = ( int32_t ) osOK;
+        }
+        else
+        {
+            lStatus = ( int32_t ) osErrorOS;
+        }
+    }
+
+    return lStatus;
+}
+
+osStatus osSemaphoreRelease( osSemaphoreId semaphore_id )
+{
+    osStatus xStatus = osErrorParameter;
+
+    if( semaphore_id != NULL )
+    {
+        if( semaphore_id->lCount < semaphore_id->lMax )
+        {
+            semaphore_id->lCount++;
+            prvSignal();
+            xStatus = osOK;
+        }
+        else
+        {
+            xStatus = osErrorOS;
+        }
+    }
+
+    return xStatus;
+}
+
+osStatus osSemaphoreDelete( osSemaphoreId semaphore_id )
+{
+    free( semaphore_id );
+
+    return osOK;
+}
+
+/*-----------------------------------------------------------*/
+
+osMessageQId osMessageCreate( const osMessageQDef_t * queue_def,
+                              osThreadId thread_id )
+{
+    struct os_messageQ_cb * pxQueue = NULL;
+
+    ( void ) thread_id;
+    prvKernelCheck();
+
+    if( ( queue_def != NULL ) && ( queue_def->queue_sz != 0U ) )
+    {
+        pxQueue = calloc( 1, sizeof( *pxQueue ) + ( queue_def->queue_sz * sizeof( uint32_t ) ) );
+    }
+
+    if( pxQueue != NULL )
+    {
+        pxQueue->ulSize = queue_def->queue_sz;
+    }
+
+    return pxQueue;
+}
+
+osStatus osMessagePut( osMessageQId queue_id,
+                       uint32_t info,
+                       uint32_t millisec )
+{
+    struct timespec xDeadline;
+    const struct timespec * pxDeadline;
+    bool xMayWait;
+    osStatus xStatus = osErrorParameter;
+
+    if( queue_id != NULL )
+    {
+        xMayWait = prvMayWait( millisec, &xDeadline, &pxDeadline );
+
+        while( ( queue_id->ulCount == queue_id->ulSize ) && ( xMayWait == true ) )
+        {
+            xMayWait = prvWait( pxDeadline );
+        }
+
+        if( queue_id->ulCount < queue_id->ulSize )
+        {
+            queue_id->ulItems[ ( queue_id->ulHead + queue_id->ulCount ) % queue_id->ulSize ] = info;
+            queue_id->ulCount++;
+            prvSignal();
+            xStatus = osOK;
+        }
+        else
+        {
+            xStatus = osErrorOS;
+        }
+    }
+
+    return xStatus;
+}
+
+osEvent osMessageGet( osMessageQId queue_id,
+                      uint32_t millisec )
+{
+    struct timespec xDeadline;
+    const struct timespec * pxDeadline;
+    bool xMayWait;
+    osEvent xEvent;
+
+    ( void ) memset( &xEvent, 0, sizeof( xEvent ) );
+    xEvent.def.message_id = queue_id;
+    xEvent.status = osErrorParameter;
+
+    if( queue_id != NULL )
+    {
+        xMayWait = prvMayWait( millisec, &xDeadline, &pxDeadline );
+
+        while( ( queue_id->ulCount == 0U ) && ( xMayWait == true ) )
+        {
+            xMayWait = prvWait( pxDeadline );
+        }
+
+        if( queue_id->ulCount != 0U )
+        {
+            xEvent.value.v = queue_id->ulItems[ queue_id->ulHead ];
+            queue_id->ulHead = ( queue_id->ulHead + 1U ) % queue_id->ulSize;
+            queue_id->ulCount--;
+            xEvent.status = osEventMessage;
+            prvSignal();
+        }
+        else
+        {
+            xEvent.status = ( millisec == 0U ) ? osOK : osEventTimeout;
+        }
+    }
+
+    return xEvent;
+}
+
+uint32_t osMessageWaiting( osMessageQId queue_id )
+{
+    return ( queue_id != NULL ) ? queue_id->ulCount : 0U;
+}
+
+/*-----------------------------------------------------------*/
+
+void * pvPortMalloc( size_t xSize )
+{
+    return malloc( xSize );
+}
+
+void vPortFree( void * pv )
+{
+    free( pv );
+}
+
+/*-----------------------------------------------------------*/
+
+void osHostEnter( void )
+{
+    prvKernelCheck();
+    ( void ) pthread_mutex_lock( &xKernelLock );
+
+    if( pxCurrentThread == NULL )
+    {
+        pxCurrentThread = &xHostThread;
+    }
+}
+
+void osHostLeave( void )
+{
+    ( void ) pthread_mutex_unlock( &xKernelLock );
+}
+
+void osHostInterrupt( void ( * handler )( void * pvContext ),
+                      void * pvContext )
+{
+    prvKernelCheck();
+    ( void ) pthread_mutex_lock( &xKernelLock );
+    handler( pvContext );
+    prvSignal();
+    ( void ) pthread_mutex_unlock( &xKernelLock );
+}
+
+void osHostUnlock( void )
+{
+    ( void ) pthread_mutex_unlock( &xKernelLock );
+}
+
+void osHostLock( void )
+{
+    ( void ) pthread_mutex_lock( &xKernelLock );
+}
@@ -0,0 +1,378 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file hal_host.c
+ * @brief STM32L4 HAL subset on POSIX, see hal_host.h.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cmsis_os.h"
+#include "hal_host.h"
+
+/* Characters read from the line at once, delivered under one interrupt. */
+#define UART_HOST_RX_BURST    ( 256U )
+
+/* Retry period while the receiver is not armed (IPC RX queue full). */
+#define UART_HOST_RX_RETRY    ( 1000U )
+
+typedef struct UartRxBurst
+{
+    USART_TypeDef * pxInstance;
+    const uint8_t * pucData;
+    size_t xLength;
+    size_t xDelivered;
+} UartRxBurst_t;
+
+/*-----------------------------------------------------------*/
+
+GPIO_TypeDef GPIOA_Host, GPIOB_Host, GPIOC_Host, GPIOD_Host, GPIOG_Host, GPIOH_Host;
+
+USART_TypeDef USART1_Host = { .lFd = -1 };
+USART_TypeDef USART2_Host = { .lFd = -1 };
+USART_TypeDef LPUART1_Host = { .lFd = -1 };
+
+UART_HandleTypeDef huart1;
+RNG_HandleTypeDef hrng = { .ulSeed = 1U };
+
+/*-----------------------------------------------------------*/
+
+void HAL_GPIO_Init( GPIO_TypeDef * GPIOx,
+                    GPIO_InitTypeDef * GPIO_Init )
+{
+    ( void ) GPIOx;
+    ( void ) GPIO_Init;
+}
+
+void HAL_GPIO_WritePin( GPIO_TypeDef * GPIOx,
+                        uint16_t GPIO_Pin,
+                        GPIO_PinState PinState )
+{
+    if( PinState == GPIO_PIN_SET )
+    {
+        GPIOx->ODR |= GPIO_Pin;
+    }
+    else
+    {
+        GPIOx->ODR &= ~( uint32_t ) GPIO_Pin;
+    }
+}
+
+GPIO_PinState HAL_GPIO_ReadPin( GPIO_TypeDef * GPIOx,
+                                uint16_t GPIO_Pin )
+{
+    return ( ( GPIOx->ODR & GPIO_Pin ) != 0U ) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+/*-----------------------------------------------------------*/
+
+void HAL_NVIC_EnableIRQ( IRQn_Type IRQn )
+{
+    ( void ) IRQn;
+}
+
+void HAL_NVIC_DisableIRQ( IRQn_Type IRQn )
+{
+    ( void ) IRQn;
+}
+
+void HAL_NVIC_SetPendingIRQ( IRQn_Type IRQn )
+{
+    ( void ) IRQn;
+}
+
+void NVIC_SystemReset( void )
+{
+    ( void ) fprintf( stderr, "target reset requested\n" );
+    abort();
+}
+
+uint32_t HAL_GetTick( void )
+{
+    return osKernelSysTick();
+}
+
+void HAL_Delay( uint32_t Delay )
+{
+    ( void ) osDelay( Delay );
+}
+
+HAL_StatusTypeDef HAL_RNG_GenerateRandomNumber( RNG_HandleTypeDef * hrng,
+                                                uint32_t * random32bit )
+{
+    /* xorshift32, reproducible from one run to the other. */
+    hrng->ulSeed ^= hrng->ulSeed << 13;
+    hrng->ulSeed ^= hrng->ulSeed >> 17;
+    hrng->ulSeed ^= hrng->ulSeed << 5;
+    *random32bit = hrng->ulSeed;
+
+    return HAL_OK;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Receive interrupt: hand over characters while the receiver is armed. */
+static void prvUartRxInterrupt( void * pvContext )
+{
+    UartRxBurst_t * pxBurst = ( UartRxBurst_t * ) pvContext;
+    UART_HandleTypeDef * pxHandle = pxBurst->pxInstance->pxHandle;
+
+    while( ( pxBurst->xDelivered < pxBurst->xLength ) &&
+           ( pxHandle != NULL ) &&
+           ( pxHandle->RxState == HAL_UART_STATE_BUSY_RX ) )
+    {
+        *pxHandle->pRxBuffPtr = pxBurst->pucData[ pxBurst->xDelivered ];
+        pxBurst->xDelivered++;
+        pxHandle->RxXferCount = 0U;
+        pxHandle->RxState = HAL_UART_STATE_READY;
+
+        /* Re-arms the receiver unless the IPC queue is full. */
+        HAL_UART_RxCpltCallback( pxHandle );
+    }
+}
+
+static void * prvUartRxThread( void * pvArgument )
+{
+    USART_TypeDef * pxInstance = ( USART_TypeDef * ) pvArgument;
+    uint8_t ucData[ UART_HOST_RX_BURST ];
+    UartRxBurst_t xBurst;
+    ssize_t xRead;
+
+    xBurst.pxInstance = pxInstance;
+    xBurst.pucData = ucData;
+
+    for( ; ; )
+    {
+        xRead = read( pxInstance->lFd, ucData, sizeof( ucData ) );
+
+        if( xRead <= 0 )
+        {
+            if( ( xRead < 0 ) && ( errno == EINTR ) )
+            {
+                continue;
+            }
+
+            /* Line hung up. */
+            break;
+        }
+
+        xBurst.xLength = ( size_t ) xRead;
+        xBurst.xDelivered = 0U;
+
+        for( ; ; )
+        {
+            osHostInterrupt( prvUartRxInterrupt, &xBurst );
+
+            if( xBurst.xDelivered == xBurst.xLength )
+            {
+                break;
+            }
+
+            /* Flow control: the line holds while the receiver is not armed. */
+            ( void ) usleep( UART_HOST_RX_RETRY );
+        }
+    }
+
+    return NULL;
+}
+
+void HAL_HostUartAttach( USART_TypeDef * pxInstance,
+                         int lFd,
+                         uint32_t ulBaudRate )
+{
+    pthread_t xThread;
+
+    pxInstance->lFd = lFd;
+    pxInstance->ulBaudRate = ulBaudRate;
+
+    if( pthread_create( &xThread, NULL, prvUartRxThread, pxInstance ) == 0 )
+    {
+        ( void ) pthread_detach( xThread );
+    }
+}
+
+HAL_StatusTypeDef HAL_UART_Init( UART_HandleTypeDef * huart )
+{
+    HAL_StatusTypeDef xStatus = HAL_ERROR;
+
+    if( ( huart != NULL ) && ( huart->Instance != NULL ) && ( huart->Instance->lFd >= 0 ) )
+    {
+        huart->Instance->pxHandle = huart;
+        huart->gState = HAL_UART_STATE_READY;
+        huart->RxState = HAL_UART_STATE_READY;
+        xStatus = HAL_OK;
+    }
+
+    return xStatus;
+}
+
+HAL_StatusTypeDef HAL_UART_DeInit( UART_HandleTypeDef * huart )
+{
+    huart->gState = HAL_UART_STATE_RESET;
+    huart->RxState = HAL_UART_STATE_RESET;
+    huart->Instance->pxHandle = NULL;
+
+    return HAL_OK;
+}
+
+/* Write the whole buffer, at the line rate, without holding the global lock. */
+static HAL_StatusTypeDef prvUartWrite( UART_HandleTypeDef * huart,
+                                       const uint8_t * pData,
+                                       uint16_t Size )
+{
+    HAL_StatusTypeDef xStatus = HAL_OK;
+    size_t xWritten = 0U;
+    ssize_t xResult;
+    uint64_t ullLineUs;
+
+    osHostUnlock();
+
+    while( xWritten < Size )
+    {
+        xResult = write( huart->Instance->lFd, &pData[ xWritten ], Size - xWritten );
+
+        if( xResult > 0 )
+        {
+            xWritten += ( size_t ) xResult;
+        }
+        else if( ( xResult < 0 ) && ( errno == EINTR ) )
+        {
+        }
+        else
+        {
+            xStatus = HAL_ERROR;
+            break;
+        }
+    }
+
+    if( huart->Instance->ulBaudRate != 0U )
+    {
+        /* 10 bits per character, 8N1. */
+        ullLineUs = ( ( uint64_t ) Size * 10U * 1000000U ) / huart->Instance->ulBaudRate;
+        ( void ) usleep( ( useconds_t ) ullLineUs );
+    }
+
+    osHostLock();
+
+    return xStatus;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit( UART_HandleTypeDef * huart,
+                                     uint8_t * pData,
+                                     uint16_t Size,
+                                     uint32_t Timeout )
+{
+    HAL_StatusTypeDef xStatus;
+
+    ( void ) Timeout;
+
+    if( huart->gState != HAL_UART_STATE_READY )
+    {
+        xStatus = HAL_BUSY;
+    }
+    else
+    {
+        huart->gState = HAL_UART_STATE_BUSY_TX;
+        xStatus = prvUartWrite( huart, pData, Size );
+        huart->gState = HAL_UART_STATE_READY;
+    }
+
+    return xStatus;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_IT( UART_HandleTypeDef * huart,
+                                        uint8_t * pData,
+                                        uint16_t Size )
+{
+    HAL_StatusTypeDef xStatus;
+
+    if( huart->gState != HAL_UART_STATE_READY )
+    {
+        xStatus = HAL_BUSY;
+    }
+    else
+    {
+        huart->gState = HAL_UART_STATE_BUSY_TX;
+        xStatus = prvUartWrite( huart, pData, Size );
+        huart->gState = HAL_UART_STATE_READY;
+
+        if( xStatus == HAL_OK )
+        {
+            /* Transfer complete interrupt. */
+            HAL_UART_TxCpltCallback( huart );
+        }
+    }
+
+    return xStatus;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_IT( UART_HandleTypeDef * huart,
+                                       uint8_t * pData,
+                                       uint16_t Size )
+{
+    HAL_StatusTypeDef xStatus;
+
+    if( huart->RxState != HAL_UART_STATE_READY )
+    {
+        xStatus = HAL_BUSY;
+    }
+    else if( ( pData == NULL ) || ( Size != 1U ) )
+    {
+        /* Only the character interrupt mode of the IPC is modelled. */
+        xStatus = HAL_ERROR;
+    }
+    else
+    {
+        huart->pRxBuffPtr = pData;
+        huart->RxXferSize = Size;
+        huart->RxXferCount = Size;
+        huart->RxState = HAL_UART_STATE_BUSY_RX;
+        xStatus = HAL_OK;
+    }
+
+    return xStatus;
+}
+
+HAL_StatusTypeDef HAL_UART_AbortReceive( UART_HandleTypeDef * huart )
+{
+    huart->RxState = HAL_UART_STATE_READY;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_AbortTransmit_IT( UART_HandleTypeDef * huart )
+{
+    huart->gState = HAL_UART_STATE_READY;
+
+    return HAL_OK;
+}
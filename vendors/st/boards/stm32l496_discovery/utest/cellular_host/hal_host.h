@@ -0,0 +1,239 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file hal_host.h
+ * @brief Host build of the STM32L4 HAL subset used by the cellular stack.
+ *
+ * GPIO writes are recorded, the RNG is libc rand() and the modem UART is a
+ * file descriptor: a socketpair end or a pseudo-terminal. Characters are
+ * delivered one by one to HAL_UART_RxCpltCallback() from a thread playing
+ * the UART interrupt, with the receive interrupt re-armed by
+ * HAL_UART_Receive_IT() as on the target. Transmission releases the global
+ * lock while the data is written, paced at the configured baud rate, then
+ * calls HAL_UART_TxCpltCallback().
+ */
+
+#ifndef HAL_HOST_H
+#define HAL_HOST_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define __IO                        volatile
+
+#define __disable_irq()             do {} while( 0 )
+#define __enable_irq()              do {} while( 0 )
+#define __NOP()                     do {} while( 0 )
+
+#define UNUSED( X )                 ( void ) ( X )
+
+#define HAL_MAX_DELAY               0xFFFFFFFFU
+
+typedef enum
+{
+    HAL_OK = 0x00U,
+    HAL_ERROR = 0x01U,
+    HAL_BUSY = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+typedef enum
+{
+    RESET = 0U,
+    SET = !RESET
+} FlagStatus;
+
+typedef enum
+{
+    USART1_IRQn = 37,
+    USART2_IRQn = 38,
+    EXTI2_IRQn = 8,
+    LPUART1_IRQn = 70
+} IRQn_Type;
+
+/* GPIO ------------------------------------------------------------------------*/
+
+typedef struct
+{
+    uint32_t ODR;
+} GPIO_TypeDef;
+
+typedef struct
+{
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+    uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+typedef enum
+{
+    GPIO_PIN_RESET = 0U,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+#define GPIO_PIN_0                  ( ( uint16_t ) 0x0001U )
+#define GPIO_PIN_2                  ( ( uint16_t ) 0x0004U )
+#define GPIO_PIN_3                  ( ( uint16_t ) 0x0008U )
+#define GPIO_PIN_6                  ( ( uint16_t ) 0x0040U )
+#define GPIO_PIN_10                 ( ( uint16_t ) 0x0400U )
+#define GPIO_PIN_11                 ( ( uint16_t ) 0x0800U )
+#define GPIO_PIN_12                 ( ( uint16_t ) 0x1000U )
+#define GPIO_PIN_15                 ( ( uint16_t ) 0x8000U )
+#define GPIO_MODE_OUTPUT_PP         ( 0x00000001U )
+#define GPIO_NOPULL                 ( 0x00000000U )
+#define GPIO_SPEED_FREQ_LOW         ( 0x00000000U )
+
+extern GPIO_TypeDef GPIOA_Host, GPIOB_Host, GPIOC_Host, GPIOD_Host, GPIOG_Host, GPIOH_Host;
+#define GPIOA                       ( &GPIOA_Host )
+#define GPIOB                       ( &GPIOB_Host )
+#define GPIOC                       ( &GPIOC_Host )
+#define GPIOD                       ( &GPIOD_Host )
+#define GPIOG                       ( &GPIOG_Host )
+#define GPIOH                       ( &GPIOH_Host )
+
+void HAL_GPIO_Init( GPIO_TypeDef * GPIOx,
+                    GPIO_InitTypeDef * GPIO_Init );
+void HAL_GPIO_WritePin( GPIO_TypeDef * GPIOx,
+                        uint16_t GPIO_Pin,
+                        GPIO_PinState PinState );
+GPIO_PinState HAL_GPIO_ReadPin( GPIO_TypeDef * GPIOx,
+                                uint16_t GPIO_Pin );
+
+/* UART ------------------------------------------------------------------------*/
+
+typedef struct
+{
+    int lFd;                                /**< Device end of the line, -1 if none. */
+    uint32_t ulBaudRate;                    /**< Line pacing, 0 for none. */
+    struct __UART_HandleTypeDef * pxHandle; /**< Handle bound by HAL_UART_Init(). */
+} USART_TypeDef;
+
+extern USART_TypeDef USART1_Host, USART2_Host, LPUART1_Host;
+#define USART1                      ( &USART1_Host )
+#define USART2                      ( &USART2_Host )
+#define LPUART1                     ( &LPUART1_Host )
+
+typedef struct
+{
+    uint32_t BaudRate;
+    uint32_t WordLength;
+    uint32_t StopBits;
+    uint32_t Parity;
+    uint32_t Mode;
+    uint32_t HwFlowCtl;
+    uint32_t OverSampling;
+    uint32_t OneBitSampling;
+} UART_InitTypeDef;
+
+typedef struct
+{
+    uint32_t AdvFeatureInit;
+} UART_AdvFeatureInitTypeDef;
+
+typedef enum
+{
+    HAL_UART_STATE_RESET = 0x00U,
+    HAL_UART_STATE_READY = 0x20U,
+    HAL_UART_STATE_BUSY_TX = 0x21U,
+    HAL_UART_STATE_BUSY_RX = 0x22U
+} HAL_UART_StateTypeDef;
+
+typedef struct __UART_HandleTypeDef
+{
+    USART_TypeDef * Instance;
+    UART_InitTypeDef Init;
+    UART_AdvFeatureInitTypeDef AdvancedInit;
+    uint8_t * pRxBuffPtr;
+    uint16_t RxXferSize;
+    uint16_t RxXferCount;
+    __IO HAL_UART_StateTypeDef gState;
+    __IO HAL_UART_StateTypeDef RxState;
+    void * hdmarx;
+} UART_HandleTypeDef;
+
+#define UART_WORDLENGTH_8B          ( 0x00000000U )
+#define UART_STOPBITS_1             ( 0x00000000U )
+#define UART_PARITY_NONE            ( 0x00000000U )
+#define UART_MODE_TX_RX             ( 0x0000000CU )
+#define UART_HWCONTROL_NONE         ( 0x00000000U )
+#define UART_HWCONTROL_RTS_CTS      ( 0x00000300U )
+#define UART_OVERSAMPLING_16        ( 0x00000000U )
+#define UART_ONE_BIT_SAMPLE_DISABLE ( 0x00000000U )
+#define UART_ADVFEATURE_NO_INIT     ( 0x00000000U )
+
+HAL_StatusTypeDef HAL_UART_Init( UART_HandleTypeDef * huart );
+HAL_StatusTypeDef HAL_UART_DeInit( UART_HandleTypeDef * huart );
+HAL_StatusTypeDef HAL_UART_Transmit( UART_HandleTypeDef * huart,
+                                     uint8_t * pData,
+                                     uint16_t Size,
+                                     uint32_t Timeout );
+HAL_StatusTypeDef HAL_UART_Transmit_IT( UART_HandleTypeDef * huart,
+                                        uint8_t * pData,
+                                        uint16_t Size );
+HAL_StatusTypeDef HAL_UART_Receive_IT( UART_HandleTypeDef * huart,
+                                       uint8_t * pData,
+                                       uint16_t Size );
+HAL_StatusTypeDef HAL_UART_AbortReceive( UART_HandleTypeDef * huart );
+HAL_StatusTypeDef HAL_UART_AbortTransmit_IT( UART_HandleTypeDef * huart );
+
+/* Called under the simulated interrupt, defined by the application. */
+void HAL_UART_RxCpltCallback( UART_HandleTypeDef * huart );
+void HAL_UART_TxCpltCallback( UART_HandleTypeDef * huart );
+
+/**
+ * @brief Attach the device end of a line to a UART instance and start its
+ * interrupt thread. To be called before HAL_UART_Init().
+ *
+ * @param[in] pxInstance UART instance, USART1 for the modem.
+ * @param[in] lFd Connected socket or terminal, in blocking mode.
+ * @param[in] ulBaudRate Rate at which transmitted data is paced, 0 to write
+ * it at once. The other end paces what it sends.
+ */
+void HAL_HostUartAttach( USART_TypeDef * pxInstance,
+                         int lFd,
+                         uint32_t ulBaudRate );
+
+/* NVIC, tick, RNG -------------------------------------------------------------*/
+
+void HAL_NVIC_EnableIRQ( IRQn_Type IRQn );
+void HAL_NVIC_DisableIRQ( IRQn_Type IRQn );
+void HAL_NVIC_SetPendingIRQ( IRQn_Type IRQn );
+void NVIC_SystemReset( void );
+
+uint32_t HAL_GetTick( void );
+void HAL_Delay( uint32_t Delay );
+
+typedef struct
+{
+    uint32_t ulSeed;
+} RNG_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_RNG_GenerateRandomNumber( RNG_HandleTypeDef * hrng,
+                                                uint32_t * random32bit );
+
+#endif /* HAL_HOST_H */
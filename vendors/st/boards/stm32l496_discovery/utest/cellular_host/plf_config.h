@@ -0,0 +1,63 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/*
+ * Host build of the STM32_Cellular platform configuration. The feature and
+ * software settings of the board (application_code/st_code/STM32_Cellular/App)
+ * are kept, less the applications, console and RTC; the hardware settings
+ * come from plf_hw_config.h in this directory.
+ */
+
+#ifndef PLF_CONFIG_H
+#define PLF_CONFIG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define USE_ECHO_CLIENT       ( 0 )
+#define USE_HTTP_CLIENT       ( 0 )
+#define USE_PING_CLIENT       ( 0 )
+#define USE_COM_CLIENT        ( 0 )
+#define USE_MQTT_CLIENT       ( 0 )
+#define USE_DC_MEMS           ( 0 )
+#define USE_SIMU_MEMS         ( 0 )
+#define USE_DC_GENERIC        ( 0 )
+#define USE_COM_PING          ( 0 )
+#define USE_COM_ICC           ( 0 )
+#define USE_CMD_CONSOLE       ( 0 )
+#define USE_RTC               ( 0 )
+#define USE_DEFAULT_SETUP     ( 1 )
+#define USE_STACK_ANALYSIS    ( 0 )
+#define USE_CELPERF           ( 0 )
+#define USE_LINK_UART         ( 0 )
+#define USE_BOARD_BUTTONS     ( 0 )
+#define SW_DEBUG_VERSION      ( 0U )
+
+#include "plf_features.h"
+#include "plf_hw_config.h"
+#include "plf_sw_config.h"
+#include "plf_thread_config.h"
+
+#endif /* PLF_CONFIG_H */
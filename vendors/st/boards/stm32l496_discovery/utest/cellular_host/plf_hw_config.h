@@ -0,0 +1,74 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/*
+ * Host build of the board hardware configuration: the modem sits on USART1
+ * as on the STMod+ connector, its control pins are recorded by hal_host.c.
+ */
+
+#ifndef PLF_HW_CONFIG_H
+#define PLF_HW_CONFIG_H
+
+#include "hal_host.h"
+#include "plf_modem_config.h"
+
+extern UART_HandleTypeDef huart1;
+
+#define MODEM_UART_HANDLE               huart1
+#define MODEM_UART_INSTANCE             ( ( USART_TypeDef * ) USART1 )
+#define MODEM_UART_AUTOBAUD             ( 1 )
+#define MODEM_UART_IRQN                 USART1_IRQn
+
+#define MODEM_UART_BAUDRATE             ( CONFIG_MODEM_UART_BAUDRATE )
+#define MODEM_UART_WORDLENGTH           UART_WORDLENGTH_8B
+#define MODEM_UART_STOPBITS             UART_STOPBITS_1
+#define MODEM_UART_PARITY               UART_PARITY_NONE
+#define MODEM_UART_MODE                 UART_MODE_TX_RX
+#define MODEM_UART_HWFLOWCTRL           UART_HWCONTROL_RTS_CTS
+
+#define MODEM_RST_GPIO_PORT             GPIOB
+#define MODEM_RST_PIN                   GPIO_PIN_2
+#define MODEM_PWR_EN_GPIO_PORT          GPIOD
+#define MODEM_PWR_EN_PIN                GPIO_PIN_3
+#define MODEM_DTR_GPIO_PORT             GPIOA
+#define MODEM_DTR_PIN                   GPIO_PIN_0
+#define MODEM_RING_GPIO_PORT            GPIOH
+#define MODEM_RING_PIN                  GPIO_PIN_2
+#define MODEM_RING_IRQN                 EXTI2_IRQn
+
+#define MODEM_SIM_SELECT_0_GPIO_PORT    GPIOC
+#define MODEM_SIM_SELECT_0_PIN          GPIO_PIN_2
+#define MODEM_SIM_SELECT_1_GPIO_PORT    GPIOC
+#define MODEM_SIM_SELECT_1_PIN          GPIO_PIN_3
+
+#define NO_LED                          ( ( uint8_t ) 0xFF )
+#define NETWORK_LED                     NO_LED
+#define HTTPCLIENT_LED                  NO_LED
+#define DATAREADY_LED                   NO_LED
+
+#define FLASH_LAST_PAGE_ADDR            ( ( uint32_t ) 0x080ff800 )
+#define FLASH_LAST_PAGE_NUMBER          255
+
+#endif /* PLF_HW_CONFIG_H */
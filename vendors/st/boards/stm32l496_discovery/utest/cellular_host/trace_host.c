@@ -0,0 +1,138 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file trace_host.c
+ * @brief Host build of the STM32_Cellular trace interface: traces go to
+ * stderr, the ITM and UART channels being the same stream.
+ *
+ * Module traces follow the USE_TRACE_xxx flags of plf_sw_config.h and can be
+ * muted with traceIF_trace_off(); forced traces are always printed.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "trace_interface.h"
+
+uint8_t dbgIF_buf[ DBG_CHAN_MAX_VALUE ][ DBG_IF_MAX_BUFFER_SIZE ];
+uint8_t * traceIF_UartBusyFlag = NULL;
+
+static bool xTraceEnabled = true;
+
+/*-----------------------------------------------------------*/
+
+static void prvTraceWrite( uint8_t port,
+                           const uint8_t * pptr,
+                           uint16_t len )
+{
+    ( void ) fprintf( stderr, "[%u] %.*s\n", ( unsigned ) port, ( int ) len, ( const char * ) pptr );
+}
+
+void traceIF_trace_off( void )
+{
+    xTraceEnabled = false;
+}
+
+void traceIF_trace_on( void )
+{
+    xTraceEnabled = true;
+}
+
+void traceIF_itmPrint( uint8_t port,
+                       uint8_t lvl,
+                       uint8_t * pptr,
+                       uint16_t len )
+{
+    if( ( xTraceEnabled == true ) && ( ( ( uint16_t ) lvl & TRACE_IF_MASK ) != 0U ) )
+    {
+        prvTraceWrite( port, pptr, len );
+    }
+}
+
+void traceIF_uartPrint( uint8_t port,
+                        uint8_t lvl,
+                        uint8_t * pptr,
+                        uint16_t len )
+{
+    /* Same stream as the ITM channel, printed once. */
+    ( void ) port;
+    ( void ) lvl;
+    ( void ) pptr;
+    ( void ) len;
+}
+
+void traceIF_itmPrintForce( uint8_t port,
+                            uint8_t * pptr,
+                            uint16_t len )
+{
+    prvTraceWrite( port, pptr, len );
+}
+
+void traceIF_uartPrintForce( uint8_t port,
+                             uint8_t * pptr,
+                             uint16_t len )
+{
+    prvTraceWrite( port, pptr, len );
+}
+
+void traceIF_hexPrint( dbg_channels_t chan,
+                       dbg_levels_t level,
+                       uint8_t * buff,
+                       uint16_t len )
+{
+    traceIF_BufHexPrint( chan, level, ( const CRC_CHAR_t * ) buff, len );
+}
+
+void traceIF_BufCharPrint( dbg_channels_t chan,
+                           dbg_levels_t level,
+                           const CRC_CHAR_t * buf,
+                           uint16_t size )
+{
+    if( ( xTraceEnabled == true ) && ( ( ( uint16_t ) level & TRACE_IF_MASK ) != 0U ) )
+    {
+        prvTraceWrite( ( uint8_t ) chan, ( const uint8_t * ) buf, size );
+    }
+}
+
+void traceIF_BufHexPrint( dbg_channels_t chan,
+                          dbg_levels_t level,
+                          const CRC_CHAR_t * buf,
+                          uint16_t size )
+{
+    uint16_t i;
+
+    if( ( xTraceEnabled == true ) && ( ( ( uint16_t ) level & TRACE_IF_MASK ) != 0U ) )
+    {
+        ( void ) fprintf( stderr, "[%u]", ( unsigned ) chan );
+
+        for( i = 0U; i < size; i++ )
+        {
+            ( void ) fprintf( stderr, " %02x", ( unsigned ) ( uint8_t ) buf[ i ] );
+        }
+
+        ( void ) fprintf( stderr, "\n" );
+    }
+}
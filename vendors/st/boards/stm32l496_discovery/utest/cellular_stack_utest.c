@@ -0,0 +1,1115 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "unity.h"
+
+#include "cmsis_os.h"
+#include "hal_host.h"
+#include "bg96_emul.h"
+
+#include "plf_config.h"
+#include "cellular_service.h"
+#include "cellular_service_os.h"
+#include "cellular_service_task.h"
+#include "cellular_datacache.h"
+#include "dc_common.h"
+#include "ipc_uart.h"
+#include "at_core.h"
+#include "at_datapack.h"
+#include "cellular_service_int.h"
+#include "com_sockets_ip_modem.h"
+#include "com_sockets_err_compat.h"
+
+/* Modem link, the BG96 UART is flow controlled and runs at 115200 bauds. */
+#define LINK_BAUD_RATE          ( 115200U )
+
+#define REMOTE_ADDRESS          ( 0x0A000001U )
+#define REMOTE_PORT             ( 7U )
+#define RECEIVE_TIMEOUT_MS      ( 10000U )
+
+#define ECHO_BUFFER_SIZE        ( 8192U )
+
+/* One AT+QISEND and the AT+QISEND chained by one socket send. */
+#define TX_CHUNK_SIZE           ( CONFIG_MODEM_MAX_SOCKET_TX_DATA_SIZE )
+#define TX_BATCH_SIZE           ( CONFIG_MODEM_MAX_SOCKET_TX_DATA_SIZE * CONFIG_MODEM_SOCKET_TX_PIPELINE_DEPTH )
+
+/* The modem is the only device opened on the AT core. */
+#define MODEM_AT_HANDLE         ( ( at_handle_t ) 0 )
+#define ASYNC_MAX_COMMANDS      ( 32U )
+#define ASYNC_TIMEOUT_MS        ( 5000U )
+#define BENCHMARK_LENGTH        ( 8U * 1024U )
+#define POLL_TIMEOUT_MS         ( 2000U )
+#define POLL_ROUNDS             ( 3U )
+#define POLL_MESSAGE_SIZE       ( 100U )
+
+/* Link model of the echo tests, restored before each test. */
+static const char cDefaultScript[] =
+    "# low latency network, no loss\n"
+    "latency 2\n"
+    "qiopen 50\n"
+    "rtt 100\n"
+    "loss 0\n"
+    "sendfail 0\n"
+    "remote echo\n";
+
+/* ============================  GLOBAL VARIABLES =========================== */
+
+dc_com_res_id_t DC_CELLULAR_NIFMAN_INFO = DC_COM_INVALID_ENTRY;
+
+static bool xStackUp = false;
+static uint8_t ucSend[ ECHO_BUFFER_SIZE ];
+static uint8_t ucReceive[ ECHO_BUFFER_SIZE ];
+
+/* Completions of the asynchronous AT commands, in callback order. */
+static uint32_t ulCompleted;
+static uintptr_t uxCompletionOrder[ ASYNC_MAX_COMMANDS ];
+static at_cmd_result_t xCompletionResult[ ASYNC_MAX_COMMANDS ];
+
+/* Background requests of the priority test: socket and completion rank. */
+static int32_t lBulkSock;
+static volatile uint32_t ulBulkDone;
+static volatile uint32_t ulPollingDone;
+static volatile uint32_t ulDoneRank;
+
+/* Task waiting in com_poll_ip_modem() on one socket. */
+typedef struct
+{
+    int32_t lSock;
+    uint32_t ulRounds;
+    bool xDrain;                   /* Read the data once the socket is ready. */
+    volatile uint32_t ulWoken;     /* Polls that returned the socket ready. */
+    volatile int32_t lLastResult;
+    volatile bool xDone;
+} PollerContext_t;
+
+static PollerContext_t xPollers[ COM_SOCKETS_POLL_WAITERS_NB ];
+
+/* ===========================  STACK ENVIRONMENT  ========================== */
+
+/* The cellular service task owns the modem once it is up, it is not part of
+ * the host build. */
+CST_autom_state_t CST_get_state( void )
+{
+    return CST_MODEM_DATA_READY_STATE;
+}
+
+void HAL_UART_RxCpltCallback( UART_HandleTypeDef * UartHandle )
+{
+    if( UartHandle->Instance == MODEM_UART_INSTANCE )
+    {
+        IPC_UART_RxCpltCallback( UartHandle );
+    }
+}
+
+void HAL_UART_TxCpltCallback( UART_HandleTypeDef * UartHandle )
+{
+    if( UartHandle->Instance == MODEM_UART_INSTANCE )
+    {
+        IPC_UART_TxCpltCallback( UartHandle );
+    }
+}
+
+/* Boot the modem and bring the data connection up, as the cellular service
+ * task and the network interface manager do on the target. */
+static void stackStart( void )
+{
+    static dc_nifman_info_t xNifmanInfo;
+    CS_OperatorSelector_t xOperator;
+    CS_RegistrationStatus_t xRegistration;
+    CS_PDN_configuration_t xPdn;
+    int lFd;
+
+    lFd = Bg96Emul_Start( cDefaultScript );
+    TEST_ASSERT_TRUE( lFd >= 0 );
+    HAL_HostUartAttach( MODEM_UART_INSTANCE, lFd, LINK_BAUD_RATE );
+
+    TEST_ASSERT_EQUAL( DC_COM_OK, dc_com_init() );
+    DC_CELLULAR_NIFMAN_INFO = dc_com_register_serv( &dc_com_db, ( void * ) &xNifmanInfo,
+                                                    ( uint16_t ) sizeof( dc_nifman_info_t ) );
+
+    TEST_ASSERT_EQUAL( CELLULAR_OK, CS_init() );
+    TEST_ASSERT_EQUAL( CELLULAR_TRUE, osCDS_cellular_service_init() );
+    TEST_ASSERT_EQUAL( ATSTATUS_OK, atcore_task_start( ATCORE_THREAD_STACK_PRIO, ATCORE_THREAD_STACK_SIZE ) );
+    TEST_ASSERT_TRUE( com_init_ip_modem() );
+    com_start_ip_modem();
+
+    TEST_ASSERT_EQUAL( CELLULAR_OK, osCDS_power_on() );
+    TEST_ASSERT_EQUAL( CELLULAR_OK, osCDS_init_modem( CS_CMI_FULL, CELLULAR_FALSE, ( const CS_CHAR_t * ) "" ) );
+
+    ( void ) memset( &xOperator, 0, sizeof( xOperator ) );
+    xOperator.mode = CS_NRM_AUTO;
+    TEST_ASSERT_EQUAL( CELLULAR_OK, osCDS_register_net( &xOperator, &xRegistration ) );
+    TEST_ASSERT_EQUAL( CELLULAR_OK, osCDS_attach_PS_domain() );
+
+    ( void ) memset( &xPdn, 0, sizeof( xPdn ) );
+    xPdn.pdp_type = CS_PDPTYPE_IP;
+    TEST_ASSERT_EQUAL( CELLULAR_OK, osCDS_define_pdn( CS_PDN_USER_CONFIG_1, ( const CS_CHAR_t * ) "emul", &xPdn ) );
+    TEST_ASSERT_EQUAL( CELLULAR_OK, osCDS_set_default_pdn( CS_PDN_USER_CONFIG_1 ) );
+    TEST_ASSERT_EQUAL( CELLULAR_OK, osCDS_activate_pdn( CS_PDN_CONFIG_DEFAULT ) );
+
+    /* Network interface up: the sockets accept requests. */
+    ( void ) memset( &xNifmanInfo, 0, sizeof( xNifmanInfo ) );
+    xNifmanInfo.rt_state = DC_SERVICE_ON;
+    xNifmanInfo.network = DC_CELLULAR_SOCKET_MODEM;
+    TEST_ASSERT_EQUAL( DC_COM_OK, dc_com_write( &dc_com_db, DC_CELLULAR_NIFMAN_INFO,
+                                                ( void * ) &xNifmanInfo, sizeof( xNifmanInfo ) ) );
+}
+
+/* =============================  SOCKET HELPERS  =========================== */
+
+static int32_t socketOpen( void )
+{
+    com_sockaddr_in_t xAddress;
+    uint32_t ulTimeout = RECEIVE_TIMEOUT_MS;
+    int32_t lSock;
+
+    lSock = com_socket_ip_modem( COM_AF_INET, COM_SOCK_STREAM, COM_IPPROTO_TCP );
+    TEST_ASSERT_TRUE( lSock >= 0 );
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_OK,
+                             com_setsockopt_ip_modem( lSock, COM_SOL_SOCKET, COM_SO_RCVTIMEO,
+                                                      &ulTimeout, ( int32_t ) sizeof( ulTimeout ) ) );
+
+    ( void ) memset( &xAddress, 0, sizeof( xAddress ) );
+    xAddress.sin_len = ( uint8_t ) sizeof( xAddress );
+    xAddress.sin_family = COM_AF_INET;
+    xAddress.sin_port = COM_HTONS( REMOTE_PORT );
+    xAddress.sin_addr.s_addr = COM_HTONL( REMOTE_ADDRESS );
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_OK,
+                             com_connect_ip_modem( lSock, ( const com_sockaddr_t * ) &xAddress,
+                                                   ( int32_t ) sizeof( xAddress ) ) );
+
+    return lSock;
+}
+
+static void fillPattern( uint8_t * pucData,
+                         size_t xLength,
+                         uint32_t ulSeed )
+{
+    size_t i;
+
+    for( i = 0U; i < xLength; i++ )
+    {
+        ulSeed = ( ulSeed * 1103515245U ) + 12345U;
+        pucData[ i ] = ( uint8_t ) ( ulSeed >> 16 );
+    }
+}
+
+/* Receive exactly xLength bytes. */
+static void receiveAll( int32_t lSock,
+                        uint8_t * pucData,
+                        size_t xLength )
+{
+    size_t xReceived = 0U;
+    int32_t lResult;
+
+    while( xReceived < xLength )
+    {
+        lResult = com_recv_ip_modem( lSock, &pucData[ xReceived ],
+                                     ( int32_t ) ( xLength - xReceived ), COM_MSG_WAIT );
+        TEST_ASSERT_TRUE_MESSAGE( lResult > 0, "receive failed" );
+        xReceived += ( size_t ) lResult;
+    }
+}
+
+/* Send then read back xLength bytes through the echo server. */
+static void echo( int32_t lSock,
+                  size_t xLength,
+                  uint32_t ulSeed )
+{
+    fillPattern( ucSend, xLength, ulSeed );
+    TEST_ASSERT_EQUAL_INT32( ( int32_t ) xLength,
+                             com_send_ip_modem( lSock, ucSend, ( int32_t ) xLength, COM_MSG_WAIT ) );
+
+    ( void ) memset( ucReceive, 0, xLength );
+    receiveAll( lSock, ucReceive, xLength );
+    TEST_ASSERT_EQUAL_MEMORY( ucSend, ucReceive, xLength );
+}
+
+static void asyncCompleted( at_handle_t athandle,
+                            const at_cmd_result_t * p_result )
+{
+    ( void ) athandle;
+
+    if( ulCompleted < ASYNC_MAX_COMMANDS )
+    {
+        uxCompletionOrder[ ulCompleted ] = ( uintptr_t ) p_result->p_ctx;
+        xCompletionResult[ ulCompleted ] = *p_result;
+    }
+
+    ulCompleted++;
+}
+
+static void asyncWait( uint32_t ulCount )
+{
+    uint32_t ulWaited = 0U;
+
+    while( ( ulCompleted < ulCount ) && ( ulWaited < ASYNC_TIMEOUT_MS ) )
+    {
+        ( void ) osDelay( 10U );
+        ulWaited += 10U;
+    }
+
+    TEST_ASSERT_EQUAL_UINT32( ulCount, ulCompleted );
+}
+
+/* Large socket send, run in its own thread. */
+static void bulkSendThread( void const * pvArgument )
+{
+    ( void ) pvArgument;
+
+    if( com_send_ip_modem( lBulkSock, ucSend, ( int32_t ) TX_BATCH_SIZE, COM_MSG_WAIT ) == ( int32_t ) TX_BATCH_SIZE )
+    {
+        ulBulkDone = ++ulDoneRank;
+    }
+}
+
+/* Background signal quality polling, run in its own thread. */
+static void signalPollingThread( void const * pvArgument )
+{
+    CS_SignalQuality_t xQuality;
+
+    ( void ) pvArgument;
+
+    if( osCS_get_signal_quality( &xQuality ) == CELLULAR_OK )
+    {
+        ulPollingDone = ++ulDoneRank;
+    }
+}
+
+/* Poll one socket for a number of rounds, run in its own thread. */
+static void pollerThread( void const * pvArgument )
+{
+    PollerContext_t * pxPoller = ( PollerContext_t * ) pvArgument;
+    uint8_t ucData[ 2U * POLL_MESSAGE_SIZE ];
+    com_pollfd_t xFd;
+    uint32_t ulReceived;
+    int32_t lResult;
+    uint32_t i;
+
+    for( i = 0U; i < pxPoller->ulRounds; i++ )
+    {
+        xFd.sock = pxPoller->lSock;
+        xFd.events = COM_POLLIN;
+        pxPoller->lLastResult = com_poll_ip_modem( &xFd, 1U, ASYNC_TIMEOUT_MS );
+
+        if( pxPoller->lLastResult != 1 )
+        {
+            break;
+        }
+
+        ulReceived = 0U;
+
+        while( ( pxPoller->xDrain == true ) && ( ulReceived < POLL_MESSAGE_SIZE ) )
+        {
+            /* More than announced: the read ends the readiness. */
+            lResult = com_recv_ip_modem( pxPoller->lSock, ucData, ( int32_t ) sizeof( ucData ), COM_MSG_DONTWAIT );
+
+            if( lResult <= 0 )
+            {
+                break;
+            }
+
+            ulReceived += ( uint32_t ) lResult;
+        }
+
+        pxPoller->ulWoken++;
+    }
+
+    pxPoller->xDone = true;
+}
+
+static void pollerStart( PollerContext_t * pxPoller,
+                         int32_t lSock,
+                         uint32_t ulRounds,
+                         bool xDrain )
+{
+    osThreadDef( poller, pollerThread, osPriorityNormal, 0, 0 );
+
+    ( void ) memset( pxPoller, 0, sizeof( *pxPoller ) );
+    pxPoller->lSock = lSock;
+    pxPoller->ulRounds = ulRounds;
+    pxPoller->xDrain = xDrain;
+    TEST_ASSERT_NOT_NULL( osThreadCreate( osThread( poller ), pxPoller ) );
+}
+
+/* Wait until a poller has been woken up ulWoken times or has ended. */
+static void pollerWait( const PollerContext_t * pxPoller,
+                        uint32_t ulWoken )
+{
+    uint32_t ulWaited = 0U;
+
+    while( ( pxPoller->ulWoken < ulWoken ) && ( pxPoller->xDone == false ) && ( ulWaited < POLL_TIMEOUT_MS ) )
+    {
+        ( void ) osDelay( 10U );
+        ulWaited += 10U;
+    }
+
+    TEST_ASSERT_EQUAL_UINT32( ulWoken, pxPoller->ulWoken );
+}
+
+static double elapsedMs( const struct timespec * pxStart )
+{
+    struct timespec xEnd;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xEnd );
+
+    return ( ( double ) ( xEnd.tv_sec - pxStart->tv_sec ) * 1000.0 ) +
+           ( ( double ) ( xEnd.tv_nsec - pxStart->tv_nsec ) / 1000000.0 );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+void setUp( void )
+{
+    osHostEnter();
+
+    if( xStackUp == false )
+    {
+        stackStart();
+        xStackUp = true;
+    }
+
+    TEST_ASSERT_TRUE( Bg96Emul_Script( cDefaultScript ) );
+}
+
+void tearDown( void )
+{
+    osHostLeave();
+}
+
+/* ==============================  TEST CASES  ============================== */
+
+/**
+ * @brief Open a socket, echo a short message and close it.
+ */
+void test_Socket_EchoShortMessage( void )
+{
+    Bg96EmulStats_t xBefore;
+    Bg96EmulStats_t xAfter;
+    int32_t lSock;
+    uint32_t i;
+
+    Bg96Emul_GetStats( &xBefore );
+
+    lSock = socketOpen();
+    echo( lSock, 100U, 1U );
+
+    for( i = 0U; i < bg96emulMAX_SOCKETS; i++ )
+    {
+        TEST_ASSERT_EQUAL( 0U, Bg96Emul_Pending( i ) );
+    }
+
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_OK, com_closesocket_ip_modem( lSock ) );
+
+    Bg96Emul_GetStats( &xAfter );
+    TEST_ASSERT_EQUAL_UINT32( xBefore.ulBytesSent + 100U, xAfter.ulBytesSent );
+    TEST_ASSERT_EQUAL_UINT32( xBefore.ulBytesDelivered + 100U, xAfter.ulBytesDelivered );
+    TEST_ASSERT_TRUE( xAfter.ulQisend > xBefore.ulQisend );
+}
+
+/**
+ * @brief A message longer than one AT+QISEND is sent in several chunks and
+ * comes back whole.
+ */
+void test_Socket_EchoSeveralChunks( void )
+{
+    Bg96EmulStats_t xBefore;
+    Bg96EmulStats_t xAfter;
+    int32_t lSock;
+
+    Bg96Emul_GetStats( &xBefore );
+
+    lSock = socketOpen();
+    echo( lSock, 3000U, 2U );
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_OK, com_closesocket_ip_modem( lSock ) );
+
+    Bg96Emul_GetStats( &xAfter );
+    TEST_ASSERT_EQUAL_UINT32( xBefore.ulBytesSent + 3000U, xAfter.ulBytesSent );
+    TEST_ASSERT_TRUE( ( xAfter.ulQisend - xBefore.ulQisend ) >= 3U );
+}
+
+/**
+ * @brief A batch of several AT+QISEND is sent by one socket send and comes
+ * back whole.
+ */
+void test_Socket_SendPipelined( void )
+{
+    Bg96EmulStats_t xBefore;
+    Bg96EmulStats_t xAfter;
+    int32_t lSock;
+
+    lSock = socketOpen();
+    Bg96Emul_GetStats( &xBefore );
+
+    fillPattern( ucSend, TX_BATCH_SIZE, 20U );
+    TEST_ASSERT_EQUAL_INT32( ( int32_t ) TX_BATCH_SIZE,
+                             com_send_ip_modem( lSock, ucSend, ( int32_t ) TX_BATCH_SIZE, COM_MSG_DONTWAIT ) );
+
+    Bg96Emul_GetStats( &xAfter );
+    TEST_ASSERT_EQUAL_UINT32( CONFIG_MODEM_SOCKET_TX_PIPELINE_DEPTH, xAfter.ulQisend - xBefore.ulQisend );
+    TEST_ASSERT_EQUAL_UINT32( TX_BATCH_SIZE, xAfter.ulBytesSent - xBefore.ulBytesSent );
+
+    ( void ) memset( ucReceive, 0, TX_BATCH_SIZE );
+    receiveAll( lSock, ucReceive, TX_BATCH_SIZE );
+    TEST_ASSERT_EQUAL_MEMORY( ucSend, ucReceive, TX_BATCH_SIZE );
+
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_OK, com_closesocket_ip_modem( lSock ) );
+}
+
+/**
+ * @brief A chunk of a batch answered SEND FAIL: the send returns the length
+ * of the chunks sent before it, in both send modes.
+ */
+void test_Socket_SendFailReportsProgress( void )
+{
+    static const uint32_t ulFlags[] = { COM_MSG_DONTWAIT, COM_MSG_WAIT };
+    const size_t xSent = 2U * TX_CHUNK_SIZE;
+    int32_t lSock;
+    uint32_t i;
+
+    lSock = socketOpen();
+
+    for( i = 0U; i < ( sizeof( ulFlags ) / sizeof( ulFlags[ 0 ] ) ); i++ )
+    {
+        TEST_ASSERT_TRUE( Bg96Emul_Script( "sendfail 3\n" ) );
+        fillPattern( ucSend, TX_BATCH_SIZE, 30U + i );
+        TEST_ASSERT_EQUAL_INT32( ( int32_t ) xSent,
+                                 com_send_ip_modem( lSock, ucSend, ( int32_t ) TX_BATCH_SIZE,
+                                                    ( int32_t ) ulFlags[ i ] ) );
+
+        /* Only the chunks reported sent come back. */
+        ( void ) memset( ucReceive, 0, xSent );
+        receiveAll( lSock, ucReceive, xSent );
+        TEST_ASSERT_EQUAL_MEMORY( ucSend, ucReceive, xSent );
+    }
+
+    /* The socket is still usable. */
+    echo( lSock, 300U, 32U );
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_OK, com_closesocket_ip_modem( lSock ) );
+}
+
+/**
+ * @brief Data sent with COM_MSG_MORE on two sockets at the same time is
+ * gathered per socket: one AT+QISEND each, every socket echoes its own data.
+ */
+void test_Socket_SendCoalescedPerSocket( void )
+{
+    Bg96EmulStats_t xBefore;
+    Bg96EmulStats_t xAfter;
+    int32_t lSock[ 2 ];
+    size_t xOffset[ 2 ] = { 0U, ECHO_BUFFER_SIZE / 2U };
+    size_t xLength[ 2 ] = { 0U, 0U };
+    size_t xPart;
+    uint32_t i;
+    uint32_t j;
+
+    lSock[ 0 ] = socketOpen();
+    lSock[ 1 ] = socketOpen();
+    fillPattern( ucSend, ECHO_BUFFER_SIZE, 40U );
+    Bg96Emul_GetStats( &xBefore );
+
+    /* Interleaved partial sends, the last one of each socket without COM_MSG_MORE. */
+    for( i = 0U; i < 3U; i++ )
+    {
+        for( j = 0U; j < 2U; j++ )
+        {
+            xPart = 100U * ( j + 1U );
+            TEST_ASSERT_EQUAL_INT32( ( int32_t ) xPart,
+                                     com_send_ip_modem( lSock[ j ], &ucSend[ xOffset[ j ] + xLength[ j ] ],
+                                                        ( int32_t ) xPart,
+                                                        ( i < 2U ) ? COM_MSG_MORE : COM_MSG_WAIT ) );
+            xLength[ j ] += xPart;
+        }
+
+        if( i < 2U )
+        {
+            Bg96Emul_GetStats( &xAfter );
+            TEST_ASSERT_EQUAL_UINT32( xBefore.ulQisend, xAfter.ulQisend );
+        }
+    }
+
+    Bg96Emul_GetStats( &xAfter );
+    TEST_ASSERT_EQUAL_UINT32( 2U, xAfter.ulQisend - xBefore.ulQisend );
+
+    for( j = 0U; j < 2U; j++ )
+    {
+        ( void ) memset( ucReceive, 0, xLength[ j ] );
+        receiveAll( lSock[ j ], ucReceive, xLength[ j ] );
+        TEST_ASSERT_EQUAL_MEMORY( &ucSend[ xOffset[ j ] ], ucReceive, xLength[ j ] );
+        TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_OK, com_closesocket_ip_modem( lSock[ j ] ) );
+    }
+}
+
+/**
+ * @brief Gathered data that fails to reach the network leaves the socket in
+ * error: the sends that gathered it succeeded, so the next receive and send
+ * return the error until the socket is closed.
+ */
+void test_Socket_SendCoalescedFailureReported( void )
+{
+    int32_t lSock;
+
+    lSock = socketOpen();
+    fillPattern( ucSend, 200U, 50U );
+    TEST_ASSERT_EQUAL_INT32( 100, com_send_ip_modem( lSock, ucSend, 100, COM_MSG_MORE ) );
+    TEST_ASSERT_EQUAL_INT32( 100, com_send_ip_modem( lSock, &ucSend[ 100 ], 100, COM_MSG_MORE ) );
+
+    /* The receive flushes the gathered data, the modem answers SEND FAIL. */
+    TEST_ASSERT_TRUE( Bg96Emul_Script( "sendfail 1\n" ) );
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_GENERAL,
+                             com_recv_ip_modem( lSock, ucReceive, 200, COM_MSG_DONTWAIT ) );
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_GENERAL,
+                             com_send_ip_modem( lSock, ucSend, 100, COM_MSG_WAIT ) );
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_GENERAL,
+                             com_recv_ip_modem( lSock, ucReceive, 200, COM_MSG_WAIT ) );
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_OK, com_closesocket_ip_modem( lSock ) );
+
+    /* A new socket starts without error. */
+    lSock = socketOpen();
+    echo( lSock, 100U, 51U );
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_OK, com_closesocket_ip_modem( lSock ) );
+}
+
+/**
+ * @brief Lost segments are retransmitted by the network: the data arrives
+ * late but complete.
+ */
+void test_Socket_EchoWithLoss( void )
+{
+    Bg96EmulStats_t xBefore;
+    Bg96EmulStats_t xAfter;
+    int32_t lSock;
+    uint32_t i;
+
+    TEST_ASSERT_TRUE( Bg96Emul_Script( "rtt 300\nloss 50\nrto 500\nseed 7\n" ) );
+    Bg96Emul_GetStats( &xBefore );
+
+    lSock = socketOpen();
+
+    for( i = 0U; i < 4U; i++ )
+    {
+        echo( lSock, 200U, 10U + i );
+    }
+
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_OK, com_closesocket_ip_modem( lSock ) );
+
+    Bg96Emul_GetStats( &xAfter );
+    TEST_ASSERT_EQUAL_UINT32( xBefore.ulBytesDelivered + 800U, xAfter.ulBytesDelivered );
+    TEST_ASSERT_TRUE( xAfter.ulRetransmissions > xBefore.ulRetransmissions );
+}
+
+/**
+ * @brief Unsolicited codes from the script are absorbed while a socket is
+ * in use.
+ */
+void test_Socket_EchoWithUnsolicitedCodes( void )
+{
+    int32_t lSock;
+
+    lSock = socketOpen();
+    TEST_ASSERT_TRUE( Bg96Emul_Script( "urc 0 +CEREG: 1\nurc 20 +CSQ: 15,99\n" ) );
+    echo( lSock, 500U, 3U );
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_OK, com_closesocket_ip_modem( lSock ) );
+}
+
+/**
+ * @brief One poll over two sockets wakes up on the data ready URC of the
+ * socket the echo comes back on, and readiness ends once the data is read.
+ */
+void test_Socket_PollWakesOnDataReady( void )
+{
+    com_pollfd_t xFds[ 2 ];
+    struct timespec xStart;
+    double dMs;
+    int32_t lSockA;
+    int32_t lSockB;
+
+    lSockA = socketOpen();
+    lSockB = socketOpen();
+
+    xFds[ 0 ].sock = lSockA;
+    xFds[ 0 ].events = COM_POLLIN;
+    xFds[ 1 ].sock = lSockB;
+    xFds[ 1 ].events = COM_POLLIN;
+
+    /* Nothing sent yet: the poll times out. */
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xStart );
+    TEST_ASSERT_EQUAL_INT32( 0, com_poll_ip_modem( xFds, 2U, 50U ) );
+    TEST_ASSERT_TRUE( elapsedMs( &xStart ) >= 45.0 );
+    TEST_ASSERT_EQUAL_INT16( 0, xFds[ 0 ].revents );
+    TEST_ASSERT_EQUAL_INT16( 0, xFds[ 1 ].revents );
+
+    /* The echo on the second socket wakes the poll up within the round trip. */
+    fillPattern( ucSend, 100U, 4U );
+    TEST_ASSERT_EQUAL_INT32( 100, com_send_ip_modem( lSockB, ucSend, 100, COM_MSG_WAIT ) );
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xStart );
+    TEST_ASSERT_EQUAL_INT32( 1, com_poll_ip_modem( xFds, 2U, POLL_TIMEOUT_MS ) );
+    dMs = elapsedMs( &xStart );
+    TEST_ASSERT_EQUAL_INT16( 0, xFds[ 0 ].revents );
+    TEST_ASSERT_EQUAL_INT16( COM_POLLIN, xFds[ 1 ].revents );
+    TEST_ASSERT_TRUE( dMs < ( double ) POLL_TIMEOUT_MS );
+
+    /* The data is there: a non blocking receive gets all of it. */
+    ( void ) memset( ucReceive, 0, 100U );
+    TEST_ASSERT_EQUAL_INT32( 100, com_recv_ip_modem( lSockB, ucReceive, ( int32_t ) ECHO_BUFFER_SIZE,
+                                                     COM_MSG_DONTWAIT ) );
+    TEST_ASSERT_EQUAL_MEMORY( ucSend, ucReceive, 100U );
+    TEST_ASSERT_EQUAL_INT32( 0, com_poll_ip_modem( xFds, 2U, 0U ) );
+
+    printf( "cellular_stack: poll woken up %.1f ms after send\n", dMs );
+
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_OK, com_closesocket_ip_modem( lSockA ) );
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_OK, com_closesocket_ip_modem( lSockB ) );
+}
+
+/**
+ * @brief Data gathered with COM_MSG_MORE is sent before the poll waits, so
+ * the poll wakes up on the echo; a failed send raises COM_POLLERR.
+ */
+void test_Socket_PollFlushesGatheredData( void )
+{
+    com_pollfd_t xFd;
+    int32_t lSock;
+
+    lSock = socketOpen();
+    xFd.sock = lSock;
+    xFd.events = COM_POLLIN;
+
+    fillPattern( ucSend, 200U, 6U );
+    TEST_ASSERT_EQUAL_INT32( 200, com_send_ip_modem( lSock, ucSend, 200, COM_MSG_MORE ) );
+    TEST_ASSERT_EQUAL_INT32( 1, com_poll_ip_modem( &xFd, 1U, POLL_TIMEOUT_MS ) );
+    TEST_ASSERT_EQUAL_INT16( COM_POLLIN, xFd.revents );
+    receiveAll( lSock, ucReceive, 200U );
+    TEST_ASSERT_EQUAL_MEMORY( ucSend, ucReceive, 200U );
+
+    TEST_ASSERT_EQUAL_INT32( 100, com_send_ip_modem( lSock, ucSend, 100, COM_MSG_MORE ) );
+    TEST_ASSERT_TRUE( Bg96Emul_Script( "sendfail 1\n" ) );
+    TEST_ASSERT_EQUAL_INT32( 1, com_poll_ip_modem( &xFd, 1U, POLL_TIMEOUT_MS ) );
+    TEST_ASSERT_BITS_HIGH( COM_POLLERR, xFd.revents );
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_GENERAL,
+                             com_recv_ip_modem( lSock, ucReceive, 100, COM_MSG_DONTWAIT ) );
+
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_OK, com_closesocket_ip_modem( lSock ) );
+}
+
+/**
+ * @brief A read that fills the application buffer leaves the socket ready
+ * for the rest of the data.
+ */
+void test_Socket_PollReadyAfterPartialRead( void )
+{
+    com_pollfd_t xFd;
+    int32_t lSock;
+
+    lSock = socketOpen();
+    xFd.sock = lSock;
+    xFd.events = COM_POLLIN;
+
+    fillPattern( ucSend, 300U, 5U );
+    TEST_ASSERT_EQUAL_INT32( 300, com_send_ip_modem( lSock, ucSend, 300, COM_MSG_WAIT ) );
+    TEST_ASSERT_EQUAL_INT32( 1, com_poll_ip_modem( &xFd, 1U, POLL_TIMEOUT_MS ) );
+
+    TEST_ASSERT_EQUAL_INT32( 100, com_recv_ip_modem( lSock, ucReceive, 100, COM_MSG_DONTWAIT ) );
+    TEST_ASSERT_EQUAL_INT32( 1, com_poll_ip_modem( &xFd, 1U, 0U ) );
+    TEST_ASSERT_EQUAL_INT16( COM_POLLIN, xFd.revents );
+
+    receiveAll( lSock, &ucReceive[ 100 ], 200U );
+    TEST_ASSERT_EQUAL_MEMORY( ucSend, ucReceive, 300U );
+
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_OK, com_closesocket_ip_modem( lSock ) );
+}
+
+/**
+ * @brief A remote close and an unknown socket are reported without waiting.
+ */
+void test_Socket_PollHangupAndInvalid( void )
+{
+    com_pollfd_t xFds[ 2 ];
+    char cScript[ 64 ];
+    int32_t lSock;
+
+    lSock = socketOpen();
+
+    /* The driver gives socket handle n the modem connection id n + 1. */
+    ( void ) snprintf( cScript, sizeof( cScript ), "urc 10 +QIURC: \"closed\",%d\n", ( int ) lSock + 1 );
+    TEST_ASSERT_TRUE( Bg96Emul_Script( cScript ) );
+
+    xFds[ 0 ].sock = lSock;
+    xFds[ 0 ].events = COM_POLLIN;
+    xFds[ 1 ].sock = lSock + 1;
+    xFds[ 1 ].events = COM_POLLIN;
+
+    TEST_ASSERT_EQUAL_INT32( 1, com_poll_ip_modem( xFds, 1U, POLL_TIMEOUT_MS ) );
+    TEST_ASSERT_EQUAL_INT16( COM_POLLHUP, xFds[ 0 ].revents );
+
+    TEST_ASSERT_EQUAL_INT32( 2, com_poll_ip_modem( xFds, 2U, POLL_TIMEOUT_MS ) );
+    TEST_ASSERT_EQUAL_INT16( COM_POLLNVAL, xFds[ 1 ].revents );
+
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_PARAMETER, com_poll_ip_modem( NULL, 1U, 0U ) );
+
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_OK, com_closesocket_ip_modem( lSock ) );
+}
+
+/**
+ * @brief Two tasks polling their own socket are each woken up by their own
+ * data, whichever socket the data ready URC before was for.
+ */
+void test_Socket_PollConcurrentWaiters( void )
+{
+    PollerContext_t * pxPollerA = &xPollers[ 0 ];
+    PollerContext_t * pxPollerB = &xPollers[ 1 ];
+    int32_t lSockA;
+    int32_t lSockB;
+    uint32_t i;
+
+    lSockA = socketOpen();
+    lSockB = socketOpen();
+    fillPattern( ucSend, POLL_MESSAGE_SIZE, 7U );
+
+    pollerStart( pxPollerA, lSockA, POLL_ROUNDS + 1U, true );
+    pollerStart( pxPollerB, lSockB, POLL_ROUNDS + 1U, true );
+    ( void ) osDelay( 50U );
+
+    /* The data for one socket wakes up its poller only, the other one keeps
+     * waiting for its own data. */
+    for( i = 0U; i < POLL_ROUNDS; i++ )
+    {
+        TEST_ASSERT_EQUAL_INT32( ( int32_t ) POLL_MESSAGE_SIZE,
+                                 com_send_ip_modem( lSockA, ucSend, ( int32_t ) POLL_MESSAGE_SIZE, COM_MSG_WAIT ) );
+        pollerWait( pxPollerA, i + 1U );
+        TEST_ASSERT_EQUAL_UINT32( i, pxPollerB->ulWoken );
+
+        TEST_ASSERT_EQUAL_INT32( ( int32_t ) POLL_MESSAGE_SIZE,
+                                 com_send_ip_modem( lSockB, ucSend, ( int32_t ) POLL_MESSAGE_SIZE, COM_MSG_WAIT ) );
+        pollerWait( pxPollerB, i + 1U );
+        TEST_ASSERT_EQUAL_UINT32( i + 1U, pxPollerA->ulWoken );
+    }
+
+    /* Data for both sockets at once wakes up both pollers. */
+    TEST_ASSERT_EQUAL_INT32( ( int32_t ) POLL_MESSAGE_SIZE,
+                             com_send_ip_modem( lSockA, ucSend, ( int32_t ) POLL_MESSAGE_SIZE, COM_MSG_WAIT ) );
+    TEST_ASSERT_EQUAL_INT32( ( int32_t ) POLL_MESSAGE_SIZE,
+                             com_send_ip_modem( lSockB, ucSend, ( int32_t ) POLL_MESSAGE_SIZE, COM_MSG_WAIT ) );
+    pollerWait( pxPollerA, POLL_ROUNDS + 1U );
+    pollerWait( pxPollerB, POLL_ROUNDS + 1U );
+    TEST_ASSERT_TRUE( pxPollerA->xDone );
+    TEST_ASSERT_TRUE( pxPollerB->xDone );
+
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_OK, com_closesocket_ip_modem( lSockA ) );
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_OK, com_closesocket_ip_modem( lSockB ) );
+}
+
+/**
+ * @brief Once all the waiter slots are taken, an additional task can only
+ * check readiness, and every waiting task is woken up by the data.
+ */
+void test_Socket_PollWaitersBounded( void )
+{
+    com_pollfd_t xFd;
+    int32_t lSock;
+    uint32_t i;
+
+    lSock = socketOpen();
+    xFd.sock = lSock;
+    xFd.events = COM_POLLIN;
+
+    for( i = 0U; i < COM_SOCKETS_POLL_WAITERS_NB; i++ )
+    {
+        pollerStart( &xPollers[ i ], lSock, 1U, false );
+    }
+
+    ( void ) osDelay( 50U );
+
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_NOMEMORY, com_poll_ip_modem( &xFd, 1U, 50U ) );
+    TEST_ASSERT_EQUAL_INT32( 0, com_poll_ip_modem( &xFd, 1U, 0U ) );
+
+    fillPattern( ucSend, POLL_MESSAGE_SIZE, 8U );
+    TEST_ASSERT_EQUAL_INT32( ( int32_t ) POLL_MESSAGE_SIZE,
+                             com_send_ip_modem( lSock, ucSend, ( int32_t ) POLL_MESSAGE_SIZE, COM_MSG_WAIT ) );
+
+    for( i = 0U; i < COM_SOCKETS_POLL_WAITERS_NB; i++ )
+    {
+        pollerWait( &xPollers[ i ], 1U );
+        TEST_ASSERT_EQUAL_INT32( 1, xPollers[ i ].lLastResult );
+    }
+
+    /* The slots are free again. */
+    TEST_ASSERT_EQUAL_INT32( 1, com_poll_ip_modem( &xFd, 1U, POLL_TIMEOUT_MS ) );
+    receiveAll( lSock, ucReceive, POLL_MESSAGE_SIZE );
+    TEST_ASSERT_EQUAL_MEMORY( ucSend, ucReceive, POLL_MESSAGE_SIZE );
+
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_OK, com_closesocket_ip_modem( lSock ) );
+}
+
+/**
+ * @brief Commands queued together complete highest priority first, with
+ * their queueing and execution latency reported.
+ */
+void test_AtCore_AsyncPriorityOrder( void )
+{
+    static at_buf_t ucCmdLow[ ATCMD_MAX_BUF_SIZE ];
+    static at_buf_t ucCmdNone[ ATCMD_MAX_BUF_SIZE ];
+    static at_buf_t ucRspLow[ ATCMD_MAX_BUF_SIZE ];
+    static at_buf_t ucRspNormal[ ATCMD_MAX_BUF_SIZE ];
+    static at_buf_t ucRspHigh[ ATCMD_MAX_BUF_SIZE ];
+    CS_SignalQuality_t xQuality;
+    at_cmd_stats_t xLowBefore;
+    at_cmd_stats_t xLowAfter;
+
+    TEST_ASSERT_TRUE( Bg96Emul_Script( "latency 20\n" ) );
+    TEST_ASSERT_EQUAL( ATSTATUS_OK, AT_getcmdstats( ATCMD_PRIO_LOW, &xLowBefore ) );
+
+    ( void ) memset( &xQuality, 0, sizeof( xQuality ) );
+    TEST_ASSERT_EQUAL( DATAPACK_OK, DATAPACK_writePtr( ucCmdLow, ( uint16_t ) CSMT_SIGNAL_QUALITY, &xQuality ) );
+    TEST_ASSERT_EQUAL( DATAPACK_OK, DATAPACK_writeStruct( ucCmdNone, ( uint16_t ) CSMT_NONE, 0U, NULL ) );
+
+    /* The command thread only runs once this thread blocks, so the three
+     * commands are all waiting when it picks the first one. */
+    ulCompleted = 0U;
+    TEST_ASSERT_EQUAL( ATSTATUS_OK, AT_sendcmd_async( MODEM_AT_HANDLE, ( at_msg_t ) SID_CS_GET_SIGNAL_QUALITY,
+                                                      ucCmdLow, ucRspLow, ATCMD_PRIO_LOW,
+                                                      asyncCompleted, ( void * ) ATCMD_PRIO_LOW ) );
+    TEST_ASSERT_EQUAL( ATSTATUS_OK, AT_sendcmd_async( MODEM_AT_HANDLE, ( at_msg_t ) SID_CS_CHECK_CNX,
+                                                      ucCmdNone, ucRspNormal, ATCMD_PRIO_NORMAL,
+                                                      asyncCompleted, ( void * ) ATCMD_PRIO_NORMAL ) );
+    TEST_ASSERT_EQUAL( ATSTATUS_OK, AT_sendcmd_async( MODEM_AT_HANDLE, ( at_msg_t ) SID_CS_GET_ATTACHSTATUS,
+                                                      ucCmdNone, ucRspHigh, ATCMD_PRIO_HIGH,
+                                                      asyncCompleted, ( void * ) ATCMD_PRIO_HIGH ) );
+    asyncWait( 3U );
+
+    TEST_ASSERT_EQUAL( ATCMD_PRIO_HIGH, uxCompletionOrder[ 0 ] );
+    TEST_ASSERT_EQUAL( ATCMD_PRIO_NORMAL, uxCompletionOrder[ 1 ] );
+    TEST_ASSERT_EQUAL( ATCMD_PRIO_LOW, uxCompletionOrder[ 2 ] );
+    TEST_ASSERT_EQUAL( ATSTATUS_OK, xCompletionResult[ 0 ].status );
+    TEST_ASSERT_EQUAL( ATSTATUS_OK, xCompletionResult[ 1 ].status );
+    TEST_ASSERT_EQUAL( ATSTATUS_OK, xCompletionResult[ 2 ].status );
+    TEST_ASSERT_EQUAL( SID_CS_GET_SIGNAL_QUALITY, xCompletionResult[ 2 ].msg_id );
+    TEST_ASSERT_EQUAL_UINT8( 20U, xQuality.rssi );
+
+    /* Each command waits for the transactions queued ahead of it. */
+    TEST_ASSERT_TRUE( xCompletionResult[ 0 ].exec_ms >= 20U );
+    TEST_ASSERT_TRUE( xCompletionResult[ 2 ].queued_ms >=
+                      ( xCompletionResult[ 0 ].exec_ms + xCompletionResult[ 1 ].exec_ms ) );
+
+    TEST_ASSERT_EQUAL( ATSTATUS_OK, AT_getcmdstats( ATCMD_PRIO_LOW, &xLowAfter ) );
+    TEST_ASSERT_EQUAL_UINT32( xLowBefore.count + 1U, xLowAfter.count );
+    TEST_ASSERT_TRUE( xLowAfter.max_queued_ms >= xCompletionResult[ 2 ].queued_ms );
+
+    /* The synchronous path still works behind the queue. */
+    TEST_ASSERT_EQUAL( CELLULAR_OK, osCS_get_signal_quality( &xQuality ) );
+}
+
+/**
+ * @brief Through the whole stack, a socket transfer requested while the
+ * signal quality polling is waiting for the modem goes first: a receive is
+ * not held by a send in progress on another socket.
+ */
+void test_AtCore_SocketDataOvertakesPolling( void )
+{
+    osThreadDef( bulkSend, bulkSendThread, osPriorityNormal, 0, 0 );
+    osThreadDef( signalPolling, signalPollingThread, osPriorityNormal, 0, 0 );
+    uint8_t * pucSmall = &ucSend[ TX_BATCH_SIZE ];
+    at_cmd_stats_t xLowBefore;
+    at_cmd_stats_t xLowAfter;
+    com_pollfd_t xFd;
+    uint32_t ulSmallDone;
+    uint32_t ulWaited = 0U;
+    int32_t lSmallSock;
+
+    lBulkSock = socketOpen();
+    lSmallSock = socketOpen();
+    fillPattern( ucSend, TX_BATCH_SIZE + 100U, 60U );
+
+    /* The echo of a small message waits in the modem. */
+    TEST_ASSERT_EQUAL_INT32( 100, com_send_ip_modem( lSmallSock, pucSmall, 100, COM_MSG_WAIT ) );
+    xFd.sock = lSmallSock;
+    xFd.events = COM_POLLIN;
+    TEST_ASSERT_EQUAL_INT32( 1, com_poll_ip_modem( &xFd, 1U, POLL_TIMEOUT_MS ) );
+
+    ulBulkDone = 0U;
+    ulPollingDone = 0U;
+    ulDoneRank = 0U;
+    TEST_ASSERT_EQUAL( ATSTATUS_OK, AT_getcmdstats( ATCMD_PRIO_LOW, &xLowBefore ) );
+
+    /* The batch keeps the modem busy, the polling queues behind it, then the
+     * echo is read on another socket. */
+    TEST_ASSERT_NOT_NULL( osThreadCreate( osThread( bulkSend ), NULL ) );
+    ( void ) osDelay( 50U );
+    TEST_ASSERT_NOT_NULL( osThreadCreate( osThread( signalPolling ), NULL ) );
+    ( void ) osDelay( 50U );
+    ( void ) memset( ucReceive, 0, 100U );
+    TEST_ASSERT_EQUAL_INT32( 100, com_recv_ip_modem( lSmallSock, ucReceive, 100, COM_MSG_DONTWAIT ) );
+    ulSmallDone = ++ulDoneRank;
+    TEST_ASSERT_EQUAL_MEMORY( pucSmall, ucReceive, 100U );
+
+    while( ( ( ulBulkDone == 0U ) || ( ulPollingDone == 0U ) ) && ( ulWaited < ASYNC_TIMEOUT_MS ) )
+    {
+        ( void ) osDelay( 10U );
+        ulWaited += 10U;
+    }
+
+    TEST_ASSERT_EQUAL_UINT32( 1U, ulBulkDone );
+    TEST_ASSERT_EQUAL_UINT32( 2U, ulSmallDone );
+    TEST_ASSERT_EQUAL_UINT32( 3U, ulPollingDone );
+
+    /* The polling waited for both transfers. */
+    TEST_ASSERT_EQUAL( ATSTATUS_OK, AT_getcmdstats( ATCMD_PRIO_LOW, &xLowAfter ) );
+    TEST_ASSERT_EQUAL_UINT32( xLowBefore.count + 1U, xLowAfter.count );
+
+    ( void ) memset( ucReceive, 0, TX_BATCH_SIZE );
+    receiveAll( lBulkSock, ucReceive, TX_BATCH_SIZE );
+    TEST_ASSERT_EQUAL_MEMORY( ucSend, ucReceive, TX_BATCH_SIZE );
+
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_OK, com_closesocket_ip_modem( lBulkSock ) );
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_OK, com_closesocket_ip_modem( lSmallSock ) );
+}
+
+/**
+ * @brief A full command queue refuses new submissions and every accepted
+ * command still completes.
+ */
+void test_AtCore_AsyncQueueFull( void )
+{
+    static at_buf_t ucCmd[ ATCMD_MAX_BUF_SIZE ];
+    static at_buf_t ucRsp[ ATCMD_MAX_BUF_SIZE ];
+    at_status_t xStatus = ATSTATUS_OK;
+    uint32_t ulAccepted = 0U;
+
+    TEST_ASSERT_EQUAL( DATAPACK_OK, DATAPACK_writeStruct( ucCmd, ( uint16_t ) CSMT_NONE, 0U, NULL ) );
+
+    ulCompleted = 0U;
+
+    while( ( xStatus == ATSTATUS_OK ) && ( ulAccepted < ASYNC_MAX_COMMANDS ) )
+    {
+        xStatus = AT_sendcmd_async( MODEM_AT_HANDLE, ( at_msg_t ) SID_CS_CHECK_CNX, ucCmd, ucRsp,
+                                    ATCMD_PRIO_NORMAL, asyncCompleted, ( void * ) ( uintptr_t ) ulAccepted );
+
+        if( xStatus == ATSTATUS_OK )
+        {
+            ulAccepted++;
+        }
+    }
+
+    TEST_ASSERT_EQUAL( ATSTATUS_ERROR, xStatus );
+    TEST_ASSERT_TRUE( ulAccepted > 1U );
+    asyncWait( ulAccepted );
+    TEST_ASSERT_EQUAL( 0U, uxCompletionOrder[ 0 ] );
+    TEST_ASSERT_EQUAL( ulAccepted - 1U, uxCompletionOrder[ ulAccepted - 1U ] );
+}
+
+/**
+ * @brief Echo throughput and AT command count over the emulated link. The
+ * figures are printed for comparison between revisions.
+ */
+void test_Benchmark_EchoThroughput( void )
+{
+    static const size_t xMessageLengths[] = { 64U, 512U, 1460U, 4096U };
+    Bg96EmulStats_t xBefore;
+    Bg96EmulStats_t xAfter;
+    struct timespec xStart;
+    double dMs;
+    size_t xLength;
+    size_t xDone;
+    int32_t lSock;
+    uint32_t i;
+
+    TEST_ASSERT_TRUE( Bg96Emul_Script( "rtt 50\n" ) );
+    lSock = socketOpen();
+
+    for( i = 0U; i < ( sizeof( xMessageLengths ) / sizeof( xMessageLengths[ 0 ] ) ); i++ )
+    {
+        xLength = xMessageLengths[ i ];
+        Bg96Emul_GetStats( &xBefore );
+        ( void ) clock_gettime( CLOCK_MONOTONIC, &xStart );
+
+        for( xDone = 0U; xDone < BENCHMARK_LENGTH; xDone += xLength )
+        {
+            echo( lSock, xLength, ( uint32_t ) xDone );
+        }
+
+        dMs = elapsedMs( &xStart );
+        Bg96Emul_GetStats( &xAfter );
+
+        printf( "cellular_stack: echo %4u bytes: %7.1f bytes/s, %5.1f ms per echo, %4u AT commands\n",
+                ( unsigned ) xLength,
+                ( ( double ) xDone * 1000.0 ) / dMs,
+                ( dMs * ( double ) xLength ) / ( double ) xDone,
+                ( unsigned ) ( xAfter.ulCommands - xBefore.ulCommands ) );
+    }
+
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_OK, com_closesocket_ip_modem( lSock ) );
+}
+
+/**
+ * @brief Send throughput of one socket send per AT+QISEND against one socket
+ * send per batch of chained AT+QISEND. The figures are printed for comparison
+ * between revisions.
+ */
+void test_Benchmark_SendPipelining( void )
+{
+    static const size_t xSendLengths[] = { TX_CHUNK_SIZE, TX_BATCH_SIZE };
+    Bg96EmulStats_t xBefore;
+    Bg96EmulStats_t xAfter;
+    struct timespec xStart;
+    double dMs;
+    size_t xLength;
+    size_t xDone;
+    int32_t lSock;
+    uint32_t i;
+
+    TEST_ASSERT_TRUE( Bg96Emul_Script( "latency 20\nremote sink\n" ) );
+    lSock = socketOpen();
+    fillPattern( ucSend, TX_BATCH_SIZE, 50U );
+
+    for( i = 0U; i < ( sizeof( xSendLengths ) / sizeof( xSendLengths[ 0 ] ) ); i++ )
+    {
+        xLength = xSendLengths[ i ];
+        Bg96Emul_GetStats( &xBefore );
+        ( void ) clock_gettime( CLOCK_MONOTONIC, &xStart );
+
+        for( xDone = 0U; xDone < ( 4U * TX_BATCH_SIZE ); xDone += xLength )
+        {
+            TEST_ASSERT_EQUAL_INT32( ( int32_t ) xLength,
+                                     com_send_ip_modem( lSock, ucSend, ( int32_t ) xLength, COM_MSG_WAIT ) );
+        }
+
+        dMs = elapsedMs( &xStart );
+        Bg96Emul_GetStats( &xAfter );
+        TEST_ASSERT_EQUAL_UINT32( xDone, xAfter.ulBytesSent - xBefore.ulBytesSent );
+
+        printf( "cellular_stack: send %4u bytes per call: %7.1f bytes/s, %4u AT+QISEND\n",
+                ( unsigned ) xLength,
+                ( ( double ) xDone * 1000.0 ) / dMs,
+                ( unsigned ) ( xAfter.ulQisend - xBefore.ulQisend ) );
+    }
+
+    TEST_ASSERT_EQUAL_INT32( COM_SOCKETS_ERR_OK, com_closesocket_ip_modem( lSock ) );
+}
@@ -0,0 +1,539 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+
+#include "flash_writer.h"
+
+/* Geometry of the simulated flash: STM32L4 pages. */
+#define PAGE_SIZE                ( 2048U )
+#define PAGE_COUNT               ( 16U )
+#define REGION_SIZE              ( PAGE_SIZE * PAGE_COUNT )
+
+/* STM32L4 datasheet, typical: double word programming, page erase. */
+#define PROGRAM_TIME_US          ( 82U )
+#define ERASE_TIME_US            ( 22020U )
+
+/* Layout of the PKCS #11 objects of the board: three 2 KB objects followed
+ * by their 32-bit presence marks. */
+#define OBJECT_SIZE              ( 2048U )
+#define MARKS_OFFSET             ( 3U * OBJECT_SIZE )
+
+/* ============================  GLOBAL VARIABLES =========================== */
+
+static uint64_t ullFlash[ REGION_SIZE / sizeof( uint64_t ) ];
+static uint8_t * const pucFlash = ( uint8_t * ) ullFlash;
+
+/* What the flash should hold once the writer is flushed. */
+static uint8_t ucReference[ REGION_SIZE ];
+
+static uint32_t ulEraseOps;
+static uint32_t ulProgramOps;
+static uint32_t ulProgramCalls;
+static uint32_t ulProgramViolations;
+static bool xFailErase;
+
+/* Simulated time in microseconds, advanced by the flash operations. */
+static uint32_t ulNowUs;
+
+static FlashWriter_t xWriter;
+
+/* ===========================  Flash simulator  ============================ */
+
+static int32_t simErase( void * pvContext,
+                         uint32_t ulOffset )
+{
+    TEST_ASSERT_EQUAL_PTR( ullFlash, pvContext );
+    TEST_ASSERT_EQUAL( 0, ulOffset % PAGE_SIZE );
+    TEST_ASSERT_LESS_THAN( REGION_SIZE, ulOffset );
+
+    if( xFailErase == true )
+    {
+        return -1;
+    }
+
+    memset( &pucFlash[ ulOffset ], 0xFF, PAGE_SIZE );
+    ulEraseOps++;
+    ulNowUs += ERASE_TIME_US;
+
+    return 0;
+}
+
+static int32_t simProgram( void * pvContext,
+                           uint32_t ulOffset,
+                           const void * pvData,
+                           uint32_t ulLength )
+{
+    const uint8_t * pucData = pvData;
+    uint32_t i, j;
+
+    TEST_ASSERT_EQUAL_PTR( ullFlash, pvContext );
+    TEST_ASSERT_EQUAL( 0, ulOffset % flashwriterPROGRAM_UNIT );
+    TEST_ASSERT_EQUAL( 0, ulLength % flashwriterPROGRAM_UNIT );
+    TEST_ASSERT_EQUAL( 0, ( uintptr_t ) pvData % flashwriterPROGRAM_UNIT );
+    TEST_ASSERT_NOT_EQUAL( 0, ulLength );
+
+    /* A program never crosses a page. */
+    TEST_ASSERT_EQUAL( ulOffset / PAGE_SIZE, ( ulOffset + ulLength - 1U ) / PAGE_SIZE );
+
+    ulProgramCalls++;
+
+    for( i = 0; i < ulLength; i += flashwriterPROGRAM_UNIT )
+    {
+        /* Like the L4 controller, refuse to program a used double word. */
+        for( j = 0; j < flashwriterPROGRAM_UNIT; j++ )
+        {
+            if( pucFlash[ ulOffset + i + j ] != 0xFFU )
+            {
+                ulProgramViolations++;
+
+                return -1;
+            }
+        }
+
+        memcpy( &pucFlash[ ulOffset + i ], &pucData[ i ], flashwriterPROGRAM_UNIT );
+        ulProgramOps++;
+        ulNowUs += PROGRAM_TIME_US;
+    }
+
+    return 0;
+}
+
+static uint32_t simTimestamp( void )
+{
+    return ulNowUs;
+}
+
+static const FlashWriterFlash_t xSimFlash =
+{
+    .pucBase      = ( const volatile uint8_t * ) ullFlash,
+    .ulPageSize   = PAGE_SIZE,
+    .ulPageCount  = PAGE_COUNT,
+    .xErase       = simErase,
+    .xProgram     = simProgram,
+    .xTimestamp   = simTimestamp,
+    .ulTicksPerUs = 1,
+    .pvContext    = ullFlash
+};
+
+/* ==========================  Helper functions  ============================ */
+
+static void fillPattern( uint8_t * pucData,
+                         size_t xLength,
+                         uint32_t ulSeed )
+{
+    size_t i;
+
+    for( i = 0; i < xLength; i++ )
+    {
+        pucData[ i ] = ( uint8_t ) ( ( i * 7U ) + ulSeed );
+    }
+}
+
+/* FLASH_update() of the board, written through. */
+static void update( uint32_t ulOffset,
+                    const void * pvData,
+                    uint32_t ulLength )
+{
+    TEST_ASSERT_EQUAL_INT32( 0, FlashWriter_Write( &xWriter, ulOffset, pvData, ulLength ) );
+    TEST_ASSERT_EQUAL_INT32( 0, FlashWriter_Flush( &xWriter ) );
+    memcpy( &ucReference[ ulOffset ], pvData, ulLength );
+}
+
+static void resetCounters( void )
+{
+    ulEraseOps = 0;
+    ulProgramOps = 0;
+    ulProgramCalls = 0;
+}
+
+static const FlashWriterPageStats_t * findStats( FlashWriterPageStats_t * pxStats,
+                                                 size_t xCount,
+                                                 uint32_t ulPage )
+{
+    size_t i;
+
+    for( i = 0; i < xCount; i++ )
+    {
+        if( pxStats[ i ].ulPage == ulPage )
+        {
+            return &pxStats[ i ];
+        }
+    }
+
+    TEST_FAIL_MESSAGE( "No statistics for the page" );
+
+    return NULL;
+}
+
+/* The legacy FLASH_update(): read, erase and reprogram every page touched. */
+static uint32_t legacyUpdateUs( uint32_t ulOffset,
+                                uint32_t ulLength )
+{
+    uint32_t ulPages = ( ( ulOffset + ulLength - 1U ) / PAGE_SIZE ) - ( ulOffset / PAGE_SIZE ) + 1U;
+
+    return ulPages * ( ERASE_TIME_US + ( ( PAGE_SIZE / flashwriterPROGRAM_UNIT ) * PROGRAM_TIME_US ) );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+void setUp( void )
+{
+    memset( ullFlash, 0xFF, sizeof( ullFlash ) );
+    memset( ucReference, 0xFF, sizeof( ucReference ) );
+    resetCounters();
+    ulProgramViolations = 0;
+    ulNowUs = 0;
+    xFailErase = false;
+    srand( 1 );
+    TEST_ASSERT_TRUE( FlashWriter_Init( &xWriter, &xSimFlash ) );
+}
+
+/* called before each testcase */
+void tearDown( void )
+{
+    TEST_ASSERT_EQUAL_UINT32( 0, ulProgramViolations );
+}
+
+/* called at the beginning of the whole suite */
+void suiteSetUp()
+{
+}
+
+/* called at the end of the whole suite */
+int suiteTearDown( int numFailures )
+{
+    return( numFailures > 0 );
+}
+
+/* ========================  TESTING FlashWriter  ========================== */
+/*!
+ * @brief An invalid flash description is rejected.
+ */
+void test_Init_InvalidGeometry( void )
+{
+    FlashWriterFlash_t xFlash = xSimFlash;
+
+    xFlash.ulPageSize = 2 * flashwriterMAX_PAGE_SIZE;
+    TEST_ASSERT_FALSE( FlashWriter_Init( &xWriter, &xFlash ) );
+
+    xFlash = xSimFlash;
+    xFlash.ulPageSize = 100;
+    TEST_ASSERT_FALSE( FlashWriter_Init( &xWriter, &xFlash ) );
+
+    xFlash = xSimFlash;
+    xFlash.xErase = NULL;
+    TEST_ASSERT_FALSE( FlashWriter_Init( &xWriter, &xFlash ) );
+
+    TEST_ASSERT_TRUE( FlashWriter_Init( &xWriter, &xSimFlash ) );
+    TEST_ASSERT_EQUAL_INT32( -1, FlashWriter_Write( &xWriter, REGION_SIZE - 4U, ucReference, 8 ) );
+}
+
+/*!
+ * @brief Writing to erased flash programs the updated double words only.
+ */
+void test_Append_NoErase( void )
+{
+    uint8_t ucData[ 300 ];
+
+    fillPattern( ucData, sizeof( ucData ), 1 );
+    update( 100, ucData, sizeof( ucData ) );
+
+    /* Bytes 100 to 399 are in double words 12 to 49. */
+    TEST_ASSERT_EQUAL_UINT32( 0, ulEraseOps );
+    TEST_ASSERT_EQUAL_UINT32( 38, ulProgramOps );
+    TEST_ASSERT_EQUAL_UINT32( 1, ulProgramCalls );
+
+    /* Appending after it only touches the new double words. */
+    resetCounters();
+    fillPattern( ucData, sizeof( ucData ), 2 );
+    update( 400, ucData, 16 );
+    TEST_ASSERT_EQUAL_UINT32( 0, ulEraseOps );
+    TEST_ASSERT_EQUAL_UINT32( 2, ulProgramOps );
+
+    TEST_ASSERT_EQUAL_MEMORY( ucReference, pucFlash, REGION_SIZE );
+}
+
+/*!
+ * @brief A 32-bit mark is programmed in place while its double word is
+ * erased, and erases the page once the double word is used.
+ */
+void test_Mark_ErasesOnlyWhenNeeded( void )
+{
+    uint8_t ucObject[ OBJECT_SIZE ];
+    uint32_t ulMark = 0x5A5A0400UL;
+
+    fillPattern( ucObject, sizeof( ucObject ), 3 );
+    update( MARKS_OFFSET + 64U, ucObject, 200 );
+
+    /* First mark: its double word is erased. */
+    resetCounters();
+    update( MARKS_OFFSET, &ulMark, sizeof( ulMark ) );
+    TEST_ASSERT_EQUAL_UINT32( 0, ulEraseOps );
+    TEST_ASSERT_EQUAL_UINT32( 1, ulProgramOps );
+
+    /* Second mark shares the double word: the page is erased and its used
+     * double words are programmed again. */
+    resetCounters();
+    ulMark = 0x5A5A0300UL;
+    update( MARKS_OFFSET + 4U, &ulMark, sizeof( ulMark ) );
+    TEST_ASSERT_EQUAL_UINT32( 1, ulEraseOps );
+    TEST_ASSERT_EQUAL_UINT32( 1 + 25, ulProgramOps );
+
+    TEST_ASSERT_EQUAL_MEMORY( ucReference, pucFlash, REGION_SIZE );
+}
+
+/*!
+ * @brief Writing the content already in flash costs nothing.
+ */
+void test_Identical_NoFlashOperation( void )
+{
+    uint8_t ucObject[ OBJECT_SIZE ];
+    uint32_t ulMark = 0x5A5A0800UL;
+
+    /* Provisioning at every boot saves the same key and certificate. */
+    fillPattern( ucObject, sizeof( ucObject ), 4 );
+    update( 0, ucObject, sizeof( ucObject ) );
+    update( MARKS_OFFSET, &ulMark, sizeof( ulMark ) );
+
+    resetCounters();
+    update( 0, ucObject, sizeof( ucObject ) );
+    update( MARKS_OFFSET, &ulMark, sizeof( ulMark ) );
+    TEST_ASSERT_EQUAL_UINT32( 0, ulEraseOps );
+    TEST_ASSERT_EQUAL_UINT32( 0, ulProgramOps );
+}
+
+/*!
+ * @brief Consecutive updates of a page are merged into one write back.
+ */
+void test_Merge_OneEraseForManyUpdates( void )
+{
+    uint8_t ucData[ 64 ];
+    uint32_t i;
+
+    fillPattern( ucData, sizeof( ucData ), 5 );
+    update( 0, ucData, sizeof( ucData ) );
+
+    /* Rewrite bytes of used double words, one at a time, without flushing. */
+    resetCounters();
+
+    for( i = 0; i < 32U; i++ )
+    {
+        ucData[ 0 ] = ( uint8_t ) i;
+        TEST_ASSERT_EQUAL_INT32( 0, FlashWriter_Write( &xWriter, i * 2U, ucData, 1 ) );
+        ucReference[ i * 2U ] = ( uint8_t ) i;
+    }
+
+    TEST_ASSERT_EQUAL_UINT32( 0, ulEraseOps );
+    TEST_ASSERT_EQUAL_INT32( 0, FlashWriter_Flush( &xWriter ) );
+    TEST_ASSERT_EQUAL_UINT32( 1, ulEraseOps );
+    TEST_ASSERT_EQUAL_UINT32( 8, ulProgramOps );
+    TEST_ASSERT_EQUAL_MEMORY( ucReference, pucFlash, REGION_SIZE );
+
+    /* Nothing left to write. */
+    resetCounters();
+    TEST_ASSERT_EQUAL_INT32( 0, FlashWriter_Flush( &xWriter ) );
+    TEST_ASSERT_EQUAL_UINT32( 0, ulEraseOps + ulProgramOps );
+}
+
+/*!
+ * @brief A write across pages writes them back in order, and leaving a page
+ * writes it back before the next one is touched.
+ */
+void test_CrossPage_WrittenInOrder( void )
+{
+    static uint8_t ucData[ 3U * PAGE_SIZE ];
+    FlashWriterPageStats_t xStats[ flashwriterTRACKED_PAGES + 1U ];
+    size_t xCount;
+
+    fillPattern( ucData, sizeof( ucData ), 6 );
+    TEST_ASSERT_EQUAL_INT32( 0, FlashWriter_Write( &xWriter, PAGE_SIZE - 8U, ucData, 2U * PAGE_SIZE ) );
+    memcpy( &ucReference[ PAGE_SIZE - 8U ], ucData, 2U * PAGE_SIZE );
+
+    /* Pages 0 and 1 are written, page 2 is still cached. */
+    TEST_ASSERT_EQUAL_UINT32( 1U + ( PAGE_SIZE / flashwriterPROGRAM_UNIT ), ulProgramOps );
+    TEST_ASSERT_EACH_EQUAL_HEX8( 0xFF, &pucFlash[ 3U * PAGE_SIZE - 8U ], 8 );
+
+    TEST_ASSERT_EQUAL_INT32( 0, FlashWriter_Flush( &xWriter ) );
+    TEST_ASSERT_EQUAL_MEMORY( ucReference, pucFlash, REGION_SIZE );
+
+    xCount = FlashWriter_PageStats( &xWriter, xStats, flashwriterTRACKED_PAGES + 1U );
+    TEST_ASSERT_EQUAL( 3, xCount );
+    TEST_ASSERT_EQUAL_UINT32( 0, xStats[ 0 ].ulPage );
+    TEST_ASSERT_EQUAL_UINT32( 1, xStats[ 0 ].ulPrograms );
+    TEST_ASSERT_EQUAL_UINT32( 1, xStats[ 1 ].ulPage );
+    TEST_ASSERT_EQUAL_UINT32( PAGE_SIZE / flashwriterPROGRAM_UNIT, xStats[ 1 ].ulPrograms );
+    TEST_ASSERT_EQUAL_UINT32( 2, xStats[ 2 ].ulPage );
+    TEST_ASSERT_EQUAL_UINT32( PAGE_SIZE / flashwriterPROGRAM_UNIT - 1U, xStats[ 2 ].ulPrograms );
+}
+
+/*!
+ * @brief Erases, programs and write back latency are reported per page.
+ */
+void test_Stats_WearAndLatency( void )
+{
+    FlashWriterPageStats_t xStats[ flashwriterTRACKED_PAGES + 1U ];
+    const FlashWriterPageStats_t * pxPage;
+    uint8_t ucData[ 16 ];
+    size_t xCount;
+    uint32_t i;
+
+    fillPattern( ucData, sizeof( ucData ), 7 );
+
+    /* Page 3 is rewritten five times, the first write lands in erased flash. */
+    for( i = 0; i < 5U; i++ )
+    {
+        ucData[ 0 ] = ( uint8_t ) i;
+        update( 3U * PAGE_SIZE, ucData, sizeof( ucData ) );
+    }
+
+    /* One write to each of the other pages, the last ones share an entry. */
+    for( i = 4; i < PAGE_COUNT; i++ )
+    {
+        update( i * PAGE_SIZE, ucData, sizeof( ucData ) );
+    }
+
+    xCount = FlashWriter_PageStats( &xWriter, xStats, flashwriterTRACKED_PAGES + 1U );
+    TEST_ASSERT_EQUAL( flashwriterTRACKED_PAGES + 1U, xCount );
+
+    pxPage = findStats( xStats, xCount, 3 );
+    TEST_ASSERT_EQUAL_UINT32( 5, pxPage->ulWrites );
+    TEST_ASSERT_EQUAL_UINT32( 5, pxPage->ulFlushes );
+    TEST_ASSERT_EQUAL_UINT32( 4, pxPage->ulErases );
+    TEST_ASSERT_EQUAL_UINT32( 10, pxPage->ulPrograms );
+    TEST_ASSERT_EQUAL_UINT32( ERASE_TIME_US + 2U * PROGRAM_TIME_US, pxPage->ulLastFlushUs );
+    TEST_ASSERT_EQUAL_UINT32( ERASE_TIME_US + 2U * PROGRAM_TIME_US, pxPage->ulMaxFlushUs );
+
+    pxPage = findStats( xStats, xCount, 4 );
+    TEST_ASSERT_EQUAL_UINT32( 0, pxPage->ulErases );
+    TEST_ASSERT_EQUAL_UINT32( 2U * PROGRAM_TIME_US, pxPage->ulMaxFlushUs );
+
+    pxPage = findStats( xStats, xCount, flashwriterOTHER_PAGES );
+    TEST_ASSERT_EQUAL_UINT32( PAGE_COUNT - 4U - ( flashwriterTRACKED_PAGES - 1U ), pxPage->ulWrites );
+    TEST_ASSERT_EQUAL_UINT32( 0, pxPage->ulErases );
+}
+
+/*!
+ * @brief A failed erase is reported and the updates are dropped.
+ */
+void test_EraseFailure_Reported( void )
+{
+    uint8_t ucData[ 8 ];
+
+    fillPattern( ucData, sizeof( ucData ), 8 );
+    update( 0, ucData, sizeof( ucData ) );
+
+    xFailErase = true;
+    ucData[ 0 ]++;
+    TEST_ASSERT_EQUAL_INT32( 0, FlashWriter_Write( &xWriter, 0, ucData, sizeof( ucData ) ) );
+    TEST_ASSERT_EQUAL_INT32( -1, FlashWriter_Flush( &xWriter ) );
+    TEST_ASSERT_EQUAL_UINT32( 1, xWriter.ulFlashErrors );
+
+    /* The next write starts again from the flash content. */
+    xFailErase = false;
+    resetCounters();
+    TEST_ASSERT_EQUAL_INT32( 0, FlashWriter_Flush( &xWriter ) );
+    TEST_ASSERT_EQUAL_UINT32( 0, ulEraseOps + ulProgramOps );
+    update( 0, ucData, sizeof( ucData ) );
+    TEST_ASSERT_EQUAL_MEMORY( ucReference, pucFlash, REGION_SIZE );
+}
+
+/*!
+ * @brief Random updates, merged or not, always leave the flash equal to a
+ * byte-wise model and never program a used double word.
+ */
+void test_Random_MatchesModel( void )
+{
+    uint8_t ucData[ 600 ];
+    uint32_t ulOffset, ulLength, i;
+
+    for( i = 0; i < 2000U; i++ )
+    {
+        ulLength = 1U + ( ( uint32_t ) rand() % sizeof( ucData ) );
+        ulOffset = ( uint32_t ) rand() % ( REGION_SIZE - ulLength );
+
+        /* Mostly appends to erased flash and small changes, like the board. */
+        if( ( rand() % 4 ) == 0 )
+        {
+            fillPattern( ucData, ulLength, ( uint32_t ) rand() );
+        }
+        else
+        {
+            memcpy( ucData, &ucReference[ ulOffset ], ulLength );
+            ucData[ ( uint32_t ) rand() % ulLength ] = ( uint8_t ) rand();
+        }
+
+        TEST_ASSERT_EQUAL_INT32( 0, FlashWriter_Write( &xWriter, ulOffset, ucData, ulLength ) );
+        memcpy( &ucReference[ ulOffset ], ucData, ulLength );
+
+        if( ( rand() % 3 ) == 0 )
+        {
+            TEST_ASSERT_EQUAL_INT32( 0, FlashWriter_Flush( &xWriter ) );
+            TEST_ASSERT_EQUAL_MEMORY( ucReference, pucFlash, REGION_SIZE );
+        }
+    }
+
+    TEST_ASSERT_EQUAL_INT32( 0, FlashWriter_Flush( &xWriter ) );
+    TEST_ASSERT_EQUAL_MEMORY( ucReference, pucFlash, REGION_SIZE );
+}
+
+/*!
+ * @brief Flash time of the PKCS #11 object saves against the legacy
+ * FLASH_update() which erased and rewrote every page it touched.
+ */
+void test_Benchmark_ObjectSave( void )
+{
+    uint8_t ucObject[ OBJECT_SIZE ];
+    uint32_t ulMark, ulLegacyUs = 0, ulObject, ulBoot;
+
+    fillPattern( ucObject, sizeof( ucObject ), 9 );
+
+    /* First provisioning, then four reboots saving the same objects. */
+    for( ulBoot = 0; ulBoot < 5U; ulBoot++ )
+    {
+        for( ulObject = 0; ulObject < 3U; ulObject++ )
+        {
+            ulMark = 0x5A5A0000UL | ( 1200U + ulObject );
+            update( ulObject * OBJECT_SIZE, ucObject, 1200U + ulObject );
+            update( MARKS_OFFSET + ( ulObject * sizeof( ulMark ) ), &ulMark, sizeof( ulMark ) );
+            ulLegacyUs += legacyUpdateUs( ulObject * OBJECT_SIZE, 1200U + ulObject );
+            ulLegacyUs += legacyUpdateUs( MARKS_OFFSET, sizeof( ulMark ) );
+        }
+    }
+
+    TEST_ASSERT_EQUAL_MEMORY( ucReference, pucFlash, REGION_SIZE );
+
+    printf( "flash_writer: %u erases, %u double words, %u us for 5 provisionings (legacy %u us)\n",
+            ( unsigned ) ulEraseOps, ( unsigned ) ulProgramOps, ( unsigned ) ulNowUs, ( unsigned ) ulLegacyUs );
+
+    /* Only the second and third marks share a used double word. */
+    TEST_ASSERT_EQUAL_UINT32( 1, ulEraseOps );
+    TEST_ASSERT_LESS_THAN_UINT32( ulLegacyUs / 10U, ulNowUs );
+}
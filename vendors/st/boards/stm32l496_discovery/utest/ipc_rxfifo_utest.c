@@ -0,0 +1,760 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "unity.h"
+
+#include "ipc_rxfifo.h"
+#include "at_util.h"
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+    #include <x86intrin.h>
+    #define CYCLE_COUNTER    1
+#else
+    #define CYCLE_COUNTER    0
+#endif
+
+/* Modem session replayed by the tests. */
+#define CAPTURE_SIZE             ( 64U * 1024U )
+#define CAPTURE_MAX_BURSTS       ( 4096U )
+#define QIRD_MAX_LENGTH          ( 1500U )
+
+/* Board RX DMA ring: an interrupt at half and full transfer, and on idle line. */
+#define DMA_RING_SIZE            ( 512U )
+
+#define BENCHMARK_ROUNDS         ( 200U )
+
+/* ============================  GLOBAL VARIABLES =========================== */
+
+/* End of message automaton, a reduced BG96 one: messages end with <LF>, and
+ * the payload announced by "+QIRD: <length><CR><LF>" is one message of
+ * <length> chars whatever they contain. */
+typedef struct Automaton
+{
+    uint8_t ucState;
+    uint32_t ulMatch;
+    uint32_t ulLength;
+} Automaton_t;
+
+#define AUTOMATON_LINE           ( 0U )
+#define AUTOMATON_QIRD_LENGTH    ( 1U )
+#define AUTOMATON_QIRD_LF        ( 2U )
+#define AUTOMATON_QIRD_DATA      ( 3U )
+
+/* One IPC channel and what its client has read. A client with xSink set
+ * reads +QIRD payloads through the RX sink, as the BG96 one does. */
+typedef struct Channel
+{
+    IPC_Handle_t xIpc;
+    Automaton_t xAutomaton;
+    uint8_t * pucOut;
+    size_t xOutLength;
+    uint32_t ulMessages;
+    uint32_t ulCallbacks;
+    uint32_t ulResumes;
+    bool xSink;
+    uint8_t ucPayload[ QIRD_MAX_LENGTH ];
+    uint32_t ulSinkMessages;
+    uint32_t ulSinkCopies;
+} Channel_t;
+
+static const char cQird[] = "+QIRD: ";
+
+/* The callback has no context: it runs the automaton of the channel being fed. */
+static Automaton_t * pxAutomaton;
+
+static uint8_t ucCapture[ CAPTURE_SIZE ];
+static size_t xCaptureLength;
+static size_t xBurstEnd[ CAPTURE_MAX_BURSTS ];
+static size_t xBurstCount;
+
+static Channel_t xReference;
+static Channel_t xBlock;
+static IPC_RxMessage_t xMessage;
+
+/* ==========================  Helper functions  ============================ */
+
+static uint8_t checkEndOfMsg( uint8_t ucChar )
+{
+    uint8_t ucEnd = 0U;
+
+    switch( pxAutomaton->ucState )
+    {
+        case AUTOMATON_LINE:
+
+            if( ucChar == ( uint8_t ) '\n' )
+            {
+                pxAutomaton->ulMatch = 0U;
+                ucEnd = 1U;
+            }
+            else if( ( pxAutomaton->ulMatch < sizeof( cQird ) - 1U ) &&
+                     ( ucChar == ( uint8_t ) cQird[ pxAutomaton->ulMatch ] ) )
+            {
+                pxAutomaton->ulMatch++;
+
+                if( pxAutomaton->ulMatch == sizeof( cQird ) - 1U )
+                {
+                    pxAutomaton->ucState = AUTOMATON_QIRD_LENGTH;
+                    pxAutomaton->ulLength = 0U;
+                }
+            }
+            else
+            {
+                /* Not a +QIRD line, wait for the next one. */
+                pxAutomaton->ulMatch = UINT32_MAX;
+            }
+
+            break;
+
+        case AUTOMATON_QIRD_LENGTH:
+
+            if( ( ucChar >= ( uint8_t ) '0' ) && ( ucChar <= ( uint8_t ) '9' ) )
+            {
+                pxAutomaton->ulLength = ( pxAutomaton->ulLength * 10U ) + ( ucChar - ( uint8_t ) '0' );
+            }
+            else if( ucChar == ( uint8_t ) '\r' )
+            {
+                pxAutomaton->ucState = AUTOMATON_QIRD_LF;
+            }
+
+            break;
+
+        case AUTOMATON_QIRD_LF:
+            pxAutomaton->ulMatch = 0U;
+            pxAutomaton->ucState = ( pxAutomaton->ulLength != 0U ) ? AUTOMATON_QIRD_DATA : AUTOMATON_LINE;
+            ucEnd = 1U;
+            break;
+
+        default:
+            pxAutomaton->ulLength--;
+
+            if( pxAutomaton->ulLength == 0U )
+            {
+                pxAutomaton->ucState = AUTOMATON_LINE;
+                ucEnd = 1U;
+            }
+
+            break;
+    }
+
+    return ucEnd;
+}
+
+/* Block version of the automaton, built as the BG96 one: chars which cannot
+ * change the state are skipped with ATutil_scan_chars(), or counted at once
+ * in a +QIRD payload, the others go through checkEndOfMsg(). */
+static uint16_t scanEndOfMsg( const uint8_t * pucData,
+                              uint16_t usSize,
+                              uint8_t * pucEndOfMsg )
+{
+    uint8_t ucChars[ 2 ];
+    uint16_t usIndex = 0U, usSkip;
+
+    *pucEndOfMsg = 0U;
+
+    while( ( usIndex < usSize ) && ( *pucEndOfMsg == 0U ) )
+    {
+        usSkip = 0U;
+
+        if( pxAutomaton->ucState == AUTOMATON_LINE )
+        {
+            ucChars[ 0 ] = ( uint8_t ) '\n';
+            ucChars[ 1 ] = ( pxAutomaton->ulMatch < sizeof( cQird ) - 1U ) ? ( uint8_t ) cQird[ pxAutomaton->ulMatch ] : ( uint8_t ) '\n';
+            usSkip = ATutil_scan_chars( &pucData[ usIndex ], usSize - usIndex, ucChars, 2U );
+
+            /* Past the first char, the line is not a +QIRD one. */
+            if( ( usSkip != 0U ) && ( pxAutomaton->ulMatch < sizeof( cQird ) - 1U ) )
+            {
+                pxAutomaton->ulMatch = UINT32_MAX;
+            }
+        }
+        else if( ( pxAutomaton->ucState == AUTOMATON_QIRD_DATA ) && ( pxAutomaton->ulLength > 1U ) )
+        {
+            usSkip = ( ( uint32_t ) ( usSize - usIndex ) < ( pxAutomaton->ulLength - 1U ) ) ?
+                     ( uint16_t ) ( usSize - usIndex ) : ( uint16_t ) ( pxAutomaton->ulLength - 1U );
+            pxAutomaton->ulLength -= usSkip;
+        }
+
+        usIndex += usSkip;
+
+        if( usIndex < usSize )
+        {
+            *pucEndOfMsg = checkEndOfMsg( pucData[ usIndex ] );
+            usIndex++;
+        }
+    }
+
+    return usIndex;
+}
+
+static void rxClientCallback( IPC_Handle_t * pxIpc )
+{
+    ( ( Channel_t * ) pxIpc )->ulCallbacks++;
+}
+
+static void channelInit( Channel_t * pxChannel,
+                         IPC_ScanEndOfMsgCallbackTypeDef xScan )
+{
+    free( pxChannel->pucOut );
+    memset( pxChannel, 0, sizeof( *pxChannel ) );
+
+    pxChannel->pucOut = malloc( 3U * CAPTURE_SIZE * BENCHMARK_ROUNDS );
+    TEST_ASSERT_NOT_NULL( pxChannel->pucOut );
+
+    IPC_RXFIFO_init( &pxChannel->xIpc );
+    pxChannel->xIpc.Mode = IPC_MODE_UART_CHARACTER;
+    pxChannel->xIpc.State = IPC_STATE_ACTIVE;
+    pxChannel->xIpc.RxClientCallback = rxClientCallback;
+    pxChannel->xIpc.CheckEndOfMsgCallback = checkEndOfMsg;
+    pxChannel->xIpc.ScanEndOfMsgCallback = xScan;
+}
+
+/* Client side: read every complete message, then resume the IPC as
+ * IPC_UART_receive() does. Each message is stored behind its 2 bytes size. */
+static void channelRead( Channel_t * pxChannel )
+{
+    uint32_t ulLength;
+
+    while( pxChannel->xIpc.RxQueue.nb_unread_msg > 0U )
+    {
+        TEST_ASSERT_TRUE( IPC_RXFIFO_read( &pxChannel->xIpc, &xMessage ) >= 0 );
+        TEST_ASSERT_NULL( pxChannel->xIpc.RxSink.p_buffer );
+
+        pxChannel->pucOut[ pxChannel->xOutLength++ ] = ( uint8_t ) ( xMessage.size >> 8 );
+        pxChannel->pucOut[ pxChannel->xOutLength++ ] = ( uint8_t ) xMessage.size;
+        memcpy( &pxChannel->pucOut[ pxChannel->xOutLength ], pxChannel->ucPayload, xMessage.sink_size );
+        memcpy( &pxChannel->pucOut[ pxChannel->xOutLength + xMessage.sink_size ],
+                &xMessage.buffer[ xMessage.sink_size ], xMessage.size - xMessage.sink_size );
+        pxChannel->xOutLength += xMessage.size;
+        pxChannel->ulMessages++;
+
+        if( xMessage.sink_size != 0U )
+        {
+            pxChannel->ulSinkMessages++;
+            pxChannel->ulSinkCopies += xMessage.nb_copies;
+        }
+        else if( pxChannel->xSink && ( memcmp( xMessage.buffer, cQird, sizeof( cQird ) - 1U ) == 0 ) )
+        {
+            /* Header analyzed: the payload is the next message. */
+            ulLength = ( uint32_t ) strtoul( ( const char * ) &xMessage.buffer[ sizeof( cQird ) - 1U ], NULL, 10 );
+            pxChannel->xIpc.RxSink.p_buffer = ( ulLength != 0U ) ? pxChannel->ucPayload : NULL;
+            pxChannel->xIpc.RxSink.size = ( uint16_t ) ulLength;
+        }
+    }
+
+    if( pxChannel->xIpc.State == IPC_STATE_PAUSED )
+    {
+        pxChannel->xIpc.State = IPC_STATE_ACTIVE;
+        pxChannel->ulResumes++;
+    }
+}
+
+/* Receive interrupt per char: once paused, the next char stays in the UART
+ * until the client read messages. */
+static void feedCharacters( Channel_t * pxChannel,
+                            const uint8_t * pucData,
+                            size_t xLength )
+{
+    size_t i = 0U;
+
+    pxAutomaton = &pxChannel->xAutomaton;
+
+    while( i < xLength )
+    {
+        if( pxChannel->xIpc.State == IPC_STATE_PAUSED )
+        {
+            channelRead( pxChannel );
+        }
+        else
+        {
+            IPC_RXFIFO_writeCharacter( &pxChannel->xIpc, pucData[ i ] );
+            i++;
+        }
+    }
+}
+
+/* DMA event: the block is written until the IPC pauses, the rest stays in
+ * the DMA ring until the client read messages. */
+static void feedBlock( Channel_t * pxChannel,
+                       const uint8_t * pucData,
+                       size_t xLength )
+{
+    size_t i = 0U;
+    uint16_t usWritten;
+
+    pxAutomaton = &pxChannel->xAutomaton;
+
+    while( i < xLength )
+    {
+        if( pxChannel->xIpc.State == IPC_STATE_PAUSED )
+        {
+            channelRead( pxChannel );
+        }
+        else
+        {
+            usWritten = IPC_RXFIFO_writeBlock( &pxChannel->xIpc, &pucData[ i ], ( uint16_t ) ( xLength - i ) );
+            TEST_ASSERT_TRUE( usWritten > 0U );
+            i += usWritten;
+        }
+    }
+}
+
+static void assertSameQueue( void )
+{
+    const IPC_RxQueue_t * pxExpected = &xReference.xIpc.RxQueue;
+    const IPC_RxQueue_t * pxActual = &xBlock.xIpc.RxQueue;
+
+    TEST_ASSERT_EQUAL( xReference.xIpc.State, xBlock.xIpc.State );
+    TEST_ASSERT_EQUAL_UINT16( pxExpected->index_read, pxActual->index_read );
+    TEST_ASSERT_EQUAL_UINT16( pxExpected->index_write, pxActual->index_write );
+    TEST_ASSERT_EQUAL_UINT16( pxExpected->current_msg_index, pxActual->current_msg_index );
+    TEST_ASSERT_EQUAL_UINT16( pxExpected->current_msg_size, pxActual->current_msg_size );
+    TEST_ASSERT_EQUAL_UINT8( pxExpected->nb_unread_msg, pxActual->nb_unread_msg );
+    TEST_ASSERT_EQUAL_MEMORY( pxExpected->data, pxActual->data, IPC_RXBUF_MAXSIZE );
+    TEST_ASSERT_EQUAL_MEMORY( &xReference.xAutomaton, &xBlock.xAutomaton, sizeof( Automaton_t ) );
+    TEST_ASSERT_EQUAL_UINT32( xReference.ulCallbacks, xBlock.ulCallbacks );
+}
+
+static void assertSameOutput( void )
+{
+    TEST_ASSERT_EQUAL_UINT32( xReference.ulMessages, xBlock.ulMessages );
+    TEST_ASSERT_EQUAL_UINT32( xReference.xOutLength, xBlock.xOutLength );
+    TEST_ASSERT_EQUAL_MEMORY( xReference.pucOut, xBlock.pucOut, xReference.xOutLength );
+}
+
+static void captureAppend( const void * pvData,
+                           size_t xLength )
+{
+    memcpy( &ucCapture[ xCaptureLength ], pvData, xLength );
+    xCaptureLength += xLength;
+}
+
+static void captureBurst( void )
+{
+    xBurstEnd[ xBurstCount++ ] = xCaptureLength;
+}
+
+/* Modem session: echoed commands, responses, URCs and socket reads whose
+ * binary payload contains <CR>, <LF> and fake +QIRD headers. Each modem
+ * answer is one burst on the line. */
+static void buildCapture( unsigned int uSeed )
+{
+    static const char * const pcExchanges[] =
+    {
+        "AT+CSQ\r\r\n+CSQ: 20,99\r\n\r\nOK\r\n",
+        "\r\n+QIURC: \"recv\",0\r\n",
+        "AT+QISTATE=1,0\r\r\n+QISTATE: 0,\"TCP\",\"52.1.2.3\",8883,0,2,1,0,0,\"usbmodem\"\r\n\r\nOK\r\n",
+        "AT+QISEND=0,64\r\r\n> ",
+        "\r\nSEND OK\r\n",
+        "\r\n+CEREG: 1,\"2F3A\",\"0102A0B\",9\r\n",
+    };
+    char cHeader[ 48 ];
+    uint32_t ulLength, i;
+
+    srand( uSeed );
+    xCaptureLength = 0U;
+    xBurstCount = 0U;
+
+    captureAppend( "\r\nRDY\r\n", 7U );
+    captureBurst();
+
+    while( xCaptureLength < CAPTURE_SIZE - ( 2U * QIRD_MAX_LENGTH ) )
+    {
+        if( ( rand() % 3 ) != 0 )
+        {
+            i = ( uint32_t ) rand() % ( sizeof( pcExchanges ) / sizeof( pcExchanges[ 0 ] ) );
+            captureAppend( pcExchanges[ i ], strlen( pcExchanges[ i ] ) );
+        }
+        else
+        {
+            ulLength = ( uint32_t ) rand() % ( QIRD_MAX_LENGTH + 1U );
+            captureAppend( "AT+QIRD=0,1500\r", 15U );
+            captureBurst();
+            captureAppend( cHeader, ( size_t ) snprintf( cHeader, sizeof( cHeader ), "\r\n+QIRD: %u\r\n", ulLength ) );
+
+            for( i = 0; i < ulLength; i++ )
+            {
+                if( ( rand() % 16 ) == 0 )
+                {
+                    ucCapture[ xCaptureLength++ ] = ( rand() % 2 ) ? ( uint8_t ) '\r' : ( uint8_t ) '\n';
+                }
+                else if( ( ( rand() % 128 ) == 0 ) && ( ( ulLength - i ) > 12U ) )
+                {
+                    captureAppend( "\n+QIRD: 9\r\n", 11U );
+                    i += 10U;
+                }
+                else
+                {
+                    ucCapture[ xCaptureLength++ ] = ( uint8_t ) rand();
+                }
+            }
+
+            captureAppend( "\r\n\r\nOK\r\n", 8U );
+        }
+
+        captureBurst();
+    }
+}
+
+/* Replay the capture on both channels, cut in the same blocks, and check
+ * the FIFO after each block. The client reads after some blocks only, so
+ * the FIFO also fills up and pauses. */
+static void replayRandomBlocks( size_t xMaxBlock,
+                                IPC_ScanEndOfMsgCallbackTypeDef xScan,
+                                bool xSink )
+{
+    size_t xOffset = 0U, xSize;
+    bool xRead;
+
+    channelInit( &xReference, NULL );
+    channelInit( &xBlock, xScan );
+    xBlock.xSink = xSink;
+
+    while( xOffset < xCaptureLength )
+    {
+        xSize = 1U + ( ( size_t ) rand() % xMaxBlock );
+        xSize = ( xSize > xCaptureLength - xOffset ) ? ( xCaptureLength - xOffset ) : xSize;
+        xRead = ( rand() % 4 ) != 0;
+
+        feedCharacters( &xReference, &ucCapture[ xOffset ], xSize );
+        feedBlock( &xBlock, &ucCapture[ xOffset ], xSize );
+        assertSameQueue();
+
+        if( xRead )
+        {
+            channelRead( &xReference );
+            channelRead( &xBlock );
+            assertSameQueue();
+        }
+
+        xOffset += xSize;
+    }
+
+    channelRead( &xReference );
+    channelRead( &xBlock );
+    assertSameQueue();
+    assertSameOutput();
+}
+
+/* Blocks as delivered by the board: a DMA event at each end of burst (idle
+ * line) and each half ring, never across the end of the ring. Returns the
+ * number of DMA events. */
+static uint32_t feedDmaEvents( Channel_t * pxChannel,
+                               const uint8_t * pucData,
+                               size_t xLength,
+                               bool xBlocks )
+{
+    size_t xOffset = 0U, xEnd, xNextHalf;
+    size_t xBurst = 0U;
+    uint32_t ulEvents = 0U;
+
+    while( xOffset < xLength )
+    {
+        while( xBurstEnd[ xBurst ] <= xOffset )
+        {
+            xBurst++;
+        }
+
+        xNextHalf = ( ( xOffset / ( DMA_RING_SIZE / 2U ) ) + 1U ) * ( DMA_RING_SIZE / 2U );
+        xEnd = ( xBurstEnd[ xBurst ] < xNextHalf ) ? xBurstEnd[ xBurst ] : xNextHalf;
+
+        if( xBlocks )
+        {
+            feedBlock( pxChannel, &pucData[ xOffset ], xEnd - xOffset );
+        }
+        else
+        {
+            feedCharacters( pxChannel, &pucData[ xOffset ], xEnd - xOffset );
+        }
+
+        /* The modem task reads while the next burst is on the line. */
+        if( xEnd == xBurstEnd[ xBurst ] )
+        {
+            channelRead( pxChannel );
+        }
+
+        xOffset = xEnd;
+        ulEvents++;
+    }
+
+    channelRead( pxChannel );
+
+    return ulEvents;
+}
+
+static double elapsedNs( const struct timespec * pxStart,
+                         const struct timespec * pxEnd )
+{
+    return ( ( double ) ( pxEnd->tv_sec - pxStart->tv_sec ) * 1e9 ) + ( double ) ( pxEnd->tv_nsec - pxStart->tv_nsec );
+}
+
+static uint64_t readCycles( void )
+{
+    #if ( CYCLE_COUNTER == 1 )
+        return __rdtsc();
+    #else
+        return 0U;
+    #endif
+}
+
+/* Receive the session BENCHMARK_ROUNDS times, as the board does, and print
+ * the host throughput. Returns the number of DMA events per session. */
+static uint32_t benchmarkPath( const char * pcName,
+                               Channel_t * pxChannel,
+                               IPC_ScanEndOfMsgCallbackTypeDef xScan,
+                               bool xBlocks )
+{
+    struct timespec xStart, xEnd;
+    uint64_t ullCycles;
+    uint32_t ulEvents = 0U;
+    uint32_t i;
+    double dBytes = ( double ) BENCHMARK_ROUNDS * xCaptureLength;
+
+    channelInit( pxChannel, xScan );
+
+    clock_gettime( CLOCK_MONOTONIC, &xStart );
+    ullCycles = readCycles();
+
+    for( i = 0; i < BENCHMARK_ROUNDS; i++ )
+    {
+        ulEvents += feedDmaEvents( pxChannel, ucCapture, xCaptureLength, xBlocks );
+    }
+
+    ullCycles = readCycles() - ullCycles;
+    clock_gettime( CLOCK_MONOTONIC, &xEnd );
+
+    printf( "ipc_rxfifo: %-34s %5.2f ns per char", pcName, elapsedNs( &xStart, &xEnd ) / dBytes );
+
+    if( ullCycles != 0U )
+    {
+        printf( ", %5.2f bytes per cycle", dBytes / ( double ) ullCycles );
+    }
+
+    printf( "\n" );
+
+    return ulEvents / BENCHMARK_ROUNDS;
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+void setUp( void )
+{
+    buildCapture( 1U );
+}
+
+void tearDown( void )
+{
+    free( xReference.pucOut );
+    free( xBlock.pucOut );
+    xReference.pucOut = NULL;
+    xBlock.pucOut = NULL;
+}
+
+/* ========================  TESTING IPC_RXFIFO  ========================== */
+
+/*!
+ * @brief Block writes leave the FIFO exactly as char writes, whatever the
+ * block size, including blocks ending inside a message or a +QIRD payload.
+ */
+void test_WriteBlock_MatchesWriteCharacter( void )
+{
+    static const size_t xMaxBlocks[] = { 1U, 7U, 64U, 300U, 1200U, 4000U };
+    size_t i;
+
+    for( i = 0; i < sizeof( xMaxBlocks ) / sizeof( xMaxBlocks[ 0 ] ); i++ )
+    {
+        srand( 100U + i );
+        replayRandomBlocks( xMaxBlocks[ i ], NULL, false );
+    }
+
+    TEST_ASSERT_TRUE( xBlock.ulMessages > 500U );
+    TEST_ASSERT_TRUE( xBlock.ulResumes > 0U );
+}
+
+/*!
+ * @brief Other sessions, to vary where payloads cross the end of the FIFO.
+ */
+void test_WriteBlock_MatchesWriteCharacter_OtherSessions( void )
+{
+    unsigned int uSeed;
+
+    for( uSeed = 2U; uSeed < 12U; uSeed++ )
+    {
+        buildCapture( uSeed );
+        srand( uSeed );
+        replayRandomBlocks( 800U, NULL, false );
+    }
+}
+
+/*!
+ * @brief Ends of message found by the block scan callback give the same
+ * FIFO as the char callback.
+ */
+void test_WriteBlock_ScanCallback_MatchesWriteCharacter( void )
+{
+    static const size_t xMaxBlocks[] = { 1U, 5U, 64U, 300U, 1200U, 4000U };
+    unsigned int uSeed;
+    size_t i;
+
+    for( i = 0; i < sizeof( xMaxBlocks ) / sizeof( xMaxBlocks[ 0 ] ); i++ )
+    {
+        srand( 200U + i );
+        replayRandomBlocks( xMaxBlocks[ i ], scanEndOfMsg, false );
+    }
+
+    for( uSeed = 2U; uSeed < 12U; uSeed++ )
+    {
+        buildCapture( uSeed );
+        srand( uSeed );
+        replayRandomBlocks( 800U, scanEndOfMsg, false );
+    }
+}
+
+/*!
+ * @brief The block write stops on the char pausing the FIFO, as the receive
+ * interrupt would, and writes nothing more until the client read.
+ */
+void test_WriteBlock_StopsWhenPaused( void )
+{
+    uint16_t usWritten;
+    size_t xCharacters = 0U;
+
+    channelInit( &xReference, NULL );
+    channelInit( &xBlock, NULL );
+
+    pxAutomaton = &xReference.xAutomaton;
+
+    while( xReference.xIpc.State != IPC_STATE_PAUSED )
+    {
+        IPC_RXFIFO_writeCharacter( &xReference.xIpc, ucCapture[ xCharacters++ ] );
+    }
+
+    pxAutomaton = &xBlock.xAutomaton;
+    usWritten = IPC_RXFIFO_writeBlock( &xBlock.xIpc, ucCapture, ( uint16_t ) xCaptureLength );
+
+    TEST_ASSERT_EQUAL_UINT32( xCharacters, usWritten );
+    TEST_ASSERT_EQUAL_UINT16( IPC_RXBUF_THRESHOLD, IPC_RXFIFO_getFreeBytes( &xBlock.xIpc ) );
+    assertSameQueue();
+
+    TEST_ASSERT_EQUAL_UINT16( 0U, IPC_RXFIFO_writeBlock( &xBlock.xIpc, &ucCapture[ usWritten ], 100U ) );
+    assertSameQueue();
+
+    /* Resumed, both carry on identically. */
+    channelRead( &xReference );
+    channelRead( &xBlock );
+    feedCharacters( &xReference, &ucCapture[ xCharacters ], xCaptureLength - xCharacters );
+    feedBlock( &xBlock, &ucCapture[ xCharacters ], xCaptureLength - xCharacters );
+    channelRead( &xReference );
+    channelRead( &xBlock );
+    assertSameQueue();
+    assertSameOutput();
+}
+
+/*!
+ * @brief +QIRD payloads read through the RX sink reach the client buffer
+ * unchanged, in one copy or two when they wrap at the end of the FIFO.
+ */
+void test_Read_RxSink_MatchesMessageCopy( void )
+{
+    unsigned int uSeed;
+    uint32_t ulSinkMessages = 0U, ulSinkCopies = 0U;
+
+    for( uSeed = 2U; uSeed < 12U; uSeed++ )
+    {
+        buildCapture( uSeed );
+        srand( uSeed );
+        replayRandomBlocks( 800U, scanEndOfMsg, true );
+        ulSinkMessages += xBlock.ulSinkMessages;
+        ulSinkCopies += xBlock.ulSinkCopies;
+    }
+
+    TEST_ASSERT_TRUE( ulSinkMessages > 100U );
+    TEST_ASSERT_TRUE( ulSinkCopies > ulSinkMessages );
+    TEST_ASSERT_TRUE( ulSinkCopies < ( 2U * ulSinkMessages ) );
+}
+
+/*!
+ * @brief A message shorter than the sink is read as usual, and the sink is
+ * used once only.
+ */
+void test_Read_RxSink_IgnoredForShorterMessage( void )
+{
+    uint8_t ucSink[ 16 ];
+    IPC_RxSegment_t xSegment[ IPC_RXMSG_MAX_SEGMENTS ];
+
+    channelInit( &xBlock, NULL );
+    xBlock.xAutomaton.ulMatch = UINT32_MAX;
+    feedBlock( &xBlock, ( const uint8_t * ) "OK\r\n+QIRD: 2\r\nAB", 16U );
+    TEST_ASSERT_EQUAL_UINT8( 3U, xBlock.xIpc.RxQueue.nb_unread_msg );
+
+    /* Segments of the first message, left in the FIFO. */
+    TEST_ASSERT_EQUAL_UINT8( 1U, IPC_RXFIFO_getMsgSegments( &xBlock.xIpc, xSegment ) );
+    TEST_ASSERT_EQUAL_PTR( &xBlock.xIpc.RxQueue.data[ IPC_RXMSG_HEADER_SIZE ], xSegment[ 0 ].p_data );
+    TEST_ASSERT_EQUAL_UINT16( 4U, xSegment[ 0 ].size );
+
+    xBlock.xIpc.RxSink.p_buffer = ucSink;
+    xBlock.xIpc.RxSink.size = 5U;
+    TEST_ASSERT_TRUE( IPC_RXFIFO_read( &xBlock.xIpc, &xMessage ) >= 0 );
+    TEST_ASSERT_EQUAL_UINT16( 0U, xMessage.sink_size );
+    TEST_ASSERT_EQUAL_UINT8( 1U, xMessage.nb_copies );
+    TEST_ASSERT_EQUAL_MEMORY( "OK\r\n", xMessage.buffer, 4U );
+    TEST_ASSERT_NULL( xBlock.xIpc.RxSink.p_buffer );
+
+    /* Header, then payload in the sink. */
+    TEST_ASSERT_TRUE( IPC_RXFIFO_read( &xBlock.xIpc, &xMessage ) >= 0 );
+    xBlock.xIpc.RxSink.p_buffer = ucSink;
+    xBlock.xIpc.RxSink.size = 2U;
+    TEST_ASSERT_TRUE( IPC_RXFIFO_read( &xBlock.xIpc, &xMessage ) >= 0 );
+    TEST_ASSERT_EQUAL_UINT16( 2U, xMessage.size );
+    TEST_ASSERT_EQUAL_UINT16( 2U, xMessage.sink_size );
+    TEST_ASSERT_EQUAL_MEMORY( "AB", ucSink, 2U );
+}
+
+/*!
+ * @brief Interrupts and host throughput needed to receive the session: one
+ * interrupt per char with the char callback, against one DMA event per burst
+ * or half ring with the char callback or the block scan.
+ */
+void test_Benchmark_RxInterrupts( void )
+{
+    uint32_t ulDmaEvents;
+
+    ( void ) benchmarkPath( "char interrupts, char callback:", &xReference, NULL, false );
+    ( void ) benchmarkPath( "DMA blocks, char callback:", &xBlock, NULL, true );
+    assertSameOutput();
+    ulDmaEvents = benchmarkPath( "DMA blocks, block scan:", &xBlock, scanEndOfMsg, true );
+    assertSameOutput();
+
+    printf( "ipc_rxfifo: %u chars in %u bursts: %u RX interrupts per char, %u DMA events\n",
+            ( unsigned int ) xCaptureLength, ( unsigned int ) xBurstCount,
+            ( unsigned int ) xCaptureLength, ( unsigned int ) ulDmaEvents );
+
+    TEST_ASSERT_TRUE( ulDmaEvents < ( xCaptureLength / 20U ) );
+}
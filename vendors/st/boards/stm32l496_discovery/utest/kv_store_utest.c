@@ -0,0 +1,941 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "unity.h"
+
+#include "kv_store.h"
+#include "flash_writer.h"
+
+/* Geometry of the simulated flash: the 16 STM32L4 pages of the board store. */
+#define PAGE_SIZE                ( 2048U )
+#define PAGE_COUNT               ( 16U )
+#define SECTOR_SIZE              ( ( PAGE_COUNT / 2U ) * PAGE_SIZE )
+
+/* STM32L4 datasheet, typical: double word programming, page erase. */
+#define PROGRAM_TIME_US          ( 82U )
+#define ERASE_TIME_US            ( 22020U )
+
+/* Keys and values of the power cut workload. */
+#define CUT_KEYS                 ( 6U )
+#define CUT_WORKLOAD_STEPS       ( 60U )
+#define CUT_PAGE_COUNT           ( 4U )
+
+/* Data of a former format imported at the first open: a value per page at
+ * the end of sector 1, its length in the first double word. */
+#define FORMER_KEYS              ( 4U )
+#define FORMER_VERSION           ( 7U )
+
+/* ============================  GLOBAL VARIABLES =========================== */
+
+static uint64_t ullFlash[ ( PAGE_COUNT * PAGE_SIZE ) / sizeof( uint64_t ) ];
+static uint8_t * const pucFlash = ( uint8_t * ) ullFlash;
+static uint32_t ulEraseCount[ PAGE_COUNT ];
+
+static uint32_t ulProgramOps;
+static uint32_t ulEraseOps;
+static uint32_t ulProgramViolations;
+
+/* Simulated time in microseconds, advanced by the flash operations. */
+static uint32_t ulNowUs;
+
+/* Flash operations (double words and page erases) left before the power
+ * is cut, negative when no cut is armed. */
+static int32_t lOpsBeforeCut;
+static bool xPowerLost;
+
+static KVStore_t xStore;
+
+/* Page cache the board programs the store through. */
+static FlashWriter_t xWriter;
+
+/* Reference model of the power cut test: version of the value of each key,
+ * -1 if the key is absent. */
+static int32_t lCommitted[ CUT_KEYS ];
+static int32_t lInFlight[ CUT_KEYS ];
+
+/* Calls of the import callback. */
+static uint32_t ulImports;
+
+/* ===========================  Flash simulator  ============================ */
+
+static bool opCutsPower( void )
+{
+    if( lOpsBeforeCut < 0 )
+    {
+        return false;
+    }
+
+    if( lOpsBeforeCut == 0 )
+    {
+        xPowerLost = true;
+
+        return true;
+    }
+
+    lOpsBeforeCut--;
+
+    return false;
+}
+
+static int32_t simErase( void * pvContext,
+                         uint32_t ulOffset )
+{
+    uint32_t i;
+
+    TEST_ASSERT_EQUAL_PTR( ullFlash, pvContext );
+    TEST_ASSERT_EQUAL( 0, ulOffset % PAGE_SIZE );
+
+    if( xPowerLost == true )
+    {
+        return -1;
+    }
+
+    if( opCutsPower() == true )
+    {
+        /* Interrupted erase: the page is left in an undefined state. */
+        for( i = 0; i < PAGE_SIZE; i++ )
+        {
+            pucFlash[ ulOffset + i ] = ( ( rand() & 1 ) != 0 ) ? 0xFFU : ( uint8_t ) rand();
+        }
+
+        return -1;
+    }
+
+    memset( &pucFlash[ ulOffset ], 0xFF, PAGE_SIZE );
+    ulEraseCount[ ulOffset / PAGE_SIZE ]++;
+    ulEraseOps++;
+    ulNowUs += ERASE_TIME_US;
+
+    return 0;
+}
+
+static int32_t simProgram( void * pvContext,
+                           uint32_t ulOffset,
+                           const void * pvData,
+                           uint32_t ulLength )
+{
+    const uint8_t * pucData = pvData;
+    uint32_t i, j;
+
+    TEST_ASSERT_EQUAL_PTR( ullFlash, pvContext );
+    TEST_ASSERT_EQUAL( 0, ulOffset % kvstorePROGRAM_UNIT );
+    TEST_ASSERT_EQUAL( 0, ulLength % kvstorePROGRAM_UNIT );
+    TEST_ASSERT_EQUAL( 0, ( uintptr_t ) pvData % kvstorePROGRAM_UNIT );
+
+    for( i = 0; i < ulLength; i += kvstorePROGRAM_UNIT )
+    {
+        if( xPowerLost == true )
+        {
+            return -1;
+        }
+
+        /* Like the L4 controller, refuse to program a used double word. */
+        for( j = 0; j < kvstorePROGRAM_UNIT; j++ )
+        {
+            if( pucFlash[ ulOffset + i + j ] != 0xFFU )
+            {
+                ulProgramViolations++;
+
+                return -1;
+            }
+        }
+
+        if( opCutsPower() == true )
+        {
+            /* Interrupted program: some bits of the double word are set. */
+            for( j = 0; j < kvstorePROGRAM_UNIT; j++ )
+            {
+                pucFlash[ ulOffset + i + j ] = pucData[ i + j ] | ( uint8_t ) rand();
+            }
+
+            return -1;
+        }
+
+        memcpy( &pucFlash[ ulOffset + i ], &pucData[ i ], kvstorePROGRAM_UNIT );
+        ulProgramOps++;
+        ulNowUs += PROGRAM_TIME_US;
+    }
+
+    return 0;
+}
+
+static uint32_t simTimestamp( void )
+{
+    return ulNowUs;
+}
+
+static const KVStoreFlash_t xSimFlash =
+{
+    .pucBase      = ( const volatile uint8_t * ) ullFlash,
+    .ulPageSize   = PAGE_SIZE,
+    .ulPageCount  = PAGE_COUNT,
+    .xErase       = simErase,
+    .xProgram     = simProgram,
+    .xTimestamp   = simTimestamp,
+    .ulTicksPerUs = 1,
+    .pvContext    = ullFlash
+};
+
+static const KVStoreFlash_t xSmallFlash =
+{
+    .pucBase      = ( const volatile uint8_t * ) ullFlash,
+    .ulPageSize   = PAGE_SIZE,
+    .ulPageCount  = CUT_PAGE_COUNT,
+    .xErase       = simErase,
+    .xProgram     = simProgram,
+    .xTimestamp   = simTimestamp,
+    .ulTicksPerUs = 1,
+    .pvContext    = ullFlash
+};
+
+static const FlashWriterFlash_t xWriterFlash =
+{
+    .pucBase     = ( const volatile uint8_t * ) ullFlash,
+    .ulPageSize  = PAGE_SIZE,
+    .ulPageCount = PAGE_COUNT,
+    .xErase      = simErase,
+    .xProgram    = simProgram,
+    .pvContext   = ullFlash
+};
+
+/* The board callbacks: FLASH_update_cached(), FLASH_sync() before an erase,
+ * and FLASH_sync(). */
+static int32_t cacheErase( void * pvContext,
+                           uint32_t ulOffset )
+{
+    int32_t lResult = FlashWriter_Flush( &xWriter );
+
+    if( lResult == 0 )
+    {
+        lResult = simErase( pvContext, ulOffset );
+    }
+
+    return lResult;
+}
+
+static int32_t cacheProgram( void * pvContext,
+                             uint32_t ulOffset,
+                             const void * pvData,
+                             uint32_t ulLength )
+{
+    ( void ) pvContext;
+
+    return FlashWriter_Write( &xWriter, ulOffset, pvData, ulLength );
+}
+
+static int32_t cacheSync( void * pvContext )
+{
+    ( void ) pvContext;
+
+    return FlashWriter_Flush( &xWriter );
+}
+
+static const KVStoreFlash_t xCachedFlash =
+{
+    .pucBase      = ( const volatile uint8_t * ) ullFlash,
+    .ulPageSize   = PAGE_SIZE,
+    .ulPageCount  = PAGE_COUNT,
+    .xErase       = cacheErase,
+    .xProgram     = cacheProgram,
+    .xSync        = cacheSync,
+    .xTimestamp   = simTimestamp,
+    .ulTicksPerUs = 1,
+    .pvContext    = ullFlash
+};
+
+static const KVStoreFlash_t xCachedSmallFlash =
+{
+    .pucBase      = ( const volatile uint8_t * ) ullFlash,
+    .ulPageSize   = PAGE_SIZE,
+    .ulPageCount  = CUT_PAGE_COUNT,
+    .xErase       = cacheErase,
+    .xProgram     = cacheProgram,
+    .xSync        = cacheSync,
+    .xTimestamp   = simTimestamp,
+    .ulTicksPerUs = 1,
+    .pvContext    = ullFlash
+};
+
+/* ==========================  Helper functions  ============================ */
+
+static size_t makeKey( uint32_t ulKey,
+                       char * pcKey )
+{
+    return ( size_t ) sprintf( pcKey, "key-%u", ( unsigned ) ulKey );
+}
+
+static size_t makeValue( uint32_t ulKey,
+                         uint32_t ulVersion,
+                         uint8_t * pucValue )
+{
+    size_t xLength = 20U + ( ( ( ulKey * 37U ) + ( ulVersion * 13U ) ) % 300U );
+    size_t i;
+
+    for( i = 0; i < xLength; i++ )
+    {
+        pucValue[ i ] = ( uint8_t ) ( ( ulKey << 5 ) + ulVersion + i );
+    }
+
+    return xLength;
+}
+
+static bool setVersion( uint32_t ulKey,
+                        uint32_t ulVersion )
+{
+    char cKey[ 16 ];
+    uint8_t ucValue[ 400 ];
+    size_t xKeyLength = makeKey( ulKey, cKey );
+
+    return KVStore_Set( &xStore, cKey, xKeyLength, ucValue, makeValue( ulKey, ulVersion, ucValue ) );
+}
+
+/* Check the value of a key against its version, -1 for an absent key. */
+static bool hasVersion( uint32_t ulKey,
+                        int32_t lVersion )
+{
+    char cKey[ 16 ];
+    uint8_t ucExpected[ 400 ];
+    uint8_t ucValue[ 400 ];
+    size_t xKeyLength = makeKey( ulKey, cKey );
+    size_t xLength;
+    bool xFound = KVStore_Read( &xStore, cKey, xKeyLength, ucValue, sizeof( ucValue ), &xLength );
+
+    if( lVersion < 0 )
+    {
+        return xFound == false;
+    }
+
+    return ( xFound == true ) &&
+           ( xLength == makeValue( ulKey, ( uint32_t ) lVersion, ucExpected ) ) &&
+           ( memcmp( ucValue, ucExpected, xLength ) == 0 );
+}
+
+static uint8_t * formerPage( uint32_t ulKey )
+{
+    return &pucFlash[ ( PAGE_COUNT - 1U - ulKey ) * PAGE_SIZE ];
+}
+
+static void writeFormerData( void )
+{
+    uint64_t ullLength;
+    uint32_t ulKey;
+
+    for( ulKey = 0; ulKey < FORMER_KEYS; ulKey++ )
+    {
+        ullLength = makeValue( ulKey, FORMER_VERSION, formerPage( ulKey ) + sizeof( ullLength ) );
+        memcpy( formerPage( ulKey ), &ullLength, sizeof( ullLength ) );
+    }
+}
+
+static int32_t simImport( KVStore_t * pxStore,
+                          void * pvContext )
+{
+    char cKey[ 16 ];
+    uint64_t ullLength;
+    uint32_t ulKey;
+    int32_t lResult = 0;
+
+    TEST_ASSERT_EQUAL_PTR( &xStore, pxStore );
+    TEST_ASSERT_EQUAL_PTR( ullFlash, pvContext );
+    ulImports++;
+
+    /* Sector 1 holds the former data, no collection may erase it. */
+    TEST_ASSERT_FALSE( KVStore_Collect( pxStore ) );
+
+    for( ulKey = 0; ( ulKey < FORMER_KEYS ) && ( lResult == 0 ); ulKey++ )
+    {
+        memcpy( &ullLength, formerPage( ulKey ), sizeof( ullLength ) );
+
+        if( KVStore_Set( pxStore, cKey, makeKey( ulKey, cKey ),
+                         formerPage( ulKey ) + sizeof( ullLength ), ( size_t ) ullLength ) == false )
+        {
+            lResult = -1;
+        }
+    }
+
+    return lResult;
+}
+
+static void reboot( const KVStoreFlash_t * pxFlash )
+{
+    lOpsBeforeCut = -1;
+    xPowerLost = false;
+    TEST_ASSERT_TRUE( FlashWriter_Init( &xWriter, &xWriterFlash ) );
+    TEST_ASSERT_TRUE( KVStore_Open( &xStore, pxFlash ) );
+}
+
+/* Updates and deletions of a few keys, tracked in the reference model. */
+static void runWorkload( void )
+{
+    uint32_t ulStep, ulKey;
+    int32_t lVersion;
+    char cKey[ 16 ];
+    bool xDone;
+
+    for( ulStep = 0; ( ulStep < CUT_WORKLOAD_STEPS ) && ( xPowerLost == false ); ulStep++ )
+    {
+        ulKey = ( ulStep * 5U ) % CUT_KEYS;
+        lVersion = ( ( ulStep % 7U ) == 6U ) ? -1 : ( int32_t ) ulStep;
+        lInFlight[ ulKey ] = lVersion;
+
+        if( lVersion < 0 )
+        {
+            xDone = KVStore_Delete( &xStore, cKey, makeKey( ulKey, cKey ) );
+        }
+        else
+        {
+            xDone = setVersion( ulKey, ( uint32_t ) lVersion );
+        }
+
+        if( xDone == true )
+        {
+            lCommitted[ ulKey ] = lVersion;
+        }
+        else
+        {
+            TEST_ASSERT_TRUE( xPowerLost );
+        }
+    }
+}
+
+/* Page erases the page cache made on its own, a log-structured store only
+ * programs erased flash and should need none. */
+static uint32_t cacheErases( void )
+{
+    FlashWriterPageStats_t xStats[ flashwriterTRACKED_PAGES + 1U ];
+    size_t xCount, i;
+    uint32_t ulErases = 0;
+
+    xCount = FlashWriter_PageStats( &xWriter, xStats, flashwriterTRACKED_PAGES + 1U );
+
+    for( i = 0; i < xCount; i++ )
+    {
+        ulErases += xStats[ i ].ulErases;
+    }
+
+    return ulErases;
+}
+
+/* Cut the power at every flash operation of the workload, check after each
+ * reboot that no committed value is lost and that the store keeps working. */
+static void powerCutWorkload( const KVStoreFlash_t * pxFlash )
+{
+    uint32_t ulOps, ulCut, ulKey;
+    uint32_t ulCollections = 0;
+
+    /* Count the operations of an uninterrupted run. */
+    reboot( pxFlash );
+    ulProgramOps = 0;
+    ulEraseOps = 0;
+    runWorkload();
+    ulOps = ulProgramOps + ulEraseOps;
+    TEST_ASSERT_GREATER_THAN_UINT32( 2, xStore.xStats.ulCollections );
+
+    for( ulCut = 0; ulCut < ulOps; ulCut++ )
+    {
+        setUp();
+        reboot( pxFlash );
+        lOpsBeforeCut = ( int32_t ) ulCut;
+        runWorkload();
+        TEST_ASSERT_TRUE( xPowerLost );
+
+        reboot( pxFlash );
+
+        for( ulKey = 0; ulKey < CUT_KEYS; ulKey++ )
+        {
+            if( ( hasVersion( ulKey, lCommitted[ ulKey ] ) == false ) &&
+                ( hasVersion( ulKey, lInFlight[ ulKey ] ) == false ) )
+            {
+                TEST_FAIL_MESSAGE( "Value lost across a power cut." );
+            }
+        }
+
+        /* The recovered store accepts updates, collecting if needed. */
+        for( ulKey = 0; ulKey < CUT_KEYS; ulKey++ )
+        {
+            TEST_ASSERT_TRUE( setVersion( ulKey, 1000U + ulCut ) );
+        }
+
+        ulCollections += xStore.xStats.ulCollections;
+        TEST_ASSERT_EQUAL_UINT32( 0, cacheErases() );
+        reboot( pxFlash );
+
+        for( ulKey = 0; ulKey < CUT_KEYS; ulKey++ )
+        {
+            TEST_ASSERT_TRUE( hasVersion( ulKey, ( int32_t ) ( 1000U + ulCut ) ) );
+        }
+
+        TEST_ASSERT_EQUAL_UINT32( 0, ulProgramViolations );
+    }
+
+    TEST_ASSERT_GREATER_THAN_UINT32( 0, ulCollections );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+void setUp( void )
+{
+    uint32_t i;
+
+    memset( ullFlash, 0xFF, sizeof( ullFlash ) );
+    memset( ulEraseCount, 0, sizeof( ulEraseCount ) );
+    ulProgramOps = 0;
+    ulEraseOps = 0;
+    ulProgramViolations = 0;
+    ulNowUs = 0;
+
+    for( i = 0; i < CUT_KEYS; i++ )
+    {
+        lCommitted[ i ] = -1;
+        lInFlight[ i ] = -1;
+    }
+
+    srand( 1 );
+    reboot( &xSimFlash );
+}
+
+/* called before each testcase */
+void tearDown( void )
+{
+    TEST_ASSERT_EQUAL_UINT32( 0, ulProgramViolations );
+}
+
+/* called at the beginning of the whole suite */
+void suiteSetUp()
+{
+}
+
+/* called at the end of the whole suite */
+int suiteTearDown( int numFailures )
+{
+    return( numFailures > 0 );
+}
+
+/* =========================  TESTING KVStore  ============================ */
+/*!
+ * @brief An invalid flash description is rejected.
+ */
+void test_Open_InvalidGeometry( void )
+{
+    KVStoreFlash_t xFlash = xSimFlash;
+
+    xFlash.ulPageCount = 3;
+    TEST_ASSERT_FALSE( KVStore_Open( &xStore, &xFlash ) );
+
+    xFlash = xSimFlash;
+    xFlash.ulPageSize = 100;
+    TEST_ASSERT_FALSE( KVStore_Open( &xStore, &xFlash ) );
+
+    xFlash = xSimFlash;
+    xFlash.xProgram = NULL;
+    TEST_ASSERT_FALSE( KVStore_Open( &xStore, &xFlash ) );
+}
+
+/*!
+ * @brief A region with no valid sector imports the former data once, and an
+ * import cut by a reset at any flash operation is started over.
+ */
+void test_Open_ImportsFormerData( void )
+{
+    KVStoreFlash_t xFlash = xSimFlash;
+    uint32_t ulCut = 0, ulKey, i;
+    bool xCompleted;
+
+    xFlash.xImport = simImport;
+
+    do
+    {
+        memset( ullFlash, 0xFF, sizeof( ullFlash ) );
+        memset( ulEraseCount, 0, sizeof( ulEraseCount ) );
+        writeFormerData();
+
+        ulImports = 0;
+        lOpsBeforeCut = ( int32_t ) ulCut++;
+        xPowerLost = false;
+        ( void ) KVStore_Open( &xStore, &xFlash );
+        xCompleted = ( xPowerLost == false );
+
+        if( xCompleted == true )
+        {
+            TEST_ASSERT_EQUAL_UINT32( 1, ulImports );
+        }
+
+        /* Imported again only if the open did not complete. */
+        ulImports = 0;
+        reboot( &xFlash );
+        TEST_ASSERT_EQUAL_UINT32( ( xCompleted == true ) ? 0U : 1U, ulImports );
+
+        for( ulKey = 0; ulKey < FORMER_KEYS; ulKey++ )
+        {
+            TEST_ASSERT_TRUE( hasVersion( ulKey, ( int32_t ) FORMER_VERSION ) );
+        }
+
+        for( i = PAGE_COUNT / 2U; i < PAGE_COUNT; i++ )
+        {
+            TEST_ASSERT_EQUAL_UINT32( 0, ulEraseCount[ i ] );
+        }
+
+        ulImports = 0;
+        reboot( &xFlash );
+        TEST_ASSERT_EQUAL_UINT32( 0, ulImports );
+    } while( xCompleted == false );
+
+    TEST_ASSERT_GREATER_THAN_UINT32( 8, ulCut );
+
+    /* The next collection reuses sector 1. */
+    TEST_ASSERT_TRUE( KVStore_Collect( &xStore ) );
+    TEST_ASSERT_EQUAL_UINT32( 1, xStore.ulActiveSector );
+    TEST_ASSERT_TRUE( hasVersion( 0, ( int32_t ) FORMER_VERSION ) );
+}
+
+/*!
+ * @brief Values come back, without copy or copied, and survive a reboot.
+ */
+void test_SetGet_Reopen( void )
+{
+    const uint8_t * pucValue;
+    uint8_t ucValue[ 400 ];
+    size_t xLength;
+    uint32_t i;
+
+    for( i = 0; i < 10U; i++ )
+    {
+        TEST_ASSERT_TRUE( setVersion( i, i ) );
+    }
+
+    reboot( &xSimFlash );
+    TEST_ASSERT_EQUAL_UINT32( 10, xStore.xStats.ulRecordsScanned );
+    TEST_ASSERT_EQUAL_UINT32( 10, xStore.ulKeyCount );
+
+    for( i = 0; i < 10U; i++ )
+    {
+        TEST_ASSERT_TRUE( hasVersion( i, ( int32_t ) i ) );
+    }
+
+    TEST_ASSERT_TRUE( hasVersion( 10, -1 ) );
+
+    /* The value is read in place and is aligned for the caller. */
+    TEST_ASSERT_TRUE( KVStore_Get( &xStore, "key-3", 5, &pucValue, &xLength ) );
+    TEST_ASSERT_EQUAL( makeValue( 3, 3, ucValue ), xLength );
+    TEST_ASSERT_EQUAL_MEMORY( ucValue, pucValue, xLength );
+    TEST_ASSERT_EQUAL( 0, ( uintptr_t ) pucValue % kvstorePROGRAM_UNIT );
+
+    /* Length only, then a buffer too small. */
+    TEST_ASSERT_TRUE( KVStore_Read( &xStore, "key-3", 5, NULL, 0, &xLength ) );
+    TEST_ASSERT_FALSE( KVStore_Read( &xStore, "key-3", 5, ucValue, xLength - 1U, &xLength ) );
+
+    /* Empty values are values. */
+    TEST_ASSERT_TRUE( KVStore_Set( &xStore, "empty", 5, NULL, 0 ) );
+    reboot( &xSimFlash );
+    TEST_ASSERT_TRUE( KVStore_Read( &xStore, "empty", 5, NULL, 0, &xLength ) );
+    TEST_ASSERT_EQUAL( 0, xLength );
+}
+
+/*!
+ * @brief Updates replace the value, storing the same value costs nothing.
+ */
+void test_Update_UnchangedSkipped( void )
+{
+    uint32_t ulProgramsBefore;
+
+    TEST_ASSERT_TRUE( setVersion( 1, 1 ) );
+    TEST_ASSERT_TRUE( setVersion( 1, 2 ) );
+    TEST_ASSERT_TRUE( hasVersion( 1, 2 ) );
+
+    ulProgramsBefore = ulProgramOps;
+    TEST_ASSERT_TRUE( setVersion( 1, 2 ) );
+    TEST_ASSERT_EQUAL_UINT32( ulProgramsBefore, ulProgramOps );
+    TEST_ASSERT_EQUAL_UINT32( 1, xStore.xStats.ulUnchanged );
+
+    reboot( &xSimFlash );
+    TEST_ASSERT_TRUE( hasVersion( 1, 2 ) );
+    TEST_ASSERT_EQUAL_UINT32( 1, xStore.ulKeyCount );
+}
+
+/*!
+ * @brief A deleted key stays deleted across a reboot.
+ */
+void test_Delete_Reopen( void )
+{
+    TEST_ASSERT_TRUE( setVersion( 1, 1 ) );
+    TEST_ASSERT_TRUE( setVersion( 2, 1 ) );
+    TEST_ASSERT_TRUE( KVStore_Delete( &xStore, "key-1", 5 ) );
+    TEST_ASSERT_TRUE( KVStore_Delete( &xStore, "key-9", 5 ) );
+    TEST_ASSERT_TRUE( hasVersion( 1, -1 ) );
+
+    reboot( &xSimFlash );
+    TEST_ASSERT_TRUE( hasVersion( 1, -1 ) );
+    TEST_ASSERT_TRUE( hasVersion( 2, 1 ) );
+
+    /* The key can come back. */
+    TEST_ASSERT_TRUE( setVersion( 1, 3 ) );
+    reboot( &xSimFlash );
+    TEST_ASSERT_TRUE( hasVersion( 1, 3 ) );
+}
+
+/*!
+ * @brief Keys of colliding hashes are told apart by the key itself.
+ */
+void test_HashCollision( void )
+{
+    /* FNV-1a collision of two 4-byte keys. */
+    static const char cKeyA[] = "costarring";
+    static const char cKeyB[] = "liquid";
+    uint8_t ucValue[ 8 ];
+    size_t xLength;
+
+    TEST_ASSERT_TRUE( KVStore_Set( &xStore, cKeyA, sizeof( cKeyA ) - 1U, "A", 1 ) );
+    TEST_ASSERT_TRUE( KVStore_Set( &xStore, cKeyB, sizeof( cKeyB ) - 1U, "B", 1 ) );
+    TEST_ASSERT_EQUAL_UINT32( xStore.xIndex[ 0 ].ulHash, xStore.xIndex[ 1 ].ulHash );
+
+    reboot( &xSimFlash );
+    TEST_ASSERT_TRUE( KVStore_Read( &xStore, cKeyA, sizeof( cKeyA ) - 1U, ucValue, sizeof( ucValue ), &xLength ) );
+    TEST_ASSERT_EQUAL_UINT8( 'A', ucValue[ 0 ] );
+    TEST_ASSERT_TRUE( KVStore_Read( &xStore, cKeyB, sizeof( cKeyB ) - 1U, ucValue, sizeof( ucValue ), &xLength ) );
+    TEST_ASSERT_EQUAL_UINT8( 'B', ucValue[ 0 ] );
+}
+
+/*!
+ * @brief The collections keep the live values and use both sectors evenly.
+ */
+void test_Collect_KeepsLiveValues( void )
+{
+    uint32_t ulVersion, ulKey, i;
+
+    for( ulVersion = 0; ulVersion < 200U; ulVersion++ )
+    {
+        for( ulKey = 0; ulKey < 4U; ulKey++ )
+        {
+            TEST_ASSERT_TRUE( setVersion( ulKey, ulVersion ) );
+        }
+    }
+
+    TEST_ASSERT_GREATER_THAN_UINT32( 5, xStore.xStats.ulCollections );
+
+    for( ulKey = 0; ulKey < 4U; ulKey++ )
+    {
+        TEST_ASSERT_TRUE( hasVersion( ulKey, 199 ) );
+    }
+
+    reboot( &xSimFlash );
+
+    for( ulKey = 0; ulKey < 4U; ulKey++ )
+    {
+        TEST_ASSERT_TRUE( hasVersion( ulKey, 199 ) );
+    }
+
+    for( i = 1; i < PAGE_COUNT; i++ )
+    {
+        TEST_ASSERT_UINT32_WITHIN( 1, ulEraseCount[ 0 ], ulEraseCount[ i ] );
+    }
+}
+
+/*!
+ * @brief Too many keys or too large a value are refused, the store keeps
+ * working.
+ */
+void test_Limits( void )
+{
+    static uint8_t ucLarge[ SECTOR_SIZE ];
+    char cKey[ kvstoreMAX_KEY_LENGTH + 1U ];
+    uint32_t i;
+
+    for( i = 0; i < kvstoreMAX_KEYS; i++ )
+    {
+        TEST_ASSERT_TRUE( setVersion( i, 0 ) );
+    }
+
+    TEST_ASSERT_FALSE( setVersion( kvstoreMAX_KEYS, 0 ) );
+    TEST_ASSERT_TRUE( KVStore_Delete( &xStore, "key-0", 5 ) );
+    TEST_ASSERT_TRUE( setVersion( kvstoreMAX_KEYS, 0 ) );
+
+    memset( cKey, 'k', sizeof( cKey ) );
+    TEST_ASSERT_FALSE( KVStore_Set( &xStore, cKey, sizeof( cKey ), "v", 1 ) );
+    TEST_ASSERT_FALSE( KVStore_Set( &xStore, "large", 5, ucLarge, sizeof( ucLarge ) ) );
+
+    reboot( &xSimFlash );
+    TEST_ASSERT_TRUE( hasVersion( 0, -1 ) );
+    TEST_ASSERT_TRUE( hasVersion( kvstoreMAX_KEYS, 0 ) );
+}
+
+/*!
+ * @brief Cut the power at every flash operation of a workload: after the
+ * reboot each key holds its last committed value, or the value of the
+ * update in progress, and the store keeps working.
+ */
+void test_PowerCut_Atomic( void )
+{
+    powerCutWorkload( &xSmallFlash );
+}
+
+/*!
+ * @brief The same power cuts with the store programmed through the page
+ * cache, as on the board.
+ */
+void test_PowerCut_AtomicThroughPageCache( void )
+{
+    powerCutWorkload( &xCachedSmallFlash );
+}
+
+/*!
+ * @brief Through the page cache, the programs of a record are merged into
+ * one write back per page, and the flash holds every record once the
+ * update returns.
+ */
+void test_PageCache_MergesRecordPrograms( void )
+{
+    FlashWriterPageStats_t xStats[ flashwriterTRACKED_PAGES + 1U ];
+    uint32_t ulWrites = 0, ulFlushes = 0, ulVersion, ulKey;
+    size_t xCount, i;
+
+    reboot( &xCachedFlash );
+
+    for( ulVersion = 0; ulVersion < 40U; ulVersion++ )
+    {
+        for( ulKey = 0; ulKey < 4U; ulKey++ )
+        {
+            TEST_ASSERT_TRUE( setVersion( ulKey, ulVersion ) );
+        }
+    }
+
+    TEST_ASSERT_GREATER_THAN_UINT32( 0, xStore.xStats.ulCollections );
+    xCount = FlashWriter_PageStats( &xWriter, xStats, flashwriterTRACKED_PAGES + 1U );
+
+    for( i = 0; i < xCount; i++ )
+    {
+        ulWrites += xStats[ i ].ulWrites;
+        ulFlushes += xStats[ i ].ulFlushes;
+    }
+
+    printf( "kv_store: page cache, %u programs merged into %u write backs\n",
+            ( unsigned ) ulWrites, ( unsigned ) ulFlushes );
+    TEST_ASSERT_LESS_THAN_UINT32( ulWrites, ulFlushes );
+    TEST_ASSERT_EQUAL_UINT32( 0, cacheErases() );
+
+    /* Nothing is left in the cache: the direct view of the flash has it all. */
+    reboot( &xSimFlash );
+
+    for( ulKey = 0; ulKey < 4U; ulKey++ )
+    {
+        TEST_ASSERT_TRUE( hasVersion( ulKey, 39 ) );
+    }
+}
+
+/*!
+ * @brief Boot time lookup cost, write amplification and collection pause of
+ * the board store holding the PKCS #11 objects and the setup settings.
+ */
+void test_Benchmark_BoardWorkload( void )
+{
+    static uint8_t ucObject[ 3 ][ 2048 ];
+    static const size_t xObjectLength[ 3 ] = { 1220, 1679, 178 };
+    static const char * const pcLabels[ 3 ] =
+    {
+        "Device Cert", "Device Priv TLS Key", "Code Verify Key"
+    };
+    struct timespec xStart, xEnd;
+    const uint8_t * pucValue;
+    uint8_t ucSetting[ 64 ];
+    double dOpenNs, dLookupNs;
+    size_t xLength;
+    uint32_t i, ulBoot, ulScanned, ulLookups = 0;
+
+    for( i = 0; i < 3U; i++ )
+    {
+        memset( ucObject[ i ], ( int ) ( 0x30U + i ), sizeof( ucObject[ i ] ) );
+    }
+
+    /* 300 boots: provisioning saves the same objects, and one setting of
+     * eight changes every boot. */
+    for( ulBoot = 0; ulBoot < 300U; ulBoot++ )
+    {
+        for( i = 0; i < 3U; i++ )
+        {
+            TEST_ASSERT_TRUE( KVStore_Set( &xStore, pcLabels[ i ], strlen( pcLabels[ i ] ),
+                                           ucObject[ i ], xObjectLength[ i ] ) );
+        }
+
+        memset( ucSetting, ( int ) ulBoot, sizeof( ucSetting ) );
+        ucSetting[ 0 ] = ( uint8_t ) ( ulBoot % 8U );
+        TEST_ASSERT_TRUE( KVStore_Set( &xStore, &ucSetting[ 0 ], 1, ucSetting, sizeof( ucSetting ) ) );
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &xStart );
+
+    for( i = 0; i < 1000U; i++ )
+    {
+        TEST_ASSERT_TRUE( KVStore_Open( &xStore, &xSimFlash ) );
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &xEnd );
+    dOpenNs = ( ( double ) ( xEnd.tv_sec - xStart.tv_sec ) * 1e9 + ( double ) ( xEnd.tv_nsec - xStart.tv_nsec ) ) / 1000.0;
+    ulScanned = xStore.xStats.ulRecordsScanned;
+
+    clock_gettime( CLOCK_MONOTONIC, &xStart );
+
+    for( i = 0; i < 100000U; i++ )
+    {
+        ulLookups += KVStore_Get( &xStore, pcLabels[ i % 3U ], strlen( pcLabels[ i % 3U ] ), &pucValue, &xLength ) ? 1U : 0U;
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &xEnd );
+    dLookupNs = ( ( double ) ( xEnd.tv_sec - xStart.tv_sec ) * 1e9 + ( double ) ( xEnd.tv_nsec - xStart.tv_nsec ) ) / 100000.0;
+    TEST_ASSERT_EQUAL_UINT32( 100000U, ulLookups );
+
+    /* The counters of the workload were cleared by the reopens: replay it
+     * on a fresh store. */
+    setUp();
+
+    for( ulBoot = 0; ulBoot < 300U; ulBoot++ )
+    {
+        for( i = 0; i < 3U; i++ )
+        {
+            TEST_ASSERT_TRUE( KVStore_Set( &xStore, pcLabels[ i ], strlen( pcLabels[ i ] ),
+                                           ucObject[ i ], xObjectLength[ i ] ) );
+        }
+
+        memset( ucSetting, ( int ) ulBoot, sizeof( ucSetting ) );
+        ucSetting[ 0 ] = ( uint8_t ) ( ulBoot % 8U );
+        TEST_ASSERT_TRUE( KVStore_Set( &xStore, &ucSetting[ 0 ], 1, ucSetting, sizeof( ucSetting ) ) );
+    }
+
+    printf( "kv_store: open %.0f ns (%u records), lookup %.0f ns\n",
+            dOpenNs, ( unsigned ) ulScanned, dLookupNs );
+    printf( "kv_store: write amplification %.2f, %u erases, %u collections, max pause %u us\n",
+            ( double ) xStore.xStats.ulBytesProgrammed / xStore.xStats.ulBytesWritten,
+            ( unsigned ) xStore.xStats.ulErases, ( unsigned ) xStore.xStats.ulCollections,
+            ( unsigned ) xStore.xStats.ulMaxCollectUs );
+
+    /* The objects are written once, the settings are appended. */
+    TEST_ASSERT_EQUAL_UINT32( 897, xStore.xStats.ulUnchanged );
+    TEST_ASSERT_LESS_THAN_UINT32( 5, xStore.xStats.ulCollections );
+    TEST_ASSERT_LESS_THAN_UINT32( 2U * ( PAGE_COUNT / 2U ) * ( ERASE_TIME_US + 2000U ), xStore.xStats.ulMaxCollectUs );
+}
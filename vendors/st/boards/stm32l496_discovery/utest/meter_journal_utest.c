@@ -0,0 +1,541 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "unity.h"
+
+#include "meter_journal.h"
+
+/* Geometry of the simulated flash: STM32L4 pages, a small region so the
+ * tests wrap around quickly. */
+#define PAGE_SIZE                ( 2048U )
+#define PAGE_COUNT               ( 8U )
+#define SLOTS_PER_PAGE           ( PAGE_SIZE / meterjournalSLOT_SIZE )
+#define RECORDS_PER_PAGE         ( SLOTS_PER_PAGE - 1U )
+#define CAPACITY                 ( PAGE_COUNT * RECORDS_PER_PAGE )
+
+/* STM32L4 datasheet, typical: double word programming, page erase. */
+#define PROGRAM_TIME_US          ( 81.7 )
+#define ERASE_TIME_US            ( 22020.0 )
+
+/* Workload of the power cut test. */
+#define CUT_WORKLOAD_STEPS       ( 400U )
+#define CUT_DRAIN_PERIOD         ( 3U )
+#define CUT_DRAIN_BATCH          ( 5U )
+
+/* ============================  GLOBAL VARIABLES =========================== */
+
+static uint64_t ullFlash[ ( PAGE_COUNT * PAGE_SIZE ) / sizeof( uint64_t ) ];
+static uint8_t * const pucFlash = ( uint8_t * ) ullFlash;
+static uint32_t ulEraseCount[ PAGE_COUNT ];
+
+static uint32_t ulProgramOps;
+static uint32_t ulEraseOps;
+static uint32_t ulProgramViolations;
+
+/* Flash operations (double words and page erases) left before the power
+ * is cut, negative when no cut is armed. */
+static int32_t lOpsBeforeCut;
+static bool xPowerLost;
+
+static MeterJournal_t xJournal;
+static MeterJournalEntry_t xEntries[ CAPACITY ];
+
+/* Reference model of the power cut test. */
+static uint8_t ucAppended[ 2048 ];  /* Indexed by sequence: 1 appended, 2 handed to consume. */
+
+/* ===========================  Flash simulator  ============================ */
+
+static bool opCutsPower( void )
+{
+    if( lOpsBeforeCut < 0 )
+    {
+        return false;
+    }
+
+    if( lOpsBeforeCut == 0 )
+    {
+        xPowerLost = true;
+
+        return true;
+    }
+
+    lOpsBeforeCut--;
+
+    return false;
+}
+
+static int32_t simErase( void * pvContext,
+                         uint32_t ulOffset )
+{
+    uint32_t i;
+
+    TEST_ASSERT_EQUAL_PTR( ullFlash, pvContext );
+    TEST_ASSERT_EQUAL( 0, ulOffset % PAGE_SIZE );
+
+    if( xPowerLost == true )
+    {
+        return -1;
+    }
+
+    if( opCutsPower() == true )
+    {
+        /* Interrupted erase: the page is left in an undefined state. */
+        for( i = 0; i < PAGE_SIZE; i++ )
+        {
+            pucFlash[ ulOffset + i ] = ( ( rand() & 1 ) != 0 ) ? 0xFFU : ( uint8_t ) rand();
+        }
+
+        return -1;
+    }
+
+    memset( &pucFlash[ ulOffset ], 0xFF, PAGE_SIZE );
+    ulEraseCount[ ulOffset / PAGE_SIZE ]++;
+    ulEraseOps++;
+
+    return 0;
+}
+
+static int32_t simProgram( void * pvContext,
+                           uint32_t ulOffset,
+                           const void * pvData,
+                           uint32_t ulLength )
+{
+    const uint8_t * pucData = pvData;
+    uint32_t i, j;
+
+    TEST_ASSERT_EQUAL_PTR( ullFlash, pvContext );
+    TEST_ASSERT_EQUAL( 0, ulOffset % meterjournalPROGRAM_UNIT );
+    TEST_ASSERT_EQUAL( 0, ulLength % meterjournalPROGRAM_UNIT );
+    TEST_ASSERT_EQUAL( 0, ( uintptr_t ) pvData % meterjournalPROGRAM_UNIT );
+
+    for( i = 0; i < ulLength; i += meterjournalPROGRAM_UNIT )
+    {
+        if( xPowerLost == true )
+        {
+            return -1;
+        }
+
+        /* Like the L4 controller, refuse to program a used double word. */
+        for( j = 0; j < meterjournalPROGRAM_UNIT; j++ )
+        {
+            if( pucFlash[ ulOffset + i + j ] != 0xFFU )
+            {
+                ulProgramViolations++;
+
+                return -1;
+            }
+        }
+
+        if( opCutsPower() == true )
+        {
+            /* Interrupted program: some bits of the double word are set. */
+            for( j = 0; j < meterjournalPROGRAM_UNIT; j++ )
+            {
+                pucFlash[ ulOffset + i + j ] = pucData[ i + j ] | ( uint8_t ) rand();
+            }
+
+            return -1;
+        }
+
+        memcpy( &pucFlash[ ulOffset + i ], &pucData[ i ], meterjournalPROGRAM_UNIT );
+        ulProgramOps++;
+    }
+
+    return 0;
+}
+
+static const MeterJournalFlash_t xSimFlash =
+{
+    .pucBase     = ( const volatile uint8_t * ) ullFlash,
+    .ulPageSize  = PAGE_SIZE,
+    .ulPageCount = PAGE_COUNT,
+    .xErase      = simErase,
+    .xProgram    = simProgram,
+    .pvContext   = ullFlash
+};
+
+/* ==========================  Helper functions  ============================ */
+
+static void makeReading( uint32_t ulSequence,
+                         MeterReading_t * pxReading )
+{
+    memset( pxReading, 0, sizeof( *pxReading ) );
+    pxReading->ullMeterId = 0x00A0B0C0D0E0ULL + ulSequence;
+    pxReading->ullAmount = ( uint64_t ) ulSequence * 1000U;
+    pxReading->ullReverseAmount = ulSequence & 0xFFU;
+    pxReading->usLDay = ( uint16_t ) ulSequence;
+    pxReading->usBDay = ( uint16_t ) ( ulSequence >> 16 );
+    pxReading->usOp = 0xFE00;
+    pxReading->ucStationId = ( uint8_t ) ( 1U + ( ulSequence % 32U ) );
+    pxReading->ucAmountPlaces = 1;
+    pxReading->ucReverseAmountPlaces = 2;
+}
+
+static void checkEntry( const MeterJournalEntry_t * pxEntry )
+{
+    MeterReading_t xExpected;
+
+    makeReading( pxEntry->ulSequence, &xExpected );
+    TEST_ASSERT_EQUAL_UINT32( pxEntry->ulSequence * 10U, pxEntry->ulTimestamp );
+    TEST_ASSERT_EQUAL_UINT64( xExpected.ullMeterId, pxEntry->xReading.ullMeterId );
+    TEST_ASSERT_EQUAL_UINT64( xExpected.ullAmount, pxEntry->xReading.ullAmount );
+    TEST_ASSERT_EQUAL_UINT64( xExpected.ullReverseAmount, pxEntry->xReading.ullReverseAmount );
+    TEST_ASSERT_EQUAL_UINT16( xExpected.usLDay, pxEntry->xReading.usLDay );
+    TEST_ASSERT_EQUAL_UINT16( xExpected.usBDay, pxEntry->xReading.usBDay );
+    TEST_ASSERT_EQUAL_UINT16( xExpected.usOp, pxEntry->xReading.usOp );
+    TEST_ASSERT_EQUAL_UINT8( xExpected.ucStationId, pxEntry->xReading.ucStationId );
+    TEST_ASSERT_EQUAL_UINT8( xExpected.ucAmountPlaces, pxEntry->xReading.ucAmountPlaces );
+    TEST_ASSERT_EQUAL_UINT8( xExpected.ucReverseAmountPlaces, pxEntry->xReading.ucReverseAmountPlaces );
+}
+
+static bool appendNext( void )
+{
+    MeterReading_t xReading;
+    uint32_t ulSequence = xJournal.ulNextSequence;
+
+    makeReading( ulSequence, &xReading );
+
+    return MeterJournal_Append( &xJournal, ulSequence * 10U, &xReading );
+}
+
+static void reboot( void )
+{
+    lOpsBeforeCut = -1;
+    xPowerLost = false;
+    TEST_ASSERT_TRUE( MeterJournal_Open( &xJournal, &xSimFlash ) );
+}
+
+/* Drain up to xBatch records as the MQTT task does. */
+static size_t drain( size_t xBatch )
+{
+    size_t xCount = MeterJournal_Peek( &xJournal, xEntries, xBatch );
+
+    if( xCount > 0U )
+    {
+        TEST_ASSERT_EQUAL( xCount, MeterJournal_Consume( &xJournal, xEntries[ xCount - 1U ].ulSequence ) );
+    }
+
+    return xCount;
+}
+
+/* Run the power cut workload, tracking what reached the journal. */
+static void runWorkload( void )
+{
+    size_t xCount, i;
+    uint32_t ulStep, ulSequence;
+
+    for( ulStep = 0; ( ulStep < CUT_WORKLOAD_STEPS ) && ( xPowerLost == false ); ulStep++ )
+    {
+        ulSequence = xJournal.ulNextSequence;
+
+        if( appendNext() == true )
+        {
+            ucAppended[ ulSequence ] = 1;
+        }
+
+        if( ( ulStep % CUT_DRAIN_PERIOD ) == ( CUT_DRAIN_PERIOD - 1U ) )
+        {
+            xCount = MeterJournal_Peek( &xJournal, xEntries, CUT_DRAIN_BATCH );
+
+            if( xCount > 0U )
+            {
+                for( i = 0; i < xCount; i++ )
+                {
+                    ucAppended[ xEntries[ i ].ulSequence ] = 2;
+                }
+
+                ( void ) MeterJournal_Consume( &xJournal, xEntries[ xCount - 1U ].ulSequence );
+            }
+        }
+    }
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+void setUp( void )
+{
+    memset( ullFlash, 0xFF, sizeof( ullFlash ) );
+    memset( ulEraseCount, 0, sizeof( ulEraseCount ) );
+    memset( ucAppended, 0, sizeof( ucAppended ) );
+    ulProgramOps = 0;
+    ulEraseOps = 0;
+    ulProgramViolations = 0;
+    srand( 1 );
+    reboot();
+}
+
+/* called before each testcase */
+void tearDown( void )
+{
+    TEST_ASSERT_EQUAL_UINT32( 0, ulProgramViolations );
+}
+
+/* called at the beginning of the whole suite */
+void suiteSetUp()
+{
+}
+
+/* called at the end of the whole suite */
+int suiteTearDown( int numFailures )
+{
+    return( numFailures > 0 );
+}
+
+/* ========================  TESTING MeterJournal  ========================= */
+/*!
+ * @brief An invalid flash description is rejected.
+ */
+void test_Open_InvalidGeometry( void )
+{
+    MeterJournalFlash_t xFlash = xSimFlash;
+
+    xFlash.ulPageCount = 1;
+    TEST_ASSERT_FALSE( MeterJournal_Open( &xJournal, &xFlash ) );
+
+    xFlash = xSimFlash;
+    xFlash.ulPageSize = 100;
+    TEST_ASSERT_FALSE( MeterJournal_Open( &xJournal, &xFlash ) );
+
+    xFlash = xSimFlash;
+    xFlash.xProgram = NULL;
+    TEST_ASSERT_FALSE( MeterJournal_Open( &xJournal, &xFlash ) );
+}
+
+/*!
+ * @brief Records come back in order and survive a reboot.
+ */
+void test_AppendPeek_Reopen( void )
+{
+    size_t i;
+
+    TEST_ASSERT_EQUAL_UINT32( 0, MeterJournal_Pending( &xJournal ) );
+    TEST_ASSERT_EQUAL( 0, MeterJournal_Peek( &xJournal, xEntries, CAPACITY ) );
+
+    for( i = 0; i < 100U; i++ )
+    {
+        TEST_ASSERT_TRUE( appendNext() );
+    }
+
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32( 100, MeterJournal_Pending( &xJournal ) );
+    TEST_ASSERT_EQUAL( 100, MeterJournal_Peek( &xJournal, xEntries, CAPACITY ) );
+
+    for( i = 0; i < 100U; i++ )
+    {
+        TEST_ASSERT_EQUAL_UINT32( i + 1U, xEntries[ i ].ulSequence );
+        checkEntry( &xEntries[ i ] );
+    }
+
+    /* Sequence numbers continue after the reboot. */
+    TEST_ASSERT_TRUE( appendNext() );
+    TEST_ASSERT_EQUAL( 101, MeterJournal_Peek( &xJournal, xEntries, CAPACITY ) );
+    TEST_ASSERT_EQUAL_UINT32( 101, xEntries[ 100 ].ulSequence );
+}
+
+/*!
+ * @brief Delivered records are not returned again, also after a reboot.
+ */
+void test_Consume( void )
+{
+    size_t i;
+
+    for( i = 0; i < 50U; i++ )
+    {
+        TEST_ASSERT_TRUE( appendNext() );
+    }
+
+    TEST_ASSERT_EQUAL( 20, MeterJournal_Consume( &xJournal, 20 ) );
+    TEST_ASSERT_EQUAL( 0, MeterJournal_Consume( &xJournal, 20 ) );
+    TEST_ASSERT_EQUAL_UINT32( 30, MeterJournal_Pending( &xJournal ) );
+
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32( 30, MeterJournal_Pending( &xJournal ) );
+    TEST_ASSERT_EQUAL( 30, MeterJournal_Peek( &xJournal, xEntries, CAPACITY ) );
+    TEST_ASSERT_EQUAL_UINT32( 21, xEntries[ 0 ].ulSequence );
+
+    TEST_ASSERT_EQUAL( 30, MeterJournal_Consume( &xJournal, 1000 ) );
+    TEST_ASSERT_EQUAL_UINT32( 0, MeterJournal_Pending( &xJournal ) );
+
+    reboot();
+    TEST_ASSERT_EQUAL( 0, MeterJournal_Peek( &xJournal, xEntries, CAPACITY ) );
+    TEST_ASSERT_TRUE( appendNext() );
+    TEST_ASSERT_EQUAL( 1, MeterJournal_Peek( &xJournal, xEntries, CAPACITY ) );
+    TEST_ASSERT_EQUAL_UINT32( 51, xEntries[ 0 ].ulSequence );
+}
+
+/*!
+ * @brief A full journal gives up its oldest page and keeps the newest records.
+ */
+void test_Full_DropsOldestPage( void )
+{
+    size_t i, xCount;
+
+    for( i = 0; i < CAPACITY + 10U; i++ )
+    {
+        TEST_ASSERT_TRUE( appendNext() );
+    }
+
+    TEST_ASSERT_EQUAL_UINT32( RECORDS_PER_PAGE, xJournal.xStats.ulDropped );
+    TEST_ASSERT_EQUAL_UINT32( CAPACITY + 10U - RECORDS_PER_PAGE, MeterJournal_Pending( &xJournal ) );
+
+    reboot();
+    xCount = MeterJournal_Peek( &xJournal, xEntries, CAPACITY );
+    TEST_ASSERT_EQUAL( CAPACITY + 10U - RECORDS_PER_PAGE, xCount );
+    TEST_ASSERT_EQUAL_UINT32( RECORDS_PER_PAGE + 1U, xEntries[ 0 ].ulSequence );
+
+    for( i = 1; i < xCount; i++ )
+    {
+        TEST_ASSERT_EQUAL_UINT32( xEntries[ i - 1U ].ulSequence + 1U, xEntries[ i ].ulSequence );
+        checkEntry( &xEntries[ i ] );
+    }
+}
+
+/*!
+ * @brief Pages are erased in turn.
+ */
+void test_WearLevelling( void )
+{
+    uint32_t ulMin = UINT32_MAX, ulMax = 0, i;
+
+    for( i = 0; i < 20U * CAPACITY; i++ )
+    {
+        TEST_ASSERT_TRUE( appendNext() );
+
+        if( ( i % 7U ) == 6U )
+        {
+            drain( 7 );
+        }
+    }
+
+    for( i = 0; i < PAGE_COUNT; i++ )
+    {
+        ulMin = ( ulEraseCount[ i ] < ulMin ) ? ulEraseCount[ i ] : ulMin;
+        ulMax = ( ulEraseCount[ i ] > ulMax ) ? ulEraseCount[ i ] : ulMax;
+    }
+
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32( ulMin + 1U, ulMax );
+    TEST_ASSERT_EQUAL_UINT32( ulMax, xJournal.xStats.ulMaxEraseCount );
+    TEST_ASSERT_EQUAL_UINT32( 0, xJournal.xStats.ulDropped );
+
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32( ulMax, xJournal.xStats.ulMaxEraseCount );
+}
+
+/*!
+ * @brief Cut the power at every flash operation of a workload: after the
+ * reboot every record that was appended and not handed to consume is still
+ * pending, in order, and the journal keeps working.
+ */
+void test_PowerCut_NoLoss( void )
+{
+    uint32_t ulOps, ulCut, ulSequence;
+    size_t xCount, i;
+
+    /* Count the operations of an uninterrupted run. */
+    runWorkload();
+    ulOps = ulProgramOps + ulEraseOps;
+    TEST_ASSERT_EQUAL_UINT32( 0, xJournal.xStats.ulDropped );
+
+    for( ulCut = 0; ulCut < ulOps; ulCut++ )
+    {
+        setUp();
+        lOpsBeforeCut = ( int32_t ) ulCut;
+        runWorkload();
+        TEST_ASSERT_TRUE( xPowerLost );
+
+        reboot();
+        xCount = MeterJournal_Peek( &xJournal, xEntries, CAPACITY );
+        TEST_ASSERT_EQUAL( MeterJournal_Pending( &xJournal ), xCount );
+
+        for( i = 0; i < xCount; i++ )
+        {
+            /* Nothing that was not appended shows up... */
+            TEST_ASSERT_NOT_EQUAL( 0, ucAppended[ xEntries[ i ].ulSequence ] );
+            checkEntry( &xEntries[ i ] );
+
+            if( i > 0U )
+            {
+                TEST_ASSERT_GREATER_THAN_UINT32( xEntries[ i - 1U ].ulSequence, xEntries[ i ].ulSequence );
+            }
+
+            ucAppended[ xEntries[ i ].ulSequence ] = 0;
+        }
+
+        /* ...and everything not delivered does. */
+        for( ulSequence = 0; ulSequence < sizeof( ucAppended ); ulSequence++ )
+        {
+            if( ucAppended[ ulSequence ] == 1U )
+            {
+                TEST_FAIL_MESSAGE( "Pending record lost across a power cut." );
+            }
+        }
+
+        /* The recovered journal accepts new records. */
+        ulSequence = xJournal.ulNextSequence;
+        TEST_ASSERT_TRUE( appendNext() );
+        TEST_ASSERT_EQUAL( xCount + 1U, MeterJournal_Peek( &xJournal, xEntries, CAPACITY ) );
+        TEST_ASSERT_EQUAL_UINT32( ulSequence, xEntries[ xCount ].ulSequence );
+        TEST_ASSERT_EQUAL_UINT32( 0, ulProgramViolations );
+    }
+}
+
+/*!
+ * @brief Flash cost and modelled throughput of appends on the STM32L4.
+ */
+void test_Benchmark_AppendThroughput( void )
+{
+    const uint32_t ulRecords = 100U * CAPACITY;
+    struct timespec xStart, xEnd;
+    double dHostNs, dFlashUs;
+    uint32_t i;
+
+    clock_gettime( CLOCK_MONOTONIC, &xStart );
+
+    for( i = 0; i < ulRecords; i++ )
+    {
+        TEST_ASSERT_TRUE( appendNext() );
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &xEnd );
+
+    dHostNs = ( ( double ) ( xEnd.tv_sec - xStart.tv_sec ) * 1e9 + ( double ) ( xEnd.tv_nsec - xStart.tv_nsec ) ) /
+              ulRecords;
+    dFlashUs = ( ( ulProgramOps * PROGRAM_TIME_US ) + ( ulEraseOps * ERASE_TIME_US ) ) / ulRecords;
+
+    printf( "meter_journal: %.2f double words and %.4f erases per record\n",
+            ( double ) ulProgramOps / ulRecords, ( double ) ulEraseOps / ulRecords );
+    printf( "meter_journal: host %.0f ns per append, L4 flash %.0f us per append (%.0f records/s)\n",
+            dHostNs, dFlashUs, 1e6 / dFlashUs );
+
+    /* Appends are O(1): seven double words, plus one page every 31 records. */
+    TEST_ASSERT_EQUAL_UINT32( 7U * ulRecords + ( 3U * ulEraseOps ), ulProgramOps );
+    TEST_ASSERT_UINT32_WITHIN( 1, ulRecords / RECORDS_PER_PAGE, ulEraseOps );
+}
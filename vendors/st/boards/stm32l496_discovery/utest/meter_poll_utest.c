@@ -0,0 +1,424 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity.h"
+
+#include "modbus_rtu.h"
+#include "meter_poll.h"
+
+/* The simulated bus counts time in microseconds at 9600 bit/s. */
+#define CHAR_US             ( 1042U )
+#define GAP_US              ( ( 7U * CHAR_US ) / 2U )
+#define REPLY_TIMEOUT_US    ( 200000U )
+#define METER_LATENCY_US    ( 5000U )
+#define MAX_RETRIES         ( 2U )
+
+/* Time from a request leaving to its reply being delimited. */
+#define TRANSACTION_US                                          \
+    ( ( meterpollREQUEST_LENGTH * CHAR_US ) + METER_LATENCY_US + \
+      ( meterpollREPLY_LENGTH * CHAR_US ) + GAP_US )
+
+/* ============================  GLOBAL VARIABLES =========================== */
+
+/* Meter reply captured on site, request 01 03 05 04 00 14. The CRC was
+ * not captured, buildReply() fills it in. */
+static const uint8_t ucMeterReply[] =
+{
+    0x01, 0x03, 0x28, 0xF0, 0x01, 0x05, 0x00, 0x00,
+    0x00, 0x00, 0x01, 0x06, 0x00, 0xFF, 0xE0, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x68, 0x08,
+    0xFF, 0xF8, 0x59, 0x47, 0x4D, 0x34, 0x00, 0xFE,
+    0x00, 0xFE, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+/* A virtual meter on the simulated bus. */
+typedef struct VirtualMeter
+{
+    bool xPresent;
+    uint8_t ucCorruptReplies;   /* Replies sent with a broken CRC. */
+    uint8_t ucSilentRequests;   /* Requests left unanswered. */
+} VirtualMeter_t;
+
+static VirtualMeter_t xMeters[ 256 ];
+static MeterPoll_t xPoll;
+static uint32_t ulNow;
+static uint32_t ulRequestsOnBus;
+
+/* The reply in flight on the bus, if any. */
+static bool xReplyPending;
+static uint32_t ulReplyTime;
+static uint8_t ucReply[ meterpollREPLY_LENGTH ];
+
+/* ==========================  Helper functions  ============================ */
+
+static void buildReply( uint8_t ucAddress,
+                        uint8_t * pucReply )
+{
+    uint16_t usCrc;
+
+    memcpy( pucReply, ucMeterReply, meterpollREPLY_LENGTH );
+    pucReply[ 0 ] = ucAddress;
+
+    /* Make every meter number and amount distinct. */
+    pucReply[ 36 ] = ucAddress;
+    pucReply[ 2 ] = ( uint8_t ) ( ucAddress + 1U );
+
+    usCrc = ModbusRtu_Crc16( pucReply, meterpollREPLY_LENGTH - 2U );
+    pucReply[ meterpollREPLY_LENGTH - 2U ] = ( uint8_t ) ( usCrc & 0xFFU );
+    pucReply[ meterpollREPLY_LENGTH - 1U ] = ( uint8_t ) ( usCrc >> 8 );
+}
+
+/* Transport of the scheduler: the addressed virtual meter answers. */
+static void busSend( void * pvContext,
+                     const uint8_t * pucRequest,
+                     size_t xLength )
+{
+    VirtualMeter_t * pxMeter = &xMeters[ pucRequest[ 0 ] ];
+
+    TEST_ASSERT_EQUAL_PTR( &xPoll, pvContext );
+    TEST_ASSERT_EQUAL( meterpollREQUEST_LENGTH, xLength );
+    TEST_ASSERT_TRUE( ModbusRtu_CrcValid( pucRequest, xLength ) );
+    TEST_ASSERT_FALSE( xReplyPending );
+
+    ulRequestsOnBus++;
+
+    if( pxMeter->xPresent == false )
+    {
+        return;
+    }
+
+    if( pxMeter->ucSilentRequests > 0U )
+    {
+        pxMeter->ucSilentRequests--;
+
+        return;
+    }
+
+    buildReply( pucRequest[ 0 ], ucReply );
+
+    if( pxMeter->ucCorruptReplies > 0U )
+    {
+        pxMeter->ucCorruptReplies--;
+        ucReply[ 10 ] ^= 0x40U;
+    }
+
+    xReplyPending = true;
+    ulReplyTime = ulNow + TRANSACTION_US;
+}
+
+/* Run one round on the simulated bus, return its duration. */
+static uint32_t runRound( void )
+{
+    uint32_t ulStart = ulNow, ulDelay;
+
+    MeterPoll_StartRound( &xPoll, ulNow );
+    ulDelay = MeterPoll_Step( &xPoll, ulNow, NULL, 0 );
+
+    while( ulDelay != meterpollROUND_COMPLETE )
+    {
+        if( ( xReplyPending == true ) && ( ( ulReplyTime - ulNow ) <= ulDelay ) )
+        {
+            ulNow = ulReplyTime;
+            xReplyPending = false;
+            ulDelay = MeterPoll_Step( &xPoll, ulNow, ucReply, sizeof( ucReply ) );
+        }
+        else
+        {
+            ulNow += ulDelay;
+            ulDelay = MeterPoll_Step( &xPoll, ulNow, NULL, 0 );
+        }
+    }
+
+    TEST_ASSERT_FALSE( xReplyPending );
+    TEST_ASSERT_EQUAL_UINT32( ulNow - ulStart, xPoll.ulLastRoundTime );
+
+    return ulNow - ulStart;
+}
+
+static void initPoll( uint8_t ucStationCount,
+                      uint32_t ulTurnaround )
+{
+    MeterPollConfig_t xConfig = { 0 };
+    uint8_t ucAddresses[ meterpollMAX_STATIONS ];
+    uint8_t i;
+
+    for( i = 0; i < ucStationCount; i++ )
+    {
+        ucAddresses[ i ] = ( uint8_t ) ( i + 1U );
+        xMeters[ i + 1U ].xPresent = true;
+    }
+
+    xConfig.usStartRegister = 0x0504;
+    xConfig.usRegisterCount = 0x14;
+    xConfig.ulReplyTimeout = REPLY_TIMEOUT_US;
+    xConfig.ulTurnaround = ulTurnaround;
+    xConfig.ucMaxRetries = MAX_RETRIES;
+    xConfig.xSend = busSend;
+    xConfig.pvSendContext = &xPoll;
+
+    MeterPoll_Init( &xPoll, &xConfig, ucAddresses, ucStationCount );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+void setUp( void )
+{
+    memset( xMeters, 0, sizeof( xMeters ) );
+    ulNow = 0x7FFFF000U; /* Close to a wrap of the clock. */
+    ulRequestsOnBus = 0;
+    xReplyPending = false;
+}
+
+/* called before each testcase */
+void tearDown( void )
+{
+}
+
+/* called at the beginning of the whole suite */
+void suiteSetUp()
+{
+}
+
+/* called at the end of the whole suite */
+int suiteTearDown( int numFailures )
+{
+    return( numFailures > 0 );
+}
+
+/* ==================  TESTING request and reply codec  ==================== */
+/*!
+ * @brief The request is the one the single meter reader used to send.
+ */
+void test_ComposeRequest( void )
+{
+    const uint8_t ucExpected[] = { 0x01, 0x03, 0x05, 0x04, 0x00, 0x14, 0x04, 0xC8 };
+    uint8_t ucRequest[ meterpollREQUEST_LENGTH ];
+
+    MeterPoll_ComposeRequest( ucRequest, 1, 0x0504, 0x14 );
+    TEST_ASSERT_EQUAL_HEX8_ARRAY( ucExpected, ucRequest, sizeof( ucExpected ) );
+}
+
+/*!
+ * @brief Fields decode to the values the original reader published.
+ */
+void test_DecodeReading_MatchesLegacyDecoder( void )
+{
+    uint8_t ucFrame[ sizeof( ucMeterReply ) ];
+    uint8_t rsp[ 45 ];
+    MeterReading_t xReading;
+
+    buildReply( 1, ucFrame );
+    TEST_ASSERT_TRUE( MeterPoll_DecodeReading( ucFrame, sizeof( ucFrame ), &xReading ) );
+
+    /* Buffer as the bit-banged reader saw it. */
+    rsp[ 0 ] = 0x00;
+    memcpy( &rsp[ 1 ], ucFrame, sizeof( rsp ) - 1U );
+
+    TEST_ASSERT_EQUAL_UINT8( 0x01, xReading.ucStationId );
+    TEST_ASSERT_EQUAL_HEX64( ( ( uint64_t ) rsp[ 8 ] << 40 ) | ( ( uint64_t ) rsp[ 7 ] << 32 ) |
+                             ( ( uint64_t ) rsp[ 6 ] << 24 ) | ( ( uint64_t ) rsp[ 5 ] << 16 ) |
+                             ( ( uint64_t ) rsp[ 4 ] << 8 ) | rsp[ 3 ],
+                             xReading.ullAmount );
+    TEST_ASSERT_EQUAL_UINT8( rsp[ 10 ], xReading.ucAmountPlaces );
+    TEST_ASSERT_EQUAL_HEX64( ( ( uint64_t ) rsp[ 16 ] << 40 ) | ( ( uint64_t ) rsp[ 15 ] << 32 ) |
+                             ( ( uint64_t ) rsp[ 14 ] << 24 ) | ( ( uint64_t ) rsp[ 13 ] << 16 ) |
+                             ( ( uint64_t ) rsp[ 12 ] << 8 ) | rsp[ 11 ],
+                             xReading.ullReverseAmount );
+    TEST_ASSERT_EQUAL_UINT8( rsp[ 18 ], xReading.ucReverseAmountPlaces );
+    TEST_ASSERT_EQUAL_HEX16( ( rsp[ 20 ] << 8 ) | rsp[ 19 ], xReading.usLDay );
+    TEST_ASSERT_EQUAL_HEX16( ( rsp[ 22 ] << 8 ) | rsp[ 21 ], xReading.usNDay );
+    TEST_ASSERT_EQUAL_HEX16( ( rsp[ 24 ] << 8 ) | rsp[ 23 ], xReading.usODay );
+    TEST_ASSERT_EQUAL_HEX16( ( rsp[ 26 ] << 8 ) | rsp[ 25 ], xReading.usUDay );
+    TEST_ASSERT_EQUAL_HEX16( ( rsp[ 28 ] << 8 ) | rsp[ 27 ], xReading.usHDay );
+    TEST_ASSERT_EQUAL_HEX16( ( rsp[ 30 ] << 8 ) | rsp[ 29 ], xReading.usBDay );
+    TEST_ASSERT_EQUAL_HEX16( ( rsp[ 33 ] << 8 ) | rsp[ 31 ], xReading.usOp );
+    TEST_ASSERT_EQUAL_HEX64( ( ( uint64_t ) rsp[ 42 ] << 40 ) | ( ( uint64_t ) rsp[ 41 ] << 32 ) |
+                             ( ( uint64_t ) rsp[ 40 ] << 24 ) | ( ( uint64_t ) rsp[ 39 ] << 16 ) |
+                             ( ( uint64_t ) rsp[ 38 ] << 8 ) | rsp[ 37 ],
+                             xReading.ullMeterId );
+}
+
+/*!
+ * @brief Truncated, corrupted or exception replies are rejected.
+ */
+void test_DecodeReading_Invalid( void )
+{
+    uint8_t ucFrame[ sizeof( ucMeterReply ) ];
+    MeterReading_t xReading;
+
+    buildReply( 1, ucFrame );
+    TEST_ASSERT_FALSE( MeterPoll_DecodeReading( ucFrame, sizeof( ucFrame ) - 1U, &xReading ) );
+
+    ucFrame[ 20 ] ^= 0x01U;
+    TEST_ASSERT_FALSE( MeterPoll_DecodeReading( ucFrame, sizeof( ucFrame ), &xReading ) );
+
+    buildReply( 1, ucFrame );
+    ucFrame[ 1 ] = 0x83;
+    TEST_ASSERT_FALSE( MeterPoll_DecodeReading( ucFrame, sizeof( ucFrame ), &xReading ) );
+}
+
+/* ========================  TESTING scheduler  ============================ */
+/*!
+ * @brief Every station is read once per round, back to back.
+ */
+void test_Round_AllStationsAnswer( void )
+{
+    MeterPollSnapshot_t xSnapshot;
+    uint8_t i;
+
+    initPoll( 8, 0 );
+
+    TEST_ASSERT_EQUAL_UINT32( 8U * TRANSACTION_US, runRound() );
+    TEST_ASSERT_EQUAL_UINT32( 8, ulRequestsOnBus );
+
+    MeterPoll_Snapshot( &xPoll, &xSnapshot );
+    TEST_ASSERT_EQUAL_UINT32( 1, xSnapshot.ulRound );
+    TEST_ASSERT_EQUAL_UINT8( 8, xSnapshot.ucStationCount );
+
+    for( i = 0; i < 8U; i++ )
+    {
+        TEST_ASSERT_EQUAL( METER_POLL_OK, xSnapshot.xStations[ i ].ucStatus );
+        TEST_ASSERT_EQUAL_UINT32( 1, xSnapshot.xStations[ i ].ulRound );
+        TEST_ASSERT_EQUAL_UINT8( i + 1U, xSnapshot.xStations[ i ].xReading.ucStationId );
+        TEST_ASSERT_EQUAL_UINT8( i + 1U, xSnapshot.xStations[ i ].xReading.ullMeterId & 0xFFU );
+    }
+
+    /* A second round refreshes the table. */
+    runRound();
+    MeterPoll_Snapshot( &xPoll, &xSnapshot );
+    TEST_ASSERT_EQUAL_UINT32( 2, xSnapshot.xStations[ 7 ].ulRound );
+}
+
+/*!
+ * @brief A missing meter costs its retries only, the others are read.
+ */
+void test_Round_DeadStationTimesOut( void )
+{
+    initPoll( 4, 0 );
+    xMeters[ 2 ].xPresent = false;
+
+    TEST_ASSERT_EQUAL_UINT32( ( 3U * TRANSACTION_US ) + ( ( MAX_RETRIES + 1U ) * REPLY_TIMEOUT_US ),
+                              runRound() );
+
+    TEST_ASSERT_EQUAL( METER_POLL_OK, xPoll.xStations[ 0 ].ucStatus );
+    TEST_ASSERT_EQUAL( METER_POLL_TIMEOUT, xPoll.xStations[ 1 ].ucStatus );
+    TEST_ASSERT_EQUAL_UINT16( MAX_RETRIES + 1U, xPoll.xStations[ 1 ].usTimeouts );
+    TEST_ASSERT_EQUAL_UINT16( MAX_RETRIES + 1U, xPoll.xStations[ 1 ].usRequests );
+    TEST_ASSERT_EQUAL( METER_POLL_OK, xPoll.xStations[ 3 ].ucStatus );
+}
+
+/*!
+ * @brief A lost request and a corrupted reply are both recovered by retries.
+ */
+void test_Round_RetriesRecover( void )
+{
+    initPoll( 2, 0 );
+    xMeters[ 1 ].ucSilentRequests = 1;
+    xMeters[ 2 ].ucCorruptReplies = 1;
+
+    TEST_ASSERT_EQUAL_UINT32( REPLY_TIMEOUT_US + ( 3U * TRANSACTION_US ), runRound() );
+
+    TEST_ASSERT_EQUAL( METER_POLL_OK, xPoll.xStations[ 0 ].ucStatus );
+    TEST_ASSERT_EQUAL_UINT16( 1, xPoll.xStations[ 0 ].usTimeouts );
+    TEST_ASSERT_EQUAL( METER_POLL_OK, xPoll.xStations[ 1 ].ucStatus );
+    TEST_ASSERT_EQUAL_UINT16( 1, xPoll.xStations[ 1 ].usBadReplies );
+}
+
+/*!
+ * @brief A station that only sends garbage is reported as such.
+ */
+void test_Round_BadReplies( void )
+{
+    initPoll( 1, 0 );
+    xMeters[ 1 ].ucCorruptReplies = MAX_RETRIES + 1U;
+
+    runRound();
+
+    TEST_ASSERT_EQUAL( METER_POLL_BAD_REPLY, xPoll.xStations[ 0 ].ucStatus );
+    TEST_ASSERT_EQUAL_UINT16( MAX_RETRIES + 1U, xPoll.xStations[ 0 ].usBadReplies );
+}
+
+/*!
+ * @brief Frames from other stations and the request echo do not complete a
+ * transaction.
+ */
+void test_Step_IgnoresForeignFrames( void )
+{
+    uint8_t ucForeign[ meterpollREPLY_LENGTH ];
+    uint32_t ulDelay;
+
+    initPoll( 1, 0 );
+    MeterPoll_StartRound( &xPoll, ulNow );
+    ( void ) MeterPoll_Step( &xPoll, ulNow, NULL, 0 );
+    xReplyPending = false;
+
+    buildReply( 9, ucForeign );
+    ulDelay = MeterPoll_Step( &xPoll, ulNow + 1000U, ucForeign, sizeof( ucForeign ) );
+    TEST_ASSERT_EQUAL_UINT32( REPLY_TIMEOUT_US - 1000U, ulDelay );
+
+    ulDelay = MeterPoll_Step( &xPoll, ulNow + 2000U, xPoll.ucRequest, meterpollREQUEST_LENGTH );
+    TEST_ASSERT_EQUAL_UINT32( REPLY_TIMEOUT_US - 2000U, ulDelay );
+    TEST_ASSERT_EQUAL( METER_POLL_NEVER, xPoll.xStations[ 0 ].ucStatus );
+}
+
+/*!
+ * @brief A configured turnaround is inserted between stations.
+ */
+void test_Round_Turnaround( void )
+{
+    initPoll( 3, 2000 );
+
+    TEST_ASSERT_EQUAL_UINT32( ( 3U * TRANSACTION_US ) + ( 2U * 2000U ), runRound() );
+}
+
+/*!
+ * @brief Round time against station count on the simulated bus.
+ */
+void test_Benchmark_RoundTime( void )
+{
+    uint8_t ucCounts[] = { 1, 2, 4, 8, 16, 32 };
+    uint32_t ulRoundTime;
+    size_t i;
+
+    for( i = 0; i < sizeof( ucCounts ); i++ )
+    {
+        memset( xMeters, 0, sizeof( xMeters ) );
+        initPoll( ucCounts[ i ], 0 );
+        ulRoundTime = runRound();
+
+        printf( "meter_poll: %2u stations, round %7u us, %5u us/station\n",
+                ( unsigned ) ucCounts[ i ],
+                ( unsigned ) ulRoundTime,
+                ( unsigned ) ( ulRoundTime / ucCounts[ i ] ) );
+
+        /* Pipelined: no idle time between transactions. */
+        TEST_ASSERT_EQUAL_UINT32( ucCounts[ i ] * TRANSACTION_US, ulRoundTime );
+    }
+}
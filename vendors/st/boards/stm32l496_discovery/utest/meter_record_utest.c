@@ -0,0 +1,402 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "unity.h"
+
+#include "cbor.h"
+#include "meter_record.h"
+
+#define BENCHMARK_RECORDS    ( 20000U )
+
+/* 2020-02-29T23:59:59Z, a leap day. */
+#define TEST_TIMESTAMP       ( 1583020799UL )
+
+/* ============================  GLOBAL VARIABLES =========================== */
+
+/* Reading decoded from the reply captured on site. */
+static const MeterReading_t xSiteReading =
+{
+    .ullMeterId            = 0xFF00FE00FEULL,
+    .ullAmount             = 0x0501F028ULL,
+    .ullReverseAmount      = 0xFF0006ULL,
+    .usLDay                = 0x0000,
+    .usNDay                = 0x0000,
+    .usODay                = 0x6800,
+    .usUDay                = 0xFF08,
+    .usHDay                = 0x59F8,
+    .usBDay                = 0x4D47,
+    .usOp                  = 0xFE00,
+    .ucStationId           = 1,
+    .ucAmountPlaces        = 0x01,
+    .ucReverseAmountPlaces = 0xE0
+};
+
+/* Largest values every field can hold. */
+static const MeterReading_t xMaxReading =
+{
+    .ullMeterId            = UINT64_MAX,
+    .ullAmount             = UINT64_MAX,
+    .ullReverseAmount      = UINT64_MAX,
+    .usLDay                = UINT16_MAX,
+    .usNDay                = UINT16_MAX,
+    .usODay                = UINT16_MAX,
+    .usUDay                = UINT16_MAX,
+    .usHDay                = UINT16_MAX,
+    .usBDay                = UINT16_MAX,
+    .usOp                  = UINT16_MAX,
+    .ucStationId           = UINT8_MAX,
+    .ucAmountPlaces        = UINT8_MAX,
+    .ucReverseAmountPlaces = UINT8_MAX
+};
+
+static char pPublishPayload[ 1024 ];
+static uint8_t ucRecord[ meterrecordMAX_LENGTH ];
+
+/* ==========================  Helper functions  ============================ */
+
+/* The serializer allocates its encoders from the FreeRTOS heap. */
+void * pvPortMalloc( size_t xSize )
+{
+    return malloc( xSize );
+}
+
+void vPortFree( void * pv )
+{
+    free( pv );
+}
+
+static char bfr[ 20 + 1 ];
+
+static char * uint64ToDecimal( uint64_t v )
+{
+    char * p = bfr + sizeof( bfr );
+
+    *( --p ) = '\0';
+
+    for( bool first = true; v || first; first = false )
+    {
+        const uint32_t digit = v % 10;
+        const char c = '0' + digit;
+        *( --p ) = c;
+        v = v / 10;
+    }
+
+    return p;
+}
+
+/* The payload builder of the original demo, kept as the reference. */
+static size_t legacyEncode( const MeterReading_t * pReading,
+                            uint32_t epoch )
+{
+    time_t e = epoch;
+    char tbuf[ 80 ];
+
+    strftime( tbuf, 80, "%Y-%m-%dT%H:%M:%SZ", localtime( &e ) );
+
+    memset( pPublishPayload, 0, sizeof( pPublishPayload ) );
+    char * p = pPublishPayload;
+    p += sprintf( p, "{\"timestamp\":\"%s\"", tbuf );
+    p += sprintf( p, ",\"STATION_NO\":%d", pReading->ucStationId );
+    p += sprintf( p, ",\"METER_NO\":%s", uint64ToDecimal( pReading->ullMeterId ) );
+    p += sprintf( p, ",\"AMOUNT\":%s", uint64ToDecimal( pReading->ullAmount ) );
+    p += sprintf( p, ",\"AMOUNT_PLACES\":%d", pReading->ucAmountPlaces );
+    p += sprintf( p, ",\"REVERSE_AMOUNT\":%s", uint64ToDecimal( pReading->ullReverseAmount ) );
+    p += sprintf( p, ",\"REVERSE_AMOUNT_PLACES\":%d", pReading->ucReverseAmountPlaces );
+    p += sprintf( p, ",\"LDAY\":%d", pReading->usLDay );
+    p += sprintf( p, ",\"NDAY\":%d", pReading->usNDay );
+    p += sprintf( p, ",\"ODAY\":%d", pReading->usODay );
+    p += sprintf( p, ",\"UDAY\":%d", pReading->usUDay );
+    p += sprintf( p, ",\"HDAY\":%d", pReading->usHDay );
+    p += sprintf( p, ",\"BDAY\":%d", pReading->usBDay );
+    p += sprintf( p, ",\"OP\":%d}", pReading->usOp );
+
+    return strlen( pPublishPayload );
+}
+
+/* The serializer decoder reads integers as int, the wide fields are looked
+ * up with tinycbor directly. */
+static int64_t cborFind( CborValue * pMap,
+                         const char * pKey )
+{
+    CborValue value;
+    int64_t result = 0;
+
+    TEST_ASSERT_EQUAL( CborNoError, cbor_value_map_find_value( pMap, pKey, &value ) );
+    TEST_ASSERT_TRUE( cbor_value_is_integer( &value ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_value_get_int64( &value, &result ) );
+
+    return result;
+}
+
+static uint64_t nanoseconds( void )
+{
+    struct timespec now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( ( uint64_t ) now.tv_sec * 1000000000ULL ) + ( uint64_t ) now.tv_nsec;
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+void setUp( void )
+{
+    memset( ucRecord, 0xA5, sizeof( ucRecord ) );
+}
+
+/* called before each testcase */
+void tearDown( void )
+{
+}
+
+/* called at the beginning of the whole suite */
+void suiteSetUp()
+{
+    /* The target has no time zone, localtime() is UTC. */
+    setenv( "TZ", "UTC", 1 );
+    tzset();
+}
+
+/* called at the end of the whole suite */
+int suiteTearDown( int numFailures )
+{
+    return( numFailures > 0 );
+}
+
+/* =======================  TESTING JSON encoding  ========================= */
+/*!
+ * @brief JSON records are byte for byte the payloads of the original demo.
+ */
+void test_Json_MatchesLegacyPayload( void )
+{
+    const uint32_t ulTimestamps[] = { 0, 951782400UL, TEST_TIMESTAMP, 4102444800UL, UINT32_MAX };
+    size_t xLength, i;
+
+    for( i = 0; i < sizeof( ulTimestamps ) / sizeof( ulTimestamps[ 0 ] ); i++ )
+    {
+        xLength = MeterRecord_Encode( METER_RECORD_FORMAT_JSON, &xSiteReading, ulTimestamps[ i ],
+                                      ucRecord, sizeof( ucRecord ) );
+
+        TEST_ASSERT_EQUAL( legacyEncode( &xSiteReading, ulTimestamps[ i ] ), xLength );
+        TEST_ASSERT_EQUAL_MEMORY( pPublishPayload, ucRecord, xLength );
+    }
+
+    xLength = MeterRecord_Encode( METER_RECORD_FORMAT_JSON, &xMaxReading, TEST_TIMESTAMP,
+                                  ucRecord, sizeof( ucRecord ) );
+    TEST_ASSERT_EQUAL( legacyEncode( &xMaxReading, TEST_TIMESTAMP ), xLength );
+    TEST_ASSERT_EQUAL_MEMORY( pPublishPayload, ucRecord, xLength );
+    TEST_ASSERT_LESS_OR_EQUAL( meterrecordMAX_JSON_LENGTH, xLength );
+}
+
+/*!
+ * @brief A buffer too small is reported and never overrun.
+ */
+void test_Json_BufferTooSmall( void )
+{
+    size_t xNeeded = legacyEncode( &xSiteReading, TEST_TIMESTAMP );
+
+    TEST_ASSERT_EQUAL( 0, MeterRecord_Encode( METER_RECORD_FORMAT_JSON, &xSiteReading, TEST_TIMESTAMP,
+                                              ucRecord, 20 ) );
+    TEST_ASSERT_EQUAL( 0, MeterRecord_Encode( METER_RECORD_FORMAT_JSON, &xSiteReading, TEST_TIMESTAMP,
+                                              ucRecord, xNeeded / 2U ) );
+    TEST_ASSERT_EACH_EQUAL_HEX8( 0xA5, &ucRecord[ xNeeded / 2U ], sizeof( ucRecord ) - ( xNeeded / 2U ) );
+}
+
+/* =======================  TESTING CBOR encoding  ========================= */
+/*!
+ * @brief Every field of a CBOR record decodes back to the reading.
+ */
+void test_Cbor_RoundTrip( void )
+{
+    CborParser parser;
+    CborValue map;
+    size_t xLength;
+
+    xLength = MeterRecord_Encode( METER_RECORD_FORMAT_CBOR, &xSiteReading, TEST_TIMESTAMP,
+                                  ucRecord, sizeof( ucRecord ) );
+    TEST_ASSERT_GREATER_THAN( 0, xLength );
+    TEST_ASSERT_LESS_OR_EQUAL( meterrecordMAX_CBOR_LENGTH, xLength );
+
+    /* A definite length map of 14 pairs. */
+    TEST_ASSERT_EQUAL_HEX8( 0xAE, ucRecord[ 0 ] );
+
+    TEST_ASSERT_EQUAL( CborNoError, cbor_parser_init( ucRecord, xLength, 0, &parser, &map ) );
+    TEST_ASSERT_TRUE( cbor_value_is_map( &map ) );
+
+    TEST_ASSERT_EQUAL_INT64( TEST_TIMESTAMP, cborFind( &map, "t" ) );
+    TEST_ASSERT_EQUAL_INT64( xSiteReading.ucStationId, cborFind( &map, "s" ) );
+    TEST_ASSERT_EQUAL_INT64( xSiteReading.ullMeterId, cborFind( &map, "m" ) );
+    TEST_ASSERT_EQUAL_INT64( xSiteReading.ullAmount, cborFind( &map, "a" ) );
+    TEST_ASSERT_EQUAL_INT64( xSiteReading.ucAmountPlaces, cborFind( &map, "ap" ) );
+    TEST_ASSERT_EQUAL_INT64( xSiteReading.ullReverseAmount, cborFind( &map, "r" ) );
+    TEST_ASSERT_EQUAL_INT64( xSiteReading.ucReverseAmountPlaces, cborFind( &map, "rp" ) );
+    TEST_ASSERT_EQUAL_INT64( xSiteReading.usLDay, cborFind( &map, "ld" ) );
+    TEST_ASSERT_EQUAL_INT64( xSiteReading.usNDay, cborFind( &map, "nd" ) );
+    TEST_ASSERT_EQUAL_INT64( xSiteReading.usODay, cborFind( &map, "od" ) );
+    TEST_ASSERT_EQUAL_INT64( xSiteReading.usUDay, cborFind( &map, "ud" ) );
+    TEST_ASSERT_EQUAL_INT64( xSiteReading.usHDay, cborFind( &map, "hd" ) );
+    TEST_ASSERT_EQUAL_INT64( xSiteReading.usBDay, cborFind( &map, "bd" ) );
+    TEST_ASSERT_EQUAL_INT64( xSiteReading.usOp, cborFind( &map, "op" ) );
+}
+
+/*!
+ * @brief A buffer too small is reported.
+ */
+void test_Cbor_BufferTooSmall( void )
+{
+    size_t xNeeded = MeterRecord_Encode( METER_RECORD_FORMAT_CBOR, &xSiteReading, TEST_TIMESTAMP,
+                                         ucRecord, sizeof( ucRecord ) );
+
+    TEST_ASSERT_EQUAL( 0, MeterRecord_Encode( METER_RECORD_FORMAT_CBOR, &xSiteReading, TEST_TIMESTAMP,
+                                              ucRecord, xNeeded - 1U ) );
+    TEST_ASSERT_EQUAL( 0, MeterRecord_Encode( METER_RECORD_FORMAT_CBOR, &xSiteReading, TEST_TIMESTAMP,
+                                              ucRecord, 0 ) );
+    TEST_ASSERT_EQUAL( xNeeded, MeterRecord_Encode( METER_RECORD_FORMAT_CBOR, &xSiteReading, TEST_TIMESTAMP,
+                                                    ucRecord, xNeeded ) );
+}
+
+/* ======================  TESTING record batches  ========================= */
+/*!
+ * @brief A JSON batch is an array of the single records.
+ */
+void test_Batch_Json( void )
+{
+    static uint8_t ucBatch[ 3U * meterrecordMAX_JSON_LENGTH ];
+    MeterRecordBatch_t xBatch;
+    size_t xLength, xOffset;
+
+    TEST_ASSERT_TRUE( MeterRecord_BatchInit( &xBatch, METER_RECORD_FORMAT_JSON, ucBatch, sizeof( ucBatch ) ) );
+    TEST_ASSERT_EQUAL( 2, MeterRecord_BatchFinish( &xBatch ) );
+    TEST_ASSERT_EQUAL_MEMORY( "[]", ucBatch, 2 );
+
+    TEST_ASSERT_TRUE( MeterRecord_BatchInit( &xBatch, METER_RECORD_FORMAT_JSON, ucBatch, sizeof( ucBatch ) ) );
+    TEST_ASSERT_TRUE( MeterRecord_BatchAppend( &xBatch, &xSiteReading, TEST_TIMESTAMP ) );
+    TEST_ASSERT_TRUE( MeterRecord_BatchAppend( &xBatch, &xMaxReading, TEST_TIMESTAMP + 1U ) );
+    TEST_ASSERT_EQUAL( 2, xBatch.xCount );
+    xLength = MeterRecord_BatchFinish( &xBatch );
+
+    TEST_ASSERT_EQUAL_HEX8( '[', ucBatch[ 0 ] );
+    xOffset = legacyEncode( &xSiteReading, TEST_TIMESTAMP );
+    TEST_ASSERT_EQUAL_MEMORY( pPublishPayload, &ucBatch[ 1 ], xOffset );
+    TEST_ASSERT_EQUAL_HEX8( ',', ucBatch[ 1U + xOffset ] );
+    TEST_ASSERT_EQUAL( 2U + xOffset + legacyEncode( &xMaxReading, TEST_TIMESTAMP + 1U ) + 1U, xLength );
+    TEST_ASSERT_EQUAL_MEMORY( pPublishPayload, &ucBatch[ 2U + xOffset ], xLength - xOffset - 3U );
+    TEST_ASSERT_EQUAL_HEX8( ']', ucBatch[ xLength - 1U ] );
+}
+
+/*!
+ * @brief A CBOR batch decodes as an array of maps, and a record that does
+ * not fit leaves the batch intact.
+ */
+void test_Batch_Cbor( void )
+{
+    static uint8_t ucBatch[ 2U * meterrecordMAX_CBOR_LENGTH ];
+    MeterRecordBatch_t xBatch;
+    CborParser parser;
+    CborValue array, map;
+    size_t xLength, xCount = 0;
+
+    TEST_ASSERT_TRUE( MeterRecord_BatchInit( &xBatch, METER_RECORD_FORMAT_CBOR, ucBatch, sizeof( ucBatch ) ) );
+
+    while( MeterRecord_BatchAppend( &xBatch, &xSiteReading, TEST_TIMESTAMP + xBatch.xCount ) == true )
+    {
+    }
+
+    TEST_ASSERT_GREATER_THAN( 1, xBatch.xCount );
+    xLength = MeterRecord_BatchFinish( &xBatch );
+    TEST_ASSERT_LESS_OR_EQUAL( sizeof( ucBatch ), xLength );
+
+    TEST_ASSERT_EQUAL( CborNoError, cbor_parser_init( ucBatch, xLength, 0, &parser, &array ) );
+    TEST_ASSERT_TRUE( cbor_value_is_array( &array ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_value_enter_container( &array, &map ) );
+
+    while( cbor_value_at_end( &map ) == false )
+    {
+        TEST_ASSERT_TRUE( cbor_value_is_map( &map ) );
+        TEST_ASSERT_EQUAL_INT64( TEST_TIMESTAMP + xCount, cborFind( &map, "t" ) );
+        TEST_ASSERT_EQUAL_INT64( xSiteReading.ullAmount, cborFind( &map, "a" ) );
+        TEST_ASSERT_EQUAL( CborNoError, cbor_value_advance( &map ) );
+        xCount++;
+    }
+
+    TEST_ASSERT_EQUAL( xBatch.xCount, xCount );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_value_leave_container( &array, &map ) );
+    TEST_ASSERT_TRUE( cbor_value_at_end( &array ) );
+}
+
+/* ==========================  Microbenchmark  ============================= */
+/*!
+ * @brief Time and bytes per record of the sprintf chain and both encoders.
+ */
+void test_Benchmark_Encoders( void )
+{
+    uint64_t ullStart, ullLegacy, ullJson, ullCbor;
+    size_t xLegacyLength = 0, xJsonLength = 0, xCborLength = 0;
+    uint32_t i;
+
+    ullStart = nanoseconds();
+
+    for( i = 0; i < BENCHMARK_RECORDS; i++ )
+    {
+        xLegacyLength = legacyEncode( &xSiteReading, TEST_TIMESTAMP + i );
+    }
+
+    ullLegacy = nanoseconds() - ullStart;
+    ullStart = nanoseconds();
+
+    for( i = 0; i < BENCHMARK_RECORDS; i++ )
+    {
+        xJsonLength = MeterRecord_Encode( METER_RECORD_FORMAT_JSON, &xSiteReading, TEST_TIMESTAMP + i,
+                                          ucRecord, sizeof( ucRecord ) );
+    }
+
+    ullJson = nanoseconds() - ullStart;
+    ullStart = nanoseconds();
+
+    for( i = 0; i < BENCHMARK_RECORDS; i++ )
+    {
+        xCborLength = MeterRecord_Encode( METER_RECORD_FORMAT_CBOR, &xSiteReading, TEST_TIMESTAMP + i,
+                                          ucRecord, sizeof( ucRecord ) );
+    }
+
+    ullCbor = nanoseconds() - ullStart;
+
+    printf( "meter_record: sprintf %5" PRIu64 " ns %3u bytes\n",
+            ullLegacy / BENCHMARK_RECORDS, ( unsigned ) xLegacyLength );
+    printf( "meter_record: json    %5" PRIu64 " ns %3u bytes\n",
+            ullJson / BENCHMARK_RECORDS, ( unsigned ) xJsonLength );
+    printf( "meter_record: cbor    %5" PRIu64 " ns %3u bytes\n",
+            ullCbor / BENCHMARK_RECORDS, ( unsigned ) xCborLength );
+
+    TEST_ASSERT_EQUAL( xLegacyLength, xJsonLength );
+    TEST_ASSERT_LESS_THAN( xJsonLength / 2U, xCborLength );
+}
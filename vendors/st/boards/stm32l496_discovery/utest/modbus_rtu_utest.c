@@ -0,0 +1,352 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "unity.h"
+
+#include "modbus_rtu.h"
+
+/* Line parameters of the meter bus. */
+#define BAUD_RATE          ( 9600U )
+#define STAMP_HZ           ( 1000000U )
+#define BIT_TICKS          ( STAMP_HZ / BAUD_RATE )
+
+/* Longest waveform a test records, in time-stamp ticks. */
+#define WAVEFORM_TICKS     ( 700000U )
+
+/* ============================  GLOBAL VARIABLES =========================== */
+
+/* Meter reply captured on site, request 01 03 05 04 00 14. */
+static const uint8_t ucMeterReply[] =
+{
+    0x01, 0x03, 0x28, 0xF0, 0x01, 0x05, 0x00, 0x00,
+    0x00, 0x00, 0x01, 0x06, 0x00, 0xFF, 0xE0, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x68, 0x08,
+    0xFF, 0xF8, 0x59, 0x47, 0x4D, 0x34, 0x00, 0xFE,
+    0x00, 0xFE, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+static ModbusRtuLine_t xLine;
+static uint8_t ucWaveform[ WAVEFORM_TICKS ];
+static uint32_t ulWaveformLength;
+static uint32_t ulFrameCallbacks;
+
+/* ==========================  CALLBACK FUNCTIONS =========================== */
+
+static void frameCallback( void * pvContext )
+{
+    TEST_ASSERT_EQUAL_PTR( &xLine, pvContext );
+    ulFrameCallbacks++;
+}
+
+/* ==========================  Helper functions  ============================ */
+
+/* Append idle line for a number of character times. */
+static void waveformIdle( uint32_t ulChars )
+{
+    uint32_t ulEnd = ulWaveformLength + ( ulChars * 10U * BIT_TICKS );
+
+    TEST_ASSERT_TRUE( ulEnd <= WAVEFORM_TICKS );
+    memset( &ucWaveform[ ulWaveformLength ], 1, ulEnd - ulWaveformLength );
+    ulWaveformLength = ulEnd;
+}
+
+/* Append 8N1 characters sent by a device whose clock is off by ppm. */
+static void waveformBytes( const uint8_t * pucBytes,
+                           size_t xLength,
+                           int32_t lClockErrorPpm,
+                           uint8_t ucStopLevel )
+{
+    uint64_t ullBitTicks = ( ( uint64_t ) STAMP_HZ * ( 1000000 + lClockErrorPpm ) ) / BAUD_RATE;
+    uint32_t ulStart, ulBit, t;
+    uint8_t ucLevel;
+    size_t i;
+
+    for( i = 0; i < xLength; i++ )
+    {
+        ulStart = ulWaveformLength;
+
+        for( ulBit = 0; ulBit < 10U; ulBit++ )
+        {
+            if( ulBit == 0U )
+            {
+                ucLevel = 0;
+            }
+            else if( ulBit < 9U )
+            {
+                ucLevel = ( pucBytes[ i ] >> ( ulBit - 1U ) ) & 0x01U;
+            }
+            else
+            {
+                ucLevel = ucStopLevel;
+            }
+
+            for( t = ulStart + ( uint32_t ) ( ( ulBit * ullBitTicks ) / 1000000U );
+                 t < ulStart + ( uint32_t ) ( ( ( ulBit + 1U ) * ullBitTicks ) / 1000000U );
+                 t++ )
+            {
+                TEST_ASSERT_TRUE( t < WAVEFORM_TICKS );
+                ucWaveform[ t ] = ucLevel;
+            }
+        }
+
+        ulWaveformLength = ulStart + ( uint32_t ) ( ( 10U * ullBitTicks ) / 1000000U );
+
+        /* A faulty stop bit must end high again for the next start bit. */
+        ucWaveform[ ulWaveformLength - 1U ] = 1;
+    }
+}
+
+/* Replay the recorded waveform: edges as the EXTI interrupt reports them and
+ * a poll every bit period as the bit timer does. */
+static void waveformReplay( void )
+{
+    uint32_t t;
+    uint8_t ucLevel = 1;
+
+    ModbusRtu_RxArm( &xLine, 0 );
+
+    for( t = 0; t < ulWaveformLength; t++ )
+    {
+        if( ucWaveform[ t ] != ucLevel )
+        {
+            ucLevel = ucWaveform[ t ];
+            ModbusRtu_RxEdge( &xLine, t, ucLevel );
+        }
+
+        if( ( t % BIT_TICKS ) == 0U )
+        {
+            ModbusRtu_RxPoll( &xLine, t );
+        }
+    }
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+void setUp( void )
+{
+    ModbusRtu_Init( &xLine, STAMP_HZ, BAUD_RATE, frameCallback, &xLine );
+    ulWaveformLength = 0;
+    ulFrameCallbacks = 0;
+    waveformIdle( 4 );
+}
+
+/* called before each testcase */
+void tearDown( void )
+{
+}
+
+/* called at the beginning of the whole suite */
+void suiteSetUp()
+{
+}
+
+/* called at the end of the whole suite */
+int suiteTearDown( int numFailures )
+{
+    return( numFailures > 0 );
+}
+
+/* ======================  TESTING ModbusRtu_Crc16  ======================== */
+/*!
+ * @brief The request sent by the meter task carries the CRC 04 C8.
+ */
+void test_Crc16_MeterRequest( void )
+{
+    const uint8_t ucRequest[] = { 0x01, 0x03, 0x05, 0x04, 0x00, 0x14, 0x04, 0xC8 };
+
+    TEST_ASSERT_EQUAL_HEX16( 0xC804, ModbusRtu_Crc16( ucRequest, 6 ) );
+    TEST_ASSERT_TRUE( ModbusRtu_CrcValid( ucRequest, sizeof( ucRequest ) ) );
+    TEST_ASSERT_FALSE( ModbusRtu_CrcValid( ucRequest, 7 ) );
+    TEST_ASSERT_FALSE( ModbusRtu_CrcValid( ucRequest, 2 ) );
+}
+
+/* ======================  TESTING receive decoder  ======================== */
+/*!
+ * @brief The recorded meter reply is decoded as one frame.
+ */
+void test_Rx_MeterReply( void )
+{
+    uint8_t ucFrame[ modbusrtuMAX_FRAME_LENGTH ];
+    size_t xLength;
+
+    waveformBytes( ucMeterReply, sizeof( ucMeterReply ), 0, 1 );
+    waveformIdle( 5 );
+    waveformReplay();
+
+    TEST_ASSERT_EQUAL_UINT32( 1, ulFrameCallbacks );
+    xLength = ModbusRtu_FrameGet( &xLine, ucFrame, sizeof( ucFrame ) );
+    TEST_ASSERT_EQUAL( sizeof( ucMeterReply ), xLength );
+    TEST_ASSERT_EQUAL_HEX8_ARRAY( ucMeterReply, ucFrame, xLength );
+    TEST_ASSERT_EQUAL( 0, ModbusRtu_FrameGet( &xLine, ucFrame, sizeof( ucFrame ) ) );
+}
+
+/*!
+ * @brief Meter clocks off by +/- 2 % are still sampled correctly.
+ */
+void test_Rx_ClockTolerance( void )
+{
+    uint8_t ucFrame[ modbusrtuMAX_FRAME_LENGTH ];
+
+    waveformBytes( ucMeterReply, sizeof( ucMeterReply ), 20000, 1 );
+    waveformIdle( 5 );
+    waveformBytes( ucMeterReply, sizeof( ucMeterReply ), -20000, 1 );
+    waveformIdle( 5 );
+    waveformReplay();
+
+    TEST_ASSERT_EQUAL_UINT32( 2, xLine.xStats.ulFrames );
+    TEST_ASSERT_EQUAL( sizeof( ucMeterReply ), ModbusRtu_FrameGet( &xLine, ucFrame, sizeof( ucFrame ) ) );
+    TEST_ASSERT_EQUAL_HEX8_ARRAY( ucMeterReply, ucFrame, sizeof( ucMeterReply ) );
+    TEST_ASSERT_EQUAL( sizeof( ucMeterReply ), ModbusRtu_FrameGet( &xLine, ucFrame, sizeof( ucFrame ) ) );
+    TEST_ASSERT_EQUAL_HEX8_ARRAY( ucMeterReply, ucFrame, sizeof( ucMeterReply ) );
+}
+
+/*!
+ * @brief Silence shorter than 3.5 characters does not split a frame, longer
+ * silence does.
+ */
+void test_Rx_InterFrameGap( void )
+{
+    const uint8_t ucFirst[] = { 0x11, 0x22, 0x33 };
+    const uint8_t ucSecond[] = { 0x44, 0x55 };
+    uint8_t ucFrame[ 16 ];
+
+    waveformBytes( ucFirst, sizeof( ucFirst ), 0, 1 );
+    waveformIdle( 2 );
+    waveformBytes( ucSecond, sizeof( ucSecond ), 0, 1 );
+    waveformIdle( 4 );
+    waveformBytes( ucFirst, sizeof( ucFirst ), 0, 1 );
+    waveformIdle( 4 );
+    waveformReplay();
+
+    TEST_ASSERT_EQUAL_UINT32( 2, ulFrameCallbacks );
+    TEST_ASSERT_EQUAL( 5, ModbusRtu_FrameGet( &xLine, ucFrame, sizeof( ucFrame ) ) );
+    TEST_ASSERT_EQUAL_HEX8( 0x11, ucFrame[ 0 ] );
+    TEST_ASSERT_EQUAL_HEX8( 0x55, ucFrame[ 4 ] );
+    TEST_ASSERT_EQUAL( 3, ModbusRtu_FrameGet( &xLine, ucFrame, sizeof( ucFrame ) ) );
+    TEST_ASSERT_EQUAL_HEX8_ARRAY( ucFirst, ucFrame, sizeof( ucFirst ) );
+}
+
+/*!
+ * @brief A frame with a low stop bit is dropped, the next one is kept.
+ */
+void test_Rx_FramingErrorDropsFrame( void )
+{
+    const uint8_t ucBytes[] = { 0xA5, 0x5A };
+    uint8_t ucFrame[ 16 ];
+
+    waveformBytes( ucBytes, 1, 0, 1 );
+    waveformBytes( &ucBytes[ 1 ], 1, 0, 0 );
+    waveformIdle( 5 );
+    waveformBytes( ucBytes, sizeof( ucBytes ), 0, 1 );
+    waveformIdle( 5 );
+    waveformReplay();
+
+    TEST_ASSERT_EQUAL_UINT32( 1, xLine.xStats.ulFramingErrors );
+    TEST_ASSERT_EQUAL_UINT32( 1, xLine.xStats.ulFrames );
+    TEST_ASSERT_EQUAL( 2, ModbusRtu_FrameGet( &xLine, ucFrame, sizeof( ucFrame ) ) );
+    TEST_ASSERT_EQUAL_HEX8_ARRAY( ucBytes, ucFrame, sizeof( ucBytes ) );
+}
+
+/*!
+ * @brief A glitch shorter than half a bit is not taken for a start bit.
+ */
+void test_Rx_GlitchIgnored( void )
+{
+    ucWaveform[ 10 ] = 0;
+    ucWaveform[ 11 ] = 0;
+    waveformReplay();
+
+    TEST_ASSERT_EQUAL_UINT32( 0, xLine.xStats.ulCharacters );
+    TEST_ASSERT_EQUAL_UINT32( 0, ulFrameCallbacks );
+}
+
+/*!
+ * @brief Frames that no longer fit in the ring are counted and dropped.
+ */
+void test_Rx_RingOverrun( void )
+{
+    uint8_t ucFrame[ modbusrtuMAX_FRAME_LENGTH ];
+    uint32_t i;
+
+    for( i = 0; i < 12U; i++ )
+    {
+        waveformBytes( ucMeterReply, sizeof( ucMeterReply ), 0, 1 );
+        waveformIdle( 4 );
+    }
+
+    waveformReplay();
+
+    TEST_ASSERT_EQUAL_UINT32( modbusrtuRX_RING_SIZE / ( sizeof( ucMeterReply ) + 2U ),
+                              xLine.xStats.ulFrames );
+    TEST_ASSERT_EQUAL_UINT32( 12U - xLine.xStats.ulFrames, xLine.xStats.ulOverruns );
+
+    for( i = 0; i < xLine.xStats.ulFrames; i++ )
+    {
+        TEST_ASSERT_EQUAL( sizeof( ucMeterReply ), ModbusRtu_FrameGet( &xLine, ucFrame, sizeof( ucFrame ) ) );
+        TEST_ASSERT_EQUAL_HEX8_ARRAY( ucMeterReply, ucFrame, sizeof( ucMeterReply ) );
+    }
+
+    /* Flushing after a read keeps the ring usable. */
+    ModbusRtu_FrameFlush( &xLine );
+    TEST_ASSERT_EQUAL( 0, ModbusRtu_FrameGet( &xLine, ucFrame, sizeof( ucFrame ) ) );
+}
+
+/* ======================  TESTING transmitter  ============================ */
+/*!
+ * @brief What the transmitter drives is decoded back by the receiver.
+ */
+void test_Tx_Loopback( void )
+{
+    const uint8_t ucRequest[] = { 0x01, 0x03, 0x05, 0x04, 0x00, 0x14, 0x04, 0xC8 };
+    uint8_t ucFrame[ 16 ];
+    int32_t lLevel;
+    uint32_t ulBits = 0, t;
+
+    ModbusRtu_TxStart( &xLine, ucRequest, sizeof( ucRequest ) );
+    TEST_ASSERT_TRUE( xLine.xTxBusy );
+
+    while( ( lLevel = ModbusRtu_TxNextLevel( &xLine ) ) != modbusrtuTX_DONE )
+    {
+        for( t = 0; t < BIT_TICKS; t++ )
+        {
+            ucWaveform[ ulWaveformLength++ ] = ( uint8_t ) lLevel;
+        }
+
+        ulBits++;
+    }
+
+    TEST_ASSERT_FALSE( xLine.xTxBusy );
+    TEST_ASSERT_EQUAL_UINT32( sizeof( ucRequest ) * 10U, ulBits );
+
+    waveformIdle( 4 );
+    waveformReplay();
+
+    TEST_ASSERT_EQUAL( sizeof( ucRequest ), ModbusRtu_FrameGet( &xLine, ucFrame, sizeof( ucFrame ) ) );
+    TEST_ASSERT_EQUAL_HEX8_ARRAY( ucRequest, ucFrame, sizeof( ucRequest ) );
+}
@@ -0,0 +1,207 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file broker_loopback.c
+ * @brief Secure Sockets stand-in, see broker_loopback.h.
+ */
+
+#include <string.h>
+
+#include "iot_secure_sockets.h"
+
+#include "broker_loopback.h"
+
+/*-----------------------------------------------------------*/
+
+struct xSOCKET
+{
+    bool xOpen;
+};
+
+static struct xSOCKET xLoopbackSocket;
+
+static const uint8_t * pucServed = NULL;
+static size_t xServedLength = 0;
+static size_t xServedRecordLength = 0;
+static size_t xServedOffset = 0;
+
+static BrokerLoopbackStats_t xLoopbackStats;
+
+/*-----------------------------------------------------------*/
+
+void BrokerLoopback_Start( const uint8_t * pucStream,
+                           size_t xLength,
+                           size_t xRecordLength )
+{
+    pucServed = pucStream;
+    xServedLength = xLength;
+    xServedRecordLength = xRecordLength;
+    xServedOffset = 0;
+
+    ( void ) memset( &xLoopbackStats, 0x00, sizeof( xLoopbackStats ) );
+}
+
+/*-----------------------------------------------------------*/
+
+void BrokerLoopback_GetStats( BrokerLoopbackStats_t * pxStats )
+{
+    *pxStats = xLoopbackStats;
+}
+
+/*-----------------------------------------------------------*/
+
+Socket_t SOCKETS_Socket( int32_t lDomain,
+                         int32_t lType,
+                         int32_t lProtocol )
+{
+    ( void ) lDomain;
+    ( void ) lType;
+    ( void ) lProtocol;
+
+    xLoopbackSocket.xOpen = true;
+
+    return &xLoopbackSocket;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t SOCKETS_SetSockOpt( Socket_t xSocket,
+                            int32_t lLevel,
+                            int32_t lOptionName,
+                            const void * pvOptionValue,
+                            size_t xOptionLength )
+{
+    ( void ) xSocket;
+    ( void ) lLevel;
+    ( void ) lOptionName;
+    ( void ) pvOptionValue;
+    ( void ) xOptionLength;
+
+    return SOCKETS_ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t SOCKETS_GetHostByName( const char * pcHostName )
+{
+    ( void ) pcHostName;
+
+    /* 127.0.0.1 */
+    return SOCKETS_inet_addr_quick( 127, 0, 0, 1 );
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t SOCKETS_Connect( Socket_t xSocket,
+                         SocketsSockaddr_t * pxAddress,
+                         Socklen_t xAddressLength )
+{
+    ( void ) xSocket;
+    ( void ) pxAddress;
+    ( void ) xAddressLength;
+
+    return SOCKETS_ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t SOCKETS_Recv( Socket_t xSocket,
+                      void * pvBuffer,
+                      size_t xBufferLength,
+                      uint32_t ulFlags )
+{
+    size_t xLength;
+
+    ( void ) ulFlags;
+
+    xLoopbackStats.ulRecvCalls++;
+
+    if( ( xSocket->xOpen == false ) || ( xServedOffset == xServedLength ) )
+    {
+        return SOCKETS_ECLOSED;
+    }
+
+    /* Never read past the end of the current record. */
+    xLength = xServedRecordLength - ( xServedOffset % xServedRecordLength );
+
+    if( xLength > ( xServedLength - xServedOffset ) )
+    {
+        xLength = xServedLength - xServedOffset;
+    }
+
+    if( xLength > xBufferLength )
+    {
+        xLength = xBufferLength;
+    }
+
+    ( void ) memcpy( pvBuffer, pucServed + xServedOffset, xLength );
+    xServedOffset += xLength;
+    xLoopbackStats.ulBytesToClient += ( uint32_t ) xLength;
+
+    return ( int32_t ) xLength;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t SOCKETS_Send( Socket_t xSocket,
+                      const void * pvBuffer,
+                      size_t xDataLength,
+                      uint32_t ulFlags )
+{
+    ( void ) pvBuffer;
+    ( void ) ulFlags;
+
+    if( xSocket->xOpen == false )
+    {
+        return SOCKETS_ECLOSED;
+    }
+
+    xLoopbackStats.ulBytesToBroker += ( uint32_t ) xDataLength;
+
+    return ( int32_t ) xDataLength;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t SOCKETS_Shutdown( Socket_t xSocket,
+                          uint32_t ulHow )
+{
+    ( void ) ulHow;
+
+    xSocket->xOpen = false;
+    xLoopbackStats.xShutdown = true;
+
+    return SOCKETS_ERROR_NONE;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t SOCKETS_Close( Socket_t xSocket )
+{
+    xSocket->xOpen = false;
+
+    return SOCKETS_ERROR_NONE;
+}
@@ -0,0 +1,72 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file broker_loopback.h
+ * @brief Secure Sockets stand-in replaying a broker to client byte stream.
+ *
+ * The stream is cut into records of a fixed length, as the broker's TLS
+ * layer would send it. One SOCKETS_Recv() call returns data from a single
+ * record at most, the way one mbedtls_ssl_read() call does, so the number of
+ * calls is the number of TLS reads the client would make. Once the stream is
+ * exhausted or the socket is shut down, SOCKETS_Recv() reports the
+ * connection closed. Data sent by the client is counted and discarded.
+ */
+
+#ifndef BROKER_LOOPBACK_H
+#define BROKER_LOOPBACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Socket activity since the last BrokerLoopback_Start().
+ */
+typedef struct BrokerLoopbackStats
+{
+    uint32_t ulRecvCalls;     /**< SOCKETS_Recv() calls, one TLS read each. */
+    uint32_t ulBytesToClient; /**< Bytes returned by SOCKETS_Recv(). */
+    uint32_t ulBytesToBroker; /**< Bytes accepted by SOCKETS_Send(). */
+    bool xShutdown;           /**< SOCKETS_Shutdown() was called. */
+} BrokerLoopbackStats_t;
+
+/**
+ * @brief Start serving a stream to the next socket.
+ *
+ * @param[in] pucStream Data sent by the broker, must stay valid while used.
+ * @param[in] xLength Length of @p pucStream.
+ * @param[in] xRecordLength Length of the records the stream is cut into.
+ */
+void BrokerLoopback_Start( const uint8_t * pucStream,
+                           size_t xLength,
+                           size_t xRecordLength );
+
+/**
+ * @brief Read the socket activity counters.
+ */
+void BrokerLoopback_GetStats( BrokerLoopbackStats_t * pxStats );
+
+#endif /* BROKER_LOOPBACK_H */
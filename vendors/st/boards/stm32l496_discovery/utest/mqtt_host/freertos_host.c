@@ -0,0 +1,346 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file freertos_host.c
+ * @brief FreeRTOS kernel subset, see freertos_host.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "event_groups.h"
+
+#include "freertos_host.h"
+
+/*-----------------------------------------------------------*/
+
+/* The single task known to the kernel. */
+static TaskFunction_t xPendingTask = NULL;
+static void * pvPendingParameters = NULL;
+static _Thread_local TaskHandle_t xCurrentTask = NULL;
+
+/* Any non-NULL value distinct from the handles of the test thread. */
+static uint8_t ucTaskControlBlock;
+
+/* Handle of a thread outside FreeRTOSHost_RunTask, as the server threads. */
+static _Thread_local uint8_t ucThreadControlBlock;
+
+/* Size of a block, in front of its data. */
+typedef union HeapHeader
+{
+    struct
+    {
+        size_t xSize;
+        bool xCounted;
+    } xBlock;
+    max_align_t xAlign;
+} HeapHeader_t;
+
+static _Thread_local bool xHeapMeasured = false;
+static size_t xHeapCurrent = 0;
+static size_t xHeapPeak = 0;
+static FreeRTOSHostHeapTrace_t xHeapTraceMalloc = NULL;
+static FreeRTOSHostHeapTrace_t xHeapTraceFree = NULL;
+
+/*-----------------------------------------------------------*/
+
+bool FreeRTOSHost_RunTask( void )
+{
+    TaskFunction_t xTask = xPendingTask;
+    void * pvParameters = pvPendingParameters;
+
+    xPendingTask = NULL;
+    pvPendingParameters = NULL;
+
+    if( xTask != NULL )
+    {
+        xCurrentTask = ( TaskHandle_t ) &ucTaskControlBlock;
+        xTask( pvParameters );
+        xCurrentTask = NULL;
+    }
+
+    return xTask != NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xTaskCreate( TaskFunction_t pxTaskCode,
+                        const char * const pcName,
+                        const configSTACK_DEPTH_TYPE usStackDepth,
+                        void * const pvParameters,
+                        UBaseType_t uxPriority,
+                        TaskHandle_t * const pxCreatedTask )
+{
+    ( void ) pcName;
+    ( void ) usStackDepth;
+    ( void ) uxPriority;
+
+    xPendingTask = pxTaskCode;
+    pvPendingParameters = pvParameters;
+
+    if( pxCreatedTask != NULL )
+    {
+        *pxCreatedTask = ( TaskHandle_t ) &ucTaskControlBlock;
+    }
+
+    return pdPASS;
+}
+
+/*-----------------------------------------------------------*/
+
+void vTaskDelete( TaskHandle_t xTaskToDelete )
+{
+    ( void ) xTaskToDelete;
+}
+
+/*-----------------------------------------------------------*/
+
+TaskHandle_t xTaskGetCurrentTaskHandle( void )
+{
+    return ( xCurrentTask != NULL ) ? xCurrentTask : ( TaskHandle_t ) &ucThreadControlBlock;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Ticks follow the monotonic clock of the host. */
+TickType_t xTaskGetTickCount( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( TickType_t ) ( ( ( uint64_t ) xNow.tv_sec * configTICK_RATE_HZ ) +
+                            ( ( uint64_t ) xNow.tv_nsec / ( 1000000000UL / configTICK_RATE_HZ ) ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Nothing to mask, no task is preempted. */
+void vPortEnterCritical( void )
+{
+}
+
+/*-----------------------------------------------------------*/
+
+void vPortExitCritical( void )
+{
+}
+
+/*-----------------------------------------------------------*/
+
+QueueHandle_t xQueueCreateMutexStatic( const uint8_t ucQueueType,
+                                       StaticQueue_t * pxStaticQueue )
+{
+    ( void ) ucQueueType;
+
+    ( void ) memset( pxStaticQueue, 0x00, sizeof( StaticQueue_t ) );
+
+    return ( QueueHandle_t ) pxStaticQueue;
+}
+
+/*-----------------------------------------------------------*/
+
+QueueHandle_t xQueueCreateMutex( const uint8_t ucQueueType )
+{
+    static StaticQueue_t xMutex;
+
+    /* No state, the same handle serves every mutex. */
+    return xQueueCreateMutexStatic( ucQueueType, &xMutex );
+}
+
+/*-----------------------------------------------------------*/
+
+void vQueueDelete( QueueHandle_t xQueue )
+{
+    ( void ) xQueue;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xQueueSemaphoreTake( QueueHandle_t xQueue,
+                                TickType_t xTicksToWait )
+{
+    ( void ) xQueue;
+    ( void ) xTicksToWait;
+
+    return pdTRUE;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xQueueGenericSend( QueueHandle_t xQueue,
+                              const void * const pvItemToQueue,
+                              TickType_t xTicksToWait,
+                              const BaseType_t xCopyPosition )
+{
+    ( void ) xQueue;
+    ( void ) pvItemToQueue;
+    ( void ) xTicksToWait;
+    ( void ) xCopyPosition;
+
+    return pdTRUE;
+}
+
+/*-----------------------------------------------------------*/
+
+/* The bits of an event group are kept in the first word of its storage. */
+EventGroupHandle_t xEventGroupCreateStatic( StaticEventGroup_t * pxEventGroupBuffer )
+{
+    ( void ) memset( pxEventGroupBuffer, 0x00, sizeof( StaticEventGroup_t ) );
+
+    return ( EventGroupHandle_t ) pxEventGroupBuffer;
+}
+
+/*-----------------------------------------------------------*/
+
+EventBits_t xEventGroupClearBits( EventGroupHandle_t xEventGroup,
+                                  const EventBits_t uxBitsToClear )
+{
+    EventBits_t * puxBits = ( EventBits_t * ) xEventGroup;
+    EventBits_t uxBits = *puxBits;
+
+    *puxBits &= ~uxBitsToClear;
+
+    return uxBits;
+}
+
+/*-----------------------------------------------------------*/
+
+EventBits_t xEventGroupSetBits( EventGroupHandle_t xEventGroup,
+                                const EventBits_t uxBitsToSet )
+{
+    EventBits_t * puxBits = ( EventBits_t * ) xEventGroup;
+
+    *puxBits |= uxBitsToSet;
+
+    return *puxBits;
+}
+
+/*-----------------------------------------------------------*/
+
+EventBits_t xEventGroupWaitBits( EventGroupHandle_t xEventGroup,
+                                 const EventBits_t uxBitsToWaitFor,
+                                 const BaseType_t xClearOnExit,
+                                 const BaseType_t xWaitForAllBits,
+                                 TickType_t xTicksToWait )
+{
+    EventBits_t * puxBits = ( EventBits_t * ) xEventGroup;
+    EventBits_t uxBits = *puxBits;
+
+    ( void ) xWaitForAllBits;
+    ( void ) xTicksToWait;
+
+    if( xClearOnExit != pdFALSE )
+    {
+        *puxBits &= ~uxBitsToWaitFor;
+    }
+
+    return uxBits;
+}
+
+/*-----------------------------------------------------------*/
+
+void * pvPortMalloc( size_t xSize )
+{
+    HeapHeader_t * pxHeader = malloc( sizeof( HeapHeader_t ) + xSize );
+    size_t xCurrent;
+
+    if( pxHeader == NULL )
+    {
+        return NULL;
+    }
+
+    pxHeader->xBlock.xSize = xSize;
+    pxHeader->xBlock.xCounted = xHeapMeasured;
+
+    if( xHeapMeasured == true )
+    {
+        xCurrent = __atomic_add_fetch( &xHeapCurrent, xSize, __ATOMIC_RELAXED );
+
+        if( xCurrent > xHeapPeak )
+        {
+            xHeapPeak = xCurrent;
+        }
+    }
+
+    if( xHeapTraceMalloc != NULL )
+    {
+        xHeapTraceMalloc( pxHeader + 1, xSize );
+    }
+
+    return pxHeader + 1;
+}
+
+/*-----------------------------------------------------------*/
+
+void vPortFree( void * pv )
+{
+    HeapHeader_t * pxHeader = ( HeapHeader_t * ) pv - 1;
+
+    if( pv != NULL )
+    {
+        if( xHeapTraceFree != NULL )
+        {
+            xHeapTraceFree( pv, pxHeader->xBlock.xSize );
+        }
+
+        if( pxHeader->xBlock.xCounted == true )
+        {
+            ( void ) __atomic_sub_fetch( &xHeapCurrent, pxHeader->xBlock.xSize, __ATOMIC_RELAXED );
+        }
+
+        free( pxHeader );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void FreeRTOSHost_HeapMeasure( void )
+{
+    xHeapMeasured = true;
+    xHeapPeak = __atomic_load_n( &xHeapCurrent, __ATOMIC_RELAXED );
+}
+
+/*-----------------------------------------------------------*/
+
+void FreeRTOSHost_GetHeapStats( FreeRTOSHostHeapStats_t * pxStats )
+{
+    pxStats->xCurrent = __atomic_load_n( &xHeapCurrent, __ATOMIC_RELAXED );
+    pxStats->xPeak = xHeapPeak;
+}
+
+/*-----------------------------------------------------------*/
+
+void FreeRTOSHost_SetHeapTrace( FreeRTOSHostHeapTrace_t xMalloc,
+                                FreeRTOSHostHeapTrace_t xFree )
+{
+    xHeapTraceMalloc = xMalloc;
+    xHeapTraceFree = xFree;
+}
@@ -0,0 +1,92 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file freertos_host.h
+ * @brief Single threaded subset of the FreeRTOS kernel for host tests of the
+ * platform network layer and the TLS library.
+ *
+ * Tasks are not scheduled: xTaskCreate() only records the task, which the
+ * test then runs to completion on its own thread with FreeRTOSHost_RunTask().
+ * Mutexes never block and event group waits return the bits already set, so
+ * the code under test must be driven in an order that needs no other task.
+ *
+ * The heap is the one of the C library. Blocks allocated by a thread that
+ * called FreeRTOSHost_HeapMeasure() are counted, and every block can be
+ * reported to the traceMALLOC() and traceFREE() hooks of the device. Each
+ * thread running no task has a task handle of its own.
+ */
+
+#ifndef FREERTOS_HOST_H
+#define FREERTOS_HOST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Run the last task created with xTaskCreate(), if any, until it
+ * returns.
+ *
+ * @return false if no task was pending.
+ */
+bool FreeRTOSHost_RunTask( void );
+
+/**
+ * @brief Heap usage of the measured threads.
+ */
+typedef struct FreeRTOSHostHeapStats
+{
+    size_t xCurrent; /**< Bytes allocated and not freed. */
+    size_t xPeak;    /**< Highest xCurrent since the last measure. */
+} FreeRTOSHostHeapStats_t;
+
+/**
+ * @brief Count the allocations of the calling thread from now on, and restart
+ * the peak from the current usage.
+ */
+void FreeRTOSHost_HeapMeasure( void );
+
+/**
+ * @brief Read the heap usage.
+ */
+void FreeRTOSHost_GetHeapStats( FreeRTOSHostHeapStats_t * pxStats );
+
+/**
+ * @brief Heap hook, called with the block and its size as traceMALLOC() and
+ * traceFREE().
+ */
+typedef void (* FreeRTOSHostHeapTrace_t)( void * pvAddress,
+                                          size_t xSize );
+
+/**
+ * @brief Report the blocks allocated and freed from now on.
+ *
+ * @param[in] xMalloc Called after each allocation, NULL for none.
+ * @param[in] xFree Called before each free, NULL for none.
+ */
+void FreeRTOSHost_SetHeapTrace( FreeRTOSHostHeapTrace_t xMalloc,
+                                FreeRTOSHostHeapTrace_t xFree );
+
+#endif /* FREERTOS_HOST_H */
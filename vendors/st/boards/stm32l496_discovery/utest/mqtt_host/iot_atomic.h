@@ -0,0 +1,72 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file iot_atomic.h
+ * @brief Atomic operations of the FreeRTOS kernel for the host tests of the
+ * MQTT library.
+ *
+ * The unit test build puts tests/unit_test/linux/utils on every include path,
+ * and its iot_atomic.h only has increment and decrement. This one comes first
+ * for the MQTT test libraries and has the kernel signatures.
+ */
+
+#ifndef IOT_ATOMIC_H_
+#define IOT_ATOMIC_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Add ulCount to *pulAddend.
+ *
+ * @return The previous value of *pulAddend.
+ */
+static inline uint32_t Atomic_Add_u32( uint32_t volatile * pulAddend,
+                                       uint32_t ulCount )
+{
+    return __atomic_fetch_add( pulAddend, ulCount, __ATOMIC_SEQ_CST );
+}
+
+/**
+ * @brief Increment *pulAddend.
+ *
+ * @return The previous value of *pulAddend.
+ */
+static inline uint32_t Atomic_Increment_u32( uint32_t volatile * pulAddend )
+{
+    return __atomic_fetch_add( pulAddend, 1U, __ATOMIC_SEQ_CST );
+}
+
+/**
+ * @brief Decrement *pulAddend.
+ *
+ * @return The previous value of *pulAddend.
+ */
+static inline uint32_t Atomic_Decrement_u32( uint32_t volatile * pulAddend )
+{
+    return __atomic_fetch_sub( pulAddend, 1U, __ATOMIC_SEQ_CST );
+}
+
+#endif /* ifndef IOT_ATOMIC_H_ */
@@ -0,0 +1,49 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file static_memory_internal.h
+ * @brief Private types of the MQTT and task pool libraries for the host tests
+ * of their static memory.
+ *
+ * Both private headers configure the logs of their library. The MQTT
+ * configuration is undefined before the task pool one. The generated test
+ * runner copies the includes of the test, so it includes this header too.
+ */
+
+#ifndef STATIC_MEMORY_INTERNAL_H_
+#define STATIC_MEMORY_INTERNAL_H_
+
+/* MQTT internal include. */
+#include "private/iot_mqtt_internal.h"
+
+/* Undefine logging configuration set in MQTT internal header. */
+#undef LIBRARY_LOG_NAME
+#undef LIBRARY_LOG_LEVEL
+
+/* Task pool internal include. */
+#include "private/iot_taskpool_internal.h"
+
+#endif /* ifndef STATIC_MEMORY_INTERNAL_H_ */
@@ -0,0 +1,786 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/* The config header is always included first. */
+#include "iot_config.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "unity.h"
+
+#include "private/iot_mqtt_internal.h"
+
+#include "freertos_host.h"
+
+#define MAX_PUBLISHES        ( 4096U )
+#define MAX_JOBS             ( 2U * MAX_PUBLISHES )
+#define TOPIC_NAME           "meters/0042/readings"
+
+/* A backlog of readings after a coverage gap. */
+#define STRESS_PUBLISHES     ( 1000U )
+
+/* More than the pending table holds. */
+#define OVERFLOW_PUBLISHES   ( IOT_MQTT_PENDING_TABLE_SIZE + 500U )
+
+/* ============================  GLOBAL VARIABLES =========================== */
+
+static _mqttConnection_t xMqttConnection;
+
+/* Jobs scheduled on the task pool, run in order by runJobs(). */
+static IotTaskPoolJob_t xJobs[ MAX_JOBS ];
+static uint32_t ulJobHead;
+static uint32_t ulJobCount;
+
+/* Retries scheduled with a delay, run by fireRetries(). */
+static IotTaskPoolJob_t xRetries[ MAX_PUBLISHES ];
+static uint32_t ulRetryCount;
+
+/* Packet identifiers of the PUBLISH sent by the MQTT library, in order. */
+static uint16_t usSent[ MAX_PUBLISHES ];
+static uint32_t ulSentCount;
+static uint32_t ulDupCount;
+
+/* PUBACK waiting to be received by the MQTT library. */
+static uint8_t ucAcks[ MAX_PUBLISHES * 4U ];
+static size_t xAcksLength;
+static size_t xAcksIndex;
+
+/* Completions of the PUBLISH, indexed by packet identifier. */
+static uint8_t ucCompleted[ UINT16_MAX + 1U ];
+static uint32_t ulCompletedCount;
+static uint32_t ulCompletionErrors;
+static uint32_t ulDisconnects;
+
+/* ================  MQTT LIBRARY OUTSIDE OF THE OPERATIONS  ================= */
+
+bool _IotMqtt_IncrementConnectionReferences( _mqttConnection_t * pMqttConnection )
+{
+    pMqttConnection->references++;
+
+    return true;
+}
+
+void _IotMqtt_DecrementConnectionReferences( _mqttConnection_t * pMqttConnection )
+{
+    pMqttConnection->references--;
+}
+
+void _IotMqtt_InvokeSubscriptionCallback( _mqttConnection_t * pMqttConnection,
+                                          IotMqttCallbackParam_t * pCallbackParam )
+{
+    ( void ) pMqttConnection;
+    ( void ) pCallbackParam;
+}
+
+void _IotMqtt_RemoveSubscriptionByPacket( _mqttConnection_t * pMqttConnection,
+                                          uint16_t packetIdentifier,
+                                          int32_t order )
+{
+    ( void ) pMqttConnection;
+    ( void ) packetIdentifier;
+    ( void ) order;
+}
+
+const char * IotMqtt_strerror( IotMqttError_t status )
+{
+    ( void ) status;
+
+    return "error";
+}
+
+const char * IotMqtt_OperationType( IotMqttOperationType_t operation )
+{
+    ( void ) operation;
+
+    return "operation";
+}
+
+/* The task pool queues the jobs, and runs them when the test calls
+ * runJobs(). */
+IotTaskPool_t IotTaskPool_GetSystemTaskPool( void )
+{
+    return NULL;
+}
+
+IotTaskPoolError_t IotTaskPool_CreateJob( IotTaskPoolRoutine_t userCallback,
+                                          void * pUserContext,
+                                          IotTaskPoolJobStorage_t * const pJobStorage,
+                                          IotTaskPoolJob_t * const pJob )
+{
+    ( void ) memset( pJobStorage, 0x00, sizeof( IotTaskPoolJobStorage_t ) );
+    pJobStorage->dummy2 = pUserContext;
+    ( void ) memcpy( &( pJobStorage->dummy3 ), &userCallback, sizeof( userCallback ) );
+    *pJob = ( IotTaskPoolJob_t ) pJobStorage;
+
+    return IOT_TASKPOOL_SUCCESS;
+}
+
+IotTaskPoolError_t IotTaskPool_ScheduleDeferred( IotTaskPool_t taskPool,
+                                                 IotTaskPoolJob_t job,
+                                                 uint32_t timeMs )
+{
+    ( void ) taskPool;
+
+    if( timeMs > 0U )
+    {
+        TEST_ASSERT_LESS_THAN_UINT32( MAX_PUBLISHES, ulRetryCount );
+        xRetries[ ulRetryCount ] = job;
+        ulRetryCount++;
+    }
+    else
+    {
+        TEST_ASSERT_LESS_THAN_UINT32( MAX_JOBS, ulJobCount );
+        xJobs[ ( ulJobHead + ulJobCount ) % MAX_JOBS ] = job;
+        ulJobCount++;
+    }
+
+    return IOT_TASKPOOL_SUCCESS;
+}
+
+IotTaskPoolError_t IotTaskPool_TryCancel( IotTaskPool_t taskPool,
+                                          IotTaskPoolJob_t job,
+                                          IotTaskPoolJobStatus_t * const pStatus )
+{
+    uint32_t i;
+    uint32_t j;
+
+    ( void ) taskPool;
+    ( void ) pStatus;
+
+    for( i = 0; i < ulRetryCount; i++ )
+    {
+        if( xRetries[ i ] == job )
+        {
+            xRetries[ i ] = xRetries[ ulRetryCount - 1U ];
+            ulRetryCount--;
+
+            return IOT_TASKPOOL_SUCCESS;
+        }
+    }
+
+    for( i = 0; i < ulJobCount; i++ )
+    {
+        if( xJobs[ ( ulJobHead + i ) % MAX_JOBS ] == job )
+        {
+            for( j = i; j + 1U < ulJobCount; j++ )
+            {
+                xJobs[ ( ulJobHead + j ) % MAX_JOBS ] = xJobs[ ( ulJobHead + j + 1U ) % MAX_JOBS ];
+            }
+
+            ulJobCount--;
+
+            return IOT_TASKPOOL_SUCCESS;
+        }
+    }
+
+    return IOT_TASKPOOL_CANCEL_FAILED;
+}
+
+IotTaskPoolJobStorage_t * IotTaskPool_GetJobStorageFromHandle( IotTaskPoolJob_t job )
+{
+    return ( IotTaskPoolJobStorage_t * ) job;
+}
+
+const char * IotTaskPool_strerror( IotTaskPoolError_t status )
+{
+    ( void ) status;
+
+    return "error";
+}
+
+void IotMutex_Lock( IotMutex_t * pMutex )
+{
+    ( void ) pMutex;
+}
+
+void IotMutex_Unlock( IotMutex_t * pMutex )
+{
+    ( void ) pMutex;
+}
+
+bool IotSemaphore_Create( IotSemaphore_t * pNewSemaphore,
+                          uint32_t initialValue,
+                          uint32_t maxValue )
+{
+    ( void ) pNewSemaphore;
+    ( void ) initialValue;
+    ( void ) maxValue;
+
+    return true;
+}
+
+void IotSemaphore_Post( IotSemaphore_t * pSemaphore )
+{
+    ( void ) pSemaphore;
+}
+
+void IotSemaphore_Destroy( IotSemaphore_t * pSemaphore )
+{
+    ( void ) pSemaphore;
+}
+
+void IotLog_Generic( int libraryLogSetting,
+                     const char * const pLibraryName,
+                     int messageLevel,
+                     const IotLogConfig_t * const pLogConfig,
+                     const char * const pFormat,
+                     ... )
+{
+    ( void ) libraryLogSetting;
+    ( void ) pLibraryName;
+    ( void ) messageLevel;
+    ( void ) pLogConfig;
+    ( void ) pFormat;
+}
+
+uint32_t Atomic_Add_u32( uint32_t volatile * pulAddend,
+                         uint32_t ulCount )
+{
+    uint32_t ulCurrent = *pulAddend;
+
+    *pulAddend += ulCount;
+
+    return ulCurrent;
+}
+
+const char * getDeviceMetrics( void )
+{
+    return "";
+}
+
+uint16_t getDeviceMetricsLength( void )
+{
+    return 0;
+}
+
+/* ===========================  MOCK NETWORK  =============================== */
+
+/* Records the packet identifier of each PUBLISH, as the mock network of the
+ * MQTT tests; the PUBACK are sent back by receiveAcks(). */
+static size_t mockSend( void * pvConnection,
+                        const uint8_t * pucMessage,
+                        size_t xLength )
+{
+    const uint8_t * pucIdentifier;
+    size_t xHeader = 2;
+
+    ( void ) pvConnection;
+
+    TEST_ASSERT_EQUAL_HEX8( MQTT_PACKET_TYPE_PUBLISH, pucMessage[ 0 ] & 0xf0U );
+    TEST_ASSERT_EQUAL_HEX8( 0x02U, pucMessage[ 0 ] & 0x06U );
+
+    /* Remaining length, then topic name and packet identifier. */
+    while( ( pucMessage[ xHeader - 1U ] & 0x80U ) != 0U )
+    {
+        xHeader++;
+    }
+
+    pucIdentifier = &( pucMessage[ xHeader + 2U + ( ( ( size_t ) pucMessage[ xHeader ] << 8 ) | pucMessage[ xHeader + 1U ] ) ] );
+
+    /* Retransmissions to a MQTT 3.1.1 server have the DUP flag and keep their
+     * packet identifier. */
+    if( ( pucMessage[ 0 ] & 0x08U ) == 0U )
+    {
+        TEST_ASSERT_LESS_THAN_UINT32( MAX_PUBLISHES, ulSentCount );
+        usSent[ ulSentCount ] = ( uint16_t ) ( ( pucIdentifier[ 0 ] << 8 ) | pucIdentifier[ 1 ] );
+        ulSentCount++;
+    }
+    else
+    {
+        ulDupCount++;
+    }
+
+    return xLength;
+}
+
+static size_t mockReceive( void * pvConnection,
+                           uint8_t * pucBuffer,
+                           size_t xBytesRequested )
+{
+    size_t xLength = xAcksLength - xAcksIndex;
+
+    ( void ) pvConnection;
+
+    if( xLength > xBytesRequested )
+    {
+        xLength = xBytesRequested;
+    }
+
+    ( void ) memcpy( pucBuffer, &( ucAcks[ xAcksIndex ] ), xLength );
+    xAcksIndex += xLength;
+
+    return xLength;
+}
+
+static IotNetworkError_t mockClose( void * pvConnection )
+{
+    ( void ) pvConnection;
+
+    return IOT_NETWORK_SUCCESS;
+}
+
+static const IotNetworkInterface_t xMockInterface =
+{
+    .send    = mockSend,
+    .receive = mockReceive,
+    .close   = mockClose
+};
+
+/* ==============================  HELPERS  ================================= */
+
+/* Run the jobs queued, at most ulMax of them. */
+static void runJobs( uint32_t ulMax )
+{
+    IotTaskPoolJob_t xJob;
+    IotTaskPoolRoutine_t xRoutine;
+    uint32_t ulRun;
+
+    for( ulRun = 0; ( ulRun < ulMax ) && ( ulJobCount > 0U ); ulRun++ )
+    {
+        xJob = xJobs[ ulJobHead ];
+        ulJobHead = ( ulJobHead + 1U ) % MAX_JOBS;
+        ulJobCount--;
+
+        ( void ) memcpy( &xRoutine, &( ( ( IotTaskPoolJobStorage_t * ) xJob )->dummy3 ), sizeof( xRoutine ) );
+        xRoutine( NULL, xJob, ( ( IotTaskPoolJobStorage_t * ) xJob )->dummy2 );
+    }
+}
+
+static void disconnectCallback( void * pvContext,
+                                IotMqttCallbackParam_t * pxParam )
+{
+    ( void ) pvContext;
+    ( void ) pxParam;
+
+    ulDisconnects++;
+}
+
+/* Run every retry scheduled, which schedules the next one. */
+static void fireRetries( void )
+{
+    uint32_t ulRetries = ulRetryCount;
+    uint32_t i;
+
+    for( i = 0; i < ulRetries; i++ )
+    {
+        xJobs[ ( ulJobHead + ulJobCount ) % MAX_JOBS ] = xRetries[ i ];
+        ulJobCount++;
+    }
+
+    ulRetryCount = 0;
+    runJobs( ulRetries );
+}
+
+static void publishComplete( void * pvContext,
+                             IotMqttCallbackParam_t * pxParam )
+{
+    uint16_t usIdentifier = ( ( _mqttOperation_t * ) pxParam->u.operation.reference )->u.operation.packetIdentifier;
+
+    ( void ) pvContext;
+
+    if( ( pxParam->u.operation.type != IOT_MQTT_PUBLISH_TO_SERVER ) ||
+        ( pxParam->u.operation.result != IOT_MQTT_SUCCESS ) ||
+        ( ucCompleted[ usIdentifier ] != 0U ) )
+    {
+        ulCompletionErrors++;
+    }
+
+    ucCompleted[ usIdentifier ]++;
+    ulCompletedCount++;
+}
+
+/* Publish at QoS 1 as IotMqtt_Publish does, and send it. */
+static void publish( uint32_t ulRetryLimit )
+{
+    static const char cPayload[] = "{\"meter\":42,\"volume\":1234567}";
+    IotMqttPublishInfo_t xPublishInfo = IOT_MQTT_PUBLISH_INFO_INITIALIZER;
+    IotMqttCallbackInfo_t xCallback = IOT_MQTT_CALLBACK_INFO_INITIALIZER;
+    _mqttOperation_t * pxOperation = NULL;
+
+    xPublishInfo.qos = IOT_MQTT_QOS_1;
+    xPublishInfo.pTopicName = TOPIC_NAME;
+    xPublishInfo.topicNameLength = ( uint16_t ) ( sizeof( TOPIC_NAME ) - 1U );
+    xPublishInfo.pPayload = cPayload;
+    xPublishInfo.payloadLength = sizeof( cPayload ) - 1U;
+    xCallback.function = publishComplete;
+
+    TEST_ASSERT_EQUAL( IOT_MQTT_SUCCESS, _IotMqtt_CreateOperation( &xMqttConnection, 0, &xCallback, &pxOperation ) );
+    pxOperation->u.operation.type = IOT_MQTT_PUBLISH_TO_SERVER;
+    pxOperation->u.operation.retry.limit = ulRetryLimit;
+    pxOperation->u.operation.retry.nextPeriod = 1000U;
+    /* As IotMqtt_Publish, a new packet identifier is only given to retries to
+     * an AWS IoT MQTT server. */
+    TEST_ASSERT_EQUAL( IOT_MQTT_SUCCESS, _IotMqtt_SerializePublish( &xPublishInfo,
+                                                                    &( pxOperation->u.operation.pMqttPacket ),
+                                                                    &( pxOperation->u.operation.packetSize ),
+                                                                    &( pxOperation->u.operation.packetIdentifier ),
+                                                                    ( xMqttConnection.awsIotMqttMode == true ) ?
+                                                                    &( pxOperation->u.operation.pPacketIdentifierHigh ) : NULL ) );
+    TEST_ASSERT_EQUAL( IOT_MQTT_SUCCESS, _IotMqtt_ScheduleOperation( pxOperation, _IotMqtt_ProcessSend, 0 ) );
+}
+
+/* Send PUBLISH until each awaits its PUBACK, one in ulRetryEvery with retries
+ * scheduled. */
+static void publishBacklog( uint32_t ulCount,
+                            uint32_t ulRetryEvery )
+{
+    uint32_t i;
+
+    for( i = 0; i < ulCount; i++ )
+    {
+        publish( ( ( ulRetryEvery != 0U ) && ( ( i % ulRetryEvery ) == 0U ) ) ? 3U : 0U );
+    }
+
+    runJobs( MAX_JOBS );
+
+    TEST_ASSERT_EQUAL_UINT32( ulCount, ulSentCount );
+    TEST_ASSERT_EQUAL_UINT32( ulCount, IotListDouble_Count( &( xMqttConnection.pendingResponse ) ) );
+    TEST_ASSERT_TRUE( IotListDouble_IsEmpty( &( xMqttConnection.pendingProcessing ) ) );
+}
+
+static void queueAck( uint16_t usIdentifier )
+{
+    TEST_ASSERT_LESS_OR_EQUAL( sizeof( ucAcks ), xAcksLength + 4U );
+    ucAcks[ xAcksLength++ ] = MQTT_PACKET_TYPE_PUBACK;
+    ucAcks[ xAcksLength++ ] = 2U;
+    ucAcks[ xAcksLength++ ] = ( uint8_t ) ( usIdentifier >> 8 );
+    ucAcks[ xAcksLength++ ] = ( uint8_t ) usIdentifier;
+}
+
+/* Receive the PUBACK queued, and run the completion callbacks. */
+static void receiveAcks( void )
+{
+    while( xAcksIndex < xAcksLength )
+    {
+        IotMqtt_ReceiveCallback( NULL, &xMqttConnection );
+    }
+
+    runJobs( MAX_JOBS );
+    xAcksLength = 0;
+    xAcksIndex = 0;
+}
+
+static void shuffle( uint16_t * pusIdentifiers,
+                     uint32_t ulCount )
+{
+    uint32_t i;
+    uint32_t j;
+    uint16_t usSwap;
+
+    for( i = ulCount - 1U; i > 0U; i-- )
+    {
+        j = ( uint32_t ) rand() % ( i + 1U );
+        usSwap = pusIdentifiers[ i ];
+        pusIdentifiers[ i ] = pusIdentifiers[ j ];
+        pusIdentifiers[ j ] = usSwap;
+    }
+}
+
+static void assertAllCompleted( uint32_t ulCount )
+{
+    FreeRTOSHostHeapStats_t xStats;
+
+    TEST_ASSERT_EQUAL_UINT32( ulCount, ulCompletedCount );
+    TEST_ASSERT_EQUAL_UINT32( 0, ulCompletionErrors );
+    TEST_ASSERT_EQUAL_UINT32( 0, ulDisconnects );
+    TEST_ASSERT_TRUE( IotListDouble_IsEmpty( &( xMqttConnection.pendingResponse ) ) );
+    TEST_ASSERT_TRUE( IotListDouble_IsEmpty( &( xMqttConnection.pendingProcessing ) ) );
+    TEST_ASSERT_EQUAL_UINT16( 0, xMqttConnection.pendingTable.count );
+    TEST_ASSERT_EQUAL_UINT16( 0, xMqttConnection.pendingTable.overflowCount );
+    TEST_ASSERT_EQUAL_UINT32( 0, ulJobCount );
+    TEST_ASSERT_EQUAL_UINT32( 0, ulRetryCount );
+    TEST_ASSERT_EQUAL_INT32( 0, xMqttConnection.references );
+
+    FreeRTOSHost_GetHeapStats( &xStats );
+    TEST_ASSERT_EQUAL( 0, xStats.xCurrent );
+}
+
+/* Operation matching of _IotMqtt_FindOperation before the pending table. */
+static bool matchPublish( const IotLink_t * pxLink,
+                          void * pvIdentifier )
+{
+    const _mqttOperation_t * pxOperation = IotLink_Container( _mqttOperation_t, pxLink, link );
+
+    return ( pxOperation->u.operation.type == IOT_MQTT_PUBLISH_TO_SERVER ) &&
+           ( pxOperation->u.operation.packetIdentifier == *( ( uint16_t * ) pvIdentifier ) );
+}
+
+static double cpuTimeUs( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &xNow );
+
+    return ( ( double ) xNow.tv_sec * 1e6 ) + ( ( double ) xNow.tv_nsec / 1e3 );
+}
+
+/* ==========================  TEST SETUP/TEARDOWN  ========================== */
+
+void setUp( void )
+{
+    ( void ) memset( &xMqttConnection, 0x00, sizeof( xMqttConnection ) );
+    xMqttConnection.pNetworkInterface = &xMockInterface;
+    xMqttConnection.disconnectCallback.function = disconnectCallback;
+    IotListDouble_Create( &( xMqttConnection.pendingProcessing ) );
+    IotListDouble_Create( &( xMqttConnection.pendingResponse ) );
+
+    ulJobHead = 0;
+    ulJobCount = 0;
+    ulRetryCount = 0;
+    ulSentCount = 0;
+    ulDupCount = 0;
+    xAcksLength = 0;
+    xAcksIndex = 0;
+    ( void ) memset( ucCompleted, 0x00, sizeof( ucCompleted ) );
+    ulCompletedCount = 0;
+    ulCompletionErrors = 0;
+    ulDisconnects = 0;
+
+    srand( 42 );
+    FreeRTOSHost_HeapMeasure();
+}
+
+void tearDown( void )
+{
+}
+
+/* ==============================  TEST CASES  ============================== */
+
+/*!
+ * @brief A backlog of QoS 1 PUBLISH is acknowledged in any order, every
+ * PUBLISH completes once and the table is left empty.
+ */
+void test_Backlog_AckedInAnyOrder( void )
+{
+    uint16_t usOrder[ STRESS_PUBLISHES ];
+    uint32_t ulRound;
+    uint32_t i;
+
+    for( ulRound = 0; ulRound < 3U; ulRound++ )
+    {
+        setUp();
+
+        /* Every fourth PUBLISH has retries, whose job the PUBACK cancels. */
+        publishBacklog( STRESS_PUBLISHES, 4U );
+        TEST_ASSERT_EQUAL_UINT16( STRESS_PUBLISHES, xMqttConnection.pendingTable.count );
+        TEST_ASSERT_EQUAL_UINT32( STRESS_PUBLISHES / 4U, ulRetryCount );
+
+        /* Retransmitted with the DUP flag before the PUBACK. */
+        if( ulRound == 2U )
+        {
+            fireRetries();
+            TEST_ASSERT_EQUAL_UINT32( STRESS_PUBLISHES / 4U, ulDupCount );
+        }
+
+        ( void ) memcpy( usOrder, usSent, sizeof( usOrder ) );
+
+        if( ulRound == 1U )
+        {
+            for( i = 0; i < STRESS_PUBLISHES / 2U; i++ )
+            {
+                usOrder[ i ] = usSent[ STRESS_PUBLISHES - 1U - i ];
+                usOrder[ STRESS_PUBLISHES - 1U - i ] = usSent[ i ];
+            }
+        }
+        else if( ulRound == 2U )
+        {
+            shuffle( usOrder, STRESS_PUBLISHES );
+        }
+
+        /* Half the PUBACK, then a duplicate of each, then the rest. */
+        for( i = 0; i < STRESS_PUBLISHES / 2U; i++ )
+        {
+            queueAck( usOrder[ i ] );
+        }
+
+        receiveAcks();
+        TEST_ASSERT_EQUAL_UINT32( STRESS_PUBLISHES / 2U, ulCompletedCount );
+
+        for( i = 0; i < STRESS_PUBLISHES; i++ )
+        {
+            queueAck( usOrder[ i ] );
+        }
+
+        receiveAcks();
+        assertAllCompleted( STRESS_PUBLISHES );
+    }
+}
+
+/*!
+ * @brief Retries to an AWS IoT MQTT server change the packet identifier of
+ * PUBLISH already awaiting their PUBACK; they are found by the new one only.
+ */
+void test_AwsRetry_FoundByNewIdentifier( void )
+{
+    uint16_t usCurrent[ STRESS_PUBLISHES ];
+    IotLink_t * pxLink;
+    uint32_t i;
+
+    xMqttConnection.awsIotMqttMode = true;
+    publishBacklog( STRESS_PUBLISHES, 1U );
+    fireRetries();
+    fireRetries();
+    TEST_ASSERT_EQUAL_UINT32( 3U * STRESS_PUBLISHES, ulSentCount );
+    TEST_ASSERT_EQUAL_UINT16( STRESS_PUBLISHES, xMqttConnection.pendingTable.count );
+
+    /* PUBACK of the identifiers replaced are ignored. */
+    for( i = 0; i < 2U * STRESS_PUBLISHES; i++ )
+    {
+        queueAck( usSent[ i ] );
+    }
+
+    receiveAcks();
+    TEST_ASSERT_EQUAL_UINT32( 0, ulCompletedCount );
+
+    i = 0;
+
+    IotContainers_ForEach( &( xMqttConnection.pendingResponse ), pxLink )
+    {
+        usCurrent[ i ] = IotLink_Container( _mqttOperation_t, pxLink, link )->u.operation.packetIdentifier;
+        i++;
+    }
+
+    shuffle( usCurrent, STRESS_PUBLISHES );
+
+    for( i = 0; i < STRESS_PUBLISHES; i++ )
+    {
+        queueAck( usCurrent[ i ] );
+    }
+
+    receiveAcks();
+    assertAllCompleted( STRESS_PUBLISHES );
+}
+
+/*!
+ * @brief PUBLISH beyond the capacity of the table are matched by scanning the
+ * pending responses list.
+ */
+void test_TableFull_MatchedByScan( void )
+{
+    uint16_t usOrder[ OVERFLOW_PUBLISHES ];
+    uint32_t i;
+
+    publishBacklog( OVERFLOW_PUBLISHES, 0U );
+    TEST_ASSERT_EQUAL_UINT16( ( IOT_MQTT_PENDING_TABLE_SIZE * 3U ) / 4U, xMqttConnection.pendingTable.count );
+    TEST_ASSERT_EQUAL_UINT16( OVERFLOW_PUBLISHES - ( ( IOT_MQTT_PENDING_TABLE_SIZE * 3U ) / 4U ),
+                              xMqttConnection.pendingTable.overflowCount );
+
+    ( void ) memcpy( usOrder, usSent, sizeof( usOrder ) );
+    shuffle( usOrder, OVERFLOW_PUBLISHES );
+
+    for( i = 0; i < OVERFLOW_PUBLISHES; i++ )
+    {
+        queueAck( usOrder[ i ] );
+    }
+
+    receiveAcks();
+    assertAllCompleted( OVERFLOW_PUBLISHES );
+}
+
+/*!
+ * @brief Operations still pending when the connection is torn down leave the
+ * table.
+ */
+void test_Reset_EmptiesTable( void )
+{
+    IotLink_t * pxLink;
+
+    publishBacklog( OVERFLOW_PUBLISHES, 0U );
+    _IotMqtt_ResetPendingTable( &xMqttConnection );
+    TEST_ASSERT_EQUAL_UINT16( 0, xMqttConnection.pendingTable.count );
+    TEST_ASSERT_EQUAL_UINT16( 0, xMqttConnection.pendingTable.overflowCount );
+
+    /* The operations are then destroyed as by IotMqtt_Disconnect. */
+    while( ( pxLink = IotListDouble_RemoveHead( &( xMqttConnection.pendingResponse ) ) ) != NULL )
+    {
+        _IotMqtt_DestroyOperation( IotLink_Container( _mqttOperation_t, pxLink, link ) );
+    }
+
+    TEST_ASSERT_EQUAL_UINT16( 0, xMqttConnection.pendingTable.count );
+    TEST_ASSERT_EQUAL_UINT16( 0, xMqttConnection.pendingTable.overflowCount );
+}
+
+/*!
+ * @brief PUBACK handled per second by the receive path, against the cost of
+ * the list scan alone that matched them before the table.
+ */
+void test_Benchmark_AckBacklog( void )
+{
+    IotListDouble_t xScanned;
+    uint16_t usOrder[ STRESS_PUBLISHES ];
+    IotLink_t * pxLink;
+    double dStart;
+    double dScanUs;
+    double dReceiveUs;
+    uint32_t i;
+
+    publishBacklog( STRESS_PUBLISHES, 0U );
+    ( void ) memcpy( usOrder, usSent, sizeof( usOrder ) );
+    shuffle( usOrder, STRESS_PUBLISHES );
+
+    /* The list scan of each PUBACK, the operation leaving the list. */
+    IotListDouble_Create( &xScanned );
+    dStart = cpuTimeUs();
+
+    for( i = 0; i < STRESS_PUBLISHES; i++ )
+    {
+        pxLink = IotListDouble_FindFirstMatch( &( xMqttConnection.pendingResponse ), NULL, matchPublish, &( usOrder[ i ] ) );
+        TEST_ASSERT_NOT_NULL( pxLink );
+        IotListDouble_Remove( pxLink );
+        IotListDouble_InsertHead( &xScanned, pxLink );
+    }
+
+    dScanUs = cpuTimeUs() - dStart;
+
+    while( ( pxLink = IotListDouble_RemoveHead( &xScanned ) ) != NULL )
+    {
+        IotListDouble_InsertHead( &( xMqttConnection.pendingResponse ), pxLink );
+    }
+
+    /* The whole receive path: deserialize, find, notify, callback, free. */
+    for( i = 0; i < STRESS_PUBLISHES; i++ )
+    {
+        queueAck( usOrder[ i ] );
+    }
+
+    dStart = cpuTimeUs();
+    receiveAcks();
+    dReceiveUs = cpuTimeUs() - dStart;
+    assertAllCompleted( STRESS_PUBLISHES );
+
+    printf( "mqtt_pending: %u QoS 1 PUBLISH pending, list scan %.3f us per PUBACK, "
+            "receive path with table %.3f us per PUBACK\n",
+            ( unsigned ) STRESS_PUBLISHES,
+            dScanUs / ( double ) STRESS_PUBLISHES,
+            dReceiveUs / ( double ) STRESS_PUBLISHES );
+
+    /* The whole path now costs less than the scan alone did. */
+    TEST_ASSERT_LESS_THAN( dScanUs, dReceiveUs );
+}
@@ -0,0 +1,608 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/* The config header is always included first. */
+#include "iot_config.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "unity.h"
+
+#include "platform/iot_network_freertos.h"
+#include "private/iot_mqtt_internal.h"
+
+#include "freertos_host.h"
+#include "broker_loopback.h"
+
+/* Broker to client streams replayed by the tests. */
+#define STREAM_SIZE              ( 512U * 1024U )
+#define TOPIC_NAME               "meters/0042/readings"
+#define TOPIC_LENGTH             ( sizeof( TOPIC_NAME ) - 1U )
+
+/* Largest TLS record payload. */
+#define TLS_RECORD_MAX_LENGTH    ( 16384U )
+
+#define BENCHMARK_PUBLISHES      ( 2000U )
+#define BENCHMARK_PAYLOAD        ( 64U )
+#define BENCHMARK_ROUNDS         ( 20U )
+
+/* ============================  GLOBAL VARIABLES =========================== */
+
+static uint8_t * pucStream;
+static size_t xStreamLength;
+static uint32_t ulStreamPublishes;
+
+/* What the MQTT library delivered for processing. */
+static uint32_t ulPublishesReceived;
+static uint32_t ulPublishErrors;
+static bool xDisconnectBadPacket;
+
+static _mqttConnection_t xMqttConnection;
+
+/* Port of the network receive path preceding the receive buffer: the receive
+ * task polls one byte, which the MQTT library then reads back before reading
+ * the rest of the packet straight from Secure Sockets. */
+typedef struct LegacyConnection
+{
+    Socket_t xSocket;
+    bool xBufferedByteValid;
+    uint8_t ucBufferedByte;
+} LegacyConnection_t;
+
+static size_t legacyReceive( void * pvConnection,
+                             uint8_t * pucBuffer,
+                             size_t xBytesRequested );
+static IotNetworkError_t legacyClose( void * pvConnection );
+
+static const IotNetworkInterface_t xLegacyInterface =
+{
+    .receive = legacyReceive,
+    .close   = legacyClose
+};
+
+/* ================  MQTT LIBRARY OUTSIDE OF THE RECEIVE PATH  =============== */
+
+/* The payload of PUBLISH number n is n in its first 4 bytes followed by bytes
+ * counting up from n. */
+static void fillPayload( uint8_t * pucPayload,
+                         size_t xLength,
+                         uint32_t ulNumber )
+{
+    size_t i;
+
+    for( i = 0; i < xLength; i++ )
+    {
+        pucPayload[ i ] = ( i < 4U ) ? ( uint8_t ) ( ulNumber >> ( 8U * i ) )
+                          : ( uint8_t ) ( ulNumber + i );
+    }
+}
+
+IotMqttError_t _IotMqtt_ScheduleOperation( _mqttOperation_t * pOperation,
+                                           IotTaskPoolRoutine_t jobRoutine,
+                                           uint32_t delay )
+{
+    const IotMqttPublishInfo_t * pxInfo = &( pOperation->u.publish.publishInfo );
+    static uint8_t ucExpected[ TLS_RECORD_MAX_LENGTH ];
+
+    ( void ) jobRoutine;
+    ( void ) delay;
+
+    if( pxInfo->payloadLength <= sizeof( ucExpected ) )
+    {
+        fillPayload( ucExpected, pxInfo->payloadLength, ulPublishesReceived );
+    }
+
+    if( ( pxInfo->topicNameLength != TOPIC_LENGTH ) ||
+        ( memcmp( pxInfo->pTopicName, TOPIC_NAME, TOPIC_LENGTH ) != 0 ) ||
+        ( pxInfo->payloadLength > sizeof( ucExpected ) ) ||
+        ( memcmp( pxInfo->pPayload, ucExpected, pxInfo->payloadLength ) != 0 ) )
+    {
+        ulPublishErrors++;
+    }
+
+    ulPublishesReceived++;
+
+    /* Processing is complete: release the PUBLISH as the task pool job does. */
+    IotListDouble_Remove( &( pOperation->link ) );
+    IotMqtt_FreeMessage( ( void * ) pOperation->u.publish.pReceivedData );
+    IotMqtt_FreeOperation( pOperation );
+
+    return IOT_MQTT_SUCCESS;
+}
+
+bool _IotMqtt_IncrementConnectionReferences( _mqttConnection_t * pMqttConnection )
+{
+    pMqttConnection->references++;
+
+    return true;
+}
+
+_mqttOperation_t * _IotMqtt_FindOperation( _mqttConnection_t * pMqttConnection,
+                                           IotMqttOperationType_t type,
+                                           const uint16_t * pPacketIdentifier )
+{
+    ( void ) pMqttConnection;
+    ( void ) type;
+    ( void ) pPacketIdentifier;
+
+    return NULL;
+}
+
+void _IotMqtt_Notify( _mqttOperation_t * pOperation )
+{
+    ( void ) pOperation;
+}
+
+void _IotMqtt_ProcessIncomingPublish( IotTaskPool_t pTaskPool,
+                                      IotTaskPoolJob_t pPublishJob,
+                                      void * pContext )
+{
+    ( void ) pTaskPool;
+    ( void ) pPublishJob;
+    ( void ) pContext;
+}
+
+void _IotMqtt_RemoveSubscriptionByPacket( _mqttConnection_t * pMqttConnection,
+                                          uint16_t packetIdentifier,
+                                          int32_t order )
+{
+    ( void ) pMqttConnection;
+    ( void ) packetIdentifier;
+    ( void ) order;
+}
+
+const char * IotMqtt_strerror( IotMqttError_t status )
+{
+    ( void ) status;
+
+    return "error";
+}
+
+IotTaskPool_t IotTaskPool_GetSystemTaskPool( void )
+{
+    return NULL;
+}
+
+IotTaskPoolError_t IotTaskPool_TryCancel( IotTaskPool_t taskPool,
+                                          IotTaskPoolJob_t job,
+                                          IotTaskPoolJobStatus_t * const pStatus )
+{
+    ( void ) taskPool;
+    ( void ) job;
+    ( void ) pStatus;
+
+    return IOT_TASKPOOL_SUCCESS;
+}
+
+void IotMutex_Lock( IotMutex_t * pMutex )
+{
+    ( void ) pMutex;
+}
+
+void IotMutex_Unlock( IotMutex_t * pMutex )
+{
+    ( void ) pMutex;
+}
+
+void IotLog_Generic( int libraryLogSetting,
+                     const char * const pLibraryName,
+                     int messageLevel,
+                     const IotLogConfig_t * const pLogConfig,
+                     const char * const pFormat,
+                     ... )
+{
+    ( void ) libraryLogSetting;
+    ( void ) pLibraryName;
+    ( void ) messageLevel;
+    ( void ) pLogConfig;
+    ( void ) pFormat;
+}
+
+/* Only used to number outgoing packets, the tests send none. */
+uint32_t Atomic_Add_u32( uint32_t volatile * pulAddend,
+                         uint32_t ulCount )
+{
+    uint32_t ulCurrent = *pulAddend;
+
+    *pulAddend += ulCount;
+
+    return ulCurrent;
+}
+
+const char * getDeviceMetrics( void )
+{
+    return "";
+}
+
+uint16_t getDeviceMetricsLength( void )
+{
+    return 0;
+}
+
+static void disconnectCallback( void * pvContext,
+                                IotMqttCallbackParam_t * pxParam )
+{
+    ( void ) pvContext;
+
+    if( pxParam->u.disconnectReason == IOT_MQTT_BAD_PACKET_RECEIVED )
+    {
+        xDisconnectBadPacket = true;
+    }
+}
+
+/* =========================  BYTE POLLING NETWORK  ========================= */
+
+static size_t legacyReceive( void * pvConnection,
+                             uint8_t * pucBuffer,
+                             size_t xBytesRequested )
+{
+    LegacyConnection_t * pxConnection = pvConnection;
+    size_t xBytesReceived = 0;
+    int32_t lStatus;
+
+    if( pxConnection->xBufferedByteValid == true )
+    {
+        *pucBuffer = pxConnection->ucBufferedByte;
+        xBytesReceived = 1;
+        pxConnection->xBufferedByteValid = false;
+    }
+
+    while( xBytesReceived < xBytesRequested )
+    {
+        lStatus = SOCKETS_Recv( pxConnection->xSocket,
+                                pucBuffer + xBytesReceived,
+                                xBytesRequested - xBytesReceived,
+                                0 );
+
+        if( lStatus <= 0 )
+        {
+            break;
+        }
+
+        xBytesReceived += ( size_t ) lStatus;
+    }
+
+    return xBytesReceived;
+}
+
+static IotNetworkError_t legacyClose( void * pvConnection )
+{
+    LegacyConnection_t * pxConnection = pvConnection;
+
+    ( void ) SOCKETS_Shutdown( pxConnection->xSocket, SOCKETS_SHUT_RDWR );
+
+    return IOT_NETWORK_SUCCESS;
+}
+
+static void legacyReceiveTask( LegacyConnection_t * pxConnection )
+{
+    BrokerLoopbackStats_t xStats;
+
+    for( ; ; )
+    {
+        if( SOCKETS_Recv( pxConnection->xSocket, &( pxConnection->ucBufferedByte ), 1, 0 ) <= 0 )
+        {
+            break;
+        }
+
+        pxConnection->xBufferedByteValid = true;
+        IotMqtt_ReceiveCallback( pxConnection, &xMqttConnection );
+
+        BrokerLoopback_GetStats( &xStats );
+
+        if( xStats.xShutdown == true )
+        {
+            break;
+        }
+    }
+}
+
+/* ============================  STREAM HELPERS  ============================ */
+
+static void streamReset( void )
+{
+    xStreamLength = 0;
+    ulStreamPublishes = 0;
+}
+
+static void streamAppend( const uint8_t * pucData,
+                          size_t xLength )
+{
+    TEST_ASSERT_TRUE( xStreamLength + xLength <= STREAM_SIZE );
+    memcpy( pucStream + xStreamLength, pucData, xLength );
+    xStreamLength += xLength;
+}
+
+/* Append a QoS 0 PUBLISH carrying the next payload of the sequence. */
+static void streamAppendPublish( size_t xPayloadLength )
+{
+    uint8_t ucHeader[ 5 + 2 + TOPIC_LENGTH ];
+    static uint8_t ucPayload[ TLS_RECORD_MAX_LENGTH ];
+    size_t xRemainingLength = 2U + TOPIC_LENGTH + xPayloadLength;
+    size_t xHeaderLength = 0;
+
+    TEST_ASSERT_TRUE( xPayloadLength <= sizeof( ucPayload ) );
+
+    ucHeader[ xHeaderLength++ ] = MQTT_PACKET_TYPE_PUBLISH;
+
+    do
+    {
+        ucHeader[ xHeaderLength ] = ( uint8_t ) ( xRemainingLength & 0x7fU );
+        xRemainingLength >>= 7;
+
+        if( xRemainingLength > 0U )
+        {
+            ucHeader[ xHeaderLength ] |= 0x80U;
+        }
+
+        xHeaderLength++;
+    } while( xRemainingLength > 0U );
+
+    ucHeader[ xHeaderLength++ ] = 0U;
+    ucHeader[ xHeaderLength++ ] = ( uint8_t ) TOPIC_LENGTH;
+    memcpy( &ucHeader[ xHeaderLength ], TOPIC_NAME, TOPIC_LENGTH );
+    xHeaderLength += TOPIC_LENGTH;
+
+    fillPayload( ucPayload, xPayloadLength, ulStreamPublishes );
+    ulStreamPublishes++;
+
+    streamAppend( ucHeader, xHeaderLength );
+    streamAppend( ucPayload, xPayloadLength );
+}
+
+static void streamAppendPingresp( void )
+{
+    static const uint8_t ucPingresp[] = { MQTT_PACKET_TYPE_PINGRESP, 0x00 };
+
+    streamAppend( ucPingresp, sizeof( ucPingresp ) );
+}
+
+/* ============================  RECEIVE PATHS  ============================= */
+
+static void connectionReset( const IotNetworkInterface_t * pxInterface,
+                             void * pvNetworkConnection )
+{
+    memset( &xMqttConnection, 0x00, sizeof( xMqttConnection ) );
+    xMqttConnection.pNetworkInterface = pxInterface;
+    xMqttConnection.pNetworkConnection = pvNetworkConnection;
+    xMqttConnection.disconnectCallback.function = disconnectCallback;
+    IotListDouble_Create( &( xMqttConnection.pendingProcessing ) );
+    IotListDouble_Create( &( xMqttConnection.pendingResponse ) );
+
+    ulPublishesReceived = 0;
+    ulPublishErrors = 0;
+    xDisconnectBadPacket = false;
+}
+
+/* Receive the stream through the network layer under test. */
+static void receiveBuffered( size_t xRecordLength )
+{
+    IotNetworkServerInfo_t xServerInfo = IOT_NETWORK_SERVER_INFO_AFR_INITIALIZER;
+    void * pvConnection = NULL;
+
+    xServerInfo.pHostName = "localhost";
+    xServerInfo.port = 8883;
+
+    BrokerLoopback_Start( pucStream, xStreamLength, xRecordLength );
+
+    TEST_ASSERT_EQUAL( IOT_NETWORK_SUCCESS, IotNetworkAfr.create( &xServerInfo, NULL, &pvConnection ) );
+    connectionReset( &IotNetworkAfr, pvConnection );
+
+    TEST_ASSERT_EQUAL( IOT_NETWORK_SUCCESS,
+                       IotNetworkAfr.setReceiveCallback( pvConnection,
+                                                         IotMqtt_ReceiveCallback,
+                                                         &xMqttConnection ) );
+    TEST_ASSERT_TRUE( FreeRTOSHost_RunTask() );
+
+    TEST_ASSERT_EQUAL( IOT_NETWORK_SUCCESS, IotNetworkAfr.destroy( pvConnection ) );
+}
+
+/* Receive the stream through the byte polling port. */
+static void receiveLegacy( size_t xRecordLength )
+{
+    LegacyConnection_t xConnection = { 0 };
+
+    BrokerLoopback_Start( pucStream, xStreamLength, xRecordLength );
+
+    xConnection.xSocket = SOCKETS_Socket( SOCKETS_AF_INET, SOCKETS_SOCK_STREAM, SOCKETS_IPPROTO_TCP );
+    connectionReset( &xLegacyInterface, &xConnection );
+
+    legacyReceiveTask( &xConnection );
+    ( void ) SOCKETS_Close( xConnection.xSocket );
+}
+
+static void assertAllReceived( void )
+{
+    BrokerLoopbackStats_t xStats;
+
+    BrokerLoopback_GetStats( &xStats );
+
+    TEST_ASSERT_EQUAL_UINT32( ulStreamPublishes, ulPublishesReceived );
+    TEST_ASSERT_EQUAL_UINT32( 0, ulPublishErrors );
+    TEST_ASSERT_EQUAL_UINT32( xStreamLength, xStats.ulBytesToClient );
+    TEST_ASSERT_FALSE( xStats.xShutdown );
+    TEST_ASSERT_FALSE( xDisconnectBadPacket );
+    TEST_ASSERT_TRUE( IotListDouble_IsEmpty( &( xMqttConnection.pendingProcessing ) ) );
+}
+
+static double cpuTimeUs( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &xNow );
+
+    return ( ( double ) xNow.tv_sec * 1e6 ) + ( ( double ) xNow.tv_nsec / 1e3 );
+}
+
+/* Receive the stream BENCHMARK_ROUNDS times, print and return the TLS reads
+ * per PUBLISH. */
+static double benchmarkPath( const char * pcName,
+                             void ( * xReceive )( size_t ),
+                             size_t xRecordLength )
+{
+    BrokerLoopbackStats_t xStats;
+    double dStart;
+    double dUs;
+    double dReads;
+    uint32_t i;
+
+    dStart = cpuTimeUs();
+
+    for( i = 0; i < BENCHMARK_ROUNDS; i++ )
+    {
+        xReceive( xRecordLength );
+    }
+
+    dUs = cpuTimeUs() - dStart;
+    assertAllReceived();
+    BrokerLoopback_GetStats( &xStats );
+
+    dReads = ( double ) xStats.ulRecvCalls / ( double ) ulStreamPublishes;
+    printf( "mqtt_receive: %-34s %6.2f TLS reads, %6.3f us CPU per PUBLISH\n",
+            pcName, dReads, dUs / ( double ) ( ulStreamPublishes * BENCHMARK_ROUNDS ) );
+
+    return dReads;
+}
+
+/* ==========================  TEST SETUP/TEARDOWN  ========================== */
+
+void setUp( void )
+{
+    pucStream = malloc( STREAM_SIZE );
+    TEST_ASSERT_NOT_NULL( pucStream );
+    streamReset();
+}
+
+void tearDown( void )
+{
+    free( pucStream );
+    pucStream = NULL;
+}
+
+/* ==============================  TEST CASES  ============================== */
+
+/*!
+ * @brief Packets cut at every position by the TLS records, including fixed
+ * headers, and packets larger than the receive buffer are delivered whole
+ * and in order.
+ */
+void test_Receive_PacketsSplitAcrossRecords( void )
+{
+    static const size_t xRecordLengths[] = { 1U, 2U, 7U, 61U, 1000U, TLS_RECORD_MAX_LENGTH };
+    static const size_t xPayloadLengths[] = { 0U, 1U, 64U, 100U, 127U, 1500U, 5000U };
+    uint32_t i;
+    uint32_t j;
+
+    for( i = 0; i < 300U; i++ )
+    {
+        streamAppendPublish( xPayloadLengths[ i % ( sizeof( xPayloadLengths ) / sizeof( xPayloadLengths[ 0 ] ) ) ] );
+
+        if( ( i % 11U ) == 0U )
+        {
+            streamAppendPingresp();
+        }
+    }
+
+    for( j = 0; j < ( sizeof( xRecordLengths ) / sizeof( xRecordLengths[ 0 ] ) ); j++ )
+    {
+        receiveBuffered( xRecordLengths[ j ] );
+        assertAllReceived();
+    }
+}
+
+/*!
+ * @brief The buffered path delivers what the byte polling path delivers.
+ */
+void test_Receive_SameAsBytePolling( void )
+{
+    uint32_t i;
+
+    for( i = 0; i < 200U; i++ )
+    {
+        streamAppendPublish( ( i * 37U ) % 700U );
+    }
+
+    receiveLegacy( 97U );
+    assertAllReceived();
+    receiveBuffered( 97U );
+    assertAllReceived();
+}
+
+/*!
+ * @brief A remaining length longer than 4 bytes closes the connection as a
+ * bad packet, after the packets preceding it were delivered.
+ */
+void test_Receive_MalformedRemainingLength_ClosesConnection( void )
+{
+    static const uint8_t ucMalformed[] = { MQTT_PACKET_TYPE_PUBLISH, 0xff, 0xff, 0xff, 0xff, 0x01 };
+    BrokerLoopbackStats_t xStats;
+
+    streamAppendPublish( 10U );
+    streamAppendPublish( 20U );
+    streamAppend( ucMalformed, sizeof( ucMalformed ) );
+    streamAppendPublish( 30U );
+
+    receiveBuffered( TLS_RECORD_MAX_LENGTH );
+    BrokerLoopback_GetStats( &xStats );
+
+    TEST_ASSERT_EQUAL_UINT32( 2, ulPublishesReceived );
+    TEST_ASSERT_EQUAL_UINT32( 0, ulPublishErrors );
+    TEST_ASSERT_TRUE( xStats.xShutdown );
+    TEST_ASSERT_TRUE( xDisconnectBadPacket );
+}
+
+/*!
+ * @brief TLS reads and host CPU time per received PUBLISH, byte polling
+ * against buffered receive, for a broker sending one record per PUBLISH and
+ * for one coalescing PUBLISHes into full records. The figures are printed for
+ * comparison between revisions.
+ */
+void test_Benchmark_ReceivePublish( void )
+{
+    size_t xPublishLength;
+    double dLegacyReads;
+    double dBufferedReads;
+    uint32_t i;
+
+    for( i = 0; i < BENCHMARK_PUBLISHES; i++ )
+    {
+        streamAppendPublish( BENCHMARK_PAYLOAD );
+    }
+
+    xPublishLength = xStreamLength / BENCHMARK_PUBLISHES;
+
+    dLegacyReads = benchmarkPath( "byte polling, record per PUBLISH:", receiveLegacy, xPublishLength );
+    dBufferedReads = benchmarkPath( "buffered, record per PUBLISH:", receiveBuffered, xPublishLength );
+    TEST_ASSERT_TRUE( dBufferedReads * 2.0 < dLegacyReads );
+
+    dLegacyReads = benchmarkPath( "byte polling, full records:", receiveLegacy, TLS_RECORD_MAX_LENGTH );
+    dBufferedReads = benchmarkPath( "buffered, full records:", receiveBuffered, TLS_RECORD_MAX_LENGTH );
+    TEST_ASSERT_TRUE( dBufferedReads * 10.0 < dLegacyReads );
+}
@@ -0,0 +1,862 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/* The config header is always included first. */
+#include "iot_config.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "unity.h"
+
+#include "private/iot_mqtt_internal.h"
+
+/* Topic filter matching of the scan of the subscription list. */
+#include "iot_test_access_mqtt.h"
+
+#define MAX_FILTERS           ( 512U )
+#define MAX_TOPIC_LENGTH      ( 256U )
+
+#define RANDOM_ROUNDS         ( 200U )
+#define RANDOM_FILTERS        ( 40U )
+#define RANDOM_TOPICS         ( 100U )
+
+#define BENCHMARK_TOPICS      ( 64U )
+#define BENCHMARK_MIN_US      ( 200000.0 )
+
+/* ============================  GLOBAL VARIABLES =========================== */
+
+static _mqttConnection_t * pxConnection;
+
+/* Topic filters of the subscriptions added by the tests, the callback context
+ * is the index of the filter. */
+static char cFilters[ MAX_FILTERS ][ MAX_TOPIC_LENGTH ];
+static uint32_t ulFilterCount;
+
+/* Callbacks invoked by the last PUBLISH. */
+static uint32_t ulInvoked[ MAX_FILTERS ];
+static uint32_t ulInvokedCount;
+
+/* Filter removed by the callback of the filter ulUnsubscriber. */
+static uint32_t ulUnsubscriber;
+static uint32_t ulUnsubscribed;
+
+/* ================  MQTT LIBRARY OUTSIDE OF THE SUBSCRIPTIONS  ============== */
+
+void IotMutex_Lock( IotMutex_t * pMutex )
+{
+    ( void ) pMutex;
+}
+
+void IotMutex_Unlock( IotMutex_t * pMutex )
+{
+    ( void ) pMutex;
+}
+
+void _IotMqtt_DecrementConnectionReferences( _mqttConnection_t * pMqttConnection )
+{
+    ( void ) pMqttConnection;
+}
+
+void IotLog_Generic( int libraryLogSetting,
+                     const char * const pLibraryName,
+                     int messageLevel,
+                     const IotLogConfig_t * const pLogConfig,
+                     const char * const pFormat,
+                     ... )
+{
+    ( void ) libraryLogSetting;
+    ( void ) pLibraryName;
+    ( void ) messageLevel;
+    ( void ) pLogConfig;
+    ( void ) pFormat;
+}
+
+/* ==============================  HELPERS  ================================= */
+
+static void subscriptionCallback( void * pvContext,
+                                  IotMqttCallbackParam_t * pxParam )
+{
+    uint32_t ulFilter = ( uint32_t ) ( uintptr_t ) pvContext;
+    IotMqttSubscription_t xSubscription = IOT_MQTT_SUBSCRIPTION_INITIALIZER;
+
+    TEST_ASSERT_LESS_THAN_UINT32( MAX_FILTERS, ulInvokedCount );
+    TEST_ASSERT_EQUAL_PTR( pxConnection, pxParam->mqttConnection );
+    TEST_ASSERT_EQUAL( strlen( cFilters[ ulFilter ] ), pxParam->u.message.topicFilterLength );
+    TEST_ASSERT_EQUAL_MEMORY( cFilters[ ulFilter ], pxParam->u.message.pTopicFilter,
+                              pxParam->u.message.topicFilterLength );
+
+    ulInvoked[ ulInvokedCount ] = ulFilter;
+    ulInvokedCount++;
+
+    if( ulFilter == ulUnsubscriber )
+    {
+        xSubscription.pTopicFilter = cFilters[ ulUnsubscribed ];
+        xSubscription.topicFilterLength = ( uint16_t ) strlen( cFilters[ ulUnsubscribed ] );
+        _IotMqtt_RemoveSubscriptionByTopicFilter( pxConnection, &xSubscription, 1 );
+    }
+}
+
+/* Subscribe to a filter, return its index. */
+static uint32_t subscribe( const char * pcFilter )
+{
+    IotMqttSubscription_t xSubscription = IOT_MQTT_SUBSCRIPTION_INITIALIZER;
+    uint32_t ulFilter = ulFilterCount;
+
+    TEST_ASSERT_LESS_THAN_UINT32( MAX_FILTERS, ulFilterCount );
+    TEST_ASSERT_LESS_THAN( MAX_TOPIC_LENGTH, strlen( pcFilter ) );
+    ( void ) strcpy( cFilters[ ulFilter ], pcFilter );
+    ulFilterCount++;
+
+    xSubscription.pTopicFilter = cFilters[ ulFilter ];
+    xSubscription.topicFilterLength = ( uint16_t ) strlen( pcFilter );
+    xSubscription.callback.function = subscriptionCallback;
+    xSubscription.callback.pCallbackContext = ( void * ) ( uintptr_t ) ulFilter;
+
+    TEST_ASSERT_EQUAL( IOT_MQTT_SUCCESS, _IotMqtt_AddSubscriptions( pxConnection, 1, &xSubscription, 1 ) );
+
+    return ulFilter;
+}
+
+static void unsubscribe( uint32_t ulFilter )
+{
+    IotMqttSubscription_t xSubscription = IOT_MQTT_SUBSCRIPTION_INITIALIZER;
+
+    xSubscription.pTopicFilter = cFilters[ ulFilter ];
+    xSubscription.topicFilterLength = ( uint16_t ) strlen( cFilters[ ulFilter ] );
+    _IotMqtt_RemoveSubscriptionByTopicFilter( pxConnection, &xSubscription, 1 );
+}
+
+/* Deliver a PUBLISH through the index, the invoked callbacks are in
+ * ulInvoked. */
+static void publish( const char * pcTopic )
+{
+    IotMqttCallbackParam_t xParam = { .u.message = { 0 } };
+
+    xParam.u.message.info.pTopicName = pcTopic;
+    xParam.u.message.info.topicNameLength = ( uint16_t ) strlen( pcTopic );
+
+    ulInvokedCount = 0;
+    _IotMqtt_InvokeSubscriptionCallback( pxConnection, &xParam );
+}
+
+/* Deliver a PUBLISH as the library did before the index: scan the whole
+ * subscription list. */
+static void publishByScan( const char * pcTopic )
+{
+    IotMqttCallbackParam_t xParam = { .u.message = { 0 } };
+    _topicMatchParams_t xMatch = { 0 };
+    IotLink_t * pxLink = NULL;
+    _mqttSubscription_t * pxSubscription;
+
+    xParam.u.message.info.pTopicName = pcTopic;
+    xParam.u.message.info.topicNameLength = ( uint16_t ) strlen( pcTopic );
+    xMatch.pTopicName = pcTopic;
+    xMatch.topicNameLength = xParam.u.message.info.topicNameLength;
+
+    ulInvokedCount = 0;
+
+    IotMutex_Lock( &( pxConnection->subscriptionMutex ) );
+
+    while( true )
+    {
+        pxLink = IotListDouble_FindFirstMatch( &( pxConnection->subscriptionList ),
+                                               pxLink,
+                                               IotTestMqtt_topicMatch,
+                                               &xMatch );
+
+        if( pxLink == NULL )
+        {
+            break;
+        }
+
+        pxSubscription = IotLink_Container( _mqttSubscription_t, pxLink, link );
+        ( pxSubscription->references )++;
+        IotMutex_Unlock( &( pxConnection->subscriptionMutex ) );
+
+        xParam.mqttConnection = pxConnection;
+        xParam.u.message.pTopicFilter = pxSubscription->pTopicFilter;
+        xParam.u.message.topicFilterLength = pxSubscription->topicFilterLength;
+        pxSubscription->callback.function( pxSubscription->callback.pCallbackContext, &xParam );
+
+        IotMutex_Lock( &( pxConnection->subscriptionMutex ) );
+        ( pxSubscription->references )--;
+        pxLink = pxLink->pNext;
+    }
+
+    IotMutex_Unlock( &( pxConnection->subscriptionMutex ) );
+}
+
+static bool invoked( uint32_t ulFilter )
+{
+    uint32_t i;
+    uint32_t ulCount = 0;
+
+    for( i = 0; i < ulInvokedCount; i++ )
+    {
+        if( ulInvoked[ i ] == ulFilter )
+        {
+            ulCount++;
+        }
+    }
+
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32( 1, ulCount );
+
+    return ulCount == 1U;
+}
+
+/* Matching as specified by MQTT 3.1.1 section 4.7, level by level. */
+static bool referenceMatch( const char * pcFilter,
+                            const char * pcTopic )
+{
+    const char * pcFilterEnd;
+    const char * pcTopicEnd;
+    size_t xFilterLevel;
+    size_t xTopicLevel;
+
+    while( true )
+    {
+        pcFilterEnd = strchr( pcFilter, '/' );
+        xFilterLevel = ( pcFilterEnd != NULL ) ? ( size_t ) ( pcFilterEnd - pcFilter ) : strlen( pcFilter );
+
+        /* "#" matches the parent level and any number of levels. */
+        if( ( xFilterLevel == 1U ) && ( pcFilter[ 0 ] == '#' ) )
+        {
+            return true;
+        }
+
+        if( pcTopic == NULL )
+        {
+            return false;
+        }
+
+        pcTopicEnd = strchr( pcTopic, '/' );
+        xTopicLevel = ( pcTopicEnd != NULL ) ? ( size_t ) ( pcTopicEnd - pcTopic ) : strlen( pcTopic );
+
+        if( !( ( xFilterLevel == 1U ) && ( pcFilter[ 0 ] == '+' ) ) &&
+            ( ( xFilterLevel != xTopicLevel ) || ( memcmp( pcFilter, pcTopic, xTopicLevel ) != 0 ) ) )
+        {
+            return false;
+        }
+
+        if( pcFilterEnd == NULL )
+        {
+            return pcTopicEnd == NULL;
+        }
+
+        pcFilter = pcFilterEnd + 1;
+        pcTopic = ( pcTopicEnd != NULL ) ? pcTopicEnd + 1 : NULL;
+    }
+}
+
+/* Nodes of the index in use. */
+static uint32_t indexNodes( void )
+{
+    const _mqttTopicIndex_t * pxIndex = &( pxConnection->topicIndex );
+    uint32_t ulNodes = 0;
+    uint32_t i;
+
+    for( i = 1; i <= pxIndex->nodesUsed; i++ )
+    {
+        if( pxIndex->nodes[ i ].levelLength != UINT16_MAX )
+        {
+            ulNodes++;
+        }
+    }
+
+    return ulNodes;
+}
+
+static void connectionReset( void )
+{
+    if( pxConnection != NULL )
+    {
+        _IotMqtt_RemoveSubscriptionByPacket( pxConnection, 1, -1 );
+        TEST_ASSERT_TRUE( IotListDouble_IsEmpty( &( pxConnection->subscriptionList ) ) );
+        free( pxConnection );
+    }
+
+    pxConnection = calloc( 1, sizeof( _mqttConnection_t ) );
+    TEST_ASSERT_NOT_NULL( pxConnection );
+    IotListDouble_Create( &( pxConnection->subscriptionList ) );
+    ulFilterCount = 0;
+    ulInvokedCount = 0;
+    ulUnsubscriber = MAX_FILTERS;
+}
+
+static double cpuTimeUs( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &xNow );
+
+    return ( ( double ) xNow.tv_sec * 1e6 ) + ( ( double ) xNow.tv_nsec / 1e3 );
+}
+
+/* ==========================  TEST SETUP/TEARDOWN  ========================== */
+
+void setUp( void )
+{
+    connectionReset();
+}
+
+void tearDown( void )
+{
+    connectionReset();
+    free( pxConnection );
+    pxConnection = NULL;
+}
+
+/* ==============================  TEST CASES  ============================== */
+
+/*!
+ * @brief The filters of the MQTT library unit tests match the same topics
+ * through the index as through the scan of the subscription list.
+ */
+void test_Match_SameAsListScan( void )
+{
+    static const struct
+    {
+        const char * pcTopic;
+        const char * pcFilter;
+        bool xMatch;
+    } xCases[] =
+    {
+        { "/exact",                    "/exact",         true  },
+        { "/aws",                      "/+",             true  },
+        { "/aws/iot",                  "/aws/+",         true  },
+        { "/aws/iot/shadow",           "/aws/+/shadow",  true  },
+        { "/aws/iot/shadow",           "/aws/+/+",       true  },
+        { "aws/",                      "aws/+",          true  },
+        { "/aws",                      "+/+",            true  },
+        { "aws//iot",                  "aws/+/iot",      true  },
+        { "aws//iot",                  "aws//+",         true  },
+        { "aws///iot",                 "aws/+/+/iot",    true  },
+        { "/aws/iot/shadow",           "#",              true  },
+        { "aws/iot/shadow",            "#",              true  },
+        { "/aws/iot/shadow",           "/#",             true  },
+        { "aws/iot/shadow",            "aws/iot/#",      true  },
+        { "aws/iot/shadow/thing",      "aws/iot/#",      true  },
+        { "aws",                       "aws/#",          true  },
+        { "aws/iot/shadow/thing/temp", "aws/+/shadow/#", true  },
+        { "/short",                    "/toolong",       false },
+        { "/exact",                    "/ExAcT",         false },
+        { "aws/",                      "aws/iot",        false },
+        { "aws",                       "aws/",           false },
+        { "aws/iot/shadow",            "aws/+",          false },
+        { "aws/iot/shadow",            "aws/+/thing",    false },
+        { "/aws",                      "+",              false },
+        { "aws/iot/shadow",            "iot/#",          false },
+        { "aws/iot",                   "/#",             false },
+        { "aws/iot/shadow",            "iot/+/#",        false },
+    };
+    uint32_t i;
+    uint32_t ulFilter;
+
+    for( i = 0; i < sizeof( xCases ) / sizeof( xCases[ 0 ] ); i++ )
+    {
+        connectionReset();
+        ulFilter = subscribe( xCases[ i ].pcFilter );
+
+        publish( xCases[ i ].pcTopic );
+        TEST_ASSERT_EQUAL_MESSAGE( xCases[ i ].xMatch, invoked( ulFilter ), xCases[ i ].pcFilter );
+
+        publishByScan( xCases[ i ].pcTopic );
+        TEST_ASSERT_EQUAL_MESSAGE( xCases[ i ].xMatch, invoked( ulFilter ), xCases[ i ].pcFilter );
+
+        TEST_ASSERT_EQUAL( xCases[ i ].xMatch, referenceMatch( xCases[ i ].pcFilter, xCases[ i ].pcTopic ) );
+    }
+}
+
+/*!
+ * @brief Topics the scan of the subscription list missed: "#" after a "+"
+ * level also matches its parent level, and a wildcard filter matches topics of
+ * the same length.
+ */
+void test_Match_MissedByListScan( void )
+{
+    uint32_t ulFilter = subscribe( "meters/+/#" );
+    uint32_t ulSameLength = subscribe( "cmd/+" );
+
+    publish( "meters/0042" );
+    TEST_ASSERT_TRUE( invoked( ulFilter ) );
+    publish( "meters/0042/" );
+    TEST_ASSERT_TRUE( invoked( ulFilter ) );
+    publish( "meters/0042/readings" );
+    TEST_ASSERT_TRUE( invoked( ulFilter ) );
+    publish( "meters" );
+    TEST_ASSERT_FALSE( invoked( ulFilter ) );
+
+    publish( "cmd/x" );
+    TEST_ASSERT_TRUE( invoked( ulSameLength ) );
+    publishByScan( "cmd/x" );
+    TEST_ASSERT_FALSE( invoked( ulSameLength ) );
+}
+
+/*!
+ * @brief Random sets of filters, with wildcards and empty levels, are added
+ * and removed; every PUBLISH invokes each matching filter once.
+ */
+void test_Match_RandomFilters( void )
+{
+    static const char * const pcLevels[] = { "a", "b", "ccc", "" };
+    char cTopic[ MAX_TOPIC_LENGTH ];
+    char cFilter[ MAX_TOPIC_LENGTH ];
+    uint32_t ulRound;
+    uint32_t ulLevels;
+    uint32_t i;
+    uint32_t j;
+    uint32_t ulFilter;
+    uint32_t ulExpected;
+    bool xRemoved[ RANDOM_FILTERS ];
+
+    srand( 1234 );
+
+    for( ulRound = 0; ulRound < RANDOM_ROUNDS; ulRound++ )
+    {
+        connectionReset();
+
+        /* Duplicate filters only replace the callback of the first. */
+        for( i = 0; i < RANDOM_FILTERS; i++ )
+        {
+            cFilter[ 0 ] = '\0';
+            ulLevels = 1U + ( ( uint32_t ) rand() % 4U );
+
+            for( j = 0; j < ulLevels; j++ )
+            {
+                if( j > 0U )
+                {
+                    ( void ) strcat( cFilter, "/" );
+                }
+
+                if( ( j == ulLevels - 1U ) && ( ( rand() % 5 ) == 0 ) )
+                {
+                    ( void ) strcat( cFilter, "#" );
+                }
+                else if( ( rand() % 4 ) == 0 )
+                {
+                    ( void ) strcat( cFilter, "+" );
+                }
+                else
+                {
+                    ( void ) strcat( cFilter, pcLevels[ rand() % 4 ] );
+                }
+            }
+
+            for( j = 0; j < ulFilterCount; j++ )
+            {
+                if( strcmp( cFilters[ j ], cFilter ) == 0 )
+                {
+                    break;
+                }
+            }
+
+            if( j == ulFilterCount )
+            {
+                ( void ) subscribe( cFilter );
+                xRemoved[ j ] = false;
+            }
+        }
+
+        /* Remove some of them. */
+        for( i = 0; i < ulFilterCount; i++ )
+        {
+            if( ( rand() % 3 ) == 0 )
+            {
+                unsubscribe( i );
+                xRemoved[ i ] = true;
+            }
+        }
+
+        for( i = 0; i < RANDOM_TOPICS; i++ )
+        {
+            cTopic[ 0 ] = '\0';
+            ulLevels = 1U + ( ( uint32_t ) rand() % 4U );
+
+            for( j = 0; j < ulLevels; j++ )
+            {
+                if( j > 0U )
+                {
+                    ( void ) strcat( cTopic, "/" );
+                }
+
+                ( void ) strcat( cTopic, pcLevels[ rand() % 4 ] );
+            }
+
+            if( cTopic[ 0 ] == '\0' )
+            {
+                continue;
+            }
+
+            publish( cTopic );
+
+            ulExpected = 0;
+
+            for( ulFilter = 0; ulFilter < ulFilterCount; ulFilter++ )
+            {
+                if( !xRemoved[ ulFilter ] && referenceMatch( cFilters[ ulFilter ], cTopic ) )
+                {
+                    ulExpected++;
+                    TEST_ASSERT_TRUE_MESSAGE( invoked( ulFilter ), cFilters[ ulFilter ] );
+                }
+            }
+
+            TEST_ASSERT_EQUAL_UINT32( ulExpected, ulInvokedCount );
+        }
+
+        /* Removing every filter frees every node. */
+        for( i = 0; i < ulFilterCount; i++ )
+        {
+            if( !xRemoved[ i ] )
+            {
+                unsubscribe( i );
+            }
+        }
+
+        TEST_ASSERT_EQUAL_UINT32( 0, indexNodes() );
+        TEST_ASSERT_TRUE( IotListDouble_IsEmpty( &( pxConnection->subscriptionList ) ) );
+    }
+}
+
+/*!
+ * @brief Levels shared by several filters are stored once, and the space of
+ * removed levels is reused.
+ */
+void test_Levels_InternedAndReclaimed( void )
+{
+    char cFilter[ MAX_TOPIC_LENGTH ];
+    uint16_t usLevelsUsed;
+    uint32_t ulRound;
+    uint32_t i;
+
+    for( i = 0; i < 32U; i++ )
+    {
+        ( void ) snprintf( cFilter, sizeof( cFilter ), "$aws/things/meter-%04u/shadow/update/accepted", ( unsigned ) i );
+        ( void ) subscribe( cFilter );
+    }
+
+    /* "$aws", "things", "shadow", "update", "accepted" once, then one name
+     * per thing. */
+    TEST_ASSERT_EQUAL_UINT16( 4U + 6U + 6U + 6U + 8U + ( 32U * 10U ),
+                              pxConnection->topicIndex.levelsUsed );
+    TEST_ASSERT_EQUAL_UINT32( 2U + ( 32U * 4U ), indexNodes() );
+
+    /* Replace the things many times over the size of the level buffer. */
+    for( ulRound = 0; ulRound < 200U; ulRound++ )
+    {
+        for( i = 0; i < 32U; i++ )
+        {
+            unsubscribe( i );
+            ( void ) snprintf( cFilters[ i ], MAX_TOPIC_LENGTH, "$aws/things/meter-%04u/shadow/update/accepted",
+                               ( unsigned ) ( ( ulRound * 32U ) + i + 32U ) );
+        }
+
+        ulFilterCount = 0;
+
+        for( i = 0; i < 32U; i++ )
+        {
+            ( void ) strcpy( cFilter, cFilters[ i ] );
+            ( void ) subscribe( cFilter );
+        }
+    }
+
+    usLevelsUsed = pxConnection->topicIndex.levelsUsed;
+    TEST_ASSERT_LESS_OR_EQUAL_UINT16( IOT_MQTT_TOPIC_INDEX_LEVELS_SIZE, usLevelsUsed );
+    TEST_ASSERT_EQUAL_UINT16( 0, pxConnection->topicIndex.overflowCount );
+
+    publish( "$aws/things/meter-6431/shadow/update/accepted" );
+    TEST_ASSERT_EQUAL_UINT32( 1, ulInvokedCount );
+    TEST_ASSERT_EQUAL_STRING( "$aws/things/meter-6431/shadow/update/accepted", cFilters[ ulInvoked[ 0 ] ] );
+}
+
+/*!
+ * @brief Filters that do not fit in the index are matched by scanning the
+ * subscription list.
+ */
+void test_IndexFull_MatchedByScan( void )
+{
+    char cFilter[ MAX_TOPIC_LENGTH ];
+    char cLevel[ 201 ];
+    uint32_t ulFull = MAX_FILTERS;
+    uint32_t i;
+
+    /* Distinct 200 byte levels fill the level buffer. */
+    for( i = 0; ( i < MAX_FILTERS ) && ( ulFull == MAX_FILTERS ); i++ )
+    {
+        ( void ) memset( cLevel, 'a' + ( int ) ( i % 26U ), 200 );
+        ( void ) snprintf( &( cLevel[ 195 ] ), 6, "%05u", ( unsigned ) i );
+        ( void ) snprintf( cFilter, sizeof( cFilter ), "big/%s/+", cLevel );
+        ( void ) subscribe( cFilter );
+
+        if( pxConnection->topicIndex.overflowCount > 0U )
+        {
+            ulFull = i;
+        }
+    }
+
+    TEST_ASSERT_NOT_EQUAL( MAX_FILTERS, ulFull );
+    TEST_ASSERT_FALSE( ( ( _mqttSubscription_t * ) IotListDouble_PeekHead(
+                             &( pxConnection->subscriptionList ) ) )->indexed );
+
+    ( void ) subscribe( "big/#" );
+    TEST_ASSERT_EQUAL_UINT16( 1, pxConnection->topicIndex.overflowCount );
+
+    /* The filter left out is still delivered, once. */
+    ( void ) snprintf( cFilter, sizeof( cFilter ), "big/%.195s%05u/xy", cFilters[ ulFull ] + 4, ( unsigned ) ulFull );
+    publish( cFilter );
+    TEST_ASSERT_EQUAL_UINT32( 2, ulInvokedCount );
+    TEST_ASSERT_TRUE( invoked( ulFull ) );
+    TEST_ASSERT_TRUE( invoked( ulFull + 1U ) );
+
+    unsubscribe( ulFull );
+    TEST_ASSERT_EQUAL_UINT16( 0, pxConnection->topicIndex.overflowCount );
+    publish( cFilter );
+    TEST_ASSERT_EQUAL_UINT32( 1, ulInvokedCount );
+
+    /* Room made by removed filters is used again. */
+    unsubscribe( 0 );
+    ( void ) strcpy( cFilter, cFilters[ ulFull ] );
+    ( void ) subscribe( cFilter );
+    TEST_ASSERT_EQUAL_UINT16( 0, pxConnection->topicIndex.overflowCount );
+}
+
+/*!
+ * @brief More matches than a batch all invoke their callback once, also when
+ * a callback removes a subscription not invoked yet.
+ */
+void test_ManyMatches_InvokedOnce( void )
+{
+    static const char * const pcFilters[] =
+    {
+        "#",             "meters/#",          "meters/+/#",        "meters/0042/#",
+        "+/+/+",         "meters/+/readings", "+/0042/readings",   "+/+/readings",
+        "meters/0042/+", "+/0042/+",          "meters/0042/readings/#",
+        "+/+/readings/#", "meters/+/+",       "+/#",               "meters/0042/readings",
+    };
+    uint32_t i;
+
+    for( i = 0; i < sizeof( pcFilters ) / sizeof( pcFilters[ 0 ] ); i++ )
+    {
+        ( void ) subscribe( pcFilters[ i ] );
+    }
+
+    TEST_ASSERT_GREATER_THAN_UINT32( IOT_MQTT_TOPIC_INDEX_MATCHES, ulFilterCount );
+
+    publish( "meters/0042/readings" );
+    TEST_ASSERT_EQUAL_UINT32( ulFilterCount, ulInvokedCount );
+
+    for( i = 0; i < ulFilterCount; i++ )
+    {
+        TEST_ASSERT_TRUE( invoked( i ) );
+    }
+
+    /* The first callback removes the last match. */
+    ulUnsubscriber = ulInvoked[ 0 ];
+    ulUnsubscribed = ulInvoked[ ulFilterCount - 1U ];
+    publish( "meters/0042/readings" );
+    TEST_ASSERT_EQUAL_UINT32( ulFilterCount - 1U, ulInvokedCount );
+    TEST_ASSERT_FALSE( invoked( ulUnsubscribed ) );
+
+    ulUnsubscriber = MAX_FILTERS;
+    publish( "meters/0042/readings" );
+    TEST_ASSERT_EQUAL_UINT32( ulFilterCount - 1U, ulInvokedCount );
+}
+
+/*!
+ * @brief Subscriptions removed by packet, as on a rejected SUBSCRIBE, leave
+ * the index.
+ */
+void test_RemoveByPacket_LeavesIndex( void )
+{
+    IotMqttSubscription_t xSubscriptions[ 2 ] = { IOT_MQTT_SUBSCRIPTION_INITIALIZER, IOT_MQTT_SUBSCRIPTION_INITIALIZER };
+    uint32_t ulKept = subscribe( "cmd/+" );
+
+    ( void ) strcpy( cFilters[ 1 ], "cmd/reboot" );
+    ( void ) strcpy( cFilters[ 2 ], "ota/#" );
+    ulFilterCount = 3;
+
+    for( uint32_t i = 0; i < 2U; i++ )
+    {
+        xSubscriptions[ i ].pTopicFilter = cFilters[ i + 1U ];
+        xSubscriptions[ i ].topicFilterLength = ( uint16_t ) strlen( cFilters[ i + 1U ] );
+        xSubscriptions[ i ].callback.function = subscriptionCallback;
+        xSubscriptions[ i ].callback.pCallbackContext = ( void * ) ( uintptr_t ) ( i + 1U );
+    }
+
+    TEST_ASSERT_EQUAL( IOT_MQTT_SUCCESS, _IotMqtt_AddSubscriptions( pxConnection, 7, xSubscriptions, 2 ) );
+    publish( "cmd/reboot" );
+    TEST_ASSERT_EQUAL_UINT32( 2, ulInvokedCount );
+
+    /* The server rejected the second filter of packet 7, then the first. */
+    _IotMqtt_RemoveSubscriptionByPacket( pxConnection, 7, 1 );
+    publish( "ota/job" );
+    TEST_ASSERT_EQUAL_UINT32( 0, ulInvokedCount );
+    _IotMqtt_RemoveSubscriptionByPacket( pxConnection, 7, -1 );
+    publish( "cmd/reboot" );
+    TEST_ASSERT_EQUAL_UINT32( 1, ulInvokedCount );
+    TEST_ASSERT_TRUE( invoked( ulKept ) );
+    TEST_ASSERT_EQUAL_UINT32( 2, indexNodes() );
+}
+
+/*!
+ * @brief PUBLISH matched per second through the index and by scanning the
+ * subscription list, for the board topics and 8 to 256 filters.
+ */
+void test_Benchmark_MatchRate( void )
+{
+    static const uint32_t ulSizes[] = { 8U, 32U, 64U, 128U, 256U };
+    char cTopics[ BENCHMARK_TOPICS ][ MAX_TOPIC_LENGTH ];
+    char cFilter[ MAX_TOPIC_LENGTH ];
+    uint32_t ulMatchesIndex;
+    uint32_t ulMatchesScan;
+    uint32_t ulPublishes;
+    uint32_t ulSize;
+    uint32_t i;
+    uint32_t n;
+    double dStart;
+    double dIndexRate = 0.0;
+    double dScanRate = 0.0;
+
+    for( n = 0; n < sizeof( ulSizes ) / sizeof( ulSizes[ 0 ] ); n++ )
+    {
+        connectionReset();
+
+        /* The filters of the board: shadow, jobs, OTA stream and defender of
+         * the things managed, then commands of the meters on the Modbus
+         * line. */
+        for( i = 0; ulFilterCount < ulSizes[ n ]; i++ )
+        {
+            switch( i % 8U )
+            {
+                case 0:
+                    ( void ) snprintf( cFilter, sizeof( cFilter ), "$aws/things/meter-%04u/shadow/update/accepted", ( unsigned ) i );
+                    break;
+
+                case 1:
+                    ( void ) snprintf( cFilter, sizeof( cFilter ), "$aws/things/meter-%04u/shadow/update/delta", ( unsigned ) i );
+                    break;
+
+                case 2:
+                    ( void ) snprintf( cFilter, sizeof( cFilter ), "$aws/things/meter-%04u/jobs/notify-next", ( unsigned ) i );
+                    break;
+
+                case 3:
+                    ( void ) snprintf( cFilter, sizeof( cFilter ), "$aws/things/meter-%04u/jobs/$next/get/+", ( unsigned ) i );
+                    break;
+
+                case 4:
+                    ( void ) snprintf( cFilter, sizeof( cFilter ), "$aws/things/meter-%04u/streams/+/data/cbor", ( unsigned ) i );
+                    break;
+
+                case 5:
+                    ( void ) snprintf( cFilter, sizeof( cFilter ), "$aws/things/meter-%04u/defender/metrics/json/+", ( unsigned ) i );
+                    break;
+
+                case 6:
+                    ( void ) snprintf( cFilter, sizeof( cFilter ), "meters/%04u/cmd/#", ( unsigned ) i );
+                    break;
+
+                default:
+                    ( void ) snprintf( cFilter, sizeof( cFilter ), "meters/+/config/%04u", ( unsigned ) i );
+                    break;
+            }
+
+            ( void ) subscribe( cFilter );
+        }
+
+        TEST_ASSERT_EQUAL_UINT16( 0, pxConnection->topicIndex.overflowCount );
+
+        /* Topics of the filters, and as many that match none. */
+        for( i = 0; i < BENCHMARK_TOPICS; i++ )
+        {
+            ulSize = ( i * 7U ) % ulFilterCount;
+
+            if( ( i % 2U ) == 1U )
+            {
+                ( void ) snprintf( cTopics[ i ], MAX_TOPIC_LENGTH, "$aws/things/meter-%04u/shadow/get/accepted", ( unsigned ) i );
+            }
+            else
+            {
+                ( void ) strcpy( cTopics[ i ], cFilters[ ulSize ] );
+
+                /* Give the wildcards a value, longer than the wildcard as the
+                 * scan of the list misses topics of the length of the
+                 * filter. */
+                for( char * pc = strpbrk( cTopics[ i ], "+#" ); pc != NULL; pc = strpbrk( cTopics[ i ], "+#" ) )
+                {
+                    ( void ) memmove( pc + 2, pc + 1, strlen( pc + 1 ) + 1U );
+                    pc[ 0 ] = 'v';
+                    pc[ 1 ] = '1';
+                }
+            }
+        }
+
+        /* Both deliver the same callbacks. */
+        for( i = 0; i < BENCHMARK_TOPICS; i++ )
+        {
+            publishByScan( cTopics[ i ] );
+            ulMatchesScan = ulInvokedCount;
+            publish( cTopics[ i ] );
+            ulMatchesIndex = ulInvokedCount;
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE( ulMatchesScan, ulMatchesIndex, cTopics[ i ] );
+        }
+
+        ulPublishes = 0;
+        dStart = cpuTimeUs();
+
+        do
+        {
+            publishByScan( cTopics[ ulPublishes % BENCHMARK_TOPICS ] );
+            ulPublishes++;
+        } while( ( cpuTimeUs() - dStart ) < BENCHMARK_MIN_US );
+
+        dScanRate = ( double ) ulPublishes * 1e6 / ( cpuTimeUs() - dStart );
+
+        ulPublishes = 0;
+        dStart = cpuTimeUs();
+
+        do
+        {
+            publish( cTopics[ ulPublishes % BENCHMARK_TOPICS ] );
+            ulPublishes++;
+        } while( ( cpuTimeUs() - dStart ) < BENCHMARK_MIN_US );
+
+        dIndexRate = ( double ) ulPublishes * 1e6 / ( cpuTimeUs() - dStart );
+
+        printf( "mqtt_subscription: %3u filters, %4u nodes, %5u level bytes: "
+                "list scan %9.0f, index %9.0f PUBLISH/s (x%.1f)\n",
+                ( unsigned ) ulFilterCount,
+                ( unsigned ) indexNodes(),
+                ( unsigned ) pxConnection->topicIndex.levelsUsed,
+                dScanRate, dIndexRate, dIndexRate / dScanRate );
+    }
+
+    /* With 256 filters the index leaves the scan far behind. */
+    TEST_ASSERT_GREATER_THAN( dScanRate * 4.0, dIndexRate );
+}
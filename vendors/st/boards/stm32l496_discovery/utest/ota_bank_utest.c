@@ -0,0 +1,734 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+
+#include "mbedtls/sha256.h"
+
+#include "ota_bank.h"
+
+/* Geometry of the STM32L496: two banks of 256 pages of 2K, the top 64K of
+ * each bank is the application data window. */
+#define PAGE_SIZE            ( 2048U )
+#define BANK_SIZE            ( 512U * 1024U )
+#define DATA_OFFSET          ( 0x70000U )
+#define DESCRIPTOR_OFFSET    ( DATA_OFFSET - PAGE_SIZE )
+
+/* OTA blocks of 1K, and an update whose last block is short. */
+#define BLOCK_SIZE           ( 1024U )
+#define IMAGE_SIZE           ( ( 40U * BLOCK_SIZE ) + 100U )
+#define BLOCK_COUNT          ( ( IMAGE_SIZE + BLOCK_SIZE - 1U ) / BLOCK_SIZE )
+
+/* ============================  GLOBAL VARIABLES =========================== */
+
+/* Physical banks, the one the device booted from is mapped first. */
+static uint64_t ullBanks[ 2 ][ BANK_SIZE / sizeof( uint64_t ) ];
+static uint32_t ulBootBank;
+static uint32_t ulOptionBank; /* BFB2, applied at the next boot. */
+static bool xResetRequested;
+
+/* Operations left before the power is cut, negative when no cut is armed. */
+static int32_t lOpsBeforeCut;
+
+/* Depth of the flash lock taken by the writer. */
+static int32_t lLockDepth;
+
+static OtaBankFlash_t xSimFlash;
+static OtaBank_t xBank;
+
+static uint8_t ucImage[ IMAGE_SIZE ];
+static mbedtls_sha256_context xSha;
+
+/* ===========================  Flash simulator  ============================ */
+
+static uint8_t * bankBytes( uint32_t ulBank )
+{
+    /* Running is the bank booted from, inactive the other one. */
+    uint32_t ulPhysical = ( ulBank == otabankRUNNING ) ? ulBootBank : ( 1U - ulBootBank );
+
+    return ( uint8_t * ) ullBanks[ ulPhysical ];
+}
+
+static bool powerCut( void )
+{
+    if( lOpsBeforeCut == 0 )
+    {
+        return true;
+    }
+
+    if( lOpsBeforeCut > 0 )
+    {
+        lOpsBeforeCut--;
+    }
+
+    return false;
+}
+
+static void checkAccess( uint32_t ulBank,
+                         uint32_t ulOffset,
+                         uint32_t ulLength )
+{
+    TEST_ASSERT_TRUE( ulBank <= otabankINACTIVE );
+    TEST_ASSERT_TRUE( ( ulOffset + ulLength ) <= BANK_SIZE );
+
+    /* The running image is never touched. */
+    if( ulBank == otabankRUNNING )
+    {
+        TEST_ASSERT_TRUE( ulOffset >= DESCRIPTOR_OFFSET );
+    }
+
+    /* The application data window is copied under the flash lock. */
+    if( ( ulBank == otabankRUNNING ) && ( ulOffset >= DATA_OFFSET ) )
+    {
+        TEST_ASSERT_GREATER_THAN( 0, lLockDepth );
+    }
+}
+
+static int32_t simErase( void * pvContext,
+                         uint32_t ulBank,
+                         uint32_t ulOffset )
+{
+    TEST_ASSERT_EQUAL_PTR( ullBanks, pvContext );
+    TEST_ASSERT_EQUAL( 0, ulOffset % PAGE_SIZE );
+    checkAccess( ulBank, ulOffset, PAGE_SIZE );
+
+    if( powerCut() == true )
+    {
+        /* The page is left half erased. */
+        memset( &bankBytes( ulBank )[ ulOffset ], 0xFF, PAGE_SIZE / 2U );
+
+        return -1;
+    }
+
+    memset( &bankBytes( ulBank )[ ulOffset ], 0xFF, PAGE_SIZE );
+
+    return 0;
+}
+
+static int32_t simProgram( void * pvContext,
+                           uint32_t ulBank,
+                           uint32_t ulOffset,
+                           const void * pvData,
+                           uint32_t ulLength )
+{
+    static const uint8_t ucErased[ otabankPROGRAM_UNIT ] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+    static const uint8_t ucZero[ otabankPROGRAM_UNIT ] = { 0 };
+    const uint8_t * pucData = pvData;
+    uint8_t * pucFlash = bankBytes( ulBank );
+    uint32_t i;
+
+    TEST_ASSERT_EQUAL_PTR( ullBanks, pvContext );
+    TEST_ASSERT_EQUAL( 0, ulOffset % otabankPROGRAM_UNIT );
+    TEST_ASSERT_EQUAL( 0, ulLength % otabankPROGRAM_UNIT );
+    TEST_ASSERT_EQUAL( 0, ( uintptr_t ) pvData % otabankPROGRAM_UNIT );
+    checkAccess( ulBank, ulOffset, ulLength );
+
+    for( i = 0; i < ulLength; i += otabankPROGRAM_UNIT )
+    {
+        /* Like the L4 controller, only program erased double words, or clear
+         * one to zero. */
+        TEST_ASSERT_TRUE( ( memcmp( &pucFlash[ ulOffset + i ], ucErased, otabankPROGRAM_UNIT ) == 0 ) ||
+                          ( memcmp( &pucData[ i ], ucZero, otabankPROGRAM_UNIT ) == 0 ) );
+    }
+
+    if( powerCut() == true )
+    {
+        /* Half of the data made it. */
+        memcpy( &pucFlash[ ulOffset ], pucData, ( ulLength / 2U ) & ~( otabankPROGRAM_UNIT - 1U ) );
+
+        return -1;
+    }
+
+    memcpy( &pucFlash[ ulOffset ], pucData, ulLength );
+
+    return 0;
+}
+
+static int32_t simSwap( void * pvContext )
+{
+    TEST_ASSERT_EQUAL_PTR( ullBanks, pvContext );
+    TEST_ASSERT_GREATER_THAN( 0, lLockDepth );
+
+    if( powerCut() == true )
+    {
+        return -1;
+    }
+
+    ulOptionBank = 1U - ulBootBank;
+    xResetRequested = true;
+
+    return 0;
+}
+
+static void simLock( void * pvContext )
+{
+    TEST_ASSERT_EQUAL_PTR( ullBanks, pvContext );
+    lLockDepth++;
+}
+
+static void simUnlock( void * pvContext )
+{
+    TEST_ASSERT_EQUAL_PTR( ullBanks, pvContext );
+    TEST_ASSERT_GREATER_THAN( 0, lLockDepth );
+    lLockDepth--;
+}
+
+/* ==========================  Helper functions  ============================ */
+
+static void hashUpdate( void * pvHashContext,
+                        const uint8_t * pucData,
+                        size_t xLength )
+{
+    TEST_ASSERT_EQUAL_PTR( &xSha, pvHashContext );
+    TEST_ASSERT_EQUAL( 0, mbedtls_sha256_update_ret( &xSha, pucData, xLength ) );
+}
+
+/* Reset the device, as many times as the writer asks for it. */
+static void boot( void )
+{
+    uint32_t i;
+
+    for( i = 0; i < 3U; i++ )
+    {
+        /* The writer gave the flash back, also after a failure. */
+        TEST_ASSERT_EQUAL( 0, lLockDepth );
+        ulBootBank = ulOptionBank;
+        xResetRequested = false;
+        lOpsBeforeCut = -1;
+        xSimFlash.pucBank[ otabankRUNNING ] = bankBytes( otabankRUNNING );
+        xSimFlash.pucBank[ otabankINACTIVE ] = bankBytes( otabankINACTIVE );
+        TEST_ASSERT_TRUE( OtaBank_Open( &xBank, &xSimFlash ) );
+
+        if( xResetRequested == false )
+        {
+            return;
+        }
+    }
+
+    TEST_FAIL_MESSAGE( "Boot loop" );
+}
+
+/* Application data of the window, in the second mapped bank. */
+static uint8_t dataByte( uint32_t ulOffset )
+{
+    return ( uint8_t ) ( ( ulOffset * 13U ) >> 8 );
+}
+
+static void checkData( void )
+{
+    const uint8_t * pucWindow = &bankBytes( otabankINACTIVE )[ DATA_OFFSET ];
+    uint32_t i;
+
+    for( i = 0; i < ( BANK_SIZE - DATA_OFFSET ); i++ )
+    {
+        if( pucWindow[ i ] != dataByte( i ) )
+        {
+            TEST_FAIL_MESSAGE( "Application data lost" );
+        }
+    }
+}
+
+static bool runsImage( const uint8_t * pucExpected,
+                       uint32_t ulLength )
+{
+    return memcmp( bankBytes( otabankRUNNING ), pucExpected, ulLength ) == 0;
+}
+
+static void begin( void )
+{
+    mbedtls_sha256_init( &xSha );
+    TEST_ASSERT_EQUAL( 0, mbedtls_sha256_starts_ret( &xSha, 0 ) );
+    TEST_ASSERT_TRUE( OtaBank_Begin( &xBank, IMAGE_SIZE, BLOCK_SIZE, hashUpdate, &xSha ) );
+}
+
+static int32_t writeBlock( uint32_t ulBlock )
+{
+    uint32_t ulOffset = ulBlock * BLOCK_SIZE;
+    uint32_t ulLength = ( ( IMAGE_SIZE - ulOffset ) < BLOCK_SIZE ) ? ( IMAGE_SIZE - ulOffset ) : BLOCK_SIZE;
+    uint8_t ucBlock[ BLOCK_SIZE + 1U ];
+
+    /* The agent buffer has no particular alignment. */
+    memcpy( &ucBlock[ 1 ], &ucImage[ ulOffset ], ulLength );
+
+    return OtaBank_Write( &xBank, ulOffset, &ucBlock[ 1 ], ulLength );
+}
+
+static void writeAll( void )
+{
+    uint32_t i;
+
+    for( i = 0; i < BLOCK_COUNT; i++ )
+    {
+        TEST_ASSERT_TRUE( writeBlock( i ) > 0 );
+    }
+}
+
+static void checkDigest( void )
+{
+    uint8_t ucDigest[ 32 ];
+    uint8_t ucExpected[ 32 ];
+
+    TEST_ASSERT_TRUE( OtaBank_Complete( &xBank ) );
+    TEST_ASSERT_EQUAL( 0, mbedtls_sha256_finish_ret( &xSha, ucDigest ) );
+    TEST_ASSERT_EQUAL( 0, mbedtls_sha256_ret( ucImage, IMAGE_SIZE, ucExpected, 0 ) );
+    TEST_ASSERT_EQUAL_MEMORY( ucExpected, ucDigest, sizeof( ucDigest ) );
+
+    /* The image is in the inactive bank, the last double word padded. */
+    TEST_ASSERT_EQUAL_MEMORY( ucImage, bankBytes( otabankINACTIVE ), IMAGE_SIZE );
+    TEST_ASSERT_EQUAL_HEX8( 0xFF, bankBytes( otabankINACTIVE )[ IMAGE_SIZE ] );
+}
+
+/* Receive and activate the update, then run it for the first time. */
+static void update( void )
+{
+    begin();
+    writeAll();
+    TEST_ASSERT_TRUE( OtaBank_Close( &xBank, true ) );
+    TEST_ASSERT_TRUE( OtaBank_Activate( &xBank ) );
+    TEST_ASSERT_TRUE( xResetRequested );
+    boot();
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* called before each testcase */
+void setUp( void )
+{
+    uint8_t * pucFactory = ( uint8_t * ) ullBanks[ 0 ];
+    uint8_t * pucWindow = ( uint8_t * ) &ullBanks[ 1 ][ DATA_OFFSET / sizeof( uint64_t ) ];
+    uint32_t i;
+
+    /* Factory image in bank 1, written by a debugger, and the application
+     * data in the window of bank 2. */
+    memset( ullBanks, 0xFF, sizeof( ullBanks ) );
+
+    for( i = 0; i < ( 64U * 1024U ); i++ )
+    {
+        pucFactory[ i ] = ( uint8_t ) ( i ^ 0x5AU );
+    }
+
+    for( i = 0; i < ( BANK_SIZE - DATA_OFFSET ); i++ )
+    {
+        pucWindow[ i ] = dataByte( i );
+    }
+
+    for( i = 0; i < IMAGE_SIZE; i++ )
+    {
+        ucImage[ i ] = ( uint8_t ) ( ( i * 7U ) + ( i >> 10 ) );
+    }
+
+    xSimFlash.ulPageSize = PAGE_SIZE;
+    xSimFlash.ulDataOffset = DATA_OFFSET;
+    xSimFlash.ulBankSize = BANK_SIZE;
+    xSimFlash.xErase = simErase;
+    xSimFlash.xProgram = simProgram;
+    xSimFlash.xSwap = simSwap;
+    xSimFlash.xLock = simLock;
+    xSimFlash.xUnlock = simUnlock;
+    xSimFlash.pvContext = ullBanks;
+
+    ulOptionBank = 0;
+    lLockDepth = 0;
+    boot();
+}
+
+/* called after each testcase */
+void tearDown( void )
+{
+    mbedtls_sha256_free( &xSha );
+}
+
+/* called at the beginning of the whole suite */
+void suiteSetUp()
+{
+}
+
+/* called at the end of the whole suite */
+int suiteTearDown( int numFailures )
+{
+    return( numFailures > 0 );
+}
+
+/* ===========================  TESTING OtaBank  ============================ */
+/*!
+ * @brief An invalid flash description is rejected.
+ */
+void test_Open_InvalidGeometry( void )
+{
+    OtaBankFlash_t xFlash = xSimFlash;
+
+    xFlash.ulDataOffset = DATA_OFFSET + 8U;
+    TEST_ASSERT_FALSE( OtaBank_Open( &xBank, &xFlash ) );
+
+    xFlash = xSimFlash;
+    xFlash.ulDataOffset = BANK_SIZE + PAGE_SIZE;
+    TEST_ASSERT_FALSE( OtaBank_Open( &xBank, &xFlash ) );
+
+    xFlash = xSimFlash;
+    xFlash.xSwap = NULL;
+    TEST_ASSERT_FALSE( OtaBank_Open( &xBank, &xFlash ) );
+
+    xFlash = xSimFlash;
+    xFlash.xUnlock = NULL;
+    TEST_ASSERT_FALSE( OtaBank_Open( &xBank, &xFlash ) );
+}
+
+/*!
+ * @brief The factory image runs as a valid image, and the largest update
+ * stops below the descriptor page.
+ */
+void test_FactoryImage_Valid( void )
+{
+    TEST_ASSERT_EQUAL( eOtaBankValid, OtaBank_GetState( &xBank ) );
+    TEST_ASSERT_EQUAL_UINT32( DESCRIPTOR_OFFSET, OtaBank_MaxImageSize( &xBank ) );
+    TEST_ASSERT_FALSE( OtaBank_Activate( &xBank ) );
+    TEST_ASSERT_TRUE( OtaBank_Accept( &xBank ) );
+    TEST_ASSERT_FALSE( xResetRequested );
+}
+
+/*!
+ * @brief Blocks received in order are hashed straight from the agent
+ * buffer, the image is never read back.
+ */
+void test_InOrder_HashedWithoutReading( void )
+{
+    uint32_t i;
+
+    begin();
+
+    for( i = 0; i < BLOCK_COUNT; i++ )
+    {
+        TEST_ASSERT_FALSE( OtaBank_Complete( &xBank ) );
+        TEST_ASSERT_TRUE( writeBlock( i ) > 0 );
+    }
+
+    checkDigest();
+    TEST_ASSERT_EQUAL_UINT32( 0, xBank.xStats.ulBytesReread );
+    TEST_ASSERT_EQUAL_UINT32( BLOCK_COUNT, xBank.xStats.ulBlocksWritten );
+    TEST_ASSERT_EQUAL_UINT32( 0, xBank.xStats.ulFlashErrors );
+}
+
+/*!
+ * @brief Blocks received out of order, some of them twice, give the digest
+ * of the image. Only the blocks received ahead of a gap are read back, once.
+ */
+void test_OutOfOrder_HashedOnce( void )
+{
+    uint32_t ulOrder[ BLOCK_COUNT ];
+    uint32_t ulSeed = 12345U;
+    uint32_t ulSwap;
+    uint32_t ulTemp;
+    uint32_t i;
+
+    for( i = 0; i < BLOCK_COUNT; i++ )
+    {
+        ulOrder[ i ] = i;
+    }
+
+    for( i = BLOCK_COUNT - 1U; i > 0U; i-- )
+    {
+        ulSeed = ( ulSeed * 1103515245U ) + 12345U;
+        ulSwap = ( ulSeed >> 16 ) % ( i + 1U );
+        ulTemp = ulOrder[ i ];
+        ulOrder[ i ] = ulOrder[ ulSwap ];
+        ulOrder[ ulSwap ] = ulTemp;
+    }
+
+    begin();
+
+    for( i = 0; i < BLOCK_COUNT; i++ )
+    {
+        TEST_ASSERT_FALSE( OtaBank_Complete( &xBank ) );
+        TEST_ASSERT_TRUE( writeBlock( ulOrder[ i ] ) > 0 );
+
+        /* The agent asks again for blocks it already has. */
+        if( ( i % 5U ) == 0U )
+        {
+            TEST_ASSERT_TRUE( writeBlock( ulOrder[ i / 2U ] ) > 0 );
+        }
+    }
+
+    checkDigest();
+    TEST_ASSERT_EQUAL_UINT32( BLOCK_COUNT, xBank.xStats.ulBlocksWritten );
+    TEST_ASSERT_EQUAL_UINT32( ( BLOCK_COUNT + 4U ) / 5U, xBank.xStats.ulDuplicates );
+    TEST_ASSERT_TRUE( xBank.xStats.ulBytesReread < IMAGE_SIZE );
+}
+
+/*!
+ * @brief Blocks received backwards are all read back except the first one.
+ */
+void test_Backwards_ReadBackOnce( void )
+{
+    uint32_t i;
+
+    begin();
+
+    for( i = BLOCK_COUNT; i > 0U; i-- )
+    {
+        TEST_ASSERT_TRUE( writeBlock( i - 1U ) > 0 );
+    }
+
+    checkDigest();
+    TEST_ASSERT_EQUAL_UINT32( IMAGE_SIZE - BLOCK_SIZE, xBank.xStats.ulBytesReread );
+}
+
+/*!
+ * @brief Blocks outside the image or not aligned on a block are refused.
+ */
+void test_InvalidBlocks_Refused( void )
+{
+    uint8_t ucBlock[ BLOCK_SIZE ] = { 0 };
+
+    TEST_ASSERT_EQUAL( -1, OtaBank_Write( &xBank, 0, ucBlock, BLOCK_SIZE ) );
+    TEST_ASSERT_FALSE( OtaBank_Begin( &xBank, DESCRIPTOR_OFFSET + 1U, BLOCK_SIZE, hashUpdate, &xSha ) );
+    TEST_ASSERT_FALSE( OtaBank_Begin( &xBank, IMAGE_SIZE, BLOCK_SIZE + 4U, hashUpdate, &xSha ) );
+    TEST_ASSERT_FALSE( OtaBank_Begin( &xBank, DESCRIPTOR_OFFSET, 256U, hashUpdate, &xSha ) );
+
+    begin();
+    TEST_ASSERT_EQUAL( -1, OtaBank_Write( &xBank, 8U, ucBlock, BLOCK_SIZE ) );
+    TEST_ASSERT_EQUAL( -1, OtaBank_Write( &xBank, 0, ucBlock, BLOCK_SIZE + 8U ) );
+    TEST_ASSERT_EQUAL( -1, OtaBank_Write( &xBank, 0, ucBlock, BLOCK_SIZE - 8U ) );
+    TEST_ASSERT_EQUAL( -1, OtaBank_Write( &xBank, BLOCK_COUNT * BLOCK_SIZE, ucBlock, BLOCK_SIZE ) );
+    TEST_ASSERT_EQUAL( -1, OtaBank_Write( &xBank, ( BLOCK_COUNT - 1U ) * BLOCK_SIZE, ucBlock, BLOCK_SIZE ) );
+    TEST_ASSERT_EQUAL( 0, xBank.xStats.ulBlocksWritten );
+}
+
+/*!
+ * @brief An image that is incomplete or whose signature is wrong cannot be
+ * activated.
+ */
+void test_Unverified_NotActivated( void )
+{
+    begin();
+    writeAll();
+    TEST_ASSERT_FALSE( OtaBank_Close( &xBank, false ) );
+    TEST_ASSERT_FALSE( OtaBank_Activate( &xBank ) );
+
+    begin();
+    TEST_ASSERT_TRUE( writeBlock( 0 ) > 0 );
+    TEST_ASSERT_FALSE( OtaBank_Close( &xBank, true ) );
+    TEST_ASSERT_FALSE( OtaBank_Activate( &xBank ) );
+
+    /* Aborted once verified. */
+    begin();
+    writeAll();
+    TEST_ASSERT_TRUE( OtaBank_Close( &xBank, true ) );
+    TEST_ASSERT_TRUE( OtaBank_Abort( &xBank ) );
+    TEST_ASSERT_FALSE( OtaBank_Activate( &xBank ) );
+
+    TEST_ASSERT_FALSE( xResetRequested );
+    boot();
+    TEST_ASSERT_TRUE( runsImage( ( const uint8_t * ) ullBanks[ 0 ], PAGE_SIZE ) );
+    TEST_ASSERT_EQUAL_UINT32( 0, ulBootBank );
+}
+
+/*!
+ * @brief The update runs on trial from the other bank with the application
+ * data, and stays once accepted.
+ */
+void test_Update_CommittedOnceAccepted( void )
+{
+    update();
+
+    TEST_ASSERT_EQUAL_UINT32( 1, ulBootBank );
+    TEST_ASSERT_TRUE( runsImage( ucImage, IMAGE_SIZE ) );
+    TEST_ASSERT_EQUAL( eOtaBankPendingCommit, OtaBank_GetState( &xBank ) );
+    checkData();
+
+    /* No other update while the previous image may be needed. */
+    TEST_ASSERT_FALSE( OtaBank_Begin( &xBank, IMAGE_SIZE, BLOCK_SIZE, hashUpdate, &xSha ) );
+
+    TEST_ASSERT_TRUE( OtaBank_Accept( &xBank ) );
+    TEST_ASSERT_EQUAL( eOtaBankValid, OtaBank_GetState( &xBank ) );
+
+    boot();
+    TEST_ASSERT_EQUAL_UINT32( 1, ulBootBank );
+    TEST_ASSERT_EQUAL( eOtaBankValid, OtaBank_GetState( &xBank ) );
+    checkData();
+
+    /* The next update goes to the first bank. */
+    update();
+    TEST_ASSERT_EQUAL_UINT32( 0, ulBootBank );
+    TEST_ASSERT_EQUAL( eOtaBankPendingCommit, OtaBank_GetState( &xBank ) );
+    checkData();
+}
+
+/*!
+ * @brief An update that resets before it is accepted is rolled back, with
+ * the application data.
+ */
+void test_TrialReset_RolledBack( void )
+{
+    update();
+    TEST_ASSERT_EQUAL( eOtaBankPendingCommit, OtaBank_GetState( &xBank ) );
+
+    boot();
+    TEST_ASSERT_EQUAL_UINT32( 0, ulBootBank );
+    TEST_ASSERT_EQUAL( eOtaBankValid, OtaBank_GetState( &xBank ) );
+    checkData();
+
+    /* The rejected image is not started again. */
+    TEST_ASSERT_FALSE( OtaBank_Activate( &xBank ) );
+}
+
+/*!
+ * @brief A rejected update is rolled back at the next boot.
+ */
+void test_Rejected_RolledBack( void )
+{
+    update();
+
+    TEST_ASSERT_TRUE( OtaBank_Reject( &xBank ) );
+    TEST_ASSERT_EQUAL( eOtaBankRejected, OtaBank_GetState( &xBank ) );
+    TEST_ASSERT_FALSE( OtaBank_Accept( &xBank ) );
+
+    boot();
+    TEST_ASSERT_EQUAL_UINT32( 0, ulBootBank );
+    TEST_ASSERT_EQUAL( eOtaBankValid, OtaBank_GetState( &xBank ) );
+    checkData();
+}
+
+/*!
+ * @brief A power cut during the download leaves the running image alone, the
+ * download starts again.
+ */
+void test_PowerCutDuringDownload_Restarted( void )
+{
+    uint32_t i = 0;
+
+    begin();
+    lOpsBeforeCut = 10;
+
+    /* The cut hits one of the first blocks. */
+    while( ( i < BLOCK_COUNT ) && ( writeBlock( i ) > 0 ) )
+    {
+        i++;
+    }
+
+    TEST_ASSERT_TRUE( i < BLOCK_COUNT );
+
+    boot();
+    TEST_ASSERT_EQUAL_UINT32( 0, ulBootBank );
+    TEST_ASSERT_EQUAL( eOtaBankValid, OtaBank_GetState( &xBank ) );
+    TEST_ASSERT_FALSE( OtaBank_Activate( &xBank ) );
+
+    mbedtls_sha256_free( &xSha );
+    begin();
+    writeAll();
+    checkDigest();
+    TEST_ASSERT_TRUE( OtaBank_Close( &xBank, true ) );
+}
+
+/*!
+ * @brief Wherever the power is cut from the end of the download to the
+ * acceptance, the device boots an image with its application data, and the
+ * update completes once tried again.
+ */
+void test_PowerCutAnywhere_Recovers( void )
+{
+    int32_t lCut;
+    bool xCut;
+
+    for( lCut = 0; lCut < 80; lCut++ )
+    {
+        setUp();
+        begin();
+        writeAll();
+        mbedtls_sha256_free( &xSha );
+
+        lOpsBeforeCut = lCut;
+        xCut = ( OtaBank_Close( &xBank, true ) == false ) ||
+               ( OtaBank_Activate( &xBank ) == false );
+
+        if( xCut == false )
+        {
+            /* The new image runs on trial, cut while it is accepted. */
+            ulBootBank = ulOptionBank;
+            xSimFlash.pucBank[ otabankRUNNING ] = bankBytes( otabankRUNNING );
+            xSimFlash.pucBank[ otabankINACTIVE ] = bankBytes( otabankINACTIVE );
+            TEST_ASSERT_TRUE( OtaBank_Open( &xBank, &xSimFlash ) );
+            xCut = ( OtaBank_Accept( &xBank ) == false );
+        }
+
+        boot();
+        checkData();
+
+        if( ulBootBank == 0U )
+        {
+            /* Cut before the swap or during the trial: the previous image
+             * runs and a new download goes through. */
+            TEST_ASSERT_TRUE( xCut );
+            TEST_ASSERT_EQUAL( eOtaBankValid, OtaBank_GetState( &xBank ) );
+            update();
+        }
+
+        TEST_ASSERT_EQUAL_UINT32( 1, ulBootBank );
+        TEST_ASSERT_TRUE( runsImage( ucImage, IMAGE_SIZE ) );
+
+        if( OtaBank_GetState( &xBank ) == eOtaBankPendingCommit )
+        {
+            TEST_ASSERT_TRUE( OtaBank_Accept( &xBank ) );
+        }
+
+        boot();
+        TEST_ASSERT_EQUAL_UINT32( 1, ulBootBank );
+        TEST_ASSERT_EQUAL( eOtaBankValid, OtaBank_GetState( &xBank ) );
+        checkData();
+        tearDown();
+    }
+}
+
+/*!
+ * @brief Wherever the power is cut during a roll back, the device ends on
+ * the previous image with its application data.
+ */
+void test_PowerCutDuringRollBack_Recovers( void )
+{
+    int32_t lCut;
+
+    for( lCut = 0; lCut < 80; lCut++ )
+    {
+        setUp();
+        update();
+        mbedtls_sha256_free( &xSha );
+        TEST_ASSERT_TRUE( OtaBank_Reject( &xBank ) );
+
+        ulBootBank = ulOptionBank;
+        lOpsBeforeCut = lCut;
+        TEST_ASSERT_TRUE( OtaBank_Open( &xBank, &xSimFlash ) );
+
+        boot();
+        TEST_ASSERT_EQUAL_UINT32( 0, ulBootBank );
+        TEST_ASSERT_EQUAL( eOtaBankValid, OtaBank_GetState( &xBank ) );
+        checkData();
+        tearDown();
+    }
+}
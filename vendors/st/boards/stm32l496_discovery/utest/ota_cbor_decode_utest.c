@@ -0,0 +1,363 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity.h"
+
+#include "FreeRTOS.h"
+#include "cbor.h"
+#include "aws_iot_ota_cbor.h"
+#include "aws_iot_ota_cbor_internal.h"
+
+#include "freertos_host.h"
+
+/* Largest block of the board, otaconfigLOG2_MAX_FILE_BLOCK_SIZE. */
+#define MAX_BLOCK_SIZE       ( 4096U )
+
+/* Room for the keys and integers of a data message. */
+#define MESSAGE_SIZE         ( MAX_BLOCK_SIZE + 64U )
+
+#define TEST_FILE_ID         ( 0 )
+#define TEST_BLOCK_ID        ( 17 )
+
+/* ============================  GLOBAL VARIABLES =========================== */
+
+/* MQTT receive buffer of the data message. */
+static uint8_t ucMessage[ MESSAGE_SIZE ];
+static size_t xMessageSize;
+
+static uint8_t ucBlock[ MAX_BLOCK_SIZE ];
+
+/* Image slot written by the PAL. */
+static uint8_t ucFlash[ 4U * MAX_BLOCK_SIZE ];
+
+/* Buffers of the agent before the block was decoded in place. */
+static uint8_t ucEventBuffer[ MESSAGE_SIZE ];
+
+/* Heap and copies counted along the data path. */
+static uint32_t ulAllocations;
+static uint32_t ulCopies;
+static uint32_t ulBytesCopied;
+
+/* Cost of one block along a data path. */
+typedef struct BlockCost
+{
+    uint32_t ulAllocations;
+    uint32_t ulCopies;
+    uint32_t ulBytesCopied;
+} BlockCost_t;
+
+/* ==========================  Helper functions  ============================ */
+
+static void countMalloc( void * pvAddress,
+                         size_t xSize )
+{
+    ( void ) pvAddress;
+    ( void ) xSize;
+    ulAllocations++;
+}
+
+static void countedCopy( uint8_t * pucDestination,
+                         const uint8_t * pucSource,
+                         size_t xSize )
+{
+    memcpy( pucDestination, pucSource, xSize );
+    ulCopies++;
+    ulBytesCopied += ( uint32_t ) xSize;
+}
+
+/* Encode a data message as the stream service does. */
+static void encodeMessage( int32_t lBlockId,
+                           size_t xBlockSize )
+{
+    CborEncoder xEncoder, xMap;
+
+    cbor_encoder_init( &xEncoder, ucMessage, sizeof( ucMessage ), 0 );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encoder_create_map( &xEncoder, &xMap, 4 ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_text_stringz( &xMap, OTA_CBOR_FILEID_KEY ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_int( &xMap, TEST_FILE_ID ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_text_stringz( &xMap, OTA_CBOR_BLOCKID_KEY ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_int( &xMap, lBlockId ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_text_stringz( &xMap, OTA_CBOR_BLOCKSIZE_KEY ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_int( &xMap, ( int64_t ) xBlockSize ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_text_stringz( &xMap, OTA_CBOR_BLOCKPAYLOAD_KEY ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_byte_string( &xMap, ucBlock, xBlockSize ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encoder_close_container( &xEncoder, &xMap ) );
+
+    xMessageSize = cbor_encoder_get_buffer_size( &xEncoder, ucMessage );
+}
+
+/* PAL write of a block into the image slot. */
+static void writeBlock( int32_t lBlockId,
+                        const uint8_t * pucData,
+                        size_t xSize )
+{
+    uint32_t ulOffset = ( ( uint32_t ) lBlockId * MAX_BLOCK_SIZE ) % sizeof( ucFlash );
+
+    countedCopy( &ucFlash[ ulOffset ], pucData, xSize );
+}
+
+/* The MQTT callback copies the message into a slab event buffer, the agent
+ * decodes the block in place there and hands the payload to the PAL. */
+static void ingestInPlace( void )
+{
+    int32_t lFileId = -1, lBlockId = -1, lBlockSize = -1;
+    uint8_t * pucPayload = NULL;
+    size_t xPayloadSize = 0;
+
+    countedCopy( ucEventBuffer, ucMessage, xMessageSize );
+
+    TEST_ASSERT_TRUE( OTA_CBOR_Decode_GetStreamResponseMessage( ucEventBuffer, xMessageSize,
+                                                                &lFileId, &lBlockId, &lBlockSize,
+                                                                &pucPayload, &xPayloadSize ) );
+    writeBlock( lBlockId, pucPayload, xPayloadSize );
+}
+
+/* The data path before the block was decoded in place: the MQTT callback
+ * copies the message into an event buffer, the decoder copies the payload
+ * into a block of its own, and the agent copies it back over the message. */
+static void ingestCopying( void )
+{
+    CborParser xParser;
+    CborValue xMap, xValue;
+    int lBlockId = -1;
+    uint8_t * pucPayload = NULL;
+    size_t xPayloadSize = 0;
+
+    countedCopy( ucEventBuffer, ucMessage, xMessageSize );
+
+    TEST_ASSERT_EQUAL( CborNoError, cbor_parser_init( ucEventBuffer, xMessageSize, 0, &xParser, &xMap ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_value_map_find_value( &xMap, OTA_CBOR_FILEID_KEY, &xValue ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_value_map_find_value( &xMap, OTA_CBOR_BLOCKID_KEY, &xValue ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_value_get_int( &xValue, &lBlockId ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_value_map_find_value( &xMap, OTA_CBOR_BLOCKSIZE_KEY, &xValue ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_value_map_find_value( &xMap, OTA_CBOR_BLOCKPAYLOAD_KEY, &xValue ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_value_calculate_string_length( &xValue, &xPayloadSize ) );
+
+    pucPayload = pvPortMalloc( xPayloadSize );
+    TEST_ASSERT_NOT_NULL( pucPayload );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_value_copy_byte_string( &xValue, pucPayload, &xPayloadSize, NULL ) );
+    ulCopies++;
+    ulBytesCopied += ( uint32_t ) xPayloadSize;
+
+    countedCopy( ucEventBuffer, pucPayload, xPayloadSize );
+    vPortFree( pucPayload );
+
+    writeBlock( lBlockId, ucEventBuffer, xPayloadSize );
+}
+
+static void measureBlock( void ( * xIngest )( void ),
+                          size_t xBlockSize,
+                          BlockCost_t * pxCost )
+{
+    encodeMessage( TEST_BLOCK_ID, xBlockSize );
+
+    ulAllocations = 0;
+    ulCopies = 0;
+    ulBytesCopied = 0;
+    xIngest();
+    pxCost->ulAllocations = ulAllocations;
+    pxCost->ulCopies = ulCopies;
+    pxCost->ulBytesCopied = ulBytesCopied;
+    TEST_ASSERT_EQUAL_MEMORY( ucBlock, &ucFlash[ ( TEST_BLOCK_ID * MAX_BLOCK_SIZE ) % sizeof( ucFlash ) ], xBlockSize );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+void setUp( void )
+{
+    uint32_t i;
+
+    for( i = 0; i < sizeof( ucBlock ); i++ )
+    {
+        ucBlock[ i ] = ( uint8_t ) ( ( i * 7U ) + 3U );
+    }
+
+    memset( ucFlash, 0xFF, sizeof( ucFlash ) );
+    ulAllocations = 0;
+    FreeRTOSHost_SetHeapTrace( countMalloc, NULL );
+}
+
+void tearDown( void )
+{
+    FreeRTOSHost_SetHeapTrace( NULL, NULL );
+}
+
+/* ==========================  Test Cases  ================================== */
+
+/* The payload is returned where it lies in the message, nothing is
+ * allocated. */
+void test_Decode_PayloadInPlace( void )
+{
+    int32_t lFileId = -1, lBlockId = -1, lBlockSize = -1;
+    uint8_t * pucPayload = NULL;
+    size_t xPayloadSize = 0;
+
+    encodeMessage( TEST_BLOCK_ID, 1024U );
+
+    TEST_ASSERT_TRUE( OTA_CBOR_Decode_GetStreamResponseMessage( ucMessage, xMessageSize,
+                                                                &lFileId, &lBlockId, &lBlockSize,
+                                                                &pucPayload, &xPayloadSize ) );
+    TEST_ASSERT_EQUAL_INT32( TEST_FILE_ID, lFileId );
+    TEST_ASSERT_EQUAL_INT32( TEST_BLOCK_ID, lBlockId );
+    TEST_ASSERT_EQUAL_INT32( 1024, lBlockSize );
+    TEST_ASSERT_EQUAL( 1024U, xPayloadSize );
+    TEST_ASSERT_TRUE( pucPayload > ucMessage );
+    TEST_ASSERT_TRUE( ( pucPayload + xPayloadSize ) <= ( ucMessage + xMessageSize ) );
+    TEST_ASSERT_EQUAL_MEMORY( ucBlock, pucPayload, xPayloadSize );
+    TEST_ASSERT_EQUAL_UINT32( 0, ulAllocations );
+}
+
+/* Keys may come in any order, unknown ones are skipped. */
+void test_Decode_AnyKeyOrder( void )
+{
+    CborEncoder xEncoder, xMap;
+    int32_t lFileId = -1, lBlockId = -1, lBlockSize = -1;
+    uint8_t * pucPayload = NULL;
+    size_t xPayloadSize = 0;
+
+    cbor_encoder_init( &xEncoder, ucMessage, sizeof( ucMessage ), 0 );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encoder_create_map( &xEncoder, &xMap, CborIndefiniteLength ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_text_stringz( &xMap, OTA_CBOR_BLOCKPAYLOAD_KEY ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_byte_string( &xMap, ucBlock, 100U ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_int( &xMap, 5 ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_text_stringz( &xMap, "unknown key" ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_text_stringz( &xMap, OTA_CBOR_BLOCKSIZE_KEY ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_int( &xMap, 100 ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_text_stringz( &xMap, OTA_CBOR_CLIENTTOKEN_KEY ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_text_stringz( &xMap, "rdy" ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_text_stringz( &xMap, OTA_CBOR_BLOCKID_KEY ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_int( &xMap, 3 ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_text_stringz( &xMap, OTA_CBOR_FILEID_KEY ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_int( &xMap, 1 ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encoder_close_container( &xEncoder, &xMap ) );
+    xMessageSize = cbor_encoder_get_buffer_size( &xEncoder, ucMessage );
+
+    TEST_ASSERT_TRUE( OTA_CBOR_Decode_GetStreamResponseMessage( ucMessage, xMessageSize,
+                                                                &lFileId, &lBlockId, &lBlockSize,
+                                                                &pucPayload, &xPayloadSize ) );
+    TEST_ASSERT_EQUAL_INT32( 1, lFileId );
+    TEST_ASSERT_EQUAL_INT32( 3, lBlockId );
+    TEST_ASSERT_EQUAL_INT32( 100, lBlockSize );
+    TEST_ASSERT_EQUAL( 100U, xPayloadSize );
+    TEST_ASSERT_EQUAL_MEMORY( ucBlock, pucPayload, xPayloadSize );
+}
+
+/* A message without all the fields is rejected. */
+void test_Decode_MissingField( void )
+{
+    CborEncoder xEncoder, xMap;
+    int32_t lFileId = -1, lBlockId = -1, lBlockSize = -1;
+    uint8_t * pucPayload = NULL;
+    size_t xPayloadSize = 0;
+
+    cbor_encoder_init( &xEncoder, ucMessage, sizeof( ucMessage ), 0 );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encoder_create_map( &xEncoder, &xMap, 3 ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_text_stringz( &xMap, OTA_CBOR_FILEID_KEY ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_int( &xMap, 0 ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_text_stringz( &xMap, OTA_CBOR_BLOCKID_KEY ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_int( &xMap, 0 ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_text_stringz( &xMap, OTA_CBOR_BLOCKSIZE_KEY ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encode_int( &xMap, 16 ) );
+    TEST_ASSERT_EQUAL( CborNoError, cbor_encoder_close_container( &xEncoder, &xMap ) );
+    xMessageSize = cbor_encoder_get_buffer_size( &xEncoder, ucMessage );
+
+    TEST_ASSERT_FALSE( OTA_CBOR_Decode_GetStreamResponseMessage( ucMessage, xMessageSize,
+                                                                 &lFileId, &lBlockId, &lBlockSize,
+                                                                 &pucPayload, &xPayloadSize ) );
+}
+
+/* A payload sent in chunks is not contiguous in the message. */
+void test_Decode_ChunkedPayloadRejected( void )
+{
+    /* { "f": 0, "i": 0, "l": 2, "p": (_ h'01', h'02') } */
+    static const uint8_t ucChunked[] =
+    {
+        0xA4U,
+        0x61U, 'f', 0x00U,
+        0x61U, 'i', 0x00U,
+        0x61U, 'l', 0x02U,
+        0x61U, 'p', 0x5FU, 0x41U, 0x01U, 0x41U, 0x02U, 0xFFU
+    };
+    int32_t lFileId = -1, lBlockId = -1, lBlockSize = -1;
+    uint8_t * pucPayload = NULL;
+    size_t xPayloadSize = 0;
+
+    TEST_ASSERT_FALSE( OTA_CBOR_Decode_GetStreamResponseMessage( ucChunked, sizeof( ucChunked ),
+                                                                 &lFileId, &lBlockId, &lBlockSize,
+                                                                 &pucPayload, &xPayloadSize ) );
+}
+
+/* A message cut short by the transport never yields a payload past its end. */
+void test_Decode_TruncatedMessage( void )
+{
+    int32_t lFileId = -1, lBlockId = -1, lBlockSize = -1;
+    uint8_t * pucPayload = NULL;
+    size_t xPayloadSize = 0;
+    size_t xLength;
+
+    encodeMessage( TEST_BLOCK_ID, 256U );
+
+    for( xLength = 0; xLength < xMessageSize; xLength++ )
+    {
+        TEST_ASSERT_FALSE( OTA_CBOR_Decode_GetStreamResponseMessage( ucMessage, xLength,
+                                                                     &lFileId, &lBlockId, &lBlockSize,
+                                                                     &pucPayload, &xPayloadSize ) );
+    }
+}
+
+/* Allocations and copies of a 1K and a 4K block from the MQTT receive buffer
+ * to the image slot. */
+void test_Benchmark_CopiesPerBlock( void )
+{
+    static const size_t xSizes[] = { 1024U, 4096U };
+    BlockCost_t xCopying, xInPlace;
+    uint32_t i;
+
+    for( i = 0; i < ( sizeof( xSizes ) / sizeof( xSizes[ 0 ] ) ); i++ )
+    {
+        measureBlock( ingestCopying, xSizes[ i ], &xCopying );
+        measureBlock( ingestInPlace, xSizes[ i ], &xInPlace );
+
+        printf( "ota_cbor_decode: %uK block, copying decode %u allocations %u copies %u bytes, "
+                "in place %u allocations %u copies %u bytes\n",
+                ( unsigned ) ( xSizes[ i ] / 1024U ),
+                ( unsigned ) xCopying.ulAllocations,
+                ( unsigned ) xCopying.ulCopies,
+                ( unsigned ) xCopying.ulBytesCopied,
+                ( unsigned ) xInPlace.ulAllocations,
+                ( unsigned ) xInPlace.ulCopies,
+                ( unsigned ) xInPlace.ulBytesCopied );
+
+        TEST_ASSERT_EQUAL_UINT32( 0, xInPlace.ulAllocations );
+        TEST_ASSERT_EQUAL_UINT32( 2, xInPlace.ulCopies );
+        TEST_ASSERT_EQUAL_UINT32( xMessageSize + xSizes[ i ], xInPlace.ulBytesCopied );
+        TEST_ASSERT_LESS_THAN_UINT32( xCopying.ulCopies, xInPlace.ulCopies );
+    }
+}
@@ -0,0 +1,444 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "unity.h"
+
+#include "aws_iot_ota_event_ring.h"
+
+/* Ring of the agent, OTA_NUM_MSG_Q_ENTRIES. */
+#define RING_SIZE              ( 32U )
+
+/* Event buffers of the board, otaconfigMAX_NUM_OTA_DATA_BUFFERS. */
+#define SLAB_SIZE              ( 2U )
+
+/* Producers of the stress test: the MQTT callback (producer 0), the request
+ * timer and the application. */
+#define STRESS_PRODUCERS       ( 3U )
+#define STRESS_EVENTS          ( 200000U )
+
+/* Events of a producer: its index in the top byte, its count below. */
+#define MAKE_EVENT( p, n )     ( ( ( uint32_t ) ( p ) << 24 ) | ( uint32_t ) ( n ) )
+#define EVENT_PRODUCER( x )    ( ( x ) >> 24 )
+#define EVENT_COUNT( x )       ( ( x ) & 0xFFFFFFU )
+
+/* ============================  GLOBAL VARIABLES =========================== */
+
+static OTA_EventRing_t xRing;
+static OTA_EventRingSlot_t xSlots[ RING_SIZE ];
+static OTA_EventSlab_t xSlab;
+
+/* Interrupt masking of the single core target, a spin lock on the host. */
+static volatile uint8_t ucCritical;
+
+/* Task notification of the agent task. */
+static sem_t xNotify;
+
+/* Event buffers of the stress test, each carries its event. */
+static uint32_t ulPayloads[ SLAB_SIZE ];
+
+/* The queue and the mutex guarded buffer pool the ring replaces, with the
+ * cost of kernel objects: a lock per operation and a wake up per event. */
+static pthread_mutex_t xQueueMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t xQueueNotEmpty = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t xPoolMutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t ulQueue[ RING_SIZE ];
+static uint32_t ulQueueHead;
+static uint32_t ulQueueCount;
+static bool xPoolUsed[ SLAB_SIZE ];
+
+/* One way of passing events to the agent task. */
+typedef struct Transport
+{
+    const char * pcName;
+    bool ( * xSend )( uint32_t ulEvent );
+    uint32_t ( * xReceive )( void );
+} Transport_t;
+
+/* One producer of the stress test. */
+typedef struct Producer
+{
+    pthread_t xThread;
+    uint32_t ulIndex;
+    const Transport_t * pxTransport;
+    uint64_t ullWorstEnqueueNs;
+    uint32_t ulRetries;
+} Producer_t;
+
+/* ==========================  Kernel port  ================================= */
+
+void vPortEnterCritical( void )
+{
+    while( __atomic_test_and_set( &ucCritical, __ATOMIC_ACQUIRE ) )
+    {
+    }
+}
+
+void vPortExitCritical( void )
+{
+    __atomic_clear( &ucCritical, __ATOMIC_RELEASE );
+}
+
+/* ==========================  Helper functions  ============================ */
+
+static uint64_t nowNanoseconds( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( uint64_t ) xNow.tv_sec * 1000000000U ) + ( uint64_t ) xNow.tv_nsec;
+}
+
+/* OTA_SignalEvent() of an event with a buffer, as the job callback. */
+static bool ringSend( uint32_t ulEvent )
+{
+    bool xWake = false;
+    bool xSent = false;
+    int32_t lBuffer = OTA_EventSlabAlloc( &xSlab );
+
+    if( lBuffer >= 0 )
+    {
+        ulPayloads[ lBuffer ] = ulEvent;
+        xSent = OTA_EventRingPush( &xRing, ulEvent, &ulPayloads[ lBuffer ], &xWake );
+
+        if( xSent == false )
+        {
+            OTA_EventSlabFree( &xSlab, ( uint32_t ) lBuffer );
+        }
+        else if( xWake == true )
+        {
+            ( void ) sem_post( &xNotify );
+        }
+    }
+
+    return xSent;
+}
+
+/* The agent task: take the next event, waiting for it if needed. */
+static uint32_t ringReceive( void )
+{
+    uint32_t ulEvent = 0;
+    void * pvData = NULL;
+
+    while( OTA_EventRingPop( &xRing, &ulEvent, &pvData ) == false )
+    {
+        if( OTA_EventRingPrepareWait( &xRing ) == true )
+        {
+            ( void ) sem_wait( &xNotify );
+        }
+    }
+
+    TEST_ASSERT_EQUAL_HEX32( ulEvent, *( uint32_t * ) pvData );
+    OTA_EventSlabFree( &xSlab, ( uint32_t ) ( ( uint32_t * ) pvData - ulPayloads ) );
+
+    return ulEvent;
+}
+
+static bool queueSend( uint32_t ulEvent )
+{
+    bool xSent = false;
+    uint32_t ulBuffer;
+
+    pthread_mutex_lock( &xPoolMutex );
+
+    for( ulBuffer = 0; ulBuffer < SLAB_SIZE; ulBuffer++ )
+    {
+        if( xPoolUsed[ ulBuffer ] == false )
+        {
+            xPoolUsed[ ulBuffer ] = true;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock( &xPoolMutex );
+
+    if( ulBuffer < SLAB_SIZE )
+    {
+        ulPayloads[ ulBuffer ] = ulEvent;
+
+        pthread_mutex_lock( &xQueueMutex );
+
+        if( ulQueueCount < RING_SIZE )
+        {
+            ulQueue[ ( ulQueueHead + ulQueueCount ) % RING_SIZE ] = ulBuffer;
+            ulQueueCount++;
+            pthread_cond_signal( &xQueueNotEmpty );
+            xSent = true;
+        }
+
+        pthread_mutex_unlock( &xQueueMutex );
+
+        if( xSent == false )
+        {
+            pthread_mutex_lock( &xPoolMutex );
+            xPoolUsed[ ulBuffer ] = false;
+            pthread_mutex_unlock( &xPoolMutex );
+        }
+    }
+
+    return xSent;
+}
+
+static uint32_t queueReceive( void )
+{
+    uint32_t ulBuffer;
+    uint32_t ulEvent;
+
+    pthread_mutex_lock( &xQueueMutex );
+
+    while( ulQueueCount == 0U )
+    {
+        pthread_cond_wait( &xQueueNotEmpty, &xQueueMutex );
+    }
+
+    ulBuffer = ulQueue[ ulQueueHead ];
+    ulQueueHead = ( ulQueueHead + 1U ) % RING_SIZE;
+    ulQueueCount--;
+
+    pthread_mutex_unlock( &xQueueMutex );
+
+    ulEvent = ulPayloads[ ulBuffer ];
+
+    pthread_mutex_lock( &xPoolMutex );
+    xPoolUsed[ ulBuffer ] = false;
+    pthread_mutex_unlock( &xPoolMutex );
+
+    return ulEvent;
+}
+
+static const Transport_t xRingTransport = { "event ring", ringSend, ringReceive };
+static const Transport_t xQueueTransport = { "queue and pool", queueSend, queueReceive };
+
+/* A producer retries while the agent lags behind, as the MQTT callback does
+ * when the broker sends the next block. */
+static void * producerThread( void * pvParameter )
+{
+    Producer_t * pxProducer = pvParameter;
+    uint64_t ullStart, ullElapsed;
+    uint32_t i;
+    bool xSent;
+
+    for( i = 0; i < STRESS_EVENTS; i++ )
+    {
+        do
+        {
+            ullStart = nowNanoseconds();
+            xSent = pxProducer->pxTransport->xSend( MAKE_EVENT( pxProducer->ulIndex, i ) );
+            ullElapsed = nowNanoseconds() - ullStart;
+
+            if( xSent == false )
+            {
+                pxProducer->ulRetries++;
+                ( void ) sched_yield();
+            }
+        } while( xSent == false );
+
+        if( ullElapsed > pxProducer->ullWorstEnqueueNs )
+        {
+            pxProducer->ullWorstEnqueueNs = ullElapsed;
+        }
+    }
+
+    return NULL;
+}
+
+/* Run the producers against the agent task on the test thread; every event
+ * must arrive once and in the order of its producer. */
+static void stress( const Transport_t * pxTransport )
+{
+    Producer_t xProducers[ STRESS_PRODUCERS ];
+    uint32_t ulNext[ STRESS_PRODUCERS ] = { 0 };
+    uint32_t ulEvent, ulProducer;
+    uint64_t ullStart, ullElapsed;
+    uint32_t ulRetries = 0;
+    uint32_t i;
+
+    memset( xProducers, 0, sizeof( xProducers ) );
+    ullStart = nowNanoseconds();
+
+    for( i = 0; i < STRESS_PRODUCERS; i++ )
+    {
+        xProducers[ i ].ulIndex = i;
+        xProducers[ i ].pxTransport = pxTransport;
+        TEST_ASSERT_EQUAL( 0, pthread_create( &xProducers[ i ].xThread, NULL, producerThread, &xProducers[ i ] ) );
+    }
+
+    for( i = 0; i < ( STRESS_PRODUCERS * STRESS_EVENTS ); i++ )
+    {
+        ulEvent = pxTransport->xReceive();
+        ulProducer = EVENT_PRODUCER( ulEvent );
+        TEST_ASSERT_LESS_THAN_UINT32( STRESS_PRODUCERS, ulProducer );
+        TEST_ASSERT_EQUAL_UINT32( ulNext[ ulProducer ], EVENT_COUNT( ulEvent ) );
+        ulNext[ ulProducer ]++;
+    }
+
+    ullElapsed = nowNanoseconds() - ullStart;
+
+    for( i = 0; i < STRESS_PRODUCERS; i++ )
+    {
+        TEST_ASSERT_EQUAL( 0, pthread_join( xProducers[ i ].xThread, NULL ) );
+        ulRetries += xProducers[ i ].ulRetries;
+    }
+
+    printf( "ota_event_ring: %s, %u producers, %u events/s, worst MQTT callback enqueue %u ns, %u retries on full\n",
+            pxTransport->pcName,
+            ( unsigned ) STRESS_PRODUCERS,
+            ( unsigned ) ( ( ( uint64_t ) STRESS_PRODUCERS * STRESS_EVENTS * 1000000000U ) / ullElapsed ),
+            ( unsigned ) xProducers[ 0 ].ullWorstEnqueueNs,
+            ( unsigned ) ulRetries );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+void setUp( void )
+{
+    TEST_ASSERT_TRUE( OTA_EventRingInit( &xRing, xSlots, RING_SIZE ) );
+    TEST_ASSERT_TRUE( OTA_EventSlabInit( &xSlab, SLAB_SIZE ) );
+    TEST_ASSERT_EQUAL( 0, sem_init( &xNotify, 0, 0 ) );
+}
+
+void tearDown( void )
+{
+    ( void ) sem_destroy( &xNotify );
+}
+
+/* ==========================  Test Cases  ================================== */
+
+/* The ring needs a power of two of slots, the slab fits a bitmap. */
+void test_Init_Sizes( void )
+{
+    TEST_ASSERT_FALSE( OTA_EventRingInit( &xRing, xSlots, 20U ) );
+    TEST_ASSERT_FALSE( OTA_EventRingInit( &xRing, xSlots, 1U ) );
+    TEST_ASSERT_FALSE( OTA_EventRingInit( &xRing, xSlots, 2U * OTA_EVENT_RING_MAX_SIZE ) );
+    TEST_ASSERT_TRUE( OTA_EventRingInit( &xRing, xSlots, 2U ) );
+    TEST_ASSERT_FALSE( OTA_EventSlabInit( &xSlab, 0U ) );
+    TEST_ASSERT_FALSE( OTA_EventSlabInit( &xSlab, OTA_EVENT_SLAB_MAX_SIZE + 1U ) );
+}
+
+/* Events come out in order over many laps, a full ring refuses events. */
+void test_Ring_OrderAndFull( void )
+{
+    uint32_t ulEvent = 0;
+    void * pvData = NULL;
+    bool xWake = false;
+    uint32_t ulLap, i;
+
+    TEST_ASSERT_FALSE( OTA_EventRingPop( &xRing, &ulEvent, &pvData ) );
+
+    for( ulLap = 0; ulLap < 5U; ulLap++ )
+    {
+        for( i = 0; i < RING_SIZE; i++ )
+        {
+            TEST_ASSERT_TRUE( OTA_EventRingPush( &xRing, ( ulLap * 100U ) + i, &xSlots[ i ], &xWake ) );
+        }
+
+        TEST_ASSERT_FALSE( OTA_EventRingPush( &xRing, 0, NULL, &xWake ) );
+
+        for( i = 0; i < RING_SIZE; i++ )
+        {
+            TEST_ASSERT_TRUE( OTA_EventRingPop( &xRing, &ulEvent, &pvData ) );
+            TEST_ASSERT_EQUAL_UINT32( ( ulLap * 100U ) + i, ulEvent );
+            TEST_ASSERT_EQUAL_PTR( &xSlots[ i ], pvData );
+        }
+
+        TEST_ASSERT_FALSE( OTA_EventRingPop( &xRing, &ulEvent, &pvData ) );
+    }
+
+    TEST_ASSERT_EQUAL_UINT32( 5U * RING_SIZE, xRing.xStats.ulPushed );
+    TEST_ASSERT_EQUAL_UINT32( 5U, xRing.xStats.ulFull );
+    TEST_ASSERT_EQUAL_UINT32( 0, xRing.xStats.ulWakes );
+}
+
+/* Only the first event after the consumer started waiting wakes it up. */
+void test_Ring_WakeOnlyWaitingConsumer( void )
+{
+    uint32_t ulEvent = 0;
+    void * pvData = NULL;
+    bool xWake = true;
+
+    TEST_ASSERT_TRUE( OTA_EventRingPush( &xRing, 1U, NULL, &xWake ) );
+    TEST_ASSERT_FALSE( xWake );
+
+    /* An event is ready, the consumer does not wait. */
+    TEST_ASSERT_FALSE( OTA_EventRingPrepareWait( &xRing ) );
+    TEST_ASSERT_TRUE( OTA_EventRingPop( &xRing, &ulEvent, &pvData ) );
+
+    TEST_ASSERT_TRUE( OTA_EventRingPrepareWait( &xRing ) );
+    TEST_ASSERT_TRUE( OTA_EventRingPush( &xRing, 2U, NULL, &xWake ) );
+    TEST_ASSERT_TRUE( xWake );
+    TEST_ASSERT_TRUE( OTA_EventRingPush( &xRing, 3U, NULL, &xWake ) );
+    TEST_ASSERT_FALSE( xWake );
+    TEST_ASSERT_EQUAL_UINT32( 1U, xRing.xStats.ulWakes );
+}
+
+/* Buffers are handed out once until freed. */
+void test_Slab_AllocFree( void )
+{
+    int32_t lBuffers[ OTA_EVENT_SLAB_MAX_SIZE ];
+    uint32_t i;
+
+    for( i = 0; i < SLAB_SIZE; i++ )
+    {
+        lBuffers[ i ] = OTA_EventSlabAlloc( &xSlab );
+        TEST_ASSERT_EQUAL_INT32( ( int32_t ) i, lBuffers[ i ] );
+    }
+
+    TEST_ASSERT_EQUAL_INT32( -1, OTA_EventSlabAlloc( &xSlab ) );
+    OTA_EventSlabFree( &xSlab, SLAB_SIZE - 1U );
+    TEST_ASSERT_EQUAL_INT32( ( int32_t ) SLAB_SIZE - 1, OTA_EventSlabAlloc( &xSlab ) );
+
+    TEST_ASSERT_TRUE( OTA_EventSlabInit( &xSlab, OTA_EVENT_SLAB_MAX_SIZE ) );
+
+    for( i = 0; i < OTA_EVENT_SLAB_MAX_SIZE; i++ )
+    {
+        lBuffers[ i ] = OTA_EventSlabAlloc( &xSlab );
+        TEST_ASSERT_EQUAL_INT32( ( int32_t ) i, lBuffers[ i ] );
+    }
+
+    TEST_ASSERT_EQUAL_INT32( -1, OTA_EventSlabAlloc( &xSlab ) );
+    OTA_EventSlabFree( &xSlab, OTA_EVENT_SLAB_MAX_SIZE - 1U );
+    TEST_ASSERT_EQUAL_INT32( ( int32_t ) OTA_EVENT_SLAB_MAX_SIZE - 1, OTA_EventSlabAlloc( &xSlab ) );
+}
+
+/* Bursts of events from several producers, against the queue and the buffer
+ * pool the ring replaces. Host figures, the ratio matters more than the
+ * values. */
+void test_Stress_ProducersAgainstAgent( void )
+{
+    stress( &xQueueTransport );
+    stress( &xRingTransport );
+
+    TEST_ASSERT_EQUAL_UINT32( STRESS_PRODUCERS * STRESS_EVENTS, xRing.xStats.ulPushed );
+    TEST_ASSERT_EQUAL_UINT32( ( 1U << SLAB_SIZE ) - 1U, xSlab.ulFree );
+}
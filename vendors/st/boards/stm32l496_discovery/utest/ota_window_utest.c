@@ -0,0 +1,527 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity.h"
+
+#include "aws_iot_ota_window.h"
+
+/* File blocks of 1K, as otaconfigLOG2_FILE_BLOCK_SIZE of the board. */
+#define LOG2_BLOCK_SIZE      ( 10U )
+#define BLOCK_SIZE           ( 1U << LOG2_BLOCK_SIZE )
+#define INITIAL_RTO_MS       ( 2500U )
+
+/* Image of the download simulation, with a short last block. */
+#define FILE_SIZE            ( ( 300U * BLOCK_SIZE ) + 300U )
+#define NUM_BLOCKS           ( ( FILE_SIZE + BLOCK_SIZE - 1U ) / BLOCK_SIZE )
+#define BITMAP_SIZE          ( ( NUM_BLOCKS + 7U ) / 8U )
+
+/* MQTT and CBOR overhead of a data message. */
+#define MESSAGE_OVERHEAD     ( 80U )
+
+/* Longest download simulated. */
+#define DOWNLOAD_LIMIT_MS    ( 3600U * 1000U )
+
+/* Stream service and cellular link model. */
+typedef struct Link
+{
+    const char * pcName;
+    uint32_t ulUplinkMs;       /* Delay of a request to the service. */
+    uint32_t ulDownlinkMs;     /* Delay of a data message, after its transmission. */
+    uint32_t ulBytesPerSecond; /* Downlink throughput. */
+    uint32_t ulLossPerMille;   /* Loss rate of 1K of data message. */
+} Link_t;
+
+/* A data message sent by the stream service. */
+typedef struct Delivery
+{
+    uint32_t ulArrivalMs;
+    uint32_t ulBlockId;
+    uint32_t ulBlockSize;
+    bool xLost;
+} Delivery_t;
+
+/* Result of one simulated download. */
+typedef struct Download
+{
+    uint32_t ulTimeMs;
+    uint32_t ulBaseBlocksRequested;
+    uint32_t ulBaseBlocksLost;
+    OTA_WindowStats_t xStats;
+} Download_t;
+
+/* ============================  GLOBAL VARIABLES =========================== */
+
+static OTA_Window_t xWindow;
+static OTA_WindowRequest_t xRequest;
+static uint8_t ucBitmap[ BITMAP_SIZE ];
+
+/* Data messages in transmission, in arrival order. */
+static Delivery_t xDeliveries[ 4096 ];
+static uint32_t ulHead;
+static uint32_t ulTail;
+static uint32_t ulLinkFreeMs;
+static uint32_t ulRandom;
+
+/* BG96 Cat-M1 links: about 20 KB/s down, 400 to 800 ms of round trip. */
+static const Link_t xGoodLink = { "400 ms RTT, 1% loss", 200U, 200U, 20000U, 10U };
+static const Link_t xPoorLink = { "800 ms RTT, 5% loss", 400U, 400U, 12000U, 50U };
+
+/* ==========================  Helper functions  ============================ */
+
+static uint32_t nextRandom( void )
+{
+    /* xorshift32, the simulation must be reproducible. */
+    ulRandom ^= ulRandom << 13;
+    ulRandom ^= ulRandom >> 17;
+    ulRandom ^= ulRandom << 5;
+
+    return ulRandom;
+}
+
+static void bitmapReset( void )
+{
+    memset( ucBitmap, 0xFF, sizeof( ucBitmap ) );
+
+    /* Blocks past the end of the file are never missing. */
+    if( ( NUM_BLOCKS % 8U ) != 0U )
+    {
+        ucBitmap[ BITMAP_SIZE - 1U ] = ( uint8_t ) ( ( 1U << ( NUM_BLOCKS % 8U ) ) - 1U );
+    }
+}
+
+static void markReceived( uint32_t ulFirst,
+                          uint32_t ulCount )
+{
+    uint32_t i;
+
+    for( i = ulFirst; i < ( ulFirst + ulCount ); i++ )
+    {
+        ucBitmap[ i >> 3 ] &= ( uint8_t ) ~( 1U << ( i & 7U ) );
+    }
+}
+
+static bool isReceived( uint32_t ulBlock )
+{
+    return ( ucBitmap[ ulBlock >> 3 ] & ( 1U << ( ulBlock & 7U ) ) ) == 0U;
+}
+
+/* The stream service answers a request with its blocks one after the other
+ * on the downlink. */
+static void serviceRequest( const Link_t * pxLink,
+                            const OTA_WindowRequest_t * pxRequest,
+                            uint32_t ulNowMs,
+                            Download_t * pxDownload )
+{
+    Delivery_t * pxDelivery;
+    uint32_t ulStartMs;
+    uint32_t ulOffset;
+    uint32_t ulBit;
+
+    for( ulBit = 0; ulBit < ( pxRequest->ulBitmapSize * 8U ); ulBit++ )
+    {
+        if( ( pxRequest->ucBitmap[ ulBit >> 3 ] & ( 1U << ( ulBit & 7U ) ) ) != 0U )
+        {
+            TEST_ASSERT_TRUE( ( ulHead - ulTail ) < ( sizeof( xDeliveries ) / sizeof( xDeliveries[ 0 ] ) ) );
+            pxDelivery = &xDeliveries[ ulHead % ( sizeof( xDeliveries ) / sizeof( xDeliveries[ 0 ] ) ) ];
+            ulHead++;
+
+            pxDelivery->ulBlockId = pxRequest->ulBlockOffset + ulBit;
+            ulOffset = pxDelivery->ulBlockId * pxRequest->ulBlockSize;
+            TEST_ASSERT_TRUE( ulOffset < FILE_SIZE );
+            pxDelivery->ulBlockSize = ( ( FILE_SIZE - ulOffset ) < pxRequest->ulBlockSize ) ? ( FILE_SIZE - ulOffset ) : pxRequest->ulBlockSize;
+
+            ulStartMs = ulNowMs + pxLink->ulUplinkMs;
+
+            if( ( int32_t ) ( ulLinkFreeMs - ulStartMs ) > 0 )
+            {
+                ulStartMs = ulLinkFreeMs;
+            }
+
+            ulLinkFreeMs = ulStartMs + ( ( ( pxDelivery->ulBlockSize + MESSAGE_OVERHEAD ) * 1000U ) / pxLink->ulBytesPerSecond );
+            pxDelivery->ulArrivalMs = ulLinkFreeMs + pxLink->ulDownlinkMs;
+
+            /* Larger messages are more likely to be lost. */
+            pxDelivery->xLost = ( nextRandom() % ( 1000U * BLOCK_SIZE ) ) < ( pxLink->ulLossPerMille * pxDelivery->ulBlockSize );
+
+            pxDownload->ulBaseBlocksRequested += ( pxDelivery->ulBlockSize + BLOCK_SIZE - 1U ) / BLOCK_SIZE;
+
+            if( pxDelivery->xLost == true )
+            {
+                pxDownload->ulBaseBlocksLost += ( pxDelivery->ulBlockSize + BLOCK_SIZE - 1U ) / BLOCK_SIZE;
+            }
+        }
+    }
+}
+
+/* Fill the window, as prvRequestFileBlock_Mqtt. */
+static void requestBlocks( const Link_t * pxLink,
+                           uint32_t ulNowMs,
+                           Download_t * pxDownload )
+{
+    while( OTA_WindowRequest( &xWindow, ucBitmap, ulNowMs, &xRequest ) > 0U )
+    {
+        serviceRequest( pxLink, &xRequest, ulNowMs, pxDownload );
+    }
+}
+
+/* Download the file as the OTA agent: each block received restarts the
+ * request timer and refills the window, the timer refills it when nothing
+ * arrives. */
+static void download( const Link_t * pxLink,
+                      uint32_t ulMaxWindow,
+                      uint32_t ulLog2MaxBlockSize,
+                      Download_t * pxDownload )
+{
+    const Delivery_t * pxDelivery;
+    uint32_t ulRemaining = NUM_BLOCKS;
+    uint32_t ulNowMs = 0;
+    uint32_t ulTimerMs;
+    uint32_t ulFirst;
+    uint32_t ulCount;
+    uint32_t i;
+
+    memset( pxDownload, 0, sizeof( Download_t ) );
+    bitmapReset();
+    ulHead = 0;
+    ulTail = 0;
+    ulLinkFreeMs = 0;
+    ulRandom = 0x2545F491UL;
+
+    OTA_WindowInit( &xWindow, FILE_SIZE, LOG2_BLOCK_SIZE, ulLog2MaxBlockSize, ulMaxWindow, INITIAL_RTO_MS );
+    requestBlocks( pxLink, ulNowMs, pxDownload );
+    ulTimerMs = ulNowMs + OTA_WindowTimeoutMs( &xWindow );
+
+    while( ( ulRemaining > 0U ) && ( ulNowMs < DOWNLOAD_LIMIT_MS ) )
+    {
+        pxDelivery = &xDeliveries[ ulTail % ( sizeof( xDeliveries ) / sizeof( xDeliveries[ 0 ] ) ) ];
+
+        if( ( ulTail != ulHead ) && ( pxDelivery->ulArrivalMs <= ulTimerMs ) )
+        {
+            ulTail++;
+            ulNowMs = pxDelivery->ulArrivalMs;
+
+            if( pxDelivery->xLost == false )
+            {
+                TEST_ASSERT_TRUE( OTA_WindowBlockRange( &xWindow, pxDelivery->ulBlockId, pxDelivery->ulBlockSize, &ulFirst, &ulCount ) );
+                OTA_WindowReceived( &xWindow, ulFirst, ulCount, ulNowMs );
+
+                for( i = ulFirst; i < ( ulFirst + ulCount ); i++ )
+                {
+                    if( isReceived( i ) == false )
+                    {
+                        markReceived( i, 1 );
+                        ulRemaining--;
+                    }
+                }
+
+                if( ulRemaining > 0U )
+                {
+                    requestBlocks( pxLink, ulNowMs, pxDownload );
+                    ulTimerMs = ulNowMs + OTA_WindowTimeoutMs( &xWindow );
+                }
+            }
+        }
+        else
+        {
+            ulNowMs = ulTimerMs;
+            requestBlocks( pxLink, ulNowMs, pxDownload );
+            ulTimerMs = ulNowMs + OTA_WindowTimeoutMs( &xWindow );
+        }
+    }
+
+    TEST_ASSERT_EQUAL_UINT32( 0, ulRemaining );
+    pxDownload->ulTimeMs = ulNowMs;
+    pxDownload->xStats = xWindow.xStats;
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* called before each testcase */
+void setUp( void )
+{
+    memset( &xWindow, 0, sizeof( xWindow ) );
+    bitmapReset();
+}
+
+/* called after each testcase */
+void tearDown( void )
+{
+}
+
+/* called at the beginning of the whole suite */
+void suiteSetUp()
+{
+}
+
+/* called at the end of the whole suite */
+int suiteTearDown( int numFailures )
+{
+    return( numFailures > 0 );
+}
+
+/* =========================  TESTING OTA_Window  =========================== */
+/*!
+ * @brief Blocks of 2K and 4K are always full, only a 1K block may be the short
+ * last block of the file.
+ */
+void test_BlockRange_LargeBlocksFullOnly( void )
+{
+    uint32_t ulFirst = 0;
+    uint32_t ulCount = 0;
+
+    /* 11 blocks, the last one of 100 bytes. */
+    OTA_WindowInit( &xWindow, ( 10U * BLOCK_SIZE ) + 100U, LOG2_BLOCK_SIZE, 12U, 32U, INITIAL_RTO_MS );
+
+    TEST_ASSERT_TRUE( OTA_WindowBlockRange( &xWindow, 1U, 4U * BLOCK_SIZE, &ulFirst, &ulCount ) );
+    TEST_ASSERT_EQUAL_UINT32( 4, ulFirst );
+    TEST_ASSERT_EQUAL_UINT32( 4, ulCount );
+    TEST_ASSERT_FALSE( OTA_WindowBlockRange( &xWindow, 2U, 4U * BLOCK_SIZE, &ulFirst, &ulCount ) );
+
+    TEST_ASSERT_TRUE( OTA_WindowBlockRange( &xWindow, 4U, 2U * BLOCK_SIZE, &ulFirst, &ulCount ) );
+    TEST_ASSERT_EQUAL_UINT32( 8, ulFirst );
+    TEST_ASSERT_EQUAL_UINT32( 2, ulCount );
+    TEST_ASSERT_FALSE( OTA_WindowBlockRange( &xWindow, 5U, 2U * BLOCK_SIZE, &ulFirst, &ulCount ) );
+
+    TEST_ASSERT_TRUE( OTA_WindowBlockRange( &xWindow, 9U, BLOCK_SIZE, &ulFirst, &ulCount ) );
+    TEST_ASSERT_EQUAL_UINT32( 9, ulFirst );
+    TEST_ASSERT_EQUAL_UINT32( 1, ulCount );
+    TEST_ASSERT_TRUE( OTA_WindowBlockRange( &xWindow, 10U, 100U, &ulFirst, &ulCount ) );
+    TEST_ASSERT_EQUAL_UINT32( 10, ulFirst );
+    TEST_ASSERT_EQUAL_UINT32( 1, ulCount );
+
+    TEST_ASSERT_FALSE( OTA_WindowBlockRange( &xWindow, 10U, BLOCK_SIZE, &ulFirst, &ulCount ) );
+    TEST_ASSERT_FALSE( OTA_WindowBlockRange( &xWindow, 9U, 100U, &ulFirst, &ulCount ) );
+    TEST_ASSERT_FALSE( OTA_WindowBlockRange( &xWindow, 11U, 100U, &ulFirst, &ulCount ) );
+    TEST_ASSERT_FALSE( OTA_WindowBlockRange( &xWindow, 0U, 3U * BLOCK_SIZE, &ulFirst, &ulCount ) );
+
+    /* Without large blocks configured, a 2K block is out of range. */
+    OTA_WindowInit( &xWindow, ( 10U * BLOCK_SIZE ) + 100U, LOG2_BLOCK_SIZE, LOG2_BLOCK_SIZE, 32U, INITIAL_RTO_MS );
+    TEST_ASSERT_FALSE( OTA_WindowBlockRange( &xWindow, 0U, 2U * BLOCK_SIZE, &ulFirst, &ulCount ) );
+}
+
+/*!
+ * @brief Only the blocks missing and not in flight are requested, up to the
+ * window.
+ */
+void test_Request_OnlyMissingBlocks( void )
+{
+    OTA_WindowInit( &xWindow, FILE_SIZE, LOG2_BLOCK_SIZE, LOG2_BLOCK_SIZE, 32U, INITIAL_RTO_MS );
+    markReceived( 0, 2 );
+    markReceived( 5, 1 );
+
+    /* The initial window is 4 blocks. */
+    TEST_ASSERT_EQUAL_UINT32( 4, OTA_WindowRequest( &xWindow, ucBitmap, 1000U, &xRequest ) );
+    TEST_ASSERT_EQUAL_UINT32( BLOCK_SIZE, xRequest.ulBlockSize );
+    TEST_ASSERT_EQUAL_UINT32( 2, xRequest.ulBlockOffset );
+    TEST_ASSERT_EQUAL_UINT32( 1, xRequest.ulBitmapSize );
+    TEST_ASSERT_EQUAL_HEX8( 0x17, xRequest.ucBitmap[ 0 ] );
+
+    /* The window is full. */
+    TEST_ASSERT_EQUAL_UINT32( 0, OTA_WindowRequest( &xWindow, ucBitmap, 1100U, &xRequest ) );
+
+    /* Block 2 arrives, the window grows by one: two blocks more. */
+    markReceived( 2, 1 );
+    OTA_WindowReceived( &xWindow, 2, 1, 1400U );
+    TEST_ASSERT_EQUAL_UINT32( 2, OTA_WindowRequest( &xWindow, ucBitmap, 1400U, &xRequest ) );
+    TEST_ASSERT_EQUAL_UINT32( 7, xRequest.ulBlockOffset );
+    TEST_ASSERT_EQUAL_HEX8( 0x03, xRequest.ucBitmap[ 0 ] );
+
+    /* Nothing is requested past the end of the file. */
+    memset( ucBitmap, 0, sizeof( ucBitmap ) );
+    TEST_ASSERT_EQUAL_UINT32( 0, OTA_WindowRequest( &xWindow, ucBitmap, 1500U, &xRequest ) );
+}
+
+/*!
+ * @brief Large blocks are only used for blocks entirely missing, the gaps and
+ * the end of the file are requested with 1K blocks.
+ */
+void test_Request_LargeBlocks( void )
+{
+    uint32_t i;
+
+    OTA_WindowInit( &xWindow, FILE_SIZE, LOG2_BLOCK_SIZE, 12U, 32U, INITIAL_RTO_MS );
+    xWindow.ulWindow = 32U;
+    xWindow.ulShift = 2U;
+
+    /* Block 1 arrived alone: blocks 0, 2 and 3 first, then blocks of 4K. */
+    markReceived( 1, 1 );
+    TEST_ASSERT_EQUAL_UINT32( 3, OTA_WindowRequest( &xWindow, ucBitmap, 0U, &xRequest ) );
+    TEST_ASSERT_EQUAL_UINT32( BLOCK_SIZE, xRequest.ulBlockSize );
+    TEST_ASSERT_EQUAL_UINT32( 0, xRequest.ulBlockOffset );
+    TEST_ASSERT_EQUAL_HEX8( 0x0D, xRequest.ucBitmap[ 0 ] );
+
+    TEST_ASSERT_EQUAL_UINT32( 7, OTA_WindowRequest( &xWindow, ucBitmap, 0U, &xRequest ) );
+    TEST_ASSERT_EQUAL_UINT32( 4U * BLOCK_SIZE, xRequest.ulBlockSize );
+    TEST_ASSERT_EQUAL_UINT32( 1, xRequest.ulBlockOffset );
+    TEST_ASSERT_EQUAL_HEX8( 0x7F, xRequest.ucBitmap[ 0 ] );
+
+    /* The last full 4K block, then the short last block. */
+    OTA_WindowInit( &xWindow, FILE_SIZE, LOG2_BLOCK_SIZE, 12U, 32U, INITIAL_RTO_MS );
+    xWindow.ulWindow = 32U;
+    xWindow.ulShift = 2U;
+    memset( ucBitmap, 0, sizeof( ucBitmap ) );
+
+    for( i = NUM_BLOCKS - 5U; i < NUM_BLOCKS; i++ )
+    {
+        ucBitmap[ i >> 3 ] |= ( uint8_t ) ( 1U << ( i & 7U ) );
+    }
+
+    TEST_ASSERT_EQUAL_UINT32( 1, OTA_WindowRequest( &xWindow, ucBitmap, 0U, &xRequest ) );
+    TEST_ASSERT_EQUAL_UINT32( 4U * BLOCK_SIZE, xRequest.ulBlockSize );
+    TEST_ASSERT_EQUAL_UINT32( ( NUM_BLOCKS - 5U ) / 4U, xRequest.ulBlockOffset );
+
+    TEST_ASSERT_EQUAL_UINT32( 1, OTA_WindowRequest( &xWindow, ucBitmap, 0U, &xRequest ) );
+    TEST_ASSERT_EQUAL_UINT32( BLOCK_SIZE, xRequest.ulBlockSize );
+    TEST_ASSERT_EQUAL_UINT32( NUM_BLOCKS - 1U, xRequest.ulBlockOffset );
+}
+
+/*!
+ * @brief A timeout halves the window once per round trip, halves the block
+ * size and backs off the timer.
+ */
+void test_Timeout_ShrinksWindow( void )
+{
+    uint32_t i;
+
+    OTA_WindowInit( &xWindow, FILE_SIZE, LOG2_BLOCK_SIZE, 11U, 32U, 1000U );
+
+    for( i = 0; i < OTA_WINDOW_GROW_SHIFT_BLOCKS; i++ )
+    {
+        TEST_ASSERT_TRUE( OTA_WindowRequest( &xWindow, ucBitmap, i, &xRequest ) > 0U );
+        markReceived( i, 1 );
+        OTA_WindowReceived( &xWindow, i, 1, i );
+    }
+
+    TEST_ASSERT_EQUAL_UINT32( 1, xWindow.ulShift );
+    TEST_ASSERT_EQUAL_UINT32( 32, xWindow.ulWindow );
+    i = OTA_WindowTimeoutMs( &xWindow );
+
+    /* Fill the window and lose all of it. */
+    while( OTA_WindowRequest( &xWindow, ucBitmap, 100U, &xRequest ) > 0U )
+    {
+    }
+
+    TEST_ASSERT_TRUE( OTA_WindowRequest( &xWindow, ucBitmap, 100U + i, &xRequest ) > 0U );
+    TEST_ASSERT_TRUE( xWindow.xStats.ulTimeouts > 1U );
+    TEST_ASSERT_EQUAL_UINT32( 16, xWindow.ulWindow );
+    TEST_ASSERT_EQUAL_UINT32( 0, xWindow.ulShift );
+    TEST_ASSERT_EQUAL_UINT32( 2U * i, OTA_WindowTimeoutMs( &xWindow ) );
+
+    /* The lost blocks are requested again. */
+    TEST_ASSERT_EQUAL_UINT32( BLOCK_SIZE, xRequest.ulBlockSize );
+    TEST_ASSERT_EQUAL_UINT32( OTA_WINDOW_GROW_SHIFT_BLOCKS, xRequest.ulBlockOffset );
+}
+
+/*!
+ * @brief The timeout follows the round trip, a block requested again does not
+ * measure it.
+ */
+void test_Rtt_NotMeasuredAfterRetry( void )
+{
+    OTA_WindowInit( &xWindow, FILE_SIZE, LOG2_BLOCK_SIZE, LOG2_BLOCK_SIZE, 1U, INITIAL_RTO_MS );
+
+    TEST_ASSERT_EQUAL_UINT32( 1, OTA_WindowRequest( &xWindow, ucBitmap, 0U, &xRequest ) );
+    markReceived( 0, 1 );
+    OTA_WindowReceived( &xWindow, 0, 1, 400U );
+    TEST_ASSERT_EQUAL_UINT32( 1, xWindow.xStats.ulRttSamples );
+    TEST_ASSERT_EQUAL_UINT32( 400U + ( 4U * 200U ), OTA_WindowTimeoutMs( &xWindow ) );
+
+    /* Block 1 times out, is requested again, and the first answer arrives. */
+    TEST_ASSERT_EQUAL_UINT32( 1, OTA_WindowRequest( &xWindow, ucBitmap, 1000U, &xRequest ) );
+    TEST_ASSERT_EQUAL_UINT32( 1, OTA_WindowRequest( &xWindow, ucBitmap, 2200U, &xRequest ) );
+    TEST_ASSERT_EQUAL_UINT32( 1, xRequest.ulBlockOffset );
+    TEST_ASSERT_EQUAL_UINT32( 1, xWindow.xStats.ulTimeouts );
+    markReceived( 1, 1 );
+    OTA_WindowReceived( &xWindow, 1, 1, 2210U );
+    TEST_ASSERT_EQUAL_UINT32( 1, xWindow.xStats.ulRttSamples );
+    TEST_ASSERT_EQUAL_UINT32( 2U * 1200U, OTA_WindowTimeoutMs( &xWindow ) );
+}
+
+/*!
+ * @brief On a lossless link every block is requested once.
+ */
+void test_Download_NoLoss_EachBlockOnce( void )
+{
+    Link_t xLink = xGoodLink;
+    Download_t xDownload;
+
+    xLink.ulLossPerMille = 0;
+    download( &xLink, 32U, 12U, &xDownload );
+
+    TEST_ASSERT_EQUAL_UINT32( 0, xDownload.xStats.ulTimeouts );
+    TEST_ASSERT_EQUAL_UINT32( 0, xDownload.xStats.ulSkipped );
+    TEST_ASSERT_EQUAL_UINT32( NUM_BLOCKS, xDownload.ulBaseBlocksRequested );
+}
+
+/*!
+ * @brief Download time of the image versus the window, with blocks of 1K and
+ * with blocks of 1K to 4K.
+ */
+void test_Download_TimeVersusWindow( void )
+{
+    static const uint32_t ulWindows[] = { 1U, 2U, 4U, 8U, 16U, 32U };
+    const Link_t * pxLinks[] = { &xGoodLink, &xPoorLink };
+    Download_t xFixed;
+    Download_t xAdaptive;
+    uint32_t ulStopAndWaitMs = 0;
+    uint32_t ulLink;
+    uint32_t i;
+
+    for( ulLink = 0; ulLink < ( sizeof( pxLinks ) / sizeof( pxLinks[ 0 ] ) ); ulLink++ )
+    {
+        printf( "ota_window: %u KB image, %s, %u KB/s\n", FILE_SIZE / 1024U,
+                pxLinks[ ulLink ]->pcName, pxLinks[ ulLink ]->ulBytesPerSecond / 1000U );
+
+        for( i = 0; i < ( sizeof( ulWindows ) / sizeof( ulWindows[ 0 ] ) ); i++ )
+        {
+            download( pxLinks[ ulLink ], ulWindows[ i ], LOG2_BLOCK_SIZE, &xFixed );
+            download( pxLinks[ ulLink ], ulWindows[ i ], 12U, &xAdaptive );
+
+            printf( "ota_window:   window %2u: 1K blocks %6.1f s (%3u lost, %3u requests), 1K-4K blocks %6.1f s (%3u lost, %3u requests)\n",
+                    ulWindows[ i ],
+                    xFixed.ulTimeMs / 1000.0, xFixed.xStats.ulTimeouts + xFixed.xStats.ulSkipped, xFixed.xStats.ulRequests,
+                    xAdaptive.ulTimeMs / 1000.0, xAdaptive.xStats.ulTimeouts + xAdaptive.xStats.ulSkipped, xAdaptive.xStats.ulRequests );
+
+            if( ulWindows[ i ] == 1U )
+            {
+                ulStopAndWaitMs = xFixed.ulTimeMs;
+            }
+
+            /* Lost blocks are requested again, and only them. */
+            TEST_ASSERT_TRUE( xFixed.ulBaseBlocksRequested >= ( NUM_BLOCKS + xFixed.ulBaseBlocksLost ) );
+            TEST_ASSERT_TRUE( xFixed.ulBaseBlocksRequested <=
+                              ( NUM_BLOCKS + xFixed.ulBaseBlocksLost + xFixed.xStats.ulTimeouts + xFixed.xStats.ulSkipped ) );
+        }
+
+        /* A full window keeps the link busy. */
+        TEST_ASSERT_TRUE( ( xFixed.ulTimeMs * 4U ) < ulStopAndWaitMs );
+        TEST_ASSERT_TRUE( ( xAdaptive.ulTimeMs * 4U ) < ulStopAndWaitMs );
+    }
+}
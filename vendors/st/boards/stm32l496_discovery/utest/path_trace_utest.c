@@ -0,0 +1,263 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "unity.h"
+
+#include "path_trace.h"
+
+/* Host timestamp: clock_gettime() in nanoseconds. */
+#define TICKS_PER_US            ( 1000U )
+
+/* Trace points timed by the cost test. */
+#define COST_ITERATIONS         ( 1000000U )
+
+/* ============================  GLOBAL VARIABLES =========================== */
+
+/* Timestamp of the manual clock. */
+static uint32_t ulManualNow;
+
+static uint32_t ulCriticalDepth;
+static uint32_t ulCriticalSections;
+
+/* ============================  Timestamp sources  ========================= */
+
+static uint32_t hostTimestamp( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( uint32_t ) ( ( ( uint64_t ) xNow.tv_sec * 1000000000U ) + ( uint64_t ) xNow.tv_nsec );
+}
+
+static uint32_t manualTimestamp( void )
+{
+    return ulManualNow;
+}
+
+static void enterCritical( void )
+{
+    ulCriticalDepth++;
+    ulCriticalSections++;
+}
+
+static void exitCritical( void )
+{
+    TEST_ASSERT_EQUAL_UINT32( 1U, ulCriticalDepth );
+    ulCriticalDepth--;
+}
+
+/* ==========================  Helper functions  ============================ */
+
+static void startManualClock( uint32_t ulTicksPerUs )
+{
+    PathTraceConfig_t xConfig = { 0 };
+
+    xConfig.xTimestamp = manualTimestamp;
+    xConfig.ulTicksPerUs = ulTicksPerUs;
+    xConfig.xEnterCritical = enterCritical;
+    xConfig.xExitCritical = exitCritical;
+    PathTrace_Init( &xConfig );
+}
+
+static void recordUs( PathTraceStage_t eStage,
+                      uint32_t ulUs,
+                      uint32_t ulTimes )
+{
+    uint32_t i;
+
+    for( i = 0; i < ulTimes; i++ )
+    {
+        PathTrace_Record( eStage, ulUs * TICKS_PER_US );
+    }
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+void setUp( void )
+{
+    PathTraceConfig_t xConfig = { 0 };
+
+    xConfig.xTimestamp = hostTimestamp;
+    xConfig.ulTicksPerUs = TICKS_PER_US;
+    PathTrace_Init( &xConfig );
+
+    ulManualNow = 0;
+    ulCriticalDepth = 0;
+    ulCriticalSections = 0;
+}
+
+void tearDown( void )
+{
+}
+
+/* ==========================  Test Cases  ================================== */
+
+/* Trace points reached before the board starts tracing do nothing. */
+void test_NotStarted_Ignored( void )
+{
+    PathTraceConfig_t xConfig = { 0 };
+    PathTraceReport_t xReport;
+
+    PathTrace_Init( &xConfig );
+
+    TEST_ASSERT_EQUAL_UINT32( 0, PathTrace_Begin() );
+    PathTrace_End( PATH_TRACE_METER_READ, 0 );
+    PathTrace_Record( PATH_TRACE_METER_READ, 100U );
+    PathTrace_Report( PATH_TRACE_METER_READ, &xReport );
+
+    TEST_ASSERT_EQUAL_UINT32( 0, xReport.ulCount );
+    TEST_ASSERT_EQUAL_UINT32( 0, xReport.ulMaxUs );
+}
+
+/* Percentiles are reported at the top of their bucket, at most 25% above the
+ * exact value and never above the longest duration. */
+void test_Percentiles_WithinBucket( void )
+{
+    PathTraceReport_t xReport;
+    uint32_t i;
+
+    for( i = 1; i <= 1000U; i++ )
+    {
+        recordUs( PATH_TRACE_TLS_ENCRYPT, i, 1U );
+    }
+
+    PathTrace_Report( PATH_TRACE_TLS_ENCRYPT, &xReport );
+
+    TEST_ASSERT_EQUAL_UINT32( 1000U, xReport.ulCount );
+    TEST_ASSERT_EQUAL_UINT32( 1000U, xReport.ulMaxUs );
+    TEST_ASSERT_UINT32_WITHIN( 125U, 625U, xReport.ulP50Us );
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32( 990U, xReport.ulP99Us );
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32( 1000U, xReport.ulP99Us );
+
+    /* Other stages are untouched. */
+    PathTrace_Report( PATH_TRACE_COM_SEND, &xReport );
+    TEST_ASSERT_EQUAL_UINT32( 0, xReport.ulCount );
+}
+
+/* Short durations have a bucket each, long ones land in the last bucket. */
+void test_Buckets_Bounds( void )
+{
+    PathTraceReport_t xReport;
+
+    recordUs( PATH_TRACE_MQTT_SERIALIZE, 3U, 10U );
+    PathTrace_Report( PATH_TRACE_MQTT_SERIALIZE, &xReport );
+    TEST_ASSERT_EQUAL_UINT32( 3U, xReport.ulP50Us );
+    TEST_ASSERT_EQUAL_UINT32( 3U, xReport.ulP99Us );
+
+    recordUs( PATH_TRACE_MQTT_PUBACK, 100U, 98U );
+    PathTrace_Record( PATH_TRACE_MQTT_PUBACK, 4000000000U );
+    PathTrace_Record( PATH_TRACE_MQTT_PUBACK, 4000000000U );
+    PathTrace_Report( PATH_TRACE_MQTT_PUBACK, &xReport );
+    TEST_ASSERT_UINT32_WITHIN( 12U, 107U, xReport.ulP50Us );
+    TEST_ASSERT_EQUAL_UINT32( 4000000U, xReport.ulP99Us );
+    TEST_ASSERT_EQUAL_UINT32( 4000000U, xReport.ulMaxUs );
+
+    /* Stages out of range are ignored. */
+    PathTrace_Record( PATH_TRACE_STAGE_COUNT, 10U );
+    PathTrace_Report( PATH_TRACE_STAGE_COUNT, &xReport );
+    TEST_ASSERT_EQUAL_UINT32( 0, xReport.ulCount );
+    TEST_ASSERT_EQUAL_STRING( "mqtt puback", PathTrace_StageName( PATH_TRACE_MQTT_PUBACK ) );
+    TEST_ASSERT_EQUAL_STRING( "?", PathTrace_StageName( PATH_TRACE_STAGE_COUNT ) );
+}
+
+/* A full bucket halves its histogram, the percentiles of a long uptime keep
+ * their value. */
+void test_Saturation_KeepsPercentiles( void )
+{
+    PathTraceReport_t xReport;
+
+    recordUs( PATH_TRACE_COM_MODEM_SEND, 10U, 70000U );
+    recordUs( PATH_TRACE_COM_MODEM_SEND, 1000U, 1500U );
+    recordUs( PATH_TRACE_COM_MODEM_SEND, 10U, 70000U );
+    recordUs( PATH_TRACE_COM_MODEM_SEND, 1000U, 1500U );
+    PathTrace_Report( PATH_TRACE_COM_MODEM_SEND, &xReport );
+
+    TEST_ASSERT_EQUAL_UINT32( 143000U, xReport.ulCount );
+    TEST_ASSERT_EQUAL_UINT32( 11U, xReport.ulP50Us );
+    TEST_ASSERT_UINT32_WITHIN( 24U, 1023U, xReport.ulP99Us );
+
+    PathTrace_Reset();
+    PathTrace_Report( PATH_TRACE_COM_MODEM_SEND, &xReport );
+    TEST_ASSERT_EQUAL_UINT32( 0, xReport.ulCount );
+}
+
+/* A stage spanning a wrap of the counter is measured, the histogram is
+ * updated under the critical section of the board. */
+void test_CounterWrap_CriticalSection( void )
+{
+    PathTraceReport_t xReport;
+    uint32_t ulStart;
+
+    startManualClock( 80U );
+    ulManualNow = 0xFFFFFF00U;
+    ulStart = PathTrace_Begin();
+    ulManualNow = 80U * 1000U - 0x100U;
+    PathTrace_End( PATH_TRACE_METER_READ, ulStart );
+
+    PathTrace_Report( PATH_TRACE_METER_READ, &xReport );
+    TEST_ASSERT_EQUAL_UINT32( 1U, xReport.ulCount );
+    TEST_ASSERT_EQUAL_UINT32( 1000U, xReport.ulMaxUs );
+    TEST_ASSERT_EQUAL_UINT32( 0, ulCriticalDepth );
+    TEST_ASSERT_GREATER_THAN_UINT32( 1U, ulCriticalSections );
+}
+
+/* The host clock measures a stage end to end. */
+void test_HostClock_Sleep( void )
+{
+    struct timespec xSleep = { 0, 2000000 };
+    PathTraceReport_t xReport;
+    uint32_t ulStart;
+
+    ulStart = PathTrace_Begin();
+    ( void ) nanosleep( &xSleep, NULL );
+    PathTrace_End( PATH_TRACE_RECORD_ENCODE, ulStart );
+
+    PathTrace_Report( PATH_TRACE_RECORD_ENCODE, &xReport );
+    TEST_ASSERT_EQUAL_UINT32( 1U, xReport.ulCount );
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32( 2000U, xReport.ulMaxUs );
+    TEST_ASSERT_EQUAL_UINT32( xReport.ulMaxUs, xReport.ulP50Us );
+}
+
+/* Cost of a trace point, two timestamps and a bucket update. Host figure. */
+void test_Cost_TracePoint( void )
+{
+    uint32_t ulStart = hostTimestamp();
+    uint32_t i;
+
+    for( i = 0; i < COST_ITERATIONS; i++ )
+    {
+        PathTrace_End( PATH_TRACE_MQTT_SERIALIZE, PathTrace_Begin() );
+    }
+
+    printf( "path_trace: %u ns per trace point (host)\n",
+            ( unsigned ) ( ( hostTimestamp() - ulStart ) / COST_ITERATIONS ) );
+}
@@ -0,0 +1,462 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "unity.h"
+
+#include "iot_config.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "private/iot_slab.h"
+#include "private/iot_static_memory.h"
+#include "static_memory_internal.h"
+#include "iot_serializer.h"
+#include "cbor.h"
+
+/* Size classes of the library, see CMakeLists.txt. */
+#define CLASSES                   ( 7U )
+#define CLASS_32                  ( 0U )
+#define CLASS_64                  ( 1U )
+#define CLASS_512                 ( 4U )
+#define CLASS_4096                ( 6U )
+
+/* Blocks of each class. */
+static const size_t xClassSizes[ CLASSES ] = { 32, 64, 128, 256, 512, 1024, 4096 };
+static const uint32_t ulClassBlocks[ CLASSES ] = { 16, 16, 16, 16, 16, 4, 1 };
+
+/* Publish churn of the benchmark: PUBLISH awaiting their PUBACK, and
+ * PUBLISH sent. */
+#define CHURN_WINDOW              ( 8U )
+#define CHURN_PUBLISHES           ( 200000U )
+
+/* Long-lived subscriptions made and removed during the churn. */
+#define CHURN_SUBSCRIPTIONS       ( 4U )
+
+/* ============================  GLOBAL VARIABLES =========================== */
+
+/* Allocator driven by the benchmark. */
+typedef struct Allocator
+{
+    const char * pcName;
+    void * ( *pvMalloc )( size_t xSize );
+    void ( * vFree )( void * pv );
+} Allocator_t;
+
+/* Objects of one QoS 1 PUBLISH between its serialization and its PUBACK. */
+typedef struct Publish
+{
+    void * pvOperation;
+    void * pvPacket;
+    void * pvJob;
+} Publish_t;
+
+/* ==========================  Platform and kernel  ========================= */
+
+bool IotMutex_Create( IotMutex_t * pNewMutex,
+                      bool recursive )
+{
+    ( void ) pNewMutex;
+    ( void ) recursive;
+
+    return true;
+}
+
+void IotMutex_Destroy( IotMutex_t * pMutex )
+{
+    ( void ) pMutex;
+}
+
+void IotMutex_Lock( IotMutex_t * pMutex )
+{
+    ( void ) pMutex;
+}
+
+void IotMutex_Unlock( IotMutex_t * pMutex )
+{
+    ( void ) pMutex;
+}
+
+/* The scheduler lock of heap_4 costs as little as the mutex of the slab. */
+void vTaskSuspendAll( void )
+{
+}
+
+BaseType_t xTaskResumeAll( void )
+{
+    return pdFALSE;
+}
+
+void vPortEnterCritical( void )
+{
+}
+
+void vPortExitCritical( void )
+{
+}
+
+void vApplicationMallocFailedHook( void )
+{
+    TEST_FAIL_MESSAGE( "heap_4 exhausted" );
+}
+
+void vTraceStoreMemMangEvent( uint32_t ecode,
+                              uint32_t address,
+                              int32_t size )
+{
+    ( void ) ecode;
+    ( void ) address;
+    ( void ) size;
+}
+
+/* ==========================  Helper functions  ============================ */
+
+static IotSlabStats_t getStats( uint32_t ulClass )
+{
+    IotSlabStats_t xStats;
+
+    TEST_ASSERT_TRUE( IotSlab_GetStats( ulClass, &xStats ) );
+
+    return xStats;
+}
+
+static uint32_t totalInUse( void )
+{
+    uint32_t i, ulInUse = 0;
+
+    for( i = 0; i < IotSlab_ClassCount(); i++ )
+    {
+        ulInUse += getStats( i ).inUse;
+    }
+
+    return ulInUse;
+}
+
+/* A block of the class, checked for size and alignment and filled. */
+static void * mallocFrom( size_t xSize,
+                          uint32_t ulClass )
+{
+    uint32_t ulInUse = getStats( ulClass ).inUse;
+    uint8_t * pucBlock = IotSlab_Malloc( xSize );
+
+    TEST_ASSERT_NOT_NULL( pucBlock );
+    TEST_ASSERT_EQUAL_UINT32( ulInUse + 1U, getStats( ulClass ).inUse );
+    TEST_ASSERT_EQUAL( 0, ( uintptr_t ) pucBlock % sizeof( uint64_t ) );
+    ( void ) memset( pucBlock, 0xA5, xSize );
+
+    return pucBlock;
+}
+
+static void * slabMalloc( size_t xSize )
+{
+    return IotSlab_Malloc( xSize );
+}
+
+static void slabFree( void * pv )
+{
+    IotSlab_Free( pv );
+}
+
+/* Pseudo-random sequence of the benchmark, the same for every allocator. */
+static uint32_t ulRandom;
+
+static uint32_t nextRandom( void )
+{
+    ulRandom = ( ulRandom * 1103515245U ) + 12345U;
+
+    return ulRandom >> 8;
+}
+
+static double cpuTimeUs( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &xNow );
+
+    return ( ( double ) xNow.tv_sec * 1e6 ) + ( ( double ) xNow.tv_nsec / 1e3 );
+}
+
+/* The allocations of the MQTT, task pool and serializer libraries for
+ * CHURN_PUBLISHES QoS 1 PUBLISH of a meter record: the record is encoded,
+ * the PUBLISH serialized and sent, and its PUBACK, read into a message buffer,
+ * frees the operation, the packet and the retry job. The PUBACK of a random
+ * PUBLISH of the window arrives first, and subscriptions come and go.
+ * Returns the CPU time in us per allocation and free, and the heap_4 state
+ * before the last PUBACK in pxHeapStats if not NULL. */
+static double churn( const Allocator_t * pxAllocator,
+                     HeapStats_t * pxHeapStats )
+{
+    Publish_t xWindow[ CHURN_WINDOW ] = { 0 };
+    void * pvSubscriptions[ CHURN_SUBSCRIPTIONS ] = { 0 };
+    void * pvEncoder, * pvAck;
+    uint32_t i, ulSlot, ulOperations = 0;
+    double dStart;
+
+    ulRandom = 1U;
+    dStart = cpuTimeUs();
+
+    for( i = 0; i < CHURN_PUBLISHES; i++ )
+    {
+        ulSlot = i % CHURN_WINDOW;
+
+        /* PUBACK of a PUBLISH of the window once it is full. */
+        if( i >= CHURN_WINDOW )
+        {
+            ulSlot = nextRandom() % CHURN_WINDOW;
+            pvAck = pxAllocator->pvMalloc( 2U );
+            TEST_ASSERT_NOT_NULL( pvAck );
+            pxAllocator->vFree( pvAck );
+            pxAllocator->vFree( xWindow[ ulSlot ].pvJob );
+            pxAllocator->vFree( xWindow[ ulSlot ].pvPacket );
+            pxAllocator->vFree( xWindow[ ulSlot ].pvOperation );
+            ulOperations += 4U;
+        }
+
+        /* Meter record, then the PUBLISH of 80 to 400 bytes. */
+        pvEncoder = pxAllocator->pvMalloc( sizeof( CborEncoder ) );
+        TEST_ASSERT_NOT_NULL( pvEncoder );
+        xWindow[ ulSlot ].pvPacket = pxAllocator->pvMalloc( 80U + ( nextRandom() % 321U ) );
+        pxAllocator->vFree( pvEncoder );
+        xWindow[ ulSlot ].pvOperation = pxAllocator->pvMalloc( sizeof( _mqttOperation_t ) );
+        xWindow[ ulSlot ].pvJob = pxAllocator->pvMalloc( sizeof( _taskPoolJob_t ) );
+        TEST_ASSERT_NOT_NULL( xWindow[ ulSlot ].pvPacket );
+        TEST_ASSERT_NOT_NULL( xWindow[ ulSlot ].pvOperation );
+        TEST_ASSERT_NOT_NULL( xWindow[ ulSlot ].pvJob );
+        ulOperations += 5U;
+
+        /* Subscription with a topic filter of up to 128 bytes. */
+        if( ( nextRandom() % 64U ) == 0U )
+        {
+            ulSlot = nextRandom() % CHURN_SUBSCRIPTIONS;
+            pxAllocator->vFree( pvSubscriptions[ ulSlot ] );
+            pvSubscriptions[ ulSlot ] = pxAllocator->pvMalloc( sizeof( _mqttSubscription_t ) + ( nextRandom() % 129U ) );
+            TEST_ASSERT_NOT_NULL( pvSubscriptions[ ulSlot ] );
+            ulOperations += 2U;
+        }
+    }
+
+    if( pxHeapStats != NULL )
+    {
+        vPortGetHeapStats( pxHeapStats );
+    }
+
+    for( i = 0; i < CHURN_WINDOW; i++ )
+    {
+        pxAllocator->vFree( xWindow[ i ].pvJob );
+        pxAllocator->vFree( xWindow[ i ].pvPacket );
+        pxAllocator->vFree( xWindow[ i ].pvOperation );
+    }
+
+    for( i = 0; i < CHURN_SUBSCRIPTIONS; i++ )
+    {
+        pxAllocator->vFree( pvSubscriptions[ i ] );
+    }
+
+    return ( cpuTimeUs() - dStart ) / ( double ) ulOperations * 2.0;
+}
+
+/* ==========================  TEST SETUP/TEARDOWN  ========================== */
+
+void setUp( void )
+{
+    TEST_ASSERT_TRUE( IotSlab_Init() );
+    TEST_ASSERT_TRUE( IotStaticMemory_Init() );
+}
+
+void tearDown( void )
+{
+    IotStaticMemory_Cleanup();
+    IotSlab_Cleanup();
+}
+
+/* ==============================  TEST CASES  ============================== */
+
+/*!
+ * @brief The pool is split into the configured classes, all free.
+ */
+void test_Init_SplitsClasses( void )
+{
+    IotSlabStats_t xStats;
+    uint32_t i;
+
+    TEST_ASSERT_EQUAL_UINT32( CLASSES, IotSlab_ClassCount() );
+
+    for( i = 0; i < CLASSES; i++ )
+    {
+        xStats = getStats( i );
+        TEST_ASSERT_EQUAL( xClassSizes[ i ], xStats.blockSize );
+        TEST_ASSERT_EQUAL_UINT32( ulClassBlocks[ i ], xStats.blocks );
+        TEST_ASSERT_EQUAL_UINT32( 0, xStats.inUse );
+        TEST_ASSERT_EQUAL_UINT32( 0, xStats.highWater );
+        TEST_ASSERT_EQUAL_UINT32( 0, xStats.failures );
+    }
+
+    TEST_ASSERT_FALSE( IotSlab_GetStats( CLASSES, &xStats ) );
+}
+
+/*!
+ * @brief A request takes a block of the smallest class that fits, the
+ * block freed last is handed out first, and the high water stays.
+ */
+void test_Malloc_SmallestClass( void )
+{
+    void * pvFirst, * pvSecond;
+
+    pvFirst = mallocFrom( 1U, CLASS_32 );
+    pvSecond = mallocFrom( 32U, CLASS_32 );
+    IotSlab_Free( mallocFrom( 33U, CLASS_64 ) );
+    IotSlab_Free( mallocFrom( 0U, CLASS_32 ) );
+    IotSlab_Free( mallocFrom( 4096U, CLASS_4096 ) );
+
+    IotSlab_Free( pvFirst );
+    TEST_ASSERT_EQUAL_PTR( pvFirst, IotSlab_Malloc( 16U ) );
+    IotSlab_Free( pvFirst );
+    IotSlab_Free( pvSecond );
+
+    TEST_ASSERT_EQUAL_UINT32( 0, totalInUse() );
+    TEST_ASSERT_EQUAL_UINT32( 3, getStats( CLASS_32 ).highWater );
+    TEST_ASSERT_EQUAL_UINT32( 4, getStats( CLASS_32 ).allocations );
+    TEST_ASSERT_EQUAL_UINT32( 1, getStats( CLASS_64 ).highWater );
+}
+
+/*!
+ * @brief A full class spills to the next class with a free block; when no
+ * class has one, or the request is larger than every class, the request
+ * counts as a failure of its class and goes to heap_4, the fallback of the
+ * library.
+ */
+void test_Malloc_SpillsThenFails( void )
+{
+    void * pvBlocks[ 64 ];
+    size_t xHeapFree;
+    uint32_t i, j, ulCount = 0;
+
+    /* heap_4 sets up its free list on the first allocation. */
+    vPortFree( pvPortMalloc( 1U ) );
+    xHeapFree = xPortGetFreeHeapSize();
+
+    /* Every block of 512 bytes and above. */
+    for( i = CLASS_512; i < CLASSES; i++ )
+    {
+        for( j = 0; j < ulClassBlocks[ i ]; j++ )
+        {
+            pvBlocks[ ulCount++ ] = mallocFrom( 300U, i );
+        }
+    }
+
+    pvBlocks[ ulCount++ ] = IotSlab_Malloc( 300U );
+    TEST_ASSERT_EQUAL_UINT32( 1, getStats( CLASS_512 ).failures );
+    pvBlocks[ ulCount++ ] = IotSlab_Malloc( 4097U );
+    TEST_ASSERT_EQUAL_UINT32( 1, getStats( CLASS_4096 ).failures );
+    TEST_ASSERT_LESS_THAN( xHeapFree - 4097U, xPortGetFreeHeapSize() );
+
+    /* Smaller classes are still served. */
+    pvBlocks[ ulCount++ ] = mallocFrom( 200U, CLASS_512 - 1U );
+
+    for( i = 0; i < ulCount; i++ )
+    {
+        IotSlab_Free( pvBlocks[ i ] );
+    }
+
+    /* Every pointer outside of the pool goes back to heap_4. */
+    TEST_ASSERT_EQUAL_UINT32( 0, totalInUse() );
+    TEST_ASSERT_EQUAL( xHeapFree, xPortGetFreeHeapSize() );
+    IotSlab_Free( NULL );
+}
+
+/*!
+ * @brief With the slab allocator selected, the static memory functions of
+ * the MQTT, task pool and serializer libraries take their objects from the
+ * size classes and still reject unexpected sizes.
+ */
+void test_StaticMemory_FromSlab( void )
+{
+    void * pvOperation, * pvConnection, * pvJob, * pvTimer, * pvEncoder, * pvMessage;
+
+    pvOperation = IotMqtt_MallocOperation( sizeof( _mqttOperation_t ) );
+    pvConnection = IotMqtt_MallocConnection( sizeof( _mqttConnection_t ) );
+    pvJob = IotTaskPool_MallocJob( sizeof( _taskPoolJob_t ) );
+    pvTimer = IotTaskPool_MallocTimerEvent( sizeof( _taskPoolTimerEvent_t ) );
+    pvEncoder = IotSerializer_MallocCborEncoder( sizeof( CborEncoder ) );
+    pvMessage = Iot_MallocMessageBuffer( 100U );
+
+    TEST_ASSERT_NOT_NULL( pvOperation );
+    TEST_ASSERT_NOT_NULL( pvConnection );
+    TEST_ASSERT_NOT_NULL( pvJob );
+    TEST_ASSERT_NOT_NULL( pvTimer );
+    TEST_ASSERT_NOT_NULL( pvEncoder );
+    TEST_ASSERT_NOT_NULL( pvMessage );
+    TEST_ASSERT_EQUAL_UINT32( 6, totalInUse() );
+    TEST_ASSERT_EQUAL_UINT32( 1, getStats( CLASS_512 ).inUse );
+    TEST_ASSERT_EQUAL_UINT32( 1, getStats( CLASS_4096 ).inUse );
+
+    TEST_ASSERT_NULL( IotMqtt_MallocOperation( sizeof( _mqttOperation_t ) + 1U ) );
+    TEST_ASSERT_NULL( IotTaskPool_MallocJob( 1U ) );
+    TEST_ASSERT_NULL( Iot_MallocMessageBuffer( Iot_MessageBufferSize() + 1U ) );
+
+    IotMqtt_FreeOperation( pvOperation );
+    IotMqtt_FreeConnection( pvConnection );
+    IotTaskPool_FreeJob( pvJob );
+    IotTaskPool_FreeTimerEvent( pvTimer );
+    IotSerializer_FreeCborEncoder( pvEncoder );
+    Iot_FreeMessageBuffer( pvMessage );
+    TEST_ASSERT_EQUAL_UINT32( 0, totalInUse() );
+}
+
+/*!
+ * @brief The publish and PUBACK churn on the slab allocator and on heap_4.
+ * The slab serves every request from the pool, and heap_4 is left with
+ * scattered free blocks.
+ */
+void test_Benchmark_PublishChurn( void )
+{
+    const Allocator_t xSlab = { "slab", slabMalloc, slabFree };
+    const Allocator_t xHeap4 = { "heap_4", pvPortMalloc, vPortFree };
+    HeapStats_t xHeapStats;
+    double dSlabUs, dHeap4Us;
+    uint32_t i;
+
+    dHeap4Us = churn( &xHeap4, &xHeapStats );
+    dSlabUs = churn( &xSlab, NULL );
+
+    TEST_ASSERT_EQUAL_UINT32( 0, totalInUse() );
+
+    for( i = 0; i < CLASSES; i++ )
+    {
+        TEST_ASSERT_EQUAL_UINT32( 0, getStats( i ).failures );
+    }
+
+    printf( "slab: publish churn, heap_4 %.3f us per malloc and free (%u free blocks), "
+            "slab %.3f us, high water 32:%u 64:%u 128:%u 256:%u 512:%u 1024:%u\n",
+            dHeap4Us, ( unsigned ) xHeapStats.xNumberOfFreeBlocks, dSlabUs,
+            ( unsigned ) getStats( 0 ).highWater, ( unsigned ) getStats( 1 ).highWater,
+            ( unsigned ) getStats( 2 ).highWater, ( unsigned ) getStats( 3 ).highWater,
+            ( unsigned ) getStats( 4 ).highWater, ( unsigned ) getStats( 5 ).highWater );
+}
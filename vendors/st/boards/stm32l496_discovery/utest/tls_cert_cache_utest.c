@@ -0,0 +1,278 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "unity.h"
+
+#include "FreeRTOS.h"
+#include "iot_tls.h"
+#include "iot_default_root_certificates.h"
+
+#include "mbedtls/certs.h"
+#include "mbedtls/x509_crt.h"
+
+#include "freertos_host.h"
+#include "tls_server_host.h"
+
+/* Chains parsed to time one parse. */
+#define BENCHMARK_PARSES    ( 200U )
+
+/* ============================  GLOBAL VARIABLES =========================== */
+
+static const char * pcServerDer;
+static uint32_t ulServerDerLength;
+
+/* Server certificate and the default AWS roots, as a device trusting both
+ * would pass them. */
+static char cBundle[ 8192 ];
+static uint32_t ulBundleLength;
+
+/* Cost of one connection. */
+typedef struct ConnectCost
+{
+    uint32_t ulParses;
+    uint32_t ulHits;
+    uint32_t ulCertificateReads;
+    size_t xHeapPeak;
+} ConnectCost_t;
+
+/* ==========================  Helper functions  ============================ */
+
+static uint64_t nowMicroseconds( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( uint64_t ) xNow.tv_sec * 1000000U ) + ( ( uint64_t ) xNow.tv_nsec / 1000U );
+}
+
+/* Time of the parse done by each connection without the cache: the trust
+ * anchors and the device certificate. The handshake itself varies more than
+ * this from one connection to the next. */
+static uint64_t parseMicroseconds( const char * pcServerCertificate,
+                                   uint32_t ulServerCertificateLength )
+{
+    mbedtls_x509_crt xChain;
+    uint64_t ullStart = nowMicroseconds();
+    uint32_t i;
+
+    for( i = 0; i < BENCHMARK_PARSES; i++ )
+    {
+        mbedtls_x509_crt_init( &xChain );
+        TEST_ASSERT_EQUAL( 0, mbedtls_x509_crt_parse( &xChain, ( const unsigned char * ) pcServerCertificate,
+                                                      ulServerCertificateLength ) );
+        TEST_ASSERT_EQUAL( 0, mbedtls_x509_crt_parse( &xChain, ( const unsigned char * ) mbedtls_test_cli_crt_ec,
+                                                      mbedtls_test_cli_crt_ec_len ) );
+        mbedtls_x509_crt_free( &xChain );
+    }
+
+    return ( nowMicroseconds() - ullStart ) / BENCHMARK_PARSES;
+}
+
+static void appendBundle( const char * pcPem )
+{
+    size_t xLength = strlen( pcPem );
+
+    TEST_ASSERT_LESS_THAN( sizeof( cBundle ) - ulBundleLength, xLength );
+    memcpy( &cBundle[ ulBundleLength ], pcPem, xLength + 1U );
+    ulBundleLength += ( uint32_t ) xLength;
+}
+
+/* Connect, measuring the certificate work and the heap above the current
+ * usage. */
+static void connectMeasure( const char * pcServerCertificate,
+                            uint32_t ulServerCertificateLength,
+                            ConnectCost_t * pxCost )
+{
+    TLSHandshakeStats_t xBefore, xAfter;
+    FreeRTOSHostHeapStats_t xHeap;
+    uint32_t ulReads = TlsServerHost_GetCertificateReads();
+    size_t xBaseline;
+
+    TLS_GetHandshakeStats( &xBefore );
+    FreeRTOSHost_HeapMeasure();
+    FreeRTOSHost_GetHeapStats( &xHeap );
+    xBaseline = xHeap.xCurrent;
+
+    TEST_ASSERT_EQUAL( 0, TlsServerHost_Connect( pcServerCertificate, ulServerCertificateLength ) );
+
+    FreeRTOSHost_GetHeapStats( &xHeap );
+    TLS_GetHandshakeStats( &xAfter );
+
+    pxCost->xHeapPeak = xHeap.xPeak - xBaseline;
+    pxCost->ulParses = xAfter.ulCertificateParses - xBefore.ulCertificateParses;
+    pxCost->ulHits = xAfter.ulCertificateHits - xBefore.ulCertificateHits;
+    pxCost->ulCertificateReads = TlsServerHost_GetCertificateReads() - ulReads;
+}
+
+static void connectExpect( const char * pcServerCertificate,
+                           uint32_t ulServerCertificateLength,
+                           uint32_t ulParses,
+                           uint32_t ulCertificateReads )
+{
+    ConnectCost_t xCost;
+
+    connectMeasure( pcServerCertificate, ulServerCertificateLength, &xCost );
+
+    TEST_ASSERT_EQUAL_UINT32( ulParses, xCost.ulParses );
+    TEST_ASSERT_EQUAL_UINT32( 2U - ulParses, xCost.ulHits );
+    TEST_ASSERT_EQUAL_UINT32( ulCertificateReads, xCost.ulCertificateReads );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* called before each testcase */
+void setUp( void )
+{
+    TlsServerHost_Init();
+    TlsServerHost_GetCertificateDer( &pcServerDer, &ulServerDerLength );
+
+    ulBundleLength = 0;
+    appendBundle( tlsVERISIGN_ROOT_CERTIFICATE_PEM );
+    appendBundle( tlsATS1_ROOT_CERTIFICATE_PEM );
+    appendBundle( tlsSTARFIELD_ROOT_CERTIFICATE_PEM );
+    appendBundle( TlsServerHost_GetCertificatePem() );
+
+    /* The PEM length includes the terminating NUL. */
+    ulBundleLength++;
+
+    TlsServerHost_Start( false, false );
+    TLS_FlushCertificateCache();
+}
+
+/* called after each testcase */
+void tearDown( void )
+{
+    TlsServerHost_Stop();
+}
+
+/* called at the beginning of the whole suite */
+void suiteSetUp()
+{
+}
+
+/* called at the end of the whole suite */
+int suiteTearDown( int numFailures )
+{
+    return( numFailures > 0 );
+}
+
+/* ========================  TESTING certificate cache  ===================== */
+/*!
+ * @brief The trust anchors and the device certificate are parsed by the
+ * first connection only.
+ */
+void test_Chains_ParsedOnce( void )
+{
+    connectExpect( pcServerDer, ulServerDerLength, 2, 1 );
+    connectExpect( pcServerDer, ulServerDerLength, 0, 0 );
+    connectExpect( pcServerDer, ulServerDerLength, 0, 0 );
+}
+
+/*!
+ * @brief A flush, as after provisioning, makes the next connection parse
+ * the chains again.
+ */
+void test_Flush_ChainsParsedAgain( void )
+{
+    connectExpect( pcServerDer, ulServerDerLength, 2, 1 );
+    TLS_FlushCertificateCache();
+    connectExpect( pcServerDer, ulServerDerLength, 2, 1 );
+    connectExpect( pcServerDer, ulServerDerLength, 0, 0 );
+}
+
+/*!
+ * @brief New certificates in the buffer of an override are not mistaken for
+ * the cached ones.
+ */
+void test_ReusedBuffer_ParsedAgain( void )
+{
+    static char cOverride[ sizeof( cBundle ) ];
+
+    memcpy( cOverride, pcServerDer, ulServerDerLength );
+    connectExpect( cOverride, ulServerDerLength, 2, 1 );
+
+    /* Same buffer, same length, other content: the connection fails if the
+     * stale chain is used. */
+    memset( cOverride, 0, ulServerDerLength );
+    TEST_ASSERT_NOT_EQUAL( 0, TlsServerHost_Connect( cOverride, ulServerDerLength ) );
+
+    memcpy( cOverride, cBundle, ulBundleLength );
+    connectExpect( cOverride, ulBundleLength, 1, 0 );
+    connectExpect( cOverride, ulBundleLength, 0, 0 );
+}
+
+/*!
+ * @brief With more overrides than entries, the least recently used list is
+ * parsed again.
+ */
+void test_Overrides_LeastRecentlyUsedReplaced( void )
+{
+    TEST_ASSERT_EQUAL( 2, tlsCERTIFICATE_CACHE_ENTRIES );
+
+    connectExpect( pcServerDer, ulServerDerLength, 2, 1 );
+    connectExpect( cBundle, ulBundleLength, 1, 0 );
+    connectExpect( pcServerDer, ulServerDerLength, 0, 0 );
+
+    /* Replaces the bundle, used before the DER. */
+    connectExpect( TlsServerHost_GetCertificatePem(), strlen( TlsServerHost_GetCertificatePem() ) + 1U, 1, 0 );
+    connectExpect( pcServerDer, ulServerDerLength, 0, 0 );
+    connectExpect( cBundle, ulBundleLength, 1, 0 );
+}
+
+/*!
+ * @brief Cost of a connection trusting the default roots and the server,
+ * without the cache (flushed before each connection) and with it.
+ */
+void test_Benchmark_ColdAndWarm( void )
+{
+    ConnectCost_t xCold, xWarm;
+    FreeRTOSHostHeapStats_t xBefore, xAfter;
+
+    FreeRTOSHost_HeapMeasure();
+    FreeRTOSHost_GetHeapStats( &xBefore );
+
+    connectMeasure( cBundle, ulBundleLength, &xCold );
+    TEST_ASSERT_EQUAL_UINT32( 2, xCold.ulParses );
+    connectMeasure( cBundle, ulBundleLength, &xWarm );
+    TEST_ASSERT_EQUAL_UINT32( 0, xWarm.ulParses );
+
+    FreeRTOSHost_GetHeapStats( &xAfter );
+
+    printf( "tls_cert_cache: 5 certificates, parse %u us and heap peak %u bytes per connection without cache, "
+            "heap peak %u bytes with cache, cache resident %u bytes\n",
+            ( unsigned ) parseMicroseconds( cBundle, ulBundleLength ),
+            ( unsigned ) xCold.xHeapPeak,
+            ( unsigned ) xWarm.xHeapPeak,
+            ( unsigned ) ( xAfter.xCurrent - xBefore.xCurrent ) );
+
+    TEST_ASSERT_LESS_THAN( xCold.xHeapPeak, xWarm.xHeapPeak );
+}
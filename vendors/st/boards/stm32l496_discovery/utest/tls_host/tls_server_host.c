@@ -0,0 +1,614 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file tls_server_host.c
+ * @brief Local TLS server and device credentials, see tls_server_host.h.
+ */
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "unity.h"
+
+#include "FreeRTOS.h"
+#include "iot_tls.h"
+#include "iot_pkcs11_config.h"
+#include "iot_pkcs11.h"
+
+#include "mbedtls/certs.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/ssl_cache.h"
+#include "mbedtls/ssl_ticket.h"
+#include "mbedtls/x509_crt.h"
+
+#include "tls_server_host.h"
+
+/* PKCS#11 objects of the client. */
+#define KEY_HANDLE    ( 1U )
+#define CERT_HANDLE   ( 2U )
+
+/*-----------------------------------------------------------*/
+
+static mbedtls_entropy_context xEntropy;
+static mbedtls_ctr_drbg_context xServerDrbg;
+static mbedtls_ctr_drbg_context xClientDrbg;
+static mbedtls_x509_crt xServerCert;
+static unsigned char ucServerCertDer[ 1024 ];
+static size_t xServerCertDerLength;
+static char cServerCertPem[ 1024 ];
+static mbedtls_pk_context xServerKey;
+static mbedtls_ssl_config xServerConf;
+static mbedtls_ssl_cache_context xServerCache;
+static mbedtls_ssl_ticket_context xServerTicket;
+static uint32_t ulCertificateReads = 0;
+
+/* One end of a connection. */
+typedef struct HostConnection
+{
+    int lSocket;
+    int lResult;
+    size_t xLargestRecord;
+} HostConnection_t;
+
+/*-----------------------------------------------------------*/
+
+void vLoggingPrintf( const char * pcFormat,
+                     ... )
+{
+    va_list xArgs;
+
+    va_start( xArgs, pcFormat );
+    vprintf( pcFormat, xArgs );
+    va_end( xArgs );
+}
+
+int mbedtls_hardware_poll( void * pvData,
+                           unsigned char * pucOutput,
+                           size_t xLength,
+                           size_t * pxOutputLength )
+{
+    size_t i;
+
+    ( void ) pvData;
+
+    for( i = 0; i < xLength; i++ )
+    {
+        pucOutput[ i ] = ( unsigned char ) rand();
+    }
+
+    *pxOutputLength = xLength;
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+/* The client credentials of the device: the key is never used because the
+ * test server does not request a client certificate. */
+
+static CK_RV prvGetSlotList( CK_BBOOL xTokenPresent,
+                             CK_SLOT_ID_PTR pxSlotList,
+                             CK_ULONG_PTR pulCount )
+{
+    ( void ) xTokenPresent;
+
+    if( pxSlotList != NULL )
+    {
+        pxSlotList[ 0 ] = 1;
+    }
+
+    *pulCount = 1;
+
+    return CKR_OK;
+}
+
+static CK_RV prvOpenSession( CK_SLOT_ID xSlotID,
+                             CK_FLAGS xFlags,
+                             CK_VOID_PTR pvApplication,
+                             CK_NOTIFY xNotify,
+                             CK_SESSION_HANDLE_PTR pxSession )
+{
+    ( void ) xSlotID;
+    ( void ) xFlags;
+    ( void ) pvApplication;
+    ( void ) xNotify;
+
+    *pxSession = 1;
+
+    return CKR_OK;
+}
+
+static CK_RV prvCloseSession( CK_SESSION_HANDLE xSession )
+{
+    ( void ) xSession;
+
+    return CKR_OK;
+}
+
+static CK_RV prvLogin( CK_SESSION_HANDLE xSession,
+                       CK_USER_TYPE xUserType,
+                       CK_UTF8CHAR_PTR pucPin,
+                       CK_ULONG ulPinLen )
+{
+    ( void ) xSession;
+    ( void ) xUserType;
+    ( void ) pucPin;
+    ( void ) ulPinLen;
+
+    return CKR_OK;
+}
+
+static CK_RV prvGetAttributeValue( CK_SESSION_HANDLE xSession,
+                                   CK_OBJECT_HANDLE xObject,
+                                   CK_ATTRIBUTE_PTR pxTemplate,
+                                   CK_ULONG ulCount )
+{
+    ( void ) xSession;
+    TEST_ASSERT_EQUAL( 1, ulCount );
+
+    if( ( xObject == KEY_HANDLE ) && ( pxTemplate->type == CKA_KEY_TYPE ) )
+    {
+        *( CK_KEY_TYPE * ) pxTemplate->pValue = CKK_EC;
+
+        return CKR_OK;
+    }
+
+    if( ( xObject == CERT_HANDLE ) && ( pxTemplate->type == CKA_VALUE ) )
+    {
+        if( pxTemplate->pValue != NULL )
+        {
+            memcpy( pxTemplate->pValue, mbedtls_test_cli_crt_ec, mbedtls_test_cli_crt_ec_len );
+            ulCertificateReads++;
+        }
+
+        pxTemplate->ulValueLen = mbedtls_test_cli_crt_ec_len;
+
+        return CKR_OK;
+    }
+
+    return CKR_ATTRIBUTE_TYPE_INVALID;
+}
+
+static CK_RV prvGenerateRandom( CK_SESSION_HANDLE xSession,
+                                CK_BYTE_PTR pucRandomData,
+                                CK_ULONG ulRandomLen )
+{
+    ( void ) xSession;
+
+    return ( mbedtls_ctr_drbg_random( &xClientDrbg, pucRandomData, ulRandomLen ) == 0 ) ?
+           CKR_OK : CKR_FUNCTION_FAILED;
+}
+
+static CK_FUNCTION_LIST xFunctionList =
+{
+    .C_GetSlotList       = prvGetSlotList,
+    .C_OpenSession       = prvOpenSession,
+    .C_CloseSession      = prvCloseSession,
+    .C_Login             = prvLogin,
+    .C_GetAttributeValue = prvGetAttributeValue,
+    .C_GenerateRandom    = prvGenerateRandom
+};
+
+CK_DECLARE_FUNCTION( CK_RV, C_GetFunctionList )( CK_FUNCTION_LIST_PTR_PTR ppxFunctionList )
+{
+    *ppxFunctionList = &xFunctionList;
+
+    return CKR_OK;
+}
+
+CK_RV xInitializePKCS11( void )
+{
+    return CKR_OK;
+}
+
+CK_RV xFindObjectWithLabelAndClass( CK_SESSION_HANDLE xSession,
+                                    const char * pcLabelName,
+                                    CK_OBJECT_CLASS xClass,
+                                    CK_OBJECT_HANDLE_PTR pxHandle )
+{
+    ( void ) xSession;
+
+    if( ( xClass == CKO_PRIVATE_KEY ) &&
+        ( strcmp( pcLabelName, pkcs11configLABEL_DEVICE_PRIVATE_KEY_FOR_TLS ) == 0 ) )
+    {
+        *pxHandle = KEY_HANDLE;
+    }
+    else if( ( xClass == CKO_CERTIFICATE ) &&
+             ( strcmp( pcLabelName, pkcs11configLABEL_DEVICE_CERTIFICATE_FOR_TLS ) == 0 ) )
+    {
+        *pxHandle = CERT_HANDLE;
+    }
+    else
+    {
+        *pxHandle = CK_INVALID_HANDLE;
+    }
+
+    return CKR_OK;
+}
+
+CK_RV vAppendSHA256AlgorithmIdentifierSequence( uint8_t * puc32ByteHashedMessage,
+                                                uint8_t * puc51ByteHashOidBuffer )
+{
+    ( void ) puc32ByteHashedMessage;
+    ( void ) puc51ByteHashOidBuffer;
+
+    return CKR_FUNCTION_NOT_SUPPORTED;
+}
+
+/* The device runs mbedTLS on the FreeRTOS heap. */
+void * pvCalloc( size_t xNumElements,
+                 size_t xSize )
+{
+    void * pvNew = pvPortMalloc( xNumElements * xSize );
+
+    if( NULL != pvNew )
+    {
+        memset( pvNew, 0, xNumElements * xSize );
+    }
+
+    return pvNew;
+}
+
+/*-----------------------------------------------------------*/
+
+/* mbedTLS sends a record per call, from its header. */
+static int prvNetSend( void * pvContext,
+                       const unsigned char * pucData,
+                       size_t xLength )
+{
+    HostConnection_t * pxConnection = pvContext;
+    ssize_t xSent = send( pxConnection->lSocket, pucData, xLength, MSG_NOSIGNAL );
+    size_t xRecord;
+
+    if( xLength >= 5U )
+    {
+        xRecord = ( ( size_t ) pucData[ 3 ] << 8 ) | pucData[ 4 ];
+
+        if( xRecord > pxConnection->xLargestRecord )
+        {
+            pxConnection->xLargestRecord = xRecord;
+        }
+    }
+
+    return ( xSent < 0 ) ? MBEDTLS_ERR_NET_SEND_FAILED : ( int ) xSent;
+}
+
+static int prvNetRecv( void * pvContext,
+                       unsigned char * pucData,
+                       size_t xLength )
+{
+    HostConnection_t * pxConnection = pvContext;
+    ssize_t xReceived = recv( pxConnection->lSocket, pucData, xLength, 0 );
+
+    return ( xReceived < 0 ) ? MBEDTLS_ERR_NET_RECV_FAILED : ( int ) xReceived;
+}
+
+/* Handshake, echo the data until the close notification. */
+static void * prvServerThread( void * pvArg )
+{
+    HostConnection_t * pxConnection = pvArg;
+    mbedtls_ssl_context xSsl;
+    unsigned char ucBuffer[ 8192 ];
+    size_t xWritten;
+    int lResult;
+
+    mbedtls_ssl_init( &xSsl );
+    lResult = mbedtls_ssl_setup( &xSsl, &xServerConf );
+
+    if( lResult == 0 )
+    {
+        mbedtls_ssl_set_bio( &xSsl, pxConnection, prvNetSend, prvNetRecv, NULL );
+        lResult = mbedtls_ssl_handshake( &xSsl );
+    }
+
+    while( lResult == 0 )
+    {
+        lResult = mbedtls_ssl_read( &xSsl, ucBuffer, sizeof( ucBuffer ) );
+
+        if( ( lResult == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY ) || ( lResult == MBEDTLS_ERR_SSL_CONN_EOF ) )
+        {
+            lResult = 0;
+            break;
+        }
+
+        /* Records are limited by the fragment length, writes may be partial. */
+        for( xWritten = 0; ( lResult > 0 ) && ( xWritten < ( size_t ) lResult ); )
+        {
+            int lSent = mbedtls_ssl_write( &xSsl, &ucBuffer[ xWritten ], ( size_t ) lResult - xWritten );
+
+            if( lSent < 0 )
+            {
+                lResult = lSent;
+            }
+            else
+            {
+                xWritten += ( size_t ) lSent;
+            }
+        }
+
+        if( lResult > 0 )
+        {
+            lResult = 0;
+        }
+    }
+
+    pxConnection->lResult = lResult;
+    mbedtls_ssl_free( &xSsl );
+    close( pxConnection->lSocket );
+
+    return NULL;
+}
+
+/* Self-signed certificate of the server key, also trusted by the client. The
+ * certificates of the mbedTLS test suite have expired. */
+static void prvIssueCertificate( void )
+{
+    mbedtls_x509write_cert xWriter;
+    mbedtls_mpi xSerial;
+    unsigned char ucDer[ 1024 ];
+    int lLength;
+
+    mbedtls_x509write_crt_init( &xWriter );
+    mbedtls_mpi_init( &xSerial );
+    TEST_ASSERT_EQUAL( 0, mbedtls_mpi_lset( &xSerial, 1 ) );
+
+    mbedtls_x509write_crt_set_subject_key( &xWriter, &xServerKey );
+    mbedtls_x509write_crt_set_issuer_key( &xWriter, &xServerKey );
+    mbedtls_x509write_crt_set_md_alg( &xWriter, MBEDTLS_MD_SHA256 );
+    TEST_ASSERT_EQUAL( 0, mbedtls_x509write_crt_set_subject_name( &xWriter, "O=Test,CN=" TLS_SERVER_HOST_NAME ) );
+    TEST_ASSERT_EQUAL( 0, mbedtls_x509write_crt_set_issuer_name( &xWriter, "O=Test,CN=" TLS_SERVER_HOST_NAME ) );
+    TEST_ASSERT_EQUAL( 0, mbedtls_x509write_crt_set_serial( &xWriter, &xSerial ) );
+    TEST_ASSERT_EQUAL( 0, mbedtls_x509write_crt_set_validity( &xWriter, "20200101000000", "20991231235959" ) );
+    TEST_ASSERT_EQUAL( 0, mbedtls_x509write_crt_set_basic_constraints( &xWriter, 1, 0 ) );
+
+    /* The DER certificate is written at the end of the buffer. */
+    lLength = mbedtls_x509write_crt_der( &xWriter, ucDer, sizeof( ucDer ), mbedtls_ctr_drbg_random, &xServerDrbg );
+    TEST_ASSERT_GREATER_THAN( 0, lLength );
+    TEST_ASSERT_LESS_OR_EQUAL( sizeof( ucServerCertDer ), ( size_t ) lLength );
+    memcpy( ucServerCertDer, &ucDer[ sizeof( ucDer ) - ( size_t ) lLength ], ( size_t ) lLength );
+    xServerCertDerLength = ( size_t ) lLength;
+    TEST_ASSERT_EQUAL( 0, mbedtls_x509_crt_parse_der( &xServerCert, ucServerCertDer, xServerCertDerLength ) );
+
+    TEST_ASSERT_EQUAL( 0, mbedtls_x509write_crt_pem( &xWriter, ( unsigned char * ) cServerCertPem,
+                                                     sizeof( cServerCertPem ), mbedtls_ctr_drbg_random,
+                                                     &xServerDrbg ) );
+
+    mbedtls_mpi_free( &xSerial );
+    mbedtls_x509write_crt_free( &xWriter );
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvClientRecv( void * pvCallerContext,
+                                 unsigned char * pucReceiveBuffer,
+                                 size_t xReceiveLength )
+{
+    return ( BaseType_t ) prvNetRecv( pvCallerContext, pucReceiveBuffer, xReceiveLength );
+}
+
+static BaseType_t prvClientSend( void * pvCallerContext,
+                                 const unsigned char * pucData,
+                                 size_t xDataLength )
+{
+    return ( BaseType_t ) prvNetSend( pvCallerContext, pucData, xDataLength );
+}
+
+/*-----------------------------------------------------------*/
+
+void TlsServerHost_Init( void )
+{
+    static bool xInitialized = false;
+
+    if( xInitialized == true )
+    {
+        return;
+    }
+
+    mbedtls_entropy_init( &xEntropy );
+    mbedtls_ctr_drbg_init( &xServerDrbg );
+    mbedtls_ctr_drbg_init( &xClientDrbg );
+    mbedtls_x509_crt_init( &xServerCert );
+    mbedtls_pk_init( &xServerKey );
+
+    TEST_ASSERT_EQUAL( 0, mbedtls_ctr_drbg_seed( &xServerDrbg, mbedtls_entropy_func, &xEntropy,
+                                                 ( const unsigned char * ) "server", 6 ) );
+    TEST_ASSERT_EQUAL( 0, mbedtls_ctr_drbg_seed( &xClientDrbg, mbedtls_entropy_func, &xEntropy,
+                                                 ( const unsigned char * ) "client", 6 ) );
+    TEST_ASSERT_EQUAL( 0, mbedtls_pk_parse_key( &xServerKey, ( const unsigned char * ) mbedtls_test_srv_key_ec,
+                                                mbedtls_test_srv_key_ec_len, NULL, 0 ) );
+    prvIssueCertificate();
+    xInitialized = true;
+}
+
+/*-----------------------------------------------------------*/
+
+void TlsServerHost_Start( bool xSessionCache,
+                          bool xSessionTickets )
+{
+    mbedtls_ssl_config_init( &xServerConf );
+    TEST_ASSERT_EQUAL( 0, mbedtls_ssl_config_defaults( &xServerConf,
+                                                       MBEDTLS_SSL_IS_SERVER,
+                                                       MBEDTLS_SSL_TRANSPORT_STREAM,
+                                                       MBEDTLS_SSL_PRESET_DEFAULT ) );
+    mbedtls_ssl_conf_rng( &xServerConf, mbedtls_ctr_drbg_random, &xServerDrbg );
+    TEST_ASSERT_EQUAL( 0, mbedtls_ssl_conf_own_cert( &xServerConf, &xServerCert, &xServerKey ) );
+
+    mbedtls_ssl_cache_init( &xServerCache );
+    mbedtls_ssl_ticket_init( &xServerTicket );
+
+    if( xSessionCache == true )
+    {
+        mbedtls_ssl_conf_session_cache( &xServerConf, &xServerCache,
+                                        mbedtls_ssl_cache_get, mbedtls_ssl_cache_set );
+    }
+
+    if( xSessionTickets == true )
+    {
+        TEST_ASSERT_EQUAL( 0, mbedtls_ssl_ticket_setup( &xServerTicket, mbedtls_ctr_drbg_random, &xServerDrbg,
+                                                        MBEDTLS_CIPHER_AES_256_GCM, 86400 ) );
+        mbedtls_ssl_conf_session_tickets_cb( &xServerConf, mbedtls_ssl_ticket_write,
+                                             mbedtls_ssl_ticket_parse, &xServerTicket );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void TlsServerHost_Stop( void )
+{
+    mbedtls_ssl_ticket_free( &xServerTicket );
+    mbedtls_ssl_cache_free( &xServerCache );
+    mbedtls_ssl_config_free( &xServerConf );
+}
+
+/*-----------------------------------------------------------*/
+
+void TlsServerHost_ForgetSessions( void )
+{
+    mbedtls_ssl_cache_free( &xServerCache );
+    mbedtls_ssl_cache_init( &xServerCache );
+}
+
+/*-----------------------------------------------------------*/
+
+void TlsServerHost_GetCertificateDer( const char ** ppcCertificate,
+                                      uint32_t * pulLength )
+{
+    *ppcCertificate = ( const char * ) ucServerCertDer;
+    *pulLength = ( uint32_t ) xServerCertDerLength;
+}
+
+/*-----------------------------------------------------------*/
+
+const char * TlsServerHost_GetCertificatePem( void )
+{
+    return cServerCertPem;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t TlsServerHost_Connect( const char * pcServerCertificate,
+                                  uint32_t ulServerCertificateLength )
+{
+    TlsServerHostExchange_t xExchange = { 0 };
+
+    xExchange.xMessageLength = 4U;
+
+    return TlsServerHost_Exchange( pcServerCertificate, ulServerCertificateLength, &xExchange );
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t TlsServerHost_Exchange( const char * pcServerCertificate,
+                                   uint32_t ulServerCertificateLength,
+                                   TlsServerHostExchange_t * pxExchange )
+{
+    HostConnection_t xServer = { 0 };
+    HostConnection_t xClient = { 0 };
+    TLSParams_t xParams = { 0 };
+    pthread_t xThread;
+    void * pvTls = NULL;
+    unsigned char * pucMessage = malloc( pxExchange->xMessageLength );
+    unsigned char * pucReply = malloc( pxExchange->xMessageLength );
+    size_t xReceived = 0;
+    int lSockets[ 2 ];
+    BaseType_t xResult;
+    size_t i;
+
+    TEST_ASSERT_NOT_NULL( pucMessage );
+    TEST_ASSERT_NOT_NULL( pucReply );
+
+    for( i = 0; i < pxExchange->xMessageLength; i++ )
+    {
+        pucMessage[ i ] = ( unsigned char ) ( i * 7U );
+    }
+
+    TEST_ASSERT_EQUAL( 0, socketpair( AF_UNIX, SOCK_STREAM, 0, lSockets ) );
+    xServer.lSocket = lSockets[ 1 ];
+    xClient.lSocket = lSockets[ 0 ];
+    TEST_ASSERT_EQUAL( 0, pthread_create( &xThread, NULL, prvServerThread, &xServer ) );
+
+    xParams.ulSize = sizeof( xParams );
+    xParams.pcDestination = TLS_SERVER_HOST_NAME;
+    xParams.pcServerCertificate = pcServerCertificate;
+    xParams.ulServerCertificateLength = ulServerCertificateLength;
+    xParams.pxNetworkRecv = prvClientRecv;
+    xParams.pxNetworkSend = prvClientSend;
+    xParams.pvCallerContext = &xClient;
+    xParams.ulMaxFragmentLength = pxExchange->ulMaxFragmentLength;
+
+    TEST_ASSERT_EQUAL( 0, TLS_Init( &pvTls, &xParams ) );
+    xResult = TLS_Connect( pvTls );
+
+    if( xResult == 0 )
+    {
+        TEST_ASSERT_EQUAL( pxExchange->xMessageLength,
+                           TLS_Send( pvTls, pucMessage, pxExchange->xMessageLength ) );
+
+        while( xReceived < pxExchange->xMessageLength )
+        {
+            BaseType_t xRead = TLS_Recv( pvTls, &pucReply[ xReceived ],
+                                         pxExchange->xMessageLength - xReceived );
+
+            TEST_ASSERT_GREATER_THAN( 0, xRead );
+            xReceived += ( size_t ) xRead;
+        }
+
+        TEST_ASSERT_EQUAL_MEMORY( pucMessage, pucReply, pxExchange->xMessageLength );
+    }
+
+    TLS_GetMemoryStats( pvTls, &pxExchange->xMemory );
+    TLS_Cleanup( pvTls );
+    shutdown( lSockets[ 0 ], SHUT_RDWR );
+    TEST_ASSERT_EQUAL( 0, pthread_join( xThread, NULL ) );
+    close( lSockets[ 0 ] );
+    free( pucMessage );
+    free( pucReply );
+
+    if( xResult == 0 )
+    {
+        TEST_ASSERT_EQUAL( 0, xServer.lResult );
+    }
+
+    pxExchange->xLargestServerRecord = xServer.xLargestRecord;
+    pxExchange->xLargestClientRecord = xClient.xLargestRecord;
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t TlsServerHost_GetCertificateReads( void )
+{
+    return ulCertificateReads;
+}
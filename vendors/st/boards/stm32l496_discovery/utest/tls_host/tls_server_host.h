@@ -0,0 +1,133 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file tls_server_host.h
+ * @brief Local TLS server and device credentials for host tests of the TLS
+ * library.
+ *
+ * The server runs on a thread, one connection at a time, over a socket pair.
+ * Its certificate is issued at start up for TLS_SERVER_HOST_NAME. The
+ * PKCS#11 module of the device is stubbed with an EC key and certificate;
+ * the server does not request a client certificate.
+ *
+ * Allocations of mbedTLS go through pvPortMalloc(), as on the device.
+ */
+
+#ifndef TLS_SERVER_HOST_H
+#define TLS_SERVER_HOST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "iot_tls.h"
+
+/**
+ * @brief Name in the server certificate.
+ */
+#define TLS_SERVER_HOST_NAME    "localhost"
+
+/**
+ * @brief Seed the random generators and issue the server certificate. Only
+ * the first call has an effect.
+ */
+void TlsServerHost_Init( void );
+
+/**
+ * @brief Configure the server for the next connections.
+ *
+ * @param[in] xSessionCache Resume sessions by session ID.
+ * @param[in] xSessionTickets Resume sessions by session ticket.
+ */
+void TlsServerHost_Start( bool xSessionCache,
+                          bool xSessionTickets );
+
+/**
+ * @brief Free the configuration of TlsServerHost_Start().
+ */
+void TlsServerHost_Stop( void );
+
+/**
+ * @brief Forget the sessions of the session cache, as a restarted server.
+ */
+void TlsServerHost_ForgetSessions( void );
+
+/**
+ * @brief Server certificate, DER encoded.
+ */
+void TlsServerHost_GetCertificateDer( const char ** ppcCertificate,
+                                      uint32_t * pulLength );
+
+/**
+ * @brief Server certificate, PEM encoded and NUL terminated.
+ */
+const char * TlsServerHost_GetCertificatePem( void );
+
+/**
+ * @brief Connect through TLS_Connect, exchange one message and close.
+ *
+ * @param[in] pcServerCertificate Certificates trusted by the client, see
+ * TLSParams_t.
+ * @param[in] ulServerCertificateLength Length of @p pcServerCertificate.
+ *
+ * @return Result of TLS_Connect.
+ */
+BaseType_t TlsServerHost_Connect( const char * pcServerCertificate,
+                                  uint32_t ulServerCertificateLength );
+
+/**
+ * @brief One connection made by TlsServerHost_Exchange().
+ */
+typedef struct TlsServerHostExchange
+{
+    uint32_t ulMaxFragmentLength; /**< Given to TLS_Init. */
+    size_t xMessageLength;        /**< Bytes sent to the server and echoed back. */
+    TLSMemoryStats_t xMemory;     /**< Memory of the client, read before TLS_Cleanup. */
+    size_t xLargestServerRecord;  /**< Largest record sent by the server, protected. */
+    size_t xLargestClientRecord;  /**< Largest record sent by the client, protected. */
+} TlsServerHostExchange_t;
+
+/**
+ * @brief Connect through TLS_Connect, have a message echoed and close.
+ *
+ * @param[in] pcServerCertificate Certificates trusted by the client, see
+ * TLSParams_t.
+ * @param[in] ulServerCertificateLength Length of @p pcServerCertificate.
+ * @param[in,out] pxExchange Parameters and results of the connection.
+ *
+ * @return Result of TLS_Connect.
+ */
+BaseType_t TlsServerHost_Exchange( const char * pcServerCertificate,
+                                   uint32_t ulServerCertificateLength,
+                                   TlsServerHostExchange_t * pxExchange );
+
+/**
+ * @brief Number of times the device certificate was read from PKCS#11.
+ */
+uint32_t TlsServerHost_GetCertificateReads( void );
+
+#endif /* TLS_SERVER_HOST_H */
@@ -0,0 +1,232 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/* C runtime includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity.h"
+
+#include "FreeRTOS.h"
+#include "iot_tls.h"
+#include "iot_pkcs11.h"
+
+#include "mbedtls/ssl.h"
+#include "mbedtls/ssl_internal.h"
+
+#include "freertos_host.h"
+#include "tls_server_host.h"
+
+/* Echoed message, several records of any fragment length. */
+#define MESSAGE_LENGTH    ( 6000U )
+
+/* Largest fragment length the record buffers allow. */
+#define BUFFER_FRAGMENT_LENGTH                                          \
+    ( ( MBEDTLS_SSL_IN_CONTENT_LEN < MBEDTLS_SSL_OUT_CONTENT_LEN ) ?   \
+      MBEDTLS_SSL_IN_CONTENT_LEN : MBEDTLS_SSL_OUT_CONTENT_LEN )
+
+/* ============================  GLOBAL VARIABLES =========================== */
+
+static const char * pcServerDer;
+static uint32_t ulServerDerLength;
+
+/* Lengths of RFC 6066, and none. */
+static const uint32_t ulFragmentLengths[] = { 0U, 512U, 1024U, 2048U, 4096U };
+
+/* ==========================  Helper functions  ============================ */
+
+static int dummyNetwork( void * pvCallerContext,
+                         unsigned char * pucData,
+                         size_t xLength )
+{
+    ( void ) pvCallerContext;
+    ( void ) pucData;
+    ( void ) xLength;
+
+    return 0;
+}
+
+/* TLS_Init result for a fragment length, with parameters of @p ulSize. */
+static BaseType_t initWithFragmentLength( uint32_t ulSize,
+                                          uint32_t ulMaxFragmentLength,
+                                          TLSMemoryStats_t * pxMemory )
+{
+    TLSParams_t xParams = { 0 };
+    void * pvTls = NULL;
+    BaseType_t xResult;
+
+    xParams.ulSize = ulSize;
+    xParams.pcDestination = TLS_SERVER_HOST_NAME;
+    xParams.pxNetworkRecv = ( NetworkRecv_t ) dummyNetwork;
+    xParams.pxNetworkSend = ( NetworkSend_t ) dummyNetwork;
+    xParams.ulMaxFragmentLength = ulMaxFragmentLength;
+
+    xResult = TLS_Init( &pvTls, &xParams );
+
+    if( xResult == 0 )
+    {
+        TLS_GetMemoryStats( pvTls, pxMemory );
+    }
+
+    TLS_Cleanup( pvTls );
+
+    return xResult;
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* called before each testcase */
+void setUp( void )
+{
+    TlsServerHost_Init();
+    TlsServerHost_GetCertificateDer( &pcServerDer, &ulServerDerLength );
+    TlsServerHost_Start( false, false );
+    FreeRTOSHost_SetHeapTrace( TLS_HeapTraceMalloc, TLS_HeapTraceFree );
+}
+
+/* called after each testcase */
+void tearDown( void )
+{
+    FreeRTOSHost_SetHeapTrace( NULL, NULL );
+    TlsServerHost_Stop();
+}
+
+/* called at the beginning of the whole suite */
+void suiteSetUp()
+{
+}
+
+/* called at the end of the whole suite */
+int suiteTearDown( int numFailures )
+{
+    return( numFailures > 0 );
+}
+
+/* =========================  TESTING record buffers  ======================= */
+/*!
+ * @brief A message larger than the record buffers is echoed with each
+ * fragment length they allow, in records no larger than the fragment length.
+ */
+void test_FragmentLengths_LargeMessageEchoed( void )
+{
+    TlsServerHostExchange_t xExchange;
+    size_t i;
+
+    for( i = 0; i < sizeof( ulFragmentLengths ) / sizeof( ulFragmentLengths[ 0 ] ); i++ )
+    {
+        if( ulFragmentLengths[ i ] > BUFFER_FRAGMENT_LENGTH )
+        {
+            continue;
+        }
+
+        memset( &xExchange, 0, sizeof( xExchange ) );
+        xExchange.ulMaxFragmentLength = ulFragmentLengths[ i ];
+        xExchange.xMessageLength = MESSAGE_LENGTH;
+
+        TEST_ASSERT_EQUAL( 0, TlsServerHost_Exchange( pcServerDer, ulServerDerLength, &xExchange ) );
+        TEST_ASSERT_EQUAL_UINT32( ulFragmentLengths[ i ], xExchange.xMemory.ulMaxFragmentLength );
+
+        if( ulFragmentLengths[ i ] != 0U )
+        {
+            TEST_ASSERT_LESS_OR_EQUAL( ulFragmentLengths[ i ] + MBEDTLS_SSL_PAYLOAD_OVERHEAD,
+                                       xExchange.xLargestServerRecord );
+            TEST_ASSERT_LESS_OR_EQUAL( ulFragmentLengths[ i ] + MBEDTLS_SSL_PAYLOAD_OVERHEAD,
+                                       xExchange.xLargestClientRecord );
+        }
+        else
+        {
+            TEST_ASSERT_LESS_OR_EQUAL( MBEDTLS_SSL_OUT_PAYLOAD_LEN, xExchange.xLargestClientRecord );
+        }
+
+        printf( "tls_profile: in %u out %u bytes, fragment length %u: heap peak %u bytes, "
+                "%u bytes held, largest records %u/%u bytes\n",
+                ( unsigned ) xExchange.xMemory.ulInContentLength,
+                ( unsigned ) xExchange.xMemory.ulOutContentLength,
+                ( unsigned ) ulFragmentLengths[ i ],
+                ( unsigned ) xExchange.xMemory.ulHeapPeak,
+                ( unsigned ) xExchange.xMemory.ulHeapCurrent,
+                ( unsigned ) xExchange.xLargestServerRecord,
+                ( unsigned ) xExchange.xLargestClientRecord );
+    }
+}
+
+/*!
+ * @brief A fragment length that is not defined or that the record buffers
+ * cannot hold is rejected by TLS_Init.
+ */
+void test_InvalidFragmentLength_Rejected( void )
+{
+    TLSMemoryStats_t xMemory;
+    size_t i;
+
+    TEST_ASSERT_EQUAL( CKR_ARGUMENTS_BAD, initWithFragmentLength( sizeof( TLSParams_t ), 3000U, &xMemory ) );
+    TEST_ASSERT_EQUAL( CKR_ARGUMENTS_BAD, initWithFragmentLength( sizeof( TLSParams_t ), 16384U, &xMemory ) );
+
+    for( i = 0; i < sizeof( ulFragmentLengths ) / sizeof( ulFragmentLengths[ 0 ] ); i++ )
+    {
+        TEST_ASSERT_EQUAL( ( ulFragmentLengths[ i ] > BUFFER_FRAGMENT_LENGTH ) ? CKR_ARGUMENTS_BAD : 0,
+                           initWithFragmentLength( sizeof( TLSParams_t ), ulFragmentLengths[ i ], &xMemory ) );
+    }
+}
+
+/*!
+ * @brief The fragment length is not read from the parameters of a caller
+ * built before it existed.
+ */
+void test_OlderParameters_DefaultFragmentLength( void )
+{
+    TLSMemoryStats_t xMemory;
+
+    TEST_ASSERT_EQUAL( 0, initWithFragmentLength( offsetof( TLSParams_t, ulMaxFragmentLength ), 3000U, &xMemory ) );
+    TEST_ASSERT_EQUAL_UINT32( tlsMAX_FRAGMENT_LENGTH, xMemory.ulMaxFragmentLength );
+    TEST_ASSERT_EQUAL_UINT32( MBEDTLS_SSL_IN_CONTENT_LEN, xMemory.ulInContentLength );
+    TEST_ASSERT_EQUAL_UINT32( MBEDTLS_SSL_OUT_CONTENT_LEN, xMemory.ulOutContentLength );
+}
+
+/*!
+ * @brief The heap reported for a context holds its record buffers and stays
+ * within the heap used by the connecting thread.
+ */
+void test_HeapStats_CoverTheConnection( void )
+{
+    TlsServerHostExchange_t xExchange = { 0 };
+    FreeRTOSHostHeapStats_t xHeap;
+
+    /* The certificates are then taken from the cache. */
+    xExchange.xMessageLength = 4U;
+    TEST_ASSERT_EQUAL( 0, TlsServerHost_Exchange( pcServerDer, ulServerDerLength, &xExchange ) );
+
+    FreeRTOSHost_HeapMeasure();
+    TEST_ASSERT_EQUAL( 0, TlsServerHost_Exchange( pcServerDer, ulServerDerLength, &xExchange ) );
+    FreeRTOSHost_GetHeapStats( &xHeap );
+
+    TEST_ASSERT_GREATER_OR_EQUAL( MBEDTLS_SSL_IN_BUFFER_LEN + MBEDTLS_SSL_OUT_BUFFER_LEN,
+                                  xExchange.xMemory.ulHeapCurrent );
+    TEST_ASSERT_GREATER_THAN( xExchange.xMemory.ulHeapCurrent, xExchange.xMemory.ulHeapPeak );
+    TEST_ASSERT_LESS_OR_EQUAL( xHeap.xPeak, xExchange.xMemory.ulHeapPeak );
+}
@@ -0,0 +1,356 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+
+#include "tls_session_store.h"
+
+/* Geometry of the simulated flash: two STM32L4 pages, as on the board. */
+#define PAGE_SIZE          ( 2048U )
+#define PAGE_COUNT         ( 2U )
+
+/* Size of a session with a typical ticket. */
+#define SESSION_LENGTH     ( 250U )
+
+/* ============================  GLOBAL VARIABLES =========================== */
+
+static uint64_t ullFlash[ ( PAGE_COUNT * PAGE_SIZE ) / sizeof( uint64_t ) ];
+static uint8_t * const pucFlash = ( uint8_t * ) ullFlash;
+
+static uint32_t ulProgramOps;
+static uint32_t ulEraseOps;
+static uint32_t ulProgramViolations;
+
+/* Double words left before the power is cut, negative when no cut is armed. */
+static int32_t lOpsBeforeCut;
+
+static TlsSessionStore_t xStore;
+
+/* ===========================  Flash simulator  ============================ */
+
+static int32_t simErase( void * pvContext,
+                         uint32_t ulOffset )
+{
+    TEST_ASSERT_EQUAL_PTR( ullFlash, pvContext );
+    TEST_ASSERT_EQUAL( 0, ulOffset % PAGE_SIZE );
+
+    memset( &pucFlash[ ulOffset ], 0xFF, PAGE_SIZE );
+    ulEraseOps++;
+
+    return 0;
+}
+
+static int32_t simProgram( void * pvContext,
+                           uint32_t ulOffset,
+                           const void * pvData,
+                           uint32_t ulLength )
+{
+    const uint8_t * pucData = pvData;
+    uint32_t i, j;
+
+    TEST_ASSERT_EQUAL_PTR( ullFlash, pvContext );
+    TEST_ASSERT_EQUAL( 0, ulOffset % tlssessionstorePROGRAM_UNIT );
+    TEST_ASSERT_EQUAL( 0, ulLength % tlssessionstorePROGRAM_UNIT );
+    TEST_ASSERT_EQUAL( 0, ( uintptr_t ) pvData % tlssessionstorePROGRAM_UNIT );
+    TEST_ASSERT_TRUE( ( ulOffset / PAGE_SIZE ) == ( ( ulOffset + ulLength - 1U ) / PAGE_SIZE ) );
+
+    for( i = 0; i < ulLength; i += tlssessionstorePROGRAM_UNIT )
+    {
+        /* Like the L4 controller, refuse to program a used double word. */
+        for( j = 0; j < tlssessionstorePROGRAM_UNIT; j++ )
+        {
+            if( pucFlash[ ulOffset + i + j ] != 0xFFU )
+            {
+                ulProgramViolations++;
+
+                return -1;
+            }
+        }
+
+        if( lOpsBeforeCut == 0 )
+        {
+            return -1;
+        }
+
+        if( lOpsBeforeCut > 0 )
+        {
+            lOpsBeforeCut--;
+        }
+
+        memcpy( &pucFlash[ ulOffset + i ], &pucData[ i ], tlssessionstorePROGRAM_UNIT );
+        ulProgramOps++;
+    }
+
+    return 0;
+}
+
+static const TlsSessionFlash_t xSimFlash =
+{
+    .pucBase     = ( const volatile uint8_t * ) ullFlash,
+    .ulPageSize  = PAGE_SIZE,
+    .ulPageCount = PAGE_COUNT,
+    .xErase      = simErase,
+    .xProgram    = simProgram,
+    .pvContext   = ullFlash
+};
+
+/* ==========================  Helper functions  ============================ */
+
+static void makeSession( uint8_t ucSeed,
+                         uint8_t * pucSession,
+                         size_t xLength )
+{
+    size_t i;
+
+    for( i = 0; i < xLength; i++ )
+    {
+        pucSession[ i ] = ( uint8_t ) ( ucSeed + ( i * 7U ) );
+    }
+}
+
+static void checkLoad( const char * pcEndpoint,
+                       uint8_t ucSeed,
+                       size_t xLength )
+{
+    uint8_t ucExpected[ tlssessionstoreMAX_SESSION_LENGTH ];
+    uint8_t ucSession[ tlssessionstoreMAX_SESSION_LENGTH ];
+    size_t xLoaded = 0;
+
+    makeSession( ucSeed, ucExpected, xLength );
+    TEST_ASSERT_TRUE( TlsSessionStore_Load( &xStore, pcEndpoint, ucSession, &xLoaded ) );
+    TEST_ASSERT_EQUAL( xLength, xLoaded );
+    TEST_ASSERT_EQUAL_MEMORY( ucExpected, ucSession, xLength );
+}
+
+static bool save( const char * pcEndpoint,
+                  uint8_t ucSeed,
+                  size_t xLength )
+{
+    /* One spare byte to check the rejection of oversized sessions. */
+    uint8_t ucSession[ tlssessionstoreMAX_SESSION_LENGTH + 1U ];
+
+    makeSession( ucSeed, ucSession, xLength );
+
+    return TlsSessionStore_Save( &xStore, pcEndpoint, ucSession, xLength );
+}
+
+static bool isStored( const char * pcEndpoint )
+{
+    uint8_t ucSession[ tlssessionstoreMAX_SESSION_LENGTH ];
+    size_t xLoaded = 0;
+
+    return TlsSessionStore_Load( &xStore, pcEndpoint, ucSession, &xLoaded );
+}
+
+static void reboot( void )
+{
+    lOpsBeforeCut = -1;
+    TEST_ASSERT_TRUE( TlsSessionStore_Open( &xStore, &xSimFlash ) );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* called before each testcase */
+void setUp( void )
+{
+    memset( ullFlash, 0xFF, sizeof( ullFlash ) );
+    ulProgramOps = 0;
+    ulEraseOps = 0;
+    ulProgramViolations = 0;
+    reboot();
+}
+
+/* called after each testcase */
+void tearDown( void )
+{
+    TEST_ASSERT_EQUAL_UINT32( 0, ulProgramViolations );
+}
+
+/* called at the beginning of the whole suite */
+void suiteSetUp()
+{
+}
+
+/* called at the end of the whole suite */
+int suiteTearDown( int numFailures )
+{
+    return( numFailures > 0 );
+}
+
+/* =======================  TESTING TlsSessionStore  ======================== */
+/*!
+ * @brief An invalid flash description is rejected.
+ */
+void test_Open_InvalidGeometry( void )
+{
+    TlsSessionFlash_t xFlash = xSimFlash;
+
+    xFlash.ulPageCount = 0;
+    TEST_ASSERT_FALSE( TlsSessionStore_Open( &xStore, &xFlash ) );
+
+    xFlash = xSimFlash;
+    xFlash.ulPageSize = 256;
+    TEST_ASSERT_FALSE( TlsSessionStore_Open( &xStore, &xFlash ) );
+
+    xFlash = xSimFlash;
+    xFlash.xErase = NULL;
+    TEST_ASSERT_FALSE( TlsSessionStore_Open( &xStore, &xFlash ) );
+}
+
+/*!
+ * @brief A saved session is found again after a reboot, and only by its
+ * server.
+ */
+void test_SaveLoad_Reopen( void )
+{
+    TEST_ASSERT_FALSE( isStored( "a.example.com" ) );
+    TEST_ASSERT_TRUE( save( "a.example.com", 1, SESSION_LENGTH ) );
+    checkLoad( "a.example.com", 1, SESSION_LENGTH );
+    TEST_ASSERT_FALSE( isStored( "b.example.com" ) );
+
+    reboot();
+    checkLoad( "a.example.com", 1, SESSION_LENGTH );
+    TEST_ASSERT_EQUAL_UINT32( 0, ulEraseOps );
+
+    /* Too long to be stored. */
+    TEST_ASSERT_FALSE( save( "a.example.com", 2, tlssessionstoreMAX_SESSION_LENGTH + 1U ) );
+    checkLoad( "a.example.com", 1, SESSION_LENGTH );
+}
+
+/*!
+ * @brief Renewing the session appends to the page of the server and erases
+ * it only once it is full.
+ */
+void test_Renew_AppendsBeforeErase( void )
+{
+    const uint32_t ulRecordSize = tlssessionstoreRECORD_HEADER_LENGTH + SESSION_LENGTH + 6U;
+    const uint32_t ulPerPage = PAGE_SIZE / ulRecordSize;
+    uint32_t i;
+
+    for( i = 0; i < ulPerPage; i++ )
+    {
+        TEST_ASSERT_TRUE( save( "a.example.com", ( uint8_t ) i, SESSION_LENGTH ) );
+        checkLoad( "a.example.com", ( uint8_t ) i, SESSION_LENGTH );
+    }
+
+    TEST_ASSERT_EQUAL_UINT32( 0, ulEraseOps );
+    TEST_ASSERT_EQUAL_UINT32( ulPerPage * ( ulRecordSize / tlssessionstorePROGRAM_UNIT ), ulProgramOps );
+
+    TEST_ASSERT_TRUE( save( "a.example.com", 100, SESSION_LENGTH ) );
+    TEST_ASSERT_EQUAL_UINT32( 1, ulEraseOps );
+    checkLoad( "a.example.com", 100, SESSION_LENGTH );
+
+    reboot();
+    checkLoad( "a.example.com", 100, SESSION_LENGTH );
+}
+
+/*!
+ * @brief Each server has its own page, the least recently saved one is
+ * reclaimed for a new server.
+ */
+void test_Servers_LeastRecentlySavedReclaimed( void )
+{
+    TEST_ASSERT_TRUE( save( "a.example.com", 1, SESSION_LENGTH ) );
+    TEST_ASSERT_TRUE( save( "b.example.com", 2, 120 ) );
+    TEST_ASSERT_TRUE( save( "a.example.com", 3, SESSION_LENGTH ) );
+    checkLoad( "a.example.com", 3, SESSION_LENGTH );
+    checkLoad( "b.example.com", 2, 120 );
+    TEST_ASSERT_EQUAL_UINT32( 0, ulEraseOps );
+
+    /* b was saved before the last save of a. */
+    reboot();
+    TEST_ASSERT_TRUE( save( "c.example.com", 4, 90 ) );
+    TEST_ASSERT_EQUAL_UINT32( 1, ulEraseOps );
+    checkLoad( "a.example.com", 3, SESSION_LENGTH );
+    checkLoad( "c.example.com", 4, 90 );
+    TEST_ASSERT_FALSE( isStored( "b.example.com" ) );
+}
+
+/*!
+ * @brief A forgotten session is not loaded, and its page is the first one
+ * reclaimed.
+ */
+void test_Forget( void )
+{
+    TEST_ASSERT_TRUE( TlsSessionStore_Save( &xStore, "a.example.com", NULL, 0 ) );
+    TEST_ASSERT_EQUAL_UINT32( 0, ulProgramOps );
+
+    TEST_ASSERT_TRUE( save( "a.example.com", 1, SESSION_LENGTH ) );
+    TEST_ASSERT_TRUE( save( "b.example.com", 2, SESSION_LENGTH ) );
+    TEST_ASSERT_TRUE( TlsSessionStore_Save( &xStore, "b.example.com", NULL, 0 ) );
+    TEST_ASSERT_FALSE( isStored( "b.example.com" ) );
+
+    reboot();
+    TEST_ASSERT_FALSE( isStored( "b.example.com" ) );
+    TEST_ASSERT_TRUE( save( "c.example.com", 3, SESSION_LENGTH ) );
+    checkLoad( "a.example.com", 1, SESSION_LENGTH );
+    checkLoad( "c.example.com", 3, SESSION_LENGTH );
+}
+
+/*!
+ * @brief A save cut by a reset leaves the previous session in place and the
+ * page usable.
+ */
+void test_PowerCut_KeepsPreviousSession( void )
+{
+    uint32_t ulCut;
+
+    for( ulCut = 0; ulCut < ( tlssessionstoreRECORD_HEADER_LENGTH + SESSION_LENGTH ) / 8U; ulCut += 3U )
+    {
+        setUp();
+        TEST_ASSERT_TRUE( save( "a.example.com", 1, SESSION_LENGTH ) );
+
+        lOpsBeforeCut = ( int32_t ) ulCut;
+        TEST_ASSERT_FALSE( save( "a.example.com", 2, SESSION_LENGTH ) );
+
+        reboot();
+        checkLoad( "a.example.com", 1, SESSION_LENGTH );
+        TEST_ASSERT_TRUE( save( "a.example.com", 3, SESSION_LENGTH ) );
+        checkLoad( "a.example.com", 3, SESSION_LENGTH );
+    }
+}
+
+/*!
+ * @brief Content that is not a record (flash left over by an older layout)
+ * is reclaimed.
+ */
+void test_Garbage_Reclaimed( void )
+{
+    memset( pucFlash, 0x5A, PAGE_COUNT * PAGE_SIZE );
+    reboot();
+
+    TEST_ASSERT_FALSE( isStored( "a.example.com" ) );
+    TEST_ASSERT_TRUE( save( "a.example.com", 1, SESSION_LENGTH ) );
+    TEST_ASSERT_TRUE( save( "b.example.com", 2, SESSION_LENGTH ) );
+    checkLoad( "a.example.com", 1, SESSION_LENGTH );
+    checkLoad( "b.example.com", 2, SESSION_LENGTH );
+    TEST_ASSERT_EQUAL_UINT32( 2, ulEraseOps );
+}
@@ -0,0 +1,271 @@
+/*
+ * FreeRTOS V1.4.7
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "unity.h"
+
+#include "FreeRTOS.h"
+#include "iot_tls.h"
+
+#include "tls_server_host.h"
+#include "tls_session_store.h"
+
+/* Simulated flash of the session store, as on the board. */
+#define PAGE_SIZE          ( 2048U )
+#define PAGE_COUNT         ( 2U )
+
+/* ============================  GLOBAL VARIABLES =========================== */
+
+static uint64_t ullFlash[ ( PAGE_COUNT * PAGE_SIZE ) / sizeof( uint64_t ) ];
+static uint8_t * const pucFlash = ( uint8_t * ) ullFlash;
+static TlsSessionStore_t xStore;
+
+/* Trusted by the client. */
+static const char * pcServerCertificate;
+static uint32_t ulServerCertificateLength;
+
+/* ===========================  Flash simulator  ============================ */
+
+static int32_t simErase( void * pvContext,
+                         uint32_t ulOffset )
+{
+    ( void ) pvContext;
+
+    memset( &pucFlash[ ulOffset ], 0xFF, PAGE_SIZE );
+
+    return 0;
+}
+
+static int32_t simProgram( void * pvContext,
+                           uint32_t ulOffset,
+                           const void * pvData,
+                           uint32_t ulLength )
+{
+    ( void ) pvContext;
+
+    memcpy( &pucFlash[ ulOffset ], pvData, ulLength );
+
+    return 0;
+}
+
+static const TlsSessionFlash_t xSimFlash =
+{
+    .pucBase     = ( const volatile uint8_t * ) ullFlash,
+    .ulPageSize  = PAGE_SIZE,
+    .ulPageCount = PAGE_COUNT,
+    .xErase      = simErase,
+    .xProgram    = simProgram,
+    .pvContext   = NULL
+};
+
+/* Bound to the TLS library as on the board. */
+static BaseType_t storeLoad( void * pvContext,
+                             const char * pcEndpoint,
+                             unsigned char * pucSession,
+                             size_t * pxSessionLength )
+{
+    ( void ) pvContext;
+
+    return TlsSessionStore_Load( &xStore, pcEndpoint, pucSession, pxSessionLength ) ? pdTRUE : pdFALSE;
+}
+
+static BaseType_t storeSave( void * pvContext,
+                             const char * pcEndpoint,
+                             const unsigned char * pucSession,
+                             size_t xSessionLength )
+{
+    ( void ) pvContext;
+
+    return TlsSessionStore_Save( &xStore, pcEndpoint, pucSession, xSessionLength ) ? pdTRUE : pdFALSE;
+}
+
+static const TLSSessionStore_t xStoreInterface =
+{
+    .xLoad     = storeLoad,
+    .xSave     = storeSave,
+    .pvContext = NULL
+};
+
+/* ==========================  Helper functions  ============================ */
+
+/* Connect and tell which kind of handshake was run. */
+static void connectExpect( bool xResumed,
+                           TLSHandshakeStats_t * pxDelta )
+{
+    TLSHandshakeStats_t xBefore, xAfter;
+
+    TLS_GetHandshakeStats( &xBefore );
+    TEST_ASSERT_EQUAL( 0, TlsServerHost_Connect( pcServerCertificate, ulServerCertificateLength ) );
+    TLS_GetHandshakeStats( &xAfter );
+
+    TEST_ASSERT_EQUAL_UINT32( xBefore.ulFailed, xAfter.ulFailed );
+    TEST_ASSERT_EQUAL_UINT32( xResumed ? 0U : 1U, xAfter.ulFull - xBefore.ulFull );
+    TEST_ASSERT_EQUAL_UINT32( xResumed ? 1U : 0U, xAfter.ulResumed - xBefore.ulResumed );
+
+    if( pxDelta != NULL )
+    {
+        pxDelta->ulFullBytes = xAfter.ulFullBytes - xBefore.ulFullBytes;
+        pxDelta->ulFullMs = xAfter.ulFullMs - xBefore.ulFullMs;
+        pxDelta->ulResumedBytes = xAfter.ulResumedBytes - xBefore.ulResumedBytes;
+        pxDelta->ulResumedMs = xAfter.ulResumedMs - xBefore.ulResumedMs;
+    }
+}
+
+/* Power cycle of the device: only the flash is kept. */
+static void reboot( void )
+{
+    TEST_ASSERT_TRUE( TlsSessionStore_Open( &xStore, &xSimFlash ) );
+}
+
+static bool isStored( void )
+{
+    uint8_t ucSession[ tlssessionstoreMAX_SESSION_LENGTH ];
+    size_t xLength;
+
+    return TlsSessionStore_Load( &xStore, TLS_SERVER_HOST_NAME, ucSession, &xLength );
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+/* called before each testcase */
+void setUp( void )
+{
+    TlsServerHost_Init();
+    TlsServerHost_GetCertificateDer( &pcServerCertificate, &ulServerCertificateLength );
+    memset( ullFlash, 0xFF, sizeof( ullFlash ) );
+    reboot();
+    TLS_SetSessionStore( &xStoreInterface );
+}
+
+/* called after each testcase */
+void tearDown( void )
+{
+    TlsServerHost_Stop();
+    TLS_SetSessionStore( NULL );
+}
+
+/* called at the beginning of the whole suite */
+void suiteSetUp()
+{
+}
+
+/* called at the end of the whole suite */
+int suiteTearDown( int numFailures )
+{
+    return( numFailures > 0 );
+}
+
+/* ========================  TESTING TLS resumption  ======================== */
+/*!
+ * @brief A session ID kept in flash is resumed after a power cycle, with a
+ * fraction of the bytes of a full handshake.
+ */
+void test_SessionId_ResumedAfterReboot( void )
+{
+    TLSHandshakeStats_t xFull = { 0 }, xResumed = { 0 };
+
+    TlsServerHost_Start( true, false );
+
+    connectExpect( false, &xFull );
+    TEST_ASSERT_TRUE( isStored() );
+
+    reboot();
+    connectExpect( true, &xResumed );
+
+    printf( "tls_session: full handshake %u bytes %u ms, resumed %u bytes %u ms\n",
+            ( unsigned ) xFull.ulFullBytes, ( unsigned ) xFull.ulFullMs,
+            ( unsigned ) xResumed.ulResumedBytes, ( unsigned ) xResumed.ulResumedMs );
+
+    TEST_ASSERT_LESS_THAN_UINT32( xFull.ulFullBytes / 2U, xResumed.ulResumedBytes );
+}
+
+/*!
+ * @brief A session ticket kept in flash is resumed, the renewed ticket is
+ * saved again.
+ */
+void test_Ticket_ResumedAfterReboot( void )
+{
+    TlsServerHost_Start( false, true );
+
+    connectExpect( false, NULL );
+    TEST_ASSERT_TRUE( isStored() );
+
+    reboot();
+    connectExpect( true, NULL );
+
+    reboot();
+    connectExpect( true, NULL );
+
+    /* The ticket renewed by the server replaced the offered one. */
+    TEST_ASSERT_EQUAL_UINT32( 1, xStore.xStats.ulWrites );
+}
+
+/*!
+ * @brief A session the server no longer knows falls back to a full
+ * handshake, whose session replaces it.
+ */
+void test_ServerForgot_FullHandshakeSaved( void )
+{
+    TlsServerHost_Start( true, false );
+    connectExpect( false, NULL );
+
+    /* The server restarted. */
+    TlsServerHost_ForgetSessions();
+
+    connectExpect( false, NULL );
+    connectExpect( true, NULL );
+}
+
+/*!
+ * @brief An unreadable saved session is not offered.
+ */
+void test_CorruptSession_Ignored( void )
+{
+    uint8_t ucGarbage[ 120 ];
+
+    memset( ucGarbage, 0xA5, sizeof( ucGarbage ) );
+    TEST_ASSERT_TRUE( TlsSessionStore_Save( &xStore, TLS_SERVER_HOST_NAME, ucGarbage, sizeof( ucGarbage ) ) );
+
+    TlsServerHost_Start( true, true );
+    connectExpect( false, NULL );
+    connectExpect( true, NULL );
+}
+
+/*!
+ * @brief Without a store every handshake is a full one.
+ */
+void test_NoStore_AlwaysFull( void )
+{
+    TLS_SetSessionStore( NULL );
+    TlsServerHost_Start( true, true );
+
+    connectExpect( false, NULL );
+    connectExpect( false, NULL );
+    TEST_ASSERT_FALSE( isStored() );
+}